@@ -96,6 +96,9 @@ PERFETTO_CONFIG = struct(
         expat = [],
         jsoncpp = [],
         linenoise = [],
+        # SQLite is built with SQLITE_THREADSAFE=0. trace_processor_shell
+        # --http-max-sessions needs ["-USQLITE_THREADSAFE",
+        # "-DSQLITE_THREADSAFE=2"] here.
         sqlite = [],
         llvm_demangle = [],
         open_csd = [],
@@ -22,6 +22,7 @@
 
 #include "perfetto/base/build_config.h"
 #include "perfetto/ext/base/container_annotations.h"
+#include "perfetto/ext/base/scoped_file.h"
 
 // We need to track the committed size on windows and when ASAN is enabled.
 #if PERFETTO_BUILDFLAG(PERFETTO_OS_WIN) || defined(ADDRESS_SANITIZER)
@@ -30,6 +31,14 @@
 #define TRACK_COMMITTED_SIZE() 0
 #endif
 
+// Clone() can share pages copy-on-write only where memfd is available.
+#if PERFETTO_BUILDFLAG(PERFETTO_OS_LINUX_BUT_NOT_QNX) || \
+    PERFETTO_BUILDFLAG(PERFETTO_OS_ANDROID)
+#define PAGED_MEMORY_COW_CLONES() 1
+#else
+#define PAGED_MEMORY_COW_CLONES() 0
+#endif
+
 namespace perfetto {
 namespace base {
 
@@ -54,6 +63,11 @@ class PagedMemory {
     // reserved and the user should call EnsureCommitted() before writing to
     // memory addresses.
     kDontCommit = 1 << 1,
+
+    // Backs the memory with a memfd so that Clone() shares the pages with the
+    // clone copy-on-write rather than copying them. Falls back on a plain
+    // anonymous mapping where memfd is not available.
+    kCopyOnWriteClones = 1 << 2,
   };
 
   // Allocates |size| bytes using mmap(MAP_ANONYMOUS). The returned memory is
@@ -61,6 +75,17 @@ class PagedMemory {
   // For |flags|, see the AllocationFlags enum above.
   static PagedMemory Allocate(size_t size, int flags = 0);
 
+  // Returns a new PagedMemory of the same size() whose first |copy_size| bytes
+  // are a copy of the ones of this. The rest of it is either zeroed or a copy
+  // as well. Returns an invalid PagedMemory if the allocation fails.
+  // If this was allocated with kCopyOnWriteClones, the two share their pages
+  // and a page is copied only when either side writes it. The cost of Clone()
+  // is then proportional to the pages written since the previous Clone(),
+  // rather than to |copy_size|. When the last clone is destroyed, the pages
+  // copied since are folded back so that this stops using extra memory: the
+  // clones must therefore be destroyed on the thread which writes this.
+  PagedMemory Clone(size_t copy_size) const;
+
   // Hint to the OS that the memory range is not needed and can be discarded.
   // The memory remains accessible and its contents may be retained, or they
   // may be zeroed. This function may be a NOP on some platforms. Returns true
@@ -83,6 +108,17 @@ class PagedMemory {
  private:
   PagedMemory(char* p, size_t size);
 
+#if PAGED_MEMORY_COW_CLONES()
+  struct CowState;
+
+  PagedMemory CloneCopyOnWrite(size_t copy_size) const;
+
+  // Writes the pages of the original memory copied since the first clone back
+  // into the memfd and maps it shared again. Called when there are no clones
+  // left.
+  static void FoldBackIntoMemfd(CowState*);
+#endif
+
   PagedMemory(const PagedMemory&) = delete;
   // Defaulted for implementation of move constructor + assignment.
   PagedMemory& operator=(const PagedMemory&) = default;
@@ -97,6 +133,15 @@ class PagedMemory {
 #if TRACK_COMMITTED_SIZE()
   size_t committed_size_ = 0u;
 #endif  // TRACK_COMMITTED_SIZE()
+
+#if PAGED_MEMORY_COW_CLONES()
+  // Set only for kCopyOnWriteClones. Shared by the original memory and its
+  // clones: holds the memfd backing them (see CowState).
+  std::shared_ptr<CowState> cow_;
+
+  // Whether this is a clone (rather than the original memory).
+  bool is_clone_ = false;
+#endif  // PAGED_MEMORY_COW_CLONES()
 };
 
 }  // namespace base
@@ -41,6 +41,13 @@ class ScopedMmap {
   // Creates a memory mapping for the first `length` bytes of `file`.
   static ScopedMmap FromHandle(base::ScopedPlatformHandle file, size_t length);
 
+  // Creates a memory mapping for `length` bytes of `file`, starting at
+  // `offset`. `offset` must be a multiple of the allocation granularity
+  // (the page size on POSIX, 64 KB on Windows).
+  static ScopedMmap FromHandle(base::ScopedPlatformHandle file,
+                               size_t offset,
+                               size_t length);
+
   ScopedMmap() {}
   ~ScopedMmap();
   ScopedMmap(ScopedMmap&& other) noexcept;
@@ -86,6 +93,12 @@ class ScopedMmap {
 // Tries to open `file_path` and maps its first `length` bytes in memory.
 ScopedMmap ReadMmapFilePart(const std::string& file_path, size_t length);
 
+// Tries to open `file_path` and maps `length` bytes starting at `offset` in
+// memory. See ScopedMmap::FromHandle for the alignment of `offset`.
+ScopedMmap ReadMmapFilePart(const std::string& file_path,
+                            size_t offset,
+                            size_t length);
+
 // Tries to open `file_path` and maps the whole file into memory.
 ScopedMmap ReadMmapWholeFile(const std::string& file_path);
 
@@ -18,6 +18,7 @@
 #define INCLUDE_PERFETTO_EXT_BASE_THREADING_THREAD_POOL_H_
 
 #include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <list>
 #include <mutex>
@@ -58,6 +59,11 @@ class ThreadPool {
   // This task should not block for IO as this can cause starvation.
   void PostTask(std::function<void()>);
 
+  // Returns the number of threads in this thread pool.
+  uint32_t thread_count() const {
+    return static_cast<uint32_t>(threads_.size());
+  }
+
  private:
   void RunThreadLoop();
 
@@ -33,6 +33,7 @@ class QueryResult;
 
 namespace trace_processor {
 
+class ArrowIpcWriter;
 class Iterator;
 class IteratorImpl;
 
@@ -50,10 +51,24 @@ class IteratorImpl;
 //   of a row).
 // The intended use case is streaaming these batches onto through a
 // chunked-encoded HTTP response, or through a repetition of Wasm calls.
+// Rows are encoded either as typed cells or, for clients which want to load
+// results into dataframes, as Arrow IPC streams (see ResultFormat).
+// If the query returns more than one batch of rows and simply scans a
+// dataframe table, the rows after the first batch are read directly from the
+// dataframe rather than through SQLite.
 class QueryResultSerializer {
  public:
   static constexpr uint32_t kDefaultBatchSplitThreshold = 128 * 1024;
-  explicit QueryResultSerializer(Iterator);
+
+  // How the rows of each batch are encoded. See QueryArgs.ResultFormat in
+  // trace_processor.proto.
+  enum class ResultFormat {
+    kCells,
+    kArrowIpc,
+  };
+
+  explicit QueryResultSerializer(Iterator,
+                                 ResultFormat = ResultFormat::kCells);
   ~QueryResultSerializer();
 
   // No copy or move.
@@ -74,16 +89,35 @@ class QueryResultSerializer {
     batch_split_threshold_ = thres;
   }
 
+  // Whether the rows are read straight from a dataframe (see SerializeRows).
+  bool is_reading_dataframe_for_testing() const {
+    return dataframe_scan_ != nullptr;
+  }
+
  private:
   void SerializeMetadata(protos::pbzero::QueryResult*);
   void SerializeBatch(protos::pbzero::QueryResult*);
+  void SerializeArrowBatch(protos::pbzero::QueryResult*);
   void MaybeSerializeError(protos::pbzero::QueryResult*);
 
+  // Appends rows to |cells| until the end of the results or until the batch
+  // is full. Returns true in the latter case.
+  template <typename Cells>
+  bool SerializeRows(Cells* cells);
+
+  struct DataframeScan;
+
   std::unique_ptr<IteratorImpl> iter_;
   const uint32_t num_cols_;
   bool did_write_metadata_ = false;
   bool eof_reached_ = false;
   uint32_t col_ = UINT32_MAX;
+  const ResultFormat result_format_;
+  std::unique_ptr<ArrowIpcWriter> arrow_writer_;
+
+  // Set once the rows are read from a dataframe rather than from |iter_|.
+  std::unique_ptr<DataframeScan> dataframe_scan_;
+  bool did_try_dataframe_scan_ = false;
 
   // These params specify the thresholds for splitting the results in batches,
   // in terms of: (1) max cells (row x cols); (2) serialized batch size in
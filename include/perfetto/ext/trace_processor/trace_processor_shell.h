@@ -62,6 +62,9 @@ class TraceProcessorShell {
       std::unique_ptr<PlatformInterface> platform_interface);
 
   std::unique_ptr<PlatformInterface> platform_interface_;
+
+  // Whether --read-ahead was passed to Run().
+  bool read_ahead_ = false;
 };
 
 // Abstract class for platform specific operations.
@@ -311,10 +311,29 @@ struct PERFETTO_EXPORT_COMPONENT TracingServiceInitOpts {
   // a vector of TracePackets and replaces the packets in the vector with
   // compressed ones.
   using CompressorFn = void (*)(std::vector<TracePacket>*);
+
+  // Used for TraceConfig.COMPRESSION_TYPE_DEFLATE.
   CompressorFn compressor_fn = nullptr;
 
+  // Used for TraceConfig.COMPRESSION_TYPE_ZSTD. If null, the service falls
+  // back on |compressor_fn|.
+  CompressorFn zstd_compressor_fn = nullptr;
+
   // Whether the relay endpoint is enabled on producer transport(s).
   bool enable_relay_endpoint = false;
+
+  // Number of worker threads used, in addition to the service thread, to run
+  // the TraceConfig.trace_filter over the packets read back from the buffers.
+  // Large reads are split in contiguous batches, one per thread, so the order
+  // of the packets is preserved. While the workers run, the service thread
+  // handles other tasks and the read is resumed once they are done. 0 keeps
+  // filtering on the service thread. The threads are created lazily, on the
+  // first read that needs them.
+  uint32_t filter_thread_count = 0;
+
+  // If true, write_into_file sessions write into their file from a dedicated
+  // thread (one per session), rather than from the service thread.
+  bool async_write_into_file = false;
 };
 
 // The API for the Relay port of the Service. Subclassed by the
@@ -215,6 +215,92 @@ struct PERFETTO_EXPORT_COMPONENT Config {
   // When provided, these descriptors allow trace processor to parse custom
   // protobuf messages that are not compiled into Perfetto
   std::vector<std::string> extra_parsing_descriptors;
+
+  // When set to true, the bytes passed to |TraceProcessorStorage::Parse| are
+  // ingested on a dedicated thread, connected to the calling thread by a
+  // bounded queue, so that the embedder can read ahead: it can read (or
+  // decompress, download...) the next chunk of the trace while the previous
+  // one is being ingested. This is not a multi-stage pipeline: tokenization,
+  // sorting and parsing all run on the ingestion thread, as they share state
+  // which is not thread-safe. The speedup is therefore bounded by the time
+  // the embedder spends producing the chunks.
+  //
+  // Chunks are handed to the ingestion thread without copying, unless their
+  // TraceBlob is shared with other TraceBlobViews held by the caller.
+  //
+  // In this mode, |Parse| returns as soon as the chunk has been queued and
+  // parsing errors are reported by the next call to |Parse| or
+  // |NotifyEndOfFile|. Queries must not be executed while chunks are still
+  // being ingested: callers should call |Flush| or |NotifyEndOfFile| first.
+  //
+  // The contents of the resulting tables are identical to the ones obtained
+  // with this option disabled.
+  //
+  // This option has no effect in builds without thread support (e.g. Wasm).
+  bool enable_read_ahead = false;
+
+  // When non-zero, bounds (approximately) the memory used by the sorter to
+  // buffer events waiting to be sorted. Once the buffered events exceed this
+  // many bytes, they are sorted and written to a temporary file (in $TMPDIR)
+  // and merged back when the trace is fully loaded. This allows loading traces
+  // which do not fit in memory, at the cost of extra I/O.
+  //
+  // Once the budget has been exceeded, events are only parsed at the end of
+  // the trace (i.e. incremental extraction is disabled).
+  //
+  // Zero means no limit. This option has no effect in Wasm builds.
+  uint64_t sorter_memory_budget_bytes = 0;
+
+  // When set to true, integer columns of the built-in tables are stored in a
+  // compressed form (bit packing, per-block frame of reference or dictionary
+  // encoding) once the trace is fully loaded. This significantly reduces the
+  // memory used by large traces at the cost of slower queries on the encoded
+  // columns.
+  //
+  // The number of bytes saved is reported in the
+  // `dataframe_encoding_bytes_saved` stat.
+  bool enable_dataframe_column_encoding = false;
+
+  // When set to true, simple GROUP BY queries over a single table and simple
+  // inner equi-joins between tables are rewritten to be computed by the
+  // tables' dataframes (with a hash join for joins) instead of by SQLite.
+  // Queries which cannot be rewritten are executed unchanged.
+  bool enable_dataframe_query_rewrites = false;
+
+  // The number of threads used to execute filters on large tables. Filters
+  // over many rows are split into chunks which are filtered in parallel: the
+  // results are identical to filtering on a single thread.
+  //
+  // 0 and 1 mean that queries run entirely on the calling thread. This option
+  // has no effect in builds without thread support (e.g. Wasm).
+  uint32_t query_parallelism = 0;
+
+  // The number of threads used to decompress the entries of zip archives and
+  // the members of multi-member gzip files concurrently. These threads are
+  // shared by all the archives and gzip files in the trace, and are only
+  // created once there is something to decompress. Gzip files are only
+  // inflated in parallel once their second member has been found.
+  //
+  // 0 and 1 mean that decompression runs entirely on the ingestion thread.
+  // This option has no effect in builds without thread support (e.g. Wasm).
+  uint32_t decompression_parallelism = 0;
+
+  // When set to true, trace processor builds an index of the three character
+  // substrings of all interned strings the first time a GLOB filter is
+  // executed on a string column. This is used to only match the pattern
+  // against strings which contain its literal parts: this makes substring
+  // searches (e.g. `name GLOB '*binder*'`) much faster on big traces at the
+  // cost of extra memory for the index.
+  bool enable_string_pool_trigram_index = false;
+
+  // When set to true, the views of the standard library prelude which don't
+  // depend on the trace being fully loaded (e.g. `slice`, `thread`, `sched`,
+  // `counter`) are available before |NotifyEndOfFile| is called. This is used
+  // to query a trace while it is still being ingested (e.g.
+  // `trace_processor_shell --follow`). The rest of the prelude (tables which
+  // are computed once and indexes) is still only available after
+  // |NotifyEndOfFile|.
+  bool enable_prelude_views_before_eof = false;
 };
 
 // Represents a dynamically typed value returned by SQL.
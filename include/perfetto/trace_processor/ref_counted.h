@@ -149,6 +149,9 @@ class RefPtr {
 
   T* get() const { return ptr_; }
   T* operator->() const { return ptr_; }
+
+  // Returns true if this is the only RefPtr pointing to the object.
+  bool unique() const { return ptr_ && ptr_->refcount_ == 1; }
   T& operator*() const { return *ptr_; }
   explicit operator bool() const { return ptr_ != nullptr; }
 
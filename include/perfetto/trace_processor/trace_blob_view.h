@@ -102,6 +102,9 @@ class alignas(8) TraceBlobView {
   size_t size() const { return length_; }
   RefPtr<TraceBlob> blob() const { return blob_; }
 
+  // Returns true if no other TraceBlobView points to the same TraceBlob.
+  bool has_unique_blob() const { return blob_.unique(); }
+
  private:
   TraceBlobView(const uint8_t* data, size_t length, RefPtr<TraceBlob> blob)
       : data_(data), length_(length), blob_(std::move(blob)) {}
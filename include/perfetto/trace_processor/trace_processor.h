@@ -184,6 +184,23 @@ class PERFETTO_EXPORT_COMPONENT TraceProcessor : public TraceProcessorStorage {
   // NOTE: No Iterators can active when called.
   virtual size_t RestoreInitialTables() = 0;
 
+  // Writes a snapshot of the loaded trace to |path|. A snapshot contains all
+  // the tables populated while parsing the trace and can be loaded with
+  // LoadSnapshot() in a fraction of the time it takes to parse the trace
+  // again. Tables, views and functions created by SQL queries are not
+  // included.
+  // Must be called after NotifyEndOfFile().
+  virtual base::Status SaveSnapshot(const std::string& path) = 0;
+
+  // Loads a snapshot written by SaveSnapshot(), in place of parsing a trace
+  // (i.e. instead of calling Parse() and NotifyEndOfFile()). The snapshot file
+  // is mapped in memory and queried in place so it must not be modified while
+  // this instance is alive.
+  // Snapshots can only be loaded by the same build of trace processor which
+  // wrote them. If this function returns an error, this instance should be
+  // discarded.
+  virtual base::Status LoadSnapshot(const std::string& path) = 0;
+
   // =================================================================
   // |  Trace-based metrics (v1) related functionality starts here   |
   // =================================================================
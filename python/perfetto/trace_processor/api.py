@@ -119,6 +119,38 @@ class TraceProcessorConfig:
     self.add_sql_packages = add_sql_packages
 
 
+def _concat_arrow_streams(streams: List[bytes], column_names: List[str]):
+  """Reads the Arrow IPC streams of the batches of a query into one table.
+
+  Each batch is a self-contained stream. As SQLite columns are dynamically
+  typed, the trace processor only ever makes the type of a column wider from
+  one batch to the next (null, int64, float64, utf8, binary; see
+  ArrowIpcWriter), so the last stream has the schema of the whole query and
+  the earlier ones are cast to it.
+  """
+  import pyarrow as pa
+
+  tables = [pa.ipc.open_stream(s).read_all() for s in streams]
+  if not tables:
+    return pa.table({name: pa.array([]) for name in column_names})
+
+  def cast(column, to_type):
+    if column.type == to_type:
+      return column
+    # Numbers are converted to their text form before becoming bytes.
+    if pa.types.is_binary(to_type) and (pa.types.is_integer(column.type) or
+                                        pa.types.is_floating(column.type)):
+      column = column.cast(pa.string())
+    return column.cast(to_type, safe=False)
+
+  schema = tables[-1].schema
+  casted = []
+  for table in tables:
+    columns = [cast(table.column(i), f.type) for i, f in enumerate(schema)]
+    casted.append(pa.table(columns, schema=schema))
+  return pa.concat_tables(casted)
+
+
 class TraceProcessor:
   QueryResultIterator = QueryResultIterator
   Row = QueryResultIterator.Row
@@ -199,6 +231,33 @@ class TraceProcessor:
     return TraceProcessor.QueryResultIterator(response.column_names,
                                               response.batch)
 
+  def query_arrow(self, sql: str):
+    """Executes passed in SQL query and returns the result as a pyarrow
+    Table. The trace processor encodes the results directly as Arrow IPC
+    streams which avoids converting each cell individually in Python. Raises
+    TraceProcessorException if the response returns with an error.
+
+    Args:
+      sql: SQL query written as a String
+
+    Returns:
+      A pyarrow.Table containing the results of the query.
+    """
+    try:
+      import pyarrow
+    except ImportError:
+      raise TraceProcessorException(
+          'pyarrow dependency missing. Please run `pip3 install pyarrow`')
+
+    response = self.http.execute_query(
+        sql, result_format=self.protos.QueryArgs.ARROW_IPC)
+    if response.error:
+      raise TraceProcessorException(response.error)
+
+    return _concat_arrow_streams(
+        [b.arrow_ipc_stream for b in response.batch if b.arrow_ipc_stream],
+        response.column_names)
+
   def trace_summary(self,
                     specs: List[Union[str, bytes]],
                     metric_ids: Optional[List[str]] = None,
@@ -25,9 +25,11 @@ class TraceProcessorHttp:
     self.protos = protos
     self.conn = http.client.HTTPConnection(url)
 
-  def execute_query(self, query: str):
+  def execute_query(self, query: str, result_format: Optional[int] = None):
     args = self.protos.QueryArgs()
     args.sql_query = query
+    if result_format is not None:
+      args.result_format = result_format
     byte_data = args.SerializeToString()
     self.conn.request('POST', '/query', body=byte_data)
     with self.conn.getresponse() as f:
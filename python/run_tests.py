@@ -20,6 +20,7 @@ import unittest
 
 from test import api_integrationtest
 from test import bigtrace_api_integrationtest
+from test import query_arrow_unittest
 from test import query_result_iterator_unittest
 from test import resolver_unittest
 from test import stdlib_unittest
@@ -51,6 +52,7 @@ def main():
 
   # Add all relevant tests to test suite
   suite.addTests(loader.loadTestsFromModule(query_result_iterator_unittest))
+  suite.addTests(loader.loadTestsFromModule(query_arrow_unittest))
   suite.addTests(loader.loadTestsFromModule(resolver_unittest))
   suite.addTests(loader.loadTestsFromModule(api_integrationtest))
   suite.addTests(loader.loadTestsFromModule(stdlib_unittest))
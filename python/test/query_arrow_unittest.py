@@ -0,0 +1,72 @@
+# Copyright (C) 2026 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+import unittest
+
+from perfetto.trace_processor.api import _concat_arrow_streams
+
+try:
+  import pyarrow as pa
+except ImportError:
+  pa = None
+
+
+def _to_stream(table):
+  sink = pa.BufferOutputStream()
+  with pa.ipc.new_stream(sink, table.schema) as writer:
+    writer.write_table(table)
+  return sink.getvalue().to_pybytes()
+
+
+@unittest.skipIf(pa is None, 'pyarrow is not installed')
+class TestQueryArrow(unittest.TestCase):
+
+  def test_no_batches(self):
+    table = _concat_arrow_streams([], ['a', 'b'])
+    self.assertEqual(table.column_names, ['a', 'b'])
+    self.assertEqual(table.num_rows, 0)
+
+  def test_types_widen_across_batches(self):
+    # Mirrors what the trace processor emits when a column holds longs in the
+    # first batch and strings from the second one onwards: the type of a
+    # column never narrows again, so the last batch has the final schema.
+    streams = [
+        _to_stream(
+            pa.table({
+                'a': pa.array([1, 2], pa.int64()),
+                'b': pa.array([None, None], pa.null()),
+            })),
+        _to_stream(
+            pa.table({
+                'a': pa.array(['x', '3'], pa.utf8()),
+                'b': pa.array([0.5, 1.0], pa.float64()),
+            })),
+        _to_stream(
+            pa.table({
+                'a': pa.array(['4'], pa.utf8()),
+                'b': pa.array([1.5], pa.float64()),
+            })),
+    ]
+    table = _concat_arrow_streams(streams, ['a', 'b'])
+    self.assertEqual(table.schema.field('a').type, pa.utf8())
+    self.assertEqual(table.schema.field('b').type, pa.float64())
+    self.assertEqual(table.column('a').to_pylist(), ['1', '2', 'x', '3', '4'])
+    self.assertEqual(table.column('b').to_pylist(), [None, None, 0.5, 1.0, 1.5])
+
+  def test_numbers_become_bytes(self):
+    streams = [
+        _to_stream(pa.table({'a': pa.array([7], pa.int64())})),
+        _to_stream(pa.table({'a': pa.array([b'\x00\x01'], pa.binary())})),
+    ]
+    table = _concat_arrow_streams(streams, ['a'])
+    self.assertEqual(table.column('a').to_pylist(), [b'7', b'\x00\x01'])
@@ -19,6 +19,9 @@
 #include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
 
 #if PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
 #include <windows.h>
@@ -26,8 +29,17 @@
 #include <sys/mman.h>
 #endif  // PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
 
+#if PAGED_MEMORY_COW_CLONES()
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#endif  // PAGED_MEMORY_COW_CLONES()
+
 #include "perfetto/base/logging.h"
 #include "perfetto/ext/base/container_annotations.h"
+#include "perfetto/ext/base/file_utils.h"
 #include "perfetto/ext/base/utils.h"
 
 namespace perfetto {
@@ -48,8 +60,119 @@ size_t GuardSize() {
   return GetSysPageSize();
 }
 
+#if PAGED_MEMORY_COW_CLONES()
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+// Returns a memfd of |size| bytes, or an invalid ScopedFile if memfd is not
+// supported.
+ScopedFile CreateMemfd(size_t size) {
+#if defined(__NR_memfd_create)
+  // Some kernels older than 3.17 segfault executing memfd_create() rather
+  // than returning ENOSYS. See also src/tracing/ipc/memfd.cc.
+  static const bool kSupportsMemfd = [] {
+    struct utsname uts;
+    int major, minor;
+    return !(uname(&uts) == 0 && strcmp(uts.sysname, "Linux") == 0 &&
+             sscanf(uts.release, "%d.%d", &major, &minor) == 2 &&
+             (major < 3 || (major == 3 && minor < 17)));
+  }();
+  if (!kSupportsMemfd)
+    return ScopedFile();
+  ScopedFile fd(static_cast<int>(
+      syscall(__NR_memfd_create, "perfetto_paged_memory", MFD_CLOEXEC)));
+  if (!fd || ftruncate(*fd, static_cast<off_t>(size)) != 0)
+    return ScopedFile();
+  return fd;
+#else
+  base::ignore_result(size);
+  return ScopedFile();
+#endif
+}
+
+// Maps |size| bytes of |fd| at |addr|, replacing the existing mapping.
+bool MapMemfdAt(void* addr, size_t size, int fd, bool shared) {
+  int flags = (shared ? MAP_SHARED : MAP_PRIVATE) | MAP_FIXED;
+  return mmap(addr, size, PROT_READ | PROT_WRITE, flags, fd, 0) == addr;
+}
+
+// Invokes |fn(offset, size)| for each run of pages of [p, p + size) that are
+// no longer backed by the file they are a MAP_PRIVATE mapping of, i.e. the
+// pages that have been written (and so copied) since they were mapped.
+// Returns false if /proc/self/pagemap cannot be read.
+template <typename Fn>
+bool ForEachCopiedPageRun(const char* p, size_t size, Fn fn) {
+  // See Documentation/admin-guide/mm/pagemap.rst.
+  constexpr uint64_t kPresent = 1ull << 63;
+  constexpr uint64_t kSwapped = 1ull << 62;
+  constexpr uint64_t kFileOrSharedAnon = 1ull << 61;
+  constexpr size_t kEntriesPerRead = 4096;
+
+  ScopedFile pagemap = OpenFile("/proc/self/pagemap", O_RDONLY);
+  if (!pagemap)
+    return false;
+  const size_t page_size = GetSysPageSize();
+  const size_t num_pages = size / page_size;
+  const uintptr_t first_page = reinterpret_cast<uintptr_t>(p) / page_size;
+  std::unique_ptr<uint64_t[]> entries(new uint64_t[kEntriesPerRead]);
+  size_t run_start = 0;
+  size_t run_len = 0;
+  for (size_t page = 0; page < num_pages; page += kEntriesPerRead) {
+    const size_t count = std::min(kEntriesPerRead, num_pages - page);
+    const size_t bytes = count * sizeof(uint64_t);
+    const auto off = static_cast<off_t>((first_page + page) * sizeof(uint64_t));
+    if (PERFETTO_EINTR(pread(*pagemap, entries.get(), bytes, off)) !=
+        static_cast<ssize_t>(bytes)) {
+      return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      const uint64_t entry = entries[i];
+      const bool anon = (entry & kPresent) && !(entry & kFileOrSharedAnon);
+      const bool copied = anon || (entry & kSwapped);
+      if (!copied)
+        continue;
+      if (run_len > 0 && run_start + run_len == page + i) {
+        ++run_len;
+        continue;
+      }
+      if (run_len > 0)
+        fn(run_start * page_size, run_len * page_size);
+      run_start = page + i;
+      run_len = 1;
+    }
+  }
+  if (run_len > 0)
+    fn(run_start * page_size, run_len * page_size);
+  return true;
+}
+
+#endif  // PAGED_MEMORY_COW_CLONES()
+
 }  // namespace
 
+#if PAGED_MEMORY_COW_CLONES()
+struct PagedMemory::CowState {
+  ScopedFile memfd;
+
+  // The size of |memfd| and of the mappings of it.
+  size_t size = 0;
+
+  // The mapping of the original memory, or nullptr once it's gone.
+  char* source = nullptr;
+
+  // True while there are no clones: |source| is then a MAP_SHARED mapping of
+  // |memfd| and writes go straight into it. While there are clones, |memfd|
+  // is never written through a mapping (so the clones keep seeing its
+  // contents as of when they were taken) and |source| is a MAP_PRIVATE
+  // mapping, whose written pages are copied-on-write.
+  bool source_mapped_shared = true;
+
+  size_t num_clones = 0;
+};
+#endif  // PAGED_MEMORY_COW_CLONES()
+
 // static
 PagedMemory PagedMemory::Allocate(size_t req_size, int flags) {
   size_t rounded_up_size = RoundUpToSysPageSize(req_size);
@@ -74,6 +197,24 @@ PagedMemory PagedMemory::Allocate(size_t req_size, int flags) {
 #endif  // PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
 
   auto memory = PagedMemory(usable_region, req_size);
+#if PAGED_MEMORY_COW_CLONES()
+  if (flags & kCopyOnWriteClones) {
+    ScopedFile memfd = CreateMemfd(rounded_up_size);
+    if (memfd) {
+      // If this fails the region might have been unmapped: it can't be used
+      // as a plain anonymous mapping either.
+      bool mapped = MapMemfdAt(usable_region, rounded_up_size, *memfd,
+                               /*shared=*/true);
+      if (!mapped && (flags & kMayFail))
+        return PagedMemory();
+      PERFETTO_CHECK(mapped);
+      memory.cow_ = std::make_shared<CowState>();
+      memory.cow_->memfd = std::move(memfd);
+      memory.cow_->size = rounded_up_size;
+      memory.cow_->source = usable_region;
+    }
+  }
+#endif  // PAGED_MEMORY_COW_CLONES()
 #if TRACK_COMMITTED_SIZE()
   size_t initial_commit = req_size;
   if (flags & kDontCommit)
@@ -93,6 +234,9 @@ PagedMemory::PagedMemory(char* p, size_t size) : p_(p), size_(size) {
 PagedMemory::PagedMemory(PagedMemory&& other) noexcept {
   *this = other;
   other.p_ = nullptr;
+#if PAGED_MEMORY_COW_CLONES()
+  other.cow_.reset();
+#endif
 }
 // clang-format on
 
@@ -106,6 +250,13 @@ PagedMemory::~PagedMemory() {
   if (!p_)
     return;
   PERFETTO_CHECK(size_);
+#if PAGED_MEMORY_COW_CLONES()
+  if (cow_ && !is_clone_) {
+    cow_->source = nullptr;
+  } else if (cow_ && --cow_->num_clones == 0 && cow_->source) {
+    FoldBackIntoMemfd(cow_.get());
+  }
+#endif
   char* start = p_ - GuardSize();
 #if PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
   BOOL res = VirtualFree(start, 0, MEM_RELEASE);
@@ -118,10 +269,104 @@ PagedMemory::~PagedMemory() {
   ANNOTATE_DELETE_BUFFER(p_, size_, committed_size_)
 }
 
+PagedMemory PagedMemory::Clone(size_t copy_size) const {
+  PERFETTO_DCHECK(p_);
+  PERFETTO_DCHECK(copy_size <= size_);
+#if PAGED_MEMORY_COW_CLONES()
+  if (cow_) {
+    PagedMemory clone = CloneCopyOnWrite(copy_size);
+    if (clone.IsValid())
+      return clone;
+  }
+#endif
+  PagedMemory clone = Allocate(size_, kMayFail | kDontCommit);
+  if (!clone.IsValid())
+    return clone;
+  clone.EnsureCommitted(copy_size);
+  memcpy(clone.p_, p_, copy_size);
+  return clone;
+}
+
+#if PAGED_MEMORY_COW_CLONES()
+PagedMemory PagedMemory::CloneCopyOnWrite(size_t copy_size) const {
+  const size_t rounded_up_size = RoundUpToSysPageSize(size_);
+  CowState& cow = *cow_;
+  const int fd = *cow.memfd;
+  if (!is_clone_) {
+    // Folding back failed when the last clone was destroyed: try again, so
+    // the pages don't have to be copied into this and the next clones. If
+    // it fails again, keep going: the pages will be copied below.
+    if (!cow.source_mapped_shared && cow.num_clones == 0)
+      FoldBackIntoMemfd(&cow);
+    if (cow.source_mapped_shared) {
+      // From now on our writes must not reach the memfd, which becomes the
+      // frozen snapshot shared with the clones. The contents don't change.
+      PERFETTO_CHECK(MapMemfdAt(p_, rounded_up_size, fd, /*shared=*/false));
+      cow.source_mapped_shared = false;
+    }
+  }
+
+  size_t outer_size = rounded_up_size + GuardSize() * 2;
+  void* ptr = mmap(nullptr, outer_size, PROT_NONE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED)
+    return PagedMemory();
+  char* usable_region = reinterpret_cast<char*>(ptr) + GuardSize();
+  if (!MapMemfdAt(usable_region, rounded_up_size, fd, /*shared=*/false)) {
+    munmap(ptr, outer_size);
+    return PagedMemory();
+  }
+  PagedMemory clone(usable_region, size_);
+  clone.cow_ = cow_;
+  clone.is_clone_ = true;
+  ++cow.num_clones;
+  clone.EnsureCommitted(copy_size);
+
+  // The memfd doesn't have the pages we have written since it was frozen.
+  bool read_ok = ForEachCopiedPageRun(
+      p_, RoundUpToSysPageSize(copy_size), [&](size_t off, size_t len) {
+        memcpy(clone.p_ + off, p_ + off, std::min(len, copy_size - off));
+      });
+  if (!read_ok)
+    return PagedMemory();  // Clone() falls back on a full copy.
+  return clone;
+}
+
+// static
+void PagedMemory::FoldBackIntoMemfd(CowState* cow) {
+  PERFETTO_DCHECK(cow->source && cow->num_clones == 0);
+  if (cow->source_mapped_shared)
+    return;
+  const int fd = *cow->memfd;
+  char* source = cow->source;
+  bool write_ok = true;
+  bool read_ok = ForEachCopiedPageRun(source, cow->size,
+                                      [&](size_t off, size_t len) {
+    if (write_ok) {
+      write_ok = PERFETTO_EINTR(pwrite(fd, source + off, len,
+                                       static_cast<off_t>(off))) ==
+                 static_cast<ssize_t>(len);
+    }
+  });
+  // Remapping drops the copied pages, which are now in the memfd. If folding
+  // failed, the source stays MAP_PRIVATE and keeps its copied pages.
+  if (read_ok && write_ok) {
+    PERFETTO_CHECK(MapMemfdAt(source, cow->size, fd, /*shared=*/true));
+    cow->source_mapped_shared = true;
+  }
+}
+#endif  // PAGED_MEMORY_COW_CLONES()
+
 bool PagedMemory::AdviseDontNeed(void* p, size_t size) {
   PERFETTO_DCHECK(p_);
   PERFETTO_DCHECK(p >= p_);
   PERFETTO_DCHECK(static_cast<char*>(p) + size <= p_ + size_);
+#if PAGED_MEMORY_COW_CLONES()
+  // Dropping the copied pages of a MAP_PRIVATE mapping would bring back the
+  // stale contents of the memfd, rather than zeroes.
+  if (cow_)
+    return false;
+#endif
 #if PERFETTO_BUILDFLAG(PERFETTO_OS_WIN) || PERFETTO_BUILDFLAG(PERFETTO_OS_NACL)
   // Discarding pages on Windows has more CPU cost than is justified for the
   // possible memory savings.
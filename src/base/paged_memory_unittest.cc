@@ -17,6 +17,9 @@
 #include "perfetto/ext/base/paged_memory.h"
 
 #include <stdint.h>
+#include <string.h>
+
+#include <string>
 
 #include "perfetto/base/build_config.h"
 #include "perfetto/ext/base/utils.h"
@@ -29,6 +32,14 @@
 #include <sys/resource.h>
 #endif
 
+#if PAGED_MEMORY_COW_CLONES()
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/scoped_file.h"
+#endif
+
 namespace perfetto {
 namespace base {
 namespace {
@@ -184,6 +195,139 @@ TEST(PagedMemoryTest, GuardRegions) {
 }
 #endif
 
+void FillPages(PagedMemory* mem, size_t first_page, size_t num_pages, char c) {
+  const size_t page_size = GetSysPageSize();
+  memset(static_cast<char*>(mem->Get()) + first_page * page_size, c,
+         num_pages * page_size);
+}
+
+// Returns the first byte of each page of |mem|, with '.' for zeroes.
+std::string PageFirstBytes(const PagedMemory& mem) {
+  const size_t page_size = GetSysPageSize();
+  std::string res;
+  for (size_t off = 0; off < mem.size(); off += page_size) {
+    char c = static_cast<const char*>(mem.Get())[off];
+    res += c ? c : '.';
+  }
+  return res;
+}
+
+void CheckClones(int flags) {
+  const size_t kNumPages = 8;
+  const size_t kSize = kNumPages * GetSysPageSize();
+  PagedMemory mem = PagedMemory::Allocate(kSize, flags);
+  ASSERT_TRUE(mem.IsValid());
+  FillPages(&mem, 0, 4, 'a');
+
+  // Only the first |copy_size| bytes are guaranteed to be copied.
+  PagedMemory clone1 = mem.Clone(4 * GetSysPageSize());
+  ASSERT_TRUE(clone1.IsValid());
+  ASSERT_EQ(clone1.size(), kSize);
+  clone1.EnsureCommitted(kSize);
+  EXPECT_EQ(PageFirstBytes(clone1), "aaaa....");
+
+  // Writes to either side are not visible to the other.
+  FillPages(&mem, 2, 4, 'b');
+  FillPages(&clone1, 0, 1, 'c');
+  EXPECT_EQ(PageFirstBytes(mem), "aabbbb..");
+  EXPECT_EQ(PageFirstBytes(clone1), "caaa....");
+
+  // Clone while |clone1| is still alive.
+  PagedMemory clone2 = mem.Clone(kSize);
+  ASSERT_TRUE(clone2.IsValid());
+  FillPages(&mem, 6, 2, 'd');
+  EXPECT_EQ(PageFirstBytes(clone1), "caaa....");
+  EXPECT_EQ(PageFirstBytes(clone2), "aabbbb..");
+  EXPECT_EQ(PageFirstBytes(mem), "aabbbbdd");
+
+  // Clone after the other clones are gone.
+  clone1 = PagedMemory();
+  clone2 = PagedMemory();
+  PagedMemory clone3 = mem.Clone(kSize);
+  ASSERT_TRUE(clone3.IsValid());
+  FillPages(&mem, 0, 1, 'e');
+  EXPECT_EQ(PageFirstBytes(clone3), "aabbbbdd");
+  EXPECT_EQ(PageFirstBytes(mem), "eabbbbdd");
+
+  // Clones can be cloned as well.
+  PagedMemory clone4 = clone3.Clone(kSize);
+  ASSERT_TRUE(clone4.IsValid());
+  FillPages(&clone3, 7, 1, 'f');
+  EXPECT_EQ(PageFirstBytes(clone4), "aabbbbdd");
+  EXPECT_EQ(PageFirstBytes(clone3), "aabbbbdf");
+  EXPECT_EQ(PageFirstBytes(mem), "eabbbbdd");
+
+  // Moving doesn't affect the contents.
+  PagedMemory moved(std::move(mem));
+  PagedMemory clone5 = moved.Clone(kSize);
+  ASSERT_TRUE(clone5.IsValid());
+  EXPECT_EQ(PageFirstBytes(clone5), "eabbbbdd");
+}
+
+TEST(PagedMemoryTest, Clone) {
+  CheckClones(/*flags=*/0);
+}
+
+TEST(PagedMemoryTest, CopyOnWriteClone) {
+  CheckClones(PagedMemory::kCopyOnWriteClones);
+}
+
+#if PAGED_MEMORY_COW_CLONES()
+// Returns the number of pages of |mem| that are private copies, rather than
+// pages of the memfd, or -1 if /proc/self/pagemap cannot be read.
+int CountCopiedPages(const PagedMemory& mem) {
+  constexpr uint64_t kPresent = 1ull << 63;
+  constexpr uint64_t kFileOrSharedAnon = 1ull << 61;
+  ScopedFile pagemap = OpenFile("/proc/self/pagemap", O_RDONLY);
+  if (!pagemap)
+    return -1;
+  const size_t page_size = GetSysPageSize();
+  const uintptr_t first_page = reinterpret_cast<uintptr_t>(mem.Get()) /
+                               page_size;
+  int copied = 0;
+  for (size_t i = 0; i < mem.size() / page_size; ++i) {
+    uint64_t entry = 0;
+    const auto off = static_cast<off_t>((first_page + i) * sizeof(entry));
+    if (pread(*pagemap, &entry, sizeof(entry), off) != sizeof(entry))
+      return -1;
+    if ((entry & kPresent) && !(entry & kFileOrSharedAnon))
+      ++copied;
+  }
+  return copied;
+}
+
+TEST(PagedMemoryTest, CopyOnWriteCloneReleasesCopiedPages) {
+  const size_t kNumPages = 8;
+  PagedMemory mem = PagedMemory::Allocate(kNumPages * GetSysPageSize(),
+                                          PagedMemory::kCopyOnWriteClones);
+  ASSERT_TRUE(mem.IsValid());
+  FillPages(&mem, 0, 2, 'a');
+  if (CountCopiedPages(mem) != 0)
+    GTEST_SKIP() << "/proc/self/pagemap not available";
+
+  // While the clone is alive, the pages written by the original are copies.
+  PagedMemory clone = mem.Clone(mem.size());
+  ASSERT_TRUE(clone.IsValid());
+  FillPages(&mem, 2, 4, 'b');
+  EXPECT_EQ(CountCopiedPages(mem), 4);
+
+  // Destroying the last clone folds them back into the memfd.
+  clone = PagedMemory();
+  EXPECT_EQ(CountCopiedPages(mem), 0);
+  EXPECT_EQ(PageFirstBytes(mem), "aabbbb..");
+
+  // Writes go straight into the memfd again, until the next clone.
+  FillPages(&mem, 6, 1, 'c');
+  EXPECT_EQ(CountCopiedPages(mem), 0);
+  clone = mem.Clone(mem.size());
+  ASSERT_TRUE(clone.IsValid());
+  EXPECT_EQ(PageFirstBytes(clone), "aabbbbc.");
+  FillPages(&mem, 7, 1, 'd');
+  EXPECT_EQ(CountCopiedPages(mem), 1);
+  EXPECT_EQ(PageFirstBytes(clone), "aabbbbc.");
+}
+#endif  // PAGED_MEMORY_COW_CLONES()
+
 // Disable this on:
 // MacOS: because it doesn't seem to have an equivalent rlimit to bound mmap().
 // Fuchsia: doesn't support rlimit.
@@ -16,6 +16,7 @@
 
 #include "perfetto/ext/base/scoped_mmap.h"
 
+#include <cstdint>
 #include <utility>
 
 #include "perfetto/ext/base/file_utils.h"
@@ -79,6 +80,13 @@ ScopedMmap::~ScopedMmap() {
 // static
 ScopedMmap ScopedMmap::FromHandle(base::ScopedPlatformHandle file,
                                   size_t length) {
+  return FromHandle(std::move(file), 0, length);
+}
+
+// static
+ScopedMmap ScopedMmap::FromHandle(base::ScopedPlatformHandle file,
+                                  size_t offset,
+                                  size_t length) {
   ScopedMmap ret;
   if (!file) {
     return ret;
@@ -87,7 +95,8 @@ ScopedMmap ScopedMmap::FromHandle(base::ScopedPlatformHandle file,
     PERFETTO_BUILDFLAG(PERFETTO_OS_ANDROID) || \
     PERFETTO_BUILDFLAG(PERFETTO_OS_FREEBSD) || \
     PERFETTO_BUILDFLAG(PERFETTO_OS_APPLE)
-  void* ptr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, *file, 0);
+  void* ptr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, *file,
+                   static_cast<off_t>(offset));
   if (ptr != MAP_FAILED) {
     ret.ptr_ = ptr;
     ret.length_ = length;
@@ -99,7 +108,10 @@ ScopedMmap ScopedMmap::FromHandle(base::ScopedPlatformHandle file,
   if (!map) {
     return ret;
   }
-  void* ptr = MapViewOfFile(*map, FILE_MAP_READ, 0, 0, length);
+  const uint64_t offset64 = offset;
+  void* ptr = MapViewOfFile(*map, FILE_MAP_READ,
+                            static_cast<DWORD>(offset64 >> 32),
+                            static_cast<DWORD>(offset64), length);
   if (ptr != nullptr) {
     ret.ptr_ = ptr;
     ret.length_ = length;
@@ -107,7 +119,7 @@ ScopedMmap ScopedMmap::FromHandle(base::ScopedPlatformHandle file,
     ret.map_ = std::move(map);
   }
 #else
-  base::ignore_result(length);
+  base::ignore_result(offset, length);
 #endif
   return ret;
 }
@@ -150,6 +162,12 @@ ScopedMmap ReadMmapFilePart(const std::string& fname, size_t length) {
   return ScopedMmap::FromHandle(OpenFileForMmap(fname), length);
 }
 
+ScopedMmap ReadMmapFilePart(const std::string& fname,
+                            size_t offset,
+                            size_t length) {
+  return ScopedMmap::FromHandle(OpenFileForMmap(fname), offset, length);
+}
+
 ScopedMmap ReadMmapWholeFile(const std::string& fname) {
   ScopedPlatformHandle file = OpenFileForMmap(fname);
   if (!file) {
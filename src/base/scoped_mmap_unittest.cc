@@ -16,6 +16,8 @@
 
 #include "perfetto/ext/base/scoped_mmap.h"
 
+#include <string>
+
 #if PERFETTO_BUILDFLAG(PERFETTO_OS_LINUX) ||   \
     PERFETTO_BUILDFLAG(PERFETTO_OS_ANDROID) || \
     PERFETTO_BUILDFLAG(PERFETTO_OS_APPLE)
@@ -24,6 +26,7 @@
 #endif
 
 #include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/utils.h"
 #include "src/base/test/tmp_dir_tree.h"
 #include "test/gtest_and_gmock.h"
 
@@ -91,6 +94,23 @@ TEST_F(ScopedMmapTest, Reset) {
   EXPECT_FALSE(mapped.IsValid());
 }
 
+TEST_F(ScopedMmapTest, PartAtOffset) {
+#if PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
+  const size_t kOffset = 64 * 1024;
+#else
+  const size_t kOffset = GetSysPageSize();
+#endif
+  base::TmpDirTree tmp;
+  tmp.AddFile("f1.txt", std::string(kOffset, 'a') + "bbbbb");
+
+  ScopedMmap mapped =
+      ReadMmapFilePart(tmp.AbsolutePath("f1.txt"), kOffset, /*length=*/3);
+
+  ASSERT_TRUE(mapped.IsValid());
+  ASSERT_EQ(mapped.length(), 3u);
+  EXPECT_EQ(std::string(static_cast<char*>(mapped.data()), 3), "bbb");
+}
+
 #if PERFETTO_BUILDFLAG(PERFETTO_OS_LINUX) ||   \
     PERFETTO_BUILDFLAG(PERFETTO_OS_ANDROID) || \
     PERFETTO_BUILDFLAG(PERFETTO_OS_APPLE)
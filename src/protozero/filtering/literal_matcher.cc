@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/protozero/filtering/literal_matcher.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace protozero {
+namespace {
+
+// Finds the literals which occur in every match of an ECMAScript regex by
+// walking the pattern: runs of literal characters which are not optional and
+// not part of an alternation must be present in any matching string.
+class RequiredLiteralFinder {
+ public:
+  explicit RequiredLiteralFinder(std::string_view pattern) : p_(pattern) {}
+
+  std::string Find() {
+    std::vector<std::string> literals;
+    if (!ParseAlternation(&literals) || pos_ != p_.size())
+      return {};
+    std::string longest;
+    for (std::string& literal : literals) {
+      if (literal.size() > longest.size())
+        longest = std::move(literal);
+    }
+    return longest;
+  }
+
+ private:
+  // Parses the pattern up to the next unbalanced ')' (or its end) and appends
+  // the literals required to match it to |literals|. Returns false if the
+  // pattern uses syntax which is not understood.
+  bool ParseAlternation(std::vector<std::string>* literals) {
+    std::vector<std::string> local;
+    std::string run;
+    bool has_alternation = false;
+    while (pos_ < p_.size() && p_[pos_] != ')') {
+      char c = p_[pos_++];
+      bool is_literal = false;
+      char literal = 0;
+      bool is_group = false;
+      std::vector<std::string> group_literals;
+      switch (c) {
+        case '|':
+          has_alternation = true;
+          Flush(&run, &local);
+          continue;
+        case '^':
+        case '$':
+          Flush(&run, &local);
+          continue;
+        case '.':
+          break;
+        case '[':
+          if (!SkipClass())
+            return false;
+          break;
+        case '(': {
+          bool is_lookahead = false;
+          if (Consume("?=") || Consume("?!")) {
+            is_lookahead = true;
+          } else if (!Consume("?:") && pos_ < p_.size() && p_[pos_] == '?') {
+            return false;
+          }
+          if (!ParseAlternation(&group_literals) || pos_ >= p_.size())
+            return false;
+          ++pos_;  // Skip the ')'.
+          if (is_lookahead)
+            group_literals.clear();
+          is_group = true;
+          break;
+        }
+        case '\\': {
+          if (pos_ >= p_.size())
+            return false;
+          char e = p_[pos_++];
+          if (!ParseEscape(e, &is_literal, &literal))
+            return false;
+          break;
+        }
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+        case '}':
+        case ']':
+          return false;
+        default:
+          is_literal = true;
+          literal = c;
+          break;
+      }
+
+      uint32_t min_repetitions = 1;
+      bool is_repeated = false;
+      if (!ParseQuantifier(&min_repetitions, &is_repeated))
+        return false;
+      if (is_literal && min_repetitions > 0) {
+        run.push_back(literal);
+        if (is_repeated)
+          Flush(&run, &local);
+        continue;
+      }
+      Flush(&run, &local);
+      if (is_group && min_repetitions > 0) {
+        local.insert(local.end(), group_literals.begin(),
+                     group_literals.end());
+      }
+    }
+    Flush(&run, &local);
+    if (!has_alternation)
+      literals->insert(literals->end(), local.begin(), local.end());
+    return true;
+  }
+
+  // Parses the escape sequence "\|e|". Backreferences and character escapes
+  // by code (e.g. \x41) are not supported.
+  static bool ParseEscape(char e, bool* is_literal, char* literal) {
+    switch (e) {
+      case 'd':
+      case 'D':
+      case 'w':
+      case 'W':
+      case 's':
+      case 'S':
+      case 'b':
+      case 'B':
+        *is_literal = false;
+        return true;
+      case 'n':
+        *literal = '\n';
+        break;
+      case 'r':
+        *literal = '\r';
+        break;
+      case 't':
+        *literal = '\t';
+        break;
+      case 'f':
+        *literal = '\f';
+        break;
+      case 'v':
+        *literal = '\v';
+        break;
+      default:
+        if ((e >= '0' && e <= '9') || (e >= 'a' && e <= 'z') ||
+            (e >= 'A' && e <= 'Z')) {
+          return false;
+        }
+        *literal = e;
+        break;
+    }
+    *is_literal = true;
+    return true;
+  }
+
+  // Skips a "[...]" class; the '[' has already been consumed.
+  bool SkipClass() {
+    if (pos_ < p_.size() && p_[pos_] == '^')
+      ++pos_;
+    while (pos_ < p_.size()) {
+      char c = p_[pos_++];
+      if (c == ']')
+        return true;
+      if (c == '\\')
+        ++pos_;
+    }
+    return false;
+  }
+
+  bool ParseQuantifier(uint32_t* min_repetitions, bool* is_repeated) {
+    if (pos_ >= p_.size())
+      return true;
+    switch (p_[pos_]) {
+      case '*':
+      case '?':
+        *min_repetitions = 0;
+        break;
+      case '+':
+        *is_repeated = true;
+        break;
+      case '{': {
+        ++pos_;
+        if (!ParseNumber(min_repetitions))
+          return false;
+        uint32_t unused = 0;
+        if (Consume(",") && pos_ < p_.size() && p_[pos_] != '}' &&
+            !ParseNumber(&unused)) {
+          return false;
+        }
+        if (pos_ >= p_.size() || p_[pos_] != '}')
+          return false;
+        *is_repeated = true;
+        break;
+      }
+      default:
+        return true;
+    }
+    ++pos_;
+    // Lazy quantifiers match the same strings.
+    Consume("?");
+    return true;
+  }
+
+  bool ParseNumber(uint32_t* value) {
+    size_t start = pos_;
+    uint64_t res = 0;
+    for (; pos_ < p_.size() && p_[pos_] >= '0' && p_[pos_] <= '9'; ++pos_) {
+      res = res * 10 + static_cast<uint32_t>(p_[pos_] - '0');
+      if (res > std::numeric_limits<uint32_t>::max())
+        return false;
+    }
+    *value = static_cast<uint32_t>(res);
+    return pos_ != start;
+  }
+
+  bool Consume(std::string_view str) {
+    if (p_.substr(pos_, str.size()) != str)
+      return false;
+    pos_ += str.size();
+    return true;
+  }
+
+  static void Flush(std::string* run, std::vector<std::string>* literals) {
+    if (run->empty())
+      return;
+    literals->emplace_back(std::move(*run));
+    run->clear();
+  }
+
+  std::string_view p_;
+  size_t pos_ = 0;
+};
+
+}  // namespace
+
+LiteralMatcher::LiteralMatcher() = default;
+LiteralMatcher::~LiteralMatcher() = default;
+
+void LiteralMatcher::Build(const std::vector<std::string>& literals) {
+  static constexpr uint32_t kNoTransition =
+      std::numeric_limits<uint32_t>::max();
+
+  byte_classes_.fill(0);
+  num_classes_ = 1;
+  transitions_.clear();
+  output_offsets_.clear();
+  outputs_.clear();
+
+  size_t count = std::min(literals.size(), kMaxLiterals);
+  for (size_t i = 0; i < count; ++i) {
+    for (char c : literals[i]) {
+      uint16_t& cls = byte_classes_[static_cast<uint8_t>(c)];
+      if (cls == 0)
+        cls = static_cast<uint16_t>(num_classes_++);
+    }
+  }
+
+  // Build the trie of the literals.
+  transitions_.assign(num_classes_, kNoTransition);
+  std::vector<std::vector<uint16_t>> state_outputs(1);
+  for (size_t i = 0; i < count; ++i) {
+    if (literals[i].empty())
+      continue;
+    uint32_t state = 0;
+    for (char c : literals[i]) {
+      size_t idx =
+          state * num_classes_ + byte_classes_[static_cast<uint8_t>(c)];
+      if (transitions_[idx] == kNoTransition) {
+        transitions_[idx] = static_cast<uint32_t>(state_outputs.size());
+        transitions_.resize(transitions_.size() + num_classes_, kNoTransition);
+        state_outputs.emplace_back();
+      }
+      state = transitions_[idx];
+    }
+    state_outputs[state].push_back(static_cast<uint16_t>(i));
+  }
+  if (state_outputs.size() == 1) {
+    transitions_.assign(num_classes_, 0);
+    return;
+  }
+
+  // Visit the trie breadth first, so that the failure state of each state
+  // (i.e. the state of its longest proper suffix) has been completed when the
+  // state is reached. Missing transitions are replaced with the ones of the
+  // failure state, turning the trie into a DFA.
+  std::vector<uint32_t> failure(state_outputs.size(), 0);
+  std::vector<uint32_t> queue = {0};
+  for (size_t q = 0; q < queue.size(); ++q) {
+    uint32_t state = queue[q];
+    if (state != 0) {
+      const auto& suffix_outputs = state_outputs[failure[state]];
+      state_outputs[state].insert(state_outputs[state].end(),
+                                  suffix_outputs.begin(),
+                                  suffix_outputs.end());
+    }
+    for (uint32_t cls = 0; cls < num_classes_; ++cls) {
+      uint32_t via_failure =
+          state == 0 ? 0 : transitions_[failure[state] * num_classes_ + cls];
+      uint32_t& next = transitions_[state * num_classes_ + cls];
+      if (next == kNoTransition) {
+        next = via_failure;
+      } else {
+        failure[next] = via_failure;
+        queue.push_back(next);
+      }
+    }
+  }
+
+  output_offsets_.reserve(state_outputs.size() + 1);
+  for (const auto& state_output : state_outputs) {
+    output_offsets_.push_back(static_cast<uint32_t>(outputs_.size()));
+    outputs_.insert(outputs_.end(), state_output.begin(), state_output.end());
+  }
+  output_offsets_.push_back(static_cast<uint32_t>(outputs_.size()));
+  for (uint32_t& next : transitions_) {
+    if (!state_outputs[next].empty())
+      next |= kHasOutputBit;
+  }
+}
+
+std::string RequiredLiteralForRegex(std::string_view pattern) {
+  return RequiredLiteralFinder(pattern).Find();
+}
+
+}  // namespace protozero
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_PROTOZERO_FILTERING_LITERAL_MATCHER_H_
+#define SRC_PROTOZERO_FILTERING_LITERAL_MATCHER_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/public/compiler.h"
+
+namespace protozero {
+
+// Finds which of a set of literals occur in a string with a single pass over
+// the string (Aho-Corasick). Used by StringFilter to skip the (expensive)
+// regex evaluation of the rules which cannot possibly match a string.
+class LiteralMatcher {
+ public:
+  // Only the first |kMaxLiterals| literals are matched, so that the set of
+  // matching literals fits in a fixed size bitmap on the stack.
+  static constexpr size_t kMaxLiterals = 512;
+
+  class MatchSet {
+   public:
+    PERFETTO_ALWAYS_INLINE void Clear() { words_.fill(0); }
+    PERFETTO_ALWAYS_INLINE void Set(size_t id) {
+      words_[id / 64] |= uint64_t(1) << (id % 64);
+    }
+    PERFETTO_ALWAYS_INLINE bool IsSet(size_t id) const {
+      return (words_[id / 64] & (uint64_t(1) << (id % 64))) != 0;
+    }
+
+   private:
+    // Not initialized until Match() is called, as that is skipped for most
+    // strings.
+    std::array<uint64_t, kMaxLiterals / 64> words_;
+  };
+
+  LiteralMatcher();
+  ~LiteralMatcher();
+
+  // Replaces the set of literals. The literal at index i is reported with id
+  // i; empty literals and the ones past |kMaxLiterals| are never reported.
+  void Build(const std::vector<std::string>& literals);
+
+  // Returns true if there are no literals to match.
+  bool empty() const { return outputs_.empty(); }
+
+  // Sets |matches| to the ids of the literals which occur in
+  // [ptr, ptr + len).
+  void Match(const char* ptr, size_t len, MatchSet* matches) const {
+    matches->Clear();
+    uint32_t state = 0;
+    for (const char* end = ptr + len; ptr != end; ++ptr) {
+      uint32_t cls = byte_classes_[static_cast<uint8_t>(*ptr)];
+      state = transitions_[state * num_classes_ + cls];
+      if (PERFETTO_UNLIKELY(state & kHasOutputBit)) {
+        state &= ~kHasOutputBit;
+        for (uint32_t i = output_offsets_[state];
+             i < output_offsets_[state + 1]; ++i) {
+          matches->Set(outputs_[i]);
+        }
+      }
+    }
+  }
+
+ private:
+  // Set in the transitions leading to states where at least one literal ends.
+  static constexpr uint32_t kHasOutputBit = 1u << 31;
+
+  // Bytes which don't occur in any literal share class 0, so each state only
+  // needs a transition for each distinct byte of the literals.
+  std::array<uint16_t, 256> byte_classes_{};
+  uint32_t num_classes_ = 1;
+
+  // |num_classes_| transitions for each state; state 0 is the root.
+  std::vector<uint32_t> transitions_;
+
+  // The ids of the literals ending at state s (including the ones which are
+  // suffixes of other literals) are
+  // outputs_[output_offsets_[s], output_offsets_[s + 1]).
+  std::vector<uint32_t> output_offsets_;
+  std::vector<uint16_t> outputs_;
+};
+
+// Returns a literal string which occurs in every string matched by the
+// ECMAScript regex |pattern| (the longest one which can be cheaply found), or
+// an empty string if there is no such literal or the pattern uses syntax which
+// is not understood.
+std::string RequiredLiteralForRegex(std::string_view pattern);
+
+}  // namespace protozero
+
+#endif  // SRC_PROTOZERO_FILTERING_LITERAL_MATCHER_H_
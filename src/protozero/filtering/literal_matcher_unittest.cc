@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/protozero/filtering/literal_matcher.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "test/gtest_and_gmock.h"
+
+namespace protozero {
+namespace {
+
+std::vector<size_t> Match(const LiteralMatcher& matcher,
+                          const std::string& str,
+                          size_t num_literals) {
+  LiteralMatcher::MatchSet matches;
+  matcher.Match(str.data(), str.size(), &matches);
+  std::vector<size_t> res;
+  for (size_t i = 0; i < num_literals && i < LiteralMatcher::kMaxLiterals;
+       ++i) {
+    if (matches.IsSet(i))
+      res.push_back(i);
+  }
+  return res;
+}
+
+TEST(LiteralMatcherTest, Empty) {
+  LiteralMatcher matcher;
+  matcher.Build({});
+  ASSERT_TRUE(matcher.empty());
+  matcher.Build({"", ""});
+  ASSERT_TRUE(matcher.empty());
+}
+
+TEST(LiteralMatcherTest, Basic) {
+  LiteralMatcher matcher;
+  std::vector<std::string> literals = {"he", "she", "his", "hers", ""};
+  matcher.Build(literals);
+  ASSERT_FALSE(matcher.empty());
+
+  using testing::ElementsAre;
+  EXPECT_THAT(Match(matcher, "ushers", 5), ElementsAre(0, 1, 3));
+  EXPECT_THAT(Match(matcher, "this", 5), ElementsAre(2));
+  EXPECT_THAT(Match(matcher, "h", 5), ElementsAre());
+  EXPECT_THAT(Match(matcher, "", 5), ElementsAre());
+  EXPECT_THAT(Match(matcher, "xyz hhe", 5), ElementsAre(0));
+}
+
+TEST(LiteralMatcherTest, DuplicatesAndSuffixes) {
+  LiteralMatcher matcher;
+  matcher.Build({"abc", "bc", "abc", "c", "abcd"});
+  EXPECT_THAT(Match(matcher, "zabcz", 5), testing::ElementsAre(0, 1, 2, 3));
+  EXPECT_THAT(Match(matcher, "abab", 5), testing::ElementsAre());
+}
+
+TEST(LiteralMatcherTest, MatchesAgainstNaiveSearch) {
+  std::vector<std::string> literals;
+  for (int i = 0; i < 100; ++i)
+    literals.push_back("lit" + std::to_string(i * 7));
+  literals.push_back("\xff\x80");
+  LiteralMatcher matcher;
+  matcher.Build(literals);
+
+  for (const std::string str :
+       {"lit0", "lit70lit7", "alit49lit3", "lit", "x\xff\x80y", "li t63"}) {
+    std::vector<size_t> expected;
+    for (size_t i = 0; i < literals.size(); ++i) {
+      if (str.find(literals[i]) != std::string::npos)
+        expected.push_back(i);
+    }
+    EXPECT_EQ(Match(matcher, str, literals.size()), expected) << str;
+  }
+}
+
+TEST(LiteralMatcherTest, TooManyLiterals) {
+  std::vector<std::string> literals(LiteralMatcher::kMaxLiterals + 1, "foo");
+  LiteralMatcher matcher;
+  matcher.Build(literals);
+  std::vector<size_t> res = Match(matcher, "foo", literals.size());
+  ASSERT_EQ(res.size(), LiteralMatcher::kMaxLiterals);
+  ASSERT_EQ(res.back(), LiteralMatcher::kMaxLiterals - 1);
+}
+
+TEST(LiteralMatcherTest, RequiredLiteralForRegex) {
+  EXPECT_EQ(RequiredLiteralForRegex(R"(B\|\d+\|foo (.*))"), "|foo ");
+  EXPECT_EQ(RequiredLiteralForRegex(R"(S\|[^|]+\|\*job\*\/.*\/.*\/(.*)\n)"),
+            "|*job*/");
+  EXPECT_EQ(RequiredLiteralForRegex(R"(C\|[^|]+\|Heap size \(KB\)\|(\d+)\n)"),
+            "|Heap size (KB)|");
+  EXPECT_EQ(RequiredLiteralForRegex("abc"), "abc");
+  EXPECT_EQ(RequiredLiteralForRegex("ab?cd"), "cd");
+  EXPECT_EQ(RequiredLiteralForRegex("abcx*yz"), "abc");
+  EXPECT_EQ(RequiredLiteralForRegex("ab+c"), "ab");
+  EXPECT_EQ(RequiredLiteralForRegex("a{2,3}bc"), "bc");
+  EXPECT_EQ(RequiredLiteralForRegex("x(?:hello)+y"), "hello");
+  EXPECT_EQ(RequiredLiteralForRegex("x(hello)?y"), "x");
+  EXPECT_EQ(RequiredLiteralForRegex("(?=lookahead)ab"), "ab");
+  EXPECT_EQ(RequiredLiteralForRegex("^start\\tend$"), "start\tend");
+  EXPECT_EQ(RequiredLiteralForRegex("[abc]]"), "");
+
+  // Alternations make the literals of the alternatives optional.
+  EXPECT_EQ(RequiredLiteralForRegex("foo|bar"), "");
+  EXPECT_EQ(RequiredLiteralForRegex("prefix(foo|bar)"), "prefix");
+
+  // Unsupported syntax.
+  EXPECT_EQ(RequiredLiteralForRegex(R"((a)\1)"), "");
+  EXPECT_EQ(RequiredLiteralForRegex(R"(\x41BC)"), "");
+  EXPECT_EQ(RequiredLiteralForRegex("(abc"), "");
+  EXPECT_EQ(RequiredLiteralForRegex("abc)"), "");
+  EXPECT_EQ(RequiredLiteralForRegex("a{2"), "");
+}
+
+}  // namespace
+}  // namespace protozero
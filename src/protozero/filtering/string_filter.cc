@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <cstring>
+#include <optional>
 #include <regex>
 #include <string>
 #include <string_view>
@@ -118,17 +119,61 @@ void StringFilter::AddRule(Policy policy,
       std::regex(pattern_str.begin(), pattern_str.end(),
                  std::regex::ECMAScript | std::regex_constants::optimize),
       std::move(atrace_payload_starts_with), std::move(name),
-      semantic_type_mask};
+      semantic_type_mask, RequiredLiteralForRegex(pattern_str)};
+
+  // Atrace rules already check that the payload starts with
+  // |atrace_payload_starts_with|: matching a literal contained in it would be
+  // redundant.
+  bool is_atrace =
+      policy != Policy::kMatchRedactGroups && policy != Policy::kMatchBreak;
+  if (is_atrace && new_rule.atrace_payload_starts_with.find(
+                       new_rule.required_literal) != std::string::npos) {
+    new_rule.required_literal.clear();
+  }
+
   // If name is non-empty, look for existing rule with same name and replace.
+  bool replaced = false;
   if (!new_rule.name.empty()) {
     for (Rule& existing : rules_) {
       if (existing.name == new_rule.name) {
         existing = std::move(new_rule);
-        return;
+        replaced = true;
+        break;
       }
     }
   }
-  rules_.push_back(std::move(new_rule));
+  if (!replaced) {
+    rules_.push_back(std::move(new_rule));
+  }
+  RebuildLiteralMatcher();
+}
+
+void StringFilter::RebuildLiteralMatcher() {
+  std::vector<std::string> literals;
+  literals.reserve(rules_.size());
+  for (size_t i = 0; i < rules_.size(); ++i) {
+    Rule& rule = rules_[i];
+    rule.prefiltered = !rule.required_literal.empty() &&
+                       i < LiteralMatcher::kMaxLiterals;
+    literals.push_back(rule.required_literal);
+  }
+  literal_matcher_.Build(literals);
+}
+
+bool StringFilter::MayMatch(
+    size_t rule_idx,
+    const char* ptr,
+    size_t len,
+    std::optional<LiteralMatcher::MatchSet>* literal_matches) const {
+  if (!rules_[rule_idx].prefiltered) {
+    return true;
+  }
+  // The literals are matched lazily, the first time a prefiltered rule passes
+  // the cheaper checks.
+  if (!literal_matches->has_value()) {
+    literal_matcher_.Match(ptr, len, &literal_matches->emplace());
+  }
+  return (*literal_matches)->IsSet(rule_idx);
 }
 
 bool StringFilter::MaybeFilterInternal(char* ptr,
@@ -137,7 +182,9 @@ bool StringFilter::MaybeFilterInternal(char* ptr,
   std::match_results<char*> matches;
   bool atrace_find_tried = false;
   const char* atrace_payload_ptr = nullptr;
-  for (const Rule& rule : rules_) {
+  std::optional<LiteralMatcher::MatchSet> literal_matches;
+  for (size_t i = 0; i < rules_.size(); ++i) {
+    const Rule& rule = rules_[i];
     if (!rule.semantic_type_mask.IsSet(semantic_type)) {
       continue;
     }
@@ -145,6 +192,7 @@ bool StringFilter::MaybeFilterInternal(char* ptr,
       case Policy::kMatchRedactGroups:
       case Policy::kMatchBreak:
         if (PERFETTO_UNLIKELY(
+                MayMatch(i, ptr, len, &literal_matches) &&
                 std::regex_match(ptr, ptr + len, matches, rule.pattern))) {
           if (rule.policy == Policy::kMatchBreak) {
             return false;
@@ -162,6 +210,7 @@ bool StringFilter::MaybeFilterInternal(char* ptr,
         if (atrace_payload_ptr &&
             StartsWith(atrace_payload_ptr, ptr + len,
                        rule.atrace_payload_starts_with) &&
+            MayMatch(i, ptr, len, &literal_matches) &&
             std::regex_match(ptr, ptr + len, matches, rule.pattern)) {
           if (rule.policy == Policy::kAtraceMatchBreak) {
             return false;
@@ -175,8 +224,10 @@ bool StringFilter::MaybeFilterInternal(char* ptr,
                                  ? atrace_payload_ptr
                                  : FindAtracePayloadPtr(ptr, ptr + len);
         atrace_find_tried = true;
-        if (atrace_payload_ptr && StartsWith(atrace_payload_ptr, ptr + len,
-                                             rule.atrace_payload_starts_with)) {
+        if (atrace_payload_ptr &&
+            StartsWith(atrace_payload_ptr, ptr + len,
+                       rule.atrace_payload_starts_with) &&
+            MayMatch(i, ptr, len, &literal_matches)) {
           auto beg = std::regex_iterator<char*>(ptr, ptr + len, rule.pattern);
           auto end = std::regex_iterator<char*>();
           bool has_any_matches = beg != end;
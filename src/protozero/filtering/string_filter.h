@@ -20,6 +20,7 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <optional>
 #include <regex>
 #include <string>
 #include <string_view>
@@ -27,6 +28,7 @@
 
 #include "perfetto/base/logging.h"
 #include "perfetto/public/compiler.h"
+#include "src/protozero/filtering/literal_matcher.h"
 
 namespace protozero {
 
@@ -126,12 +128,36 @@ class StringFilter {
     std::string atrace_payload_starts_with;
     std::string name;
     SemanticTypeMask semantic_type_mask = SemanticTypeMask::Unspecified();
+
+    // A literal which occurs in every string the rule can match (see
+    // RequiredLiteralForRegex()) or empty if no such literal is known.
+    std::string required_literal;
+
+    // True if |required_literal| is matched by |literal_matcher_|: the rule
+    // is skipped for strings which don't contain it.
+    bool prefiltered = false;
   };
 
   bool MaybeFilterInternal(char* ptr, size_t len, uint32_t semantic_type) const;
 
+  // Returns false if the rule at |rule_idx| cannot match [ptr, ptr + len)
+  // because the string doesn't contain the rule's required literal.
+  // |literal_matches| caches the literals found in the string.
+  bool MayMatch(size_t rule_idx,
+                const char* ptr,
+                size_t len,
+                std::optional<LiteralMatcher::MatchSet>* literal_matches) const;
+
+  // Rebuilds |literal_matcher_| from the required literals of the rules.
+  void RebuildLiteralMatcher();
+
   // All rules, in the order they were added.
   std::vector<Rule> rules_;
+
+  // Matches the required literals of all the rules in a single pass over each
+  // string, so that the regexes are only evaluated for the rules which have a
+  // chance to match.
+  LiteralMatcher literal_matcher_;
 };
 
 }  // namespace protozero
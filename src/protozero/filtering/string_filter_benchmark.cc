@@ -232,3 +232,45 @@ static void BM_ProtozeroStringFilterSemanticTypeBothMatch(
 BENCHMARK(BM_ProtozeroStringFilterSemanticTypeBothMatch)
     ->Unit(benchmark::kMillisecond)
     ->Arg(10);
+
+// Large configs with one rule per event name: each string is only matched
+// against the regexes of the rules whose required literal it contains.
+static void BM_ProtozeroStringFilterManyRules(benchmark::State& state) {
+  std::vector<std::string> patterns;
+  for (int i = 0; i < 64; ++i) {
+    patterns.push_back(R"(B\|[^|]+\|event_)" + std::to_string(i) +
+                       R"( (.*)\n)");
+  }
+  patterns.push_back(R"(B\|[^|]+\|Lock contention on a monitor lock (.*)\n)");
+
+  std::vector<std::tuple<Policy, const char*, const char*, SemanticTypeMask>>
+      rules;
+  for (const std::string& pattern : patterns) {
+    rules.emplace_back(Policy::kMatchRedactGroups, pattern.c_str(), "",
+                       SemanticTypeMask::Unspecified());
+  }
+  Benchmark(state, rules);
+}
+BENCHMARK(BM_ProtozeroStringFilterManyRules)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(1);
+
+static void BM_ProtozeroStringFilterManyAtraceRules(benchmark::State& state) {
+  std::vector<std::string> patterns;
+  for (int i = 0; i < 64; ++i) {
+    patterns.push_back(R"(B\|[^|]+\|Lock contention on )" + std::to_string(i) +
+                       R"( (.*)\n)");
+  }
+  patterns.push_back(R"(B\|[^|]+\|Lock contention on a monitor lock (.*)\n)");
+
+  std::vector<std::tuple<Policy, const char*, const char*, SemanticTypeMask>>
+      rules;
+  for (const std::string& pattern : patterns) {
+    rules.emplace_back(Policy::kAtraceMatchRedactGroups, pattern.c_str(),
+                       "Lock contention on", SemanticTypeMask::Unspecified());
+  }
+  Benchmark(state, rules);
+}
+BENCHMARK(BM_ProtozeroStringFilterManyAtraceRules)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(1);
@@ -604,6 +604,46 @@ TEST(StringFilterTest, RuleReplacementByName) {
   ASSERT_EQ(str6, "qux:P60RED");
 }
 
+TEST(StringFilterTest, ManyRules) {
+  StringFilter filter;
+  for (int i = 0; i < 60; ++i) {
+    std::string n = std::to_string(i);
+    filter.AddRule(StringFilter::Policy::kMatchRedactGroups,
+                   "B\\|\\d+\\|event" + n + " (.*)", "");
+    filter.AddRule(StringFilter::Policy::kAtraceMatchRedactGroups,
+                   "B\\|\\d+\\|atrace (.*) tag" + n, "atrace");
+  }
+  // Rules without any required literal are always evaluated.
+  filter.AddRule(StringFilter::Policy::kMatchRedactGroups, R"(\d+:(\d+))", "");
+
+  std::string str1 = "B|1234|event42 secret";
+  ASSERT_TRUE(filter.MaybeFilter(str1.data(), str1.size()));
+  ASSERT_EQ(str1, "B|1234|event42 P60RED");
+
+  std::string str2 = "B|1234|atrace secret tag59";
+  ASSERT_TRUE(filter.MaybeFilter(str2.data(), str2.size()));
+  ASSERT_EQ(str2, "B|1234|atrace P60RED tag59");
+
+  std::string str3 = "B|1234|event60 secret";
+  ASSERT_FALSE(filter.MaybeFilter(str3.data(), str3.size()));
+  ASSERT_EQ(str3, "B|1234|event60 secret");
+
+  std::string str4 = "1234:5678";
+  ASSERT_TRUE(filter.MaybeFilter(str4.data(), str4.size()));
+  ASSERT_EQ(str4, "1234:P60R");
+
+  // Replacing a rule replaces its required literal.
+  filter.AddRule(StringFilter::Policy::kMatchRedactGroups, R"(foo(.*))", "",
+                 "named");
+  filter.AddRule(StringFilter::Policy::kMatchRedactGroups, R"(bar(.*))", "",
+                 "named");
+  std::string str5 = "foo1";
+  ASSERT_FALSE(filter.MaybeFilter(str5.data(), str5.size()));
+  std::string str6 = "bar1";
+  ASSERT_TRUE(filter.MaybeFilter(str6.data(), str6.size()));
+  ASSERT_EQ(str6, "barP");
+}
+
 TEST(StringFilterTest, SemanticTypeMaskConstruction) {
   StringFilter filter;
 
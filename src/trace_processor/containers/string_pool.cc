@@ -20,11 +20,18 @@
 #include <cstdint>
 #include <cstring>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 #include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/murmur_hash.h"
+#include "perfetto/ext/base/status_macros.h"
 #include "perfetto/ext/base/string_view.h"
 #include "perfetto/public/compiler.h"
+#include "src/trace_processor/core/util/snapshot.h"
 
 namespace perfetto::trace_processor {
 
@@ -105,4 +112,114 @@ uint32_t StringPool::InsertInCurrentBlock(base::StringView str) {
   return static_cast<uint32_t>(str_start - blocks_[block_index_].get());
 }
 
+void StringPool::SerializeToSnapshot(core::SnapshotWriter* writer) const {
+  MaybeLockGuard guard{mutex_, should_acquire_mutex_};
+  writer->WriteU32(kBlockSizeBytes);
+  writer->WriteU32(block_index_);
+  for (uint32_t i = 0; i <= block_index_; ++i) {
+    const uint8_t* start = blocks_[i].get();
+    auto used = static_cast<uint64_t>(block_end_ptrs_[i] - start);
+    writer->WriteU64(used);
+    writer->WriteArray(start, used, used);
+  }
+  writer->WriteU64(large_strings_.size());
+  for (const auto& [ptr, size] : large_strings_) {
+    writer->WriteString(std::string_view(ptr.get(), size));
+  }
+}
+
+base::Status StringPool::LoadFromSnapshot(core::SnapshotReader* reader) {
+  // Remember the strings which are already in the pool: their ids may have
+  // been stored by other classes and must not change.
+  std::vector<std::pair<std::string, Id>> existing;
+  for (auto it = CreateSmallStringIterator(); it; ++it) {
+    if (!it.StringId().is_null()) {
+      existing.emplace_back(it.StringView().ToStdString(), it.StringId());
+    }
+  }
+  {
+    MaybeLockGuard guard{mutex_, should_acquire_mutex_};
+    for (uint32_t i = 0; i < large_strings_.size(); ++i) {
+      const auto& [ptr, size] = large_strings_[i];
+      existing.emplace_back(std::string(ptr.get(), size), Id::LargeString(i));
+    }
+  }
+
+  ASSIGN_OR_RETURN(uint32_t block_size, reader->ReadU32());
+  ASSIGN_OR_RETURN(uint32_t block_index, reader->ReadU32());
+  if (block_size != kBlockSizeBytes || block_index >= kMaxBlockCount) {
+    return base::ErrStatus("Snapshot: invalid string pool");
+  }
+
+  MaybeLockGuard guard{mutex_, should_acquire_mutex_};
+  for (uint32_t i = 0; i <= block_index; ++i) {
+    ASSIGN_OR_RETURN(uint64_t used, reader->ReadU64());
+    if (used > kBlockSizeBytes) {
+      return base::ErrStatus("Snapshot: invalid string pool block");
+    }
+    ASSIGN_OR_RETURN(const uint8_t* data, reader->ReadArray<uint8_t>(used));
+    if (!blocks_[i]) {
+      blocks_[i] = std::make_unique<uint8_t[]>(kBlockSizeBytes);
+    }
+    memcpy(blocks_[i].get(), data, static_cast<size_t>(used));
+    block_end_ptrs_[i] = blocks_[i].get() + used;
+  }
+  for (uint32_t i = block_index + 1; i <= block_index_; ++i) {
+    blocks_[i].reset();
+    block_end_ptrs_[i] = nullptr;
+  }
+  block_index_ = block_index;
+
+  ASSIGN_OR_RETURN(uint64_t large_string_count, reader->ReadU64());
+  large_strings_.clear();
+  for (uint64_t i = 0; i < large_string_count; ++i) {
+    ASSIGN_OR_RETURN(std::string_view str, reader->ReadString());
+    large_strings_.emplace_back(std::make_unique<char[]>(str.size() + 1),
+                                str.size());
+    memcpy(large_strings_.back().first.get(), str.data(), str.size());
+    large_strings_.back().first[str.size()] = '\0';
+  }
+
+  // Rebuild the hash index by walking over all the strings. The first string
+  // of the first block is the null string which is never indexed.
+  string_index_.Clear();
+  for (uint32_t i = 0; i <= block_index_; ++i) {
+    const uint8_t* start = blocks_[i].get();
+    const uint8_t* end = block_end_ptrs_[i];
+    for (const uint8_t* ptr = start; ptr < end;) {
+      if (static_cast<size_t>(end - ptr) < kMetadataSize) {
+        return base::ErrStatus("Snapshot: invalid string pool block");
+      }
+      uint32_t size = 0;
+      const uint8_t* str = ReadSize(ptr, &size);
+      if (static_cast<size_t>(end - str) < size + 1u) {
+        return base::ErrStatus("Snapshot: invalid string pool block");
+      }
+      if (i != 0 || ptr != start) {
+        base::StringView view(reinterpret_cast<const char*>(str), size);
+        string_index_.Insert(
+            base::MurmurHashValue(view),
+            Id::BlockString(i, static_cast<uint32_t>(ptr - start)));
+      }
+      ptr = str + size + 1;
+    }
+  }
+  for (uint32_t i = 0; i < large_strings_.size(); ++i) {
+    const auto& [ptr, size] = large_strings_[i];
+    base::StringView view(ptr.get(), size);
+    string_index_.Insert(base::MurmurHashValue(view), Id::LargeString(i));
+  }
+
+  for (const auto& [str, id] : existing) {
+    Id* new_id =
+        string_index_.Find(base::MurmurHashValue(base::StringView(str)));
+    if (!new_id || *new_id != id) {
+      return base::ErrStatus(
+          "Snapshot: string pool is incompatible with this trace processor; "
+          "was the snapshot written by a different version?");
+    }
+  }
+  return base::OkStatus();
+}
+
 }  // namespace perfetto::trace_processor
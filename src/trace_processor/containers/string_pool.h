@@ -29,6 +29,7 @@
 #include <vector>
 
 #include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
 #include "perfetto/base/thread_annotations.h"
 #include "perfetto/ext/base/flat_hash_map.h"
 #include "perfetto/ext/base/hash.h"
@@ -39,6 +40,11 @@
 
 namespace perfetto::trace_processor {
 
+namespace core {
+class SnapshotReader;
+class SnapshotWriter;
+}  // namespace core
+
 // Interns strings in a string pool and hands out compact StringIds which can
 // be used to retrieve the string in O(1).
 class StringPool {
@@ -188,9 +194,20 @@ class StringPool {
 
     explicit SmallStringIterator(
         std::array<const uint8_t*, kMaxBlockCount> block_start_ptrs,
-        std::array<const uint8_t*, kMaxBlockCount> block_end_ptrs)
+        std::array<const uint8_t*, kMaxBlockCount> block_end_ptrs,
+        Id start)
         : block_start_ptrs_(block_start_ptrs), block_end_ptrs_(block_end_ptrs) {
-      current_block_ptr_ = block_start_ptrs[0];
+      current_block_index_ = start.block_index();
+      const uint8_t* block_start = block_start_ptrs_[current_block_index_];
+      if (!block_start) {
+        return;
+      }
+      current_block_ptr_ = block_start + start.block_offset();
+      PERFETTO_DCHECK(current_block_ptr_ <=
+                      block_end_ptrs_[current_block_index_]);
+      if (current_block_ptr_ == block_end_ptrs_[current_block_index_]) {
+        current_block_ptr_ = block_start_ptrs_[++current_block_index_];
+      }
     }
 
     std::array<const uint8_t*, kMaxBlockCount> block_start_ptrs_;
@@ -252,6 +269,15 @@ class StringPool {
   }
 
   SmallStringIterator CreateSmallStringIterator() const {
+    return CreateSmallStringIterator(Id::Null());
+  }
+
+  // Creates an iterator over the small strings in the pool starting at
+  // |start|. |start| should either be the id of a small string or a value
+  // previously returned by |MaxSmallStringId|: in the latter case, the
+  // iterator only returns the strings added since that call.
+  SmallStringIterator CreateSmallStringIterator(Id start) const {
+    PERFETTO_DCHECK(!start.is_large_string());
     MaybeLockGuard guard{mutex_, should_acquire_mutex_};
     std::array<const uint8_t*, kMaxBlockCount> block_start_ptrs;
     for (uint32_t i = 0; i < kMaxBlockCount; ++i) {
@@ -261,7 +287,7 @@ class StringPool {
     for (uint32_t i = 0; i < kMaxBlockCount; ++i) {
       block_end_ptrs[i] = block_end_ptrs_[i];
     }
-    return SmallStringIterator(block_start_ptrs, block_end_ptrs);
+    return SmallStringIterator(block_start_ptrs, block_end_ptrs, start);
   }
 
   size_t size() const {
@@ -292,6 +318,19 @@ class StringPool {
   // Sets the locking mode of the string pool.
   void set_locking(bool should_lock) { should_acquire_mutex_ = should_lock; }
 
+  // Writes all the strings in the pool to `writer`, preserving their ids.
+  void SerializeToSnapshot(core::SnapshotWriter* writer) const;
+
+  // Replaces the contents of the pool with the strings written by
+  // `SerializeToSnapshot`. Unlike dataframes, the strings are copied out of
+  // `reader` as the pool may need to intern more strings after loading.
+  //
+  // Every string already in the pool must have the same id in the snapshot.
+  // This is the case when the snapshot was written by the same build of trace
+  // processor (which interns the same strings on startup); otherwise an error
+  // is returned.
+  base::Status LoadFromSnapshot(core::SnapshotReader* reader);
+
  private:
   using StringHash = uint64_t;
 
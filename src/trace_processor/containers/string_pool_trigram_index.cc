@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/containers/string_pool_trigram_index.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <vector>
+
+#include "perfetto/ext/base/string_view.h"
+#include "src/trace_processor/containers/null_term_string_view.h"
+#include "src/trace_processor/containers/string_pool.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+// Appends the trigrams of |str| to |out|.
+void AppendTrigrams(const char* str, size_t size, std::vector<uint32_t>* out) {
+  const auto* data = reinterpret_cast<const uint8_t*>(str);
+  for (size_t i = 0; i + 3 <= size; ++i) {
+    out->push_back(static_cast<uint32_t>(data[i]) << 16 |
+                   static_cast<uint32_t>(data[i + 1]) << 8 |
+                   static_cast<uint32_t>(data[i + 2]));
+  }
+}
+
+void SortAndDedupe(std::vector<uint32_t>* v) {
+  std::sort(v->begin(), v->end());
+  v->erase(std::unique(v->begin(), v->end()), v->end());
+}
+
+}  // namespace
+
+StringPoolTrigramIndex::StringPoolTrigramIndex(const StringPool* pool)
+    : pool_(pool) {}
+
+void StringPoolTrigramIndex::Update() {
+  StringPool::Id end = pool_->MaxSmallStringId();
+  if (end == indexed_end_) {
+    return;
+  }
+  // Strings are added to the pool in increasing id order and so are also
+  // appended to the posting lists in increasing order.
+  for (auto it = pool_->CreateSmallStringIterator(indexed_end_); it; ++it) {
+    StringPool::Id id = it.StringId();
+    if (!(id < end)) {
+      break;
+    }
+    if (id.is_null()) {
+      continue;
+    }
+    NullTermStringView str = it.StringView();
+    if (str.size() > kMaxIndexedStringSize) {
+      unindexed_.push_back(id.raw_id());
+      continue;
+    }
+    trigrams_.clear();
+    AppendTrigrams(str.data(), str.size(), &trigrams_);
+    SortAndDedupe(&trigrams_);
+    for (uint32_t trigram : trigrams_) {
+      postings_[trigram].push_back(id.raw_id());
+    }
+  }
+  indexed_end_ = end;
+}
+
+std::optional<std::vector<StringPool::Id>>
+StringPoolTrigramIndex::FindCandidates(
+    const std::vector<base::StringView>& literals) const {
+  std::vector<uint32_t> trigrams;
+  for (base::StringView literal : literals) {
+    AppendTrigrams(literal.data(), literal.size(), &trigrams);
+  }
+  if (trigrams.empty()) {
+    return std::nullopt;
+  }
+  SortAndDedupe(&trigrams);
+
+  // Intersect the posting lists starting from the shortest one: this keeps
+  // the intermediate results as small as possible.
+  std::vector<const std::vector<uint32_t>*> lists;
+  lists.reserve(trigrams.size());
+  for (uint32_t trigram : trigrams) {
+    const std::vector<uint32_t>* list = postings_.Find(trigram);
+    if (!list) {
+      lists.clear();
+      break;
+    }
+    lists.push_back(list);
+  }
+  std::sort(lists.begin(), lists.end(),
+            [](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) {
+              return a->size() < b->size();
+            });
+  std::vector<uint32_t> ids;
+  if (!lists.empty()) {
+    ids = *lists.front();
+    std::vector<uint32_t> scratch;
+    for (auto it = lists.begin() + 1; it != lists.end() && !ids.empty(); ++it) {
+      scratch.clear();
+      std::set_intersection(ids.begin(), ids.end(), (*it)->begin(),
+                            (*it)->end(), std::back_inserter(scratch));
+      ids.swap(scratch);
+    }
+  }
+
+  std::vector<StringPool::Id> candidates;
+  candidates.reserve(ids.size() + unindexed_.size());
+  auto ids_it = ids.begin();
+  auto unindexed_it = unindexed_.begin();
+  while (ids_it != ids.end() || unindexed_it != unindexed_.end()) {
+    bool take_id = unindexed_it == unindexed_.end() ||
+                   (ids_it != ids.end() && *ids_it < *unindexed_it);
+    candidates.push_back(
+        StringPool::Id::Raw(take_id ? *ids_it++ : *unindexed_it++));
+  }
+  return candidates;
+}
+
+}  // namespace perfetto::trace_processor
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_CONTAINERS_STRING_POOL_TRIGRAM_INDEX_H_
+#define SRC_TRACE_PROCESSOR_CONTAINERS_STRING_POOL_TRIGRAM_INDEX_H_
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "perfetto/ext/base/flat_hash_map.h"
+#include "perfetto/ext/base/string_view.h"
+#include "src/trace_processor/containers/string_pool.h"
+
+namespace perfetto::trace_processor {
+
+// Maps the trigrams (i.e. runs of three bytes) of the strings in a StringPool
+// to the ids of the strings containing them.
+//
+// This allows substring searches (e.g. `name GLOB '*binder*'`) to only look at
+// the few strings which could match instead of every string in the pool: a
+// string can only contain "binder" if it contains each of "bin", "ind", "nde"
+// and "der".
+//
+// The index is built lazily: strings are only indexed when |Update| is called.
+// As the pool is append-only, each call only needs to index the strings added
+// since the previous one.
+//
+// Large strings in the pool are never indexed: callers should not use the
+// index if |StringPool::HasLargeString| is true.
+class StringPoolTrigramIndex {
+ public:
+  // Strings longer than this are not split into trigrams (as they would bloat
+  // the index) but instead are returned as candidates for every search.
+  static constexpr uint32_t kMaxIndexedStringSize = 1024;
+
+  explicit StringPoolTrigramIndex(const StringPool* pool);
+
+  // Indexes all the small strings added to the pool since the last call.
+  void Update();
+
+  // Returns the ids, in increasing order, of the indexed strings which may
+  // contain all of |literals| as substrings. The result is a superset of the
+  // strings which actually contain them so the caller still has to check
+  // every candidate.
+  //
+  // Returns std::nullopt if no literal is long enough to contain a trigram,
+  // i.e. if the index cannot narrow down the search.
+  std::optional<std::vector<StringPool::Id>> FindCandidates(
+      const std::vector<base::StringView>& literals) const;
+
+  const StringPool* pool() const { return pool_; }
+
+ private:
+  const StringPool* pool_;
+
+  // For each trigram, the raw ids of the strings containing it in increasing
+  // order.
+  base::FlatHashMap<uint32_t, std::vector<uint32_t>> postings_;
+
+  // Raw ids of the strings longer than |kMaxIndexedStringSize| in increasing
+  // order.
+  std::vector<uint32_t> unindexed_;
+
+  // Value of |StringPool::MaxSmallStringId| when |Update| was last called:
+  // all strings before this id have been indexed.
+  StringPool::Id indexed_end_ = StringPool::Id::Null();
+
+  // Scratch buffer for the trigrams of a single string.
+  std::vector<uint32_t> trigrams_;
+};
+
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_CONTAINERS_STRING_POOL_TRIGRAM_INDEX_H_
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "perfetto/ext/base/string_view.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/containers/string_pool_trigram_index.h"
+#include "src/trace_processor/util/glob.h"
+
+namespace {
+
+using perfetto::base::StringView;
+using perfetto::trace_processor::StringPool;
+using perfetto::trace_processor::StringPoolTrigramIndex;
+using perfetto::trace_processor::util::GlobMatcher;
+
+constexpr char kBinderGlob[] = "*binder*";
+
+// Fills |pool| with |count| distinct strings which look like slice names:
+// a few of them contain "binder" while most do not.
+void FillPool(StringPool* pool, uint32_t count) {
+  static constexpr const char* kWords[] = {
+      "Choreographer#doFrame", "RenderThread", "DrawFrame",
+      "inflate",               "measure",      "layout",
+      "Lock contention",       "onMessage",    "traversal",
+      "animation",             "queueBuffer",  "dequeueBuffer",
+  };
+  std::minstd_rand0 rnd(0);
+  for (uint32_t i = 0; i < count; ++i) {
+    std::string str = kWords[rnd() % std::size(kWords)];
+    if (rnd() % 1000 == 0) {
+      str += " binder transaction";
+    }
+    str += " " + std::to_string(i);
+    pool->InternString(StringView(str));
+  }
+}
+
+void BM_StringPoolGlobScan(benchmark::State& state) {
+  StringPool pool;
+  FillPool(&pool, static_cast<uint32_t>(state.range(0)));
+  GlobMatcher matcher = GlobMatcher::FromPattern(kBinderGlob);
+  for (auto _ : state) {
+    uint32_t matches = 0;
+    for (auto it = pool.CreateSmallStringIterator(); it; ++it) {
+      matches += matcher.Matches(it.StringView());
+    }
+    benchmark::DoNotOptimize(matches);
+  }
+}
+BENCHMARK(BM_StringPoolGlobScan)->Arg(100 * 1000)->Arg(1000 * 1000);
+
+void BM_StringPoolGlobTrigramIndex(benchmark::State& state) {
+  StringPool pool;
+  FillPool(&pool, static_cast<uint32_t>(state.range(0)));
+  StringPoolTrigramIndex index(&pool);
+  index.Update();
+  GlobMatcher matcher = GlobMatcher::FromPattern(kBinderGlob);
+  for (auto _ : state) {
+    uint32_t matches = 0;
+    std::optional<std::vector<StringPool::Id>> candidates =
+        index.FindCandidates(matcher.LiteralRuns());
+    for (StringPool::Id id : *candidates) {
+      matches += matcher.Matches(pool.Get(id));
+    }
+    benchmark::DoNotOptimize(matches);
+  }
+}
+BENCHMARK(BM_StringPoolGlobTrigramIndex)->Arg(100 * 1000)->Arg(1000 * 1000);
+
+void BM_StringPoolTrigramIndexUpdate(benchmark::State& state) {
+  StringPool pool;
+  FillPool(&pool, static_cast<uint32_t>(state.range(0)));
+  for (auto _ : state) {
+    StringPoolTrigramIndex index(&pool);
+    index.Update();
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_StringPoolTrigramIndexUpdate)->Arg(100 * 1000);
+
+}  // namespace
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/containers/string_pool_trigram_index.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "perfetto/ext/base/string_view.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+class StringPoolTrigramIndexTest : public testing::Test {
+ protected:
+  std::vector<StringPool::Id> Candidates(
+      const std::vector<base::StringView>& literals) {
+    std::optional<std::vector<StringPool::Id>> res =
+        index_.FindCandidates(literals);
+    PERFETTO_CHECK(res);
+    return *res;
+  }
+
+  StringPool pool_;
+  StringPoolTrigramIndex index_{&pool_};
+};
+
+TEST_F(StringPoolTrigramIndexTest, Empty) {
+  index_.Update();
+  ASSERT_THAT(Candidates({"binder"}), IsEmpty());
+}
+
+TEST_F(StringPoolTrigramIndexTest, ShortLiterals) {
+  pool_.InternString("binder transaction");
+  index_.Update();
+  ASSERT_EQ(index_.FindCandidates({}), std::nullopt);
+  ASSERT_EQ(index_.FindCandidates({"bi", "", "er"}), std::nullopt);
+}
+
+TEST_F(StringPoolTrigramIndexTest, Candidates) {
+  StringPool::Id a = pool_.InternString("binder transaction");
+  StringPool::Id b = pool_.InternString("binder reply");
+  StringPool::Id c = pool_.InternString("Choreographer#doFrame");
+  StringPool::Id d = pool_.InternString("bin der");
+  index_.Update();
+
+  ASSERT_THAT(Candidates({"binder"}), ElementsAre(a, b));
+  ASSERT_THAT(Candidates({"binder", "reply"}), ElementsAre(b));
+  ASSERT_THAT(Candidates({"der"}), ElementsAre(a, b, d));
+  ASSERT_THAT(Candidates({"bin", "der"}), ElementsAre(a, b, d));
+  ASSERT_THAT(Candidates({"Frame", "ab"}), ElementsAre(c));
+  ASSERT_THAT(Candidates({"frame"}), IsEmpty());
+}
+
+TEST_F(StringPoolTrigramIndexTest, Incremental) {
+  StringPool::Id a = pool_.InternString("binder transaction");
+  index_.Update();
+  ASSERT_THAT(Candidates({"binder"}), ElementsAre(a));
+
+  // Strings added after |Update| are not visible until the next call.
+  StringPool::Id b = pool_.InternString("binder reply");
+  ASSERT_THAT(Candidates({"binder"}), ElementsAre(a));
+
+  index_.Update();
+  ASSERT_THAT(Candidates({"binder"}), ElementsAre(a, b));
+
+  // Calling |Update| again without any new strings is a no-op.
+  index_.Update();
+  ASSERT_THAT(Candidates({"binder"}), ElementsAre(a, b));
+}
+
+TEST_F(StringPoolTrigramIndexTest, LongStrings) {
+  std::string long_str(StringPoolTrigramIndex::kMaxIndexedStringSize + 1, 'x');
+  StringPool::Id a = pool_.InternString("binder transaction");
+  StringPool::Id b = pool_.InternString(base::StringView(long_str));
+  index_.Update();
+
+  // Long strings are always candidates.
+  ASSERT_THAT(Candidates({"binder"}), ElementsAre(a, b));
+  ASSERT_THAT(Candidates({"abc"}), ElementsAre(b));
+}
+
+TEST_F(StringPoolTrigramIndexTest, MatchesBruteForce) {
+  // Enough strings to span several blocks of the pool, indexed in a few
+  // batches to check that indexing resumes correctly across blocks.
+  std::minstd_rand0 rnd(0);
+  std::vector<std::pair<StringPool::Id, std::string>> strings;
+  for (uint32_t batch = 0; batch < 4; ++batch) {
+    for (uint32_t i = 0; i < 40000; ++i) {
+      std::string str;
+      size_t len = rnd() % 64;
+      for (size_t j = 0; j < len; ++j) {
+        str.push_back(static_cast<char>('a' + rnd() % 4));
+      }
+      str += std::to_string(i);
+      StringPool::Id id = pool_.InternString(base::StringView(str));
+      if (strings.empty() || strings.back().first < id) {
+        strings.emplace_back(id, str);
+      }
+    }
+    index_.Update();
+  }
+  ASSERT_GT(pool_.MaxSmallStringId().block_index(), 0u);
+
+  for (const char* literal : {"abcd", "dddd", "cab", "a12", "99", "abcabca"}) {
+    std::vector<StringPool::Id> expected;
+    for (const auto& [id, str] : strings) {
+      if (str.find(literal) != std::string::npos) {
+        expected.push_back(id);
+      }
+    }
+    std::vector<StringPool::Id> candidates;
+    if (auto res = index_.FindCandidates({literal}); res) {
+      candidates = *res;
+    } else {
+      continue;
+    }
+    // All the matching strings must be candidates.
+    ASSERT_TRUE(std::includes(candidates.begin(), candidates.end(),
+                              expected.begin(), expected.end()))
+        << literal;
+  }
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor
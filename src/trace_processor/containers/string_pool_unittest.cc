@@ -21,10 +21,17 @@
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <optional>
 #include <random>
+#include <string>
+
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/temp_file.h"
 
 #include "perfetto/ext/base/string_view.h"
+#include "src/base/test/status_matchers.h"
 #include "src/trace_processor/containers/null_term_string_view.h"
+#include "src/trace_processor/core/util/snapshot.h"
 #include "test/gtest_and_gmock.h"
 
 namespace perfetto::trace_processor {
@@ -186,5 +193,34 @@ TEST_F(StringPoolTest, MaxSmallStringIdOnBlockBoundary) {
   ASSERT_EQ(max_id.block_offset(), 0u);
 }
 
+TEST_F(StringPoolTest, SnapshotRoundTrip) {
+  StringPool::Id foo = pool_.InternString("foo");
+  StringPool::Id bar = pool_.InternString("bar");
+  StringPool::Id large = pool_.InternString(
+      base::StringView(std::string(kMinLargeStringSizeBytes, 'x')));
+
+  base::TempFile file = base::TempFile::Create();
+  core::SnapshotWriter writer(base::OpenFile(file.path(), O_WRONLY));
+  pool_.SerializeToSnapshot(&writer);
+  ASSERT_OK(writer.Finish());
+
+  std::string contents;
+  ASSERT_TRUE(base::ReadFile(file.path(), &contents));
+  auto reader = core::SnapshotReader::Create(
+      reinterpret_cast<const uint8_t*>(contents.data()), contents.size());
+  ASSERT_OK(reader);
+
+  StringPool loaded;
+  ASSERT_OK(loaded.LoadFromSnapshot(&*reader));
+  ASSERT_TRUE(reader->AtEnd());
+  ASSERT_EQ(loaded.Get(foo), "foo");
+  ASSERT_EQ(loaded.Get(bar), "bar");
+  ASSERT_EQ(loaded.Get(large).size(), kMinLargeStringSizeBytes);
+  ASSERT_EQ(loaded.InternString("foo"), foo);
+  ASSERT_EQ(loaded.InternString("bar"), bar);
+  ASSERT_EQ(loaded.GetId("baz"), std::nullopt);
+  ASSERT_NE(loaded.InternString("baz"), foo);
+}
+
 }  // namespace
 }  // namespace perfetto::trace_processor
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_CORE_COMMON_AGGREGATE_TYPES_H_
+#define SRC_TRACE_PROCESSOR_CORE_COMMON_AGGREGATE_TYPES_H_
+
+#include "src/trace_processor/core/util/type_set.h"
+
+namespace perfetto::trace_processor::core {
+
+// Counts the rows in each group. When applied to a column, only the non-null
+// cells are counted.
+struct Count {};
+
+// Sums the non-null cells of a column in each group. The result is null for
+// groups where all the cells are null.
+struct Sum {};
+
+// Finds the smallest non-null cell of a column in each group. The result is
+// null for groups where all the cells are null.
+struct Min {};
+
+// Finds the largest non-null cell of a column in each group. The result is
+// null for groups where all the cells are null.
+struct Max {};
+
+// TypeSet of all possible aggregation operations.
+using AggregateOp = core::TypeSet<Count, Sum, Min, Max>;
+
+}  // namespace perfetto::trace_processor::core
+
+#endif  // SRC_TRACE_PROCESSOR_CORE_COMMON_AGGREGATE_TYPES_H_
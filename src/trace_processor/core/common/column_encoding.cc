@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/core/common/column_encoding.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/ext/base/flat_hash_map.h"
+#include "src/trace_processor/core/common/storage_types.h"
+#include "src/trace_processor/core/util/bit_packed_vector.h"
+#include "src/trace_processor/core/util/flex_vector.h"
+
+namespace perfetto::trace_processor::core {
+
+namespace {
+
+// Returns the number of bytes needed to bit pack `size` values of `width`
+// bits.
+size_t PackedBytes(uint32_t size, uint32_t width) {
+  return (uint64_t(size) * width + 7) / 8;
+}
+
+uint64_t Distance(int64_t from, int64_t to) {
+  return static_cast<uint64_t>(to) - static_cast<uint64_t>(from);
+}
+
+}  // namespace
+
+std::optional<EncodedColumn> EncodedColumn::EncodeImpl(StorageType type,
+                                                       const int64_t* data,
+                                                       uint32_t size,
+                                                       size_t raw_size_bytes) {
+  if (size == 0) {
+    return std::nullopt;
+  }
+
+  // Frame of reference: always possible.
+  auto [min_it, max_it] = std::minmax_element(data, data + size);
+  uint32_t packed_width =
+      BitPackedVector::BitWidthFor(Distance(*min_it, *max_it));
+  Kind best_kind = Kind::kBitPacked;
+  size_t best_bytes = PackedBytes(size, packed_width);
+
+  // Frame of reference per block: only worth trying if the values are not
+  // already narrow.
+  uint32_t block_count = (size + kBlockSize - 1) / kBlockSize;
+  FlexVector<int64_t> block_mins;
+  uint32_t block_width = 0;
+  if (packed_width > 8) {
+    block_mins = FlexVector<int64_t>::CreateWithSize(block_count);
+    for (uint32_t b = 0; b < block_count; ++b) {
+      const int64_t* begin = data + b * kBlockSize;
+      const int64_t* end = data + std::min((b + 1) * kBlockSize, size);
+      auto [block_min, block_max] = std::minmax_element(begin, end);
+      block_mins[b] = *block_min;
+      uint64_t range = Distance(*block_min, *block_max);
+      block_width = std::max(block_width, BitPackedVector::BitWidthFor(range));
+    }
+    size_t bytes =
+        PackedBytes(size, block_width) + block_count * sizeof(int64_t);
+    if (bytes < best_bytes) {
+      best_kind = Kind::kBlockBitPacked;
+      best_bytes = bytes;
+    }
+  }
+
+  // Dictionary: only worth trying if the values are not already narrow and
+  // abandoned as soon as there are too many distinct values.
+  base::FlatHashMap<int64_t, uint32_t> codes;
+  bool dictionary_possible = packed_width > 8;
+  for (uint32_t i = 0; dictionary_possible && i < size; ++i) {
+    codes.Insert(data[i], 0);
+    dictionary_possible = codes.size() <= kMaxDictionarySize;
+  }
+  uint32_t dictionary_width = 0;
+  if (dictionary_possible) {
+    dictionary_width =
+        BitPackedVector::BitWidthFor(static_cast<uint64_t>(codes.size() - 1));
+    size_t bytes =
+        PackedBytes(size, dictionary_width) + codes.size() * sizeof(int64_t);
+    if (bytes < best_bytes) {
+      best_kind = Kind::kDictionary;
+      best_bytes = bytes;
+    }
+  }
+
+  if (best_bytes * 4 > raw_size_bytes * 3) {
+    return std::nullopt;
+  }
+
+  EncodedColumn col(type, best_kind);
+  switch (best_kind) {
+    case Kind::kBitPacked: {
+      col.base_ = static_cast<uint64_t>(*min_it);
+      col.codes_ = BitPackedVector(packed_width, size);
+      for (uint32_t i = 0; i < size; ++i) {
+        col.codes_.Set(i, Distance(*min_it, data[i]));
+      }
+      break;
+    }
+    case Kind::kBlockBitPacked: {
+      col.bases_ = std::move(block_mins);
+      col.codes_ = BitPackedVector(block_width, size);
+      for (uint32_t i = 0; i < size; ++i) {
+        col.codes_.Set(i, Distance(col.bases_[i / kBlockSize], data[i]));
+      }
+      break;
+    }
+    case Kind::kDictionary: {
+      col.dictionary_ = FlexVector<int64_t>::CreateWithCapacity(codes.size());
+      for (auto it = codes.GetIterator(); it; ++it) {
+        col.dictionary_.push_back(it.key());
+      }
+      std::sort(col.dictionary_.begin(), col.dictionary_.end());
+      for (uint32_t i = 0; i < col.dictionary_.size(); ++i) {
+        *codes.Find(col.dictionary_[i]) = i;
+      }
+      col.codes_ = BitPackedVector(dictionary_width, size);
+      for (uint32_t i = 0; i < size; ++i) {
+        col.codes_.Set(i, *codes.Find(data[i]));
+      }
+      break;
+    }
+  }
+  return col;
+}
+
+void EncodedColumn::DecodeBlock(uint32_t begin,
+                                uint32_t count,
+                                int64_t* out) const {
+  PERFETTO_DCHECK(count <= kDecodeBlockSize);
+  uint64_t codes[kDecodeBlockSize];
+  codes_.Unpack(begin, count, codes);
+  switch (kind_) {
+    case Kind::kBitPacked:
+      for (uint32_t i = 0; i < count; ++i) {
+        out[i] = static_cast<int64_t>(base_ + codes[i]);
+      }
+      return;
+    case Kind::kBlockBitPacked:
+      for (uint32_t i = 0; i < count; ++i) {
+        auto base = static_cast<uint64_t>(bases_[(begin + i) / kBlockSize]);
+        out[i] = static_cast<int64_t>(base + codes[i]);
+      }
+      return;
+    case Kind::kDictionary:
+      for (uint32_t i = 0; i < count; ++i) {
+        out[i] = dictionary_[codes[i]];
+      }
+      return;
+  }
+  PERFETTO_FATAL("For GCC");
+}
+
+}  // namespace perfetto::trace_processor::core
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_CORE_COMMON_COLUMN_ENCODING_H_
+#define SRC_TRACE_PROCESSOR_CORE_COMMON_COLUMN_ENCODING_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/public/compiler.h"
+#include "src/trace_processor/core/common/storage_types.h"
+#include "src/trace_processor/core/util/bit_packed_vector.h"
+#include "src/trace_processor/core/util/flex_vector.h"
+
+namespace perfetto::trace_processor::core {
+
+// A compressed, read-only representation of the storage of an integer
+// (Uint32, Int32 or Int64) column.
+//
+// Values are stored as bit packed "codes" which are turned back into values
+// using one of the encodings below. The encoding is chosen per column by
+// `Encode()` based on which one uses the least memory.
+//
+// Individual values can be decoded in O(1) with `Get()`; `Decode()` decodes a
+// range of values in blocks and should be preferred when reading many values.
+class EncodedColumn {
+ public:
+  enum class Kind : uint8_t {
+    // Frame of reference + bit packing: each value is stored as its
+    // difference from the smallest value in the column. Works well for
+    // columns with a small range of values (e.g. cpu, utid, track_id).
+    kBitPacked,
+
+    // Like kBitPacked but with a separate reference value for each block of
+    // `kBlockSize` rows. Works well for columns whose values are large but
+    // close to their neighbours: for sorted columns (e.g. ts) this amounts to
+    // delta encoding.
+    kBlockBitPacked,
+
+    // Each value is stored as an index into a sorted dictionary of the
+    // distinct values of the column. Works well for columns with few, but
+    // widely spread, distinct values.
+    kDictionary,
+  };
+
+  // Number of rows sharing a reference value with `kBlockBitPacked`.
+  static constexpr uint32_t kBlockSize = 128;
+
+  // Maximum number of distinct values for the `kDictionary` encoding.
+  static constexpr uint32_t kMaxDictionarySize = 1u << 16;
+
+  // Encodes `data` using the encoding which uses the least memory.
+  //
+  // Returns std::nullopt if no encoding is at least 25% smaller than `data`:
+  // decoding has a cost so it's not worth it for small gains.
+  template <typename T>
+  static std::optional<EncodedColumn> Encode(const FlexVector<T>& data);
+
+  // Returns the value at index `i`.
+  PERFETTO_ALWAYS_INLINE int64_t Get(uint32_t i) const {
+    uint64_t code = codes_.Get(i);
+    switch (kind_) {
+      case Kind::kBitPacked:
+        return static_cast<int64_t>(base_ + code);
+      case Kind::kBlockBitPacked:
+        return static_cast<int64_t>(
+            static_cast<uint64_t>(bases_[i / kBlockSize]) + code);
+      case Kind::kDictionary:
+        return dictionary_[code];
+    }
+    PERFETTO_FATAL("For GCC");
+  }
+
+  // Writes the `count` values starting at index `begin` to `out`, converted
+  // to `T` (which should be the C++ type of `type()`).
+  template <typename T>
+  void Decode(uint32_t begin, uint32_t count, T* out) const {
+    int64_t buffer[kDecodeBlockSize];
+    for (uint32_t i = 0; i < count; i += kDecodeBlockSize) {
+      uint32_t n = std::min(kDecodeBlockSize, count - i);
+      DecodeBlock(begin + i, n, buffer);
+      for (uint32_t j = 0; j < n; ++j) {
+        out[i + j] = static_cast<T>(buffer[j]);
+      }
+    }
+  }
+
+  // Returns the type of the column which was encoded.
+  StorageType type() const { return type_; }
+
+  // Returns the encoding used by the column.
+  Kind kind() const { return kind_; }
+
+  // Returns the number of values in the column.
+  uint32_t size() const { return codes_.size(); }
+
+  // Returns the number of bytes of memory used by the encoded column.
+  size_t size_bytes() const {
+    return codes_.size_bytes() + bases_.size() * sizeof(int64_t) +
+           dictionary_.size() * sizeof(int64_t);
+  }
+
+ private:
+  static constexpr uint32_t kDecodeBlockSize = 1024;
+
+  EncodedColumn(StorageType type, Kind kind) : type_(type), kind_(kind) {}
+
+  static std::optional<EncodedColumn> EncodeImpl(StorageType type,
+                                                 const int64_t* data,
+                                                 uint32_t size,
+                                                 size_t raw_size_bytes);
+
+  // Decodes `count` (<= kDecodeBlockSize) values starting at `begin`.
+  void DecodeBlock(uint32_t begin, uint32_t count, int64_t* out) const;
+
+  StorageType type_;
+  Kind kind_;
+  BitPackedVector codes_;
+
+  // kBitPacked: the smallest value in the column (as unsigned so that adding
+  // codes wraps around instead of overflowing).
+  uint64_t base_ = 0;
+
+  // kBlockBitPacked: the smallest value of each block.
+  FlexVector<int64_t> bases_;
+
+  // kDictionary: the distinct values of the column, sorted.
+  FlexVector<int64_t> dictionary_;
+};
+
+template <typename T>
+std::optional<EncodedColumn> EncodedColumn::Encode(const FlexVector<T>& data) {
+  static_assert(std::is_same_v<T, uint32_t> || std::is_same_v<T, int32_t> ||
+                    std::is_same_v<T, int64_t>,
+                "Only integer columns can be encoded");
+  using S = std::conditional_t<
+      std::is_same_v<T, uint32_t>, Uint32,
+      std::conditional_t<std::is_same_v<T, int32_t>, Int32, Int64>>;
+  auto size = static_cast<uint32_t>(data.size());
+  if constexpr (std::is_same_v<T, int64_t>) {
+    return EncodeImpl(S{}, data.data(), size, size * sizeof(T));
+  } else {
+    auto widened = FlexVector<int64_t>::CreateWithSize(size);
+    for (uint32_t i = 0; i < size; ++i) {
+      widened[i] = data[i];
+    }
+    return EncodeImpl(S{}, widened.data(), size, size * sizeof(T));
+  }
+}
+
+}  // namespace perfetto::trace_processor::core
+
+#endif  // SRC_TRACE_PROCESSOR_CORE_COMMON_COLUMN_ENCODING_H_
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/core/common/column_encoding.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "src/trace_processor/core/util/flex_vector.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor::core {
+namespace {
+
+template <typename T>
+FlexVector<T> ToFlexVector(const std::vector<T>& values) {
+  auto vec = FlexVector<T>::CreateWithCapacity(values.size());
+  for (T v : values) {
+    vec.push_back(v);
+  }
+  return vec;
+}
+
+template <typename T>
+void VerifyRoundTrip(const EncodedColumn& encoded,
+                     const std::vector<T>& values) {
+  ASSERT_EQ(encoded.size(), values.size());
+  for (uint32_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQ(static_cast<T>(encoded.Get(i)), values[i]) << i;
+  }
+  std::vector<T> decoded(values.size());
+  encoded.Decode(0, static_cast<uint32_t>(values.size()), decoded.data());
+  ASSERT_EQ(decoded, values);
+
+  // Unaligned range crossing decode blocks.
+  if (values.size() > 1500) {
+    std::vector<T> partial(1300);
+    encoded.Decode(101, 1300, partial.data());
+    ASSERT_TRUE(std::equal(partial.begin(), partial.end(),
+                           values.begin() + 101));
+  }
+}
+
+TEST(EncodedColumnTest, SmallRangeIsBitPacked) {
+  std::vector<uint32_t> values;
+  for (uint32_t i = 0; i < 5000; ++i) {
+    values.push_back(1000 + (i * 7) % 13);
+  }
+  auto encoded = EncodedColumn::Encode(ToFlexVector(values));
+  ASSERT_TRUE(encoded);
+  ASSERT_EQ(encoded->kind(), EncodedColumn::Kind::kBitPacked);
+  ASSERT_TRUE(encoded->type().Is<Uint32>());
+  ASSERT_LT(encoded->size_bytes(), values.size() * sizeof(uint32_t) / 4);
+  VerifyRoundTrip(*encoded, values);
+}
+
+TEST(EncodedColumnTest, SortedIsBlockBitPacked) {
+  std::minstd_rand rnd(42);
+  std::vector<int64_t> values;
+  int64_t ts = 1700000000000000000l;
+  for (uint32_t i = 0; i < 5000; ++i) {
+    ts += rnd() % 100000;
+    values.push_back(ts);
+  }
+  auto encoded = EncodedColumn::Encode(ToFlexVector(values));
+  ASSERT_TRUE(encoded);
+  ASSERT_EQ(encoded->kind(), EncodedColumn::Kind::kBlockBitPacked);
+  ASSERT_LT(encoded->size_bytes(), values.size() * sizeof(int64_t) / 2);
+  VerifyRoundTrip(*encoded, values);
+}
+
+TEST(EncodedColumnTest, FewSpreadValuesUseDictionary) {
+  std::minstd_rand rnd(42);
+  std::vector<int64_t> values;
+  for (uint32_t i = 0; i < 5000; ++i) {
+    values.push_back(rnd() % 4 == 0 ? std::numeric_limits<int64_t>::min()
+                                    : std::numeric_limits<int64_t>::max() -
+                                          static_cast<int64_t>(rnd() % 3));
+  }
+  auto encoded = EncodedColumn::Encode(ToFlexVector(values));
+  ASSERT_TRUE(encoded);
+  ASSERT_EQ(encoded->kind(), EncodedColumn::Kind::kDictionary);
+  VerifyRoundTrip(*encoded, values);
+}
+
+TEST(EncodedColumnTest, NegativeValues) {
+  std::vector<int32_t> values;
+  for (int32_t i = 0; i < 3000; ++i) {
+    values.push_back(-1000 + i % 17);
+  }
+  auto encoded = EncodedColumn::Encode(ToFlexVector(values));
+  ASSERT_TRUE(encoded);
+  ASSERT_TRUE(encoded->type().Is<Int32>());
+  VerifyRoundTrip(*encoded, values);
+}
+
+TEST(EncodedColumnTest, IncompressibleReturnsNullopt) {
+  std::mt19937_64 rnd(42);
+  std::vector<int64_t> values;
+  for (uint32_t i = 0; i < 5000; ++i) {
+    values.push_back(static_cast<int64_t>(rnd()));
+  }
+  ASSERT_FALSE(EncodedColumn::Encode(ToFlexVector(values)));
+  ASSERT_FALSE(EncodedColumn::Encode(FlexVector<int64_t>()));
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor::core
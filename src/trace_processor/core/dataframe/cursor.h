@@ -67,12 +67,22 @@ class Cursor {
     interpreter_.Initialize(plan.bytecode, plan.params.register_count, pool);
     params_ = plan.params;
     col_to_output_offset_ = plan.col_to_output_offset;
+    aggregate_registers_ = plan.aggregate_registers;
     pool_ = pool;
 
     column_storage_data_ptrs_.clear();
     column_storage_data_ptrs_.reserve(column_count);
+    column_encodings_.clear();
+    column_encodings_.reserve(column_count);
     for (uint32_t i = 0; i < column_count; ++i) {
-      column_storage_data_ptrs_.push_back(column_ptrs[i]->storage.data());
+      const Storage& storage = column_ptrs[i]->storage;
+      if (storage.is_encoded()) {
+        column_storage_data_ptrs_.emplace_back();
+        column_encodings_.push_back(&storage.encoded());
+      } else {
+        column_storage_data_ptrs_.push_back(storage.data());
+        column_encodings_.push_back(nullptr);
+      }
     }
 
     // Process register initialization specs from the plan.
@@ -84,6 +94,20 @@ class Cursor {
     }
   }
 
+  // Sets the pool used to filter large numbers of rows in parallel when
+  // executing the query. The results are identical to executing the query on
+  // the calling thread (which is what happens if this is never called).
+  void SetThreadPool(base::ThreadPool* pool) {
+    interpreter_.SetThreadPool(pool);
+  }
+
+  // Sets the trigram index over the dataframe's string pool used to speed up
+  // glob filters. The results are identical to executing the query without
+  // the index (which is what happens if this is never called).
+  void SetStringPoolTrigramIndex(StringPoolTrigramIndex* index) {
+    interpreter_.SetStringPoolTrigramIndex(index);
+  }
+
   // Executes the query and prepares the cursor for iteration.
   // This initializes the cursor's position to the first row of results.
   //
@@ -104,6 +128,33 @@ class Cursor {
   // Returns true if the cursor has reached the end of the result set.
   PERFETTO_ALWAYS_INLINE bool Eof() const { return pos_ == end_; }
 
+  // Returns the value of the |agg|-th aggregation of the group at the current
+  // cursor position. Only valid for plans returned by `PlanAggregateQuery`.
+  template <typename CellCallbackImpl>
+  PERFETTO_ALWAYS_INLINE void AggregateCell(
+      uint32_t agg,
+      CellCallbackImpl& cell_callback_impl) {
+    static_assert(std::is_base_of_v<CellCallback, CellCallbackImpl>,
+                  "CellCallbackImpl must be a subclass of CellCallback");
+    const auto& values = GetAggregateValues(agg);
+    auto group = static_cast<uint32_t>(pos_ - begin_) / params_.output_per_row;
+    if (values.has_value.size() > 0 && !values.has_value[group]) {
+      cell_callback_impl.OnCell(nullptr);
+      return;
+    }
+    if (values.doubles.size() > 0) {
+      cell_callback_impl.OnCell(values.doubles[group]);
+    } else {
+      cell_callback_impl.OnCell(values.ints[group]);
+    }
+  }
+
+  // Returns true if computing the |agg|-th aggregation overflowed the range of
+  // int64 for any group. Only valid for plans returned by `PlanAggregateQuery`.
+  bool AggregateOverflowed(uint32_t agg) {
+    return GetAggregateValues(agg).overflowed;
+  }
+
   // Returns the value of the column at the current cursor position.
   // The visitor pattern allows type-safe access to heterogeneous column types.
   //
@@ -124,6 +175,10 @@ class Cursor {
       cell_callback_impl.OnCell(nullptr);
       return;
     }
+    if (PERFETTO_UNLIKELY(column_encodings_[col])) {
+      EncodedCell(*column_encodings_[col], idx, cell_callback_impl);
+      return;
+    }
     switch (p.index()) {
       case StorageType::GetTypeIndex<Id>():
         cell_callback_impl.OnCell(idx);
@@ -150,6 +205,50 @@ class Cursor {
   }
 
  private:
+  template <typename CellCallbackImpl>
+  PERFETTO_NO_INLINE static void EncodedCell(
+      const EncodedColumn& encoded,
+      uint32_t idx,
+      CellCallbackImpl& cell_callback_impl) {
+    int64_t value = encoded.Get(idx);
+    switch (encoded.type().index()) {
+      case StorageType::GetTypeIndex<Uint32>():
+        cell_callback_impl.OnCell(static_cast<uint32_t>(value));
+        break;
+      case StorageType::GetTypeIndex<Int32>():
+        cell_callback_impl.OnCell(static_cast<int32_t>(value));
+        break;
+      case StorageType::GetTypeIndex<Int64>():
+        cell_callback_impl.OnCell(value);
+        break;
+      default:
+        PERFETTO_FATAL("Invalid encoded storage type");
+    }
+  }
+
+  // Returns the register value for the storage of integer column `col`. For
+  // encoded columns, the interpreter reads the encoded values directly and
+  // only decodes them if a bytecode needs contiguous storage.
+  template <typename T>
+  static interpreter::StoragePtr GetIntegerStoragePtr(
+      const Column* const* column_ptrs,
+      uint32_t col) {
+    const Storage& storage = column_ptrs[col]->storage;
+    if (storage.is_encoded()) {
+      return interpreter::StoragePtr{nullptr, T{}, &storage.encoded()};
+    }
+    return interpreter::StoragePtr{storage.unchecked_data<T>(), T{}};
+  }
+
+  const interpreter::AggregateValues& GetAggregateValues(uint32_t agg) {
+    PERFETTO_DCHECK(agg < aggregate_registers_.size());
+    const auto* values = interpreter_.GetRegisterValue(
+        interpreter::ReadHandle<interpreter::AggregateValues>{
+            aggregate_registers_[agg]});
+    PERFETTO_DCHECK(values);
+    return *values;
+  }
+
   interpreter::RegValue GetRegisterInitValue(const RegisterInit& init,
                                              const Column* const* column_ptrs,
                                              const Index* indexes) {
@@ -159,20 +258,11 @@ class Cursor {
         // Return a nullptr StoragePtr which the interpreter knows to handle.
         return interpreter::StoragePtr{nullptr, Id{}};
       case RegisterInit::Type::GetTypeIndex<Uint32>():
-        return interpreter::StoragePtr{
-            column_ptrs[init.source_index]->storage.unchecked_data<Uint32>(),
-            Uint32{},
-        };
+        return GetIntegerStoragePtr<Uint32>(column_ptrs, init.source_index);
       case RegisterInit::Type::GetTypeIndex<Int32>():
-        return interpreter::StoragePtr{
-            column_ptrs[init.source_index]->storage.unchecked_data<Int32>(),
-            Int32{},
-        };
+        return GetIntegerStoragePtr<Int32>(column_ptrs, init.source_index);
       case RegisterInit::Type::GetTypeIndex<Int64>():
-        return interpreter::StoragePtr{
-            column_ptrs[init.source_index]->storage.unchecked_data<Int64>(),
-            Int64{},
-        };
+        return GetIntegerStoragePtr<Int64>(column_ptrs, init.source_index);
       case RegisterInit::Type::GetTypeIndex<Double>():
         return interpreter::StoragePtr{
             column_ptrs[init.source_index]->storage.unchecked_data<Double>(),
@@ -209,6 +299,17 @@ class Cursor {
             sve.prefix_popcount.data(),
             sve.prefix_popcount.data() + sve.prefix_popcount.size());
       }
+      case RegisterInit::Type::GetTypeIndex<RegisterInit::ZoneMapBounds>(): {
+        const auto& zone_map =
+            column_ptrs[init.source_index]
+                ->specialized_storage
+                .unchecked_get<SpecializedStorage::ZoneMap>();
+        return interpreter::StoragePtr{
+            std::visit([](auto ptr) -> const void* { return ptr; },
+                       zone_map.bounds.data()),
+            zone_map.bounds.type(),
+        };
+      }
       default:
         PERFETTO_FATAL("Unhandled RegisterInit kind: %u",
                        static_cast<uint32_t>(init.kind.index()));
@@ -221,11 +322,17 @@ class Cursor {
   QueryPlanImpl::ExecutionParams params_;
   // Maps column indices to their output offsets in the result set.
   base::SmallVector<uint32_t, 24> col_to_output_offset_;
+  // Registers holding the results of the aggregations, if any.
+  base::SmallVector<uint32_t, 4> aggregate_registers_;
   // Variant of pointers to the storage data.
   std::vector<Storage::DataPointer> column_storage_data_ptrs_;
+  // For encoded columns, the encoded storage.
+  std::vector<const EncodedColumn*> column_encodings_;
   // String pool for string values.
   const StringPool* pool_;
 
+  // Start of the result set.
+  const uint32_t* begin_;
   // Current position in the result set.
   const uint32_t* pos_;
   // End position in the result set.
@@ -34,6 +34,7 @@ void Cursor<FilterValueFetcherImpl>::Execute(
 
   const auto& span =
       *interpreter_.template GetRegisterValue<S>(params_.output_register);
+  begin_ = span.b;
   pos_ = span.b;
   end_ = span.e;
 }
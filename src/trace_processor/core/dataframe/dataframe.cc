@@ -16,24 +16,249 @@
 
 #include "src/trace_processor/core/dataframe/dataframe.h"
 
+#include <algorithm>
 #include <cstddef>
+#include <cinttypes>
 #include <cstdint>
+#include <limits>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 #include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
 #include "perfetto/ext/base/status_macros.h"
 #include "perfetto/ext/base/status_or.h"
 #include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/common/column_encoding.h"
 #include "src/trace_processor/core/dataframe/query_plan.h"
 #include "src/trace_processor/core/dataframe/specs.h"
 #include "src/trace_processor/core/dataframe/typed_cursor.h"
 #include "src/trace_processor/core/dataframe/types.h"
 #include "src/trace_processor/core/interpreter/bytecode_to_string.h"
+#include "src/trace_processor/core/util/bit_vector.h"
+#include "src/trace_processor/core/util/flex_vector.h"
+#include "src/trace_processor/core/util/slab.h"
+#include "src/trace_processor/core/util/snapshot.h"
 
 namespace perfetto::trace_processor::core::dataframe {
+namespace {
+
+// Returns `count` rounded up to the capacity granularity of FlexVector.
+uint64_t PaddedCount(uint64_t count) {
+  constexpr uint64_t kMultiple = FlexVector<uint32_t>::kCapacityMultiple;
+  return (count + kMultiple - 1) / kMultiple * kMultiple;
+}
+
+template <typename T>
+void WriteFlexVector(SnapshotWriter* writer, const FlexVector<T>& vec) {
+  writer->WriteU64(vec.size());
+  writer->WriteArray(vec.data(), vec.size(), PaddedCount(vec.size()));
+}
+
+template <typename T>
+base::StatusOr<FlexVector<T>> ReadFlexVector(SnapshotReader* reader) {
+  ASSIGN_OR_RETURN(uint64_t size, reader->ReadU64());
+  // Nothing in a dataframe can be larger than this (row indices are 32-bit):
+  // this also prevents overflows when computing the padded size.
+  if (size > std::numeric_limits<uint32_t>::max()) {
+    return base::ErrStatus("Snapshot: invalid vector size %" PRIu64, size);
+  }
+  uint64_t capacity = PaddedCount(size);
+  ASSIGN_OR_RETURN(const T* data, reader->ReadArray<T>(capacity));
+  return FlexVector<T>::CreateUnowned(data, size, capacity);
+}
+
+void WriteBitVector(SnapshotWriter* writer, const BitVector& bv) {
+  writer->WriteU64(bv.size());
+  WriteFlexVector(writer, bv.words());
+}
+
+base::StatusOr<BitVector> ReadBitVector(SnapshotReader* reader) {
+  ASSIGN_OR_RETURN(uint64_t size, reader->ReadU64());
+  ASSIGN_OR_RETURN(FlexVector<uint64_t> words,
+                   ReadFlexVector<uint64_t>(reader));
+  if (words.size() != (size + 63u) / 64u) {
+    return base::ErrStatus("Snapshot: invalid bitvector");
+  }
+  return BitVector::CreateUnowned(std::move(words), size);
+}
+
+// Returns the number of set bits in `bv`. The lookups into the storage of a
+// nullable column count the set bits of whole words so bits past the end of
+// `bv` must not be set.
+base::StatusOr<uint64_t> CountSetBits(const BitVector& bv) {
+  const FlexVector<uint64_t>& words = bv.words();
+  if (bv.size() % 64u != 0 && !words.empty() &&
+      (words[words.size() - 1] >> (bv.size() % 64u)) != 0) {
+    return base::ErrStatus("Snapshot: invalid bitvector");
+  }
+  uint64_t count = 0;
+  for (uint64_t word : words) {
+    count += static_cast<uint64_t>(PERFETTO_POPCOUNT(word));
+  }
+  return count;
+}
+
+// Checks that `prefix_popcount` is the prefix popcount of `bv` (see
+// BitVector::PrefixPopcount()).
+base::Status CheckPrefixPopcount(const BitVector& bv,
+                                 const uint32_t* prefix_popcount,
+                                 uint64_t size) {
+  const FlexVector<uint64_t>& words = bv.words();
+  if (size != words.size()) {
+    return base::ErrStatus("Snapshot: invalid prefix popcount");
+  }
+  uint32_t accum = 0;
+  for (uint64_t i = 0; i < size; ++i) {
+    if (prefix_popcount[i] != accum) {
+      return base::ErrStatus("Snapshot: invalid prefix popcount");
+    }
+    accum += static_cast<uint32_t>(PERFETTO_POPCOUNT(words[i]));
+  }
+  return base::OkStatus();
+}
+
+// Returns the number of values in the plain (i.e. not encoded) `storage`.
+uint64_t StorageSize(const Storage& storage) {
+  switch (storage.type().index()) {
+    case StorageType::GetTypeIndex<Id>():
+      return storage.unchecked_get<Id>().size;
+    case StorageType::GetTypeIndex<Uint32>():
+      return storage.unchecked_get<Uint32>().size();
+    case StorageType::GetTypeIndex<Int32>():
+      return storage.unchecked_get<Int32>().size();
+    case StorageType::GetTypeIndex<Int64>():
+      return storage.unchecked_get<Int64>().size();
+    case StorageType::GetTypeIndex<Double>():
+      return storage.unchecked_get<Double>().size();
+    case StorageType::GetTypeIndex<String>():
+      return storage.unchecked_get<String>().size();
+    default:
+      PERFETTO_FATAL("Invalid storage type");
+  }
+}
+
+template <typename T>
+base::Status ReadStorage(SnapshotReader* reader, Storage* storage) {
+  using C = typename T::cpp_type;
+  ASSIGN_OR_RETURN(storage->unchecked_get<T>(), ReadFlexVector<C>(reader));
+  return base::OkStatus();
+}
+
+template <typename T>
+FlexVector<T> ComputeZoneMapBounds(const FlexVector<T>& data) {
+  using ZoneMap = SpecializedStorage::ZoneMap;
+  auto size = static_cast<uint32_t>(data.size());
+  uint32_t blocks = (size + ZoneMap::kBlockSize - 1) / ZoneMap::kBlockSize;
+  auto bounds = FlexVector<T>::CreateWithSize(blocks * 2);
+  for (uint32_t b = 0; b < blocks; ++b) {
+    const T* it = data.data() + b * ZoneMap::kBlockSize;
+    const T* end = data.data() + std::min(size, (b + 1) * ZoneMap::kBlockSize);
+    // Note: std::min and std::max ignore NaNs here as they always compare
+    // false; this is fine as NaNs never match any filter either.
+    T min = std::numeric_limits<T>::max();
+    T max = std::numeric_limits<T>::lowest();
+    for (; it != end; ++it) {
+      min = std::min(min, *it);
+      max = std::max(max, *it);
+    }
+    bounds[2 * b] = min;
+    bounds[2 * b + 1] = max;
+  }
+  return bounds;
+}
+
+// Returns the zone map for `column` if one should be built for it.
+std::optional<SpecializedStorage::ZoneMap> MaybeBuildZoneMap(
+    const Column& column,
+    uint32_t row_count) {
+  using ZoneMap = SpecializedStorage::ZoneMap;
+  // With only a couple of blocks, scanning is as fast as pruning.
+  if (row_count < 2 * ZoneMap::kBlockSize ||
+      !column.sort_state.Is<Unsorted>() ||
+      !column.specialized_storage.Is<std::monostate>()) {
+    return std::nullopt;
+  }
+  const Nullability& nullability = column.null_storage.nullability();
+  if (!nullability.Is<NonNull>() && !nullability.Is<DenseNull>()) {
+    return std::nullopt;
+  }
+  const Storage& storage = column.storage;
+  switch (storage.type().index()) {
+    case StorageType::GetTypeIndex<Uint32>():
+      return ZoneMap{
+          Storage(ComputeZoneMapBounds(storage.unchecked_get<Uint32>()))};
+    case StorageType::GetTypeIndex<Int32>():
+      return ZoneMap{
+          Storage(ComputeZoneMapBounds(storage.unchecked_get<Int32>()))};
+    case StorageType::GetTypeIndex<Int64>():
+      return ZoneMap{
+          Storage(ComputeZoneMapBounds(storage.unchecked_get<Int64>()))};
+    case StorageType::GetTypeIndex<Double>():
+      return ZoneMap{
+          Storage(ComputeZoneMapBounds(storage.unchecked_get<Double>()))};
+    default:
+      return std::nullopt;
+  }
+}
+
+void WriteZoneMap(SnapshotWriter* writer,
+                  const SpecializedStorage::ZoneMap& zone_map) {
+  const Storage& bounds = zone_map.bounds;
+  switch (bounds.type().index()) {
+    case StorageType::GetTypeIndex<Uint32>():
+      WriteFlexVector(writer, bounds.unchecked_get<Uint32>());
+      break;
+    case StorageType::GetTypeIndex<Int32>():
+      WriteFlexVector(writer, bounds.unchecked_get<Int32>());
+      break;
+    case StorageType::GetTypeIndex<Int64>():
+      WriteFlexVector(writer, bounds.unchecked_get<Int64>());
+      break;
+    case StorageType::GetTypeIndex<Double>():
+      WriteFlexVector(writer, bounds.unchecked_get<Double>());
+      break;
+    default:
+      PERFETTO_FATAL("Invalid zone map type");
+  }
+}
+
+template <typename T>
+base::StatusOr<SpecializedStorage::ZoneMap> ReadZoneMapBounds(
+    SnapshotReader* reader,
+    uint32_t row_count) {
+  using ZoneMap = SpecializedStorage::ZoneMap;
+  using C = typename T::cpp_type;
+  ASSIGN_OR_RETURN(FlexVector<C> bounds, ReadFlexVector<C>(reader));
+  uint32_t blocks = (row_count + ZoneMap::kBlockSize - 1) / ZoneMap::kBlockSize;
+  if (bounds.size() != uint64_t(blocks) * 2) {
+    return base::ErrStatus("Snapshot: invalid zone map");
+  }
+  return ZoneMap{Storage(std::move(bounds))};
+}
+
+base::StatusOr<SpecializedStorage::ZoneMap> ReadZoneMap(SnapshotReader* reader,
+                                                        StorageType type,
+                                                        uint32_t row_count) {
+  switch (type.index()) {
+    case StorageType::GetTypeIndex<Uint32>():
+      return ReadZoneMapBounds<Uint32>(reader, row_count);
+    case StorageType::GetTypeIndex<Int32>():
+      return ReadZoneMapBounds<Int32>(reader, row_count);
+    case StorageType::GetTypeIndex<Int64>():
+      return ReadZoneMapBounds<Int64>(reader, row_count);
+    case StorageType::GetTypeIndex<Double>():
+      return ReadZoneMapBounds<Double>(reader, row_count);
+    default:
+      return base::ErrStatus("Snapshot: invalid zone map");
+  }
+}
+
+}  // namespace
 
 Dataframe::Dataframe(StringPool* string_pool,
                      uint32_t column_count,
@@ -77,6 +302,17 @@ base::StatusOr<Dataframe::QueryPlan> Dataframe::PlanQuery(
   return QueryPlan(std::move(plan));
 }
 
+base::StatusOr<Dataframe::QueryPlan> Dataframe::PlanAggregateQuery(
+    std::vector<FilterSpec>& filter_specs,
+    const std::vector<GroupBySpec>& group_by_specs,
+    const std::vector<AggregateSpec>& aggregate_specs,
+    uint64_t cols_used) const {
+  ASSIGN_OR_RETURN(auto plan, QueryPlanBuilder::BuildAggregate(
+                                  row_count_, columns_, indexes_, filter_specs,
+                                  group_by_specs, aggregate_specs, cols_used));
+  return QueryPlan(std::move(plan));
+}
+
 void Dataframe::Clear() {
   PERFETTO_DCHECK(!finalized_);
   for (const auto& c : columns_) {
@@ -213,6 +449,9 @@ void Dataframe::Finalize() {
       default:
         PERFETTO_FATAL("Invalid nullability type");
     }
+    if (auto zone_map = MaybeBuildZoneMap(*c, row_count_); zone_map) {
+      c->specialized_storage = SpecializedStorage(*std::move(zone_map));
+    }
   }
   // Bump the mutation counter so that any cursors with cached pointers
   // know to refresh them: shrink_to_fit() may have reallocated the internal
@@ -220,6 +459,47 @@ void Dataframe::Finalize() {
   ++non_column_mutations_;
 }
 
+size_t Dataframe::EncodeColumns() {
+  PERFETTO_CHECK(finalized_);
+  size_t saved = 0;
+  for (const auto& c : columns_) {
+    if (c->storage.is_encoded()) {
+      continue;
+    }
+    std::optional<EncodedColumn> encoded;
+    size_t raw_size_bytes = 0;
+    switch (c->storage.type().index()) {
+      case StorageType::GetTypeIndex<Uint32>(): {
+        const auto& data = c->storage.unchecked_get<Uint32>();
+        encoded = EncodedColumn::Encode(data);
+        raw_size_bytes = data.size() * sizeof(uint32_t);
+        break;
+      }
+      case StorageType::GetTypeIndex<Int32>(): {
+        const auto& data = c->storage.unchecked_get<Int32>();
+        encoded = EncodedColumn::Encode(data);
+        raw_size_bytes = data.size() * sizeof(int32_t);
+        break;
+      }
+      case StorageType::GetTypeIndex<Int64>(): {
+        const auto& data = c->storage.unchecked_get<Int64>();
+        encoded = EncodedColumn::Encode(data);
+        raw_size_bytes = data.size() * sizeof(int64_t);
+        break;
+      }
+      default:
+        break;
+    }
+    if (!encoded || encoded->size_bytes() >= raw_size_bytes) {
+      continue;
+    }
+    saved += raw_size_bytes - encoded->size_bytes();
+    c->storage = Storage(*std::move(encoded));
+  }
+  ++non_column_mutations_;
+  return saved;
+}
+
 dataframe::Dataframe Dataframe::CopyFinalized() const {
   PERFETTO_CHECK(finalized_);
   return *this;
@@ -236,6 +516,256 @@ DataframeSpec Dataframe::CreateSpec() const {
   return spec;
 }
 
+void Dataframe::SerializeToSnapshot(SnapshotWriter* writer) const {
+  PERFETTO_CHECK(finalized_);
+
+  // The schema is written first so that it can be checked against the schema
+  // of the dataframe the snapshot is loaded into.
+  writer->WriteU32(static_cast<uint32_t>(columns_.size()));
+  for (uint32_t i = 0; i < columns_.size(); ++i) {
+    const Column& c = *columns_[i];
+    writer->WriteString(column_names_[i]);
+    writer->WriteU32(c.storage.type().index());
+    writer->WriteU32(c.null_storage.nullability().index());
+    writer->WriteU32(c.sort_state.index());
+    writer->WriteU32(c.duplicate_state.index());
+  }
+  writer->WriteU32(row_count_);
+
+  for (const auto& c : columns_) {
+    // Snapshots always contain the plain representation of the columns.
+    std::optional<Storage> decoded;
+    if (c->storage.is_encoded()) {
+      decoded = c->storage.Decode();
+    }
+    const Storage& storage = decoded ? *decoded : c->storage;
+    switch (storage.type().index()) {
+      case StorageType::GetTypeIndex<Id>():
+        writer->WriteU64(storage.unchecked_get<Id>().size);
+        break;
+      case StorageType::GetTypeIndex<Uint32>():
+        WriteFlexVector(writer, storage.unchecked_get<Uint32>());
+        break;
+      case StorageType::GetTypeIndex<Int32>():
+        WriteFlexVector(writer, storage.unchecked_get<Int32>());
+        break;
+      case StorageType::GetTypeIndex<Int64>():
+        WriteFlexVector(writer, storage.unchecked_get<Int64>());
+        break;
+      case StorageType::GetTypeIndex<Double>():
+        WriteFlexVector(writer, storage.unchecked_get<Double>());
+        break;
+      case StorageType::GetTypeIndex<String>():
+        WriteFlexVector(writer, storage.unchecked_get<String>());
+        break;
+      default:
+        PERFETTO_FATAL("Invalid storage type");
+    }
+    switch (c->null_storage.nullability().index()) {
+      case Nullability::GetTypeIndex<NonNull>():
+        break;
+      case Nullability::GetTypeIndex<SparseNull>():
+      case Nullability::GetTypeIndex<SparseNullWithPopcountUntilFinalization>():
+      case Nullability::GetTypeIndex<SparseNullWithPopcountAlways>(): {
+        const auto& null = c->null_storage.unchecked_get<SparseNull>();
+        WriteBitVector(writer, null.bit_vector);
+        WriteFlexVector(writer, null.prefix_popcount_for_cell_get);
+        break;
+      }
+      case Nullability::GetTypeIndex<DenseNull>():
+        WriteBitVector(writer,
+                       c->null_storage.unchecked_get<DenseNull>().bit_vector);
+        break;
+      default:
+        PERFETTO_FATAL("Invalid nullability type");
+    }
+    using SmallValueEq = SpecializedStorage::SmallValueEq;
+    using ZoneMap = SpecializedStorage::ZoneMap;
+    if (c->specialized_storage.Is<SmallValueEq>()) {
+      const auto& sve = c->specialized_storage.unchecked_get<SmallValueEq>();
+      writer->WriteU32(1);
+      WriteBitVector(writer, sve.bit_vector);
+      writer->WriteU64(sve.prefix_popcount.size());
+      writer->WriteArray(sve.prefix_popcount.data(),
+                         sve.prefix_popcount.size(),
+                         sve.prefix_popcount.size());
+    } else if (c->specialized_storage.Is<ZoneMap>()) {
+      writer->WriteU32(2);
+      WriteZoneMap(writer, c->specialized_storage.unchecked_get<ZoneMap>());
+    } else {
+      writer->WriteU32(0);
+    }
+  }
+
+  writer->WriteU32(static_cast<uint32_t>(indexes_.size()));
+  for (const Index& index : indexes_) {
+    writer->WriteU32(static_cast<uint32_t>(index.columns().size()));
+    for (uint32_t col : index.columns()) {
+      writer->WriteU32(col);
+    }
+    const std::vector<uint32_t>& pv = *index.permutation_vector();
+    writer->WriteU64(pv.size());
+    writer->WriteArray(pv.data(), pv.size(), pv.size());
+  }
+}
+
+base::Status Dataframe::LoadFromSnapshot(SnapshotReader* reader) {
+  PERFETTO_CHECK(!finalized_);
+
+  ASSIGN_OR_RETURN(uint32_t column_count, reader->ReadU32());
+  if (column_count != columns_.size()) {
+    return base::ErrStatus(
+        "Snapshot: column count mismatch (%u in snapshot, expected %zu)",
+        column_count, columns_.size());
+  }
+  for (uint32_t i = 0; i < column_count; ++i) {
+    const Column& c = *columns_[i];
+    ASSIGN_OR_RETURN(std::string_view name, reader->ReadString());
+    ASSIGN_OR_RETURN(uint32_t type, reader->ReadU32());
+    ASSIGN_OR_RETURN(uint32_t nullability, reader->ReadU32());
+    ASSIGN_OR_RETURN(uint32_t sort_state, reader->ReadU32());
+    ASSIGN_OR_RETURN(uint32_t duplicate_state, reader->ReadU32());
+    if (name != column_names_[i] || type != c.storage.type().index() ||
+        nullability != c.null_storage.nullability().index() ||
+        sort_state != c.sort_state.index() ||
+        duplicate_state != c.duplicate_state.index()) {
+      return base::ErrStatus("Snapshot: schema mismatch for column '%s'",
+                             column_names_[i].c_str());
+    }
+  }
+  ASSIGN_OR_RETURN(uint32_t row_count, reader->ReadU32());
+
+  for (uint32_t i = 0; i < column_count; ++i) {
+    const std::shared_ptr<Column>& c = columns_[i];
+    Storage& storage = c->storage;
+    switch (storage.type().index()) {
+      case StorageType::GetTypeIndex<Id>(): {
+        ASSIGN_OR_RETURN(uint64_t size, reader->ReadU64());
+        if (size != row_count) {
+          return base::ErrStatus("Snapshot: invalid id column size");
+        }
+        storage.unchecked_get<Id>().size = row_count;
+        break;
+      }
+      case StorageType::GetTypeIndex<Uint32>():
+        RETURN_IF_ERROR(ReadStorage<Uint32>(reader, &storage));
+        break;
+      case StorageType::GetTypeIndex<Int32>():
+        RETURN_IF_ERROR(ReadStorage<Int32>(reader, &storage));
+        break;
+      case StorageType::GetTypeIndex<Int64>():
+        RETURN_IF_ERROR(ReadStorage<Int64>(reader, &storage));
+        break;
+      case StorageType::GetTypeIndex<Double>():
+        RETURN_IF_ERROR(ReadStorage<Double>(reader, &storage));
+        break;
+      case StorageType::GetTypeIndex<String>():
+        RETURN_IF_ERROR(ReadStorage<String>(reader, &storage));
+        break;
+      default:
+        PERFETTO_FATAL("Invalid storage type");
+    }
+    // Sparse null columns only store the non-null values, all the others
+    // store one value per row.
+    uint64_t storage_size = row_count;
+    switch (c->null_storage.nullability().index()) {
+      case Nullability::GetTypeIndex<NonNull>():
+        break;
+      case Nullability::GetTypeIndex<SparseNull>():
+      case Nullability::GetTypeIndex<SparseNullWithPopcountUntilFinalization>():
+      case Nullability::GetTypeIndex<SparseNullWithPopcountAlways>(): {
+        auto& null = c->null_storage.unchecked_get<SparseNull>();
+        ASSIGN_OR_RETURN(null.bit_vector, ReadBitVector(reader));
+        ASSIGN_OR_RETURN(null.prefix_popcount_for_cell_get,
+                         ReadFlexVector<uint32_t>(reader));
+        if (null.bit_vector.size() != row_count) {
+          return base::ErrStatus("Snapshot: invalid null bitvector size");
+        }
+        ASSIGN_OR_RETURN(storage_size, CountSetBits(null.bit_vector));
+        // Only columns which keep the prefix popcount after finalization
+        // have one in the snapshot.
+        if (!null.prefix_popcount_for_cell_get.empty() ||
+            c->null_storage.nullability().Is<SparseNullWithPopcountAlways>()) {
+          RETURN_IF_ERROR(CheckPrefixPopcount(
+              null.bit_vector, null.prefix_popcount_for_cell_get.data(),
+              null.prefix_popcount_for_cell_get.size()));
+        }
+        break;
+      }
+      case Nullability::GetTypeIndex<DenseNull>(): {
+        auto& null = c->null_storage.unchecked_get<DenseNull>();
+        ASSIGN_OR_RETURN(null.bit_vector, ReadBitVector(reader));
+        if (null.bit_vector.size() != row_count) {
+          return base::ErrStatus("Snapshot: invalid null bitvector size");
+        }
+        break;
+      }
+      default:
+        PERFETTO_FATAL("Invalid nullability type");
+    }
+    if (StorageSize(storage) != storage_size) {
+      return base::ErrStatus(
+          "Snapshot: invalid size for column '%s' (%" PRIu64
+          " values, expected %" PRIu64 ")",
+          column_names_[i].c_str(), StorageSize(storage), storage_size);
+    }
+    ASSIGN_OR_RETURN(uint32_t specialized, reader->ReadU32());
+    if (specialized == 1) {
+      SpecializedStorage::SmallValueEq sve;
+      ASSIGN_OR_RETURN(sve.bit_vector, ReadBitVector(reader));
+      ASSIGN_OR_RETURN(uint64_t size, reader->ReadU64());
+      ASSIGN_OR_RETURN(const uint32_t* data, reader->ReadArray<uint32_t>(size));
+      RETURN_IF_ERROR(CountSetBits(sve.bit_vector).status());
+      RETURN_IF_ERROR(CheckPrefixPopcount(sve.bit_vector, data, size));
+      sve.prefix_popcount = Slab<uint32_t>::Unowned(data, size);
+      c->specialized_storage = SpecializedStorage(std::move(sve));
+    } else if (specialized == 2) {
+      ASSIGN_OR_RETURN(SpecializedStorage::ZoneMap zone_map,
+                       ReadZoneMap(reader, c->storage.type(), row_count));
+      c->specialized_storage = SpecializedStorage(std::move(zone_map));
+    } else if (specialized != 0) {
+      return base::ErrStatus("Snapshot: invalid specialized storage");
+    }
+    ++c->mutations;
+  }
+
+  ASSIGN_OR_RETURN(uint32_t index_count, reader->ReadU32());
+  std::vector<Index> indexes;
+  for (uint32_t i = 0; i < index_count; ++i) {
+    ASSIGN_OR_RETURN(uint32_t index_column_count, reader->ReadU32());
+    std::vector<uint32_t> cols;
+    for (uint32_t j = 0; j < index_column_count; ++j) {
+      ASSIGN_OR_RETURN(uint32_t col, reader->ReadU32());
+      if (col >= column_count) {
+        return base::ErrStatus("Snapshot: invalid index column");
+      }
+      cols.push_back(col);
+    }
+    ASSIGN_OR_RETURN(uint64_t size, reader->ReadU64());
+    if (size != row_count) {
+      return base::ErrStatus("Snapshot: invalid index size");
+    }
+    ASSIGN_OR_RETURN(const uint32_t* data, reader->ReadArray<uint32_t>(size));
+    if (std::any_of(data, data + size,
+                    [row_count](uint32_t row) { return row >= row_count; })) {
+      return base::ErrStatus("Snapshot: invalid index row");
+    }
+    indexes.emplace_back(std::move(cols),
+                         std::make_shared<std::vector<uint32_t>>(
+                             data, data + static_cast<size_t>(size)));
+  }
+
+  row_count_ = row_count;
+  indexes_ = std::move(indexes);
+
+  // Note: Finalize() is deliberately not called as it would copy all the
+  // column data out of the snapshot memory to shrink it. The snapshot was
+  // written from a finalized dataframe so there is nothing left to do.
+  finalized_ = true;
+  ++non_column_mutations_;
+  return base::OkStatus();
+}
+
 std::vector<std::shared_ptr<Column>> Dataframe::CreateColumnVector(
     const ColumnSpec* column_specs,
     uint32_t column_count) {
@@ -29,6 +29,7 @@
 #include <vector>
 
 #include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
 #include "perfetto/ext/base/status_or.h"
 #include "perfetto/public/compiler.h"
 #include "src/trace_processor/containers/string_pool.h"
@@ -37,6 +38,11 @@
 #include "src/trace_processor/core/dataframe/types.h"
 #include "src/trace_processor/core/util/bit_vector.h"
 
+namespace perfetto::trace_processor::core {
+class SnapshotReader;
+class SnapshotWriter;
+}  // namespace perfetto::trace_processor::core
+
 namespace perfetto::trace_processor::core::dataframe {
 
 struct QueryPlanImpl;
@@ -152,6 +158,31 @@ class Dataframe {
       const LimitSpec& limit_spec,
       uint64_t cols_used_bitmap) const;
 
+  // Creates an execution plan which filters the dataframe and then computes
+  // aggregations over groups of rows with equal values in the group by
+  // columns.
+  //
+  // The cursor for the plan returns one row per group: `Cursor::Cell` returns
+  // the values of the group by columns (and any other column in
+  // `cols_used_bitmap`, taken from the first row of the group) while
+  // `Cursor::AggregateCell` returns the value of the i-th aggregation. Groups
+  // are returned in no particular order.
+  //
+  // Parameters:
+  //   filter_specs:     Filter predicates to apply before grouping.
+  //   group_by_specs:   Columns to group rows by. Must not be empty.
+  //   aggregate_specs:  Aggregations to compute for each group.
+  //   cols_used_bitmap: Bitmap where each bit corresponds to a column that may
+  //                     be requested. Only columns with set bits can be
+  //                     fetched.
+  // Returns:
+  //   A StatusOr containing the QueryPlan or an error status.
+  base::StatusOr<QueryPlan> PlanAggregateQuery(
+      std::vector<FilterSpec>& filter_specs,
+      const std::vector<GroupBySpec>& group_by_specs,
+      const std::vector<AggregateSpec>& aggregate_specs,
+      uint64_t cols_used_bitmap) const;
+
   // Prepares a cursor for executing the query plan. The template parameter
   // `FilterValueFetcherImpl` is a subclass of `ValueFetcher` that defines the
   // logic for fetching filter values for each filter specs specified when
@@ -233,6 +264,17 @@ class Dataframe {
   // If the dataframe is already finalized, this function does nothing.
   void Finalize();
 
+  // Replaces the storage of integer columns with a compressed `EncodedColumn`
+  // wherever that saves a significant amount of memory (e.g. timestamps or
+  // small ids). Encoded values are decoded transparently when read, at some
+  // CPU cost: equality, range and sorted filters read the encoded values
+  // directly while other operations (e.g. sorting, distinct, IN and
+  // aggregates) decode the column for the lifetime of the cursor.
+  //
+  // The dataframe must be finalized and no cursors must have been created on
+  // it (or any of its copies) yet. Returns the number of bytes saved.
+  size_t EncodeColumns();
+
   // Makes a copy of the dataframe which has been finalized. Unfinalized
   // dataframes *cannot* be copied, so this function will assert if not
   // finalized.
@@ -244,6 +286,22 @@ class Dataframe {
   // Creates a spec object for this dataframe.
   DataframeSpec CreateSpec() const;
 
+  // Writes the contents of this dataframe (column data, null bitvectors,
+  // specialized storage and indexes) to `writer`. The dataframe must be
+  // finalized.
+  void SerializeToSnapshot(SnapshotWriter* writer) const;
+
+  // Replaces the contents of this non-finalized dataframe with the contents
+  // written by `SerializeToSnapshot`. Returns an error if the
+  // snapshot is corrupt (including if the size of any column, null bitvector
+  // or index does not match its row count) or the columns in the snapshot do
+  // not match the columns of this dataframe.
+  //
+  // Column data and null bitvectors are *not* copied: they point directly
+  // into the memory of `reader`, which must outlive this dataframe and all of
+  // its copies. The dataframe is finalized on success.
+  base::Status LoadFromSnapshot(SnapshotReader* reader);
+
   // Returns whether the dataframe has been finalized.
   bool finalized() const { return finalized_; }
 
@@ -253,6 +311,11 @@ class Dataframe {
   // Returns the number of rows in the dataframe.
   uint32_t row_count() const { return row_count_; }
 
+  // Returns a count of the number of non-column mutations (e.g. adding rows,
+  // adding indexes) to the dataframe. Query plans built before this count
+  // changed may no longer be optimal.
+  uint32_t non_column_mutations() const { return non_column_mutations_; }
+
   // Returns the number of columns in the dataframe.
   uint32_t column_count() const {
     return static_cast<uint32_t>(column_ptrs_.size());
@@ -275,7 +338,6 @@ class Dataframe {
     PERFETTO_DCHECK(col < column_ptrs_.size());
 
     const Column& column = *column_ptrs_[col];
-    const Storage::DataPointer data_ptr = column.storage.data();
     const Nullability nullability = column.null_storage.nullability();
 
     // Handle nullability and compute storage index.
@@ -312,7 +374,23 @@ class Dataframe {
       default:
         PERFETTO_FATAL("Unknown null storage type");
     }
+    if (PERFETTO_UNLIKELY(column.storage.is_encoded())) {
+      int64_t value = column.storage.encoded().Get(storage_idx);
+      switch (column.storage.type().index()) {
+        case StorageType::GetTypeIndex<Uint32>():
+          callback.OnCell(static_cast<uint32_t>(value));
+          break;
+        case StorageType::GetTypeIndex<Int32>():
+          callback.OnCell(static_cast<int32_t>(value));
+          break;
+        default:
+          callback.OnCell(value);
+          break;
+      }
+      return;
+    }
     // Dispatch based on storage type.
+    const Storage::DataPointer data_ptr = column.storage.data();
     switch (data_ptr.index()) {
       case StorageType::GetTypeIndex<Id>():
         callback.OnCell(storage_idx);
@@ -374,6 +452,7 @@ class Dataframe {
 
  private:
   friend class AdhocDataframeBuilder;
+  friend class HashJoin;
   friend class TypedCursor;
 
   // TODO(lalitm): remove this once we have a proper static builder for
@@ -518,19 +597,19 @@ class Dataframe {
         std::is_same_v<N, SparseNullWithPopcountAlways>;
     static constexpr bool is_sparse_null_supporting_get_until_finalization =
         std::is_same_v<N, SparseNullWithPopcountUntilFinalization>;
-    const auto& storage = col.storage.unchecked_get<T>();
+    const Storage& storage = col.storage;
     const auto& nulls = col.null_storage.unchecked_get<N>();
     // See kStringNullLegacy above.
     if constexpr (std::is_same_v<N, NonNull>) {
-      auto result = GetCellUncheckedFromStorage(storage, row);
+      auto result = GetCellUncheckedFromStorage<T>(storage, row);
       if constexpr (std::is_same_v<T, String>) {
         PERFETTO_DCHECK(!result.is_null());
       }
       return result;
     } else if constexpr (std::is_same_v<N, DenseNull>) {
-      using Ret = decltype(GetCellUncheckedFromStorage(storage, {}));
+      using Ret = decltype(GetCellUncheckedFromStorage<T>(storage, {}));
       if (nulls.bit_vector.is_set(row)) {
-        auto result = GetCellUncheckedFromStorage(storage, row);
+        auto result = GetCellUncheckedFromStorage<T>(storage, row);
         if constexpr (std::is_same_v<T, String>) {
           PERFETTO_DCHECK(!result.is_null());
         }
@@ -540,12 +619,12 @@ class Dataframe {
     } else if constexpr (is_sparse_null_supporting_get_always ||
                          is_sparse_null_supporting_get_until_finalization) {
       PERFETTO_DCHECK(is_sparse_null_supporting_get_always || !finalized_);
-      using Ret = decltype(GetCellUncheckedFromStorage(storage, {}));
+      using Ret = decltype(GetCellUncheckedFromStorage<T>(storage, {}));
       if (nulls.bit_vector.is_set(row)) {
         auto index = static_cast<uint32_t>(
             nulls.prefix_popcount_for_cell_get[row / 64] +
             nulls.bit_vector.count_set_bits_until_in_word(row));
-        auto result = GetCellUncheckedFromStorage(storage, index);
+        auto result = GetCellUncheckedFromStorage<T>(storage, index);
         if constexpr (std::is_same_v<T, String>) {
           PERFETTO_DCHECK(!result.is_null());
         }
@@ -639,13 +718,22 @@ class Dataframe {
     }
   }
 
-  template <typename C>
-  PERFETTO_ALWAYS_INLINE auto GetCellUncheckedFromStorage(const C& column,
-                                                          uint32_t row) const {
-    if constexpr (std::is_same_v<C, Storage::Id>) {
+  template <typename T>
+  PERFETTO_ALWAYS_INLINE auto GetCellUncheckedFromStorage(
+      const Storage& storage,
+      uint32_t row) const {
+    if constexpr (std::is_same_v<T, Id>) {
       return row;
+    } else if constexpr (std::is_same_v<T, Uint32> ||
+                         std::is_same_v<T, Int32> ||
+                         std::is_same_v<T, Int64>) {
+      using V = std::decay_t<decltype(storage.unchecked_get<T>()[row])>;
+      if (PERFETTO_UNLIKELY(storage.is_encoded())) {
+        return static_cast<V>(storage.encoded().Get(row));
+      }
+      return storage.unchecked_get<T>()[row];
     } else {
-      return column[row];
+      return storage.unchecked_get<T>()[row];
     }
   }
 
@@ -29,9 +29,13 @@
 #include <vector>
 
 #include "perfetto/base/logging.h"
+#include "perfetto/ext/base/file_utils.h"
 #include "perfetto/ext/base/string_utils.h"
+#include "perfetto/ext/base/temp_file.h"
 #include "src/base/test/status_matchers.h"
 #include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/cursor.h"
+#include "src/trace_processor/core/dataframe/cursor_impl.h"  // IWYU pragma: keep
 #include "src/trace_processor/core/dataframe/dataframe_test_utils.h"
 #include "src/trace_processor/core/dataframe/query_plan.h"
 #include "src/trace_processor/core/dataframe/specs.h"
@@ -39,6 +43,8 @@
 #include "src/trace_processor/core/dataframe/types.h"
 #include "src/trace_processor/core/interpreter/bytecode_to_string.h"
 #include "src/trace_processor/core/util/bit_vector.h"
+#include "src/trace_processor/core/util/flex_vector.h"
+#include "src/trace_processor/core/util/snapshot.h"
 #include "src/trace_processor/util/regex.h"
 #include "test/gtest_and_gmock.h"
 
@@ -1658,4 +1664,427 @@ TEST(DataframeTest, SortedFilterWithDuplicatesAndRowCountOfZero) {
   EXPECT_EQ(plan.GetImplForTesting().params.estimated_row_count, 0u);
 }
 
+// Collects the values passed to a CellCallback.
+struct AggregateResultCallback : CellCallback {
+  void OnCell(int64_t v) { value = v; }
+  void OnCell(double v) { value = v; }
+  void OnCell(NullTermStringView v) { value = v.ToStdString(); }
+  void OnCell(std::nullptr_t) { value = std::monostate(); }
+  void OnCell(uint32_t v) { value = int64_t(v); }
+  void OnCell(int32_t v) { value = int64_t(v); }
+
+  std::variant<std::monostate, int64_t, double, std::string> value;
+};
+
+// Returns the same int64 value for every filter.
+struct ConstantInt64Fetcher : ValueFetcher {
+  static const Type kInt64 = 0;
+  static const Type kDouble = 1;
+  static const Type kString = 2;
+  static const Type kNull = 3;
+  int64_t GetInt64Value(uint32_t) const { return value; }
+  static double GetDoubleValue(uint32_t) { PERFETTO_FATAL("Unreachable"); }
+  static const char* GetStringValue(uint32_t) { PERFETTO_FATAL("Unreachable"); }
+  static Type GetValueType(uint32_t) { return kInt64; }
+  static bool IteratorInit(uint32_t) { PERFETTO_FATAL("Unreachable"); }
+  static bool IteratorNext(uint32_t) { PERFETTO_FATAL("Unreachable"); }
+
+  int64_t value;
+};
+
+TEST(DataframeTest, PlanAggregateQuery_HashGroupBy) {
+  static constexpr auto kSpec = CreateTypedDataframeSpec(
+      {"key", "dur", "value"},
+      CreateTypedColumnSpec(String(), NonNull(), Unsorted()),
+      CreateTypedColumnSpec(Int64(), DenseNull(), Unsorted()),
+      CreateTypedColumnSpec(Double(), NonNull(), Unsorted()));
+  StringPool pool;
+  Dataframe df = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+  df.InsertUnchecked(kSpec, pool.InternString("a"), std::make_optional(10l),
+                     1.5);
+  df.InsertUnchecked(kSpec, pool.InternString("b"), std::nullopt, 2.5);
+  df.InsertUnchecked(kSpec, pool.InternString("a"), std::nullopt, -1.0);
+  df.InsertUnchecked(kSpec, pool.InternString("a"), std::make_optional(5l),
+                     4.0);
+  df.Finalize();
+
+  std::vector<FilterSpec> filters;
+  std::vector<AggregateSpec> aggregates = {
+      {std::nullopt, Count{}}, {1, Count{}}, {1, Sum{}},
+      {2, Min{}},              {2, Max{}},
+  };
+  ASSERT_OK_AND_ASSIGN(Dataframe::QueryPlan plan,
+                       df.PlanAggregateQuery(filters, {{0}}, aggregates, 1u));
+
+  Cursor<ErrorValueFetcher> cursor;
+  df.PrepareCursor(plan, cursor);
+  ErrorValueFetcher fetcher;
+  cursor.Execute(fetcher);
+
+  using Row = std::vector<std::variant<std::monostate, int64_t, double,
+                                       std::string>>;
+  std::vector<Row> rows;
+  for (; !cursor.Eof(); cursor.Next()) {
+    Row row;
+    AggregateResultCallback cb;
+    cursor.Cell(0, cb);
+    row.push_back(cb.value);
+    for (uint32_t i = 0; i < aggregates.size(); ++i) {
+      cursor.AggregateCell(i, cb);
+      row.push_back(cb.value);
+    }
+    rows.push_back(std::move(row));
+  }
+  ASSERT_THAT(rows, testing::UnorderedElementsAre(
+                        Row{std::string("a"), int64_t(3), int64_t(2),
+                            int64_t(15), -1.0, 4.0},
+                        Row{std::string("b"), int64_t(1), int64_t(0),
+                            std::monostate(), 2.5, 2.5}));
+  ASSERT_FALSE(cursor.AggregateOverflowed(2));
+}
+
+TEST(DataframeTest, PlanAggregateQuery_SortedGroupByWithFilter) {
+  static constexpr auto kSpec = CreateTypedDataframeSpec(
+      {"ts", "value"},
+      CreateTypedColumnSpec(Int64(), NonNull(), Sorted(), HasDuplicates()),
+      CreateTypedColumnSpec(Uint32(), NonNull(), Unsorted()));
+  StringPool pool;
+  Dataframe df = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+  df.InsertUnchecked(kSpec, int64_t{1}, 10u);
+  df.InsertUnchecked(kSpec, int64_t{1}, 20u);
+  df.InsertUnchecked(kSpec, int64_t{2}, 30u);
+  df.InsertUnchecked(kSpec, int64_t{3}, 40u);
+  df.InsertUnchecked(kSpec, int64_t{3}, 50u);
+  df.Finalize();
+
+  std::vector<FilterSpec> filters = {{1, 0, Gt{}, {}}};
+  std::vector<AggregateSpec> aggregates = {{1, Sum{}}};
+  ASSERT_OK_AND_ASSIGN(Dataframe::QueryPlan plan,
+                       df.PlanAggregateQuery(filters, {{0}}, aggregates, 1u));
+
+  // The serialized plan should preserve the aggregate registers.
+  plan = Dataframe::QueryPlan::Deserialize(plan.Serialize());
+  bool has_sorted_group_by = false;
+  for (const auto& bc : plan.GetImplForTesting().bytecode) {
+    has_sorted_group_by |= interpreter::ToString(bc).find("SortedGroupBy") == 0;
+  }
+  ASSERT_TRUE(has_sorted_group_by);
+  ASSERT_EQ(plan.GetImplForTesting().aggregate_registers.size(), 1u);
+
+  Cursor<ConstantInt64Fetcher> cursor;
+  df.PrepareCursor(plan, cursor);
+  ConstantInt64Fetcher fetcher{{}, 15};
+  cursor.Execute(fetcher);
+
+  std::vector<std::pair<int64_t, int64_t>> rows;
+  for (; !cursor.Eof(); cursor.Next()) {
+    AggregateResultCallback key;
+    AggregateResultCallback sum;
+    cursor.Cell(0, key);
+    cursor.AggregateCell(0, sum);
+    rows.emplace_back(std::get<int64_t>(key.value),
+                      std::get<int64_t>(sum.value));
+  }
+  ASSERT_THAT(rows, testing::ElementsAre(std::make_pair(1, 20), std::make_pair(2, 30),
+                                std::make_pair(3, 90)));
+}
+
+TEST(DataframeTest, PlanAggregateQuery_SumOnStringIsError) {
+  static constexpr auto kSpec = CreateTypedDataframeSpec(
+      {"name"}, CreateTypedColumnSpec(String(), NonNull(), Unsorted()));
+  StringPool pool;
+  Dataframe df = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+  df.Finalize();
+
+  std::vector<FilterSpec> filters;
+  ASSERT_FALSE(df.PlanAggregateQuery(filters, {{0}}, {{0, Sum{}}}, 1u).ok());
+  ASSERT_FALSE(df.PlanAggregateQuery(filters, {}, {{0, Count{}}}, 1u).ok());
+}
+
+TEST(DataframeTest, SnapshotRoundTrip) {
+  static constexpr auto kSpec = CreateTypedDataframeSpec(
+      {"id", "col2", "col3", "col4"},
+      CreateTypedColumnSpec(Id(), NonNull(), IdSorted()),
+      CreateTypedColumnSpec(Uint32(), NonNull(), Unsorted()),
+      CreateTypedColumnSpec(Int64(), DenseNull(), Unsorted()),
+      CreateTypedColumnSpec(String(), SparseNull(), Unsorted()));
+  StringPool pool;
+  Dataframe df = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+  df.InsertUnchecked(kSpec, std::monostate(), 10u, std::make_optional(0l),
+                     std::make_optional(pool.InternString("foo")));
+  df.InsertUnchecked(kSpec, std::monostate(), 20u, std::nullopt, std::nullopt);
+  df.InsertUnchecked(kSpec, std::monostate(), 30u, std::make_optional(5l),
+                     std::make_optional(pool.InternString("bar")));
+  df.Finalize();
+
+  base::TempFile file = base::TempFile::Create();
+  SnapshotWriter writer(base::OpenFile(file.path(), O_WRONLY));
+  df.SerializeToSnapshot(&writer);
+  ASSERT_OK(writer.Finish());
+
+  std::string contents;
+  ASSERT_TRUE(base::ReadFile(file.path(), &contents));
+  auto reader = SnapshotReader::Create(
+      reinterpret_cast<const uint8_t*>(contents.data()), contents.size());
+  ASSERT_OK(reader);
+
+  Dataframe loaded = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+  ASSERT_OK(loaded.LoadFromSnapshot(&*reader));
+  ASSERT_TRUE(reader->AtEnd());
+  ASSERT_TRUE(loaded.finalized());
+  VerifyData(loaded, 0b1111,
+             Rows(Row(0u, 10u, int64_t(0l), "foo"),
+                  Row(1u, 20u, nullptr, nullptr),
+                  Row(2u, 30u, int64_t(5l), "bar")));
+}
+
+TEST(DataframeTest, SnapshotSchemaMismatch) {
+  static constexpr auto kSpec = CreateTypedDataframeSpec(
+      {"col"}, CreateTypedColumnSpec(Uint32(), NonNull(), Unsorted()));
+  static constexpr auto kOtherSpec = CreateTypedDataframeSpec(
+      {"col"}, CreateTypedColumnSpec(Int64(), NonNull(), Unsorted()));
+  StringPool pool;
+  Dataframe df = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+  df.InsertUnchecked(kSpec, 10u);
+  df.Finalize();
+
+  base::TempFile file = base::TempFile::Create();
+  SnapshotWriter writer(base::OpenFile(file.path(), O_WRONLY));
+  df.SerializeToSnapshot(&writer);
+  ASSERT_OK(writer.Finish());
+
+  std::string contents;
+  ASSERT_TRUE(base::ReadFile(file.path(), &contents));
+  auto reader = SnapshotReader::Create(
+      reinterpret_cast<const uint8_t*>(contents.data()), contents.size());
+  ASSERT_OK(reader);
+
+  Dataframe loaded = Dataframe::CreateFromTypedSpec(kOtherSpec, &pool);
+  ASSERT_FALSE(loaded.LoadFromSnapshot(&*reader).ok());
+}
+
+TEST(DataframeTest, SnapshotCorrupt) {
+  static constexpr auto kSpec = CreateTypedDataframeSpec(
+      {"a", "b"}, CreateTypedColumnSpec(Uint32(), NonNull(), Unsorted()),
+      CreateTypedColumnSpec(Uint32(), SparseNull(), Unsorted()));
+  StringPool pool;
+
+  // Writes a snapshot by hand, with an index on "a", so that its contents can
+  // be inconsistent with its row count, and loads it.
+  auto load = [&](uint32_t row_count, const std::vector<uint32_t>& a,
+                  uint64_t b_non_null, const std::vector<uint32_t>& b,
+                  const std::vector<uint32_t>& permutation) {
+    base::TempFile file = base::TempFile::Create();
+    SnapshotWriter writer(base::OpenFile(file.path(), O_WRONLY));
+    DataframeSpec spec = Dataframe::CreateFromTypedSpec(kSpec, &pool)
+                             .CreateSpec();
+    writer.WriteU32(static_cast<uint32_t>(spec.column_specs.size()));
+    for (uint32_t i = 0; i < spec.column_specs.size(); ++i) {
+      const ColumnSpec& c = spec.column_specs[i];
+      writer.WriteString(spec.column_names[i]);
+      writer.WriteU32(c.type.index());
+      writer.WriteU32(c.nullability.index());
+      writer.WriteU32(c.sort_state.index());
+      writer.WriteU32(c.duplicate_state.index());
+    }
+    writer.WriteU32(row_count);
+    auto write_vector = [&writer](const auto& v) {
+      constexpr size_t kMultiple = FlexVector<uint32_t>::kCapacityMultiple;
+      writer.WriteU64(v.size());
+      writer.WriteArray(v.data(), v.size(),
+                        (v.size() + kMultiple - 1) / kMultiple * kMultiple);
+    };
+    write_vector(a);
+    writer.WriteU32(0);
+    write_vector(b);
+    writer.WriteU64(row_count);
+    write_vector(std::vector<uint64_t>{b_non_null});
+    write_vector(std::vector<uint32_t>());
+    writer.WriteU32(0);
+    writer.WriteU32(1);
+    writer.WriteU32(1);
+    writer.WriteU32(0);
+    writer.WriteU64(permutation.size());
+    writer.WriteArray(permutation.data(), permutation.size(),
+                      permutation.size());
+    PERFETTO_CHECK(writer.Finish().ok());
+
+    std::string contents;
+    PERFETTO_CHECK(base::ReadFile(file.path(), &contents));
+    auto reader = SnapshotReader::Create(
+        reinterpret_cast<const uint8_t*>(contents.data()), contents.size());
+    PERFETTO_CHECK(reader.ok());
+    Dataframe loaded = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+    base::Status status = loaded.LoadFromSnapshot(&*reader);
+    if (status.ok()) {
+      VerifyData(loaded, 0b11,
+                 Rows(Row(1u, 7u), Row(2u, nullptr), Row(3u, 8u)));
+    }
+    return status;
+  };
+
+  ASSERT_OK(load(3, {1, 2, 3}, 0b101, {7, 8}, {2, 0, 1}));
+  // Storage shorter or longer than the row count.
+  ASSERT_FALSE(load(3, {1, 2}, 0b101, {7, 8}, {2, 0, 1}).ok());
+  ASSERT_FALSE(load(3, {1, 2, 3, 4}, 0b101, {7, 8}, {2, 0, 1}).ok());
+  // Sparse storage not matching the number of non-null rows.
+  ASSERT_FALSE(load(3, {1, 2, 3}, 0b111, {7, 8}, {2, 0, 1}).ok());
+  // Non-null rows past the end of the null bitvector.
+  ASSERT_FALSE(load(3, {1, 2, 3}, 0b1101, {7, 8, 9}, {2, 0, 1}).ok());
+  // Index permutation of the wrong size or pointing past the last row.
+  ASSERT_FALSE(load(3, {1, 2, 3}, 0b101, {7, 8}, {2, 0}).ok());
+  ASSERT_FALSE(load(3, {1, 2, 3}, 0b101, {7, 8}, {2, 0, 3}).ok());
+}
+
+TEST(DataframeTest, ZoneMapFilter) {
+  static constexpr auto kSpec = CreateTypedDataframeSpec(
+      {"id", "ts"}, CreateTypedColumnSpec(Id(), NonNull(), IdSorted()),
+      CreateTypedColumnSpec(Int64(), NonNull(), Unsorted()));
+  static constexpr uint32_t kBlockSize =
+      SpecializedStorage::ZoneMap::kBlockSize;
+  StringPool pool;
+  Dataframe df = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+  // Values are unsorted inside each block but clustered across blocks.
+  for (uint32_t i = 0; i < 3 * kBlockSize; ++i) {
+    df.InsertUnchecked(kSpec, std::monostate(),
+                       int64_t((i / kBlockSize) * 1000 + (i * 7) % 11));
+  }
+  df.Finalize();
+
+  auto uses_zone_map = [](const Dataframe& d) {
+    std::vector<FilterSpec> filters = {FilterSpec{1, 0, Ge{}, {}}};
+    auto plan = d.PlanQuery(filters, {}, {}, {}, 0b11);
+    PERFETTO_CHECK(plan.ok());
+    for (const auto& bc : plan->GetImplForTesting().bytecode) {
+      if (interpreter::ToString(bc).find("ZoneMapFilter") !=
+          std::string::npos) {
+        return true;
+      }
+    }
+    return false;
+  };
+  ASSERT_TRUE(uses_zone_map(df));
+
+  auto count_rows = [&](FilterSpec spec, int64_t value,
+                        bool (*matches)(int64_t, int64_t)) {
+    TypedCursor cursor(&df, {spec}, {});
+    cursor.SetFilterValueUnchecked(0, value);
+    cursor.ExecuteUnchecked();
+    uint32_t count = 0;
+    for (; !cursor.Eof(); cursor.Next(), ++count) {
+      EXPECT_TRUE(matches(cursor.GetCellUnchecked<1>(kSpec), value));
+    }
+    return count;
+  };
+  ASSERT_EQ(count_rows(FilterSpec{1, 0, Ge{}, {}}, 2000,
+                       [](int64_t v, int64_t x) { return v >= x; }),
+            kBlockSize);
+  ASSERT_EQ(count_rows(FilterSpec{1, 0, Lt{}, {}}, 1000,
+                       [](int64_t v, int64_t x) { return v < x; }),
+            kBlockSize);
+  ASSERT_EQ(count_rows(FilterSpec{1, 0, Gt{}, {}}, 5000,
+                       [](int64_t, int64_t) { return false; }),
+            0u);
+
+  uint32_t expected_eq = 0;
+  for (uint32_t i = kBlockSize; i < 2 * kBlockSize; ++i) {
+    expected_eq += (i * 7) % 11 == 3;
+  }
+  ASSERT_EQ(count_rows(FilterSpec{1, 0, Eq{}, {}}, 1003,
+                       [](int64_t v, int64_t x) { return v == x; }),
+            expected_eq);
+
+  // Zone maps survive a snapshot round trip.
+  base::TempFile file = base::TempFile::Create();
+  SnapshotWriter writer(base::OpenFile(file.path(), O_WRONLY));
+  df.SerializeToSnapshot(&writer);
+  ASSERT_OK(writer.Finish());
+
+  std::string contents;
+  ASSERT_TRUE(base::ReadFile(file.path(), &contents));
+  auto reader = SnapshotReader::Create(
+      reinterpret_cast<const uint8_t*>(contents.data()), contents.size());
+  ASSERT_OK(reader);
+  Dataframe loaded = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+  ASSERT_OK(loaded.LoadFromSnapshot(&*reader));
+  ASSERT_TRUE(uses_zone_map(loaded));
+}
+
+TEST(DataframeTest, EncodeColumns) {
+  static constexpr auto kSpec = CreateTypedDataframeSpec(
+      {"id", "ts", "cpu", "dur"},
+      CreateTypedColumnSpec(Id(), NonNull(), IdSorted()),
+      CreateTypedColumnSpec(Int64(), NonNull(), Sorted()),
+      CreateTypedColumnSpec(Uint32(), NonNull(), Unsorted()),
+      CreateTypedColumnSpec(Int64(), DenseNull(), Unsorted()));
+  StringPool pool;
+  Dataframe df = Dataframe::CreateFromTypedSpec(kSpec, &pool);
+  for (uint32_t i = 0; i < 1000; ++i) {
+    std::optional<int64_t> dur;
+    if (i % 3 != 0) {
+      dur = 1000000000l + i;
+    }
+    df.InsertUnchecked(kSpec, std::monostate(), 1000000000000l + i * 100l,
+                       i % 8, dur);
+  }
+  df.Finalize();
+  ASSERT_GT(df.EncodeColumns(), 0u);
+
+  // Filters on the encoded columns.
+  TypedCursor cursor(&df,
+                     {FilterSpec{2, 0, Eq{}, {}}, FilterSpec{1, 1, Ge{}, {}}},
+                     {});
+  cursor.SetFilterValueUnchecked(0, int64_t(3));
+  cursor.SetFilterValueUnchecked(1, int64_t(1000000050000l));
+  cursor.ExecuteUnchecked();
+  uint32_t count = 0;
+  for (; !cursor.Eof(); cursor.Next(), ++count) {
+    uint32_t id = cursor.GetCellUnchecked<0>(kSpec);
+    ASSERT_GE(id, 500u);
+    ASSERT_EQ(id % 8, 3u);
+    ASSERT_EQ(cursor.GetCellUnchecked<1>(kSpec), 1000000000000l + id * 100l);
+    ASSERT_EQ(cursor.GetCellUnchecked<2>(kSpec), 3u);
+    auto dur = cursor.GetCellUnchecked<3>(kSpec);
+    if (id % 3 == 0) {
+      ASSERT_EQ(dur, std::nullopt);
+    } else {
+      ASSERT_EQ(dur, 1000000000l + id);
+    }
+  }
+  ASSERT_EQ(count, 62u);
+
+  // Equality on a sorted encoded column.
+  TypedCursor eq_cursor(&df, {FilterSpec{1, 0, Eq{}, {}}}, {});
+  eq_cursor.SetFilterValueUnchecked(0, int64_t(1000000004200l));
+  eq_cursor.ExecuteUnchecked();
+  ASSERT_FALSE(eq_cursor.Eof());
+  ASSERT_EQ(eq_cursor.GetCellUnchecked<0>(kSpec), 42u);
+  eq_cursor.Next();
+  ASSERT_TRUE(eq_cursor.Eof());
+
+  // Sorting by an encoded column, which decodes it.
+  TypedCursor sort_cursor(&df, {FilterSpec{1, 0, Lt{}, {}}},
+                          {SortSpec{2, SortDirection::kDescending}});
+  sort_cursor.SetFilterValueUnchecked(0, int64_t(1000000001600l));
+  sort_cursor.ExecuteUnchecked();
+  std::vector<uint32_t> cpus;
+  for (; !sort_cursor.Eof(); sort_cursor.Next()) {
+    cpus.push_back(sort_cursor.GetCellUnchecked<2>(kSpec));
+  }
+  std::vector<uint32_t> expected_cpus = {7, 7, 6, 6, 5, 5, 4, 4,
+                                         3, 3, 2, 2, 1, 1, 0, 0};
+  ASSERT_EQ(cpus, expected_cpus);
+
+  // Random access to the encoded columns.
+  AggregateResultCallback cb;
+  df.GetCell(999, 1, cb);
+  ASSERT_EQ(cb.value, (decltype(cb.value)(int64_t(1000000099900l))));
+  df.GetCell(998, 2, cb);
+  ASSERT_EQ(cb.value, (decltype(cb.value)(int64_t(6))));
+  df.GetCell(998, 3, cb);
+  ASSERT_EQ(cb.value, (decltype(cb.value)(int64_t(1000000998l))));
+  df.GetCell(999, 3, cb);
+  ASSERT_EQ(cb.value, (decltype(cb.value)(std::monostate())));
+}
+
 }  // namespace perfetto::trace_processor::core::dataframe
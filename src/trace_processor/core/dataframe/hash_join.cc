@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/core/dataframe/hash_join.h"
+
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/flat_hash_map.h"
+#include "perfetto/ext/base/status_or.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/adhoc_dataframe_builder.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/core/dataframe/types.h"
+#include "src/trace_processor/core/util/bit_vector.h"
+#include "src/trace_processor/core/util/slab.h"
+
+namespace perfetto::trace_processor::core::dataframe {
+namespace {
+
+constexpr uint32_t kNoRow = std::numeric_limits<uint32_t>::max();
+
+// Gives random access to the cells of a column, converting row indices to
+// storage indices for nullable columns.
+class ColumnReader {
+ public:
+  explicit ColumnReader(const Column& column) : type_(column.storage.type()) {
+    if (column.storage.is_encoded()) {
+      decoded_ = column.storage.Decode();
+      data_ = decoded_->data();
+    } else {
+      data_ = column.storage.data();
+    }
+    const Nullability nullability = column.null_storage.nullability();
+    if (nullability.Is<DenseNull>()) {
+      nulls_ = &column.null_storage.unchecked_get<DenseNull>().bit_vector;
+    } else if (!nullability.Is<NonNull>()) {
+      // The popcount kept for GetCell is not available for all the sparse
+      // null variants so compute it here: this is a single pass over the
+      // words of the bit vector.
+      nulls_ = &column.null_storage.unchecked_get<SparseNull>().bit_vector;
+      prefix_popcount_ = nulls_->PrefixPopcount();
+      sparse_ = true;
+    }
+  }
+
+  StorageType type() const { return type_; }
+  const Storage::DataPointer& data() const { return data_; }
+
+  // Returns the index in storage of the cell at |row| or kNoRow if the cell
+  // is null.
+  PERFETTO_ALWAYS_INLINE uint32_t StorageIndex(uint32_t row) const {
+    if (!nulls_) {
+      return row;
+    }
+    if (!nulls_->is_set(row)) {
+      return kNoRow;
+    }
+    if (!sparse_) {
+      return row;
+    }
+    return static_cast<uint32_t>(prefix_popcount_[row / 64] +
+                                 nulls_->count_set_bits_until_in_word(row));
+  }
+
+  // Returns the value of the cell at |row| of an integer column or
+  // std::nullopt if the cell is null.
+  PERFETTO_ALWAYS_INLINE std::optional<int64_t> IntValue(uint32_t row) const {
+    uint32_t idx = StorageIndex(row);
+    if (idx == kNoRow) {
+      return std::nullopt;
+    }
+    switch (type_.index()) {
+      case StorageType::GetTypeIndex<Id>():
+        return idx;
+      case StorageType::GetTypeIndex<Uint32>():
+        return Storage::CastDataPtr<Uint32>(data_)[idx];
+      case StorageType::GetTypeIndex<Int32>():
+        return Storage::CastDataPtr<Int32>(data_)[idx];
+      case StorageType::GetTypeIndex<Int64>():
+        return Storage::CastDataPtr<Int64>(data_)[idx];
+      default:
+        PERFETTO_FATAL("Join key must be an integer column");
+    }
+  }
+
+ private:
+  StorageType type_;
+  // Plain copy of the storage if the column is encoded.
+  std::optional<Storage> decoded_;
+  Storage::DataPointer data_;
+  const BitVector* nulls_ = nullptr;
+  Slab<uint32_t> prefix_popcount_;
+  bool sparse_ = false;
+};
+
+bool IsIntegerType(StorageType type) {
+  return type.Is<Id>() || type.Is<Uint32>() || type.Is<Int32>() ||
+         type.Is<Int64>();
+}
+
+// Builds a hash table on |build_keys| and probes it with |probe_keys|. For
+// every pair of matching keys, appends the index of the build key to
+// |build_matches| and the index of the probe key to |probe_matches|.
+//
+// Matches are returned in increasing order of probe index and, for the same
+// probe index, in increasing order of build index.
+template <typename BuildKeyFn, typename ProbeKeyFn>
+void HashJoinKeys(uint32_t build_count,
+                  const BuildKeyFn& build_keys,
+                  uint32_t probe_count,
+                  const ProbeKeyFn& probe_keys,
+                  std::vector<uint32_t>& build_matches,
+                  std::vector<uint32_t>& probe_matches) {
+  // Maps each key to the first build index with that key: the rest of the
+  // indices are chained through |next|. Insert in reverse so that the chains
+  // are in increasing order.
+  base::FlatHashMap<int64_t, uint32_t> heads;
+  std::vector<uint32_t> next(build_count, kNoRow);
+  for (uint32_t i = build_count; i-- > 0;) {
+    std::optional<int64_t> key = build_keys(i);
+    if (!key) {
+      continue;
+    }
+    auto [head, inserted] = heads.Insert(*key, i);
+    if (!inserted) {
+      next[i] = *head;
+      *head = i;
+    }
+  }
+  for (uint32_t i = 0; i < probe_count; ++i) {
+    std::optional<int64_t> key = probe_keys(i);
+    if (!key) {
+      continue;
+    }
+    uint32_t* head = heads.Find(*key);
+    if (!head) {
+      continue;
+    }
+    for (uint32_t b = *head; b != kNoRow; b = next[b]) {
+      build_matches.push_back(b);
+      probe_matches.push_back(i);
+    }
+  }
+}
+
+template <typename T>
+void PushColumn(const ColumnReader& reader,
+                const std::vector<uint32_t>& rows,
+                uint32_t col,
+                AdhocDataframeBuilder& builder) {
+  for (uint32_t row : rows) {
+    uint32_t idx = reader.StorageIndex(row);
+    if (idx == kNoRow) {
+      builder.PushNull(col);
+    } else if constexpr (std::is_same_v<T, Id>) {
+      builder.PushNonNullUnchecked(col, int64_t(idx));
+    } else if constexpr (std::is_same_v<T, Double>) {
+      builder.PushNonNullUnchecked(
+          col, Storage::CastDataPtr<T>(reader.data())[idx]);
+    } else if constexpr (std::is_same_v<T, String>) {
+      builder.PushNonNull(col, Storage::CastDataPtr<T>(reader.data())[idx]);
+    } else {
+      builder.PushNonNullUnchecked(
+          col, int64_t(Storage::CastDataPtr<T>(reader.data())[idx]));
+    }
+  }
+}
+
+}  // namespace
+
+base::StatusOr<Dataframe> HashJoin::Join(
+    const std::vector<HashJoinTableSpec>& tables,
+    const std::vector<HashJoinOutputColumnSpec>& output_columns,
+    StringPool* pool) {
+  if (tables.empty()) {
+    return base::ErrStatus("JOIN: no tables specified");
+  }
+  for (uint32_t i = 1; i < tables.size(); ++i) {
+    const HashJoinTableSpec& t = tables[i];
+    if (t.left_table >= i) {
+      return base::ErrStatus(
+          "JOIN: table %u can only be joined with tables before it", i);
+    }
+    const Dataframe& left = *tables[t.left_table].df;
+    if (t.col >= t.df->column_count() || t.left_col >= left.column_count()) {
+      return base::ErrStatus("JOIN: column out of range for table %u", i);
+    }
+    if (!IsIntegerType(t.df->column_ptrs_[t.col]->storage.type()) ||
+        !IsIntegerType(left.column_ptrs_[t.left_col]->storage.type())) {
+      return base::ErrStatus("JOIN: join columns must be integer columns");
+    }
+  }
+  for (const auto& c : output_columns) {
+    if (c.table >= tables.size() ||
+        c.col >= tables[c.table].df->column_count()) {
+      return base::ErrStatus("JOIN: output column out of range");
+    }
+  }
+
+  // For each table, the rows of that table which are part of each row of the
+  // join computed so far.
+  std::vector<std::vector<uint32_t>> rows(tables.size());
+  rows[0].resize(tables[0].df->row_count());
+  std::iota(rows[0].begin(), rows[0].end(), 0u);
+  for (uint32_t t = 1; t < tables.size(); ++t) {
+    const HashJoinTableSpec& spec = tables[t];
+    const std::vector<uint32_t>& left_rows = rows[spec.left_table];
+    ColumnReader left(
+        *tables[spec.left_table].df->column_ptrs_[spec.left_col]);
+    ColumnReader right(*spec.df->column_ptrs_[spec.col]);
+    auto left_count = static_cast<uint32_t>(left_rows.size());
+    uint32_t right_count = spec.df->row_count();
+    auto left_key = [&](uint32_t i) { return left.IntValue(left_rows[i]); };
+    auto right_key = [&](uint32_t i) { return right.IntValue(i); };
+
+    std::vector<uint32_t> left_matches;
+    std::vector<uint32_t> right_matches;
+    if (right_count <= left_count) {
+      HashJoinKeys(right_count, right_key, left_count, left_key,
+                   right_matches, left_matches);
+    } else {
+      std::vector<uint32_t> unordered_left;
+      std::vector<uint32_t> unordered_right;
+      HashJoinKeys(left_count, left_key, right_count, right_key,
+                   unordered_left, unordered_right);
+
+      // Restore the nested loop order with a counting sort on the left index:
+      // being stable, it keeps the right rows in increasing order.
+      std::vector<uint32_t> offsets(left_count + 1, 0);
+      for (uint32_t l : unordered_left) {
+        offsets[l + 1]++;
+      }
+      std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+      left_matches.resize(unordered_left.size());
+      right_matches.resize(unordered_right.size());
+      for (uint32_t i = 0; i < unordered_left.size(); ++i) {
+        uint32_t pos = offsets[unordered_left[i]]++;
+        left_matches[pos] = unordered_left[i];
+        right_matches[pos] = unordered_right[i];
+      }
+    }
+
+    for (uint32_t k = 0; k < t; ++k) {
+      std::vector<uint32_t> joined(left_matches.size());
+      for (uint32_t i = 0; i < left_matches.size(); ++i) {
+        joined[i] = rows[k][left_matches[i]];
+      }
+      rows[k] = std::move(joined);
+    }
+    rows[t] = std::move(right_matches);
+  }
+
+  std::vector<std::string> names;
+  std::vector<AdhocDataframeBuilder::ColumnType> types;
+  for (const auto& c : output_columns) {
+    names.push_back(c.name);
+    StorageType type = tables[c.table].df->column_ptrs_[c.col]->storage.type();
+    if (type.Is<Double>()) {
+      types.push_back(AdhocDataframeBuilder::ColumnType::kDouble);
+    } else if (type.Is<String>()) {
+      types.push_back(AdhocDataframeBuilder::ColumnType::kString);
+    } else {
+      types.push_back(AdhocDataframeBuilder::ColumnType::kInt64);
+    }
+  }
+  AdhocDataframeBuilder builder(
+      std::move(names), pool,
+      AdhocDataframeBuilder::Options{
+          std::move(types), NullabilityType::kSparseNullWithPopcount});
+  for (uint32_t i = 0; i < output_columns.size(); ++i) {
+    const auto& c = output_columns[i];
+    ColumnReader reader(*tables[c.table].df->column_ptrs_[c.col]);
+    const std::vector<uint32_t>& col_rows = rows[c.table];
+    switch (reader.type().index()) {
+      case StorageType::GetTypeIndex<Id>():
+        PushColumn<Id>(reader, col_rows, i, builder);
+        break;
+      case StorageType::GetTypeIndex<Uint32>():
+        PushColumn<Uint32>(reader, col_rows, i, builder);
+        break;
+      case StorageType::GetTypeIndex<Int32>():
+        PushColumn<Int32>(reader, col_rows, i, builder);
+        break;
+      case StorageType::GetTypeIndex<Int64>():
+        PushColumn<Int64>(reader, col_rows, i, builder);
+        break;
+      case StorageType::GetTypeIndex<Double>():
+        PushColumn<Double>(reader, col_rows, i, builder);
+        break;
+      case StorageType::GetTypeIndex<String>():
+        PushColumn<String>(reader, col_rows, i, builder);
+        break;
+      default:
+        PERFETTO_FATAL("Invalid storage type");
+    }
+  }
+  return std::move(builder).Build();
+}
+
+}  // namespace perfetto::trace_processor::core::dataframe
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_CORE_DATAFRAME_HASH_JOIN_H_
+#define SRC_TRACE_PROCESSOR_CORE_DATAFRAME_HASH_JOIN_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "perfetto/ext/base/status_or.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+
+namespace perfetto::trace_processor::core::dataframe {
+
+// Specifies one of the dataframes taking part in a join.
+struct HashJoinTableSpec {
+  // The dataframe to join.
+  const Dataframe* df;
+
+  // The column of |df| which is compared for equality with column |left_col|
+  // of table |left_table|. Both columns must be integer (or id) columns.
+  //
+  // Ignored for the first table.
+  uint32_t col = 0;
+  uint32_t left_table = 0;
+  uint32_t left_col = 0;
+};
+
+// Specifies one of the columns in the result of a join.
+struct HashJoinOutputColumnSpec {
+  // The index of the table in the list of tables passed to HashJoin::Join.
+  uint32_t table;
+
+  // The index of the column in that table.
+  uint32_t col;
+
+  // The name of the column in the result.
+  std::string name;
+};
+
+// Computes inner equi-joins between dataframes with hash joins.
+//
+// Tables are joined from left to right: the second table is joined with the
+// first, the third table with the result of joining the first two and so on.
+// For each join, a hash table is built on the smaller of the two inputs and
+// probed with the rows of the larger one. Rows with a null join key never
+// match anything, matching the semantics of SQL.
+//
+// The rows of the result are ordered as a nested loop join would order them:
+// by the row in the first table, then by the row in the second table etc.
+class HashJoin {
+ public:
+  // Joins |tables| and returns a new dataframe containing |output_columns|.
+  // Strings in the result are interned in |pool| which must be the pool of all
+  // the joined dataframes.
+  static base::StatusOr<Dataframe> Join(
+      const std::vector<HashJoinTableSpec>& tables,
+      const std::vector<HashJoinOutputColumnSpec>& output_columns,
+      StringPool* pool);
+};
+
+}  // namespace perfetto::trace_processor::core::dataframe
+
+#endif  // SRC_TRACE_PROCESSOR_CORE_DATAFRAME_HASH_JOIN_H_
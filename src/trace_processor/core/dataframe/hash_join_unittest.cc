@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/core/dataframe/hash_join.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/base/test/status_matchers.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/adhoc_dataframe_builder.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/core/dataframe/dataframe_test_utils.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor::core::dataframe {
+namespace {
+
+class HashJoinTest : public ::testing::Test {
+ protected:
+  // Builds a dataframe with an integer column "key" and a string column "val".
+  Dataframe Build(const std::vector<std::optional<int64_t>>& keys,
+                  const std::vector<const char*>& vals) {
+    AdhocDataframeBuilder builder(
+        {"key", "val"}, &pool_,
+        AdhocDataframeBuilder::Options{
+            {AdhocDataframeBuilder::ColumnType::kInt64,
+             AdhocDataframeBuilder::ColumnType::kString}});
+    for (uint32_t i = 0; i < keys.size(); ++i) {
+      if (keys[i]) {
+        builder.PushNonNull(0, *keys[i]);
+      } else {
+        builder.PushNull(0);
+      }
+      builder.PushNonNull(1, pool_.InternString(vals[i]));
+    }
+    auto df = std::move(builder).Build();
+    PERFETTO_CHECK(df.ok());
+    return std::move(*df);
+  }
+
+  StringPool pool_;
+};
+
+TEST_F(HashJoinTest, TwoTables) {
+  Dataframe left = Build({1, 2, std::nullopt, 3, 2}, {"a", "b", "c", "d", "e"});
+  Dataframe right =
+      Build({2, 2, 3, 4, std::nullopt}, {"v", "w", "x", "y", "z"});
+
+  auto res = HashJoin::Join({{&left}, {&right, 0, 0, 0}},
+                            {{0, 1, "l"}, {1, 0, "key"}, {1, 1, "r"}}, &pool_);
+  ASSERT_OK(res.status());
+  VerifyData(*res, 0b111,
+             Rows(Row(NullTermStringView("b"), uint32_t(2),
+                      NullTermStringView("v")),
+                  Row(NullTermStringView("b"), uint32_t(2),
+                      NullTermStringView("w")),
+                  Row(NullTermStringView("d"), uint32_t(3),
+                      NullTermStringView("x")),
+                  Row(NullTermStringView("e"), uint32_t(2),
+                      NullTermStringView("v")),
+                  Row(NullTermStringView("e"), uint32_t(2),
+                      NullTermStringView("w"))));
+}
+
+TEST_F(HashJoinTest, BuildOnLeftKeepsNestedLoopOrder) {
+  // The right table is larger so the hash table is built on the left one:
+  // the result should still be ordered by the left row.
+  Dataframe left = Build({2, 1}, {"a", "b"});
+  Dataframe right = Build({1, 2, 1, 2, 5}, {"v", "w", "x", "y", "z"});
+
+  auto res = HashJoin::Join({{&left}, {&right, 0, 0, 0}},
+                            {{0, 1, "l"}, {1, 1, "r"}}, &pool_);
+  ASSERT_OK(res.status());
+  VerifyData(
+      *res, 0b11,
+      Rows(Row(NullTermStringView("a"), NullTermStringView("w")),
+           Row(NullTermStringView("a"), NullTermStringView("y")),
+           Row(NullTermStringView("b"), NullTermStringView("v")),
+           Row(NullTermStringView("b"), NullTermStringView("x"))));
+}
+
+TEST_F(HashJoinTest, ThreeTables) {
+  Dataframe a = Build({1, 2, 3}, {"a1", "a2", "a3"});
+  Dataframe b = Build({3, 1}, {"b3", "b1"});
+  Dataframe c = Build({3, 3, 1}, {"c3", "c3'", "c1"});
+
+  // Join c with a (rather than b) on the key.
+  auto res = HashJoin::Join({{&a}, {&b, 0, 0, 0}, {&c, 0, 0, 0}},
+                            {{0, 1, "a"}, {1, 1, "b"}, {2, 1, "c"}}, &pool_);
+  ASSERT_OK(res.status());
+  VerifyData(*res, 0b111,
+             Rows(Row(NullTermStringView("a1"), NullTermStringView("b1"),
+                      NullTermStringView("c1")),
+                  Row(NullTermStringView("a3"), NullTermStringView("b3"),
+                      NullTermStringView("c3")),
+                  Row(NullTermStringView("a3"), NullTermStringView("b3"),
+                      NullTermStringView("c3'"))));
+}
+
+TEST_F(HashJoinTest, NonIntegerKeyIsError) {
+  Dataframe left = Build({1}, {"a"});
+  Dataframe right = Build({1}, {"a"});
+  ASSERT_FALSE(
+      HashJoin::Join({{&left}, {&right, 1, 0, 1}}, {{0, 0, "k"}}, &pool_)
+          .ok());
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor::core::dataframe
@@ -45,7 +45,6 @@
 #include "src/trace_processor/core/util/slab.h"
 #include "src/trace_processor/core/util/span.h"
 #include "src/trace_processor/core/util/type_set.h"
-#include "src/trace_processor/util/regex.h"
 
 namespace perfetto::trace_processor::core::dataframe {
 
@@ -355,6 +354,115 @@ void QueryPlanBuilder::Distinct(
   }
 }
 
+base::Status QueryPlanBuilder::GroupBy(
+    const std::vector<GroupBySpec>& group_by_specs,
+    const std::vector<AggregateSpec>& aggregate_specs) {
+  if (group_by_specs.empty()) {
+    return base::ErrStatus("GROUP BY requires at least one column");
+  }
+  for (const auto& agg : aggregate_specs) {
+    if (!agg.col) {
+      if (!agg.op.Is<Count>()) {
+        return base::ErrStatus("Only COUNT can be computed without a column");
+      }
+      continue;
+    }
+    if (GetColumn(*agg.col).storage.type().Is<String>() &&
+        !agg.op.Is<Count>()) {
+      return base::ErrStatus("Only COUNT is supported on string columns");
+    }
+  }
+
+  std::vector<RowLayoutParams> row_layout_params;
+  row_layout_params.reserve(group_by_specs.size());
+  for (const auto& spec : group_by_specs) {
+    row_layout_params.push_back({spec.col, false});
+  }
+  uint16_t total_row_stride = CalculateRowLayoutStride(row_layout_params);
+  i::RwHandle<Span<uint32_t>> indices = EnsureIndicesAreInSlab();
+  auto buffer_reg =
+      CopyToRowLayout(total_row_stride, indices, {}, row_layout_params);
+
+  i::RwHandle<Slab<uint32_t>> groups_slab{plan_.params.register_count++};
+  i::RwHandle<Span<uint32_t>> groups{plan_.params.register_count++};
+  {
+    using B = i::AllocateIndices;
+    auto& bc = AddOpcode<B>(UnchangedRowCount{});
+    bc.arg<B::size>() = plan_.params.max_row_count;
+    bc.arg<B::dest_slab_register>() = groups_slab;
+    bc.arg<B::dest_span_register>() = groups;
+  }
+
+  // If rows with equal keys are known to be adjacent, we can avoid hashing
+  // altogether. This is the case for a single sorted, non-null column as long
+  // as the indices are still in row order.
+  const Column& first = GetColumn(group_by_specs[0].col);
+  bool is_sorted = group_by_specs.size() == 1 && indices_in_row_order_ &&
+                   first.null_storage.nullability().Is<NonNull>() &&
+                   !first.sort_state.Is<Unsorted>();
+  i::ReadHandle<Slab<uint32_t>> group_ids{plan_.params.register_count++};
+  if (is_sorted) {
+    using B = i::SortedGroupBy;
+    auto& bc = AddOpcode<B>(NonEqualityFilterRowCount{});
+    bc.arg<B::buffer_register>() = buffer_reg;
+    bc.arg<B::total_row_stride>() = total_row_stride;
+    bc.arg<B::indices_register>() = indices;
+    bc.arg<B::dest_group_ids_register>() =
+        i::WriteHandle<Slab<uint32_t>>{group_ids.index};
+    bc.arg<B::groups_register>() = groups;
+  } else {
+    using B = i::HashGroupBy;
+    auto& bc = AddOpcode<B>(NonEqualityFilterRowCount{});
+    bc.arg<B::buffer_register>() = buffer_reg;
+    bc.arg<B::total_row_stride>() = total_row_stride;
+    bc.arg<B::indices_register>() = indices;
+    bc.arg<B::dest_group_ids_register>() =
+        i::WriteHandle<Slab<uint32_t>>{group_ids.index};
+    bc.arg<B::groups_register>() = groups;
+  }
+
+  for (const auto& agg : aggregate_specs) {
+    i::WriteHandle<i::AggregateValues> dest{plan_.params.register_count++};
+    plan_.aggregate_registers.emplace_back(dest.index);
+
+    const Column* col = agg.col ? &GetColumn(*agg.col) : nullptr;
+    if (!col || (agg.op.Is<Count>() &&
+                 col->null_storage.nullability().Is<NonNull>())) {
+      using B = i::CountGroupRows;
+      auto& bc = AddOpcode<B>(UnchangedRowCount{});
+      bc.arg<B::indices_register>() = indices;
+      bc.arg<B::group_ids_register>() = group_ids;
+      bc.arg<B::groups_register>() = groups;
+      bc.arg<B::dest_register>() = dest;
+      continue;
+    }
+
+    const auto& nullability = col->null_storage.nullability();
+    using PopcountHandle = i::ReadHandle<Slab<uint32_t>>;
+    PopcountHandle popcount_register{std::numeric_limits<uint32_t>::max()};
+    if (nullability.IsAnyOf<SparseNullTypes>()) {
+      popcount_register = PrefixPopcountRegisterFor(*agg.col);
+    }
+    using B = i::AggregateBase;
+    auto& bc = AddOpcode<B>(
+        i::Index<i::Aggregate>(
+            col->storage.type(),
+            NullabilityToSparseNullCollapsedNullability(nullability)),
+        UnchangedRowCount{});
+    bc.arg<B::storage_register>() =
+        StorageRegisterFor(*agg.col, col->storage.type());
+    bc.arg<B::null_bv_register>() = NullBitvectorRegisterFor(*agg.col);
+    bc.arg<B::popcount_register>() = popcount_register;
+    bc.arg<B::indices_register>() = indices;
+    bc.arg<B::group_ids_register>() = group_ids;
+    bc.arg<B::groups_register>() = groups;
+    bc.arg<B::op>() = agg.op;
+    bc.arg<B::dest_register>() = dest;
+  }
+  indices_reg_ = groups;
+  return base::OkStatus();
+}
+
 void QueryPlanBuilder::Sort(const std::vector<SortSpec>& sort_specs) {
   if (sort_specs.empty()) {
     return;
@@ -625,6 +733,14 @@ void QueryPlanBuilder::NonStringConstraint(
     const i::NonStringOp& op,
     const i::ReadHandle<i::CastFilterValueResult>& result) {
   const auto& col = GetColumn(c.col);
+  if (std::holds_alternative<i::RwHandle<Range>>(indices_reg_) &&
+      col.specialized_storage.Is<SpecializedStorage::ZoneMap>()) {
+    auto int_or_double = type.TryDowncast<i::IntegerOrDoubleType>();
+    auto range_op = op.TryDowncast<i::RangeOp>();
+    if (int_or_double && range_op) {
+      ZoneMapConstraint(c, *int_or_double, *range_op, result);
+    }
+  }
   if (std::holds_alternative<i::RwHandle<Range>>(indices_reg_) && op.Is<Eq>() &&
       col.null_storage.nullability().Is<NonNull>()) {
     // Non null equality on an id column should have been handled earlier.
@@ -653,6 +769,34 @@ void QueryPlanBuilder::NonStringConstraint(
   MaybeReleaseScratchSpanRegister();
 }
 
+void QueryPlanBuilder::ZoneMapConstraint(
+    const FilterSpec& c,
+    const i::IntegerOrDoubleType& type,
+    const i::RangeOp& op,
+    const i::ReadHandle<i::CastFilterValueResult>& result) {
+  const auto& range_reg = base::unchecked_get<i::RwHandle<Range>>(indices_reg_);
+  i::RwHandle<Slab<uint32_t>> slab_reg{plan_.params.register_count++};
+  i::RwHandle<Span<uint32_t>> span_reg{plan_.params.register_count++};
+  {
+    using B = i::AllocateIndices;
+    auto& bc = AddOpcode<B>(UnchangedRowCount{});
+    bc.arg<B::size>() = plan_.params.max_row_count;
+    bc.arg<B::dest_slab_register>() = slab_reg;
+    bc.arg<B::dest_span_register>() = span_reg;
+  }
+  {
+    using B = i::ZoneMapFilterBase;
+    auto& bc =
+        AddOpcode<B>(i::Index<i::ZoneMapFilter>(type, op), UnchangedRowCount{});
+    bc.arg<B::zone_map_register>() = ZoneMapRegisterFor(c.col);
+    bc.arg<B::val_register>() = result;
+    bc.arg<B::source_register>() = range_reg;
+    bc.arg<B::update_register>() = span_reg;
+    bc.arg<B::block_size>() = SpecializedStorage::ZoneMap::kBlockSize;
+  }
+  indices_reg_ = span_reg;
+}
+
 base::Status QueryPlanBuilder::StringConstraint(
     const FilterSpec& c,
     const i::StringOp& op,
@@ -663,12 +807,6 @@ base::Status QueryPlanBuilder::StringConstraint(
     AddLinearFilterEqBytecode(c, result, i::NonIdStorageType{String{}});
     return base::OkStatus();
   }
-  if constexpr (!regex::IsRegexSupported()) {
-    if (op.Is<Regex>()) {
-      return base::ErrStatus(
-          "Regex is not supported on non-Unix platforms (e.g. Windows).");
-    }
-  }
   auto update = EnsureIndicesAreInSlab();
   PruneNullIndices(c.col, update);
   auto source = TranslateNonNullIndices(c.col, update, false);
@@ -788,6 +926,7 @@ void QueryPlanBuilder::IndexConstraints(
     bc.arg<B::update_register>() = output_span_reg;
   }
   indices_reg_ = output_span_reg;
+  indices_in_row_order_ = false;
 }
 
 bool QueryPlanBuilder::TrySortedConstraint(FilterSpec& fs,
@@ -1121,6 +1260,12 @@ QueryPlanBuilder::SmallValueEqPopcountRegisterFor(uint32_t col) {
       RegisterInit::SmallValueEqPopcount{});
 }
 
+i::ReadHandle<i::StoragePtr> QueryPlanBuilder::ZoneMapRegisterFor(
+    uint32_t col) {
+  return GetOrCreateInitRegister<i::ReadHandle<i::StoragePtr>>(
+      col, &ColumnState::zone_map_register, RegisterInit::ZoneMapBounds{});
+}
+
 i::RwHandle<Span<uint32_t>> QueryPlanBuilder::IndexRegisterFor(uint32_t pos) {
   auto& reg = index_states_[pos].index_register;
   if (!reg) {
@@ -58,6 +58,7 @@ struct RegisterInit {
   struct IndexVector {};
   struct SmallValueEqBitvector {};
   struct SmallValueEqPopcount {};
+  struct ZoneMapBounds {};
 
   using Type = TypeSet<Id,
                        Uint32,
@@ -68,7 +69,8 @@ struct RegisterInit {
                        NullBitvector,
                        IndexVector,
                        SmallValueEqBitvector,
-                       SmallValueEqPopcount>;
+                       SmallValueEqPopcount,
+                       ZoneMapBounds>;
   uint32_t dest_register = 0;
   Type kind{Id{}};
   uint16_t source_index = 0;  // col_index or index_id depending on kind
@@ -113,7 +115,8 @@ struct QueryPlanImpl {
         sizeof(params) + sizeof(size_t) +
         (bytecode.size() * sizeof(interpreter::Bytecode)) + sizeof(size_t) +
         (col_to_output_offset.size() * sizeof(uint32_t)) + sizeof(size_t) +
-        (register_inits.size() * sizeof(RegisterInit));
+        (register_inits.size() * sizeof(RegisterInit)) + sizeof(size_t) +
+        (aggregate_registers.size() * sizeof(uint32_t));
     std::string res(size, '\0');
     char* p = res.data();
     {
@@ -150,6 +153,16 @@ struct QueryPlanImpl {
              register_inits.size() * sizeof(RegisterInit));
       p += register_inits.size() * sizeof(RegisterInit);
     }
+    {
+      size_t aggregate_registers_size = aggregate_registers.size();
+      memcpy(p, &aggregate_registers_size, sizeof(aggregate_registers_size));
+      p += sizeof(aggregate_registers_size);
+    }
+    {
+      memcpy(p, aggregate_registers.data(),
+             aggregate_registers.size() * sizeof(uint32_t));
+      p += aggregate_registers.size() * sizeof(uint32_t);
+    }
     PERFETTO_CHECK(p == res.data() + res.size());
     return base::Base64Encode(base::StringView(res));
   }
@@ -165,6 +178,7 @@ struct QueryPlanImpl {
     size_t bytecode_size;
     size_t columns_size;
     size_t register_inits_size;
+    size_t aggregate_registers_size;
     {
       memcpy(&res.params, p, sizeof(res.params));
       p += sizeof(res.params);
@@ -205,6 +219,18 @@ struct QueryPlanImpl {
              register_inits_size * sizeof(RegisterInit));
       p += register_inits_size * sizeof(RegisterInit);
     }
+    {
+      memcpy(&aggregate_registers_size, p, sizeof(aggregate_registers_size));
+      p += sizeof(aggregate_registers_size);
+    }
+    {
+      for (size_t i = 0; i < aggregate_registers_size; ++i) {
+        res.aggregate_registers.emplace_back();
+      }
+      memcpy(res.aggregate_registers.data(), p,
+             aggregate_registers_size * sizeof(uint32_t));
+      p += aggregate_registers_size * sizeof(uint32_t);
+    }
     PERFETTO_CHECK(p == raw_data->data() + raw_data->size());
     return res;
   }
@@ -216,6 +242,10 @@ struct QueryPlanImpl {
   // Register initialization specifications.
   // The cursor processes these to set up registers before bytecode execution.
   base::SmallVector<RegisterInit, 16> register_inits;
+
+  // Registers holding the results of aggregations (one AggregateValues per
+  // AggregateSpec). Empty if the plan does not aggregate.
+  base::SmallVector<uint32_t, 4> aggregate_registers;
 };
 
 // Builder class for creating query plans.
@@ -246,6 +276,26 @@ class QueryPlanBuilder {
     return std::move(builder).Build();
   }
 
+  // Builds a plan which filters the rows and then computes |aggregate_specs|
+  // for each group of rows with equal values in the |group_by_specs| columns.
+  // The output of the plan has one row per group, pointing to the first row of
+  // the group; the aggregated values are stored in
+  // `QueryPlanImpl::aggregate_registers`.
+  static base::StatusOr<QueryPlanImpl> BuildAggregate(
+      uint32_t row_count,
+      const std::vector<std::shared_ptr<Column>>& columns,
+      const std::vector<Index>& indexes,
+      std::vector<FilterSpec>& specs,
+      const std::vector<GroupBySpec>& group_by_specs,
+      const std::vector<AggregateSpec>& aggregate_specs,
+      uint64_t cols_used) {
+    QueryPlanBuilder builder(row_count, columns, indexes);
+    RETURN_IF_ERROR(builder.Filter(specs));
+    RETURN_IF_ERROR(builder.GroupBy(group_by_specs, aggregate_specs));
+    builder.Output({}, cols_used);
+    return std::move(builder).Build();
+  }
+
  private:
   // Represents register types for holding indices.
   using IndicesReg = std::variant<interpreter::RwHandle<Range>,
@@ -297,6 +347,8 @@ class QueryPlanBuilder {
         small_value_eq_bv_register;
     std::optional<interpreter::ReadHandle<Span<const uint32_t>>>
         small_value_eq_popcount_register;
+    std::optional<interpreter::ReadHandle<interpreter::StoragePtr>>
+        zone_map_register;
   };
 
   // Constructs a builder for the given number of rows and columns.
@@ -313,6 +365,11 @@ class QueryPlanBuilder {
   // specification.
   void Distinct(const std::vector<DistinctSpec>& distinct_specs);
 
+  // Adds group by and aggregation operations to the query plan. After this,
+  // the indices contain the first row of each group.
+  base::Status GroupBy(const std::vector<GroupBySpec>& group_by_specs,
+                       const std::vector<AggregateSpec>& aggregate_specs);
+
   // Adds min/max operations to the query plan given a single column which
   // should be sorted on.
   void MinMax(const SortSpec& spec);
@@ -337,6 +394,15 @@ class QueryPlanBuilder {
       const interpreter::ReadHandle<interpreter::CastFilterValueResult>&
           result);
 
+  // Replaces the range of indices with the indices of the blocks which may
+  // match the constraint according to the zone map of the column.
+  void ZoneMapConstraint(
+      const FilterSpec& c,
+      const interpreter::IntegerOrDoubleType& type,
+      const interpreter::RangeOp& op,
+      const interpreter::ReadHandle<interpreter::CastFilterValueResult>&
+          result);
+
   // Processes string filter constraints.
   base::Status StringConstraint(
       const FilterSpec& c,
@@ -436,6 +502,10 @@ class QueryPlanBuilder {
   interpreter::ReadHandle<Span<const uint32_t>> SmallValueEqPopcountRegisterFor(
       uint32_t col);
 
+  // Returns the zone map bounds register for the given column.
+  interpreter::ReadHandle<interpreter::StoragePtr> ZoneMapRegisterFor(
+      uint32_t col);
+
   interpreter::ReadHandle<interpreter::CastFilterValueResult> CastFilterValue(
       FilterSpec& c,
       const StorageType& ct,
@@ -494,6 +564,11 @@ class QueryPlanBuilder {
   // Current register holding the set of matching indices.
   IndicesReg indices_reg_;
 
+  // Whether the indices are in increasing row order. This is false once
+  // indices have been read from an index (which produces them in the order of
+  // the indexed values).
+  bool indices_in_row_order_ = true;
+
   // If scratch indices are needed, this holds the size and handles to
   // the scratch indices in both Span and Slab forms.
   struct ScratchIndices {
@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/common/aggregate_types.h"
 #include "src/trace_processor/core/common/duplicate_types.h"
 #include "src/trace_processor/core/common/null_types.h"
 #include "src/trace_processor/core/common/op_types.h"
@@ -49,6 +50,13 @@ using core::Ne;
 using core::Op;
 using core::Regex;
 
+// Aggregate types
+using core::AggregateOp;
+using core::Count;
+using core::Max;
+using core::Min;
+using core::Sum;
+
 // Nullability types
 using core::DenseNull;
 using core::NonNull;
@@ -105,6 +113,26 @@ struct DistinctSpec {
   uint32_t col;
 };
 
+// -----------------------------------------------------------------------------
+// Group By Specifications
+// -----------------------------------------------------------------------------
+
+// Specifies a column whose values should be used to group rows.
+struct GroupBySpec {
+  // Index of the column in the dataframe to group by.
+  uint32_t col;
+};
+
+// Specifies an aggregation to compute for each group of rows.
+struct AggregateSpec {
+  // Index of the column in the dataframe to aggregate or std::nullopt to
+  // count all rows in the group (i.e. COUNT(*)).
+  std::optional<uint32_t> col;
+
+  // Aggregation to compute.
+  AggregateOp op;
+};
+
 // -----------------------------------------------------------------------------
 // Sort Specifications
 // -----------------------------------------------------------------------------
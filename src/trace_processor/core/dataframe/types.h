@@ -12,6 +12,7 @@
 #include "perfetto/base/logging.h"
 #include "perfetto/ext/base/variant.h"
 #include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/common/column_encoding.h"
 #include "src/trace_processor/core/common/duplicate_types.h"
 #include "src/trace_processor/core/common/null_types.h"
 #include "src/trace_processor/core/common/sort_types.h"
@@ -84,18 +85,21 @@ class Storage {
       : type_(core::Double{}), data_(std::move(data)) {}
   Storage(Storage::String data)
       : type_(core::String{}), data_(std::move(data)) {}
+  Storage(EncodedColumn data) : type_(data.type()), data_(std::move(data)) {}
 
   // Type-safe access to storage with unchecked variant access.
   template <typename T>
   auto& unchecked_get() {
-    using U = StorageType::VariantTypeAtIndex<T, Variant>;
+    using U =
+        std::variant_alternative_t<StorageType::GetTypeIndex<T>(), Variant>;
     PERFETTO_DCHECK(std::holds_alternative<U>(data_));
     return base::unchecked_get<U>(data_);
   }
 
   template <typename T>
   const auto& unchecked_get() const {
-    using U = StorageType::VariantTypeAtIndex<T, Variant>;
+    using U =
+        std::variant_alternative_t<StorageType::GetTypeIndex<T>(), Variant>;
     PERFETTO_DCHECK(std::holds_alternative<U>(data_));
     return base::unchecked_get<U>(data_);
   }
@@ -114,7 +118,10 @@ class Storage {
   // Returns a variant containing pointer to the underlying data.
   // Returns nullptr (as IdDataTag*) if the storage type is Id (which has no
   // buffer).
+  //
+  // Must not be called on encoded storage: see `is_encoded()`.
   DataPointer data() const {
+    PERFETTO_DCHECK(!is_encoded());
     switch (type_.index()) {
       case StorageType::GetTypeIndex<core::Id>():
         return static_cast<const IdDataTag*>(nullptr);
@@ -141,9 +148,47 @@ class Storage {
 
   StorageType type() const { return type_; }
 
+  // Returns whether the values are stored in a compressed `EncodedColumn`
+  // (see `Dataframe::EncodeColumns()`) rather than a plain vector. Encoded
+  // storage has no contiguous buffer so `unchecked_get()`, `unchecked_data()`
+  // and `data()` must not be called on it: values should be read with
+  // `encoded()` or the whole storage decoded with `Decode()`.
+  bool is_encoded() const {
+    return std::holds_alternative<EncodedColumn>(data_);
+  }
+
+  const EncodedColumn& encoded() const {
+    PERFETTO_DCHECK(is_encoded());
+    return base::unchecked_get<EncodedColumn>(data_);
+  }
+
+  // Returns a plain (i.e. non-encoded) copy of encoded storage.
+  Storage Decode() const {
+    switch (type_.index()) {
+      case StorageType::GetTypeIndex<core::Uint32>():
+        return Storage(DecodeToVector<uint32_t>(encoded()));
+      case StorageType::GetTypeIndex<core::Int32>():
+        return Storage(DecodeToVector<int32_t>(encoded()));
+      case StorageType::GetTypeIndex<core::Int64>():
+        return Storage(DecodeToVector<int64_t>(encoded()));
+      default:
+        PERFETTO_FATAL("Only integer storage can be encoded");
+    }
+  }
+
  private:
-  // Variant containing all possible storage representations.
-  using Variant = std::variant<Id, Uint32, Int32, Int64, Double, String>;
+  template <typename T>
+  static FlexVector<T> DecodeToVector(const EncodedColumn& encoded) {
+    auto vec = FlexVector<T>::CreateWithSize(encoded.size());
+    encoded.Decode(0, encoded.size(), vec.data());
+    return vec;
+  }
+
+  // Variant containing all possible storage representations. Note that the
+  // index of the plain representations must match the index of the
+  // corresponding type in `StorageType`.
+  using Variant =
+      std::variant<Id, Uint32, Int32, Int64, Double, String, EncodedColumn>;
   StorageType type_;
   Variant data_;
 };
@@ -307,8 +352,27 @@ struct SpecializedStorage {
     Slab<uint32_t> prefix_popcount;
   };
 
+  // Summary of the values in each block of `kBlockSize` rows of a numeric
+  // column, used to skip the blocks which cannot contain any row matching a
+  // filter instead of scanning every row.
+  //
+  // Usable in situations where the column has all the following properties:
+  //  1) It's non-null or dense null (i.e. storage indices are row indices).
+  //  2) It's not sorted (sorted columns are filtered with binary search).
+  //  3) It's an integer or double column.
+  struct ZoneMap {
+    static constexpr uint32_t kBlockSize = 4096;
+
+    // The minimum and maximum value of each block, interleaved (i.e.
+    // [min_0, max_0, min_1, max_1, ...]). Has the same type as the column.
+    //
+    // Note: for dense null columns, the values of null rows are included.
+    Storage bounds;
+  };
+
   SpecializedStorage() = default;
   SpecializedStorage(SmallValueEq data) : data_(std::move(data)) {}
+  SpecializedStorage(ZoneMap data) : data_(std::move(data)) {}
 
   template <typename T>
   bool Is() const {
@@ -322,7 +386,7 @@ struct SpecializedStorage {
   }
 
  private:
-  using Variant = std::variant<std::monostate, SmallValueEq>;
+  using Variant = std::variant<std::monostate, SmallValueEq, ZoneMap>;
   Variant data_;
 };
 
@@ -24,6 +24,7 @@
 #include "perfetto/ext/base/variant.h"
 #include "perfetto/public/compiler.h"
 #include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/common/aggregate_types.h"
 #include "src/trace_processor/core/common/null_types.h"
 #include "src/trace_processor/core/common/op_types.h"
 #include "src/trace_processor/core/common/storage_types.h"
@@ -202,6 +203,32 @@ struct NonStringFilter : NonStringFilterBase {
   static_assert(TS2::Contains<Op>());
 };
 
+// Writes the indices in a range which belong to blocks of `block_size` rows
+// which may contain values matching a filter, using the minimum and maximum
+// value of each block (i.e. the "zone map" of the column). This is only a
+// coarse filter: the indices should then be filtered by NonStringFilter.
+struct ZoneMapFilterBase : TemplatedBytecode2<IntegerOrDoubleType, RangeOp> {
+  // TODO(lalitm): while the cost type is legitimate, the cost estimate inside
+  // is plucked from thin air and has no real foundation. Fix this by creating
+  // benchmarks and backing it up with actual data.
+  static constexpr Cost kCost = LinearPerRowCost{1};
+  PERFETTO_DATAFRAME_BYTECODE_IMPL_5(ReadHandle<StoragePtr>,
+                                     zone_map_register,
+                                     ReadHandle<CastFilterValueResult>,
+                                     val_register,
+                                     ReadHandle<Range>,
+                                     source_register,
+                                     RwHandle<Span<uint32_t>>,
+                                     update_register,
+                                     uint32_t,
+                                     block_size);
+};
+template <typename T, typename Op>
+struct ZoneMapFilter : ZoneMapFilterBase {
+  static_assert(TS1::Contains<T>());
+  static_assert(TS2::Contains<Op>());
+};
+
 // Filter operations on string columns.
 struct StringFilterBase : TemplatedBytecode1<StringOp> {
   // TODO(lalitm): while the cost type is legitimate, the cost estimate inside
@@ -418,6 +445,87 @@ struct Distinct : Bytecode {
                                      indices_register);
 };
 
+// Assigns every row in `indices_register` to a group based on the opaque
+// bytes of its row layout entry, using a hash table. The id of the group of
+// each row is written to `dest_group_ids_register` (in the same order as the
+// indices) and the first row of each group is written to `groups_register`,
+// in the order in which the groups were first seen.
+struct HashGroupBy : Bytecode {
+  static constexpr Cost kCost = LinearPerRowCost{10};
+
+  PERFETTO_DATAFRAME_BYTECODE_IMPL_5(ReadHandle<Slab<uint8_t>>,
+                                     buffer_register,
+                                     uint32_t,
+                                     total_row_stride,
+                                     ReadHandle<Span<uint32_t>>,
+                                     indices_register,
+                                     WriteHandle<Slab<uint32_t>>,
+                                     dest_group_ids_register,
+                                     RwHandle<Span<uint32_t>>,
+                                     groups_register);
+};
+
+// Same as HashGroupBy but requires rows with equal row layout entries to be
+// adjacent (e.g. because the rows are sorted by the grouped columns): a new
+// group is started whenever an entry differs from the previous one.
+struct SortedGroupBy : Bytecode {
+  static constexpr Cost kCost = LinearPerRowCost{3};
+
+  PERFETTO_DATAFRAME_BYTECODE_IMPL_5(ReadHandle<Slab<uint8_t>>,
+                                     buffer_register,
+                                     uint32_t,
+                                     total_row_stride,
+                                     ReadHandle<Span<uint32_t>>,
+                                     indices_register,
+                                     WriteHandle<Slab<uint32_t>>,
+                                     dest_group_ids_register,
+                                     RwHandle<Span<uint32_t>>,
+                                     groups_register);
+};
+
+// Counts the number of rows in each group created by a GroupBy bytecode.
+struct CountGroupRows : Bytecode {
+  static constexpr Cost kCost = LinearPerRowCost{1};
+
+  PERFETTO_DATAFRAME_BYTECODE_IMPL_4(ReadHandle<Span<uint32_t>>,
+                                     indices_register,
+                                     ReadHandle<Slab<uint32_t>>,
+                                     group_ids_register,
+                                     ReadHandle<Span<uint32_t>>,
+                                     groups_register,
+                                     WriteHandle<AggregateValues>,
+                                     dest_register);
+};
+
+// Computes `op` over the non-null cells of a column for each group created by
+// a GroupBy bytecode.
+struct AggregateBase
+    : TemplatedBytecode2<StorageType, SparseNullCollapsedNullability> {
+  static constexpr Cost kCost = LinearPerRowCost{3};
+
+  PERFETTO_DATAFRAME_BYTECODE_IMPL_8(ReadHandle<StoragePtr>,
+                                     storage_register,
+                                     ReadHandle<const BitVector*>,
+                                     null_bv_register,
+                                     ReadHandle<Slab<uint32_t>>,
+                                     popcount_register,
+                                     ReadHandle<Span<uint32_t>>,
+                                     indices_register,
+                                     ReadHandle<Slab<uint32_t>>,
+                                     group_ids_register,
+                                     ReadHandle<Span<uint32_t>>,
+                                     groups_register,
+                                     AggregateOp,
+                                     op,
+                                     WriteHandle<AggregateValues>,
+                                     dest_register);
+};
+template <typename T, typename Nullability>
+struct Aggregate : AggregateBase {
+  static_assert(TS1::Contains<T>());
+  static_assert(TS2::Contains<Nullability>());
+};
+
 // Applies an offset to the indices span and limits the rows.
 // Modifies the span referenced by `update_register` in place.
 //
@@ -685,6 +793,26 @@ struct Reverse : Bytecode {
   X(NonStringFilter<Double, Le>)                       \
   X(NonStringFilter<Double, Gt>)                       \
   X(NonStringFilter<Double, Ge>)                       \
+  X(ZoneMapFilter<Uint32, Eq>)                         \
+  X(ZoneMapFilter<Uint32, Lt>)                         \
+  X(ZoneMapFilter<Uint32, Le>)                         \
+  X(ZoneMapFilter<Uint32, Gt>)                         \
+  X(ZoneMapFilter<Uint32, Ge>)                         \
+  X(ZoneMapFilter<Int32, Eq>)                          \
+  X(ZoneMapFilter<Int32, Lt>)                          \
+  X(ZoneMapFilter<Int32, Le>)                          \
+  X(ZoneMapFilter<Int32, Gt>)                          \
+  X(ZoneMapFilter<Int32, Ge>)                          \
+  X(ZoneMapFilter<Int64, Eq>)                          \
+  X(ZoneMapFilter<Int64, Lt>)                          \
+  X(ZoneMapFilter<Int64, Le>)                          \
+  X(ZoneMapFilter<Int64, Gt>)                          \
+  X(ZoneMapFilter<Int64, Ge>)                          \
+  X(ZoneMapFilter<Double, Eq>)                         \
+  X(ZoneMapFilter<Double, Lt>)                         \
+  X(ZoneMapFilter<Double, Le>)                         \
+  X(ZoneMapFilter<Double, Gt>)                         \
+  X(ZoneMapFilter<Double, Ge>)                         \
   X(StringFilter<Eq>)                                  \
   X(StringFilter<Ne>)                                  \
   X(StringFilter<Lt>)                                  \
@@ -720,6 +848,27 @@ struct Reverse : Bytecode {
   X(CopyToRowLayout<String, SparseNull>)               \
   X(CopyToRowLayout<String, DenseNull>)                \
   X(Distinct)                                          \
+  X(HashGroupBy)                                       \
+  X(SortedGroupBy)                                     \
+  X(CountGroupRows)                                    \
+  X(Aggregate<Id, NonNull>)                            \
+  X(Aggregate<Id, SparseNull>)                         \
+  X(Aggregate<Id, DenseNull>)                          \
+  X(Aggregate<Uint32, NonNull>)                        \
+  X(Aggregate<Uint32, SparseNull>)                     \
+  X(Aggregate<Uint32, DenseNull>)                      \
+  X(Aggregate<Int32, NonNull>)                         \
+  X(Aggregate<Int32, SparseNull>)                      \
+  X(Aggregate<Int32, DenseNull>)                       \
+  X(Aggregate<Int64, NonNull>)                         \
+  X(Aggregate<Int64, SparseNull>)                      \
+  X(Aggregate<Int64, DenseNull>)                       \
+  X(Aggregate<Double, NonNull>)                        \
+  X(Aggregate<Double, SparseNull>)                     \
+  X(Aggregate<Double, DenseNull>)                      \
+  X(Aggregate<String, NonNull>)                        \
+  X(Aggregate<String, SparseNull>)                     \
+  X(Aggregate<String, DenseNull>)                      \
   X(LimitOffsetIndices)                                \
   X(FindMinMaxIndex<Id, MinOp>)                        \
   X(FindMinMaxIndex<Id, MaxOp>)                        \
@@ -54,6 +54,18 @@ class Interpreter {
     state_.Initialize(bytecode, num_registers, string_pool);
   }
 
+  // Sets the pool used to filter large numbers of rows in parallel. The
+  // results are identical to filtering on the calling thread. Pass nullptr
+  // to run everything on the calling thread (the default).
+  void SetThreadPool(base::ThreadPool* pool) { state_.thread_pool = pool; }
+
+  // Sets the trigram index over the string pool used to only match globs
+  // against strings which contain the literal parts of the pattern. Pass
+  // nullptr to match against every string (the default).
+  void SetStringPoolTrigramIndex(StringPoolTrigramIndex* index) {
+    state_.trigram_index = index;
+  }
+
   // Not movable because it's a very large object and the move cost would be
   // high. Prefer constructing in place.
   Interpreter(Interpreter&&) = delete;
@@ -16,12 +16,14 @@
 
 #include <benchmark/benchmark.h>
 #include <cstdint>
+#include <memory>
 #include <random>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "perfetto/ext/base/string_view.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "src/trace_processor/containers/string_pool.h"
 #include "src/trace_processor/core/common/duplicate_types.h"
 #include "src/trace_processor/core/common/sort_types.h"
@@ -33,10 +35,52 @@
 #include "src/trace_processor/core/interpreter/bytecode_registers.h"
 #include "src/trace_processor/core/util/flex_vector.h"
 #include "src/trace_processor/core/util/slab.h"
+#include "src/trace_processor/util/parallel_for.h"
 
 namespace perfetto::trace_processor::core::interpreter {
 namespace {
 
+constexpr uint32_t kFilterTableSize = 1024 * 1024;
+
+// Reports the number of rows processed per second, given that each iteration
+// processes |rows| rows.
+void SetRowsPerSecond(benchmark::State& state, uint32_t rows) {
+  state.counters["rows/s"] = benchmark::Counter(
+      rows, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// Runs |bytecode| against a NonNull column holding |data|, with the column's
+// storage in register 4 and |values| as the filter values, reporting the
+// throughput of the filter in rows/s. If |pool| is non-null, filters are
+// split into morsels which run on its threads.
+template <typename S, typename T>
+void RunFilterBenchmark(benchmark::State& state,
+                        FlexVector<T> data,
+                        const std::string& bytecode,
+                        std::vector<FilterValue> values,
+                        base::ThreadPool* pool = nullptr) {
+  dataframe::Column col{dataframe::Storage{std::move(data)},
+                        dataframe::NullStorage::NonNull{}, Unsorted{},
+                        HasDuplicates{}};
+
+  StringPool spool;
+  Interpreter<Fetcher> interpreter;
+  interpreter.Initialize(ParseBytecodeToVec(bytecode), 5, &spool);
+  interpreter.SetThreadPool(pool);
+
+  StoragePtr storage_ptr{col.storage.unchecked_data<S>(), S{}};
+  interpreter.SetRegisterValue(WriteHandle<StoragePtr>(4), storage_ptr);
+
+  Fetcher fetcher;
+  fetcher.value = std::move(values);
+
+  for (auto _ : state) {
+    interpreter.Execute(fetcher);
+    benchmark::ClobberMemory();
+  }
+  SetRowsPerSecond(state, kFilterTableSize);
+}
+
 void BM_BytecodeInterpreter_LinearFilterEqUint32(benchmark::State& state) {
   constexpr uint32_t kTableSize = 1024 * 1024;
 
@@ -81,6 +125,7 @@ void BM_BytecodeInterpreter_LinearFilterEqUint32(benchmark::State& state) {
     interpreter.Execute(fetcher);
     benchmark::ClobberMemory();
   }
+  SetRowsPerSecond(state, kTableSize);
 }
 BENCHMARK(BM_BytecodeInterpreter_LinearFilterEqUint32);
 
@@ -133,9 +178,140 @@ void BM_BytecodeInterpreter_LinearFilterEqString(benchmark::State& state) {
     interpreter.Execute(fetcher);
     benchmark::ClobberMemory();
   }
+  SetRowsPerSecond(state, kTableSize);
 }
 BENCHMARK(BM_BytecodeInterpreter_LinearFilterEqString);
 
+void BM_BytecodeInterpreter_LinearFilterEqInt64(benchmark::State& state) {
+  FlexVector<int64_t> data;
+  for (uint32_t i = 0; i < kFilterTableSize; ++i) {
+    data.push_back(i % 256);
+  }
+  // Register layout:
+  // R0: CastFilterValueResult (filter value)
+  // R1: Range (source range)
+  // R2: Span<uint32_t> (output indices)
+  // R3: Slab<uint32_t> (backing storage for output)
+  // R4: StoragePtr (column data pointer)
+  std::string bytecode_str = R"(
+    CastFilterValue<Int64>: [fval_handle=FilterValue(0), write_register=Register(0), op=Op(0)]
+    InitRange: [size=1048576, dest_register=Register(1)]
+    AllocateIndices: [size=1048576, dest_slab_register=Register(3), dest_span_register=Register(2)]
+    LinearFilterEq<Int64>: [storage_register=Register(4), filter_value_reg=Register(0), popcount_register=Register(4294967295), source_register=Register(1), update_register=Register(2)]
+  )";
+  RunFilterBenchmark<Int64>(state, std::move(data), bytecode_str,
+                            {int64_t(123)});
+}
+BENCHMARK(BM_BytecodeInterpreter_LinearFilterEqInt64);
+
+// The NonStringFilter and In benchmarks below use uniformly random data with
+// ~50% selectivity: this is the worst case for a branchy scalar loop.
+//
+// Register layout:
+// R0: CastFilterValueResult/CastFilterValueListResult (filter value)
+// R1: Range (source range)
+// R2: Span<uint32_t> (indices, filtered in place)
+// R3: Slab<uint32_t> (backing storage for indices)
+// R4: StoragePtr (column data pointer)
+
+void BM_BytecodeInterpreter_NonStringFilterUint32Gt(benchmark::State& state) {
+  FlexVector<uint32_t> data;
+  std::minstd_rand0 rnd(0);
+  for (uint32_t i = 0; i < kFilterTableSize; ++i) {
+    data.push_back(static_cast<uint32_t>(rnd() % 1000));
+  }
+  std::string bytecode_str = R"(
+    CastFilterValue<Uint32>: [fval_handle=FilterValue(0), write_register=Register(0), op=Op(4)]
+    InitRange: [size=1048576, dest_register=Register(1)]
+    AllocateIndices: [size=1048576, dest_slab_register=Register(3), dest_span_register=Register(2)]
+    Iota: [source_register=Register(1), update_register=Register(2)]
+    NonStringFilter<Uint32, Gt>: [storage_register=Register(4), val_register=Register(0), source_register=Register(2), update_register=Register(2)]
+  )";
+  RunFilterBenchmark<Uint32>(state, std::move(data), bytecode_str,
+                             {int64_t(500)});
+}
+BENCHMARK(BM_BytecodeInterpreter_NonStringFilterUint32Gt);
+
+// Same as above but with the filter split between state.range(0) threads.
+void BM_BytecodeInterpreter_NonStringFilterUint32GtParallel(
+    benchmark::State& state) {
+  FlexVector<uint32_t> data;
+  std::minstd_rand0 rnd(0);
+  for (uint32_t i = 0; i < kFilterTableSize; ++i) {
+    data.push_back(static_cast<uint32_t>(rnd() % 1000));
+  }
+  std::string bytecode_str = R"(
+    CastFilterValue<Uint32>: [fval_handle=FilterValue(0), write_register=Register(0), op=Op(4)]
+    InitRange: [size=1048576, dest_register=Register(1)]
+    AllocateIndices: [size=1048576, dest_slab_register=Register(3), dest_span_register=Register(2)]
+    Iota: [source_register=Register(1), update_register=Register(2)]
+    NonStringFilter<Uint32, Gt>: [storage_register=Register(4), val_register=Register(0), source_register=Register(2), update_register=Register(2)]
+  )";
+  std::unique_ptr<base::ThreadPool> pool =
+      util::MaybeCreateThreadPool(static_cast<uint32_t>(state.range(0)));
+  RunFilterBenchmark<Uint32>(state, std::move(data), bytecode_str,
+                             {int64_t(500)}, pool.get());
+}
+BENCHMARK(BM_BytecodeInterpreter_NonStringFilterUint32GtParallel)
+    ->Arg(1)
+    ->Arg(8)
+    ->Arg(16)
+    ->Arg(32);
+
+void BM_BytecodeInterpreter_NonStringFilterInt64Lt(benchmark::State& state) {
+  FlexVector<int64_t> data;
+  std::minstd_rand0 rnd(0);
+  for (uint32_t i = 0; i < kFilterTableSize; ++i) {
+    data.push_back(static_cast<int64_t>(rnd() % 1000));
+  }
+  std::string bytecode_str = R"(
+    CastFilterValue<Int64>: [fval_handle=FilterValue(0), write_register=Register(0), op=Op(2)]
+    InitRange: [size=1048576, dest_register=Register(1)]
+    AllocateIndices: [size=1048576, dest_slab_register=Register(3), dest_span_register=Register(2)]
+    Iota: [source_register=Register(1), update_register=Register(2)]
+    NonStringFilter<Int64, Lt>: [storage_register=Register(4), val_register=Register(0), source_register=Register(2), update_register=Register(2)]
+  )";
+  RunFilterBenchmark<Int64>(state, std::move(data), bytecode_str,
+                            {int64_t(500)});
+}
+BENCHMARK(BM_BytecodeInterpreter_NonStringFilterInt64Lt);
+
+void BM_BytecodeInterpreter_NonStringFilterDoubleGe(benchmark::State& state) {
+  FlexVector<double> data;
+  std::minstd_rand0 rnd(0);
+  for (uint32_t i = 0; i < kFilterTableSize; ++i) {
+    data.push_back(static_cast<double>(rnd() % 1000) / 10.0);
+  }
+  std::string bytecode_str = R"(
+    CastFilterValue<Double>: [fval_handle=FilterValue(0), write_register=Register(0), op=Op(5)]
+    InitRange: [size=1048576, dest_register=Register(1)]
+    AllocateIndices: [size=1048576, dest_slab_register=Register(3), dest_span_register=Register(2)]
+    Iota: [source_register=Register(1), update_register=Register(2)]
+    NonStringFilter<Double, Ge>: [storage_register=Register(4), val_register=Register(0), source_register=Register(2), update_register=Register(2)]
+  )";
+  RunFilterBenchmark<Double>(state, std::move(data), bytecode_str, {50.0});
+}
+BENCHMARK(BM_BytecodeInterpreter_NonStringFilterDoubleGe);
+
+void BM_BytecodeInterpreter_InInt64(benchmark::State& state) {
+  FlexVector<int64_t> data;
+  std::minstd_rand0 rnd(0);
+  for (uint32_t i = 0; i < kFilterTableSize; ++i) {
+    data.push_back(static_cast<int64_t>(rnd() % 8) << 32);
+  }
+  std::string bytecode_str = R"(
+    CastFilterValueList<Int64>: [fval_handle=FilterValue(0), write_register=Register(0), op=Op(0)]
+    InitRange: [size=1048576, dest_register=Register(1)]
+    AllocateIndices: [size=1048576, dest_slab_register=Register(3), dest_span_register=Register(2)]
+    Iota: [source_register=Register(1), update_register=Register(2)]
+    In<Int64>: [storage_register=Register(4), value_list_register=Register(0), source_register=Register(2), update_register=Register(2)]
+  )";
+  RunFilterBenchmark<Int64>(
+      state, std::move(data), bytecode_str,
+      {int64_t(0), int64_t(2) << 32, int64_t(4) << 32, int64_t(6) << 32});
+}
+BENCHMARK(BM_BytecodeInterpreter_InInt64);
+
 }  // namespace
 
 static void BM_BytecodeInterpreter_SortUint32(benchmark::State& state) {
@@ -23,16 +23,19 @@
 #include <optional>
 #include <string_view>
 #include <unordered_set>
+#include <vector>
 
 #include "perfetto/base/logging.h"
 #include "perfetto/ext/base/flat_hash_map.h"
 #include "perfetto/ext/base/string_view.h"
 #include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/containers/string_pool_trigram_index.h"
 #include "src/trace_processor/core/util/bit_vector.h"
 #include "src/trace_processor/core/util/slab.h"
 #include "src/trace_processor/core/util/sort.h"
 #include "src/trace_processor/core/util/span.h"
 #include "src/trace_processor/util/glob.h"
+#include "src/trace_processor/util/parallel_for.h"
 #include "src/trace_processor/util/regex.h"
 
 namespace perfetto::trace_processor::core::interpreter::ops {
@@ -69,11 +72,18 @@ struct BitVectorComparator {
   }
 };
 
+// Strings are interned so, rather than running the regex for every row, it
+// only runs once for each distinct string.
 struct RegexComparator {
   bool operator()(StringPool::Id lhs, const regex::Regex& r) const {
-    return r.Search(pool->Get(lhs).c_str());
+    auto [result, inserted] = results->Insert(lhs, false);
+    if (inserted) {
+      *result = r.Search(pool->Get(lhs).c_str());
+    }
+    return *result;
   }
   const StringPool* pool;
+  base::FlatHashMap<StringPool::Id, bool>* results;
 };
 
 }  // namespace
@@ -172,7 +182,60 @@ void DistinctImpl(const Slab<uint8_t>& buffer,
   indices.e = write_ptr;
 }
 
+uint32_t HashGroupByImpl(const Slab<uint8_t>& buffer,
+                         uint32_t stride,
+                         const Span<uint32_t>& indices,
+                         uint32_t* group_ids,
+                         uint32_t* groups) {
+  const uint8_t* row_ptr = buffer.data();
+  uint32_t group_count = 0;
+  auto assign = [&](auto& map, auto key, uint32_t row, uint32_t i) {
+    auto [group, inserted] = map.Insert(key, group_count);
+    if (inserted) {
+      groups[group_count++] = row;
+    }
+    group_ids[i] = *group;
+  };
+  auto count = static_cast<uint32_t>(indices.size());
+  if (stride <= sizeof(uint64_t)) {
+    // Most GROUP BYs are on a single column: in that case, the whole entry
+    // fits in an integer which is much cheaper to hash and compare than a
+    // string.
+    base::FlatHashMap<uint64_t, uint32_t> map;
+    for (uint32_t i = 0; i < count; ++i, row_ptr += stride) {
+      uint64_t key = 0;
+      memcpy(&key, row_ptr, stride);
+      assign(map, key, indices.b[i], i);
+    }
+  } else {
+    base::FlatHashMap<std::string_view, uint32_t> map;
+    for (uint32_t i = 0; i < count; ++i, row_ptr += stride) {
+      std::string_view key(reinterpret_cast<const char*>(row_ptr), stride);
+      assign(map, key, indices.b[i], i);
+    }
+  }
+  return group_count;
+}
+
+uint32_t SortedGroupByImpl(const Slab<uint8_t>& buffer,
+                           uint32_t stride,
+                           const Span<uint32_t>& indices,
+                           uint32_t* group_ids,
+                           uint32_t* groups) {
+  const uint8_t* row_ptr = buffer.data();
+  auto count = static_cast<uint32_t>(indices.size());
+  uint32_t group_count = 0;
+  for (uint32_t i = 0; i < count; ++i, row_ptr += stride) {
+    if (i == 0 || memcmp(row_ptr - stride, row_ptr, stride) != 0) {
+      groups[group_count++] = indices.b[i];
+    }
+    group_ids[i] = group_count - 1;
+  }
+  return group_count;
+}
+
 uint32_t* StringFilterGlobImpl(const StringPool* string_pool,
+                               StringPoolTrigramIndex* trigram_index,
                                const StringPool::Id* data,
                                const char* pattern,
                                const uint32_t* begin,
@@ -198,6 +261,33 @@ uint32_t* StringFilterGlobImpl(const StringPool* string_pool,
     return o_write;
   }
 
+  // If the pool is indexed, only the strings containing every literal part of
+  // the pattern need to be matched.
+  if (trigram_index && !string_pool->HasLargeString()) {
+    PERFETTO_DCHECK(trigram_index->pool() == string_pool);
+    trigram_index->Update();
+    std::optional<std::vector<StringPool::Id>> candidates =
+        trigram_index->FindCandidates(matcher.LiteralRuns());
+    if (candidates) {
+      if (candidates->empty()) {
+        return output;
+      }
+      if (size_t(end - begin) < candidates->size()) {
+        return ops::Filter(data, begin, end, output, matcher,
+                           GlobComparator{string_pool});
+      }
+      auto matches =
+          BitVector::CreateWithSize(string_pool->MaxSmallStringId().raw_id());
+      for (StringPool::Id id : *candidates) {
+        if (matcher.Matches(string_pool->Get(id))) {
+          matches.set(id.raw_id());
+        }
+      }
+      return ops::Filter(data, begin, end, output, matches,
+                         BitVectorComparator{});
+    }
+  }
+
   // For very big string pools (or small ranges) or pools with large
   // strings run a standard glob function.
   if (size_t(end - begin) < string_pool->size() ||
@@ -225,12 +315,55 @@ uint32_t* StringFilterRegexImpl(const StringPool* string_pool,
                                 const uint32_t* begin,
                                 const uint32_t* end,
                                 uint32_t* output) {
-  auto regex = regex::Regex::Create(pattern);
+  auto regex = regex::Regex::CreateCached(pattern);
   if (!regex.ok()) {
     return output;
   }
-  return ops::Filter(data, begin, end, output, regex.value(),
-                     RegexComparator{string_pool});
+  const regex::Regex& r = **regex;
+
+  // Same as for globs: unless the pool is bigger than the number of rows,
+  // pre-compute matches for all strings in the pool.
+  if (size_t(end - begin) < string_pool->size() ||
+      string_pool->HasLargeString()) {
+    base::FlatHashMap<StringPool::Id, bool> results;
+    return ops::Filter(data, begin, end, output, r,
+                       RegexComparator{string_pool, &results});
+  }
+  auto matches =
+      BitVector::CreateWithSize(string_pool->MaxSmallStringId().raw_id());
+  for (auto it = string_pool->CreateSmallStringIterator(); it; ++it) {
+    auto id = it.StringId();
+    if (!id.is_null()) {
+      matches.change_assume_unset(id.raw_id(),
+                                  r.Search(string_pool->Get(id).c_str()));
+    }
+  }
+  return ops::Filter(data, begin, end, output, matches, BitVectorComparator{});
+}
+
+uint32_t* MorselFilterImpl(
+    base::ThreadPool* pool,
+    uint32_t count,
+    uint32_t* output,
+    const std::function<uint32_t*(uint32_t, uint32_t, uint32_t*)>& filter) {
+  uint32_t morsels = (count + kFilterMorselSize - 1) / kFilterMorselSize;
+  std::vector<uint32_t*> ends(morsels);
+  util::ParallelFor(pool, morsels, [&](size_t i) {
+    uint32_t b = static_cast<uint32_t>(i) * kFilterMorselSize;
+    uint32_t e = std::min(count, b + kFilterMorselSize);
+    ends[i] = filter(b, e, output + b);
+  });
+
+  // Each morsel kept a prefix of its own slice of |output|: move them next to
+  // each other, in order.
+  uint32_t* out = ends[0];
+  for (uint32_t i = 1; i < morsels; ++i) {
+    uint32_t* begin = output + i * kFilterMorselSize;
+    auto kept = static_cast<size_t>(ends[i] - begin);
+    memmove(out, begin, kept * sizeof(uint32_t));
+    out += kept;
+  }
+  return out;
 }
 
 }  // namespace perfetto::trace_processor::core::interpreter::ops
@@ -38,6 +38,7 @@
 #include "perfetto/public/compiler.h"
 #include "src/trace_processor/containers/null_term_string_view.h"
 #include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/common/column_encoding.h"
 #include "src/trace_processor/core/common/null_types.h"
 #include "src/trace_processor/core/common/op_types.h"
 #include "src/trace_processor/core/common/storage_types.h"
@@ -46,6 +47,7 @@
 #include "src/trace_processor/core/interpreter/bytecode_interpreter_state.h"
 #include "src/trace_processor/core/interpreter/bytecode_registers.h"
 #include "src/trace_processor/core/interpreter/interpreter_types.h"
+#include "src/trace_processor/core/interpreter/simd_filter.h"
 #include "src/trace_processor/core/util/bit_vector.h"
 #include "src/trace_processor/core/util/flex_vector.h"
 #include "src/trace_processor/core/util/range.h"
@@ -55,27 +57,6 @@
 namespace perfetto::trace_processor::core::interpreter {
 namespace comparators {
 
-// Returns an appropriate comparator functor for the given integer/double type
-// and operation. Currently only supports equality comparison.
-template <typename T, typename Op>
-auto IntegerOrDoubleComparator() {
-  if constexpr (std::is_same_v<Op, Eq>) {
-    return std::equal_to<T>();
-  } else if constexpr (std::is_same_v<Op, Ne>) {
-    return std::not_equal_to<T>();
-  } else if constexpr (std::is_same_v<Op, Lt>) {
-    return std::less<T>();
-  } else if constexpr (std::is_same_v<Op, Le>) {
-    return std::less_equal<T>();
-  } else if constexpr (std::is_same_v<Op, Gt>) {
-    return std::greater<T>();
-  } else if constexpr (std::is_same_v<Op, Ge>) {
-    return std::greater_equal<T>();
-  } else {
-    static_assert(std::is_same_v<Op, Eq>, "Unsupported op");
-  }
-}
-
 template <typename T>
 struct StringComparator {
   bool operator()(StringPool::Id lhs, NullTermStringView rhs) const {
@@ -100,6 +81,28 @@ struct StringLessInvert {
   const StringPool* pool_;
 };
 
+// Returns whether a block with values in [min, max] may contain a value
+// matching `Op` against `val`.
+template <typename Op>
+struct ZoneMapComparator {
+  template <typename T, typename V>
+  PERFETTO_ALWAYS_INLINE bool operator()(T min, T max, V val) const {
+    if constexpr (std::is_same_v<Op, Eq>) {
+      return min <= val && val <= max;
+    } else if constexpr (std::is_same_v<Op, Lt>) {
+      return min < val;
+    } else if constexpr (std::is_same_v<Op, Le>) {
+      return min <= val;
+    } else if constexpr (std::is_same_v<Op, Gt>) {
+      return max > val;
+    } else if constexpr (std::is_same_v<Op, Ge>) {
+      return max >= val;
+    } else {
+      static_assert(std::is_same_v<Op, Eq>, "Unsupported op");
+    }
+  }
+};
+
 }  // namespace comparators
 
 namespace ops {
@@ -122,9 +125,28 @@ void DistinctImpl(const Slab<uint8_t>& buffer,
                   uint32_t stride,
                   Span<uint32_t>& indices);
 
-// Outlined implementation of glob filtering for strings.
+// Outlined implementation of HashGroupBy bytecode.
+// Writes the group of each row to `group_ids` and the first row of each group
+// to `groups`. Returns the number of groups.
+uint32_t HashGroupByImpl(const Slab<uint8_t>& buffer,
+                         uint32_t stride,
+                         const Span<uint32_t>& indices,
+                         uint32_t* group_ids,
+                         uint32_t* groups);
+
+// Outlined implementation of SortedGroupBy bytecode.
+// Same contract as HashGroupByImpl.
+uint32_t SortedGroupByImpl(const Slab<uint8_t>& buffer,
+                           uint32_t stride,
+                           const Span<uint32_t>& indices,
+                           uint32_t* group_ids,
+                           uint32_t* groups);
+
+// Outlined implementation of glob filtering for strings. |trigram_index| may
+// be null.
 // Returns pointer past last written output index.
 uint32_t* StringFilterGlobImpl(const StringPool* string_pool,
+                               StringPoolTrigramIndex* trigram_index,
                                const StringPool::Id* data,
                                const char* pattern,
                                const uint32_t* begin,
@@ -140,6 +162,40 @@ uint32_t* StringFilterRegexImpl(const StringPool* string_pool,
                                 const uint32_t* end,
                                 uint32_t* output);
 
+// Number of indices processed by each task when a filter is split into
+// morsels which run in parallel.
+inline constexpr uint32_t kFilterMorselSize = 64 * 1024;
+
+// Outlined implementation of MorselFilter for the parallel case.
+uint32_t* MorselFilterImpl(
+    base::ThreadPool* pool,
+    uint32_t count,
+    uint32_t* output,
+    const std::function<uint32_t*(uint32_t, uint32_t, uint32_t*)>& filter);
+
+// Runs a filter over the indices [0, count) of its input which writes the
+// indices it keeps to `output`.
+//
+// `filter(b, e, out)` must filter the inputs [b, e), write the kept indices
+// in order starting at `out` (which is always `output + b`) and return a
+// pointer one past the last index written: i.e. it must behave like an
+// in-place filter on its own slice of the buffer.
+//
+// If `pool` is non-null and there are at least two morsels of input, the
+// morsels are filtered in parallel and the kept indices are then compacted,
+// in order, to the start of `output`. Either way, the result is identical to
+// `filter(0, count, output)`. Returns a pointer one past the last kept index.
+template <typename FilterFn>
+PERFETTO_ALWAYS_INLINE uint32_t* MorselFilter(base::ThreadPool* pool,
+                                              uint32_t count,
+                                              uint32_t* output,
+                                              const FilterFn& filter) {
+  if (PERFETTO_LIKELY(!pool || count < 2 * kFilterMorselSize)) {
+    return filter(0u, count, output);
+  }
+  return MorselFilterImpl(pool, count, output, filter);
+}
+
 // Handles invalid cast filter value results for filtering operations.
 // If the cast result is invalid, updates the range or span accordingly.
 //
@@ -158,6 +214,56 @@ PERFETTO_ALWAYS_INLINE bool HandleInvalidCastFilterValueResult(
   return true;
 }
 
+// Returns the encoded storage in |reg| if the column is encoded and not yet
+// decoded, null otherwise. Filters use this to read the values of encoded
+// columns directly instead of decoding the whole column.
+inline PERFETTO_ALWAYS_INLINE const EncodedColumn* MaybeEncodedStorage(
+    const InterpreterState& state,
+    ReadHandle<StoragePtr> reg) {
+  return state.ReadFromRegister(reg).encoded;
+}
+
+// Same as simd::Filter but reads the values from an encoded column.
+template <typename Op, typename T>
+PERFETTO_NO_INLINE uint32_t* EncodedFilter(const EncodedColumn& encoded,
+                                           const uint32_t* begin,
+                                           const uint32_t* end,
+                                           uint32_t* output,
+                                           T value) {
+  const uint32_t* o_read = output;
+  uint32_t* o_write = output;
+  for (const uint32_t* it = begin; it != end; ++it, ++o_read) {
+    if (simd::ScalarCompare<Op>(static_cast<T>(encoded.Get(*it)), value)) {
+      *o_write++ = *o_read;
+    }
+  }
+  return o_write;
+}
+
+// Same as simd::LinearFilterEq but reads the values from an encoded column,
+// decoding them a block at a time.
+template <typename T>
+PERFETTO_NO_INLINE uint32_t* EncodedLinearFilterEq(const EncodedColumn& encoded,
+                                                   uint32_t begin,
+                                                   uint32_t end,
+                                                   T value,
+                                                   uint32_t* output) {
+  static constexpr uint32_t kBlockSize = 1024;
+  T block[kBlockSize];
+  uint32_t* o_write = output;
+  for (uint32_t b = begin; b < end; b += kBlockSize) {
+    uint32_t n = std::min(kBlockSize, end - b);
+    encoded.Decode(b, n, block);
+    uint32_t* block_out = o_write;
+    o_write = simd::LinearFilterEq(block, 0, n, value, o_write);
+    // The indices written are relative to |block|: rebase them on |b|.
+    for (uint32_t* it = block_out; it != o_write; ++it) {
+      *it += b;
+    }
+  }
+  return o_write;
+}
+
 // Filters an existing index buffer in-place, based on data comparisons
 // performed using a separate set of source indices.
 //
@@ -467,6 +573,239 @@ inline PERFETTO_ALWAYS_INLINE void Distinct(InterpreterState& state,
   DistinctImpl(buffer, stride, indices);
 }
 
+template <typename GroupByImpl>
+inline PERFETTO_ALWAYS_INLINE void GroupBy(
+    InterpreterState& state,
+    ReadHandle<Slab<uint8_t>> buffer_register,
+    uint32_t stride,
+    ReadHandle<Span<uint32_t>> indices_register,
+    WriteHandle<Slab<uint32_t>> group_ids_register,
+    RwHandle<Span<uint32_t>> groups_register,
+    GroupByImpl impl) {
+  const auto& indices = state.ReadFromRegister(indices_register);
+  auto& groups = state.ReadFromRegister(groups_register);
+  PERFETTO_DCHECK(indices.size() <= groups.size());
+
+  // Reuse the group ids from a previous execution if they are large enough.
+  auto* group_ids = state.MaybeReadFromRegister(group_ids_register);
+  if (!group_ids || group_ids->size() < indices.size()) {
+    state.WriteToRegister(group_ids_register,
+                          Slab<uint32_t>::Alloc(indices.size()));
+    group_ids = state.MaybeReadFromRegister(group_ids_register);
+  }
+  if (indices.empty()) {
+    groups.e = groups.b;
+    return;
+  }
+  const auto& buffer = state.ReadFromRegister(buffer_register);
+  groups.e =
+      groups.b + impl(buffer, stride, indices, group_ids->data(), groups.b);
+}
+
+inline PERFETTO_ALWAYS_INLINE void HashGroupBy(
+    InterpreterState& state,
+    const struct HashGroupBy& bytecode) {
+  using B = struct HashGroupBy;
+  GroupBy(state, bytecode.arg<B::buffer_register>(),
+          bytecode.arg<B::total_row_stride>(),
+          bytecode.arg<B::indices_register>(),
+          bytecode.arg<B::dest_group_ids_register>(),
+          bytecode.arg<B::groups_register>(), HashGroupByImpl);
+}
+
+inline PERFETTO_ALWAYS_INLINE void SortedGroupBy(
+    InterpreterState& state,
+    const struct SortedGroupBy& bytecode) {
+  using B = struct SortedGroupBy;
+  GroupBy(state, bytecode.arg<B::buffer_register>(),
+          bytecode.arg<B::total_row_stride>(),
+          bytecode.arg<B::indices_register>(),
+          bytecode.arg<B::dest_group_ids_register>(),
+          bytecode.arg<B::groups_register>(), SortedGroupByImpl);
+}
+
+inline PERFETTO_ALWAYS_INLINE void CountGroupRows(
+    InterpreterState& state,
+    const struct CountGroupRows& bytecode) {
+  using B = struct CountGroupRows;
+  const auto& indices =
+      state.ReadFromRegister(bytecode.arg<B::indices_register>());
+  const auto& group_ids =
+      state.ReadFromRegister(bytecode.arg<B::group_ids_register>());
+  const auto& groups =
+      state.ReadFromRegister(bytecode.arg<B::groups_register>());
+
+  AggregateValues res;
+  res.ints = Slab<int64_t>::Alloc(groups.size());
+  std::fill(res.ints.begin(), res.ints.end(), 0);
+  for (uint32_t i = 0; i < indices.size(); ++i) {
+    ++res.ints[group_ids[i]];
+  }
+  state.WriteToRegister(bytecode.arg<B::dest_register>(), std::move(res));
+}
+
+// Accumulates the non-null cells of a column into one value per group.
+//
+// `get_storage_index` returns the index into the column storage for a table
+// index or std::nullopt if the cell is null.
+template <typename T, typename Op, typename StorageIndexFn>
+inline PERFETTO_ALWAYS_INLINE void AggregateCells(
+    const typename T::cpp_type* data,
+    const Span<uint32_t>& indices,
+    const Slab<uint32_t>& group_ids,
+    StorageIndexFn get_storage_index,
+    AggregateValues& res) {
+  for (uint32_t i = 0; i < indices.size(); ++i) {
+    std::optional<uint32_t> storage_idx = get_storage_index(indices.b[i]);
+    if (!storage_idx) {
+      continue;
+    }
+    uint32_t group = group_ids[i];
+    if constexpr (std::is_same_v<Op, Count>) {
+      base::ignore_result(data);
+      ++res.ints[group];
+      continue;
+    } else {
+      bool first = !res.has_value[group];
+      res.has_value[group] = true;
+      if constexpr (std::is_same_v<T, Double>) {
+        double v = data[*storage_idx];
+        double& acc = res.doubles[group];
+        if constexpr (std::is_same_v<Op, Sum>) {
+          acc = first ? v : acc + v;
+        } else if constexpr (std::is_same_v<Op, Min>) {
+          acc = first || v < acc ? v : acc;
+        } else {
+          static_assert(std::is_same_v<Op, Max>, "Unsupported op");
+          acc = first || v > acc ? v : acc;
+        }
+      } else {
+        int64_t v;
+        if constexpr (std::is_same_v<T, Id>) {
+          base::ignore_result(data);
+          v = *storage_idx;
+        } else {
+          v = data[*storage_idx];
+        }
+        int64_t& acc = res.ints[group];
+        if constexpr (std::is_same_v<Op, Sum>) {
+          if (first) {
+            acc = v;
+          } else if (PERFETTO_UNLIKELY(__builtin_add_overflow(acc, v, &acc))) {
+            res.overflowed = true;
+          }
+        } else if constexpr (std::is_same_v<Op, Min>) {
+          acc = first || v < acc ? v : acc;
+        } else {
+          static_assert(std::is_same_v<Op, Max>, "Unsupported op");
+          acc = first || v > acc ? v : acc;
+        }
+      }
+    }
+  }
+}
+
+template <typename T, typename StorageIndexFn>
+inline PERFETTO_ALWAYS_INLINE void AggregateCellsForOp(
+    const AggregateOp& op,
+    const typename T::cpp_type* data,
+    const Span<uint32_t>& indices,
+    const Slab<uint32_t>& group_ids,
+    StorageIndexFn get_storage_index,
+    AggregateValues& res) {
+  switch (op.index()) {
+    case AggregateOp::GetTypeIndex<Count>():
+      AggregateCells<T, Count>(data, indices, group_ids, get_storage_index,
+                               res);
+      break;
+    case AggregateOp::GetTypeIndex<Sum>():
+      if constexpr (!std::is_same_v<T, String>) {
+        AggregateCells<T, Sum>(data, indices, group_ids, get_storage_index,
+                               res);
+        break;
+      }
+      PERFETTO_FATAL("Sum is not supported on string columns");
+    case AggregateOp::GetTypeIndex<Min>():
+      if constexpr (!std::is_same_v<T, String>) {
+        AggregateCells<T, Min>(data, indices, group_ids, get_storage_index,
+                               res);
+        break;
+      }
+      PERFETTO_FATAL("Min is not supported on string columns");
+    case AggregateOp::GetTypeIndex<Max>():
+      if constexpr (!std::is_same_v<T, String>) {
+        AggregateCells<T, Max>(data, indices, group_ids, get_storage_index,
+                               res);
+        break;
+      }
+      PERFETTO_FATAL("Max is not supported on string columns");
+    default:
+      PERFETTO_FATAL("Unknown aggregate op");
+  }
+}
+
+template <typename T, typename Nullability>
+inline PERFETTO_ALWAYS_INLINE void Aggregate(
+    InterpreterState& state,
+    const Aggregate<T, Nullability>& bytecode) {
+  using B = AggregateBase;
+  const auto& indices =
+      state.ReadFromRegister(bytecode.template arg<B::indices_register>());
+  const auto& group_ids =
+      state.ReadFromRegister(bytecode.template arg<B::group_ids_register>());
+  const auto& groups =
+      state.ReadFromRegister(bytecode.template arg<B::groups_register>());
+  const AggregateOp& op = bytecode.template arg<B::op>();
+  const auto* data = state.ReadStorageFromRegister<T>(
+      bytecode.template arg<B::storage_register>());
+
+  AggregateValues res;
+  if (!op.Is<Count>() && std::is_same_v<T, Double>) {
+    res.doubles = Slab<double>::Alloc(groups.size());
+  } else {
+    res.ints = Slab<int64_t>::Alloc(groups.size());
+    std::fill(res.ints.begin(), res.ints.end(), 0);
+  }
+  if (!op.Is<Count>()) {
+    res.has_value = Slab<uint8_t>::Alloc(groups.size());
+    std::fill(res.has_value.begin(), res.has_value.end(), 0);
+  }
+
+  if constexpr (std::is_same_v<Nullability, NonNull>) {
+    AggregateCellsForOp<T>(
+        op, data, indices, group_ids,
+        [](uint32_t idx) { return std::make_optional(idx); }, res);
+  } else if constexpr (std::is_same_v<Nullability, DenseNull>) {
+    const BitVector* bv =
+        state.ReadFromRegister(bytecode.template arg<B::null_bv_register>());
+    AggregateCellsForOp<T>(
+        op, data, indices, group_ids,
+        [bv](uint32_t idx) {
+          return bv->is_set(idx) ? std::make_optional(idx) : std::nullopt;
+        },
+        res);
+  } else if constexpr (std::is_same_v<Nullability, SparseNull>) {
+    const BitVector* bv =
+        state.ReadFromRegister(bytecode.template arg<B::null_bv_register>());
+    const auto& popcount =
+        state.ReadFromRegister(bytecode.template arg<B::popcount_register>());
+    AggregateCellsForOp<T>(
+        op, data, indices, group_ids,
+        [bv, &popcount](uint32_t idx) -> std::optional<uint32_t> {
+          if (!bv->is_set(idx)) {
+            return std::nullopt;
+          }
+          return popcount[idx / 64] + bv->count_set_bits_until_in_word(idx);
+        },
+        res);
+  } else {
+    static_assert(std::is_same_v<Nullability, NonNull>,
+                  "Unsupported Nullability type");
+  }
+  state.WriteToRegister(bytecode.template arg<B::dest_register>(),
+                        std::move(res));
+}
+
 inline PERFETTO_ALWAYS_INLINE void SortRowLayout(
     InterpreterState& state,
     const SortRowLayout& bytecode) {
@@ -959,21 +1298,80 @@ inline PERFETTO_ALWAYS_INLINE void NonStringFilter(
   const auto& source =
       state.ReadFromRegister(nf.template arg<B::source_register>());
   using M = StorageType::VariantTypeAtIndex<T, CastFilterValueResult::Value>;
+  const auto count = static_cast<uint32_t>(source.size());
   if constexpr (std::is_same_v<T, Id>) {
-    update.e = IdentityFilter(
-        source.b, source.e, update.b, base::unchecked_get<M>(value.value).value,
-        comparators::IntegerOrDoubleComparator<uint32_t, Op>());
+    const auto& val = base::unchecked_get<M>(value.value).value;
+    update.e = MorselFilter(
+        state.thread_pool, count, update.b,
+        [&source, &val](uint32_t b, uint32_t e, uint32_t* out) {
+          return simd::IdentityFilter<Op>(source.b + b, source.b + e, out,
+                                          val);
+        });
   } else if constexpr (IntegerOrDoubleType::Contains<T>()) {
+    const auto& val = base::unchecked_get<M>(value.value);
+    if (const EncodedColumn* encoded = MaybeEncodedStorage(
+            state, nf.template arg<B::storage_register>());
+        PERFETTO_UNLIKELY(encoded)) {
+      update.e = MorselFilter(
+          state.thread_pool, count, update.b,
+          [encoded, &source, &val](uint32_t b, uint32_t e, uint32_t* out) {
+            return EncodedFilter<Op>(*encoded, source.b + b, source.b + e, out,
+                                     val);
+          });
+      return;
+    }
     const auto* data = state.ReadStorageFromRegister<T>(
         nf.template arg<B::storage_register>());
-    update.e = Filter(data, source.b, source.e, update.b,
-                      base::unchecked_get<M>(value.value),
-                      comparators::IntegerOrDoubleComparator<M, Op>());
+    update.e = MorselFilter(
+        state.thread_pool, count, update.b,
+        [data, &source, &val](uint32_t b, uint32_t e, uint32_t* out) {
+          return simd::Filter<Op>(data, source.b + b, source.b + e, out, val);
+        });
   } else {
     static_assert(std::is_same_v<T, Id>, "Unsupported type");
   }
 }
 
+template <typename T, typename Op>
+inline PERFETTO_ALWAYS_INLINE void ZoneMapFilter(
+    InterpreterState& state,
+    const ::perfetto::trace_processor::core::interpreter::ZoneMapFilter<T, Op>&
+        zf) {
+  using B =
+      ::perfetto::trace_processor::core::interpreter::ZoneMapFilter<T, Op>;
+  const auto& value =
+      state.ReadFromRegister(zf.template arg<B::val_register>());
+  const auto& source =
+      state.ReadFromRegister(zf.template arg<B::source_register>());
+  auto& update = state.ReadFromRegister(zf.template arg<B::update_register>());
+  PERFETTO_DCHECK(source.size() <= update.size());
+  if (value.validity == CastFilterValueResult::kNoneMatch) {
+    update.e = update.b;
+    return;
+  }
+  bool all_match = value.validity == CastFilterValueResult::kAllMatch;
+
+  using M = StorageType::VariantTypeAtIndex<T, CastFilterValueResult::Value>;
+  const auto* bounds = state.ReadStorageFromRegister<T>(
+      zf.template arg<B::zone_map_register>());
+  const M& val = base::unchecked_get<M>(value.value);
+  const uint32_t block_size = zf.template arg<B::block_size>();
+  comparators::ZoneMapComparator<Op> may_match;
+  uint32_t* out = update.b;
+  for (uint32_t block = source.b / block_size; block * block_size < source.e;
+       ++block) {
+    if (!all_match &&
+        !may_match(bounds[2 * block], bounds[2 * block + 1], val)) {
+      continue;
+    }
+    uint32_t b = std::max(source.b, block * block_size);
+    uint32_t e = std::min(source.e, (block + 1) * block_size);
+    std::iota(out, out + (e - b), b);
+    out += e - b;
+  }
+  update.e = out;
+}
+
 inline PERFETTO_ALWAYS_INLINE uint32_t* StringFilterEq(
     const InterpreterState& state,
     const StringPool::Id* data,
@@ -987,8 +1385,8 @@ inline PERFETTO_ALWAYS_INLINE uint32_t* StringFilterEq(
     return output;
   }
   static_assert(sizeof(StringPool::Id) == 4, "Id should be 4 bytes");
-  return Filter(reinterpret_cast<const uint32_t*>(data), begin, end, output,
-                id->raw_id(), std::equal_to<>());
+  return simd::Filter<Eq>(reinterpret_cast<const uint32_t*>(data), begin, end,
+                          output, id->raw_id());
 }
 
 inline PERFETTO_ALWAYS_INLINE uint32_t* StringFilterNe(
@@ -1005,8 +1403,8 @@ inline PERFETTO_ALWAYS_INLINE uint32_t* StringFilterNe(
     return output + (end - begin);
   }
   static_assert(sizeof(StringPool::Id) == 4, "Id should be 4 bytes");
-  return Filter(reinterpret_cast<const uint32_t*>(data), begin, end, output,
-                id->raw_id(), std::not_equal_to<>());
+  return simd::Filter<Ne>(reinterpret_cast<const uint32_t*>(data), begin, end,
+                          output, id->raw_id());
 }
 
 template <typename Op>
@@ -1022,8 +1420,8 @@ inline PERFETTO_ALWAYS_INLINE uint32_t* FilterStringOp(
   } else if constexpr (std::is_same_v<Op, Ne>) {
     return StringFilterNe(state, data, begin, end, output, val);
   } else if constexpr (std::is_same_v<Op, Glob>) {
-    return StringFilterGlobImpl(state.string_pool, data, val, begin, end,
-                                output);
+    return StringFilterGlobImpl(state.string_pool, state.trigram_index, data,
+                                val, begin, end, output);
   } else if constexpr (std::is_same_v<Op, Regex>) {
     return StringFilterRegexImpl(state.string_pool, data, val, begin, end,
                                  output);
@@ -1127,6 +1525,51 @@ inline PERFETTO_ALWAYS_INLINE void NonIdSortedFilter(
   }
 }
 
+// Same as NonIdSortedFilter but binary searches an encoded column, decoding
+// only the values probed by the search.
+template <typename RangeOp, typename ValueType>
+PERFETTO_NO_INLINE void EncodedSortedFilter(const EncodedColumn& encoded,
+                                            ValueType val,
+                                            BoundModifier bound_modifier,
+                                            Range& update) {
+  auto at = [&encoded](uint32_t i) {
+    return static_cast<ValueType>(encoded.Get(i));
+  };
+  // Returns the first index in [b, e) for which |pred| is false, assuming
+  // |pred| is true for a prefix of the range.
+  auto partition_point = [](uint32_t b, uint32_t e, auto pred) {
+    while (b < e) {
+      uint32_t mid = b + (e - b) / 2;
+      if (pred(mid)) {
+        b = mid + 1;
+      } else {
+        e = mid;
+      }
+    }
+    return b;
+  };
+  auto lower_bound = [&](uint32_t b, uint32_t e) {
+    return partition_point(b, e, [&](uint32_t i) { return at(i) < val; });
+  };
+  auto upper_bound = [&](uint32_t b, uint32_t e) {
+    return partition_point(b, e, [&](uint32_t i) { return !(val < at(i)); });
+  };
+  if constexpr (std::is_same_v<RangeOp, EqualRange>) {
+    PERFETTO_DCHECK(bound_modifier.Is<BothBounds>());
+    uint32_t eq_start = lower_bound(update.b, update.e);
+    update.e = upper_bound(eq_start, update.e);
+    update.b = eq_start;
+  } else if constexpr (std::is_same_v<RangeOp, LowerBound>) {
+    auto& res = bound_modifier.Is<BeginBound>() ? update.b : update.e;
+    res = lower_bound(update.b, update.e);
+  } else if constexpr (std::is_same_v<RangeOp, UpperBound>) {
+    auto& res = bound_modifier.Is<BeginBound>() ? update.b : update.e;
+    res = upper_bound(update.b, update.e);
+  } else {
+    static_assert(std::is_same_v<RangeOp, EqualRange>, "Unsupported op");
+  }
+}
+
 template <typename T, typename RangeOp>
 inline PERFETTO_ALWAYS_INLINE void SortedFilter(
     InterpreterState& state,
@@ -1168,6 +1611,14 @@ inline PERFETTO_ALWAYS_INLINE void SortedFilter(
     }
   } else {
     BoundModifier bound_modifier = f.template arg<B::write_result_to>();
+    if constexpr (IntegerOrDoubleType::Contains<T>()) {
+      if (const EncodedColumn* encoded =
+              MaybeEncodedStorage(state, f.template arg<B::storage_register>());
+          PERFETTO_UNLIKELY(encoded)) {
+        EncodedSortedFilter<RangeOp>(*encoded, val, bound_modifier, update);
+        return;
+      }
+    }
     const auto* data =
         state.ReadStorageFromRegister<T>(f.template arg<B::storage_register>());
     NonIdSortedFilter<RangeOp>(state, data, val, bound_modifier, update);
@@ -1244,6 +1695,15 @@ inline PERFETTO_ALWAYS_INLINE void In(
     }
   }
   if constexpr (std::is_same_v<T, Id>) {
+    if (val.size() <= simd::kMaxVectorizedInListSize) {
+      uint32_t values[simd::kMaxVectorizedInListSize];
+      for (uint32_t i = 0; i < val.size(); ++i) {
+        values[i] = val[i].value;
+      }
+      update.e = simd::IdentityFilterIn(source.b, source.e, update.b, values,
+                                        static_cast<uint32_t>(val.size()));
+      return;
+    }
     struct Comparator {
       bool operator()(uint32_t lhs,
                       const FlexVector<CastFilterValueResult::Id>& rhs) const {
@@ -1259,18 +1719,16 @@ inline PERFETTO_ALWAYS_INLINE void In(
   } else {
     const auto* data =
         state.ReadStorageFromRegister<T>(f.template arg<B::storage_register>());
-    using D = std::remove_cv_t<std::remove_reference_t<decltype(*data)>>;
-    struct Comparator {
-      bool operator()(D lhs, const FlexVector<D>& rhs) const {
-        for (const auto& r : rhs) {
-          if (std::equal_to<>()(lhs, r)) {
-            return true;
-          }
-        }
-        return false;
-      }
-    };
-    update.e = Filter(data, source.b, source.e, update.b, val, Comparator());
+    if constexpr (std::is_same_v<T, String>) {
+      static_assert(sizeof(StringPool::Id) == 4, "Id should be 4 bytes");
+      update.e = simd::FilterIn(
+          reinterpret_cast<const uint32_t*>(data), source.b, source.e,
+          update.b, reinterpret_cast<const uint32_t*>(val.data()),
+          static_cast<uint32_t>(val.size()));
+    } else {
+      update.e = simd::FilterIn(data, source.b, source.e, update.b,
+                                val.data(), static_cast<uint32_t>(val.size()));
+    }
   }
 }
 
@@ -1294,12 +1752,26 @@ inline PERFETTO_ALWAYS_INLINE void LinearFilterEq(
     return;
   }
 
+  using M = StorageType::VariantTypeAtIndex<T, CastFilterValueResult::Value>;
+  const auto& value = base::unchecked_get<M>(res.value);
+  if constexpr (IntegerOrDoubleType::Contains<T>()) {
+    if (const EncodedColumn* encoded = MaybeEncodedStorage(
+            state, leq.template arg<B::storage_register>());
+        PERFETTO_UNLIKELY(encoded)) {
+      span.e = MorselFilter(
+          state.thread_pool, static_cast<uint32_t>(range.size()), span.b,
+          [encoded, &range, &value](uint32_t b, uint32_t e, uint32_t* out) {
+            return EncodedLinearFilterEq(*encoded, range.b + b, range.b + e,
+                                         value, out);
+          });
+      return;
+    }
+  }
+
   const auto* data =
       state.ReadStorageFromRegister<T>(leq.template arg<B::storage_register>());
 
   using Compare = std::remove_cv_t<std::remove_reference_t<decltype(*data)>>;
-  using M = StorageType::VariantTypeAtIndex<T, CastFilterValueResult::Value>;
-  const auto& value = base::unchecked_get<M>(res.value);
   Compare to_compare;
   if constexpr (std::is_same_v<T, String>) {
     auto id = state.string_pool->GetId(value);
@@ -1312,16 +1784,19 @@ inline PERFETTO_ALWAYS_INLINE void LinearFilterEq(
     to_compare = value;
   }
 
-  // Note to future readers: this can be optimized further with explicit SIMD
-  // but the compiler does a pretty good job even without it. For context,
-  // we're talking about query changing from 2s -> 1.6s on a 12m row table.
-  uint32_t* o_write = span.b;
-  for (uint32_t i = range.b; i < range.e; ++i) {
-    if (std::equal_to<>()(data[i], to_compare)) {
-      *o_write++ = i;
-    }
-  }
-  span.e = o_write;
+  span.e = MorselFilter(
+      state.thread_pool, static_cast<uint32_t>(range.size()), span.b,
+      [data, &range, &to_compare](uint32_t b, uint32_t e, uint32_t* out) {
+        if constexpr (std::is_same_v<T, String>) {
+          static_assert(sizeof(StringPool::Id) == 4, "Id should be 4 bytes");
+          return simd::LinearFilterEq(reinterpret_cast<const uint32_t*>(data),
+                                      range.b + b, range.b + e,
+                                      to_compare.raw_id(), out);
+        } else {
+          return simd::LinearFilterEq(data, range.b + b, range.b + e,
+                                      to_compare, out);
+        }
+      });
 }
 
 template <typename N>
@@ -21,6 +21,7 @@
 #include <cstring>
 
 #include <limits>
+#include <type_traits>
 #include <utility>
 
 #include "perfetto/base/compiler.h"
@@ -28,9 +29,19 @@
 #include "perfetto/ext/base/variant.h"
 #include "perfetto/public/compiler.h"
 #include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/common/column_encoding.h"
 #include "src/trace_processor/core/common/storage_types.h"
 #include "src/trace_processor/core/interpreter/bytecode_core.h"
 #include "src/trace_processor/core/interpreter/bytecode_registers.h"
+#include "src/trace_processor/core/util/slab.h"
+
+namespace perfetto::base {
+class ThreadPool;
+}  // namespace perfetto::base
+
+namespace perfetto::trace_processor {
+class StringPoolTrigramIndex;
+}  // namespace perfetto::trace_processor
 
 namespace perfetto::trace_processor::core::interpreter {
 
@@ -42,6 +53,15 @@ struct InterpreterState {
   base::SmallVector<RegValue, 16> registers;
   // Pointer to the string pool (for string operations)
   const StringPool* string_pool;
+  // Pool used to split large filters into morsels which run in parallel.
+  // Null if filters should run on the calling thread.
+  base::ThreadPool* thread_pool = nullptr;
+  // Index over |string_pool| used to speed up substring globs. Null if
+  // globs should match every string.
+  StringPoolTrigramIndex* trigram_index = nullptr;
+  // Decoded copies of the encoded storage registers read by bytecodes which
+  // need contiguous storage. See `ReadStorageFromRegister()`.
+  base::SmallVector<Slab<int64_t>, 2> decoded_storage;
 
   /******************************************************************
    * Helper functions for accessing the interpreter state           *
@@ -56,6 +76,7 @@ struct InterpreterState {
       registers.emplace_back();
     }
     string_pool = string_pool_;
+    decoded_storage.clear();
   }
 
   // Access a register for reading/writing with type safety through the
@@ -98,9 +119,33 @@ struct InterpreterState {
       ReadHandle<StoragePtr> reg) {
     // For Id columns, the register contains a StoragePtr with nullptr.
     // The caller is expected to handle this case (the row index IS the value).
+    if (PERFETTO_UNLIKELY(ReadFromRegister(reg).encoded)) {
+      return DecodeStorageRegister<T>(reg);
+    }
     return static_cast<const typename T::cpp_type*>(ReadFromRegister(reg).ptr);
   }
 
+  // Decodes the encoded storage in |reg| and rewrites the register to point
+  // to the decoded copy so that the decoding only happens once per cursor.
+  template <typename T>
+  PERFETTO_NO_INLINE const typename T::cpp_type* DecodeStorageRegister(
+      ReadHandle<StoragePtr> reg) {
+    using C = typename T::cpp_type;
+    auto& storage = base::unchecked_get<StoragePtr>(registers[reg.index]);
+    if constexpr (std::is_integral_v<C>) {
+      const EncodedColumn& encoded = *storage.encoded;
+      uint64_t words = (uint64_t{encoded.size()} * sizeof(C) + 7) / 8;
+      decoded_storage.emplace_back(Slab<int64_t>::Alloc(words));
+      auto* decoded = reinterpret_cast<C*>(decoded_storage.back().data());
+      encoded.Decode(0, encoded.size(), decoded);
+      storage.ptr = decoded;
+      storage.encoded = nullptr;
+      return decoded;
+    } else {
+      PERFETTO_FATAL("Only integer storage can be encoded");
+    }
+  }
+
   // Writes a value to the specified register, handling type safety through
   // the handle.
   template <typename T>
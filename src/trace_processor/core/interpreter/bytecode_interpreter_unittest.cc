@@ -33,9 +33,12 @@
 
 #include "perfetto/base/logging.h"
 #include "perfetto/ext/base/string_utils.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/ext/base/variant.h"
 #include "perfetto/public/compiler.h"
 #include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/containers/string_pool_trigram_index.h"
+#include "src/trace_processor/core/common/column_encoding.h"
 #include "src/trace_processor/core/common/duplicate_types.h"
 #include "src/trace_processor/core/common/op_types.h"
 #include "src/trace_processor/core/common/sort_types.h"
@@ -52,6 +55,7 @@
 #include "src/trace_processor/core/util/range.h"
 #include "src/trace_processor/core/util/slab.h"
 #include "src/trace_processor/core/util/span.h"
+#include "src/trace_processor/util/parallel_for.h"
 #include "src/trace_processor/util/regex.h"
 #include "test/gtest_and_gmock.h"
 
@@ -884,6 +888,10 @@ TEST_F(BytecodeInterpreterTest, StringFilter) {
   if constexpr (regex::IsRegexSupported()) {
     RunStringFilterSubTest("Regex ^d", "Regex", "^d",
                            {5, 6});  // Matches date, durian
+    RunStringFilterSubTest("Regex an", "Regex", "an",
+                           {3, 6});  // Matches banana, durian
+    RunStringFilterSubTest("Regex p{2}l", "Regex", "p{2}l", {1, 4});
+    RunStringFilterSubTest("Regex ^$", "Regex", "^$", {2});
   }
   RunStringFilterSubTest("Lt banana", "Lt", "banana",
                          {1, 2, 4});  // Matches apple, ""
@@ -928,6 +936,53 @@ TEST_F(BytecodeInterpreterTest, StringFilterNeStringNotInPool) {
   EXPECT_THAT(GetRegister<Span<uint32_t>>(2), ElementsAre(0, 1, 2, 3));
 }
 
+TEST_F(BytecodeInterpreterTest, StringFilterGlobTrigramIndex) {
+  std::vector<StringPool::Id> ids;
+  for (const char* str :
+       {"binder transaction", "binder reply", "Choreographer#doFrame",
+        "bin der", "HIDL::IBinder", "", "binder transaction async"}) {
+    ids.push_back(spool_.InternString(str));
+  }
+  FlexVector<StringPool::Id> column;
+  for (uint32_t i = 0; i < 100; ++i) {
+    column.push_back(ids[(i * 7u) % ids.size()]);
+  }
+  std::vector<uint32_t> all(column.size());
+  std::iota(all.begin(), all.end(), 0u);
+  AddColumn(dataframe::Column{std::move(column),
+                              dataframe::NullStorage::NonNull{}, Unsorted{},
+                              HasDuplicates{}});
+
+  StringPoolTrigramIndex index(&spool_);
+  auto run = [&](const char* pattern, StringPoolTrigramIndex* idx,
+                 std::vector<uint32_t> indices) {
+    SetupInterpreterWithBytecode(ParseBytecodeToVec(
+        "StringFilter<Glob>: [storage_register=Register(3), "
+        "val_register=Register(0), source_register=Register(1), "
+        "update_register=Register(2)]"));
+    interpreter_->SetStringPoolTrigramIndex(idx);
+    SetRegisterValuesForTesting(
+        interpreter_.get(), std::make_integer_sequence<uint32_t, 4>(),
+        CastFilterValueResult::Valid(pattern), GetSpan(indices),
+        GetSpan(indices), GetStoragePtr<String>(0));
+    Execute();
+    const auto& res = GetRegister<Span<uint32_t>>(2);
+    return std::vector<uint32_t>(res.b, res.e);
+  };
+  for (const char* pattern :
+       {"*binder*", "binder*", "*binder", "*bin*der*", "*Bind?r*",
+        "*[bB]inder*", "*transaction*async", "*frame*", "*", "bin der",
+        "*nd*"}) {
+    // Check both when there are more rows than candidate strings and the
+    // other way around.
+    for (uint32_t rows : {100u, 2u}) {
+      std::vector<uint32_t> indices(all.begin(), all.begin() + rows);
+      EXPECT_EQ(run(pattern, &index, indices), run(pattern, nullptr, indices))
+          << pattern << " " << rows;
+    }
+  }
+}
+
 TEST_F(BytecodeInterpreterTest, NullFilter) {
   // Create a BitVector representing nulls: 0=null, 1=not_null, 2=null,
   // 3=not_null, ...
@@ -1282,6 +1337,68 @@ TEST_F(BytecodeInterpreterTest, NonStringFilterInPlace) {
               ElementsAre(101u, 103u));  // Indices 101 and 103 are kept
 }
 
+TEST_F(BytecodeInterpreterTest, NonStringFilterParallel) {
+  // Enough rows for several morsels, with the last one partially filled.
+  const uint32_t kRows = 5 * ops::kFilterMorselSize + 123;
+  std::vector<uint32_t> data(kRows);
+  for (uint32_t i = 0; i < kRows; ++i) {
+    data[i] = (i * 7919u) % 100u;
+  }
+  std::vector<uint32_t> expected;
+  for (uint32_t i = 0; i < kRows; ++i) {
+    if (data[i] < 10u) {
+      expected.push_back(i);
+    }
+  }
+
+  std::unique_ptr<base::ThreadPool> pool = util::MaybeCreateThreadPool(4);
+  std::vector<uint32_t> update_indices(kRows);
+  std::string bytecode =
+      "NonStringFilter<Uint32, Lt>: [storage_register=Register(2), "
+      "val_register=Register(0), source_register=Register(1), "
+      "update_register=Register(1)]";
+  SetupInterpreterWithBytecode(ParseBytecodeToVec(bytecode));
+  interpreter_->SetThreadPool(pool.get());
+  std::iota(update_indices.begin(), update_indices.end(), 0u);
+  SetRegisterValuesForTesting(
+      interpreter_.get(), std::make_integer_sequence<uint32_t, 3>(),
+      CastFilterValueResult::Valid(10u), GetSpan(update_indices),
+      StoragePtr{data.data(), Uint32{}});
+  Execute();
+  EXPECT_THAT(GetRegister<Span<uint32_t>>(1), ElementsAreArray(expected));
+}
+
+TEST_F(BytecodeInterpreterTest, ZoneMapFilter) {
+  // Interleaved (min, max) of three blocks of four rows.
+  std::vector<int64_t> bounds = {0, 9, 10, 19, 0, 5};
+  std::vector<uint32_t> update_indices(12);
+
+  SetRegistersAndExecute(
+      "ZoneMapFilter<Int64, Ge>: [zone_map_register=Register(3), "
+      "val_register=Register(0), source_register=Register(1), "
+      "update_register=Register(2), block_size=4]",
+      CastFilterValueResult::Valid(int64_t(10)), Range{2u, 11u},
+      GetSpan(update_indices), StoragePtr{bounds.data(), Int64{}});
+  EXPECT_THAT(GetRegister<Span<uint32_t>>(2), ElementsAre(4u, 5u, 6u, 7u));
+
+  SetRegistersAndExecute(
+      "ZoneMapFilter<Int64, Lt>: [zone_map_register=Register(3), "
+      "val_register=Register(0), source_register=Register(1), "
+      "update_register=Register(2), block_size=4]",
+      CastFilterValueResult::Valid(int64_t(3)), Range{2u, 11u},
+      GetSpan(update_indices), StoragePtr{bounds.data(), Int64{}});
+  EXPECT_THAT(GetRegister<Span<uint32_t>>(2),
+              ElementsAre(2u, 3u, 8u, 9u, 10u));
+
+  SetRegistersAndExecute(
+      "ZoneMapFilter<Int64, Eq>: [zone_map_register=Register(3), "
+      "val_register=Register(0), source_register=Register(1), "
+      "update_register=Register(2), block_size=4]",
+      CastFilterValueResult::NoneMatch(), Range{2u, 11u},
+      GetSpan(update_indices), StoragePtr{bounds.data(), Int64{}});
+  EXPECT_THAT(GetRegister<Span<uint32_t>>(2), IsEmpty());
+}
+
 TEST_F(BytecodeInterpreterTest, Uint32SetIdSortedEq) {
   // Data conforming to SetIdSorted: `data[v] == v` for the first occurrence of
   // v. Index:  0  1  2  3  4  5  6  7  8  9  10 Value:  0  0  0  3  3  5  5  7
@@ -1522,6 +1639,99 @@ TEST_F(BytecodeInterpreterTest, Distinct_OneNonNullCol_SimpleDuplicates) {
   EXPECT_THAT(GetRegister<Span<uint32_t>>(0), ElementsAre(0, 1, 3));
 }
 
+TEST_F(BytecodeInterpreterTest, HashGroupBy_CountAndSum) {
+  AddColumn(CreateNonNullColumn<int32_t, int32_t>({10, 20, 10, 30, 20},
+                                                  Unsorted{}, HasDuplicates{}));
+  AddColumn(CreateNonNullColumn<int64_t, int64_t>({1, 2, 3, 4, 5}, Unsorted{},
+                                                  NoDuplicates{}));
+
+  // Register layout:
+  // 0: indices span, 1: groups span, 2: buffer
+  // 3: storage col0, 4: null_bv col0 (nullptr for NonNull)
+  // 5: storage col1, 6: null_bv col1 (nullptr for NonNull)
+  // 7: group ids, 8: count result, 9: sum result
+  std::string bytecode_sequence = R"(
+    AllocateRowLayoutBuffer: [buffer_size=20, dest_buffer_register=Register(2)]
+    CopyToRowLayout<Int32, NonNull>: [storage_register=Register(3), null_bv_register=Register(4), source_indices_register=Register(0), dest_buffer_register=Register(2), row_layout_offset=0, row_layout_stride=4, invert_copied_bits=0, popcount_register=Register(4294967295), rank_map_register=Register(4294967295)]
+    HashGroupBy: [buffer_register=Register(2), total_row_stride=4, indices_register=Register(0), dest_group_ids_register=Register(7), groups_register=Register(1)]
+    CountGroupRows: [indices_register=Register(0), group_ids_register=Register(7), groups_register=Register(1), dest_register=Register(8)]
+    Aggregate<Int64, NonNull>: [storage_register=Register(5), null_bv_register=Register(6), popcount_register=Register(4294967295), indices_register=Register(0), group_ids_register=Register(7), groups_register=Register(1), op=AggregateOp(1), dest_register=Register(9)]
+  )";
+
+  std::vector<uint32_t> indices = {0, 1, 2, 3, 4};
+  std::vector<uint32_t> groups(indices.size());
+  SetRegistersAndExecute(bytecode_sequence, GetSpan(indices), GetSpan(groups),
+                         Empty{}, GetStoragePtr<Int32>(0), GetNullBv(0),
+                         GetStoragePtr<Int64>(1), GetNullBv(1));
+  EXPECT_THAT(GetRegister<Span<uint32_t>>(1), ElementsAre(0, 1, 3));
+  EXPECT_THAT(GetRegister<AggregateValues>(8).ints, ElementsAre(2, 2, 1));
+
+  const auto& sum = GetRegister<AggregateValues>(9);
+  EXPECT_THAT(sum.ints, ElementsAre(4, 7, 4));
+  EXPECT_THAT(sum.has_value, ElementsAre(1, 1, 1));
+  EXPECT_FALSE(sum.overflowed);
+}
+
+TEST_F(BytecodeInterpreterTest, SortedGroupBy_MinMaxDenseNull) {
+  AddColumn(CreateNonNullColumn<uint32_t, uint32_t>(
+      {1, 1, 2, 2, 3}, Sorted{}, HasDuplicates{}));
+  AddColumn(CreateDenseNullableColumn<double>(
+      {5.0, 2.0, std::nullopt, 1.0, std::nullopt}, Unsorted{},
+      HasDuplicates{}));
+
+  // Register layout:
+  // 0: indices span, 1: groups span, 2: buffer
+  // 3: storage col0, 4: null_bv col0 (nullptr for NonNull)
+  // 5: storage col1, 6: null_bv col1
+  // 7: group ids, 8: min result, 9: max result
+  std::string bytecode_sequence = R"(
+    AllocateRowLayoutBuffer: [buffer_size=20, dest_buffer_register=Register(2)]
+    CopyToRowLayout<Uint32, NonNull>: [storage_register=Register(3), null_bv_register=Register(4), source_indices_register=Register(0), dest_buffer_register=Register(2), row_layout_offset=0, row_layout_stride=4, invert_copied_bits=0, popcount_register=Register(4294967295), rank_map_register=Register(4294967295)]
+    SortedGroupBy: [buffer_register=Register(2), total_row_stride=4, indices_register=Register(0), dest_group_ids_register=Register(7), groups_register=Register(1)]
+    Aggregate<Double, DenseNull>: [storage_register=Register(5), null_bv_register=Register(6), popcount_register=Register(4294967295), indices_register=Register(0), group_ids_register=Register(7), groups_register=Register(1), op=AggregateOp(2), dest_register=Register(8)]
+    Aggregate<Double, DenseNull>: [storage_register=Register(5), null_bv_register=Register(6), popcount_register=Register(4294967295), indices_register=Register(0), group_ids_register=Register(7), groups_register=Register(1), op=AggregateOp(3), dest_register=Register(9)]
+  )";
+
+  std::vector<uint32_t> indices = {0, 1, 2, 3, 4};
+  std::vector<uint32_t> groups(indices.size());
+  SetRegistersAndExecute(bytecode_sequence, GetSpan(indices), GetSpan(groups),
+                         Empty{}, GetStoragePtr<Uint32>(0), GetNullBv(0),
+                         GetStoragePtr<Double>(1), GetNullBv(1));
+  EXPECT_THAT(GetRegister<Span<uint32_t>>(1), ElementsAre(0, 2, 4));
+
+  const auto& min = GetRegister<AggregateValues>(8);
+  EXPECT_THAT(min.has_value, ElementsAre(1, 1, 0));
+  EXPECT_EQ(min.doubles[0], 2.0);
+  EXPECT_EQ(min.doubles[1], 1.0);
+
+  const auto& max = GetRegister<AggregateValues>(9);
+  EXPECT_THAT(max.has_value, ElementsAre(1, 1, 0));
+  EXPECT_EQ(max.doubles[0], 5.0);
+  EXPECT_EQ(max.doubles[1], 1.0);
+}
+
+TEST_F(BytecodeInterpreterTest, Aggregate_SumOverflow) {
+  AddColumn(CreateNonNullColumn<int64_t, int64_t>(
+      {std::numeric_limits<int64_t>::max(), 1}, Unsorted{}, NoDuplicates{}));
+
+  // Register layout:
+  // 0: indices span, 1: groups span, 2: buffer
+  // 3: storage col0, 4: null_bv col0 (nullptr for NonNull)
+  // 5: group ids, 6: sum result
+  std::string bytecode_sequence = R"(
+    AllocateRowLayoutBuffer: [buffer_size=0, dest_buffer_register=Register(2)]
+    HashGroupBy: [buffer_register=Register(2), total_row_stride=0, indices_register=Register(0), dest_group_ids_register=Register(5), groups_register=Register(1)]
+    Aggregate<Int64, NonNull>: [storage_register=Register(3), null_bv_register=Register(4), popcount_register=Register(4294967295), indices_register=Register(0), group_ids_register=Register(5), groups_register=Register(1), op=AggregateOp(1), dest_register=Register(6)]
+  )";
+
+  std::vector<uint32_t> indices = {0, 1};
+  std::vector<uint32_t> groups(indices.size());
+  SetRegistersAndExecute(bytecode_sequence, GetSpan(indices), GetSpan(groups),
+                         Empty{}, GetStoragePtr<Int64>(0), GetNullBv(0));
+  EXPECT_THAT(GetRegister<Span<uint32_t>>(1), ElementsAre(0));
+  EXPECT_TRUE(GetRegister<AggregateValues>(6).overflowed);
+}
+
 TEST_F(BytecodeInterpreterTest, LimitOffsetIndicesCombined) {
   std::vector<uint32_t> initial_indices(20);
   std::iota(initial_indices.begin(), initial_indices.end(), 0);
@@ -1835,6 +2045,38 @@ TEST_F(BytecodeInterpreterTest, LinearFilterEq_HandleInvalidCast_AllMatch) {
   EXPECT_THAT(GetRegister<Span<uint32_t>>(3), ElementsAre(0u, 1u, 2u));
 }
 
+TEST_F(BytecodeInterpreterTest, LinearFilterEq_Parallel) {
+  const uint32_t kRows = 3 * ops::kFilterMorselSize + 17;
+  std::vector<uint32_t> data(kRows);
+  for (uint32_t i = 0; i < kRows; ++i) {
+    data[i] = i % 5u;
+  }
+  // Start the range part way through the column to check that morsels are
+  // offset correctly.
+  Range source_range{11, kRows};
+  std::vector<uint32_t> expected;
+  for (uint32_t i = source_range.b; i < source_range.e; ++i) {
+    if (data[i] == 3u) {
+      expected.push_back(i);
+    }
+  }
+
+  std::unique_ptr<base::ThreadPool> pool = util::MaybeCreateThreadPool(4);
+  std::vector<uint32_t> update_data(kRows);
+  std::string bytecode_str =
+      "LinearFilterEq<Uint32>: [storage_register=Register(4), "
+      "filter_value_reg=Register(0), popcount_register=Register(1), "
+      "source_register=Register(2), update_register=Register(3)]";
+  SetupInterpreterWithBytecode(ParseBytecodeToVec(bytecode_str));
+  interpreter_->SetThreadPool(pool.get());
+  SetRegisterValuesForTesting(
+      interpreter_.get(), std::make_integer_sequence<uint32_t, 5>(),
+      CastFilterValueResult::Valid(3u), Slab<uint32_t>::Alloc(0), source_range,
+      GetSpan(update_data), StoragePtr{data.data(), Uint32{}});
+  Execute();
+  EXPECT_THAT(GetRegister<Span<uint32_t>>(3), ElementsAreArray(expected));
+}
+
 TEST_F(BytecodeInterpreterTest, CollectIdIntoRankMap) {
   AddColumn(CreateSparseNullableStringColumn(
       {std::make_optional("apple"), std::nullopt, std::make_optional("banana")},
@@ -2145,6 +2387,99 @@ TEST_F(BytecodeInterpreterTest, InUint32BitVector) {
   }
 }
 
+TEST_F(BytecodeInterpreterTest, InInt64) {
+  std::string bytecode =
+      "In<Int64>: [storage_register=Register(3), "
+      "value_list_register=Register(0), "
+      "source_register=Register(1), update_register=Register(2)]";
+
+  auto values = CreateFlexVectorForTesting<int64_t>(
+      {-5, 1ll << 40, 7, -5, 0, 1ll << 40, 9, 7, 3, -5, 11});
+  AddColumn(dataframe::Column{std::move(values),
+                              dataframe::NullStorage::NonNull{}, Unsorted{},
+                              HasDuplicates{}});
+
+  // More indices than fit in a register so both the vectorized loop and the
+  // scalar tail are exercised.
+  std::vector<uint32_t> indices = {10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0};
+  CastFilterValueListResult value_list;
+  value_list.validity = CastFilterValueResult::kValid;
+  value_list.value_list =
+      CreateFlexVectorForTesting<int64_t>({-5, 1ll << 40, 11});
+  SetRegistersAndExecute(bytecode, std::move(value_list), GetSpan(indices),
+                         GetSpan(indices), GetStoragePtr<Int64>(0));
+  EXPECT_THAT(GetRegister<Span<uint32_t>>(2), ElementsAre(10, 9, 5, 3, 1, 0));
+}
+
+TEST_F(BytecodeInterpreterTest, EncodedStorageFilteredWithoutDecoding) {
+  auto values = CreateFlexVectorForTesting<int64_t>(
+      {100, 104, 105, 105, 105, 106, 110, 110});
+  std::optional<EncodedColumn> encoded = EncodedColumn::Encode(values);
+  ASSERT_TRUE(encoded);
+  StoragePtr storage{nullptr, Int64{}, &*encoded};
+  {
+    SetRegistersAndExecute(
+        "SortedFilter<Int64, EqualRange>: [storage_register=Register(2), "
+        "val_register=Register(0), update_register=Register(1), "
+        "write_result_to=BoundModifier(0)]",
+        CastFilterValueResult::Valid(int64_t(105)), Range{0u, 8u}, storage);
+    const auto& result = GetRegister<Range>(1);
+    EXPECT_EQ(result.b, 2u);
+    EXPECT_EQ(result.e, 5u);
+    EXPECT_EQ(GetRegister<StoragePtr>(2).encoded, &*encoded);
+  }
+  {
+    std::vector<uint32_t> indices = {7, 0, 5, 3};
+    SetRegistersAndExecute(
+        "NonStringFilter<Int64, Gt>: [storage_register=Register(3), "
+        "val_register=Register(0), source_register=Register(1), "
+        "update_register=Register(2)]",
+        CastFilterValueResult::Valid(int64_t(105)), GetSpan(indices),
+        GetSpan(indices), storage);
+    EXPECT_THAT(GetRegister<Span<uint32_t>>(2), ElementsAre(7u, 5u));
+    EXPECT_EQ(GetRegister<StoragePtr>(3).encoded, &*encoded);
+  }
+  {
+    std::vector<uint32_t> update_data(8);
+    SetRegistersAndExecute(
+        "LinearFilterEq<Int64>: [storage_register=Register(4), "
+        "filter_value_reg=Register(0), popcount_register=Register(1), "
+        "source_register=Register(2), update_register=Register(3)]",
+        CastFilterValueResult::Valid(int64_t(105)), Slab<uint32_t>::Alloc(0),
+        Range{1u, 8u}, GetSpan(update_data), storage);
+    EXPECT_THAT(GetRegister<Span<uint32_t>>(3), ElementsAre(2u, 3u, 4u));
+    EXPECT_EQ(GetRegister<StoragePtr>(4).encoded, &*encoded);
+  }
+}
+
+TEST_F(BytecodeInterpreterTest, EncodedStorageDecodedOnDemand) {
+  auto values = CreateFlexVectorForTesting<int64_t>(
+      {-5, 1ll << 40, 7, -5, 0, 1ll << 40, 9, 7, 3, -5, 11});
+  std::optional<EncodedColumn> encoded = EncodedColumn::Encode(values);
+  ASSERT_TRUE(encoded);
+
+  std::vector<uint32_t> indices = {10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0};
+  CastFilterValueListResult value_list;
+  value_list.validity = CastFilterValueResult::kValid;
+  value_list.value_list =
+      CreateFlexVectorForTesting<int64_t>({-5, 1ll << 40, 11});
+  SetRegistersAndExecute(
+      "In<Int64>: [storage_register=Register(3), "
+      "value_list_register=Register(0), "
+      "source_register=Register(1), update_register=Register(2)]",
+      std::move(value_list), GetSpan(indices), GetSpan(indices),
+      StoragePtr{nullptr, Int64{}, &*encoded});
+  EXPECT_THAT(GetRegister<Span<uint32_t>>(2), ElementsAre(10, 9, 5, 3, 1, 0));
+
+  // In has no encoded implementation so the storage was decoded and the
+  // register now points to the decoded copy.
+  const auto& storage = GetRegister<StoragePtr>(3);
+  EXPECT_EQ(storage.encoded, nullptr);
+  const auto* decoded = static_cast<const int64_t*>(storage.ptr);
+  ASSERT_NE(decoded, nullptr);
+  EXPECT_TRUE(std::equal(values.begin(), values.end(), decoded));
+}
+
 TEST_F(BytecodeInterpreterTest, CastFilterValueList_Uint32) {
   fetcher_.value.emplace_back(int64_t(10));
   fetcher_.value.emplace_back(int64_t(20));
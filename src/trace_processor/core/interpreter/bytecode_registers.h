@@ -25,6 +25,7 @@
 #include "perfetto/base/build_config.h"
 #include "perfetto/ext/base/flat_hash_map.h"
 #include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/common/column_encoding.h"
 #include "src/trace_processor/core/common/storage_types.h"
 #include "src/trace_processor/core/interpreter/interpreter_types.h"
 #include "src/trace_processor/core/util/bit_vector.h"
@@ -101,6 +102,27 @@ using StringIdToRankMap =
 struct StoragePtr {
   const void* ptr;
   StorageType type;
+  // If set, the storage is encoded and `ptr` is null: bytecodes either read
+  // the encoded values directly or call `ReadStorageFromRegister()`, which
+  // decodes them on first use.
+  const EncodedColumn* encoded = nullptr;
+};
+
+// Per-group results of an aggregation.
+struct AggregateValues {
+  // The value of the aggregate for each group. Exactly one of these is
+  // populated: `doubles` for aggregates over double columns and `ints` for
+  // everything else (including all counts).
+  Slab<int64_t> ints;
+  Slab<double> doubles;
+
+  // For each group, whether at least one non-null cell contributed to the
+  // value (i.e. whether the value is non-null). Empty if the value can never
+  // be null.
+  Slab<uint8_t> has_value;
+
+  // Set if summing integers overflowed for any group.
+  bool overflowed = false;
 };
 
 // Values that can be stored in a register.
@@ -114,7 +136,8 @@ using RegValue = std::variant<Empty,
                               StringIdToRankMap,
                               StoragePtr,
                               const BitVector*,
-                              Span<const uint32_t>>;
+                              Span<const uint32_t>,
+                              AggregateValues>;
 
 }  // namespace perfetto::trace_processor::core::interpreter
 
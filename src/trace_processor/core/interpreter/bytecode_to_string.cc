@@ -24,6 +24,7 @@
 #include "perfetto/base/logging.h"
 #include "perfetto/ext/base/string_utils.h"
 #include "perfetto/ext/base/variant.h"
+#include "src/trace_processor/core/common/aggregate_types.h"
 #include "src/trace_processor/core/common/sort_types.h"
 #include "src/trace_processor/core/interpreter/bytecode_instructions.h"
 #include "src/trace_processor/core/interpreter/bytecode_registers.h"
@@ -60,6 +61,10 @@ base::StackString<64> ArgToString(NullsLocation location) {
   return base::StackString<64>("NullsLocation(%u)", location.index());
 }
 
+base::StackString<64> ArgToString(AggregateOp op) {
+  return base::StackString<64>("AggregateOp(%u)", op.index());
+}
+
 void BytecodeFieldToString(std::string_view name,
                            const char* value,
                            std::vector<std::string>& fields) {
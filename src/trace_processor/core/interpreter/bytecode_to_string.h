@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "perfetto/ext/base/string_utils.h"
+#include "src/trace_processor/core/common/aggregate_types.h"
 #include "src/trace_processor/core/common/sort_types.h"
 #include "src/trace_processor/core/interpreter/bytecode_registers.h"
 #include "src/trace_processor/core/interpreter/interpreter_types.h"
@@ -39,6 +40,7 @@ base::StackString<64> ArgToString(FilterValueHandle value);
 base::StackString<64> ArgToString(BoundModifier bound);
 base::StackString<64> ArgToString(SortDirection direction);
 base::StackString<64> ArgToString(NullsLocation location);
+base::StackString<64> ArgToString(AggregateOp op);
 void BytecodeFieldToString(std::string_view name,
                            const char* value,
                            std::vector<std::string>& fields);
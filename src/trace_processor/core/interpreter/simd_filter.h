@@ -0,0 +1,463 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_CORE_INTERPRETER_SIMD_FILTER_H_
+#define SRC_TRACE_PROCESSOR_CORE_INTERPRETER_SIMD_FILTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "perfetto/base/build_config.h"
+#include "perfetto/base/compiler.h"
+#include "src/trace_processor/core/common/op_types.h"
+
+#if PERFETTO_BUILDFLAG(PERFETTO_X64_CPU_OPT)
+#include <immintrin.h>
+#endif
+
+// Vectorized kernels backing the filtering bytecodes (NonStringFilter,
+// LinearFilterEq and In).
+//
+// When built with PERFETTO_X64_CPU_OPT (which implies AVX2 and is verified
+// against the running CPU at startup by CheckCpuOptimizations() in
+// src/base/utils.cc), each kernel compares a full register of values per
+// instruction and compress-stores the surviving row indices using a
+// permutation lookup table. Any tail which does not fill a register, and all
+// input in builds without the flag, goes through the scalar loop.
+//
+// Every kernel has the same semantics as its scalar counterpart in
+// bytecode_interpreter_impl.h (including NaN handling for doubles) and
+// supports in-place filtering, i.e. |output| may alias the indices being
+// read.
+namespace perfetto::trace_processor::core::interpreter::simd {
+
+// The largest IN list which is checked by comparing against every value in
+// registers; larger lists are handled by the scalar loop.
+inline constexpr uint32_t kMaxVectorizedInListSize = 16;
+
+// Returns whether |Op| is satisfied by |lhs| and |rhs|.
+template <typename Op, typename T>
+PERFETTO_ALWAYS_INLINE bool ScalarCompare(T lhs, T rhs) {
+  if constexpr (std::is_same_v<Op, Eq>) {
+    return lhs == rhs;
+  } else if constexpr (std::is_same_v<Op, Ne>) {
+    return lhs != rhs;
+  } else if constexpr (std::is_same_v<Op, Lt>) {
+    return lhs < rhs;
+  } else if constexpr (std::is_same_v<Op, Le>) {
+    return lhs <= rhs;
+  } else if constexpr (std::is_same_v<Op, Gt>) {
+    return lhs > rhs;
+  } else if constexpr (std::is_same_v<Op, Ge>) {
+    return lhs >= rhs;
+  } else {
+    static_assert(std::is_same_v<Op, Eq>, "Unsupported op");
+  }
+}
+
+namespace internal {
+
+#if PERFETTO_BUILDFLAG(PERFETTO_X64_CPU_OPT)
+
+// For each 8-bit mask, the positions of the set bits packed at the front.
+// Used as the permutation which moves the selected lanes of a register to the
+// front before storing it.
+struct CompressTable {
+  constexpr CompressTable() : lanes() {
+    for (uint32_t mask = 0; mask < 256; ++mask) {
+      uint32_t count = 0;
+      for (uint8_t bit = 0; bit < 8; ++bit) {
+        if (mask & (1u << bit)) {
+          lanes[mask][count++] = bit;
+        }
+      }
+    }
+  }
+  alignas(8) uint8_t lanes[256][8];
+};
+inline constexpr CompressTable kCompressTable{};
+
+// Stores the lanes of |v| selected by |mask| contiguously at |out|. All eight
+// lanes are written so |out| must have space for eight values.
+PERFETTO_ALWAYS_INLINE inline uint32_t* CompressStore(__m256i v,
+                                                      uint32_t mask,
+                                                      uint32_t* out) {
+  __m128i packed = _mm_loadl_epi64(
+      reinterpret_cast<const __m128i*>(kCompressTable.lanes[mask]));
+  __m256i perm = _mm256_cvtepu8_epi32(packed);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+                      _mm256_permutevar8x32_epi32(v, perm));
+  return out + _mm_popcnt_u32(mask);
+}
+
+// Four lane version of the above.
+PERFETTO_ALWAYS_INLINE inline uint32_t* CompressStore(__m128i v,
+                                                      uint32_t mask,
+                                                      uint32_t* out) {
+  int32_t lanes;
+  memcpy(&lanes, kCompressTable.lanes[mask], sizeof(lanes));
+  __m128i perm = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(lanes));
+  __m128 res = _mm_permutevar_ps(_mm_castsi128_ps(v), perm);
+  _mm_storeu_ps(reinterpret_cast<float*>(out), res);
+  return out + _mm_popcnt_u32(mask);
+}
+
+// Integer comparisons in terms of the equality and greater-than primitives
+// AVX2 provides. Only correct for integers: for doubles the negated forms
+// would match NaNs.
+template <typename Op, typename L>
+PERFETTO_ALWAYS_INLINE uint32_t IntegerCompare(typename L::Vec a,
+                                               typename L::Vec b) {
+  constexpr uint32_t kAll = (1u << L::kLanes) - 1;
+  if constexpr (std::is_same_v<Op, Eq>) {
+    return L::Eq(a, b);
+  } else if constexpr (std::is_same_v<Op, Ne>) {
+    return L::Eq(a, b) ^ kAll;
+  } else if constexpr (std::is_same_v<Op, Lt>) {
+    return L::Gt(b, a);
+  } else if constexpr (std::is_same_v<Op, Le>) {
+    return L::Gt(a, b) ^ kAll;
+  } else if constexpr (std::is_same_v<Op, Gt>) {
+    return L::Gt(a, b);
+  } else if constexpr (std::is_same_v<Op, Ge>) {
+    return L::Gt(b, a) ^ kAll;
+  } else {
+    static_assert(std::is_same_v<Op, Eq>, "Unsupported op");
+  }
+}
+
+// Per-type register operations. Gathers use signed 32-bit offsets: this is
+// fine as columns never have 2^31 rows.
+template <typename T>
+struct Lanes;
+
+template <>
+struct Lanes<int32_t> {
+  static constexpr uint32_t kLanes = 8;
+  using Vec = __m256i;
+
+  static Vec Splat(int32_t v) { return _mm256_set1_epi32(v); }
+  static Vec Load(const int32_t* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  }
+  static Vec Gather(const int32_t* data, const uint32_t* idx) {
+    return _mm256_i32gather_epi32(
+        data, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx)), 4);
+  }
+  static uint32_t Eq(Vec a, Vec b) {
+    return static_cast<uint32_t>(
+        _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))));
+  }
+  static uint32_t Gt(Vec a, Vec b) {
+    return static_cast<uint32_t>(
+        _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(a, b))));
+  }
+  template <typename Op>
+  static uint32_t Compare(Vec a, Vec b) {
+    return IntegerCompare<Op, Lanes<int32_t>>(a, b);
+  }
+};
+
+// Unsigned values are flipped into signed order by toggling the sign bit so
+// the signed AVX2 comparisons can be used.
+template <>
+struct Lanes<uint32_t> {
+  static constexpr uint32_t kLanes = 8;
+  using Vec = __m256i;
+
+  static Vec Bias(Vec v) {
+    return _mm256_xor_si256(v, _mm256_set1_epi32(INT32_MIN));
+  }
+  static Vec Splat(uint32_t v) {
+    return Bias(_mm256_set1_epi32(static_cast<int32_t>(v)));
+  }
+  static Vec Load(const uint32_t* p) {
+    return Bias(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+  }
+  static Vec Gather(const uint32_t* data, const uint32_t* idx) {
+    return Bias(_mm256_i32gather_epi32(
+        reinterpret_cast<const int32_t*>(data),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx)), 4));
+  }
+  static uint32_t Eq(Vec a, Vec b) { return Lanes<int32_t>::Eq(a, b); }
+  static uint32_t Gt(Vec a, Vec b) { return Lanes<int32_t>::Gt(a, b); }
+  template <typename Op>
+  static uint32_t Compare(Vec a, Vec b) {
+    return IntegerCompare<Op, Lanes<uint32_t>>(a, b);
+  }
+};
+
+template <>
+struct Lanes<int64_t> {
+  static constexpr uint32_t kLanes = 4;
+  using Vec = __m256i;
+
+  static Vec Splat(int64_t v) { return _mm256_set1_epi64x(v); }
+  static Vec Load(const int64_t* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  }
+  static Vec Gather(const int64_t* data, const uint32_t* idx) {
+    return _mm256_i32gather_epi64(
+        reinterpret_cast<const long long*>(data),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(idx)), 8);
+  }
+  static uint32_t Eq(Vec a, Vec b) {
+    return static_cast<uint32_t>(
+        _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(a, b))));
+  }
+  static uint32_t Gt(Vec a, Vec b) {
+    return static_cast<uint32_t>(
+        _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(a, b))));
+  }
+  template <typename Op>
+  static uint32_t Compare(Vec a, Vec b) {
+    return IntegerCompare<Op, Lanes<int64_t>>(a, b);
+  }
+};
+
+// Doubles use the ordered predicates (and unordered for Ne) so NaNs behave
+// exactly like the C++ comparison operators.
+template <>
+struct Lanes<double> {
+  static constexpr uint32_t kLanes = 4;
+  using Vec = __m256d;
+
+  static Vec Splat(double v) { return _mm256_set1_pd(v); }
+  static Vec Load(const double* p) { return _mm256_loadu_pd(p); }
+  static Vec Gather(const double* data, const uint32_t* idx) {
+    return _mm256_i32gather_pd(
+        data, _mm_loadu_si128(reinterpret_cast<const __m128i*>(idx)), 8);
+  }
+  template <typename Op>
+  static uint32_t Compare(Vec a, Vec b) {
+    if constexpr (std::is_same_v<Op, Eq>) {
+      return Mask(_mm256_cmp_pd(a, b, _CMP_EQ_OQ));
+    } else if constexpr (std::is_same_v<Op, Ne>) {
+      return Mask(_mm256_cmp_pd(a, b, _CMP_NEQ_UQ));
+    } else if constexpr (std::is_same_v<Op, Lt>) {
+      return Mask(_mm256_cmp_pd(a, b, _CMP_LT_OQ));
+    } else if constexpr (std::is_same_v<Op, Le>) {
+      return Mask(_mm256_cmp_pd(a, b, _CMP_LE_OQ));
+    } else if constexpr (std::is_same_v<Op, Gt>) {
+      return Mask(_mm256_cmp_pd(a, b, _CMP_GT_OQ));
+    } else if constexpr (std::is_same_v<Op, Ge>) {
+      return Mask(_mm256_cmp_pd(a, b, _CMP_GE_OQ));
+    } else {
+      static_assert(std::is_same_v<Op, Eq>, "Unsupported op");
+    }
+  }
+  static uint32_t Mask(Vec v) {
+    return static_cast<uint32_t>(_mm256_movemask_pd(v));
+  }
+};
+
+// Loads |L::kLanes| row indices starting at |p|.
+template <typename L>
+PERFETTO_ALWAYS_INLINE auto LoadIndices(const uint32_t* p) {
+  if constexpr (L::kLanes == 8) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  } else {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  }
+}
+
+// Returns the row indices [i, i + L::kLanes).
+template <typename L>
+PERFETTO_ALWAYS_INLINE auto IotaIndices(uint32_t i) {
+  if constexpr (L::kLanes == 8) {
+    return _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(i)),
+                            _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  } else {
+    return _mm_add_epi32(_mm_set1_epi32(static_cast<int32_t>(i)),
+                         _mm_setr_epi32(0, 1, 2, 3));
+  }
+}
+
+#endif  // PERFETTO_BUILDFLAG(PERFETTO_X64_CPU_OPT)
+
+// Shared implementation of Filter and IdentityFilter: when |kIdentity| is
+// true, the values compared are the indices in [begin, end) themselves.
+template <bool kIdentity, typename Op, typename T>
+PERFETTO_ALWAYS_INLINE uint32_t* FilterImpl(const T* data,
+                                            const uint32_t* begin,
+                                            const uint32_t* end,
+                                            uint32_t* output,
+                                            T value) {
+  const uint32_t* it = begin;
+  const uint32_t* o_read = output;
+  uint32_t* o_write = output;
+#if PERFETTO_BUILDFLAG(PERFETTO_X64_CPU_OPT)
+  using L = Lanes<T>;
+  constexpr std::ptrdiff_t kLanes = L::kLanes;
+  const auto splat = L::Splat(value);
+  for (; end - it >= kLanes; it += kLanes, o_read += kLanes) {
+    typename L::Vec v;
+    if constexpr (kIdentity) {
+      v = L::Load(it);
+    } else {
+      v = L::Gather(data, it);
+    }
+    uint32_t mask = L::template Compare<Op>(v, splat);
+    o_write = CompressStore(LoadIndices<L>(o_read), mask, o_write);
+  }
+#endif
+  for (; it != end; ++it, ++o_read) {
+    T lhs;
+    if constexpr (kIdentity) {
+      lhs = *it;
+    } else {
+      lhs = data[*it];
+    }
+    if (ScalarCompare<Op>(lhs, value)) {
+      *o_write++ = *o_read;
+    }
+  }
+  return o_write;
+}
+
+// Shared implementation of FilterIn and IdentityFilterIn.
+template <bool kIdentity, typename T>
+PERFETTO_ALWAYS_INLINE uint32_t* FilterInImpl(const T* data,
+                                              const uint32_t* begin,
+                                              const uint32_t* end,
+                                              uint32_t* output,
+                                              const T* values,
+                                              uint32_t count) {
+  const uint32_t* it = begin;
+  const uint32_t* o_read = output;
+  uint32_t* o_write = output;
+#if PERFETTO_BUILDFLAG(PERFETTO_X64_CPU_OPT)
+  using L = Lanes<T>;
+  constexpr std::ptrdiff_t kLanes = L::kLanes;
+  if (count <= kMaxVectorizedInListSize) {
+    typename L::Vec splats[kMaxVectorizedInListSize];
+    for (uint32_t i = 0; i < count; ++i) {
+      splats[i] = L::Splat(values[i]);
+    }
+    for (; end - it >= kLanes; it += kLanes, o_read += kLanes) {
+      typename L::Vec v;
+      if constexpr (kIdentity) {
+        v = L::Load(it);
+      } else {
+        v = L::Gather(data, it);
+      }
+      uint32_t mask = 0;
+      for (uint32_t i = 0; i < count; ++i) {
+        mask |= L::template Compare<Eq>(v, splats[i]);
+      }
+      o_write = CompressStore(LoadIndices<L>(o_read), mask, o_write);
+    }
+  }
+#endif
+  for (; it != end; ++it, ++o_read) {
+    T lhs;
+    if constexpr (kIdentity) {
+      lhs = *it;
+    } else {
+      lhs = data[*it];
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      if (lhs == values[i]) {
+        *o_write++ = *o_read;
+        break;
+      }
+    }
+  }
+  return o_write;
+}
+
+}  // namespace internal
+
+// Writes every index i in [begin, end) for which |data[i] == value| to
+// |output|, which must have space for |end - begin| indices.
+template <typename T>
+[[nodiscard]] PERFETTO_ALWAYS_INLINE uint32_t* LinearFilterEq(
+    const T* data,
+    uint32_t begin,
+    uint32_t end,
+    T value,
+    uint32_t* output) {
+  uint32_t i = begin;
+  uint32_t* o_write = output;
+#if PERFETTO_BUILDFLAG(PERFETTO_X64_CPU_OPT)
+  using L = internal::Lanes<T>;
+  const auto splat = L::Splat(value);
+  for (; end - i >= L::kLanes; i += L::kLanes) {
+    uint32_t mask = L::template Compare<Eq>(L::Load(data + i), splat);
+    o_write =
+        internal::CompressStore(internal::IotaIndices<L>(i), mask, o_write);
+  }
+#endif
+  for (; i < end; ++i) {
+    if (data[i] == value) {
+      *o_write++ = i;
+    }
+  }
+  return o_write;
+}
+
+// Keeps the entries of |output| whose corresponding index in [begin, end)
+// points at a value in |data| satisfying |Op| against |value|. Returns a
+// pointer one past the last index kept.
+template <typename Op, typename T>
+[[nodiscard]] PERFETTO_ALWAYS_INLINE uint32_t* Filter(const T* data,
+                                                      const uint32_t* begin,
+                                                      const uint32_t* end,
+                                                      uint32_t* output,
+                                                      T value) {
+  return internal::FilterImpl<false, Op>(data, begin, end, output, value);
+}
+
+// Same as Filter but compares the indices in [begin, end) themselves.
+template <typename Op>
+[[nodiscard]] PERFETTO_ALWAYS_INLINE uint32_t* IdentityFilter(
+    const uint32_t* begin,
+    const uint32_t* end,
+    uint32_t* output,
+    uint32_t value) {
+  return internal::FilterImpl<true, Op, uint32_t>(nullptr, begin, end, output,
+                                                  value);
+}
+
+// Same as Filter but keeps entries whose value is equal to any of the |count|
+// values in |values|.
+template <typename T>
+[[nodiscard]] PERFETTO_ALWAYS_INLINE uint32_t* FilterIn(const T* data,
+                                                        const uint32_t* begin,
+                                                        const uint32_t* end,
+                                                        uint32_t* output,
+                                                        const T* values,
+                                                        uint32_t count) {
+  return internal::FilterInImpl<false>(data, begin, end, output, values,
+                                       count);
+}
+
+// Same as FilterIn but compares the indices in [begin, end) themselves.
+[[nodiscard]] PERFETTO_ALWAYS_INLINE inline uint32_t* IdentityFilterIn(
+    const uint32_t* begin,
+    const uint32_t* end,
+    uint32_t* output,
+    const uint32_t* values,
+    uint32_t count) {
+  return internal::FilterInImpl<true, uint32_t>(nullptr, begin, end, output,
+                                                values, count);
+}
+
+}  // namespace perfetto::trace_processor::core::interpreter::simd
+
+#endif  // SRC_TRACE_PROCESSOR_CORE_INTERPRETER_SIMD_FILTER_H_
@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/core/interpreter/simd_filter.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "src/trace_processor/core/common/op_types.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor::core::interpreter::simd {
+namespace {
+
+using testing::ElementsAreArray;
+
+// Row counts chosen to exercise empty input, partial registers, full
+// registers and full registers followed by a tail.
+constexpr uint32_t kSizes[] = {0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 31, 64, 101};
+
+template <typename T>
+std::vector<T> Values();
+
+template <>
+std::vector<uint32_t> Values() {
+  return {0, 1, 2, 3, 0x7fffffff, 0x80000000, 0xffffffff};
+}
+template <>
+std::vector<int32_t> Values() {
+  return {std::numeric_limits<int32_t>::min(), -2, -1, 0, 1, 2,
+          std::numeric_limits<int32_t>::max()};
+}
+template <>
+std::vector<int64_t> Values() {
+  return {std::numeric_limits<int64_t>::min(), -(int64_t(1) << 40), -1, 0, 1,
+          int64_t(1) << 40, std::numeric_limits<int64_t>::max()};
+}
+template <>
+std::vector<double> Values() {
+  return {-std::numeric_limits<double>::infinity(), -1.5, -0.0, 0.0, 1.5,
+          std::numeric_limits<double>::quiet_NaN()};
+}
+
+// Column of |size| values drawn from Values<T>().
+template <typename T>
+std::vector<T> MakeColumn(uint32_t size, std::minstd_rand0& rnd) {
+  std::vector<T> values = Values<T>();
+  std::vector<T> col(size);
+  for (auto& v : col) {
+    v = values[rnd() % values.size()];
+  }
+  return col;
+}
+
+// Shuffled indices into a column of |size| rows.
+std::vector<uint32_t> MakeIndices(uint32_t size, std::minstd_rand0& rnd) {
+  std::vector<uint32_t> indices(size);
+  std::iota(indices.begin(), indices.end(), 0u);
+  std::shuffle(indices.begin(), indices.end(), rnd);
+  return indices;
+}
+
+template <typename Op, typename T>
+void CheckFilter() {
+  std::minstd_rand0 rnd(42);
+  for (uint32_t size : kSizes) {
+    std::vector<T> col = MakeColumn<T>(size, rnd);
+    std::vector<uint32_t> indices = MakeIndices(size, rnd);
+    for (T value : Values<T>()) {
+      std::vector<uint32_t> expected;
+      for (uint32_t idx : indices) {
+        if (ScalarCompare<Op>(col[idx], value)) {
+          expected.push_back(idx);
+        }
+      }
+      // Filter in place, as the interpreter does.
+      std::vector<uint32_t> output = indices;
+      uint32_t* end = Filter<Op>(col.data(), output.data(),
+                                 output.data() + output.size(), output.data(),
+                                 value);
+      output.resize(static_cast<size_t>(end - output.data()));
+      ASSERT_THAT(output, ElementsAreArray(expected)) << "size=" << size;
+    }
+  }
+}
+
+template <typename T>
+void CheckAllOps() {
+  CheckFilter<Eq, T>();
+  CheckFilter<Ne, T>();
+  CheckFilter<Lt, T>();
+  CheckFilter<Le, T>();
+  CheckFilter<Gt, T>();
+  CheckFilter<Ge, T>();
+}
+
+TEST(SimdFilterTest, FilterUint32) {
+  CheckAllOps<uint32_t>();
+}
+
+TEST(SimdFilterTest, FilterInt32) {
+  CheckAllOps<int32_t>();
+}
+
+TEST(SimdFilterTest, FilterInt64) {
+  CheckAllOps<int64_t>();
+}
+
+TEST(SimdFilterTest, FilterDouble) {
+  CheckAllOps<double>();
+}
+
+TEST(SimdFilterTest, FilterSeparateOutput) {
+  std::vector<int64_t> col = {5, 1, 5, 2, 5, 3, 5, 4, 5, 5};
+  std::vector<uint32_t> indices(col.size());
+  std::iota(indices.begin(), indices.end(), 0u);
+  std::vector<uint32_t> output(col.size());
+  std::iota(output.begin(), output.end(), 100u);
+  uint32_t* end =
+      Filter<Eq>(col.data(), indices.data(), indices.data() + indices.size(),
+                 output.data(), int64_t(5));
+  output.resize(static_cast<size_t>(end - output.data()));
+  ASSERT_THAT(output, ElementsAreArray({100u, 102u, 104u, 106u, 108u, 109u}));
+}
+
+TEST(SimdFilterTest, IdentityFilter) {
+  for (uint32_t size : kSizes) {
+    std::minstd_rand0 rnd(size);
+    std::vector<uint32_t> indices = MakeIndices(size, rnd);
+    std::vector<uint32_t> expected;
+    for (uint32_t idx : indices) {
+      if (idx >= size / 2) {
+        expected.push_back(idx);
+      }
+    }
+    std::vector<uint32_t> output = indices;
+    uint32_t* end = IdentityFilter<Ge>(output.data(),
+                                       output.data() + output.size(),
+                                       output.data(), size / 2);
+    output.resize(static_cast<size_t>(end - output.data()));
+    ASSERT_THAT(output, ElementsAreArray(expected)) << "size=" << size;
+  }
+}
+
+template <typename T>
+void CheckLinearFilterEq() {
+  std::minstd_rand0 rnd(7);
+  for (uint32_t size : kSizes) {
+    std::vector<T> col = MakeColumn<T>(size, rnd);
+    for (uint32_t begin : {0u, 1u, size / 3}) {
+      if (begin > size) {
+        continue;
+      }
+      for (T value : Values<T>()) {
+        std::vector<uint32_t> expected;
+        for (uint32_t i = begin; i < size; ++i) {
+          if (col[i] == value) {
+            expected.push_back(i);
+          }
+        }
+        std::vector<uint32_t> output(size - begin);
+        uint32_t* end =
+            LinearFilterEq(col.data(), begin, size, value, output.data());
+        output.resize(static_cast<size_t>(end - output.data()));
+        ASSERT_THAT(output, ElementsAreArray(expected))
+            << "size=" << size << " begin=" << begin;
+      }
+    }
+  }
+}
+
+TEST(SimdFilterTest, LinearFilterEq) {
+  CheckLinearFilterEq<uint32_t>();
+  CheckLinearFilterEq<int32_t>();
+  CheckLinearFilterEq<int64_t>();
+  CheckLinearFilterEq<double>();
+}
+
+template <typename T>
+void CheckFilterIn(uint32_t list_size) {
+  std::minstd_rand0 rnd(list_size);
+  std::vector<T> values = Values<T>();
+  std::vector<T> list;
+  for (uint32_t i = 0; i < list_size; ++i) {
+    list.push_back(values[rnd() % values.size()]);
+  }
+  for (uint32_t size : kSizes) {
+    std::vector<T> col = MakeColumn<T>(size, rnd);
+    std::vector<uint32_t> indices = MakeIndices(size, rnd);
+    std::vector<uint32_t> expected;
+    for (uint32_t idx : indices) {
+      if (std::find(list.begin(), list.end(), col[idx]) != list.end()) {
+        expected.push_back(idx);
+      }
+    }
+    std::vector<uint32_t> output = indices;
+    uint32_t* end = FilterIn(col.data(), output.data(),
+                             output.data() + output.size(), output.data(),
+                             list.data(), list_size);
+    output.resize(static_cast<size_t>(end - output.data()));
+    ASSERT_THAT(output, ElementsAreArray(expected)) << "size=" << size;
+  }
+}
+
+TEST(SimdFilterTest, FilterIn) {
+  // Cover empty lists, lists checked in registers and lists which are too
+  // large to be.
+  for (uint32_t list_size : {0u, 1u, 3u, kMaxVectorizedInListSize,
+                             kMaxVectorizedInListSize + 1}) {
+    CheckFilterIn<uint32_t>(list_size);
+    CheckFilterIn<int32_t>(list_size);
+    CheckFilterIn<int64_t>(list_size);
+    CheckFilterIn<double>(list_size);
+  }
+}
+
+TEST(SimdFilterTest, IdentityFilterIn) {
+  std::vector<uint32_t> indices(37);
+  std::iota(indices.begin(), indices.end(), 0u);
+  std::vector<uint32_t> list = {36, 0, 9, 8, 100};
+  uint32_t* end =
+      IdentityFilterIn(indices.data(), indices.data() + indices.size(),
+                       indices.data(), list.data(),
+                       static_cast<uint32_t>(list.size()));
+  indices.resize(static_cast<size_t>(end - indices.data()));
+  ASSERT_THAT(indices, ElementsAreArray({0u, 8u, 9u, 36u}));
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor::core::interpreter::simd
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_CORE_UTIL_BIT_PACKED_VECTOR_H_
+#define SRC_TRACE_PROCESSOR_CORE_UTIL_BIT_PACKED_VECTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/public/compiler.h"
+#include "src/trace_processor/core/util/slab.h"
+
+namespace perfetto::trace_processor::core {
+
+// A fixed size vector of unsigned integers, each stored using exactly
+// `bit_width` bits (between 0 and 64) packed back to back into 64-bit words.
+//
+// Used to store integers which are known to have a small range (e.g. after
+// subtracting a base value) using much less memory than their native type.
+//
+// Random access is O(1): a value is assembled from at most two adjacent words
+// with no branches. For reading many consecutive values, `Unpack` should be
+// preferred as it avoids recomputing the word/bit offset for every value.
+//
+// Usage example:
+//   BitPackedVector vec(/*bit_width=*/5, /*size=*/100);
+//   vec.Set(0, 17);
+//   uint64_t x = vec.Get(0);  // x == 17
+class BitPackedVector {
+ public:
+  // Returns the number of bits required to represent `max_value`.
+  static constexpr uint32_t BitWidthFor(uint64_t max_value) {
+    uint32_t width = 0;
+    for (; width < 64 && (max_value >> width) != 0; ++width) {
+    }
+    return width;
+  }
+
+  // Creates an empty vector.
+  BitPackedVector() = default;
+
+  // Creates a vector of `size` zero values, each `bit_width` bits wide.
+  BitPackedVector(uint32_t bit_width, uint32_t size)
+      : bit_width_(bit_width),
+        size_(size),
+        mask_(bit_width == 64 ? ~0ull : (1ull << bit_width) - 1) {
+    PERFETTO_DCHECK(bit_width <= 64);
+    // An extra word is always allocated so that `Get` can unconditionally
+    // read the word following the one containing the start of the value.
+    uint64_t words = (uint64_t(bit_width) * size + 63) / 64 + 2;
+    words_ = Slab<uint64_t>::Alloc(words);
+    memset(words_.data(), 0, words * sizeof(uint64_t));
+  }
+
+  // Sets the value at index `i` to `value`. `value` must fit in `bit_width`
+  // bits.
+  PERFETTO_ALWAYS_INLINE void Set(uint32_t i, uint64_t value) {
+    PERFETTO_DCHECK(i < size_);
+    PERFETTO_DCHECK((value & ~mask_) == 0);
+    if (bit_width_ == 0) {
+      return;
+    }
+    uint64_t bit = uint64_t(i) * bit_width_;
+    uint64_t word = bit / 64;
+    uint32_t shift = bit % 64;
+    words_[word] = (words_[word] & ~(mask_ << shift)) | (value << shift);
+    if (shift + bit_width_ > 64) {
+      uint32_t written = 64 - shift;
+      words_[word + 1] = (words_[word + 1] & ~(mask_ >> written)) |
+                         (value >> written);
+    }
+  }
+
+  // Returns the value at index `i`.
+  PERFETTO_ALWAYS_INLINE uint64_t Get(uint32_t i) const {
+    PERFETTO_DCHECK(i < size_);
+    uint64_t bit = uint64_t(i) * bit_width_;
+    uint64_t word = bit / 64;
+    uint32_t shift = bit % 64;
+    // The high word is shifted in two steps to avoid an (undefined) shift by
+    // 64 when `shift` is zero.
+    uint64_t lo = words_[word] >> shift;
+    uint64_t hi = (words_[word + 1] << 1) << (63 - shift);
+    return (lo | hi) & mask_;
+  }
+
+  // Writes the `count` values starting at index `begin` to `out`.
+  void Unpack(uint32_t begin, uint32_t count, uint64_t* out) const {
+    PERFETTO_DCHECK(uint64_t(begin) + count <= size_);
+    if (bit_width_ == 0) {
+      memset(out, 0, count * sizeof(uint64_t));
+      return;
+    }
+    uint64_t bit = uint64_t(begin) * bit_width_;
+    const uint64_t* word = words_.data() + bit / 64;
+    uint32_t shift = bit % 64;
+    for (uint32_t i = 0; i < count; ++i) {
+      uint64_t lo = word[0] >> shift;
+      uint64_t hi = (word[1] << 1) << (63 - shift);
+      out[i] = (lo | hi) & mask_;
+      shift += bit_width_;
+      word += shift / 64;
+      shift %= 64;
+    }
+  }
+
+  // Returns the number of bits used by each value.
+  uint32_t bit_width() const { return bit_width_; }
+
+  // Returns the number of values in the vector.
+  uint32_t size() const { return size_; }
+
+  // Returns the number of bytes of memory used by the packed values.
+  size_t size_bytes() const { return words_.size() * sizeof(uint64_t); }
+
+ private:
+  Slab<uint64_t> words_;
+  uint32_t bit_width_ = 0;
+  uint32_t size_ = 0;
+  uint64_t mask_ = 0;
+};
+
+}  // namespace perfetto::trace_processor::core
+
+#endif  // SRC_TRACE_PROCESSOR_CORE_UTIL_BIT_PACKED_VECTOR_H_
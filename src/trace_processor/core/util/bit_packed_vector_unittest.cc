@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/core/util/bit_packed_vector.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor::core {
+namespace {
+
+TEST(BitPackedVectorTest, BitWidthFor) {
+  EXPECT_EQ(BitPackedVector::BitWidthFor(0), 0u);
+  EXPECT_EQ(BitPackedVector::BitWidthFor(1), 1u);
+  EXPECT_EQ(BitPackedVector::BitWidthFor(255), 8u);
+  EXPECT_EQ(BitPackedVector::BitWidthFor(256), 9u);
+  EXPECT_EQ(BitPackedVector::BitWidthFor(~0ull), 64u);
+}
+
+TEST(BitPackedVectorTest, ZeroWidth) {
+  BitPackedVector vec(0, 100);
+  EXPECT_EQ(vec.size(), 100u);
+  for (uint32_t i = 0; i < 100; ++i) {
+    vec.Set(i, 0);
+    EXPECT_EQ(vec.Get(i), 0u);
+  }
+  std::vector<uint64_t> out(100, 1);
+  vec.Unpack(0, 100, out.data());
+  EXPECT_EQ(out, std::vector<uint64_t>(100, 0));
+}
+
+// Checks every width, including values straddling two words and full 64-bit
+// values.
+TEST(BitPackedVectorTest, GetSetUnpackAllWidths) {
+  std::minstd_rand0 rnd(0);
+  constexpr uint32_t kSize = 257;
+  for (uint32_t width = 1; width <= 64; ++width) {
+    uint64_t mask = width == 64 ? ~0ull : (1ull << width) - 1;
+    std::vector<uint64_t> expected(kSize);
+    BitPackedVector vec(width, kSize);
+    for (uint32_t i = 0; i < kSize; ++i) {
+      expected[i] = ((uint64_t(rnd()) << 32) ^ rnd()) & mask;
+      vec.Set(i, expected[i]);
+    }
+    // Overwrite some values to check that Set clears the old bits.
+    for (uint32_t i = 0; i < kSize; i += 3) {
+      expected[i] = (expected[i] ^ mask) & mask;
+      vec.Set(i, expected[i]);
+    }
+    for (uint32_t i = 0; i < kSize; ++i) {
+      ASSERT_EQ(vec.Get(i), expected[i]) << "width=" << width << " i=" << i;
+    }
+    std::vector<uint64_t> out(kSize);
+    vec.Unpack(0, kSize, out.data());
+    ASSERT_EQ(out, expected) << "width=" << width;
+
+    std::vector<uint64_t> partial(100);
+    vec.Unpack(77, 100, partial.data());
+    ASSERT_TRUE(std::equal(partial.begin(), partial.end(),
+                           expected.begin() + 77))
+        << "width=" << width;
+  }
+}
+
+TEST(BitPackedVectorTest, SizeBytes) {
+  BitPackedVector vec(3, 1000);
+  // 3000 bits need 47 words, plus padding.
+  EXPECT_LE(vec.size_bytes(), 49u * sizeof(uint64_t));
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor::core
@@ -75,6 +75,14 @@ struct BitVector {
     return BitVector(std::move(words), size);
   }
 
+  // Creates a BitVector with `size` bits backed by `words`, memory which is
+  // owned by someone else. See `FlexVector::CreateUnowned` for the rules on
+  // `words`.
+  static BitVector CreateUnowned(FlexVector<uint64_t> words, uint64_t size) {
+    PERFETTO_DCHECK(words.size() == (size + 63u) / 64u);
+    return BitVector(std::move(words), size);
+  }
+
   // Adds a bit to the end of the vector.
   //
   // bit: The boolean value to add to the end of the BitVector.
@@ -224,6 +232,9 @@ struct BitVector {
   // Returns the number of bits in the vector.
   PERFETTO_ALWAYS_INLINE uint64_t size() const { return size_; }
 
+  // Returns the words backing this BitVector.
+  const FlexVector<uint64_t>& words() const { return words_; }
+
  private:
   // Constructor used by Alloc.
   explicit BitVector(FlexVector<uint64_t> data, uint64_t size)
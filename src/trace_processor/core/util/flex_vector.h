@@ -100,6 +100,23 @@ class FlexVector {
     return FlexVector(base::AlignUp(size, kCapacityMultiple), size);
   }
 
+  // Creates a FlexVector of `size` elements which points to memory owned by
+  // someone else (e.g. a mmapped snapshot file). `capacity` must be a multiple
+  // of `kCapacityMultiple` and at least `size`. See `Slab::Unowned` for the
+  // ownership rules.
+  //
+  // The memory may be read-only: the returned vector must not be mutated.
+  static FlexVector<T> CreateUnowned(const T* data,
+                                     uint64_t size,
+                                     uint64_t capacity) {
+    PERFETTO_DCHECK(capacity % kCapacityMultiple == 0);
+    PERFETTO_DCHECK(size <= capacity);
+    FlexVector<T> vec;
+    vec.slab_ = Slab<T>::Unowned(data, capacity);
+    vec.size_ = size;
+    return vec;
+  }
+
   // Adds `value` to the end of the vector.
   PERFETTO_ALWAYS_INLINE void push_back(T value) {
     PERFETTO_DCHECK(capacity() % kCapacityMultiple == 0);
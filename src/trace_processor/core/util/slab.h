@@ -20,6 +20,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <type_traits>
+#include <utility>
 
 #include "perfetto/ext/base/utils.h"
 #include "perfetto/public/compiler.h"
@@ -53,8 +54,16 @@ class Slab {
   Slab() = default;
 
   // Move operations are supported.
-  constexpr Slab(Slab&&) = default;
-  constexpr Slab& operator=(Slab&&) = default;
+  Slab(Slab&& other) noexcept
+      : owned_(std::move(other.owned_)),
+        data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0)) {}
+  Slab& operator=(Slab&& other) noexcept {
+    owned_ = std::move(other.owned_);
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    return *this;
+  }
 
   // Copy operations are deleted to avoid accidental copies.
   Slab(const Slab&) = delete;
@@ -70,28 +79,48 @@ class Slab {
         size);
   }
 
+  // Creates a slab which points to `size` elements of memory owned by
+  // someone else (e.g. a mmapped snapshot file). The memory is not freed
+  // when the slab is destroyed and must outlive it.
+  //
+  // The memory may be read-only: callers must not write to the returned slab.
+  static Slab<T> Unowned(const T* data, uint64_t size) {
+    Slab<T> slab;
+    slab.data_ = const_cast<T*>(data);
+    slab.size_ = size;
+    return slab;
+  }
+
   // Returns a pointer to the underlying data.
-  PERFETTO_ALWAYS_INLINE const T* data() const { return data_.get(); }
-  PERFETTO_ALWAYS_INLINE T* data() { return data_.get(); }
+  PERFETTO_ALWAYS_INLINE const T* data() const { return data_; }
+  PERFETTO_ALWAYS_INLINE T* data() { return data_; }
 
   // Returns the number of elements in the slab.
   PERFETTO_ALWAYS_INLINE uint64_t size() const { return size_; }
 
+  // Returns whether the memory of this slab is owned by it (i.e. was not
+  // created with `Unowned`).
+  PERFETTO_ALWAYS_INLINE bool is_owned() const {
+    return owned_ != nullptr || data_ == nullptr;
+  }
+
   // Returns iterators for range-based for loops.
-  PERFETTO_ALWAYS_INLINE T* begin() const { return data_.get(); }
-  PERFETTO_ALWAYS_INLINE T* end() const { return data_.get() + size_; }
+  PERFETTO_ALWAYS_INLINE T* begin() const { return data_; }
+  PERFETTO_ALWAYS_INLINE T* end() const { return data_ + size_; }
 
   // Provides indexed access to elements.
-  PERFETTO_ALWAYS_INLINE T& operator[](uint64_t i) const {
-    return data_.get()[i];
-  }
+  PERFETTO_ALWAYS_INLINE T& operator[](uint64_t i) const { return data_[i]; }
 
  private:
   // Constructor used by Alloc.
-  Slab(T* data, uint64_t size) : data_(data), size_(size) {}
+  Slab(T* data, uint64_t size) : owned_(data), data_(data), size_(size) {}
+
+  // Aligned unique pointer that holds the allocated memory. Null for slabs
+  // created with `Unowned`.
+  base::AlignedUniquePtr<T> owned_;
 
-  // Aligned unique pointer that holds the allocated memory.
-  base::AlignedUniquePtr<T> data_;
+  // Pointer to the first element: either `owned_.get()` or unowned memory.
+  T* data_ = nullptr;
 
   // Number of elements in the slab.
   uint64_t size_ = 0;
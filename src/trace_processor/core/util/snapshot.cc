@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/core/util/snapshot.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/scoped_file.h"
+#include "perfetto/ext/base/status_macros.h"
+#include "perfetto/ext/base/status_or.h"
+
+namespace perfetto::trace_processor::core {
+namespace {
+
+// Bump this every time the layout of the snapshot changes in a backwards
+// incompatible way.
+constexpr uint32_t kSnapshotFormatVersion = 1;
+
+// Used to reject snapshots written on machines with a different endianness.
+constexpr uint32_t kSnapshotEndiannessMarker = 0x01020304;
+
+constexpr size_t kWriteBufferSize = 1024 * 1024;
+
+}  // namespace
+
+SnapshotWriter::SnapshotWriter(base::ScopedFile fd) : fd_(std::move(fd)) {
+  buffer_.reserve(kWriteBufferSize);
+  WriteRaw(kSnapshotMagic, kSnapshotMagicSize);
+  WriteU32(kSnapshotFormatVersion);
+  WriteU32(kSnapshotEndiannessMarker);
+}
+
+SnapshotWriter::~SnapshotWriter() = default;
+
+void SnapshotWriter::WriteString(std::string_view str) {
+  WriteU64(str.size());
+  WriteRaw(str.data(), str.size());
+}
+
+base::Status SnapshotWriter::Finish() {
+  FlushBuffer();
+  if (failed_) {
+    return base::ErrStatus("Failed to write snapshot file");
+  }
+  return base::OkStatus();
+}
+
+void SnapshotWriter::WriteRaw(const void* data, size_t size) {
+  const auto* ptr = static_cast<const uint8_t*>(data);
+  offset_ += size;
+  if (buffer_.size() + size > kWriteBufferSize) {
+    FlushBuffer();
+  }
+  // Large writes (e.g. whole columns) bypass the buffer.
+  if (size >= kWriteBufferSize) {
+    if (!failed_ &&
+        base::WriteAll(*fd_, ptr, size) != static_cast<ssize_t>(size)) {
+      failed_ = true;
+    }
+    return;
+  }
+  buffer_.insert(buffer_.end(), ptr, ptr + size);
+}
+
+void SnapshotWriter::WriteZeros(size_t size) {
+  static constexpr uint8_t kZeros[kSnapshotAlignment] = {};
+  while (size > 0) {
+    size_t chunk = std::min(size, sizeof(kZeros));
+    WriteRaw(kZeros, chunk);
+    size -= chunk;
+  }
+}
+
+void SnapshotWriter::AlignTo(size_t alignment) {
+  size_t misalignment = static_cast<size_t>(offset_ % alignment);
+  if (misalignment != 0) {
+    WriteZeros(alignment - misalignment);
+  }
+}
+
+void SnapshotWriter::FlushBuffer() {
+  if (!failed_ && !buffer_.empty() &&
+      base::WriteAll(*fd_, buffer_.data(), buffer_.size()) !=
+          static_cast<ssize_t>(buffer_.size())) {
+    failed_ = true;
+  }
+  buffer_.clear();
+}
+
+// static
+base::StatusOr<SnapshotReader> SnapshotReader::Create(const uint8_t* data,
+                                                      size_t size) {
+  if (!IsSnapshot(data, size)) {
+    return base::ErrStatus("Snapshot: invalid magic number");
+  }
+  SnapshotReader reader(data, size, kSnapshotMagicSize);
+  ASSIGN_OR_RETURN(uint32_t version, reader.ReadU32());
+  if (version != kSnapshotFormatVersion) {
+    return base::ErrStatus(
+        "Snapshot: unsupported format version %u (expected %u)", version,
+        kSnapshotFormatVersion);
+  }
+  ASSIGN_OR_RETURN(uint32_t marker, reader.ReadU32());
+  if (marker != kSnapshotEndiannessMarker) {
+    return base::ErrStatus(
+        "Snapshot: written on a machine with a different endianness");
+  }
+  return reader;
+}
+
+base::StatusOr<std::string_view> SnapshotReader::ReadString() {
+  ASSIGN_OR_RETURN(uint64_t size, ReadU64());
+  if (offset_ > size_ || size > size_ - offset_) {
+    return OutOfBounds();
+  }
+  std::string_view str(reinterpret_cast<const char*>(data_ + offset_),
+                       static_cast<size_t>(size));
+  offset_ += static_cast<size_t>(size);
+  return str;
+}
+
+// static
+base::Status SnapshotReader::OutOfBounds() {
+  return base::ErrStatus("Snapshot: unexpected end of file, file is corrupt");
+}
+
+}  // namespace perfetto::trace_processor::core
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_CORE_UTIL_SNAPSHOT_H_
+#define SRC_TRACE_PROCESSOR_CORE_UTIL_SNAPSHOT_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/scoped_file.h"
+#include "perfetto/ext/base/status_or.h"
+
+namespace perfetto::trace_processor::core {
+
+// Helpers to write and read the binary snapshot format used to persist the
+// contents of trace processor (see TraceStorage::SerializeToSnapshot).
+//
+// A snapshot is a sequence of native-endian scalars and arrays. Arrays are
+// aligned to kSnapshotAlignment bytes from the start of the file so that,
+// once the file is mmapped, they can be used directly as the backing memory
+// of FlexVectors and BitVectors without any copy. As a consequence,
+// snapshots are only meant to be loaded by the same build of trace processor
+// which wrote them, on the same architecture.
+
+// Alignment of arrays in the snapshot file.
+inline constexpr size_t kSnapshotAlignment = 64;
+
+// Magic number at the start of every snapshot file.
+inline constexpr char kSnapshotMagic[] = "PFTPSNAP";
+inline constexpr size_t kSnapshotMagicSize = sizeof(kSnapshotMagic) - 1;
+
+// Returns whether |data| starts with kSnapshotMagic.
+inline bool IsSnapshot(const uint8_t* data, size_t size) {
+  return size >= kSnapshotMagicSize &&
+         memcmp(data, kSnapshotMagic, kSnapshotMagicSize) == 0;
+}
+
+// Writes a snapshot sequentially to a file. Writes are buffered: errors are
+// sticky and reported by |Finish|.
+class SnapshotWriter {
+ public:
+  // Writes the snapshot header to |fd| straight away.
+  explicit SnapshotWriter(base::ScopedFile fd);
+  ~SnapshotWriter();
+
+  SnapshotWriter(const SnapshotWriter&) = delete;
+  SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+  void WriteU32(uint32_t value) { WriteRaw(&value, sizeof(value)); }
+  void WriteU64(uint64_t value) { WriteRaw(&value, sizeof(value)); }
+  void WriteI64(int64_t value) { WriteRaw(&value, sizeof(value)); }
+
+  // Writes the size of |str| followed by its bytes.
+  void WriteString(std::string_view str);
+
+  // Writes |count| elements starting at |data|, aligned to
+  // kSnapshotAlignment, followed by zeros up to |padded_count| elements.
+  // The element count is *not* written: it is up to the caller to do so if
+  // needed.
+  template <typename T>
+  void WriteArray(const T* data, uint64_t count, uint64_t padded_count) {
+    AlignTo(kSnapshotAlignment);
+    WriteRaw(data, count * sizeof(T));
+    WriteZeros((padded_count - count) * sizeof(T));
+  }
+
+  // Flushes all the buffered data. Returns an error if any write failed.
+  base::Status Finish();
+
+ private:
+  void WriteRaw(const void* data, size_t size);
+  void WriteZeros(size_t size);
+  void AlignTo(size_t alignment);
+  void FlushBuffer();
+
+  base::ScopedFile fd_;
+  std::vector<uint8_t> buffer_;
+  uint64_t offset_ = 0;
+  bool failed_ = false;
+};
+
+// Reads a snapshot from memory (usually a mmapped snapshot file). All reads
+// are bounds checked: any read past the end of the snapshot returns an error.
+class SnapshotReader {
+ public:
+  // Checks the snapshot header at the start of |data| and returns a reader
+  // positioned right after it.
+  static base::StatusOr<SnapshotReader> Create(const uint8_t* data,
+                                               size_t size);
+
+  base::StatusOr<uint32_t> ReadU32() { return ReadScalar<uint32_t>(); }
+  base::StatusOr<uint64_t> ReadU64() { return ReadScalar<uint64_t>(); }
+  base::StatusOr<int64_t> ReadI64() { return ReadScalar<int64_t>(); }
+
+  // Reads a string written by SnapshotWriter::WriteString. The returned view
+  // points into the snapshot memory.
+  base::StatusOr<std::string_view> ReadString();
+
+  // Reads an array of |padded_count| elements written by
+  // SnapshotWriter::WriteArray. The returned pointer points into the snapshot
+  // memory.
+  template <typename T>
+  base::StatusOr<const T*> ReadArray(uint64_t padded_count) {
+    offset_ = AlignUp(offset_);
+    if (padded_count > (size_ - std::min(offset_, size_)) / sizeof(T)) {
+      return OutOfBounds();
+    }
+    const T* ptr = reinterpret_cast<const T*>(data_ + offset_);
+    offset_ += padded_count * sizeof(T);
+    return ptr;
+  }
+
+  // Returns whether all the snapshot has been read.
+  bool AtEnd() const { return offset_ == size_; }
+
+ private:
+  SnapshotReader(const uint8_t* data, size_t size, size_t offset)
+      : data_(data), size_(size), offset_(offset) {}
+
+  template <typename T>
+  base::StatusOr<T> ReadScalar() {
+    if (offset_ > size_ || size_ - offset_ < sizeof(T)) {
+      return OutOfBounds();
+    }
+    T value;
+    memcpy(&value, data_ + offset_, sizeof(T));
+    offset_ += sizeof(T);
+    return value;
+  }
+
+  static size_t AlignUp(size_t offset) {
+    return (offset + kSnapshotAlignment - 1) & ~(kSnapshotAlignment - 1);
+  }
+
+  static base::Status OutOfBounds();
+
+  const uint8_t* data_;
+  size_t size_;
+  size_t offset_;
+};
+
+}  // namespace perfetto::trace_processor::core
+
+#endif  // SRC_TRACE_PROCESSOR_CORE_UTIL_SNAPSHOT_H_
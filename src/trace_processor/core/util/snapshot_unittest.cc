@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/core/util/snapshot.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/temp_file.h"
+#include "src/base/test/status_matchers.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor::core {
+namespace {
+
+std::string ReadBack(const base::TempFile& file) {
+  std::string contents;
+  PERFETTO_CHECK(base::ReadFile(file.path(), &contents));
+  return contents;
+}
+
+const uint8_t* Bytes(const std::string& str) {
+  return reinterpret_cast<const uint8_t*>(str.data());
+}
+
+TEST(SnapshotTest, RoundTrip) {
+  base::TempFile file = base::TempFile::Create();
+  SnapshotWriter writer(base::OpenFile(file.path(), O_WRONLY));
+  writer.WriteU32(42);
+  writer.WriteString("foo");
+  std::vector<int64_t> values = {1, -2, 3};
+  writer.WriteArray(values.data(), values.size(), 8);
+  writer.WriteU64(1234);
+  ASSERT_OK(writer.Finish());
+
+  std::string contents = ReadBack(file);
+  ASSERT_TRUE(IsSnapshot(Bytes(contents), contents.size()));
+  auto reader_or = SnapshotReader::Create(Bytes(contents), contents.size());
+  ASSERT_OK(reader_or);
+  SnapshotReader& reader = *reader_or;
+  ASSERT_OK_AND_ASSIGN(uint32_t u32, reader.ReadU32());
+  ASSERT_EQ(u32, 42u);
+  ASSERT_OK_AND_ASSIGN(std::string_view str, reader.ReadString());
+  ASSERT_EQ(str, "foo");
+  ASSERT_OK_AND_ASSIGN(const int64_t* array, reader.ReadArray<int64_t>(8));
+  ASSERT_EQ(reinterpret_cast<const char*>(array) - contents.data(),
+            static_cast<ptrdiff_t>(kSnapshotAlignment));
+  ASSERT_THAT(std::vector<int64_t>(array, array + 8),
+              testing::ElementsAre(1, -2, 3, 0, 0, 0, 0, 0));
+  ASSERT_OK_AND_ASSIGN(uint64_t u64, reader.ReadU64());
+  ASSERT_EQ(u64, 1234u);
+  ASSERT_TRUE(reader.AtEnd());
+}
+
+TEST(SnapshotTest, BadMagic) {
+  std::string contents(64, 'x');
+  ASSERT_FALSE(IsSnapshot(Bytes(contents), contents.size()));
+  ASSERT_FALSE(SnapshotReader::Create(Bytes(contents), contents.size()).ok());
+}
+
+TEST(SnapshotTest, Truncated) {
+  base::TempFile file = base::TempFile::Create();
+  SnapshotWriter writer(base::OpenFile(file.path(), O_WRONLY));
+  writer.WriteString("a longer string");
+  std::vector<uint32_t> values(16, 7);
+  writer.WriteArray(values.data(), values.size(), values.size());
+  ASSERT_OK(writer.Finish());
+
+  std::string contents = ReadBack(file);
+  contents.resize(contents.size() - 1);
+  auto reader_or = SnapshotReader::Create(Bytes(contents), contents.size());
+  ASSERT_OK(reader_or);
+  SnapshotReader& reader = *reader_or;
+  ASSERT_OK(reader.ReadString());
+  ASSERT_FALSE(reader.ReadArray<uint32_t>(16).ok());
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor::core
@@ -53,6 +53,7 @@ std::optional<TraceSorter::SortingMode> GetMinimumSortingMode(
     const TraceProcessorContext& context) {
   switch (trace_type) {
     case kGzipTraceType:
+    case kZstdTraceType:
       return std::nullopt;
 
     case kAndroidDumpstateTraceType:
@@ -33,7 +33,8 @@ bool ArchiveEntry::operator<(const ArchiveEntry& rhs) const {
       // Proto traces should always parsed first as they might contains clock
       // sync data needed to correctly parse other traces.
       return 0;
-    if (type == TraceType::kGzipTraceType)
+    if (type == TraceType::kGzipTraceType ||
+        type == TraceType::kZstdTraceType)
       return 1;  // Middle priority
     return 2;    // Default for other trace types
   };
@@ -16,17 +16,20 @@
 
 #include "src/trace_processor/importers/archive/gzip_trace_parser.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "perfetto/base/logging.h"
 #include "perfetto/base/status.h"
 #include "perfetto/ext/base/status_macros.h"
 #include "perfetto/ext/base/string_utils.h"
 #include "perfetto/ext/base/string_view.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/trace_processor/trace_blob.h"
 #include "perfetto/trace_processor/trace_blob_view.h"
 #include "src/trace_processor/forwarding_trace_parser.h"
@@ -34,6 +37,7 @@
 #include "src/trace_processor/importers/common/trace_file_tracker.h"
 #include "src/trace_processor/types/trace_processor_context.h"
 #include "src/trace_processor/util/gzip_utils.h"
+#include "src/trace_processor/util/parallel_for.h"
 
 namespace perfetto::trace_processor {
 
@@ -44,10 +48,16 @@ using ResultCode = util::GzipDecompressor::ResultCode;
 }  // namespace
 
 GzipTraceParser::GzipTraceParser(TraceProcessorContext* context)
-    : context_(context) {}
+    : context_(context),
+      thread_pool_(context->decompression_thread_pool.get()),
+      parallel_(thread_pool_ && thread_pool_->thread_count() > 1) {}
 
-GzipTraceParser::GzipTraceParser(std::unique_ptr<ChunkedTraceReader> reader)
-    : context_(nullptr), inner_(std::move(reader)) {}
+GzipTraceParser::GzipTraceParser(std::unique_ptr<ChunkedTraceReader> reader,
+                                 util::LazyThreadPool* thread_pool)
+    : context_(nullptr),
+      inner_(std::move(reader)),
+      thread_pool_(thread_pool),
+      parallel_(thread_pool_ && thread_pool_->thread_count() > 1) {}
 
 GzipTraceParser::~GzipTraceParser() = default;
 
@@ -79,6 +89,51 @@ base::Status GzipTraceParser::ParseUnowned(const uint8_t* data, size_t size) {
     first_chunk_parsed_ = true;
   }
 
+  if (!parallel_) {
+    return InflateStreaming(start, len, /*stop_at_member_end=*/false, nullptr);
+  }
+
+  // Stream until the current member ends. Single member files never leave
+  // this loop.
+  while (len > 0 && (output_state_ == kMidStream || member_header_.empty())) {
+    size_t leftover = 0;
+    RETURN_IF_ERROR(
+        InflateStreaming(start, len, /*stop_at_member_end=*/true, &leftover));
+    start += len - leftover;
+    len = leftover;
+    // A member ended and is followed by another one: the file is made of
+    // several members, which are likely to share this header.
+    if (member_header_.empty() && len >= util::kGzipMemberHeaderSize) {
+      member_header_.assign(start, start + util::kGzipMemberHeaderSize);
+    }
+  }
+  return len > 0 ? InflateMembers(start, len) : base::OkStatus();
+}
+
+base::Status GzipTraceParser::InflateMembers(const uint8_t* data,
+                                             size_t size) {
+  ASSIGN_OR_RETURN(
+      std::unique_ptr<util::GzipDecompressor> partial_member,
+      util::InflateGzipMembers(
+          thread_pool_->Get(), data, size, member_header_.data(),
+          [this](std::unique_ptr<uint8_t[]> chunk, size_t chunk_size) {
+            TraceBlob blob =
+                TraceBlob::TakeOwnership(std::move(chunk), chunk_size);
+            return inner_->Parse(TraceBlobView(std::move(blob)));
+          }));
+  if (partial_member) {
+    // The partial member consumed all the input: continue inflating it in a
+    // streaming fashion with the following input.
+    decompressor_ = std::move(*partial_member);
+    output_state_ = kMidStream;
+  }
+  return base::OkStatus();
+}
+
+base::Status GzipTraceParser::InflateStreaming(const uint8_t* start,
+                                               size_t len,
+                                               bool stop_at_member_end,
+                                               size_t* leftover) {
   // Our default uncompressed buffer size is 32MB as it allows for good
   // throughput.
   constexpr size_t kUncompressedBufferSize = 32ul * 1024 * 1024;
@@ -115,10 +170,15 @@ base::Status GzipTraceParser::ParseUnowned(const uint8_t* data, size_t size) {
     // the decompressor to begin processing the next stream: all other variables
     // can be preserved.
     if (ret == ResultCode::kEof) {
+      size_t avail_in = decompressor_.AvailIn();
       decompressor_.Reset();
       output_state_ = kStreamBoundary;
 
-      if (decompressor_.AvailIn() == 0) {
+      if (stop_at_member_end) {
+        *leftover = avail_in;
+        return base::OkStatus();
+      }
+      if (avail_in == 0) {
         return base::OkStatus();
       }
     }
@@ -20,6 +20,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "perfetto/base/status.h"
 #include "src/trace_processor/importers/common/chunked_trace_reader.h"
@@ -29,10 +30,29 @@ namespace perfetto::trace_processor {
 
 class TraceProcessorContext;
 
+namespace util {
+class LazyThreadPool;
+}  // namespace util
+
+// Decompresses a .gz file and forwards the decompressed bytes to the
+// appropriate ChunkedTraceReader.
+//
+// The input is inflated in a streaming fashion. Files made of several gzip
+// members (RFC1952 section 2.2) can instead be inflated concurrently when a
+// thread pool with more than one thread is configured (see
+// Config::decompression_parallelism). This only starts once a member has
+// ended and is followed by the header of another one: from then on, the
+// members starting in each chunk passed to Parse() are inflated in parallel
+// (see util::InflateGzipMembers), using that header to find them. A member
+// which is not complete at the end of a chunk is inflated in a streaming
+// fashion until it ends. The decompressed output is forwarded in order,
+// exactly as it would be with sequential decompression.
 class GzipTraceParser : public ChunkedTraceReader {
  public:
   explicit GzipTraceParser(TraceProcessorContext*);
-  explicit GzipTraceParser(std::unique_ptr<ChunkedTraceReader>);
+  // If |thread_pool| is null, members are inflated on the calling thread.
+  explicit GzipTraceParser(std::unique_ptr<ChunkedTraceReader>,
+                           util::LazyThreadPool* thread_pool = nullptr);
   ~GzipTraceParser() override;
 
   // ChunkedTraceReader implementation
@@ -42,10 +62,29 @@ class GzipTraceParser : public ChunkedTraceReader {
   base::Status ParseUnowned(const uint8_t*, size_t);
 
  private:
+  // Inflates |data| with |decompressor_|. If |stop_at_member_end| is true,
+  // returns as soon as the current member ends and sets |*leftover| to the
+  // number of bytes at the end of |data| which were not consumed.
+  base::Status InflateStreaming(const uint8_t* data,
+                                size_t size,
+                                bool stop_at_member_end,
+                                size_t* leftover);
+
+  // Inflates the members in |data|, which starts at a member boundary,
+  // concurrently.
+  base::Status InflateMembers(const uint8_t* data, size_t size);
+
   TraceProcessorContext* const context_;
   util::GzipDecompressor decompressor_;
   std::unique_ptr<ChunkedTraceReader> inner_;
 
+  // Null or single-threaded when not inflating in parallel.
+  util::LazyThreadPool* const thread_pool_;
+  const bool parallel_;
+  // The header of the second member of the file, once it has been seen. Empty
+  // until then, and for single member files.
+  std::vector<uint8_t> member_header_;
+
   std::unique_ptr<uint8_t[]> buffer_;
   size_t bytes_written_ = 0;
 
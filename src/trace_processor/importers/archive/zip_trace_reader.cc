@@ -16,6 +16,8 @@
 
 #include "src/trace_processor/importers/archive/zip_trace_reader.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <map>
@@ -26,17 +28,29 @@
 #include "perfetto/base/logging.h"
 #include "perfetto/base/status.h"
 #include "perfetto/ext/base/status_macros.h"
-#include "perfetto/trace_processor/trace_blob.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/trace_processor/trace_blob_view.h"
 #include "src/trace_processor/forwarding_trace_parser.h"
 #include "src/trace_processor/importers/android_bugreport/android_bugreport_reader.h"
 #include "src/trace_processor/importers/archive/archive_entry.h"
 #include "src/trace_processor/importers/common/trace_file_tracker.h"
 #include "src/trace_processor/types/trace_processor_context.h"
+#include "src/trace_processor/util/parallel_for.h"
 #include "src/trace_processor/util/trace_type.h"
 #include "src/trace_processor/util/zip_reader.h"
 
 namespace perfetto::trace_processor {
+namespace {
+
+// Upper bound on the inflated bytes kept in memory between classifying the
+// entries of an archive and parsing them.
+constexpr size_t kMaxRetainedInflatedBytes = 256 * 1024 * 1024;
+
+// Number of bytes inflated to classify the entries which are not retained.
+// This is more than GuessTraceType() looks at for all but a few formats.
+constexpr size_t kClassificationPrefixSize = 64 * 1024;
+
+}  // namespace
 
 ZipTraceReader::ZipTraceReader(TraceProcessorContext* context)
     : context_(context),
@@ -57,34 +71,95 @@ base::Status ZipTraceReader::NotifyEndOfFile() {
     return android_bugreport_reader_->Parse(std::move(files));
   }
 
-  // TODO(carlscab): There is a lot of unnecessary copying going on here.
-  // ZipTraceReader can directly parse the ZIP file and given that we know the
-  // decompressed size we could directly decompress into TraceBlob chunks and
-  // send them to the tokenizer.
-  std::vector<uint8_t> buffer;
-  std::map<ArchiveEntry, File> ordered_files;
+  // Inflating the entries is independent from parsing them so do it
+  // concurrently, in batches of one entry per thread: for archives containing
+  // several compressed traces this is a significant fraction of the total load
+  // time.
+  util::LazyThreadPool* lazy_pool = context_->decompression_thread_pool.get();
+  base::ThreadPool* pool =
+      lazy_pool && files.size() > 1 ? lazy_pool->Get() : nullptr;
+  const size_t batch_size = pool ? pool->thread_count() + 1 : 1;
+  std::vector<TraceBlobView> data(files.size());
+  std::vector<std::vector<uint8_t>> prefixes(files.size());
+  std::vector<base::Status> statuses(files.size());
+
+  // The trace type of every entry is needed to decide the parsing order. The
+  // first entries, up to |kMaxRetainedInflatedBytes| of output, are inflated
+  // upfront and kept until they are parsed. The others are deferred: only
+  // their first |kClassificationPrefixSize| bytes are inflated to classify
+  // them, and they are inflated in full right before being parsed. This way
+  // peak memory does not grow with the size of the archive and no entry is
+  // inflated twice.
+  std::vector<bool> deferred(files.size());
+  size_t retained_bytes = 0;
   for (size_t i = 0; i < files.size(); ++i) {
-    util::ZipFile& zip_file = files[i];
-    auto id = context_->trace_file_tracker->AddFile(zip_file.name());
-    context_->trace_file_tracker->SetSize(id, zip_file.compressed_size());
-    RETURN_IF_ERROR(files[i].Decompress(&buffer));
-    TraceBlobView data(TraceBlob::CopyFrom(buffer.data(), buffer.size()));
-    ArchiveEntry entry{zip_file.name(), i,
-                       GuessTraceType(data.data(), data.size())};
-    ordered_files.emplace(entry, File{id, std::move(data)});
+    if (retained_bytes + files[i].uncompressed_size() <=
+        kMaxRetainedInflatedBytes) {
+      retained_bytes += files[i].uncompressed_size();
+    } else {
+      deferred[i] = true;
+    }
   }
+  auto inflate = [&](const std::vector<size_t>& indices, bool classify) {
+    util::ParallelFor(pool, indices.size(), [&](size_t j) {
+      size_t i = indices[j];
+      statuses[i] = classify && deferred[i]
+                        ? files[i].DecompressPrefix(kClassificationPrefixSize,
+                                                    &prefixes[i])
+                        : files[i].Decompress(&data[i]);
+    });
+  };
+
+  std::map<ArchiveEntry, tables::TraceFileTable::Id> ordered_files;
+  std::vector<size_t> batch;
+  for (size_t start = 0; start < files.size(); start += batch_size) {
+    batch.clear();
+    for (size_t i = start; i < std::min(files.size(), start + batch_size);
+         ++i) {
+      batch.push_back(i);
+    }
+    inflate(batch, /*classify=*/true);
+    for (size_t i : batch) {
+      util::ZipFile& zip_file = files[i];
+      auto id = context_->trace_file_tracker->AddFile(zip_file.name());
+      context_->trace_file_tracker->SetSize(id, zip_file.compressed_size());
+      RETURN_IF_ERROR(statuses[i]);
+      TraceType type =
+          deferred[i] ? GuessTraceType(prefixes[i].data(), prefixes[i].size())
+                      : GuessTraceType(data[i].data(), data[i].size());
+      prefixes[i] = std::vector<uint8_t>();
+      ordered_files.emplace(ArchiveEntry{zip_file.name(), i, type}, id);
+    }
+  }
+
+  // Parse the entries in order, inflating the deferred ones a batch at a time
+  // and releasing each one as soon as it has been parsed.
+  for (auto it = ordered_files.begin(); it != ordered_files.end();) {
+    batch.clear();
+    auto batch_end = it;
+    for (size_t n = 0; n < batch_size && batch_end != ordered_files.end();
+         ++n, ++batch_end) {
+      if (deferred[batch_end->first.index]) {
+        batch.push_back(batch_end->first.index);
+      }
+    }
+    inflate(batch, /*classify=*/false);
+    for (; it != batch_end; ++it) {
+      size_t i = it->first.index;
+      RETURN_IF_ERROR(statuses[i]);
+      auto chunk_reader =
+          std::make_unique<ForwardingTraceParser>(context_, it->second);
+      auto& parser = *chunk_reader;
+      parsers_.push_back(std::move(chunk_reader));
 
-  for (auto& file : ordered_files) {
-    auto chunk_reader =
-        std::make_unique<ForwardingTraceParser>(context_, file.second.id);
-    auto& parser = *chunk_reader;
-    parsers_.push_back(std::move(chunk_reader));
-
-    RETURN_IF_ERROR(parser.Parse(std::move(file.second.data)));
-    RETURN_IF_ERROR(parser.NotifyEndOfFile());
-    // Make sure the ForwardingTraceParser determined the same trace type as we
-    // did.
-    PERFETTO_CHECK(parser.trace_type() == file.first.trace_type);
+      RETURN_IF_ERROR(parser.Parse(std::move(data[i])));
+      RETURN_IF_ERROR(parser.NotifyEndOfFile());
+      // Make sure the ForwardingTraceParser determined the same trace type as
+      // we did. Deferred entries were classified from a prefix, which only
+      // decides where they are parsed in the order.
+      PERFETTO_CHECK(deferred[i] ||
+                     parser.trace_type() == it->first.trace_type);
+    }
   }
 
   return base::OkStatus();
@@ -45,10 +45,6 @@ class ZipTraceReader : public ChunkedTraceReader {
   base::Status NotifyEndOfFile() override;
 
  private:
-  struct File {
-    tables::TraceFileTable::Id id;
-    TraceBlobView data;
-  };
   TraceProcessorContext* const context_;
   util::ZipReader zip_reader_;
   std::unique_ptr<AndroidBugreportReader> android_bugreport_reader_;
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/importers/archive/zstd_trace_parser.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/status_macros.h"
+#include "perfetto/trace_processor/trace_blob.h"
+#include "perfetto/trace_processor/trace_blob_view.h"
+#include "src/trace_processor/forwarding_trace_parser.h"
+#include "src/trace_processor/importers/common/chunked_trace_reader.h"
+#include "src/trace_processor/importers/common/trace_file_tracker.h"
+#include "src/trace_processor/types/trace_processor_context.h"
+#include "src/trace_processor/util/zstd_utils.h"
+
+namespace perfetto::trace_processor {
+
+namespace {
+
+using ResultCode = util::ZstdDecompressor::ResultCode;
+
+}  // namespace
+
+ZstdTraceParser::ZstdTraceParser(TraceProcessorContext* context)
+    : context_(context) {}
+
+ZstdTraceParser::ZstdTraceParser(std::unique_ptr<ChunkedTraceReader> reader)
+    : context_(nullptr), inner_(std::move(reader)) {}
+
+ZstdTraceParser::~ZstdTraceParser() = default;
+
+base::Status ZstdTraceParser::Parse(TraceBlobView blob) {
+  return ParseUnowned(blob.data(), blob.size());
+}
+
+base::Status ZstdTraceParser::ParseUnowned(const uint8_t* data, size_t size) {
+  if (!inner_) {
+    PERFETTO_CHECK(context_);
+    inner_.reset(new ForwardingTraceParser(
+        context_, context_->trace_file_tracker->AddFile("")));
+  }
+
+  // Same as GzipTraceParser: 32MB allows for good throughput.
+  constexpr size_t kUncompressedBufferSize = 32ul * 1024 * 1024;
+  decompressor_.Feed(data, size);
+  if (size > 0) {
+    // Until the decompressor reports the end of a frame with no more input
+    // left, we are in the middle of a frame.
+    output_state_ = kMidFrame;
+  }
+
+  for (;;) {
+    if (!buffer_) {
+      buffer_.reset(new uint8_t[kUncompressedBufferSize]);
+      bytes_written_ = 0;
+    }
+
+    auto result =
+        decompressor_.ExtractOutput(buffer_.get() + bytes_written_,
+                                    kUncompressedBufferSize - bytes_written_);
+    ResultCode ret = result.ret;
+    if (ret == ResultCode::kError)
+      return base::ErrStatus("Failed to decompress zstd trace chunk");
+
+    if (ret == ResultCode::kNeedsMoreInput) {
+      PERFETTO_DCHECK(result.bytes_written == 0);
+      return base::OkStatus();
+    }
+    bytes_written_ += result.bytes_written;
+
+    if (bytes_written_ == kUncompressedBufferSize || ret == ResultCode::kEof) {
+      TraceBlob blob =
+          TraceBlob::TakeOwnership(std::move(buffer_), bytes_written_);
+      RETURN_IF_ERROR(inner_->Parse(TraceBlobView(std::move(blob))));
+    }
+
+    // The decompressor moves on to the next frame by itself: there is no need
+    // to reset it.
+    if (ret == ResultCode::kEof && decompressor_.AvailIn() == 0) {
+      output_state_ = kFrameBoundary;
+      return base::OkStatus();
+    }
+  }
+}
+
+base::Status ZstdTraceParser::NotifyEndOfFile() {
+  if (output_state_ != kFrameBoundary || decompressor_.AvailIn() > 0) {
+    return base::ErrStatus("ZSTD stream incomplete, trace is likely corrupt");
+  }
+  PERFETTO_CHECK(!buffer_);
+  return inner_ ? inner_->NotifyEndOfFile() : base::OkStatus();
+}
+
+}  // namespace perfetto::trace_processor
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_IMPORTERS_ARCHIVE_ZSTD_TRACE_PARSER_H_
+#define SRC_TRACE_PROCESSOR_IMPORTERS_ARCHIVE_ZSTD_TRACE_PARSER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "perfetto/base/status.h"
+#include "src/trace_processor/importers/common/chunked_trace_reader.h"
+#include "src/trace_processor/util/zstd_utils.h"
+
+namespace perfetto::trace_processor {
+
+class TraceProcessorContext;
+
+// Decompresses a .zst file and forwards the decompressed bytes to the
+// appropriate ChunkedTraceReader. Files made of several concatenated zstd
+// frames are supported.
+class ZstdTraceParser : public ChunkedTraceReader {
+ public:
+  explicit ZstdTraceParser(TraceProcessorContext*);
+  explicit ZstdTraceParser(std::unique_ptr<ChunkedTraceReader>);
+  ~ZstdTraceParser() override;
+
+  // ChunkedTraceReader implementation
+  base::Status Parse(TraceBlobView) override;
+  base::Status NotifyEndOfFile() override;
+
+  base::Status ParseUnowned(const uint8_t*, size_t);
+
+ private:
+  TraceProcessorContext* const context_;
+  util::ZstdDecompressor decompressor_;
+  std::unique_ptr<ChunkedTraceReader> inner_;
+
+  std::unique_ptr<uint8_t[]> buffer_;
+  size_t bytes_written_ = 0;
+
+  enum { kFrameBoundary, kMidFrame } output_state_ = kFrameBoundary;
+};
+
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_IMPORTERS_ARCHIVE_ZSTD_TRACE_PARSER_H_
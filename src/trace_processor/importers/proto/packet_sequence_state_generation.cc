@@ -15,7 +15,11 @@
  */
 
 #include "src/trace_processor/importers/proto/packet_sequence_state_generation.h"
+
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
 
 #include "src/trace_processor/importers/proto/track_event_sequence_state.h"
 #include "src/trace_processor/storage/stats.h"
@@ -24,6 +28,13 @@
 
 namespace perfetto::trace_processor {
 
+namespace {
+
+// Larger than any field id in InternedData.
+constexpr uint32_t kMaxInternedFieldId = 1024;
+
+}  // namespace
+
 PacketSequenceStateGeneration::CustomState::~CustomState() = default;
 
 // static
@@ -86,20 +97,8 @@ PacketSequenceStateGeneration::OnNewTracePacketDefaults(
           is_incremental_state_valid_));
 }
 
-InternedMessageView* PacketSequenceStateGeneration::GetInternedMessageView(
-    uint32_t field_id,
-    uint64_t iid) {
-  auto field_it = interned_data_.find(field_id);
-  if (field_it != interned_data_.end()) {
-    auto* message_map = &field_it->second;
-    auto it = message_map->find(iid);
-    if (it != message_map->end()) {
-      return &it->second;
-    }
-  }
-
+void PacketSequenceStateGeneration::OnInternedMessageNotFound() {
   context_->storage->IncrementStats(stats::interned_data_tokenizer_errors);
-  return nullptr;
 }
 
 void PacketSequenceStateGeneration::InternMessage(uint32_t field_id,
@@ -119,7 +118,15 @@ void PacketSequenceStateGeneration::InternMessage(uint32_t field_id,
   }
   iid = field.as_uint64();
 
-  auto res = interned_data_[field_id].emplace(
+  // Only fields of InternedData are ever looked up: don't let unknown fields
+  // with huge ids blow up the size of |interned_data_|.
+  if (PERFETTO_UNLIKELY(field_id >= kMaxInternedFieldId)) {
+    return;
+  }
+  if (field_id >= interned_data_.size()) {
+    interned_data_.resize(field_id + 1);
+  }
+  auto res = interned_data_[field_id].Insert(
       iid, InternedMessageView(std::move(message)));
 
   // If a message with this ID is already interned in the same generation,
@@ -128,8 +135,8 @@ void PacketSequenceStateGeneration::InternMessage(uint32_t field_id,
   // TODO(eseckler): This DCHECK assumes that the message is encoded the
   // same way if it is re-emitted.
   PERFETTO_DCHECK(res.second ||
-                  (res.first->second.message().length() == message_size &&
-                   memcmp(res.first->second.message().data(), message_start,
+                  (res.first->message().length() == message_size &&
+                   memcmp(res.first->message().data(), message_start,
                           message_size) == 0));
 }
 
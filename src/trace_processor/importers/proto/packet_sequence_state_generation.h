@@ -23,13 +23,14 @@
 #include <optional>
 #include <tuple>
 #include <type_traits>
-#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "perfetto/public/compiler.h"
 #include "perfetto/trace_processor/ref_counted.h"
 #include "perfetto/trace_processor/trace_blob_view.h"
 #include "src/trace_processor/importers/proto/track_event_sequence_state.h"
+#include "src/trace_processor/util/interned_message_table.h"
 #include "src/trace_processor/util/interned_message_view.h"
 
 #include "protos/perfetto/trace/trace_packet_defaults.pbzero.h"
@@ -38,10 +39,9 @@
 
 namespace perfetto::trace_processor {
 
-using InternedMessageMap =
-    std::unordered_map<uint64_t /*iid*/, InternedMessageView>;
-using InternedFieldMap =
-    std::unordered_map<uint32_t /*field_id*/, InternedMessageMap>;
+// The interned messages of a sequence, indexed by their field id in
+// InternedData.
+using InternedFieldMap = std::vector<InternedMessageTable>;
 
 class TraceProcessorContext;
 
@@ -158,7 +158,20 @@ class PacketSequenceStateGeneration : public RefCounted {
     return interned_message_view->template GetOrCreateDecoder<MessageType>();
   }
 
-  InternedMessageView* GetInternedMessageView(uint32_t field_id, uint64_t iid);
+  // Returns |nullptr| if the message with the given |iid| was not found (also
+  // records a stat in this case).
+  InternedMessageView* GetInternedMessageView(uint32_t field_id,
+                                              uint64_t iid) {
+    if (PERFETTO_LIKELY(field_id < interned_data_.size())) {
+      InternedMessageView* view = interned_data_[field_id].Find(iid);
+      if (PERFETTO_LIKELY(view)) {
+        return view;
+      }
+    }
+    OnInternedMessageNotFound();
+    return nullptr;
+  }
+
   // Returns |nullptr| if no defaults were set.
   InternedMessageView* GetTracePacketDefaultsView() {
     if (!trace_packet_defaults_.has_value()) {
@@ -297,6 +310,8 @@ class PacketSequenceStateGeneration : public RefCounted {
   // data out of trace packets.
   void InternMessage(uint32_t field_id, TraceBlobView message);
 
+  PERFETTO_NO_INLINE void OnInternedMessageNotFound();
+
   TraceProcessorContext* const context_;
   InternedFieldMap interned_data_;
   TrackEventSequenceState track_event_sequence_state_;
@@ -38,6 +38,8 @@
 #include "perfetto/protozero/field.h"
 #include "perfetto/protozero/proto_decoder.h"
 #include "perfetto/public/compiler.h"
+#include "perfetto/trace_processor/trace_blob.h"
+#include "perfetto/trace_processor/trace_blob_view.h"
 #include "src/trace_processor/importers/common/clock_tracker.h"
 #include "src/trace_processor/importers/common/event_tracker.h"
 #include "src/trace_processor/importers/common/import_logs_tracker.h"
@@ -489,7 +491,8 @@ void ProtoTraceReader::ParseTracePacketDefaults(
 
   auto* state = GetIncrementalStateForPacketSequence(
       packet_decoder.trusted_packet_sequence_id());
-  state->UpdateTracePacketDefaults(std::move(trace_packet_defaults));
+  state->UpdateTracePacketDefaults(
+      MaybeCopyIncrementalState(std::move(trace_packet_defaults)));
 }
 
 void ProtoTraceReader::ParseInternedData(
@@ -519,6 +522,7 @@ void ProtoTraceReader::ParseInternedData(
   }
 
   // Store references to interned data submessages into the sequence's state.
+  interned_data = MaybeCopyIncrementalState(std::move(interned_data));
   protozero::ProtoDecoder decoder(interned_data.data(), interned_data.length());
   for (protozero::Field f = decoder.ReadField(); f.valid();
        f = decoder.ReadField()) {
@@ -527,6 +531,17 @@ void ProtoTraceReader::ParseInternedData(
   }
 }
 
+TraceBlobView ProtoTraceReader::MaybeCopyIncrementalState(TraceBlobView blob) {
+  // Incremental state is kept alive for as long as a packet referencing it is
+  // buffered. When the sorter spills packets to disk, referencing the trace
+  // chunks here would keep them in memory anyway, defeating the purpose of
+  // spilling: make a copy of just the bytes we need instead.
+  if (!context_->sorter->spilling_enabled()) {
+    return blob;
+  }
+  return TraceBlobView(TraceBlob::CopyFrom(blob.data(), blob.size()));
+}
+
 base::Status ProtoTraceReader::ParseClockSnapshot(ConstBytes blob,
                                                   uint32_t seq_id) {
   std::vector<ClockTracker::ClockTimestamp> clock_timestamps;
@@ -842,6 +857,21 @@ void ProtoTraceReader::ParseTraceStats(ConstBytes blob) {
     }
   }
 
+  if (evt.has_file_writer_stats()) {
+    protos::pbzero::TraceStats::FileWriterStats::Decoder fwstat(
+        evt.file_writer_stats());
+    storage->SetStats(stats::traced_file_writer_bytes_written,
+                      static_cast<int64_t>(fwstat.bytes_written()));
+    storage->SetStats(stats::traced_file_writer_write_errors,
+                      static_cast<int64_t>(fwstat.write_errors()));
+    storage->SetStats(stats::traced_file_writer_max_pending_bytes,
+                      static_cast<int64_t>(fwstat.max_pending_bytes()));
+    storage->SetStats(stats::traced_file_writer_stalls,
+                      static_cast<int64_t>(fwstat.stalls()));
+    storage->SetStats(stats::traced_file_writer_stall_time_ns,
+                      static_cast<int64_t>(fwstat.stall_time_ns()));
+  }
+
   switch (evt.final_flush_outcome()) {
     case protos::pbzero::TraceStats::FINAL_FLUSH_SUCCEEDED:
       storage->IncrementStats(stats::traced_final_flush_succeeded, 1);
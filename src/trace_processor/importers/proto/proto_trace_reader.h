@@ -26,6 +26,7 @@
 
 #include "perfetto/base/status.h"
 #include "perfetto/ext/base/flat_hash_map.h"
+#include "perfetto/trace_processor/trace_blob_view.h"
 #include "src/trace_processor/importers/common/chunked_trace_reader.h"
 #include "src/trace_processor/importers/proto/packet_sequence_state_builder.h"
 #include "src/trace_processor/importers/proto/proto_importer_module.h"
@@ -100,6 +101,7 @@ class ProtoTraceReader : public ChunkedTraceReader {
                                 TraceBlobView trace_packet_defaults);
   void ParseInternedData(const protos::pbzero::TracePacket_Decoder&,
                          TraceBlobView interned_data);
+  TraceBlobView MaybeCopyIncrementalState(TraceBlobView);
   void ParseTraceConfig(ConstBytes);
   void ParseTraceStats(ConstBytes);
 
@@ -26,23 +26,41 @@ ProtoTraceTokenizer::ProtoTraceTokenizer() = default;
 
 base::Status ProtoTraceTokenizer::Decompress(TraceBlobView input,
                                              TraceBlobView* output) {
-  PERFETTO_DCHECK(util::IsGzipSupported());
-
   std::vector<uint8_t> data;
   data.reserve(input.length());
+  auto consumer = [&data](const uint8_t* buffer, size_t buffer_len) {
+    data.insert(data.end(), buffer, buffer + buffer_len);
+  };
 
-  // Ensure that the decompressor is able to cope with a new stream of data.
-  decompressor_.Reset();
-  using ResultCode = util::GzipDecompressor::ResultCode;
-  ResultCode ret = decompressor_.FeedAndExtract(
-      input.data(), input.length(),
-      [&data](const uint8_t* buffer, size_t buffer_len) {
-        data.insert(data.end(), buffer, buffer + buffer_len);
-      });
-
-  if (ret == ResultCode::kError || ret == ResultCode::kNeedsMoreInput) {
-    return base::ErrStatus("Failed to decompress (error code: %d)",
-                           static_cast<int>(ret));
+  // The service compresses packets with zstd or deflate depending on
+  // TraceConfig.compression_type: tell them apart with the zstd magic number.
+  if (util::IsZstdFrame(input.data(), input.length())) {
+    if (!util::IsZstdSupported()) {
+      return base::ErrStatus(
+          "Cannot decode compressed packets. Zstd not enabled");
+    }
+    zstd_decompressor_.Reset();
+    using ResultCode = util::ZstdDecompressor::ResultCode;
+    ResultCode ret = zstd_decompressor_.FeedAndExtract(
+        input.data(), input.length(), consumer);
+    if (ret != ResultCode::kEof) {
+      return base::ErrStatus("Failed to decompress zstd (error code: %d)",
+                             static_cast<int>(ret));
+    }
+  } else {
+    if (!util::IsGzipSupported()) {
+      return base::ErrStatus(
+          "Cannot decode compressed packets. Zlib not enabled");
+    }
+    // Ensure that the decompressor is able to cope with a new stream of data.
+    decompressor_.Reset();
+    using ResultCode = util::GzipDecompressor::ResultCode;
+    ResultCode ret =
+        decompressor_.FeedAndExtract(input.data(), input.length(), consumer);
+    if (ret == ResultCode::kError || ret == ResultCode::kNeedsMoreInput) {
+      return base::ErrStatus("Failed to decompress (error code: %d)",
+                             static_cast<int>(ret));
+    }
   }
 
   TraceBlob out_blob = TraceBlob::CopyFrom(data.data(), data.size());
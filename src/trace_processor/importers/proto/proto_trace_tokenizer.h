@@ -31,6 +31,7 @@
 #include "perfetto/trace_processor/trace_blob_view.h"
 #include "protos/perfetto/trace/trace_packet.pbzero.h"
 #include "src/trace_processor/util/gzip_utils.h"
+#include "src/trace_processor/util/zstd_utils.h"
 
 #include "perfetto/ext/base/status_macros.h"
 #include "protos/perfetto/trace/trace.pbzero.h"
@@ -181,11 +182,6 @@ class ProtoTraceTokenizer {
         continue;
       }
 
-      if (!util::IsGzipSupported()) {
-        return base::ErrStatus(
-            "Cannot decode compressed packets. Zlib not enabled");
-      }
-
       protozero::ConstBytes field = decoder.compressed_packets();
       TraceBlobView compressed_packets = packet->slice(field.data, field.size);
       TraceBlobView packets;
@@ -226,6 +222,7 @@ class ProtoTraceTokenizer {
 
   // Allows support for compressed trace packets.
   util::GzipDecompressor decompressor_;
+  util::ZstdDecompressor zstd_decompressor_;
 };
 
 }  // namespace perfetto::trace_processor
@@ -16,9 +16,14 @@
 
 #include "src/trace_processor/importers/proto/proto_trace_tokenizer.h"
 
+#include "perfetto/base/build_config.h"
 #include "perfetto/protozero/scattered_heap_buffer.h"
 #include "test/gtest_and_gmock.h"
 
+#if PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+#include <zstd.h>
+#endif
+
 namespace perfetto::trace_processor {
 namespace {
 
@@ -144,5 +149,44 @@ TEST(ProtoTraceTokenizerTest, SkipFieldsSingleByteByByte) {
   }
 }
 
+#if PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+TEST(ProtoTraceTokenizerTest, ZstdCompressedPackets) {
+  protozero::HeapBuffered<protozero::Message> inner;
+  inner->AppendString(/*field_id=*/1, "payload1");
+  inner->AppendString(/*field_id=*/1, "payload2");
+  std::vector<uint8_t> inner_data = inner.SerializeAsArray();
+
+  std::vector<uint8_t> compressed(ZSTD_compressBound(inner_data.size()));
+  size_t compressed_size =
+      ZSTD_compress(compressed.data(), compressed.size(), inner_data.data(),
+                    inner_data.size(), /*compressionLevel=*/3);
+  ASSERT_FALSE(ZSTD_isError(compressed_size));
+
+  // A TracePacket with only the compressed_packets field set.
+  protozero::HeapBuffered<protozero::Message> message;
+  protozero::Message* packet = message->BeginNestedMessage<protozero::Message>(
+      /*field_id=*/1);
+  packet->AppendBytes(/*field_id=*/50, compressed.data(), compressed_size);
+  packet->Finalize();
+  std::vector<uint8_t> data = message.SerializeAsArray();
+
+  ProtoTraceTokenizer tokenizer;
+
+  MockFunction<base::Status(TraceBlobView)> cb;
+  EXPECT_CALL(cb, Call)
+      .WillOnce([](TraceBlobView out) {
+        EXPECT_EQ(ToStringView(out), "payload1");
+        return base::OkStatus();
+      })
+      .WillOnce([](TraceBlobView out) {
+        EXPECT_EQ(ToStringView(out), "payload2");
+        return base::OkStatus();
+      });
+
+  auto bv = TraceBlobView(TraceBlob::CopyFrom(data.data(), data.size()));
+  EXPECT_TRUE(tokenizer.Tokenize(std::move(bv), cb.AsStdFunction()).ok());
+}
+#endif  // PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+
 }  // namespace
 }  // namespace perfetto::trace_processor
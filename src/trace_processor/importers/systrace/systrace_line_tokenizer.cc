@@ -51,7 +51,7 @@ SystraceLineTokenizer::SystraceLineTokenizer()
     : std_line_matcher_(
           std::regex(R"(-(\d+)\s+\(?\s*(\d+|-+)?\)?\s?\[(\d+)\]\s*)"
                      R"(([a-zA-Z.]{3}[0-9.]{1,2}\s*)?(\d+\.\d+):\s+(\S+):)")) {
-  if constexpr (regex::IsRegexSupported()) {
+  if constexpr (regex::IsSubmatchSupported()) {
     auto regex_or = regex::Regex::Create(
         R"(-([0-9]+)[[:space:]]+\(?[[:space:]]*([0-9]+|-+)?\)?[[:space:]]?\[([0-9]+)\][[:space:]]*([a-zA-Z.]{3}[0-9.]{1,2}[[:space:]]*)?([0-9]+\.[0-9]+):[[:space:]]+([^[:space:]]+):)");
     if (!regex_or.ok()) {
@@ -81,7 +81,7 @@ base::Status SystraceLineTokenizer::Tokenize(const std::string& buffer,
 
   std::vector<std::string_view> matches;
   bool matched;
-  if constexpr (regex::IsRegexSupported()) {
+  if constexpr (regex::IsSubmatchSupported()) {
     line_matcher_->Submatch(buffer.c_str(), matches);
     matched = !matches.empty();
   } else {
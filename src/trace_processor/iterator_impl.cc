@@ -18,6 +18,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 
@@ -26,6 +27,7 @@
 #include "perfetto/ext/base/status_or.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "perfetto/trace_processor/iterator.h"
+#include "src/trace_processor/perfetto_sql/engine/dataframe_module.h"
 #include "src/trace_processor/perfetto_sql/engine/perfetto_sql_engine.h"
 #include "src/trace_processor/storage/trace_storage.h"
 #include "src/trace_processor/trace_processor_impl.h"
@@ -56,6 +58,19 @@ void IteratorImpl::RecordFirstNextInSqlStats() {
   sql_stats->RecordQueryFirstNext(sql_stats_row_, t_first_next.count());
 }
 
+std::optional<IteratorImpl::DataframeScan> IteratorImpl::TakeDataframeScan() {
+  if (!result_.ok() || !called_next_ || result_->stmt.IsDone()) {
+    return std::nullopt;
+  }
+  auto columns =
+      trace_processor_.get()->engine_->GetDataframeScanColumns(*result_);
+  if (!columns) {
+    return std::nullopt;
+  }
+  return DataframeScan{&result_->dataframe_cursor.cursor->df_cursor,
+                       std::move(*columns)};
+}
+
 Iterator::Iterator(std::unique_ptr<IteratorImpl> iterator)
     : iterator_(std::move(iterator)) {}
 Iterator::~Iterator() = default;
@@ -20,7 +20,9 @@
 #include <sqlite3.h>
 #include <cstddef>
 #include <cstdint>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "perfetto/base/logging.h"
 #include "perfetto/base/status.h"
@@ -28,6 +30,7 @@
 #include "perfetto/ext/base/status_or.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "perfetto/trace_processor/iterator.h"
+#include "src/trace_processor/perfetto_sql/engine/dataframe_module.h"
 #include "src/trace_processor/perfetto_sql/engine/perfetto_sql_engine.h"
 #include "src/trace_processor/sqlite/sqlite_engine.h"
 
@@ -38,6 +41,15 @@ class TraceProcessorImpl;
 
 class IteratorImpl {
  public:
+  // The remaining rows of a query which can be read straight from a
+  // dataframe cursor. See TakeDataframeScan().
+  struct DataframeScan {
+    // Positioned on the row Get() would have returned.
+    DataframeModule::DfCursor* cursor;
+    // For each result column, the index of the dataframe column to read.
+    std::vector<uint32_t> columns;
+  };
+
   IteratorImpl(TraceProcessorImpl* impl,
                base::StatusOr<PerfettoSqlEngine::ExecutionResult>,
                uint32_t sql_stats_row);
@@ -138,6 +150,14 @@ class IteratorImpl {
     return result_.ok() ? result_->stmt.sql() : "";
   }
 
+  // If the statement is a plain scan of a single dataframe table (see
+  // PerfettoSqlEngine::GetDataframeScanColumns()) and is positioned on a
+  // row, returns the cursor of that table. The current row and all the
+  // remaining ones can then be read from the cursor instead of going through
+  // SQLite. Next() and Get() must not be called after this function returns
+  // a value.
+  std::optional<DataframeScan> TakeDataframeScan();
+
  private:
   // Dummy function to pass to ScopedResource.
   static int DummyClose(TraceProcessorImpl*) { return 0; }
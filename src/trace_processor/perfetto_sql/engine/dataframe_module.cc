@@ -30,6 +30,8 @@
 #include <vector>
 
 #include "perfetto/base/logging.h"
+#include "perfetto/ext/base/status_macros.h"
+#include "perfetto/ext/base/status_or.h"
 #include "perfetto/ext/base/string_utils.h"
 #include "src/trace_processor/core/dataframe/cursor_impl.h"  // IWYU pragma: keep
 #include "src/trace_processor/core/dataframe/dataframe.h"
@@ -44,6 +46,106 @@ namespace perfetto::trace_processor {
 
 namespace {
 
+// The maximum number of plans cached for a single dataframe: the cache is
+// cleared once it grows past this.
+constexpr size_t kMaxCachedPlans = 1024;
+
+// Separates the plan id and the DelegatedScan of the plan, written as
+// "<id>,<applies all constraints>,<constraint count>,<order by count>", from
+// the serialized plan in `idxStr`.
+constexpr char kIdxStrIdSeparator = ':';
+
+// Returns a key identifying the "shape" of a query: two queries with the same
+// key are guaranteed to have the same plan (as long as the dataframe is not
+// mutated).
+std::string PlanCacheKey(const std::vector<dataframe::FilterSpec>& filter_specs,
+                         const std::vector<dataframe::DistinctSpec>& distinct,
+                         const std::vector<dataframe::SortSpec>& sort_specs,
+                         const dataframe::LimitSpec& limit_spec,
+                         uint64_t cols_used) {
+  std::string key;
+  auto append = [&key](uint64_t value) {
+    key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  };
+  append(filter_specs.size());
+  for (const auto& f : filter_specs) {
+    append(f.col);
+    append(f.op.index());
+  }
+  append(distinct.size());
+  for (const auto& d : distinct) {
+    append(d.col);
+  }
+  append(sort_specs.size());
+  for (const auto& s : sort_specs) {
+    append(s.col);
+    append(static_cast<uint64_t>(s.direction));
+  }
+  append(limit_spec.limit.has_value());
+  append(limit_spec.limit.value_or(0));
+  append(limit_spec.offset.has_value());
+  append(limit_spec.offset.value_or(0));
+  append(cols_used);
+  return key;
+}
+
+// Returns the plan for the given query, either from the cache in `s` or by
+// planning the query and adding it to the cache. Sets `value_index` on each
+// of `filter_specs`.
+base::StatusOr<const DataframeModule::CachedPlan*> GetOrCreatePlan(
+    DataframeModule::State* s,
+    std::vector<dataframe::FilterSpec>& filter_specs,
+    const std::vector<dataframe::DistinctSpec>& distinct_specs,
+    const std::vector<dataframe::SortSpec>& sort_specs,
+    const dataframe::LimitSpec& limit_spec,
+    uint64_t cols_used,
+    bool* cache_hit) {
+  uint32_t mutations = s->dataframe->non_column_mutations();
+  if (mutations != s->plan_cache_mutations ||
+      s->plan_cache.size() >= kMaxCachedPlans) {
+    s->plan_cache.Clear();
+    s->plan_cache_by_id.Clear();
+    s->plan_cache_mutations = mutations;
+  }
+
+  std::string key = PlanCacheKey(filter_specs, distinct_specs, sort_specs,
+                                 limit_spec, cols_used);
+  if (auto* cached = s->plan_cache.Find(key); cached) {
+    const auto& value_indices = (*cached)->value_indices;
+    for (uint32_t i = 0; i < filter_specs.size(); ++i) {
+      filter_specs[i].value_index = value_indices[i];
+    }
+    *cache_hit = true;
+    return cached->get();
+  }
+  *cache_hit = false;
+
+  // The planner reorders the filters so plan a copy of them and map the
+  // value indices back to the original order.
+  std::vector<dataframe::FilterSpec> planned_specs = filter_specs;
+  ASSIGN_OR_RETURN(auto plan, s->dataframe->PlanQuery(
+                                  planned_specs, distinct_specs, sort_specs,
+                                  limit_spec, cols_used));
+  auto cached = std::make_unique<DataframeModule::CachedPlan>();
+  cached->value_indices.resize(filter_specs.size());
+  for (const auto& planned : planned_specs) {
+    for (uint32_t i = 0; i < filter_specs.size(); ++i) {
+      if (filter_specs[i].source_index == planned.source_index) {
+        filter_specs[i].value_index = planned.value_index;
+        cached->value_indices[i] = planned.value_index;
+      }
+    }
+  }
+  cached->id = s->next_plan_id++;
+  cached->serialized_plan = plan.Serialize();
+  cached->plan = std::move(plan);
+
+  const DataframeModule::CachedPlan* res = cached.get();
+  s->plan_cache_by_id.Insert(res->id, res);
+  s->plan_cache.Insert(std::move(key), std::move(cached));
+  return res;
+}
+
 std::optional<dataframe::Op> SqliteOpToDataframeOp(int op) {
   switch (op) {
     case SQLITE_INDEX_CONSTRAINT_EQ:
@@ -166,6 +268,7 @@ int DataframeModule::Create(sqlite3* db,
     return r;
   }
   std::unique_ptr<Vtab> res = std::make_unique<Vtab>();
+  res->context = ctx;
   res->id_col_idx = FindIdColumnIndex(state->dataframe->column_names());
   res->state = ctx->OnCreate(argc, argv, std::move(state));
   res->name = argv[2];
@@ -187,7 +290,8 @@ int DataframeModule::Connect(sqlite3* db,
                              char**) {
   PERFETTO_CHECK(argc == 3);
 
-  auto* vtab_state = GetContext(raw_ctx)->OnConnect(argc, argv);
+  auto* ctx = GetContext(raw_ctx);
+  auto* vtab_state = ctx->OnConnect(argc, argv);
   auto* state =
       sqlite::ModuleStateManager<DataframeModule>::GetState(vtab_state);
   std::string create_stmt = CreateTableStmt(state->dataframe->CreateSpec());
@@ -195,6 +299,7 @@ int DataframeModule::Connect(sqlite3* db,
     return r;
   }
   std::unique_ptr<Vtab> res = std::make_unique<Vtab>();
+  res->context = ctx;
   res->state = vtab_state;
   res->id_col_idx = FindIdColumnIndex(state->dataframe->column_names());
   res->name = argv[2];
@@ -311,10 +416,12 @@ int DataframeModule::BestIndex(sqlite3_vtab* tab, sqlite3_index_info* info) {
   }
   info->orderByConsumed = true;
 
+  bool cache_hit = false;
   SQLITE_ASSIGN_OR_RETURN(
-      tab, auto plan,
-      s->dataframe->PlanQuery(filter_specs, distinct_specs, sort_specs,
-                              limit_spec, info->colUsed));
+      tab, const CachedPlan* cached,
+      GetOrCreatePlan(s, filter_specs, distinct_specs, sort_specs, limit_spec,
+                      info->colUsed, &cache_hit));
+  const dataframe::Dataframe::QueryPlan& plan = cached->plan;
   int max_argv = 0;
   for (const auto& c : filter_specs) {
     if (auto value_index = c.value_index; value_index) {
@@ -333,6 +440,11 @@ int DataframeModule::BestIndex(sqlite3_vtab* tab, sqlite3_index_info* info) {
     info->aConstraintUsage[*offset_constraint_idx].omit = true;
     info->aConstraintUsage[*offset_constraint_idx].argvIndex = ++max_argv;
   }
+  bool applies_all_constraints = true;
+  for (int i = 0; i < info->nConstraint; ++i) {
+    applies_all_constraints &= info->aConstraint[i].usable &&
+                               info->aConstraintUsage[i].argvIndex > 0;
+  }
   info->needToFreeIdxStr = true;
   info->estimatedCost = plan.estimated_cost();
   info->estimatedRows = plan.estimated_row_count();
@@ -342,10 +454,11 @@ int DataframeModule::BestIndex(sqlite3_vtab* tab, sqlite3_index_info* info) {
   info->idxNum = v->best_idx_num++;
   PERFETTO_TP_TRACE(
       metatrace::Category::QUERY_TIMELINE, "DATAFRAME_BEST_INDEX",
-      [info, v, s, &plan](metatrace::Record* record) {
+      [info, v, s, &plan, cache_hit](metatrace::Record* record) {
         base::StackString<32> unique("%d",
                                      info->idxFlags & SQLITE_INDEX_SCAN_UNIQUE);
         record->AddArg("name", v->name);
+        record->AddArg("planCacheHit", cache_hit ? "1" : "0");
         record->AddArg("unique", unique.string_view());
         record->AddArg("idxNum",
                        base::StackString<32>("%d", info->idxNum).string_view());
@@ -415,18 +528,25 @@ int DataframeModule::BestIndex(sqlite3_vtab* tab, sqlite3_index_info* info) {
           }
         }
       });
-  info->idxStr = sqlite3_mprintf("%s", std::move(plan).Serialize().data());
+  info->idxStr = sqlite3_mprintf(
+      "%u,%d,%d,%d%c%s", cached->id, applies_all_constraints,
+      info->nConstraint, info->nOrderBy, kIdxStrIdSeparator,
+      cached->serialized_plan.c_str());
   return SQLITE_OK;
 }
 
-int DataframeModule::Open(sqlite3_vtab*, sqlite3_vtab_cursor** cursor) {
+int DataframeModule::Open(sqlite3_vtab* vtab, sqlite3_vtab_cursor** cursor) {
   std::unique_ptr<Cursor> c = std::make_unique<Cursor>();
+  c->context = GetVtab(vtab)->context;
   *cursor = c.release();
   return SQLITE_OK;
 }
 
 int DataframeModule::Close(sqlite3_vtab_cursor* cursor) {
   std::unique_ptr<Cursor> c(GetCursor(cursor));
+  if (c->context->last_filtered_cursor.cursor == c.get()) {
+    c->context->last_filtered_cursor = {};
+  }
   return SQLITE_OK;
 }
 
@@ -437,23 +557,50 @@ int DataframeModule::Filter(sqlite3_vtab_cursor* cur,
                             sqlite3_value** argv) {
   auto* c = GetCursor(cur);
   if (idxStr != c->last_idx_str) {
-    auto plan = dataframe::Dataframe::QueryPlan::Deserialize(idxStr);
+    auto* v = GetVtab(cur->pVtab);
+    auto* s = sqlite::ModuleStateManager<DataframeModule>::GetState(v->state);
+
+    // Reuse the plan from the cache if it's still there; otherwise (e.g. if
+    // the cache was cleared because the dataframe was mutated) fall back to
+    // deserializing the plan from `idxStr`.
+    const char* sep = strchr(idxStr, kIdxStrIdSeparator);
+    PERFETTO_CHECK(sep);
+    std::vector<std::string> prefix =
+        base::SplitString(std::string(idxStr, sep), ",");
+    PERFETTO_CHECK(prefix.size() == 4);
+    auto id = base::StringToUInt32(prefix[0]);
+    auto applies_all_constraints = base::StringToUInt32(prefix[1]);
+    auto constraint_count = base::StringToUInt32(prefix[2]);
+    auto order_by_count = base::StringToUInt32(prefix[3]);
+    PERFETTO_CHECK(id && applies_all_constraints && constraint_count &&
+                   order_by_count);
+    const CachedPlan* const* cached = s->plan_cache_by_id.Find(*id);
+    dataframe::Dataframe::QueryPlan deserialized;
+    if (!cached) {
+      deserialized = dataframe::Dataframe::QueryPlan::Deserialize(sep + 1);
+    }
+    const auto& plan = cached ? (*cached)->plan : deserialized;
     PERFETTO_TP_TRACE(
         metatrace::Category::QUERY_DETAILED, "DATAFRAME_FILTER_PREPARE",
-        [&plan, idxNum](metatrace::Record* record) {
+        [&plan, idxNum, cached](metatrace::Record* record) {
           record->AddArg("idxNum",
                          base::StackString<32>("%d", idxNum).string_view());
+          record->AddArg("planCacheHit", cached ? "1" : "0");
           auto str = plan.BytecodeToString();
           for (uint32_t i = 0; i < str.size(); ++i) {
             base::StackString<32> c("bytecode[%u]", i);
             record->AddArg(c.string_view(), str[i]);
           }
         });
-    auto* v = GetVtab(cur->pVtab);
-    auto* s = sqlite::ModuleStateManager<DataframeModule>::GetState(v->state);
     s->dataframe->PrepareCursor(plan, c->df_cursor);
+    c->df_cursor.SetThreadPool(v->context->thread_pool);
+    c->df_cursor.SetStringPoolTrigramIndex(
+        v->context->string_pool_trigram_index);
     c->last_idx_str = idxStr;
     c->id_col_idx = v->id_col_idx;
+    c->dataframe = s->dataframe;
+    c->scan = DelegatedScan{*applies_all_constraints != 0, *constraint_count,
+                            *order_by_count};
   }
   // SQLite's API claims it will never pass more than 16 arguments
   // so assert that here as our std::array is fixed size.
@@ -463,6 +610,7 @@ int DataframeModule::Filter(sqlite3_vtab_cursor* cur,
          static_cast<void*>(argv),
          sizeof(sqlite3_value*) * static_cast<size_t>(argc));
   c->df_cursor.Execute(fetcher);
+  c->context->last_filtered_cursor = {c, c->dataframe, c->scan};
   return SQLITE_OK;
 }
 
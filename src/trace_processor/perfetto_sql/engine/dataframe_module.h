@@ -21,10 +21,12 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "perfetto/ext/base/flat_hash_map.h"
 #include "src/trace_processor/containers/null_term_string_view.h"
 #include "src/trace_processor/core/dataframe/cursor.h"
 #include "src/trace_processor/core/dataframe/dataframe.h"
@@ -35,8 +37,14 @@
 #include "src/trace_processor/sqlite/bindings/sqlite_value.h"
 #include "src/trace_processor/sqlite/module_state_manager.h"
 
+namespace perfetto::base {
+class ThreadPool;
+}  // namespace perfetto::base
+
 namespace perfetto::trace_processor {
 
+class StringPoolTrigramIndex;
+
 // Adapter class between SQLite and the Dataframe API. Allows SQLite to query
 // and iterate over the results of a dataframe query.
 struct DataframeModule : sqlite::Module<DataframeModule> {
@@ -45,6 +53,18 @@ struct DataframeModule : sqlite::Module<DataframeModule> {
   static constexpr bool kDoesOverloadFunctions = false;
   static constexpr bool kDoesSupportTransactions = true;
 
+  // A query plan built by BestIndex, cached so that it can be reused when
+  // SQLite asks for the same shape of query again.
+  struct CachedPlan {
+    // Identifies the plan in `idxStr` so that Filter can reuse `plan` without
+    // deserializing it.
+    uint32_t id;
+    dataframe::Dataframe::QueryPlan plan;
+    std::string serialized_plan;
+    // The `value_index` assigned by the planner to each filter, in the order
+    // the filters were passed to the planner.
+    std::vector<std::optional<uint32_t>> value_indices;
+  };
   struct State {
     explicit State(dataframe::Dataframe* _dataframe) : dataframe(_dataframe) {}
     explicit State(std::unique_ptr<dataframe::Dataframe> _owned_dataframe)
@@ -53,9 +73,48 @@ struct DataframeModule : sqlite::Module<DataframeModule> {
     std::unique_ptr<dataframe::Dataframe> owned_dataframe;
     dataframe::Dataframe* dataframe;
     std::vector<std::string> named_indexes;
+
+    // Cache of query plans keyed on the shape of the query (filters,
+    // distinct, sort, limit and used columns). SQLite calls BestIndex many
+    // times for the same shape while preparing statements.
+    base::FlatHashMap<std::string, std::unique_ptr<CachedPlan>> plan_cache;
+    // The same plans as `plan_cache`, keyed on `CachedPlan::id`.
+    base::FlatHashMap<uint32_t, const CachedPlan*> plan_cache_by_id;
+    // The value of `Dataframe::non_column_mutations()` when the plans in the
+    // cache were built.
+    uint32_t plan_cache_mutations = 0;
+    uint32_t next_plan_id = 0;
+  };
+  // What SQLite delegated to the table in the plan picked by BestIndex.
+  struct DelegatedScan {
+    // Whether the plan applies every constraint passed to BestIndex. The
+    // ordering asked for by SQLite is always applied by the plan.
+    bool applies_all_constraints = false;
+    // The number of constraints and ORDER BY terms passed to BestIndex.
+    uint32_t constraint_count = 0;
+    uint32_t order_by_count = 0;
+  };
+  struct Cursor;
+  // A cursor on which Filter was called, the dataframe it reads and what
+  // SQLite delegated to it. The dataframe is recorded separately so that it
+  // can be compared against without dereferencing |cursor|, which might have
+  // been closed since.
+  struct FilteredCursor {
+    Cursor* cursor = nullptr;
+    const dataframe::Dataframe* dataframe = nullptr;
+    DelegatedScan scan;
   };
   struct Context : sqlite::ModuleStateManager<DataframeModule> {
     std::unique_ptr<State> temporary_create_state;
+    // Pool used to execute filters on large tables in parallel. Not owned and
+    // may be null.
+    base::ThreadPool* thread_pool = nullptr;
+    // Index used to speed up glob filters on string columns. Not owned and
+    // may be null.
+    StringPoolTrigramIndex* string_pool_trigram_index = nullptr;
+    // The cursor on which Filter was most recently called. Used by the engine
+    // to find the cursor backing a statement which simply scans a dataframe.
+    FilteredCursor last_filtered_cursor;
   };
   struct SqliteValueFetcher : dataframe::ValueFetcher {
     using Type = sqlite::Type;
@@ -97,6 +156,7 @@ struct DataframeModule : sqlite::Module<DataframeModule> {
     sqlite3_context* ctx;
   };
   struct Vtab : sqlite::Module<DataframeModule>::Vtab {
+    Context* context;
     sqlite::ModuleStateManager<DataframeModule>::PerVtabState* state;
     std::string name;
     int best_idx_num = 0;
@@ -104,10 +164,12 @@ struct DataframeModule : sqlite::Module<DataframeModule> {
   };
   using DfCursor = dataframe::Cursor<SqliteValueFetcher>;
   struct Cursor : sqlite::Module<DataframeModule>::Cursor {
+    Context* context;
     const dataframe::Dataframe* dataframe;
     DfCursor df_cursor;
     const char* last_idx_str = nullptr;
     uint32_t id_col_idx = 0;
+    DelegatedScan scan;
   };
 
   static int Create(sqlite3*,
@@ -0,0 +1,939 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/perfetto_sql/engine/dataframe_query_rewriter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "perfetto/ext/base/string_utils.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/core/dataframe/specs.h"
+#include "src/trace_processor/perfetto_sql/grammar/perfettosql_grammar.h"
+#include "src/trace_processor/perfetto_sql/tokenizer/sqlite_tokenizer.h"
+#include "src/trace_processor/sqlite/sql_source.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+using Token = SqliteTokenizer::Token;
+
+// Same as the number of bindable columns of __intrinsic_table_ptr.
+constexpr uint32_t kMaxOutputColumns = 16;
+
+// Maximum number of views looked through to find the table backing a view.
+constexpr uint32_t kMaxViewDepth = 4;
+
+struct SelectItem {
+  // The aggregation for this item or std::nullopt if this is a grouped column.
+  std::optional<std::string> aggregate;
+
+  // The column referenced by this item or std::nullopt for COUNT(*).
+  std::optional<std::string> column;
+
+  // SQL for the name of the item in the result or std::nullopt if the item
+  // is a column without an alias: the result is then named after the column.
+  std::optional<std::string> result_name;
+};
+
+// Returns true if |t| is an identifier which does not need to be quoted: we
+// don't try to handle quoted identifiers as their lookup rules differ from
+// plain ones.
+bool IsPlainIdentifier(const Token& t) {
+  return t.token_type == TK_ID && !t.str.empty() &&
+         (isalpha(static_cast<unsigned char>(t.str[0])) || t.str[0] == '_');
+}
+
+std::string Quote(std::string_view str, char quote) {
+  std::string res(1, quote);
+  for (char c : str) {
+    if (c == quote) {
+      res.push_back(quote);
+    }
+    res.push_back(c);
+  }
+  res.push_back(quote);
+  return res;
+}
+
+// Returns the index in |table.columns| of the column called |name|. Like in
+// SQLite, names are matched case insensitively.
+std::optional<uint32_t> FindColumn(const DataframeTable& table,
+                                   const std::string& name) {
+  for (uint32_t i = 0; i < table.columns.size(); ++i) {
+    if (base::CaseInsensitiveEqual(table.columns[i].first, name)) {
+      return i;
+    }
+  }
+  return std::nullopt;
+}
+
+// Returns the index of the dataframe column called |name| in |table|.
+std::optional<uint32_t> DataframeColumn(const DataframeTable& table,
+                                        const std::string& name) {
+  std::optional<uint32_t> col = FindColumn(table, name);
+  if (!col) {
+    return std::nullopt;
+  }
+  return table.columns[*col].second;
+}
+
+// Returns the SQL for the name SQLite gives to a column selected without an
+// alias: the name of the column in the table, whatever the case it was
+// written with.
+std::string ColumnResultName(const DataframeTable& table,
+                             const std::string& name) {
+  return Quote(table.columns[*FindColumn(table, name)].first, '"');
+}
+
+// Returns the WHERE clause binding the first |count| columns of
+// __intrinsic_table_ptr.
+std::string TablePtrBindClause(uint32_t count) {
+  std::string bind;
+  for (uint32_t i = 0; i < count; ++i) {
+    std::string c = "c" + std::to_string(i);
+    bind += i == 0 ? "" : " AND ";
+    bind += "__intrinsic_table_ptr_bind(" + c + ", '" + c + "')";
+  }
+  return bind;
+}
+
+bool IsIntegerColumn(const dataframe::DataframeSpec& spec, uint32_t col) {
+  const auto& type = spec.column_specs[col].type;
+  return !type.Is<dataframe::Double>() && !type.Is<dataframe::String>();
+}
+
+// Parses an optional `[AS] <alias>` starting at |next|. Returns false if the
+// alias is malformed. On success, sets |alias| if there is one and |next| to
+// the first token after it.
+bool ParseAlias(SqliteTokenizer& tokenizer,
+                Token& next,
+                std::optional<std::string>& alias) {
+  if (next.token_type == TK_AS) {
+    next = tokenizer.NextNonWhitespace();
+    if (next.token_type != TK_ID) {
+      return false;
+    }
+  }
+  if (next.token_type == TK_ID) {
+    alias = std::string(next.str);
+    next = tokenizer.NextNonWhitespace();
+  }
+  return true;
+}
+
+// Parses a single item of the SELECT list, starting at |start|. On success,
+// returns the item and sets |next| to the first token after the item.
+std::optional<SelectItem> ParseSelectItem(SqliteTokenizer& tokenizer,
+                                          const Token& start,
+                                          Token& next) {
+  if (!IsPlainIdentifier(start)) {
+    return std::nullopt;
+  }
+  SelectItem item;
+  next = tokenizer.NextNonWhitespace();
+  if (next.token_type == TK_LP) {
+    std::string fn = base::ToLower(std::string(start.str));
+    if (fn != "count" && fn != "sum" && fn != "min" && fn != "max") {
+      return std::nullopt;
+    }
+    Token arg = tokenizer.NextNonWhitespace();
+    Token end = arg;
+    if (arg.token_type == TK_STAR) {
+      end = tokenizer.NextNonWhitespace();
+    } else if (IsPlainIdentifier(arg)) {
+      item.column = std::string(arg.str);
+      end = tokenizer.NextNonWhitespace();
+    }
+    if (end.token_type != TK_RP || (!item.column && fn != "count")) {
+      return std::nullopt;
+    }
+    item.aggregate = fn;
+    // SQLite names the result column with the text of the expression.
+    SqlSource expr =
+        tokenizer.Substr(start, end, SqliteTokenizer::EndToken::kInclusive);
+    item.result_name = Quote(expr.sql(), '"');
+    next = tokenizer.NextNonWhitespace();
+  } else {
+    item.column = std::string(start.str);
+  }
+
+  // Aliases are passed through as written.
+  if (!ParseAlias(tokenizer, next, item.result_name)) {
+    return std::nullopt;
+  }
+  return item;
+}
+
+struct JoinTable {
+  // The table as written in the query.
+  std::string name;
+  // The name used to qualify columns of this table: the alias if there is one
+  // or the name of the table otherwise.
+  std::string qualifier;
+  DataframeTable table;
+
+  // The join condition for all but the first table, as indices of dataframe
+  // columns.
+  uint32_t left_table = 0;
+  uint32_t left_col = 0;
+  uint32_t col = 0;
+
+  // The column in the USING clause of the join, if any.
+  std::optional<std::string> using_column;
+};
+
+struct ColumnItem {
+  std::optional<std::string> table;
+  std::string column;
+
+  // SQL for the name of the item in the result or std::nullopt if the result
+  // is named after the column.
+  std::optional<std::string> result_name;
+};
+
+// Parses `<table> [[AS] <alias>]` starting at |start|. On success, sets
+// |next| to the first token after the alias.
+std::optional<JoinTable> ParseTableRef(SqliteTokenizer& tokenizer,
+                                       const Token& start,
+                                       Token& next) {
+  if (!IsPlainIdentifier(start)) {
+    return std::nullopt;
+  }
+  JoinTable table;
+  table.name = std::string(start.str);
+  table.qualifier = table.name;
+  next = tokenizer.NextNonWhitespace();
+  if (next.token_type == TK_AS) {
+    next = tokenizer.NextNonWhitespace();
+    if (!IsPlainIdentifier(next)) {
+      return std::nullopt;
+    }
+  }
+  if (IsPlainIdentifier(next)) {
+    table.qualifier = std::string(next.str);
+    next = tokenizer.NextNonWhitespace();
+  }
+  return table;
+}
+
+// Parses `[<table>.]<column>` starting at |start|. On success, sets |next| to
+// the first token after the column.
+std::optional<ColumnItem> ParseColumnRef(SqliteTokenizer& tokenizer,
+                                         const Token& start,
+                                         Token& next) {
+  if (!IsPlainIdentifier(start)) {
+    return std::nullopt;
+  }
+  ColumnItem item;
+  item.column = std::string(start.str);
+  next = tokenizer.NextNonWhitespace();
+  if (next.token_type == TK_DOT) {
+    Token col = tokenizer.NextNonWhitespace();
+    if (!IsPlainIdentifier(col)) {
+      return std::nullopt;
+    }
+    item.table = item.column;
+    item.column = std::string(col.str);
+    next = tokenizer.NextNonWhitespace();
+  }
+  return item;
+}
+
+// Returns the index of the table whose columns are qualified by |qualifier|.
+std::optional<uint32_t> FindTable(const std::vector<JoinTable>& tables,
+                                  const std::string& qualifier) {
+  std::optional<uint32_t> res;
+  for (uint32_t i = 0; i < tables.size(); ++i) {
+    if (base::CaseInsensitiveEqual(tables[i].qualifier, qualifier)) {
+      if (res) {
+        return std::nullopt;
+      }
+      res = i;
+    }
+  }
+  return res;
+}
+
+// Resolves an unqualified column to the only table among the first |count|
+// containing it. Tables joined with USING on the column are ignored as their
+// column is merged with the one of the table they are joined with.
+std::optional<uint32_t> FindTableWithColumn(
+    const std::vector<JoinTable>& tables,
+    uint32_t count,
+    const std::string& column) {
+  std::optional<uint32_t> res;
+  for (uint32_t i = 0; i < count; ++i) {
+    const auto& using_column = tables[i].using_column;
+    if (using_column && base::CaseInsensitiveEqual(*using_column, column)) {
+      continue;
+    }
+    if (FindColumn(tables[i].table, column)) {
+      if (res) {
+        return std::nullopt;
+      }
+      res = i;
+    }
+  }
+  return res;
+}
+
+// Parses a `[INNER] JOIN <table> ... (USING (<column>) | ON <a>.<c> = <b>.<d>)`
+// clause starting at |start| and appends the joined table to |tables|. On
+// success, sets |next| to the first token after the clause.
+bool ParseJoin(SqliteTokenizer& tokenizer,
+               const Token& start,
+               const DataframeTableResolver& resolve_table,
+               std::vector<JoinTable>& tables,
+               Token& next) {
+  Token t = start;
+  if (t.token_type == TK_JOIN_KW) {
+    if (!base::CaseInsensitiveEqual(std::string(t.str), "inner")) {
+      return false;
+    }
+    t = tokenizer.NextNonWhitespace();
+  }
+  if (t.token_type != TK_JOIN) {
+    return false;
+  }
+  std::optional<JoinTable> table =
+      ParseTableRef(tokenizer, tokenizer.NextNonWhitespace(), next);
+  if (!table) {
+    return false;
+  }
+  std::optional<DataframeTable> resolved = resolve_table(table->name);
+  if (!resolved) {
+    return false;
+  }
+  table->table = std::move(*resolved);
+  auto count = static_cast<uint32_t>(tables.size());
+  for (const auto& t : tables) {
+    if (base::CaseInsensitiveEqual(t.qualifier, table->qualifier)) {
+      return false;
+    }
+  }
+
+  std::optional<uint32_t> left_table;
+  std::optional<uint32_t> left_col;
+  std::optional<uint32_t> col;
+  if (next.token_type == TK_USING) {
+    Token lp = tokenizer.NextNonWhitespace();
+    Token name = tokenizer.NextNonWhitespace();
+    Token rp = tokenizer.NextNonWhitespace();
+    if (lp.token_type != TK_LP || !IsPlainIdentifier(name) ||
+        rp.token_type != TK_RP) {
+      return false;
+    }
+    std::string column(name.str);
+    left_table = FindTableWithColumn(tables, count, column);
+    if (!left_table) {
+      return false;
+    }
+    left_col = DataframeColumn(tables[*left_table].table, column);
+    col = DataframeColumn(table->table, column);
+    table->using_column = std::move(column);
+    next = tokenizer.NextNonWhitespace();
+  } else if (next.token_type == TK_ON) {
+    Token eq;
+    std::optional<ColumnItem> a =
+        ParseColumnRef(tokenizer, tokenizer.NextNonWhitespace(), eq);
+    if (!a || !a->table || eq.token_type != TK_EQ) {
+      return false;
+    }
+    std::optional<ColumnItem> b =
+        ParseColumnRef(tokenizer, tokenizer.NextNonWhitespace(), next);
+    if (!b || !b->table) {
+      return false;
+    }
+    // The condition can be written in either order: make |b| refer to the
+    // joined table.
+    if (base::CaseInsensitiveEqual(*a->table, table->qualifier)) {
+      std::swap(a, b);
+    }
+    if (!base::CaseInsensitiveEqual(*b->table, table->qualifier)) {
+      return false;
+    }
+    left_table = FindTable(tables, *a->table);
+    if (!left_table) {
+      return false;
+    }
+    left_col = DataframeColumn(tables[*left_table].table, a->column);
+    col = DataframeColumn(table->table, b->column);
+  } else {
+    return false;
+  }
+  if (!left_col || !col ||
+      !IsIntegerColumn(tables[*left_table].table.spec, *left_col) ||
+      !IsIntegerColumn(table->table.spec, *col)) {
+    return false;
+  }
+  table->left_table = *left_table;
+  table->left_col = *left_col;
+  table->col = *col;
+  tables.push_back(std::move(*table));
+  return true;
+}
+
+// A column of a view: the name of the column of the underlying table it
+// selects (std::nullopt for `*` or an expression) and its name in the view.
+struct ViewItem {
+  bool star = false;
+  std::optional<std::string> column;
+  std::optional<std::string> name;
+};
+
+// Skips the tokens of an expression starting at |start| until the first
+// comma or FROM outside of parentheses, which is returned.
+Token SkipExpression(SqliteTokenizer& tokenizer, Token t) {
+  uint32_t depth = 0;
+  for (; !t.str.empty(); t = tokenizer.NextNonWhitespace()) {
+    if (t.token_type == TK_LP) {
+      ++depth;
+    } else if (t.token_type == TK_RP) {
+      if (depth == 0) {
+        break;
+      }
+      --depth;
+    } else if (depth == 0 &&
+               (t.token_type == TK_COMMA || t.token_type == TK_FROM)) {
+      break;
+    }
+  }
+  return t;
+}
+
+// Parses the SQL of a view of the form accepted by ResolveDataframeTable.
+// On success, returns the items of the view and sets |table| to the table it
+// selects from.
+std::optional<std::vector<ViewItem>> ParseProjectionView(
+    const std::string& sql,
+    std::string& table) {
+  SqliteTokenizer tokenizer(SqlSource::FromTraceProcessorImplementation(sql));
+  if (tokenizer.NextNonWhitespace().token_type != TK_CREATE) {
+    return std::nullopt;
+  }
+  Token t = tokenizer.NextNonWhitespace();
+  if (t.token_type == TK_TEMP) {
+    t = tokenizer.NextNonWhitespace();
+  }
+  if (t.token_type != TK_VIEW ||
+      !IsPlainIdentifier(tokenizer.NextNonWhitespace()) ||
+      tokenizer.NextNonWhitespace().token_type != TK_AS ||
+      tokenizer.NextNonWhitespace().token_type != TK_SELECT) {
+    return std::nullopt;
+  }
+
+  std::vector<ViewItem> items;
+  for (t = tokenizer.NextNonWhitespace();;) {
+    ViewItem item;
+    if (t.token_type == TK_STAR) {
+      item.star = true;
+      t = tokenizer.NextNonWhitespace();
+    } else {
+      Token start = t;
+      t = tokenizer.NextNonWhitespace();
+      bool is_column = IsPlainIdentifier(start) &&
+                       (t.token_type == TK_COMMA || t.token_type == TK_FROM ||
+                        t.token_type == TK_AS || t.token_type == TK_ID);
+      if (is_column) {
+        item.column = std::string(start.str);
+      } else {
+        t = SkipExpression(tokenizer, t);
+      }
+      if (!ParseAlias(tokenizer, t, item.name)) {
+        return std::nullopt;
+      }
+      if (!item.name) {
+        item.name = item.column;
+      }
+    }
+    items.emplace_back(std::move(item));
+    if (t.token_type == TK_FROM) {
+      break;
+    }
+    if (t.token_type != TK_COMMA) {
+      return std::nullopt;
+    }
+    t = tokenizer.NextNonWhitespace();
+  }
+
+  Token from = tokenizer.NextNonWhitespace();
+  if (!IsPlainIdentifier(from)) {
+    return std::nullopt;
+  }
+  t = tokenizer.NextNonWhitespace();
+  if (t.token_type == TK_SEMI) {
+    t = tokenizer.NextNonWhitespace();
+  }
+  if (!t.str.empty()) {
+    return std::nullopt;
+  }
+  table = std::string(from.str);
+  return items;
+}
+
+std::optional<DataframeTable> ResolveDataframeTableImpl(
+    const std::string& name,
+    const std::function<const dataframe::Dataframe*(const std::string&)>&
+        get_dataframe,
+    const std::function<std::optional<std::string>(const std::string&)>&
+        get_view_sql,
+    uint32_t depth) {
+  if (const dataframe::Dataframe* df = get_dataframe(name); df) {
+    DataframeTable table{name, df->CreateSpec(), {}};
+    for (uint32_t i = 0; i < table.spec.column_names.size(); ++i) {
+      table.columns.emplace_back(table.spec.column_names[i], i);
+    }
+    return table;
+  }
+  if (depth == kMaxViewDepth) {
+    return std::nullopt;
+  }
+  std::optional<std::string> view_sql = get_view_sql(name);
+  if (!view_sql) {
+    return std::nullopt;
+  }
+  std::string from;
+  std::optional<std::vector<ViewItem>> items =
+      ParseProjectionView(*view_sql, from);
+  if (!items) {
+    return std::nullopt;
+  }
+  std::optional<DataframeTable> inner = ResolveDataframeTableImpl(
+      from, get_dataframe, get_view_sql, depth + 1);
+  if (!inner) {
+    return std::nullopt;
+  }
+  DataframeTable table{inner->name, inner->spec, {}};
+  for (const ViewItem& item : *items) {
+    if (item.star) {
+      // The hidden columns of a table are not part of `*`.
+      for (const auto& col : inner->columns) {
+        if (col.first != "_auto_id") {
+          table.columns.push_back(col);
+        }
+      }
+      continue;
+    }
+    if (!item.column) {
+      continue;
+    }
+    std::optional<uint32_t> col = DataframeColumn(*inner, *item.column);
+    if (!col) {
+      return std::nullopt;
+    }
+    table.columns.emplace_back(*item.name, *col);
+  }
+  return table;
+}
+
+// Parses a literal, optionally preceded by a sign, or a bound parameter
+// starting at |start|. On success, sets |next| to the first token after it.
+bool ParseValue(SqliteTokenizer& tokenizer, Token start, Token& next) {
+  bool is_number =
+      start.token_type == TK_INTEGER || start.token_type == TK_FLOAT;
+  if (start.token_type == TK_MINUS || start.token_type == TK_PLUS) {
+    start = tokenizer.NextNonWhitespace();
+    is_number = start.token_type == TK_INTEGER || start.token_type == TK_FLOAT;
+    if (!is_number) {
+      return false;
+    }
+  }
+  if (!is_number && start.token_type != TK_STRING &&
+      start.token_type != TK_NULL && start.token_type != TK_VARIABLE) {
+    return false;
+  }
+  next = tokenizer.NextNonWhitespace();
+  return true;
+}
+
+// Parses a term of a WHERE clause which SQLite always passes to the virtual
+// table as a constraint: `<column> <op> <value>` with a comparison operator,
+// `<column> IS [NOT] <value>` or `<column> IN (<value>, ...)`. On success,
+// sets |next| to the first token after the term.
+bool ParseConstraint(SqliteTokenizer& tokenizer,
+                     const DataframeTable& table,
+                     const Token& start,
+                     Token& next) {
+  if (!IsPlainIdentifier(start) ||
+      !DataframeColumn(table, std::string(start.str))) {
+    return false;
+  }
+  Token op = tokenizer.NextNonWhitespace();
+  switch (op.token_type) {
+    case TK_EQ:
+    case TK_NE:
+    case TK_LT:
+    case TK_LE:
+    case TK_GT:
+    case TK_GE:
+      return ParseValue(tokenizer, tokenizer.NextNonWhitespace(), next);
+    case TK_IS: {
+      Token t = tokenizer.NextNonWhitespace();
+      if (t.token_type == TK_NOT) {
+        t = tokenizer.NextNonWhitespace();
+      }
+      return ParseValue(tokenizer, t, next);
+    }
+    case TK_IN: {
+      if (tokenizer.NextNonWhitespace().token_type != TK_LP) {
+        return false;
+      }
+      for (Token t = tokenizer.NextNonWhitespace();;
+           t = tokenizer.NextNonWhitespace()) {
+        if (!ParseValue(tokenizer, t, next)) {
+          return false;
+        }
+        if (next.token_type == TK_RP) {
+          break;
+        }
+        if (next.token_type != TK_COMMA) {
+          return false;
+        }
+      }
+      next = tokenizer.NextNonWhitespace();
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+std::optional<DataframeTable> ResolveDataframeTable(
+    const std::string& name,
+    const std::function<const dataframe::Dataframe*(const std::string&)>&
+        get_dataframe,
+    const std::function<std::optional<std::string>(const std::string&)>&
+        get_view_sql) {
+  return ResolveDataframeTableImpl(name, get_dataframe, get_view_sql, 0);
+}
+
+std::optional<std::string> RewriteDataframeGroupBy(
+    const std::string& sql,
+    const DataframeTableResolver& resolve_table) {
+  SqliteTokenizer tokenizer(SqlSource::FromTraceProcessorImplementation(sql));
+  if (tokenizer.NextNonWhitespace().token_type != TK_SELECT) {
+    return std::nullopt;
+  }
+
+  std::vector<SelectItem> items;
+  for (Token t = tokenizer.NextNonWhitespace();;) {
+    Token next;
+    std::optional<SelectItem> item = ParseSelectItem(tokenizer, t, next);
+    if (!item) {
+      return std::nullopt;
+    }
+    items.emplace_back(std::move(*item));
+    if (next.token_type == TK_FROM) {
+      break;
+    }
+    if (next.token_type != TK_COMMA) {
+      return std::nullopt;
+    }
+    t = tokenizer.NextNonWhitespace();
+  }
+
+  Token table_token = tokenizer.NextNonWhitespace();
+  if (!IsPlainIdentifier(table_token) ||
+      tokenizer.NextNonWhitespace().token_type != TK_GROUP ||
+      tokenizer.NextNonWhitespace().token_type != TK_BY) {
+    return std::nullopt;
+  }
+  std::vector<std::string> group_by;
+  for (;;) {
+    Token col = tokenizer.NextNonWhitespace();
+    if (!IsPlainIdentifier(col)) {
+      return std::nullopt;
+    }
+    group_by.emplace_back(col.str);
+    Token next = tokenizer.NextNonWhitespace();
+    if (next.token_type == TK_SEMI) {
+      next = tokenizer.NextNonWhitespace();
+    }
+    if (next.str.empty()) {
+      break;
+    }
+    if (next.token_type != TK_COMMA) {
+      return std::nullopt;
+    }
+  }
+
+  std::optional<DataframeTable> table =
+      resolve_table(std::string(table_token.str));
+  if (!table) {
+    return std::nullopt;
+  }
+  const dataframe::DataframeSpec& spec = table->spec;
+  std::vector<uint32_t> group_by_cols;
+  for (const auto& name : group_by) {
+    std::optional<uint32_t> col = DataframeColumn(*table, name);
+    // Doubles are grouped by their bit pattern which does not match SQLite's
+    // semantics for e.g. 0.0 and -0.0 so leave them to SQLite.
+    if (!col || spec.column_specs[*col].type.Is<dataframe::Double>() ||
+        std::count(group_by_cols.begin(), group_by_cols.end(), *col) > 0) {
+      return std::nullopt;
+    }
+    group_by_cols.push_back(*col);
+  }
+
+  std::string select;
+  std::string args = Quote(table->name, '\'') + ", " +
+                     std::to_string(group_by_cols.size());
+  for (uint32_t col : group_by_cols) {
+    args += ", " + Quote(spec.column_names[col], '\'');
+  }
+  auto output_col_count = static_cast<uint32_t>(group_by_cols.size());
+  for (const auto& item : items) {
+    std::optional<uint32_t> col;
+    if (item.column) {
+      col = DataframeColumn(*table, *item.column);
+      if (!col) {
+        return std::nullopt;
+      }
+    }
+    uint32_t output_col;
+    if (!item.aggregate) {
+      auto it = std::find(group_by_cols.begin(), group_by_cols.end(), *col);
+      if (it == group_by_cols.end()) {
+        return std::nullopt;
+      }
+      output_col = static_cast<uint32_t>(it - group_by_cols.begin());
+    } else {
+      if (col && spec.column_specs[*col].type.Is<dataframe::String>() &&
+          *item.aggregate != "count") {
+        return std::nullopt;
+      }
+      output_col = output_col_count++;
+      args += ", " + Quote(*item.aggregate, '\'') + ", " +
+              (col ? Quote(spec.column_names[*col], '\'') : "NULL");
+    }
+    std::string result_name = item.result_name
+                                  ? *item.result_name
+                                  : ColumnResultName(*table, *item.column);
+    select += (select.empty() ? "" : ", ") + std::string("c") +
+              std::to_string(output_col) + " AS " + result_name;
+  }
+  if (output_col_count > kMaxOutputColumns) {
+    return std::nullopt;
+  }
+
+  std::string order_by;
+  for (uint32_t i = 0; i < group_by_cols.size(); ++i) {
+    order_by += (i == 0 ? "c" : ", c") + std::to_string(i);
+  }
+  return "SELECT " + select + " FROM __intrinsic_table_ptr(" +
+         kDataframeGroupByFunctionName + "(" + args + ")) WHERE " +
+         TablePtrBindClause(output_col_count) + " ORDER BY " + order_by;
+}
+
+std::optional<std::string> RewriteDataframeJoin(
+    const std::string& sql,
+    const DataframeTableResolver& resolve_table) {
+  SqliteTokenizer tokenizer(SqlSource::FromTraceProcessorImplementation(sql));
+  if (tokenizer.NextNonWhitespace().token_type != TK_SELECT) {
+    return std::nullopt;
+  }
+
+  std::vector<ColumnItem> items;
+  for (Token t = tokenizer.NextNonWhitespace();;) {
+    Token next;
+    std::optional<ColumnItem> item = ParseColumnRef(tokenizer, t, next);
+    // Aliases are passed through as written.
+    if (!item || !ParseAlias(tokenizer, next, item->result_name)) {
+      return std::nullopt;
+    }
+    items.emplace_back(std::move(*item));
+    if (next.token_type == TK_FROM) {
+      break;
+    }
+    if (next.token_type != TK_COMMA) {
+      return std::nullopt;
+    }
+    t = tokenizer.NextNonWhitespace();
+  }
+
+  std::vector<JoinTable> tables;
+  Token next;
+  std::optional<JoinTable> first =
+      ParseTableRef(tokenizer, tokenizer.NextNonWhitespace(), next);
+  if (!first) {
+    return std::nullopt;
+  }
+  std::optional<DataframeTable> first_table = resolve_table(first->name);
+  if (!first_table) {
+    return std::nullopt;
+  }
+  first->table = std::move(*first_table);
+  tables.emplace_back(std::move(*first));
+  while (!next.str.empty() && next.token_type != TK_SEMI) {
+    if (!ParseJoin(tokenizer, next, resolve_table, tables, next)) {
+      return std::nullopt;
+    }
+  }
+  if (next.token_type == TK_SEMI &&
+      !tokenizer.NextNonWhitespace().str.empty()) {
+    return std::nullopt;
+  }
+  if (tables.size() < 2 || items.size() > kMaxOutputColumns) {
+    return std::nullopt;
+  }
+
+  auto table_count = static_cast<uint32_t>(tables.size());
+  std::string args = std::to_string(table_count) + ", " +
+                     Quote(tables[0].table.name, '\'');
+  for (uint32_t i = 1; i < table_count; ++i) {
+    const JoinTable& t = tables[i];
+    const dataframe::DataframeSpec& left_spec = tables[t.left_table].table.spec;
+    args += ", " + Quote(t.table.name, '\'') + ", " +
+            std::to_string(t.left_table) + ", " +
+            Quote(left_spec.column_names[t.left_col], '\'') + ", " +
+            Quote(t.table.spec.column_names[t.col], '\'');
+  }
+  std::string select;
+  for (uint32_t i = 0; i < items.size(); ++i) {
+    const ColumnItem& item = items[i];
+    std::optional<uint32_t> table =
+        item.table ? FindTable(tables, *item.table)
+                   : FindTableWithColumn(tables, table_count, item.column);
+    if (!table) {
+      return std::nullopt;
+    }
+    const DataframeTable& t = tables[*table].table;
+    std::optional<uint32_t> col = DataframeColumn(t, item.column);
+    if (!col) {
+      return std::nullopt;
+    }
+    args += ", " + std::to_string(*table) + ", " +
+            Quote(t.spec.column_names[*col], '\'');
+    select += (i == 0 ? "c" : ", c") + std::to_string(i) + " AS " +
+              (item.result_name ? *item.result_name
+                                : ColumnResultName(t, item.column));
+  }
+  return "SELECT " + select + " FROM __intrinsic_table_ptr(" +
+         kDataframeJoinFunctionName + "(" + args + ")) WHERE " +
+         TablePtrBindClause(static_cast<uint32_t>(items.size()));
+}
+
+std::optional<DataframeScanStatement> ParseDataframeScan(
+    const std::string& sql,
+    const DataframeTableResolver& resolve_table) {
+  SqliteTokenizer tokenizer(SqlSource::FromTraceProcessorImplementation(sql));
+  if (tokenizer.NextNonWhitespace().token_type != TK_SELECT) {
+    return std::nullopt;
+  }
+
+  // The items are resolved once the table is known: a null name stands for
+  // `*`.
+  std::vector<std::optional<std::string>> items;
+  for (Token t = tokenizer.NextNonWhitespace();;) {
+    Token next;
+    if (t.token_type == TK_STAR) {
+      items.emplace_back(std::nullopt);
+      next = tokenizer.NextNonWhitespace();
+    } else {
+      std::optional<std::string> alias;
+      if (!IsPlainIdentifier(t)) {
+        return std::nullopt;
+      }
+      items.emplace_back(std::string(t.str));
+      next = tokenizer.NextNonWhitespace();
+      if (!ParseAlias(tokenizer, next, alias)) {
+        return std::nullopt;
+      }
+    }
+    if (next.token_type == TK_FROM) {
+      break;
+    }
+    if (next.token_type != TK_COMMA) {
+      return std::nullopt;
+    }
+    t = tokenizer.NextNonWhitespace();
+  }
+
+  Token table_token = tokenizer.NextNonWhitespace();
+  if (!IsPlainIdentifier(table_token)) {
+    return std::nullopt;
+  }
+  std::optional<DataframeTable> table =
+      resolve_table(std::string(table_token.str));
+  if (!table) {
+    return std::nullopt;
+  }
+  DataframeScanStatement scan;
+  scan.table = table->name;
+  for (const auto& item : items) {
+    if (!item) {
+      // The hidden columns of a table are not part of `*`.
+      for (const auto& col : table->columns) {
+        if (col.first != "_auto_id") {
+          scan.columns.push_back(col.second);
+        }
+      }
+      continue;
+    }
+    std::optional<uint32_t> col = DataframeColumn(*table, *item);
+    if (!col) {
+      return std::nullopt;
+    }
+    scan.columns.push_back(*col);
+  }
+
+  Token next = tokenizer.NextNonWhitespace();
+  if (next.token_type == TK_WHERE) {
+    do {
+      if (!ParseConstraint(tokenizer, *table, tokenizer.NextNonWhitespace(),
+                           next)) {
+        return std::nullopt;
+      }
+      ++scan.constraint_count;
+    } while (next.token_type == TK_AND);
+  }
+  if (next.token_type == TK_ORDER) {
+    if (tokenizer.NextNonWhitespace().token_type != TK_BY) {
+      return std::nullopt;
+    }
+    do {
+      // The terms can also name an alias of the SELECT list so they are not
+      // resolved here: SQLite only passes them to the table if they are all
+      // columns of it.
+      if (!IsPlainIdentifier(tokenizer.NextNonWhitespace())) {
+        return std::nullopt;
+      }
+      next = tokenizer.NextNonWhitespace();
+      if (next.token_type == TK_ASC || next.token_type == TK_DESC) {
+        next = tokenizer.NextNonWhitespace();
+      }
+      ++scan.order_by_count;
+    } while (next.token_type == TK_COMMA);
+  }
+  if (next.token_type == TK_SEMI) {
+    next = tokenizer.NextNonWhitespace();
+  }
+  if (!next.str.empty()) {
+    return std::nullopt;
+  }
+  return scan;
+}
+
+}  // namespace perfetto::trace_processor
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_DATAFRAME_QUERY_REWRITER_H_
+#define SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_DATAFRAME_QUERY_REWRITER_H_
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/core/dataframe/specs.h"
+
+namespace perfetto::trace_processor {
+
+// A table or view whose rows are exactly the rows of a dataframe: either the
+// table backed by the dataframe or a view which only selects (and possibly
+// renames) columns of such a table, e.g. the `slice` view over
+// `__intrinsic_slice`.
+struct DataframeTable {
+  // The name of the table backed by the dataframe.
+  std::string name;
+
+  // The spec of the dataframe.
+  dataframe::DataframeSpec spec;
+
+  // The columns visible through the table or view: pairs of (name, index of
+  // the dataframe column).
+  std::vector<std::pair<std::string, uint32_t>> columns;
+};
+
+// Returns the DataframeTable for the table or view with the given name or
+// std::nullopt if it does not read a dataframe.
+using DataframeTableResolver =
+    std::function<std::optional<DataframeTable>(const std::string&)>;
+
+// Returns the DataframeTable for the table or view |name|.
+//
+// |get_dataframe| should return the dataframe backing the table with the given
+// name or nullptr if there is no such table. |get_view_sql| should return the
+// SQL of the view with the given name, as stored by SQLite (i.e. the `CREATE
+// VIEW` statement), or std::nullopt if there is no such view.
+//
+// Views are only looked through if they are of the form
+//   SELECT <item>, ... FROM <table>
+// where <table> is itself resolvable and each <item> is `*`, a column of
+// <table> or an expression, optionally followed by an alias. Columns computed
+// by an expression are not visible through the returned DataframeTable.
+std::optional<DataframeTable> ResolveDataframeTable(
+    const std::string& name,
+    const std::function<const dataframe::Dataframe*(const std::string&)>&
+        get_dataframe,
+    const std::function<std::optional<std::string>(const std::string&)>&
+        get_view_sql);
+
+// Name of the function computing GROUP BY aggregations inside a dataframe.
+//
+// Arguments: the name of the table, the number N of grouped columns, the names
+// of the N grouped columns and then a pair (aggregation, column name) for each
+// aggregation where aggregation is one of 'count', 'sum', 'min' and 'max'. The
+// column name is NULL for COUNT(*).
+//
+// Returns a table pointer with one row per group with columns c0, c1, ...: the
+// first N columns contain the values of the grouped columns and the remaining
+// ones the results of the aggregations, in the order they were specified.
+inline constexpr char kDataframeGroupByFunctionName[] =
+    "__intrinsic_dataframe_group_by";
+
+// SQLite does not allow virtual tables to compute aggregations: for a GROUP BY
+// query, every row of the table is returned to SQLite which then hashes or
+// sorts them itself. For the common case of a simple aggregation over a single
+// table, this function rewrites the query to compute the aggregation inside
+// the dataframe instead.
+//
+// Only queries of exactly the following form are rewritten:
+//   SELECT <item>, ... FROM <table> GROUP BY <column>, ...
+// where <table> reads a dataframe (see DataframeTable) and each <item> is
+// either one of the grouped columns or one of COUNT(*), COUNT(<column>),
+// SUM(<column>), MIN(<column>) or MAX(<column>), optionally followed by an
+// alias. Columns are matched case insensitively, like SQLite does. The output
+// is ordered by the grouped columns to match the order SQLite would return
+// the groups in.
+//
+// Returns the rewritten SQL or std::nullopt if |sql| is not of the above form.
+std::optional<std::string> RewriteDataframeGroupBy(
+    const std::string& sql,
+    const DataframeTableResolver& resolve_table);
+
+// Name of the function computing inner equi-joins between dataframes.
+//
+// Arguments: the number N of joined tables, the name of the first table and
+// then, for each of the N - 1 other tables: its name, the index of the table it
+// is joined with (which must come before it), the name of the join column in
+// that table and the name of the join column in this table. The remaining
+// arguments are a pair (table index, column name) for each output column.
+//
+// Returns a table pointer with columns c0, c1, ... containing the output
+// columns, in the order they were specified.
+inline constexpr char kDataframeJoinFunctionName[] =
+    "__intrinsic_dataframe_join";
+
+// SQLite executes joins between virtual tables as nested loops: the inner
+// table is filtered once for every row of the outer one, going through the
+// virtual table interface each time. This function rewrites simple equi-joins
+// between dataframes to be computed with a hash join instead (see
+// dataframe::HashJoin).
+//
+// Only queries of exactly the following form are rewritten:
+//   SELECT <item>, ... FROM <table> [[AS] <alias>]
+//     [INNER] JOIN <table> [[AS] <alias>] USING (<column>)
+//     [INNER] JOIN <table> [[AS] <alias>] ON <a>.<column> = <b>.<column>
+//     ...
+// where all the tables read dataframes (see DataframeTable), the join columns
+// are integer columns and each <item> is a column, optionally qualified with
+// its table and optionally followed by an alias.
+//
+// Returns the rewritten SQL or std::nullopt if |sql| is not of the above form.
+std::optional<std::string> RewriteDataframeJoin(
+    const std::string& sql,
+    const DataframeTableResolver& resolve_table);
+
+// A statement which does nothing other than returning columns of the rows of
+// a dataframe, filtered and sorted by the dataframe itself.
+struct DataframeScanStatement {
+  // The name of the table backed by the dataframe.
+  std::string table;
+
+  // For each result column, the index of the dataframe column it reads.
+  std::vector<uint32_t> columns;
+
+  // The number of terms of the WHERE and ORDER BY clauses.
+  uint32_t constraint_count = 0;
+  uint32_t order_by_count = 0;
+};
+
+// Parses |sql| if it is of exactly the following form:
+//   SELECT <item>, ... FROM <table>
+//     [WHERE <term> AND ...] [ORDER BY <column> [ASC|DESC], ...]
+// where <table> reads a dataframe (see DataframeTable), each <item> is `*` or
+// a column, optionally followed by an alias, and each <term> is one of
+// `<column> <op> <value>` (with op one of =, ==, !=, <>, <, <=, > and >=),
+// `<column> IS [NOT] <value>` or `<column> IN (<value>, ...)` where <value> is
+// a literal or a bound parameter.
+//
+// SQLite passes every such term to the virtual table as a constraint. If the
+// table applied that many constraints and ORDER BY terms itself (see
+// DataframeModule::DelegatedScan), SQLite does nothing other than returning
+// the rows of its cursor.
+//
+// Returns std::nullopt if |sql| is not of the above form.
+std::optional<DataframeScanStatement> ParseDataframeScan(
+    const std::string& sql,
+    const DataframeTableResolver& resolve_table);
+
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_DATAFRAME_QUERY_REWRITER_H_
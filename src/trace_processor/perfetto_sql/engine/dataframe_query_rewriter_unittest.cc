@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/perfetto_sql/engine/dataframe_query_rewriter.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/ext/base/string_utils.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/adhoc_dataframe_builder.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+using ::testing::ElementsAre;
+
+class DataframeQueryRewriterTest : public ::testing::Test {
+ protected:
+  DataframeQueryRewriterTest() {
+    using CT = dataframe::AdhocDataframeBuilder::ColumnType;
+    dataframe::AdhocDataframeBuilder foo(
+        {"id", "name", "dur"}, &pool_,
+        dataframe::AdhocDataframeBuilder::Options{
+            {CT::kInt64, CT::kString, CT::kDouble}});
+    foo.PushNonNullUnchecked(0, int64_t(0));
+    foo.PushNonNullUnchecked(1, pool_.InternString("a"));
+    foo.PushNonNullUnchecked(2, 1.0);
+    auto foo_df = std::move(foo).Build();
+    PERFETTO_CHECK(foo_df.ok());
+    foo_.emplace(std::move(*foo_df));
+
+    dataframe::AdhocDataframeBuilder bar(
+        {"id", "foo_id", "name"}, &pool_,
+        dataframe::AdhocDataframeBuilder::Options{
+            {CT::kInt64, CT::kInt64, CT::kString}});
+    bar.PushNonNullUnchecked(0, int64_t(0));
+    bar.PushNonNullUnchecked(1, int64_t(0));
+    bar.PushNonNullUnchecked(2, pool_.InternString("b"));
+    auto bar_df = std::move(bar).Build();
+    PERFETTO_CHECK(bar_df.ok());
+    bar_.emplace(std::move(*bar_df));
+  }
+
+  const dataframe::Dataframe* GetDataframe(const std::string& name) {
+    if (name == "foo") {
+      return &*foo_;
+    }
+    return name == "bar" ? &*bar_ : nullptr;
+  }
+
+  static std::optional<std::string> GetViewSql(const std::string& name) {
+    if (base::CaseInsensitiveEqual(name, "foo_view")) {
+      return "CREATE VIEW foo_view AS "
+             "SELECT *, name AS foo_name, dur * 2 AS dur2 FROM foo";
+    }
+    if (base::CaseInsensitiveEqual(name, "bar_view")) {
+      return "CREATE VIEW bar_view AS SELECT id AS bar_id, foo_id FROM bar;";
+    }
+    if (base::CaseInsensitiveEqual(name, "filtered")) {
+      return "CREATE VIEW filtered AS SELECT * FROM foo WHERE id = 1";
+    }
+    return std::nullopt;
+  }
+
+  std::optional<DataframeTable> ResolveTable(const std::string& name) {
+    return ResolveDataframeTable(
+        name, [this](const std::string& n) { return GetDataframe(n); },
+        &GetViewSql);
+  }
+
+  std::optional<std::string> Rewrite(const std::string& sql) {
+    return RewriteDataframeGroupBy(sql, [this](const std::string& name) {
+      return ResolveTable(name);
+    });
+  }
+
+  std::optional<std::string> RewriteJoin(const std::string& sql) {
+    return RewriteDataframeJoin(sql, [this](const std::string& name) {
+      return ResolveTable(name);
+    });
+  }
+
+  std::optional<DataframeScanStatement> ParseScan(const std::string& sql) {
+    return ParseDataframeScan(sql, [this](const std::string& name) {
+      return ResolveTable(name);
+    });
+  }
+
+  StringPool pool_;
+  std::optional<dataframe::Dataframe> foo_;
+  std::optional<dataframe::Dataframe> bar_;
+};
+
+TEST_F(DataframeQueryRewriterTest, GroupBy) {
+  auto res = Rewrite(
+      "SELECT name, COUNT(*) AS cnt, sum(dur), max(id) m FROM foo "
+      "GROUP BY name");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(*res,
+            "SELECT c0 AS \"name\", c1 AS cnt, c2 AS \"sum(dur)\", c3 AS m "
+            "FROM __intrinsic_table_ptr(__intrinsic_dataframe_group_by('foo', "
+            "1, 'name', 'count', NULL, 'sum', 'dur', 'max', 'id')) "
+            "WHERE __intrinsic_table_ptr_bind(c0, 'c0') AND "
+            "__intrinsic_table_ptr_bind(c1, 'c1') AND "
+            "__intrinsic_table_ptr_bind(c2, 'c2') AND "
+            "__intrinsic_table_ptr_bind(c3, 'c3') ORDER BY c0");
+}
+
+TEST_F(DataframeQueryRewriterTest, GroupByCaseInsensitive) {
+  // SQLite names the result after the column, not as the query wrote it.
+  auto res = Rewrite("SELECT NAME, count(*) FROM foo GROUP BY name");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(*res,
+            "SELECT c0 AS \"name\", c1 AS \"count(*)\" "
+            "FROM __intrinsic_table_ptr(__intrinsic_dataframe_group_by('foo', "
+            "1, 'name', 'count', NULL)) "
+            "WHERE __intrinsic_table_ptr_bind(c0, 'c0') AND "
+            "__intrinsic_table_ptr_bind(c1, 'c1') ORDER BY c0");
+
+  // Grouping twice on the same column.
+  ASSERT_FALSE(Rewrite("SELECT name FROM foo GROUP BY name, NAME"));
+}
+
+TEST_F(DataframeQueryRewriterTest, GroupByView) {
+  auto res =
+      Rewrite("SELECT foo_name, max(ID) FROM foo_view GROUP BY foo_name");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(*res,
+            "SELECT c0 AS \"foo_name\", c1 AS \"max(ID)\" "
+            "FROM __intrinsic_table_ptr(__intrinsic_dataframe_group_by('foo', "
+            "1, 'name', 'max', 'id')) "
+            "WHERE __intrinsic_table_ptr_bind(c0, 'c0') AND "
+            "__intrinsic_table_ptr_bind(c1, 'c1') ORDER BY c0");
+
+  // Column computed by the view.
+  ASSERT_FALSE(Rewrite("SELECT dur2 FROM foo_view GROUP BY dur2"));
+  // Column hidden by the view.
+  ASSERT_FALSE(Rewrite("SELECT id FROM bar_view GROUP BY id"));
+  // View which does more than selecting columns.
+  ASSERT_FALSE(Rewrite("SELECT name FROM filtered GROUP BY name"));
+}
+
+TEST_F(DataframeQueryRewriterTest, ResolveView) {
+  auto table = ResolveTable("BAR_VIEW");
+  ASSERT_TRUE(table.has_value());
+  ASSERT_EQ(table->name, "bar");
+  ASSERT_EQ(table->columns,
+            (std::vector<std::pair<std::string, uint32_t>>{{"bar_id", 0},
+                                                           {"foo_id", 1}}));
+  ASSERT_FALSE(ResolveTable("filtered"));
+  ASSERT_FALSE(ResolveTable("baz"));
+}
+
+TEST_F(DataframeQueryRewriterTest, GroupByNotRewritten) {
+  // Not a dataframe.
+  ASSERT_FALSE(Rewrite("SELECT name FROM baz GROUP BY name"));
+  // Grouping on a double column.
+  ASSERT_FALSE(Rewrite("SELECT dur FROM foo GROUP BY dur"));
+  // Selecting a column which is not grouped.
+  ASSERT_FALSE(Rewrite("SELECT id FROM foo GROUP BY name"));
+  // Unsupported aggregation.
+  ASSERT_FALSE(Rewrite("SELECT name, avg(dur) FROM foo GROUP BY name"));
+  // Non-count aggregation on a string column.
+  ASSERT_FALSE(Rewrite("SELECT id, max(name) FROM foo GROUP BY id"));
+  // Extra clauses.
+  ASSERT_FALSE(Rewrite("SELECT name FROM foo WHERE id = 1 GROUP BY name"));
+  ASSERT_FALSE(Rewrite("SELECT name FROM foo GROUP BY name LIMIT 1"));
+  // No GROUP BY.
+  ASSERT_FALSE(Rewrite("SELECT name FROM foo"));
+}
+
+TEST_F(DataframeQueryRewriterTest, Join) {
+  auto res = RewriteJoin(
+      "SELECT f.name, bar.name AS bar_name, dur FROM foo f "
+      "JOIN bar ON bar.foo_id = f.id");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(*res,
+            "SELECT c0 AS \"name\", c1 AS bar_name, c2 AS \"dur\" "
+            "FROM __intrinsic_table_ptr(__intrinsic_dataframe_join(2, 'foo', "
+            "'bar', 0, 'id', 'foo_id', 0, 'name', 1, 'name', 0, 'dur')) "
+            "WHERE __intrinsic_table_ptr_bind(c0, 'c0') AND "
+            "__intrinsic_table_ptr_bind(c1, 'c1') AND "
+            "__intrinsic_table_ptr_bind(c2, 'c2')");
+
+  // The column of a USING clause is not ambiguous.
+  res = RewriteJoin("SELECT id FROM foo INNER JOIN bar USING (id);");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(*res,
+            "SELECT c0 AS \"id\" FROM __intrinsic_table_ptr("
+            "__intrinsic_dataframe_join(2, 'foo', 'bar', 0, 'id', 'id', 0, "
+            "'id')) WHERE __intrinsic_table_ptr_bind(c0, 'c0')");
+
+  // The column of a USING clause is matched case insensitively.
+  res = RewriteJoin("SELECT id FROM foo JOIN bar USING (ID)");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(*res,
+            "SELECT c0 AS \"id\" FROM __intrinsic_table_ptr("
+            "__intrinsic_dataframe_join(2, 'foo', 'bar', 0, 'id', 'id', 0, "
+            "'id')) WHERE __intrinsic_table_ptr_bind(c0, 'c0')");
+}
+
+TEST_F(DataframeQueryRewriterTest, JoinView) {
+  auto res = RewriteJoin(
+      "SELECT bar_id, foo_name FROM bar_view "
+      "JOIN foo_view ON foo_view.ID = bar_view.foo_id");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(*res,
+            "SELECT c0 AS \"bar_id\", c1 AS \"foo_name\" "
+            "FROM __intrinsic_table_ptr(__intrinsic_dataframe_join(2, 'bar', "
+            "'foo', 0, 'foo_id', 'id', 0, 'id', 1, 'name')) "
+            "WHERE __intrinsic_table_ptr_bind(c0, 'c0') AND "
+            "__intrinsic_table_ptr_bind(c1, 'c1')");
+
+  // Column hidden by the view.
+  ASSERT_FALSE(RewriteJoin("SELECT name FROM bar_view JOIN foo USING (id)"));
+}
+
+TEST_F(DataframeQueryRewriterTest, JoinNotRewritten) {
+  // Not a dataframe.
+  ASSERT_FALSE(RewriteJoin("SELECT id FROM foo JOIN baz USING (id)"));
+  // Ambiguous column.
+  ASSERT_FALSE(
+      RewriteJoin("SELECT name FROM foo JOIN bar ON foo.id = bar.foo_id"));
+  // Joining on a string column.
+  ASSERT_FALSE(RewriteJoin("SELECT id FROM foo JOIN bar USING (name)"));
+  // Outer join.
+  ASSERT_FALSE(RewriteJoin("SELECT id FROM foo LEFT JOIN bar USING (id)"));
+  // Condition not involving the joined table.
+  ASSERT_FALSE(
+      RewriteJoin("SELECT foo.id FROM foo f JOIN bar ON f.id = f.id"));
+  // Extra clauses.
+  ASSERT_FALSE(
+      RewriteJoin("SELECT foo_id FROM foo JOIN bar USING (id) WHERE id = 1"));
+  // No join.
+  ASSERT_FALSE(RewriteJoin("SELECT id FROM foo"));
+}
+
+TEST_F(DataframeQueryRewriterTest, Scan) {
+  auto res = ParseScan("SELECT * FROM foo");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->table, "foo");
+  ASSERT_THAT(res->columns, ElementsAre(0, 1, 2));
+  ASSERT_EQ(res->constraint_count, 0u);
+  ASSERT_EQ(res->order_by_count, 0u);
+
+  res = ParseScan(
+      "select dur, ID as i, * from foo where id > 1 and name = 'a' and "
+      "dur is not null and id in (1, -2, ?) and dur != 1.5 "
+      "order by dur desc, i;");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_THAT(res->columns, ElementsAre(2, 0, 0, 1, 2));
+  ASSERT_EQ(res->constraint_count, 5u);
+  ASSERT_EQ(res->order_by_count, 2u);
+}
+
+TEST_F(DataframeQueryRewriterTest, ScanView) {
+  auto res =
+      ParseScan("SELECT foo_name, id FROM foo_view WHERE foo_name = 'a'");
+  ASSERT_TRUE(res.has_value());
+  ASSERT_EQ(res->table, "foo");
+  ASSERT_THAT(res->columns, ElementsAre(1, 0));
+  ASSERT_EQ(res->constraint_count, 1u);
+
+  // Columns computed by the view are not visible.
+  ASSERT_FALSE(ParseScan("SELECT dur2 FROM foo_view"));
+  ASSERT_FALSE(ParseScan("SELECT id FROM foo_view WHERE dur2 = 1"));
+  // Views filtering the table are not looked through.
+  ASSERT_FALSE(ParseScan("SELECT id FROM filtered"));
+}
+
+TEST_F(DataframeQueryRewriterTest, ScanNotParsed) {
+  // Not a dataframe.
+  ASSERT_FALSE(ParseScan("SELECT id FROM baz"));
+  // Expressions.
+  ASSERT_FALSE(ParseScan("SELECT id + 1 FROM foo"));
+  ASSERT_FALSE(ParseScan("SELECT id FROM foo WHERE id + 1 = 2"));
+  ASSERT_FALSE(ParseScan("SELECT id FROM foo WHERE id = dur"));
+  ASSERT_FALSE(ParseScan("SELECT id FROM foo ORDER BY id + 1"));
+  // Terms which SQLite does not pass to the table.
+  ASSERT_FALSE(ParseScan("SELECT id FROM foo WHERE id = 1 OR id = 2"));
+  ASSERT_FALSE(ParseScan("SELECT id FROM foo WHERE name LIKE 'a%'"));
+  ASSERT_FALSE(ParseScan("SELECT id FROM foo WHERE id IN ()"));
+  ASSERT_FALSE(ParseScan("SELECT id FROM foo WHERE id IN (SELECT 1)"));
+  ASSERT_FALSE(ParseScan("SELECT id FROM foo ORDER BY name COLLATE nocase"));
+  // Other clauses.
+  ASSERT_FALSE(ParseScan("SELECT DISTINCT id FROM foo"));
+  ASSERT_FALSE(ParseScan("SELECT id FROM foo LIMIT 10"));
+  ASSERT_FALSE(ParseScan("SELECT id FROM foo GROUP BY id"));
+  ASSERT_FALSE(ParseScan("SELECT id FROM foo f"));
+  ASSERT_FALSE(ParseScan("SELECT id FROM foo, bar"));
+  ASSERT_FALSE(ParseScan("SELECT id FROM foo; SELECT 1"));
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor
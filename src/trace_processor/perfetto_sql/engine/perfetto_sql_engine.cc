@@ -45,6 +45,7 @@
 #include "src/trace_processor/core/dataframe/runtime_dataframe_builder.h"
 #include "src/trace_processor/core/dataframe/specs.h"
 #include "src/trace_processor/perfetto_sql/engine/created_function.h"
+#include "src/trace_processor/perfetto_sql/engine/dataframe_query_rewriter.h"
 #include "src/trace_processor/perfetto_sql/engine/dataframe_module.h"
 #include "src/trace_processor/perfetto_sql/engine/runtime_table_function.h"
 #include "src/trace_processor/perfetto_sql/engine/static_table_function_module.h"
@@ -583,7 +584,9 @@ base::StatusOr<PerfettoSqlEngine::FrameResult> PerfettoSqlEngine::ProcessFrame(
             {FrameType::kInclude,
              SqlSource::FromModuleInclude(file_ptr->sql, key),
              /*parser=*/nullptr, /*accumulated_stats=*/{},
-             /*current_stmt=*/std::nullopt, key, file_ptr, std::move(traceback),
+             /*current_stmt=*/std::nullopt,
+             /*current_stmt_dataframe_cursor=*/{}, key, file_ptr,
+             std::move(traceback),
              /*wildcard_modules=*/{},
              /*wildcard_index=*/0,
              /*wildcard_traceback_sql=*/
@@ -645,6 +648,21 @@ base::StatusOr<PerfettoSqlEngine::FrameResult> PerfettoSqlEngine::ProcessFrame(
       const auto* sql = std::get_if<PerfettoSqlParser::SqliteSql>(&stmt);
       PERFETTO_CHECK(sql);
       source = stmt_sql;
+      auto resolve_table = [this](const std::string& name) {
+        return ResolveTable(name);
+      };
+      std::optional<std::string> rewritten;
+      if (dataframe_group_by_rewrite_enabled_) {
+        rewritten = RewriteDataframeGroupBy(stmt_sql.sql(), resolve_table);
+      }
+      if (!rewritten && dataframe_join_rewrite_enabled_) {
+        rewritten = RewriteDataframeJoin(stmt_sql.sql(), resolve_table);
+      }
+      if (rewritten) {
+        source = stmt_sql.RewriteAllIgnoreExisting(
+            SqlSource::FromTraceProcessorImplementation(
+                std::move(*rewritten)));
+      }
     }
 
     // Prepare the statement
@@ -691,8 +709,11 @@ base::StatusOr<PerfettoSqlEngine::FrameResult> PerfettoSqlEngine::ProcessFrame(
             record->AddArg("Executed SQL",
                            execution_stack_[frame_idx].current_stmt->sql());
           });
+      dataframe_context_->last_filtered_cursor = {};
       execution_stack_[frame_idx].current_stmt->Step();
       RETURN_IF_ERROR(execution_stack_[frame_idx].current_stmt->status());
+      execution_stack_[frame_idx].current_stmt_dataframe_cursor =
+          dataframe_context_->last_filtered_cursor;
     }
 
     // Update stats
@@ -754,7 +775,8 @@ PerfettoSqlEngine::ExecuteUntilLastStatementImpl(SqlSource sql_source) {
   execution_stack_.push_back(
       {FrameType::kRoot, std::move(sql_source), /*parser=*/nullptr,
        /*accumulated_stats=*/{}, /*current_stmt=*/std::nullopt,
-       /*include_key=*/{}, /*file_ptr=*/nullptr,
+       /*current_stmt_dataframe_cursor=*/{}, /*include_key=*/{},
+       /*file_ptr=*/nullptr,
        /*traceback_sql=*/SqlSource::FromTraceProcessorImplementation(""),
        /*wildcard_modules=*/{}, /*wildcard_index=*/0,
        /*wildcard_traceback_sql=*/
@@ -775,7 +797,8 @@ PerfettoSqlEngine::ExecuteUntilLastStatementImpl(SqlSource sql_source) {
       case FrameResult::kReturnResult: {
         auto& frame = execution_stack_.back();
         ExecutionResult res{std::move(*frame.current_stmt),
-                            frame.accumulated_stats};
+                            frame.accumulated_stats,
+                            frame.current_stmt_dataframe_cursor};
         execution_stack_.pop_back();
         return std::move(res);
       }
@@ -792,6 +815,67 @@ const dataframe::Dataframe* PerfettoSqlEngine::GetDataframeOrNull(
   return state ? state->dataframe : nullptr;
 }
 
+std::optional<std::vector<uint32_t>>
+PerfettoSqlEngine::GetDataframeScanColumns(const ExecutionResult& result) {
+  const DataframeModule::FilteredCursor& cursor = result.dataframe_cursor;
+  if (!cursor.cursor || !cursor.scan.applies_all_constraints) {
+    return std::nullopt;
+  }
+  sqlite3_stmt* stmt = result.stmt.sqlite_stmt();
+  const char* sql = sqlite3_sql(stmt);
+  if (!sql) {
+    return std::nullopt;
+  }
+  std::optional<DataframeScanStatement> scan =
+      ParseDataframeScan(sql, [this](const std::string& name) {
+        return ResolveTable(name);
+      });
+  // The statement must read the very dataframe of the cursor: otherwise the
+  // cursor belongs to a statement nested in it (e.g. in a table function)
+  // and might even have been closed already.
+  if (!scan || GetDataframeOrNull(scan->table) != cursor.dataframe ||
+      scan->constraint_count != cursor.scan.constraint_count ||
+      scan->order_by_count != cursor.scan.order_by_count ||
+      scan->columns.size() !=
+          static_cast<size_t>(sqlite3_column_count(stmt))) {
+    return std::nullopt;
+  }
+  return std::move(scan->columns);
+}
+
+std::optional<DataframeTable> PerfettoSqlEngine::ResolveTable(
+    const std::string& name) {
+  return ResolveDataframeTable(
+      name, [this](const std::string& n) { return GetDataframeOrNull(n); },
+      [this](const std::string& n) { return GetViewSqlOrNull(n); });
+}
+
+std::optional<std::string> PerfettoSqlEngine::GetViewSqlOrNull(
+    const std::string& name) {
+  // Temporary views shadow the ones in the main schema.
+  for (const char* schema : {"sqlite_temp_master", "sqlite_master"}) {
+    std::string sql = std::string("SELECT sql FROM ") + schema +
+                      " WHERE type = 'view' AND name = ? COLLATE NOCASE";
+    auto stmt = engine_->PrepareStatement(
+        SqlSource::FromTraceProcessorImplementation(std::move(sql)));
+    if (!stmt.status().ok()) {
+      return std::nullopt;
+    }
+    sqlite3_stmt* raw = stmt.sqlite_stmt();
+    if (sqlite3_bind_text(raw, 1, name.c_str(), -1, SQLITE_TRANSIENT) !=
+        SQLITE_OK) {
+      return std::nullopt;
+    }
+    if (stmt.Step()) {
+      const auto* view_sql =
+          reinterpret_cast<const char*>(sqlite3_column_text(raw, 0));
+      return view_sql ? std::make_optional<std::string>(view_sql)
+                      : std::nullopt;
+    }
+  }
+  return std::nullopt;
+}
+
 base::Status PerfettoSqlEngine::RegisterLegacyRuntimeFunction(
     bool replace,
     const FunctionPrototype& prototype,
@@ -1100,6 +1184,7 @@ base::Status PerfettoSqlEngine::IncludePackageImpl(
          /*sql_source=*/SqlSource::FromTraceProcessorImplementation(""),
          /*parser=*/nullptr, /*accumulated_stats=*/{},
          /*current_stmt=*/std::nullopt,
+         /*current_stmt_dataframe_cursor=*/{},
          /*include_key=*/{}, /*file_ptr=*/nullptr,
          /*traceback_sql=*/SqlSource::FromTraceProcessorImplementation(""),
          std::move(matching_modules), /*wildcard_index=*/0,
@@ -1126,7 +1211,9 @@ base::Status PerfettoSqlEngine::IncludeModuleImpl(
   execution_stack_.push_back({FrameType::kInclude,
                               SqlSource::FromModuleInclude(file.sql, key),
                               /*parser=*/nullptr, /*accumulated_stats=*/{},
-                              /*current_stmt=*/std::nullopt, key, &file,
+                              /*current_stmt=*/std::nullopt,
+                              /*current_stmt_dataframe_cursor=*/{}, key,
+                              &file,
                               /*traceback_sql=*/parser.statement_sql(),
                               /*wildcard_modules=*/{}, /*wildcard_index=*/0,
                               /*wildcard_traceback_sql=*/
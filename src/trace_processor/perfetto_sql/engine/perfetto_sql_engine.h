@@ -33,6 +33,7 @@
 #include "src/trace_processor/containers/string_pool.h"
 #include "src/trace_processor/core/dataframe/dataframe.h"
 #include "src/trace_processor/perfetto_sql/engine/dataframe_module.h"
+#include "src/trace_processor/perfetto_sql/engine/dataframe_query_rewriter.h"
 #include "src/trace_processor/perfetto_sql/engine/runtime_table_function.h"
 #include "src/trace_processor/perfetto_sql/engine/static_table_function_module.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/table_functions/static_table_function.h"
@@ -63,6 +64,12 @@ class PerfettoSqlEngine {
   struct ExecutionResult {
     SqliteEngine::PreparedStatement stmt;
     ExecutionStats stats;
+    // The last dataframe cursor filtered while taking the first step of
+    // |stmt|. This can be the cursor of a statement nested in |stmt| (e.g.
+    // in the body of a table function). If |stmt| is a plain scan of the
+    // table of this cursor (see GetDataframeScanColumns), its rows can be
+    // read directly from the cursor, bypassing SQLite.
+    DataframeModule::FilteredCursor dataframe_cursor;
   };
   struct StaticTable {
     dataframe::Dataframe* dataframe;
@@ -75,6 +82,19 @@ class PerfettoSqlEngine {
       const std::vector<StaticTable>& tables,
       std::vector<std::unique_ptr<StaticTableFunction>> functions);
 
+  // Sets the pool used to execute filters on large tables in parallel. The
+  // pool is not owned and must outlive this engine. Null (the default) means
+  // all queries run on the calling thread.
+  void SetDataframeThreadPool(base::ThreadPool* pool) {
+    dataframe_context_->thread_pool = pool;
+  }
+
+  // Sets the index over the trace string pool used to speed up glob filters
+  // on string columns. The index is not owned and must outlive this engine.
+  void SetDataframeStringPoolTrigramIndex(StringPoolTrigramIndex* index) {
+    dataframe_context_->string_pool_trigram_index = index;
+  }
+
   // Executes all the statements in |sql| and returns a |ExecutionResult|
   // object. The metadata will reference all the statements executed and the
   // |ScopedStmt| be empty.
@@ -264,6 +284,34 @@ class PerfettoSqlEngine {
   // Find dataframe registered with engine with provided name.
   const dataframe::Dataframe* GetDataframeOrNull(const std::string& name) const;
 
+  // Checks whether the statement of |result| does nothing other than
+  // returning the rows of |result.dataframe_cursor|, i.e. whether it is a
+  // statement accepted by ParseDataframeScan for which SQLite delegated all
+  // the filtering and sorting to the cursor. If so, returns the index of the
+  // dataframe column read by each result column.
+  //
+  // This parses the SQL of the statement and resolves the table it reads: it
+  // should only be called when that is expected to pay off (e.g. for queries
+  // returning many rows).
+  std::optional<std::vector<uint32_t>> GetDataframeScanColumns(
+      const ExecutionResult& result);
+
+  // Enables rewriting simple GROUP BY queries over dataframes to compute the
+  // aggregation inside the dataframe. See RewriteDataframeGroupBy for details.
+  //
+  // Requires the __intrinsic_table_ptr module and the function named
+  // kDataframeGroupByFunctionName to be registered.
+  void EnableDataframeGroupByRewrite() {
+    dataframe_group_by_rewrite_enabled_ = true;
+  }
+
+  // Enables rewriting simple equi-joins between dataframes to be computed with
+  // a hash join. See RewriteDataframeJoin for details.
+  //
+  // Requires the __intrinsic_table_ptr module and the function named
+  // kDataframeJoinFunctionName to be registered.
+  void EnableDataframeJoinRewrite() { dataframe_join_rewrite_enabled_ = true; }
+
   // Registers a function with the prototype |prototype| which returns a value
   // of |return_type| and is implemented by executing the SQL statement |sql|.
   //
@@ -293,6 +341,9 @@ class PerfettoSqlEngine {
     std::unique_ptr<PerfettoSqlParser> parser;
     ExecutionStats accumulated_stats;
     std::optional<SqliteEngine::PreparedStatement> current_stmt;
+    // The dataframe cursor filtered by the first step of |current_stmt|, if
+    // any.
+    DataframeModule::FilteredCursor current_stmt_dataframe_cursor;
 
     // For include frames: metadata needed to complete the include
     std::string include_key;
@@ -332,6 +383,14 @@ class PerfettoSqlEngine {
 
   base::Status ExecuteCreateView(const PerfettoSqlParser::CreateView&);
 
+  // Returns the SQL SQLite stores for the view called |name| or std::nullopt
+  // if there is no such view.
+  std::optional<std::string> GetViewSqlOrNull(const std::string& name);
+
+  // Returns the DataframeTable for the table or view called |name|. See
+  // ResolveDataframeTable.
+  std::optional<DataframeTable> ResolveTable(const std::string& name);
+
   base::Status ExecuteCreateMacro(const PerfettoSqlParser::CreateMacro&);
 
   base::Status ExecuteCreateIndex(const PerfettoSqlParser::CreateIndex&);
@@ -396,6 +455,12 @@ class PerfettoSqlEngine {
   // creating tables and views.
   const bool enable_extra_checks_;
 
+  // Whether to rewrite GROUP BY queries over dataframes.
+  bool dataframe_group_by_rewrite_enabled_ = false;
+
+  // Whether to rewrite joins between dataframes.
+  bool dataframe_join_rewrite_enabled_ = false;
+
   // Execution stack for iterative (non-recursive) processing of SQL sources.
   // When an INCLUDE statement is encountered, the included module's SQL is
   // pushed onto this stack and executed before continuing with the current SQL.
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/perfetto_sql/intrinsics/functions/dataframe_group_by.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "src/trace_processor/containers/null_term_string_view.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/adhoc_dataframe_builder.h"
+#include "src/trace_processor/core/dataframe/cursor.h"
+#include "src/trace_processor/core/dataframe/cursor_impl.h"  // IWYU pragma: keep
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/core/dataframe/specs.h"
+#include "src/trace_processor/perfetto_sql/engine/dataframe_query_rewriter.h"
+#include "src/trace_processor/perfetto_sql/engine/perfetto_sql_engine.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_function.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_result.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_type.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_value.h"
+#include "src/trace_processor/sqlite/sqlite_utils.h"
+
+namespace perfetto::trace_processor::perfetto_sql {
+namespace {
+
+// Appends the cells passed to it to a column of an AdhocDataframeBuilder.
+struct PushCellToBuilder : dataframe::CellCallback {
+  void OnCell(int64_t v) { builder->PushNonNullUnchecked(col, v); }
+  void OnCell(double v) { builder->PushNonNullUnchecked(col, v); }
+  void OnCell(NullTermStringView v) {
+    builder->PushNonNullUnchecked(col, pool->InternString(v));
+  }
+  void OnCell(std::nullptr_t) { builder->PushNull(col); }
+  void OnCell(uint32_t v) { builder->PushNonNullUnchecked(col, v); }
+  void OnCell(int32_t v) { builder->PushNonNullUnchecked(col, int64_t(v)); }
+
+  dataframe::AdhocDataframeBuilder* builder;
+  StringPool* pool;
+  uint32_t col;
+};
+
+base::StatusOr<dataframe::AggregateOp> ParseAggregateOp(const char* op) {
+  std::string str = op ? op : "";
+  if (str == "count") {
+    return dataframe::AggregateOp(dataframe::Count{});
+  }
+  if (str == "sum") {
+    return dataframe::AggregateOp(dataframe::Sum{});
+  }
+  if (str == "min") {
+    return dataframe::AggregateOp(dataframe::Min{});
+  }
+  if (str == "max") {
+    return dataframe::AggregateOp(dataframe::Max{});
+  }
+  return base::ErrStatus("Unknown aggregation '%s'", str.c_str());
+}
+
+// Computes a GROUP BY aggregation directly on the dataframe backing a table
+// and returns the result as a table pointer. See kDataframeGroupByFunctionName
+// for the arguments.
+//
+// Note: this function is not intended to be used directly from SQL: instead
+// GROUP BY queries are rewritten to use it by PerfettoSqlEngine.
+struct DataframeGroupBy : public sqlite::Function<DataframeGroupBy> {
+  static constexpr char kName[] = "__intrinsic_dataframe_group_by";
+  static constexpr int kArgCount = -1;
+
+  struct UserData {
+    PerfettoSqlEngine* engine;
+    StringPool* pool;
+  };
+
+  static void Step(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    UserData* user_data = GetUserData(ctx);
+    if (argc < 2 || sqlite::value::Type(argv[0]) != sqlite::Type::kText ||
+        sqlite::value::Type(argv[1]) != sqlite::Type::kInteger) {
+      return sqlite::result::Error(ctx, "GROUP BY: invalid arguments");
+    }
+    const char* table = sqlite::value::Text(argv[0]);
+    const dataframe::Dataframe* df =
+        user_data->engine->GetDataframeOrNull(table);
+    if (!df) {
+      return sqlite::utils::SetError(
+          ctx, base::ErrStatus("GROUP BY: table '%s' not found", table));
+    }
+    int64_t group_count = sqlite::value::Int64(argv[1]);
+    if (group_count < 0 || group_count > argc - 2 ||
+        (argc - 2 - group_count) % 2 != 0) {
+      return sqlite::result::Error(ctx, "GROUP BY: invalid arguments");
+    }
+    dataframe::DataframeSpec spec = df->CreateSpec();
+    auto column_index = [&spec](sqlite3_value* value) {
+      std::optional<uint32_t> res;
+      const char* name = sqlite::value::Text(value);
+      for (uint32_t i = 0; name && i < spec.column_names.size(); ++i) {
+        if (spec.column_names[i] == name) {
+          res = i;
+        }
+      }
+      return res;
+    };
+
+    std::vector<std::string> names;
+    std::vector<dataframe::AdhocDataframeBuilder::ColumnType> types;
+    using CT = dataframe::AdhocDataframeBuilder::ColumnType;
+    auto column_type = [&spec](uint32_t col) {
+      const auto& type = spec.column_specs[col].type;
+      if (type.Is<dataframe::String>()) {
+        return CT::kString;
+      }
+      return type.Is<dataframe::Double>() ? CT::kDouble : CT::kInt64;
+    };
+
+    std::vector<dataframe::GroupBySpec> group_by;
+    uint64_t cols_used = 0;
+    for (int i = 2; i < 2 + group_count; ++i) {
+      std::optional<uint32_t> col = column_index(argv[i]);
+      if (!col) {
+        return sqlite::result::Error(ctx, "GROUP BY: column not found");
+      }
+      group_by.push_back({*col});
+      cols_used |= 1ull << std::min(*col, 63u);
+      names.push_back("c" + std::to_string(names.size()));
+      types.push_back(column_type(*col));
+    }
+
+    std::vector<dataframe::AggregateSpec> aggregates;
+    for (int i = 2 + static_cast<int>(group_count); i < argc; i += 2) {
+      SQLITE_ASSIGN_OR_RETURN(ctx, dataframe::AggregateOp op,
+                              ParseAggregateOp(sqlite::value::Text(argv[i])));
+      std::optional<uint32_t> col;
+      if (!sqlite::value::IsNull(argv[i + 1])) {
+        col = column_index(argv[i + 1]);
+        if (!col) {
+          return sqlite::result::Error(ctx, "GROUP BY: column not found");
+        }
+      }
+      aggregates.push_back({col, op});
+      names.push_back("c" + std::to_string(names.size()));
+      types.push_back(col && !op.Is<dataframe::Count>() ? column_type(*col)
+                                                        : CT::kInt64);
+    }
+
+    std::vector<dataframe::FilterSpec> filters;
+    SQLITE_ASSIGN_OR_RETURN(
+        ctx, auto plan,
+        df->PlanAggregateQuery(filters, group_by, aggregates, cols_used));
+    dataframe::Cursor<dataframe::ErrorValueFetcher> cursor;
+    df->PrepareCursor(plan, cursor);
+    dataframe::ErrorValueFetcher fetcher;
+    cursor.Execute(fetcher);
+    for (uint32_t i = 0; i < aggregates.size(); ++i) {
+      if (cursor.AggregateOverflowed(i)) {
+        return sqlite::result::Error(ctx, "integer overflow");
+      }
+    }
+
+    dataframe::AdhocDataframeBuilder builder(
+        names, user_data->pool,
+        dataframe::AdhocDataframeBuilder::Options{
+            types, dataframe::NullabilityType::kSparseNullWithPopcount});
+    PushCellToBuilder cb;
+    cb.builder = &builder;
+    cb.pool = user_data->pool;
+    for (; !cursor.Eof(); cursor.Next()) {
+      uint32_t out = 0;
+      for (const auto& g : group_by) {
+        cb.col = out++;
+        cursor.Cell(g.col, cb);
+      }
+      for (uint32_t i = 0; i < aggregates.size(); ++i) {
+        cb.col = out++;
+        cursor.AggregateCell(i, cb);
+      }
+    }
+    SQLITE_ASSIGN_OR_RETURN(ctx, auto res, std::move(builder).Build());
+    return sqlite::result::UniquePointer(
+        ctx, std::make_unique<dataframe::Dataframe>(std::move(res)), "TABLE");
+  }
+};
+
+}  // namespace
+
+base::Status RegisterDataframeGroupByFunction(PerfettoSqlEngine& engine,
+                                              StringPool* pool) {
+  static_assert(std::string_view(DataframeGroupBy::kName) ==
+                kDataframeGroupByFunctionName);
+  RETURN_IF_ERROR(engine.RegisterFunction<DataframeGroupBy>(
+      std::make_unique<DataframeGroupBy::UserData>(
+          DataframeGroupBy::UserData{&engine, pool}),
+      PerfettoSqlEngine::RegisterFunctionArgs(nullptr, false)));
+  return base::OkStatus();
+}
+
+}  // namespace perfetto::trace_processor::perfetto_sql
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/perfetto_sql/intrinsics/functions/dataframe_join.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/status.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/core/dataframe/dataframe.h"
+#include "src/trace_processor/core/dataframe/hash_join.h"
+#include "src/trace_processor/core/dataframe/specs.h"
+#include "src/trace_processor/perfetto_sql/engine/dataframe_query_rewriter.h"
+#include "src/trace_processor/perfetto_sql/engine/perfetto_sql_engine.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_function.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_result.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_type.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_value.h"
+#include "src/trace_processor/sqlite/sqlite_utils.h"
+
+namespace perfetto::trace_processor::perfetto_sql {
+namespace {
+
+std::optional<uint32_t> ColumnIndex(const dataframe::DataframeSpec& spec,
+                                    sqlite3_value* value) {
+  if (sqlite::value::Type(value) != sqlite::Type::kText) {
+    return std::nullopt;
+  }
+  std::string_view name = sqlite::value::Text(value);
+  auto it = std::find(spec.column_names.begin(), spec.column_names.end(), name);
+  if (it == spec.column_names.end()) {
+    return std::nullopt;
+  }
+  return static_cast<uint32_t>(it - spec.column_names.begin());
+}
+
+// Computes an inner equi-join between dataframes and returns the result as a
+// table pointer. See kDataframeJoinFunctionName for the arguments.
+//
+// Note: this function is not intended to be used directly from SQL: instead
+// joins are rewritten to use it by PerfettoSqlEngine.
+struct DataframeJoin : public sqlite::Function<DataframeJoin> {
+  static constexpr char kName[] = "__intrinsic_dataframe_join";
+  static constexpr int kArgCount = -1;
+
+  struct UserData {
+    PerfettoSqlEngine* engine;
+    StringPool* pool;
+  };
+
+  static void Step(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    UserData* user_data = GetUserData(ctx);
+    if (argc < 2 || sqlite::value::Type(argv[0]) != sqlite::Type::kInteger) {
+      return sqlite::result::Error(ctx, "JOIN: invalid arguments");
+    }
+    int64_t table_count = sqlite::value::Int64(argv[0]);
+    if (table_count < 1 || 2 + (table_count - 1) * 4 > argc) {
+      return sqlite::result::Error(ctx, "JOIN: invalid arguments");
+    }
+
+    auto get_table = [user_data](sqlite3_value* value)
+        -> std::optional<std::pair<const dataframe::Dataframe*,
+                                   dataframe::DataframeSpec>> {
+      if (sqlite::value::Type(value) != sqlite::Type::kText) {
+        return std::nullopt;
+      }
+      const dataframe::Dataframe* df =
+          user_data->engine->GetDataframeOrNull(sqlite::value::Text(value));
+      if (!df) {
+        return std::nullopt;
+      }
+      return std::make_pair(df, df->CreateSpec());
+    };
+
+    std::vector<dataframe::HashJoinTableSpec> tables;
+    std::vector<dataframe::DataframeSpec> specs;
+    int arg = 1;
+    for (int64_t i = 0; i < table_count; ++i) {
+      auto table = get_table(argv[arg++]);
+      if (!table) {
+        return sqlite::result::Error(ctx, "JOIN: table not found");
+      }
+      dataframe::HashJoinTableSpec spec{table->first};
+      if (i > 0) {
+        int64_t left = sqlite::value::Int64(argv[arg++]);
+        if (left < 0 || left >= i) {
+          return sqlite::result::Error(ctx, "JOIN: invalid arguments");
+        }
+        std::optional<uint32_t> left_col =
+            ColumnIndex(specs[static_cast<size_t>(left)], argv[arg++]);
+        std::optional<uint32_t> col = ColumnIndex(table->second, argv[arg++]);
+        if (!left_col || !col) {
+          return sqlite::result::Error(ctx, "JOIN: column not found");
+        }
+        spec.left_table = static_cast<uint32_t>(left);
+        spec.left_col = *left_col;
+        spec.col = *col;
+      }
+      tables.push_back(spec);
+      specs.emplace_back(std::move(table->second));
+    }
+
+    if ((argc - arg) % 2 != 0) {
+      return sqlite::result::Error(ctx, "JOIN: invalid arguments");
+    }
+    std::vector<dataframe::HashJoinOutputColumnSpec> output_columns;
+    for (; arg < argc; arg += 2) {
+      int64_t table = sqlite::value::Int64(argv[arg]);
+      if (table < 0 || table >= table_count) {
+        return sqlite::result::Error(ctx, "JOIN: invalid arguments");
+      }
+      std::optional<uint32_t> col =
+          ColumnIndex(specs[static_cast<size_t>(table)], argv[arg + 1]);
+      if (!col) {
+        return sqlite::result::Error(ctx, "JOIN: column not found");
+      }
+      output_columns.push_back({static_cast<uint32_t>(table), *col,
+                                "c" + std::to_string(output_columns.size())});
+    }
+
+    SQLITE_ASSIGN_OR_RETURN(
+        ctx, auto res,
+        dataframe::HashJoin::Join(tables, output_columns, user_data->pool));
+    return sqlite::result::UniquePointer(
+        ctx, std::make_unique<dataframe::Dataframe>(std::move(res)), "TABLE");
+  }
+};
+
+}  // namespace
+
+base::Status RegisterDataframeJoinFunction(PerfettoSqlEngine& engine,
+                                           StringPool* pool) {
+  static_assert(std::string_view(DataframeJoin::kName) ==
+                kDataframeJoinFunctionName);
+  RETURN_IF_ERROR(engine.RegisterFunction<DataframeJoin>(
+      std::make_unique<DataframeJoin::UserData>(
+          DataframeJoin::UserData{&engine, pool}),
+      PerfettoSqlEngine::RegisterFunctionArgs(nullptr, false)));
+  return base::OkStatus();
+}
+
+}  // namespace perfetto::trace_processor::perfetto_sql
@@ -312,31 +312,25 @@ struct Regexp : public sqlite::Function<Regexp> {
   static constexpr char kName[] = "regexp";
   static constexpr int kArgCount = 2;
 
-  using AuxData = regex::Regex;
+  // Patterns are shared between statements using the same pattern.
+  using AuxData = std::shared_ptr<regex::Regex>;
   static void Step(sqlite3_context* ctx, int, sqlite3_value** argv) {
-    if constexpr (regex::IsRegexSupported()) {
-      const char* text =
-          reinterpret_cast<const char*>(sqlite3_value_text(argv[1]));
-      auto* aux = GetAuxData(ctx, 0);
-      if (PERFETTO_UNLIKELY(!aux || !text)) {
-        const char* pattern_str =
-            reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
-        if (!text || !pattern_str) {
-          return;
-        }
-        SQLITE_ASSIGN_OR_RETURN(ctx, auto regex,
-                                regex::Regex::Create(pattern_str));
-        auto ptr = std::make_unique<AuxData>(std::move(regex));
-        aux = ptr.get();
-        SetAuxData(ctx, 0, std::move(ptr));
-      }
-      return sqlite::result::Long(ctx, aux->Search(text));
-    } else {
-      // Always-true branch to avoid spurious no-return warnings.
-      if (ctx) {
-        PERFETTO_FATAL("Regex not supported");
+    const char* text =
+        reinterpret_cast<const char*>(sqlite3_value_text(argv[1]));
+    auto* aux = GetAuxData(ctx, 0);
+    if (PERFETTO_UNLIKELY(!aux || !text)) {
+      const char* pattern_str =
+          reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+      if (!text || !pattern_str) {
+        return;
       }
+      SQLITE_ASSIGN_OR_RETURN(ctx, auto regex,
+                              regex::Regex::CreateCached(pattern_str));
+      auto ptr = std::make_unique<AuxData>(std::move(regex));
+      aux = ptr.get();
+      SetAuxData(ctx, 0, std::move(ptr));
     }
+    return sqlite::result::Long(ctx, (*aux)->Search(text));
   }
 };
 
@@ -350,7 +344,7 @@ struct RegexpExtract : public sqlite::Function<RegexpExtract> {
   };
 
   static void Step(sqlite3_context* ctx, int, sqlite3_value** argv) {
-    if constexpr (regex::IsRegexSupported()) {
+    if constexpr (regex::IsSubmatchSupported()) {
       const char* text =
           reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
       auto* aux = GetAuxData(ctx, 1);
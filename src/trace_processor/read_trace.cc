@@ -28,11 +28,13 @@
 #include "perfetto/trace_processor/trace_blob_view.h"
 #include "perfetto/trace_processor/trace_processor.h"
 #include "src/trace_processor/importers/archive/gzip_trace_parser.h"
+#include "src/trace_processor/importers/archive/zstd_trace_parser.h"
 #include "src/trace_processor/importers/common/chunked_trace_reader.h"
 #include "src/trace_processor/importers/proto/proto_trace_tokenizer.h"
 #include "src/trace_processor/read_trace_internal.h"
 #include "src/trace_processor/util/gzip_utils.h"
 #include "src/trace_processor/util/trace_type.h"
+#include "src/trace_processor/util/zstd_utils.h"
 
 #include "protos/perfetto/trace/trace.pbzero.h"
 #include "protos/perfetto/trace/trace_packet.pbzero.h"
@@ -89,9 +91,11 @@ base::Status DecompressTrace(const uint8_t* data,
                              size_t size,
                              std::vector<uint8_t>* output) {
   TraceType type = GuessTraceType(data, size);
-  if (type != TraceType::kGzipTraceType && type != TraceType::kProtoTraceType) {
+  if (type != TraceType::kGzipTraceType && type != TraceType::kZstdTraceType &&
+      type != TraceType::kProtoTraceType) {
     return base::ErrStatus(
-        "Only GZIP and proto trace types are supported by DecompressTrace");
+        "Only GZIP, ZSTD and proto trace types are supported by "
+        "DecompressTrace");
   }
 
   if (type == TraceType::kGzipTraceType) {
@@ -102,10 +106,22 @@ base::Status DecompressTrace(const uint8_t* data,
     return parser.NotifyEndOfFile();
   }
 
+  if (type == TraceType::kZstdTraceType) {
+    if (!util::IsZstdSupported()) {
+      return base::ErrStatus("Zstd support is disabled in this build");
+    }
+    std::unique_ptr<ChunkedTraceReader> reader(
+        new SerializingProtoTraceReader(output));
+    ZstdTraceParser parser(std::move(reader));
+    RETURN_IF_ERROR(parser.ParseUnowned(data, size));
+    return parser.NotifyEndOfFile();
+  }
+
   PERFETTO_CHECK(type == TraceType::kProtoTraceType);
 
   protos::pbzero::Trace::Decoder decoder(data, size);
   util::GzipDecompressor decompressor;
+  util::ZstdDecompressor zstd_decompressor;
   if (size > 0 && !decoder.packet()) {
     return base::ErrStatus("Trace does not contain valid packets");
   }
@@ -116,8 +132,22 @@ base::Status DecompressTrace(const uint8_t* data,
       continue;
     }
 
-    // Make sure that to reset the stream between the gzip streams.
     auto bytes = packet.compressed_packets();
+    if (util::IsZstdFrame(bytes.data, bytes.size)) {
+      zstd_decompressor.Reset();
+      using ZstdResultCode = util::ZstdDecompressor::ResultCode;
+      ZstdResultCode ret = zstd_decompressor.FeedAndExtract(
+          bytes.data, bytes.size,
+          [&output](const uint8_t* buf, size_t buf_len) {
+            output->insert(output->end(), buf, buf + buf_len);
+          });
+      if (ret != ZstdResultCode::kEof) {
+        return base::ErrStatus("Failed while decompressing zstd stream");
+      }
+      continue;
+    }
+
+    // Make sure that to reset the stream between the gzip streams.
     decompressor.Reset();
     using ResultCode = util::GzipDecompressor::ResultCode;
     ResultCode ret = decompressor.FeedAndExtract(
@@ -16,8 +16,11 @@
 
 #include "perfetto/ext/base/file_utils.h"
 #include "perfetto/ext/base/scoped_file.h"
+#include "perfetto/ext/base/temp_file.h"
 #include "perfetto/ext/base/utils.h"
 #include "perfetto/trace_processor/read_trace.h"
+#include "perfetto/trace_processor/trace_processor.h"
+#include "src/trace_processor/read_trace_internal.h"
 
 #include "src/base/test/utils.h"
 #include "test/gtest_and_gmock.h"
@@ -132,6 +135,69 @@ TEST_F(ReadTraceIntegrationTest, DoubleGzipDecompressTrace) {
   ASSERT_EQ(packet_count, 2412u);
 }
 
+int64_t CountSchedSlices(TraceProcessor* tp) {
+  auto it = tp->ExecuteQuery("SELECT COUNT(*) FROM sched");
+  EXPECT_TRUE(it.Next());
+  int64_t count = it.Get(0).AsLong();
+  EXPECT_TRUE(it.Status().ok());
+  return count;
+}
+
+TEST_F(ReadTraceIntegrationTest, FollowGrowingFile) {
+  base::ScopedFstream f =
+      OpenTestTrace("test/data/example_android_trace_30s.pb");
+  std::vector<uint8_t> raw_trace = ReadAllData(f);
+
+  auto expected_tp = TraceProcessor::CreateInstance(Config());
+  ASSERT_TRUE(expected_tp
+                  ->Parse(TraceBlobView(
+                      TraceBlob::CopyFrom(raw_trace.data(), raw_trace.size())))
+                  .ok());
+  ASSERT_TRUE(expected_tp->NotifyEndOfFile().ok());
+  int64_t expected_count = CountSchedSlices(expected_tp.get());
+  ASSERT_GT(expected_count, 0);
+
+  // Append the trace in a few chunks which don't end on packet boundaries,
+  // querying in between.
+  base::TempFile tmp = base::TempFile::Create();
+  Config config;
+  config.enable_prelude_views_before_eof = true;
+  auto tp = TraceProcessor::CreateInstance(config);
+  TraceFileFollower follower(tmp.path());
+  size_t written = 0;
+  for (size_t end : {raw_trace.size() / 3 + 7, raw_trace.size() / 2 + 3,
+                     raw_trace.size()}) {
+    ASSERT_TRUE(base::WriteAll(tmp.fd(), raw_trace.data() + written,
+                               end - written) > 0);
+    written = end;
+    ASSERT_TRUE(follower.ReadNewData(tp.get()).ok());
+    ASSERT_EQ(follower.bytes_read(), written);
+    ASSERT_LE(CountSchedSlices(tp.get()), expected_count);
+  }
+  ASSERT_TRUE(follower.ReadNewData(tp.get()).ok());
+  ASSERT_EQ(follower.bytes_read(), raw_trace.size());
+
+  // The prelude views are available before EOF (showing the events sorted so
+  // far), but the prelude tables (computed once from the full trace) are not.
+  ASSERT_LE(CountSchedSlices(tp.get()), expected_count);
+  {
+    auto it = tp->ExecuteQuery("SELECT COUNT(*) FROM thread_track");
+    ASSERT_FALSE(it.Next());
+    ASSERT_FALSE(it.Status().ok());
+  }
+
+  ASSERT_TRUE(tp->NotifyEndOfFile().ok());
+  ASSERT_EQ(CountSchedSlices(tp.get()), expected_count);
+  {
+    auto it = tp->ExecuteQuery("SELECT COUNT(*) FROM thread_track");
+    ASSERT_TRUE(it.Next());
+    ASSERT_GT(it.Get(0).AsLong(), 0);
+  }
+
+  ASSERT_TRUE(base::OpenFile(tmp.path(), O_WRONLY | O_TRUNC));
+  ASSERT_FALSE(follower.ReadNewData(tp.get()).ok());
+}
+
 }  // namespace
 }  // namespace trace_processor
 }  // namespace perfetto
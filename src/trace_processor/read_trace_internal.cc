@@ -24,8 +24,11 @@
 #include <cstdlib>
 #include <cstring>
 #include <functional>
+#include <optional>
+#include <string>
 #include <utility>
 
+#include "perfetto/base/compiler.h"
 #include "perfetto/base/logging.h"
 #include "perfetto/base/status.h"
 #include "perfetto/ext/base/file_utils.h"
@@ -73,20 +76,21 @@ base::Status ReadTraceUsingRead(
 base::Status ReadTraceUnfinalized(
     TraceProcessor* tp,
     const char* filename,
-    const std::function<void(uint64_t parsed_size)>& progress_callback) {
+    const std::function<void(uint64_t parsed_size)>& progress_callback,
+    bool map_chunks_separately) {
   uint64_t bytes_read = 0;
 
 #if PERFETTO_HAS_MMAP()
   char* no_mmap = getenv("TRACE_PROCESSOR_NO_MMAP");
   bool use_mmap = !no_mmap || *no_mmap != '1';
 
-  if (use_mmap) {
+  // Parse the file in chunks so we get some status update on stdio.
+  static constexpr size_t kMmapChunkSize = 128ul * 1024 * 1024;
+  if (use_mmap && !map_chunks_separately) {
     base::ScopedMmap mapped = base::ReadMmapWholeFile(filename);
     if (mapped.IsValid()) {
       size_t length = mapped.length();
       TraceBlobView whole_mmap(TraceBlob::FromMmap(std::move(mapped)));
-      // Parse the file in chunks so we get some status update on stdio.
-      static constexpr size_t kMmapChunkSize = 128ul * 1024 * 1024;
       while (bytes_read < length) {
         progress_callback(bytes_read);
         const size_t bytes_read_z = static_cast<size_t>(bytes_read);
@@ -96,9 +100,32 @@ base::Status ReadTraceUnfinalized(
         bytes_read += slice_size;
       }  // while (slices)
     }  // if (mapped.IsValid())
+  } else if (use_mmap) {
+    std::optional<uint64_t> file_size = base::GetFileSize(filename);
+    size_t length = static_cast<size_t>(file_size.value_or(0));
+    if (static_cast<uint64_t>(length) != file_size.value_or(0))
+      length = 0;
+    while (bytes_read < length) {
+      progress_callback(bytes_read);
+      const size_t bytes_read_z = static_cast<size_t>(bytes_read);
+      size_t slice_size = std::min(length - bytes_read_z, kMmapChunkSize);
+      base::ScopedMmap mapped =
+          base::ReadMmapFilePart(filename, bytes_read_z, slice_size);
+      if (!mapped.IsValid()) {
+        if (bytes_read == 0)
+          break;  // Fall back on read() below.
+        return base::ErrStatus("Could not mmap trace file (path: %s)",
+                               filename);
+      }
+      RETURN_IF_ERROR(
+          tp->Parse(TraceBlobView(TraceBlob::FromMmap(std::move(mapped)))));
+      bytes_read += slice_size;
+    }  // while (chunks)
   }  // if (use_mmap)
   if (bytes_read == 0)
     PERFETTO_LOG("Cannot use mmap on this system. Falling back on read()");
+#else
+  base::ignore_result(map_chunks_separately);
 #endif  // PERFETTO_HAS_MMAP()
   if (bytes_read == 0) {
     base::ScopedFile fd(base::OpenFile(filename, O_RDONLY));
@@ -113,4 +140,48 @@ base::Status ReadTraceUnfinalized(
     progress_callback(bytes_read);
   return base::OkStatus();
 }
+
+TraceFileFollower::TraceFileFollower(std::string filename)
+    : filename_(std::move(filename)) {}
+TraceFileFollower::~TraceFileFollower() = default;
+
+base::Status TraceFileFollower::ReadNewData(TraceProcessor* tp) {
+  if (!fd_) {
+    fd_ = base::OpenFile(filename_, O_RDONLY);
+    if (!fd_) {
+      return base::ErrStatus("Could not open trace file (path: %s)",
+                             filename_.c_str());
+    }
+    tp->SetCurrentTraceName(filename_);
+  }
+  std::optional<uint64_t> file_size = base::GetFileSize(filename_);
+  if (!file_size) {
+    return base::ErrStatus("Could not stat trace file (path: %s)",
+                           filename_.c_str());
+  }
+  if (*file_size < bytes_read_) {
+    return base::ErrStatus("Trace file was truncated (path: %s)",
+                           filename_.c_str());
+  }
+
+  // Blobs are sized to the data which is available: the tokenizer can retain
+  // them so, when following a slowly growing file, fixed size blobs would
+  // mostly hold unused memory.
+  while (bytes_read_ < *file_size) {
+    uint64_t available = *file_size - bytes_read_;
+    TraceBlob blob = TraceBlob::Allocate(
+        static_cast<size_t>(std::min<uint64_t>(available, kChunkSize)));
+    auto rsize = base::Read(*fd_, blob.data(), blob.size());
+    if (rsize == 0)
+      break;
+    if (rsize < 0) {
+      return base::ErrStatus("Reading trace file failed (errno: %d, %s)", errno,
+                             strerror(errno));
+    }
+    bytes_read_ += static_cast<uint64_t>(rsize);
+    TraceBlobView blob_view(std::move(blob), 0, static_cast<size_t>(rsize));
+    RETURN_IF_ERROR(tp->Parse(std::move(blob_view)));
+  }
+  return base::OkStatus();
+}
 }  // namespace perfetto::trace_processor
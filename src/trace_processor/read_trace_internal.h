@@ -19,19 +19,49 @@
 
 #include <cstdint>
 #include <functional>
+#include <string>
 
 #include "perfetto/base/export.h"
 #include "perfetto/base/status.h"
+#include "perfetto/ext/base/scoped_file.h"
 
 namespace perfetto::trace_processor {
 
 class TraceProcessor;
 
 // Reads trace without Flushing the data at the end.
+//
+// The file is mapped in memory as a whole and passed to Parse() in slices of
+// that mapping. If |map_chunks_separately| is true, each slice is mapped on
+// its own instead, so that the blobs passed to Parse() don't share their
+// TraceBlob: this avoids copying them with |Config::enable_read_ahead|.
 base::Status PERFETTO_EXPORT_COMPONENT ReadTraceUnfinalized(
     TraceProcessor* tp,
     const char* filename,
-    const std::function<void(uint64_t parsed_size)>& progress_callback = {});
+    const std::function<void(uint64_t parsed_size)>& progress_callback = {},
+    bool map_chunks_separately = false);
+
+// Incrementally reads a trace file which is still being written (e.g. by
+// traced with write_into_file). Each call to ReadNewData() parses the bytes
+// appended to the file since the previous call. NotifyEndOfFile() is never
+// called: queries see the events which the sorter has extracted so far, which
+// for proto traces happens as flush and read-buffer service events are parsed.
+class PERFETTO_EXPORT_COMPONENT TraceFileFollower {
+ public:
+  explicit TraceFileFollower(std::string filename);
+  ~TraceFileFollower();
+
+  // Parses the data appended to the file since the last call (or the whole
+  // file on the first call). Fails if the file has been truncated.
+  base::Status ReadNewData(TraceProcessor* tp);
+
+  uint64_t bytes_read() const { return bytes_read_; }
+
+ private:
+  const std::string filename_;
+  base::ScopedFile fd_;
+  uint64_t bytes_read_ = 0;
+};
 
 }  // namespace perfetto::trace_processor
 
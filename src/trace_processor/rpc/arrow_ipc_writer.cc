@@ -0,0 +1,460 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/rpc/arrow_ipc_writer.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/ext/base/string_utils.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+// Values from Schema.fbs and Message.fbs in the Arrow repository.
+constexpr uint16_t kMetadataVersionV5 = 4;
+constexpr uint8_t kMessageHeaderSchema = 1;
+constexpr uint8_t kMessageHeaderRecordBatch = 3;
+constexpr uint8_t kTypeNull = 1;
+constexpr uint8_t kTypeInt = 2;
+constexpr uint8_t kTypeFloatingPoint = 3;
+constexpr uint8_t kTypeBinary = 4;
+constexpr uint8_t kTypeUtf8 = 5;
+constexpr uint16_t kPrecisionDouble = 2;
+
+// Prefix of each message in a stream. The end of the stream is marked by a
+// message with zero length.
+constexpr uint32_t kContinuationMarker = 0xFFFFFFFF;
+
+// Buffers in the body of a record batch must start at 8-byte aligned offsets.
+constexpr size_t kBodyAlignment = 8;
+
+// The type of each cell, as stored in Column::types. Ordered from the
+// narrowest to the widest type of column which can hold the cell.
+enum CellType : uint8_t {
+  kCellNull = 0,
+  kCellLong = 1,
+  kCellDouble = 2,
+  kCellString = 3,
+  kCellBlob = 4,
+};
+
+size_t AlignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+template <typename T>
+void AppendPod(std::vector<uint8_t>* buf, T value) {
+  size_t pos = buf->size();
+  buf->resize(pos + sizeof(T));
+  memcpy(buf->data() + pos, &value, sizeof(T));
+}
+
+// Minimal FlatBuffers writer, just enough for the Arrow metadata messages.
+//
+// Unlike the official builder, which writes buffers back to front, objects are
+// appended front to back: a table is written before the objects it references
+// and the references are patched in once those are written. This works as
+// references (uoffset_t) must point forward in the buffer.
+class FlatBufferWriter {
+ public:
+  struct TableField {
+    uint16_t slot;
+    uint8_t size;
+    // Ignored for offsets, which are patched later with PatchOffset().
+    uint64_t value;
+  };
+  struct Table {
+    size_t pos;
+    // The position of each of the fields passed to AddTable(), in order.
+    std::vector<size_t> fields;
+  };
+
+  // Leaves space for the offset of the root table.
+  FlatBufferWriter() { buf_.resize(sizeof(uint32_t)); }
+
+  Table AddTable(std::initializer_list<TableField> fields) {
+    uint16_t num_slots = 0;
+    for (const TableField& f : fields) {
+      num_slots = std::max<uint16_t>(num_slots, f.slot + 1);
+    }
+    const auto vtable_size = static_cast<uint16_t>(4 + 2 * num_slots);
+    Align(2);
+    size_t vtable = buf_.size();
+    buf_.resize(vtable + vtable_size);
+
+    // Tables are 8-byte aligned so that field alignments can be computed
+    // relative to the table start.
+    Align(8);
+    Table table{buf_.size(), {}};
+    AppendPod<int32_t>(&buf_, static_cast<int32_t>(table.pos - vtable));
+    for (const TableField& f : fields) {
+      Align(f.size);
+      size_t pos = buf_.size();
+      buf_.resize(pos + f.size);
+      memcpy(buf_.data() + pos, &f.value, f.size);
+      WriteAt<uint16_t>(vtable + 4 + 2 * f.slot,
+                        static_cast<uint16_t>(pos - table.pos));
+      table.fields.push_back(pos);
+    }
+    WriteAt<uint16_t>(vtable, vtable_size);
+    WriteAt<uint16_t>(vtable + 2,
+                      static_cast<uint16_t>(buf_.size() - table.pos));
+    return table;
+  }
+
+  size_t AddString(const std::string& str) {
+    Align(4);
+    size_t pos = buf_.size();
+    AppendPod<uint32_t>(&buf_, static_cast<uint32_t>(str.size()));
+    buf_.insert(buf_.end(), str.begin(), str.end());
+    buf_.push_back(0);
+    return pos;
+  }
+
+  // Adds a vector of |count| offsets which must be set with PatchOffset().
+  // Returns the position of the vector and of its first element.
+  std::pair<size_t, size_t> AddOffsetVector(uint32_t count) {
+    Align(4);
+    size_t pos = buf_.size();
+    AppendPod<uint32_t>(&buf_, count);
+    buf_.resize(buf_.size() + count * sizeof(uint32_t));
+    return {pos, pos + sizeof(uint32_t)};
+  }
+
+  // Adds a vector of structs made of 64-bit fields.
+  template <typename T>
+  size_t AddStructVector(const std::vector<T>& elements) {
+    static_assert(alignof(T) == 8);
+    // The elements, not the length, need to be 8-byte aligned.
+    while ((buf_.size() + sizeof(uint32_t)) % 8 != 0) {
+      buf_.push_back(0);
+    }
+    size_t pos = buf_.size();
+    AppendPod<uint32_t>(&buf_, static_cast<uint32_t>(elements.size()));
+    const auto* data = reinterpret_cast<const uint8_t*>(elements.data());
+    buf_.insert(buf_.end(), data, data + elements.size() * sizeof(T));
+    return pos;
+  }
+
+  void PatchOffset(size_t field_pos, size_t target_pos) {
+    PERFETTO_DCHECK(target_pos > field_pos);
+    WriteAt<uint32_t>(field_pos, static_cast<uint32_t>(target_pos - field_pos));
+  }
+
+  void SetRoot(size_t table_pos) { PatchOffset(0, table_pos); }
+
+  // Returns the buffer, padded to a multiple of 8 bytes.
+  std::vector<uint8_t> Finalize() && {
+    Align(8);
+    return std::move(buf_);
+  }
+
+ private:
+  void Align(size_t alignment) {
+    buf_.resize(AlignUp(buf_.size(), alignment));
+  }
+
+  template <typename T>
+  void WriteAt(size_t pos, T value) {
+    memcpy(buf_.data() + pos, &value, sizeof(T));
+  }
+
+  std::vector<uint8_t> buf_;
+};
+
+struct FieldNode {
+  int64_t length;
+  int64_t null_count;
+};
+
+struct BufferSpec {
+  int64_t offset;
+  int64_t length;
+};
+
+// Appends an encapsulated message (i.e. the continuation marker, the size of
+// the metadata and the metadata) to |out|.
+void AppendMessage(std::vector<uint8_t>* out,
+                   const std::vector<uint8_t>& metadata) {
+  PERFETTO_DCHECK(metadata.size() % 8 == 0);
+  AppendPod<uint32_t>(out, kContinuationMarker);
+  AppendPod<int32_t>(out, static_cast<int32_t>(metadata.size()));
+  out->insert(out->end(), metadata.begin(), metadata.end());
+}
+
+}  // namespace
+
+struct ArrowIpcWriter::Column {
+  std::string name;
+  // One entry per row.
+  std::vector<uint8_t> types;
+  // One entry per row: the value of integers and the bits of doubles.
+  std::vector<int64_t> fixed;
+  // One entry per row plus one: the range of |var| used by strings and blobs.
+  std::vector<int32_t> offsets{0};
+  std::vector<uint8_t> var;
+  // Bitmask of the CellTypes in |types|.
+  uint32_t types_seen = 0;
+  uint32_t null_count = 0;
+  // The widest CellType in this column across all the streams written so far:
+  // unlike the fields above, this is not reset between streams.
+  uint8_t widest_type = kCellNull;
+};
+
+ArrowIpcWriter::ArrowIpcWriter(std::vector<std::string> column_names) {
+  columns_.resize(column_names.size());
+  for (size_t i = 0; i < column_names.size(); ++i) {
+    columns_[i].name = std::move(column_names[i]);
+  }
+}
+
+ArrowIpcWriter::~ArrowIpcWriter() = default;
+
+ArrowIpcWriter::Column& ArrowIpcWriter::NextColumn() {
+  Column& col = columns_[next_column_];
+  if (++next_column_ == columns_.size()) {
+    next_column_ = 0;
+    ++row_count_;
+  }
+  return col;
+}
+
+void ArrowIpcWriter::AppendNull() {
+  Column& col = NextColumn();
+  col.types.push_back(kCellNull);
+  col.fixed.push_back(0);
+  col.offsets.push_back(col.offsets.back());
+  col.types_seen |= 1u << kCellNull;
+  col.null_count++;
+}
+
+void ArrowIpcWriter::AppendLong(int64_t value) {
+  Column& col = NextColumn();
+  col.types.push_back(kCellLong);
+  col.fixed.push_back(value);
+  col.offsets.push_back(col.offsets.back());
+  col.types_seen |= 1u << kCellLong;
+}
+
+void ArrowIpcWriter::AppendDouble(double value) {
+  Column& col = NextColumn();
+  int64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  col.types.push_back(kCellDouble);
+  col.fixed.push_back(bits);
+  col.offsets.push_back(col.offsets.back());
+  col.types_seen |= 1u << kCellDouble;
+}
+
+void ArrowIpcWriter::AppendString(const char* data, size_t size) {
+  Column& col = NextColumn();
+  col.types.push_back(kCellString);
+  col.fixed.push_back(0);
+  col.var.insert(col.var.end(), data, data + size);
+  PERFETTO_CHECK(col.var.size() <= std::numeric_limits<int32_t>::max());
+  col.offsets.push_back(static_cast<int32_t>(col.var.size()));
+  col.types_seen |= 1u << kCellString;
+}
+
+void ArrowIpcWriter::AppendBlob(const uint8_t* data, size_t size) {
+  Column& col = NextColumn();
+  col.types.push_back(kCellBlob);
+  col.fixed.push_back(0);
+  col.var.insert(col.var.end(), data, data + size);
+  PERFETTO_CHECK(col.var.size() <= std::numeric_limits<int32_t>::max());
+  col.offsets.push_back(static_cast<int32_t>(col.var.size()));
+  col.types_seen |= 1u << kCellBlob;
+}
+
+std::vector<uint8_t> ArrowIpcWriter::WriteStreamAndReset() {
+  PERFETTO_CHECK(next_column_ == 0);
+
+  // Pick the type of each column and convert the cells which don't match it.
+  // The type of a column never gets narrower from one stream to the next so
+  // that the streams of a query can be concatenated.
+  std::vector<uint8_t> types;
+  for (Column& col : columns_) {
+    uint32_t seen = col.types_seen & ~(1u << kCellNull);
+    for (uint8_t t = kCellBlob; t > col.widest_type; --t) {
+      if (seen & (1u << t)) {
+        col.widest_type = t;
+        break;
+      }
+    }
+    uint32_t numbers = seen & ((1u << kCellLong) | (1u << kCellDouble));
+    if (col.widest_type >= kCellString) {
+      types.push_back(col.widest_type == kCellBlob ? kTypeBinary : kTypeUtf8);
+      if (numbers) {
+        std::vector<int32_t> offsets{0};
+        std::vector<uint8_t> var;
+        for (uint32_t i = 0; i < row_count_; ++i) {
+          if (col.types[i] == kCellLong) {
+            base::StackString<32> str("%" PRId64, col.fixed[i]);
+            var.insert(var.end(), str.c_str(), str.c_str() + str.len());
+          } else if (col.types[i] == kCellDouble) {
+            double value;
+            memcpy(&value, &col.fixed[i], sizeof(value));
+            base::StackString<32> str("%.17g", value);
+            var.insert(var.end(), str.c_str(), str.c_str() + str.len());
+          } else {
+            var.insert(var.end(), col.var.begin() + col.offsets[i],
+                       col.var.begin() + col.offsets[i + 1]);
+          }
+          PERFETTO_CHECK(var.size() <= std::numeric_limits<int32_t>::max());
+          offsets.push_back(static_cast<int32_t>(var.size()));
+        }
+        col.offsets = std::move(offsets);
+        col.var = std::move(var);
+      }
+    } else if (col.widest_type == kCellDouble) {
+      types.push_back(kTypeFloatingPoint);
+      for (uint32_t i = 0; i < row_count_; ++i) {
+        if (col.types[i] == kCellLong) {
+          auto value = static_cast<double>(col.fixed[i]);
+          memcpy(&col.fixed[i], &value, sizeof(value));
+        }
+      }
+    } else if (col.widest_type == kCellLong) {
+      types.push_back(kTypeInt);
+    } else {
+      types.push_back(kTypeNull);
+    }
+  }
+
+  std::vector<uint8_t> out;
+
+  // The schema.
+  {
+    FlatBufferWriter fb;
+    auto message = fb.AddTable({{0, 2, kMetadataVersionV5},
+                                {1, 1, kMessageHeaderSchema},
+                                {2, 4, 0},
+                                {3, 8, 0}});
+    fb.SetRoot(message.pos);
+    auto schema = fb.AddTable({{1, 4, 0}});
+    fb.PatchOffset(message.fields[2], schema.pos);
+    auto fields = fb.AddOffsetVector(static_cast<uint32_t>(columns_.size()));
+    fb.PatchOffset(schema.fields[0], fields.first);
+    for (size_t i = 0; i < columns_.size(); ++i) {
+      auto field = fb.AddTable(
+          {{0, 4, 0}, {1, 1, 1}, {2, 1, types[i]}, {3, 4, 0}, {5, 4, 0}});
+      fb.PatchOffset(fields.second + i * sizeof(uint32_t), field.pos);
+      fb.PatchOffset(field.fields[0], fb.AddString(columns_[i].name));
+      FlatBufferWriter::Table type;
+      switch (types[i]) {
+        case kTypeInt:
+          type = fb.AddTable({{0, 4, 64}, {1, 1, 1}});
+          break;
+        case kTypeFloatingPoint:
+          type = fb.AddTable({{0, 2, kPrecisionDouble}});
+          break;
+        default:
+          type = fb.AddTable({});
+          break;
+      }
+      fb.PatchOffset(field.fields[3], type.pos);
+      fb.PatchOffset(field.fields[4], fb.AddOffsetVector(0).first);
+    }
+    AppendMessage(&out, std::move(fb).Finalize());
+  }
+
+  // The record batch. Buffers are not copied into a separate body but are
+  // appended to |out| straight after the metadata.
+  {
+    std::vector<FieldNode> nodes;
+    std::vector<BufferSpec> buffers;
+    std::vector<std::pair<const uint8_t*, size_t>> buffer_data;
+    std::vector<std::vector<uint8_t>> validity(columns_.size());
+    size_t body_size = 0;
+    auto add_buffer = [&](const void* data, size_t size) {
+      buffers.push_back(BufferSpec{static_cast<int64_t>(body_size),
+                                   static_cast<int64_t>(size)});
+      buffer_data.emplace_back(static_cast<const uint8_t*>(data), size);
+      body_size += AlignUp(size, kBodyAlignment);
+    };
+    for (size_t i = 0; i < columns_.size(); ++i) {
+      const Column& col = columns_[i];
+      nodes.push_back(FieldNode{row_count_, col.null_count});
+      if (types[i] == kTypeNull) {
+        continue;
+      }
+      // The validity bitmap can be omitted if there are no NULLs.
+      if (col.null_count > 0) {
+        validity[i].resize((row_count_ + 7) / 8);
+        for (uint32_t r = 0; r < row_count_; ++r) {
+          if (col.types[r] != kCellNull) {
+            validity[i][r / 8] |= static_cast<uint8_t>(1u << (r % 8));
+          }
+        }
+      }
+      add_buffer(validity[i].data(), validity[i].size());
+      if (types[i] == kTypeInt || types[i] == kTypeFloatingPoint) {
+        add_buffer(col.fixed.data(), row_count_ * sizeof(int64_t));
+      } else {
+        add_buffer(col.offsets.data(), (row_count_ + 1) * sizeof(int32_t));
+        add_buffer(col.var.data(), col.var.size());
+      }
+    }
+
+    FlatBufferWriter fb;
+    auto message = fb.AddTable({{0, 2, kMetadataVersionV5},
+                                {1, 1, kMessageHeaderRecordBatch},
+                                {2, 4, 0},
+                                {3, 8, body_size}});
+    fb.SetRoot(message.pos);
+    auto batch = fb.AddTable({{0, 8, row_count_}, {1, 4, 0}, {2, 4, 0}});
+    fb.PatchOffset(message.fields[2], batch.pos);
+    fb.PatchOffset(batch.fields[1], fb.AddStructVector(nodes));
+    fb.PatchOffset(batch.fields[2], fb.AddStructVector(buffers));
+    AppendMessage(&out, std::move(fb).Finalize());
+
+    size_t body_start = out.size();
+    out.reserve(out.size() + body_size + 8);
+    for (const auto& [data, size] : buffer_data) {
+      out.insert(out.end(), data, data + size);
+      out.resize(AlignUp(out.size() - body_start, kBodyAlignment) +
+                 body_start);
+    }
+    PERFETTO_DCHECK(out.size() - body_start == body_size);
+  }
+
+  // The end of stream marker.
+  AppendPod<uint32_t>(&out, kContinuationMarker);
+  AppendPod<uint32_t>(&out, 0);
+
+  for (Column& col : columns_) {
+    col.types.clear();
+    col.fixed.clear();
+    col.offsets.resize(1);
+    col.var.clear();
+    col.types_seen = 0;
+    col.null_count = 0;
+  }
+  row_count_ = 0;
+  return out;
+}
+
+}  // namespace perfetto::trace_processor
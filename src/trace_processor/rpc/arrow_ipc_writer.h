@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_RPC_ARROW_IPC_WRITER_H_
+#define SRC_TRACE_PROCESSOR_RPC_ARROW_IPC_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace perfetto::trace_processor {
+
+// Builds Apache Arrow IPC streams from query results, see
+// https://arrow.apache.org/docs/format/Columnar.html#ipc-streaming-format.
+//
+// Cells are appended in row-major order (i.e. in the order they are returned
+// by the query) but are stored column by column, so that they can be written
+// out as Arrow buffers without transposing them.
+//
+// SQLite columns are dynamically typed while Arrow ones are not. The Arrow
+// type of each column is chosen when a stream is written, based on the values
+// in that column in this stream and in all the previous ones:
+//  - only NULLs: null.
+//  - only integers: int64.
+//  - integers and doubles: float64.
+//  - any string: utf8, with numbers converted to their decimal representation.
+//  - any blob: binary, with strings and numbers converted as above.
+// As a result, the type of a column only ever gets wider (in the order above)
+// from one stream to the next: the previous streams of a query can always be
+// cast to the schema of the last one to concatenate them. All columns are
+// nullable.
+class ArrowIpcWriter {
+ public:
+  explicit ArrowIpcWriter(std::vector<std::string> column_names);
+  ~ArrowIpcWriter();
+
+  ArrowIpcWriter(const ArrowIpcWriter&) = delete;
+  ArrowIpcWriter& operator=(const ArrowIpcWriter&) = delete;
+
+  void AppendNull();
+  void AppendLong(int64_t);
+  void AppendDouble(double);
+  void AppendString(const char* data, size_t size);
+  void AppendBlob(const uint8_t* data, size_t size);
+
+  // Writes all the rows appended so far as a complete Arrow IPC stream (i.e.
+  // the schema, a single record batch and the end-of-stream marker) and
+  // removes them from this writer. The column types are kept for the next
+  // stream. Must be called at a row boundary.
+  std::vector<uint8_t> WriteStreamAndReset();
+
+  uint32_t row_count() const { return row_count_; }
+
+ private:
+  struct Column;
+
+  Column& NextColumn();
+
+  std::vector<Column> columns_;
+  uint32_t next_column_ = 0;
+  uint32_t row_count_ = 0;
+};
+
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_RPC_ARROW_IPC_WRITER_H_
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/rpc/arrow_ipc_writer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+struct Message {
+  uint32_t metadata_size;
+  uint32_t metadata_offset;
+  uint32_t body_offset;
+};
+
+uint32_t ReadU32(const std::vector<uint8_t>& buf, size_t off) {
+  uint32_t v;
+  memcpy(&v, buf.data() + off, sizeof(v));
+  return v;
+}
+
+// Splits |stream| into its encapsulated messages, checking the framing (i.e.
+// continuation markers, 8-byte alignment and the end-of-stream marker). The
+// body length is not known without parsing the metadata so the body of a
+// message is assumed to extend until the next continuation marker.
+std::vector<Message> SplitMessages(const std::vector<uint8_t>& stream) {
+  std::vector<Message> messages;
+  size_t off = 0;
+  for (;;) {
+    EXPECT_LE(off + 8, stream.size());
+    if (off + 8 > stream.size())
+      return messages;
+    EXPECT_EQ(ReadU32(stream, off), 0xFFFFFFFFu);
+    uint32_t metadata_size = ReadU32(stream, off + 4);
+    if (metadata_size == 0) {
+      EXPECT_EQ(off + 8, stream.size());
+      return messages;
+    }
+    EXPECT_EQ((off + 8 + metadata_size) % 8, 0u);
+    Message msg{metadata_size, static_cast<uint32_t>(off + 8),
+                static_cast<uint32_t>(off + 8 + metadata_size)};
+    messages.push_back(msg);
+    off = msg.body_offset;
+    // Skip over the body (if any) to the next continuation marker.
+    while (off + 4 <= stream.size() && ReadU32(stream, off) != 0xFFFFFFFFu)
+      off += 8;
+  }
+}
+
+bool Contains(const std::vector<uint8_t>& haystack, const void* needle,
+              size_t size) {
+  const auto* n = static_cast<const uint8_t*>(needle);
+  return std::search(haystack.begin(), haystack.end(), n, n + size) !=
+         haystack.end();
+}
+
+TEST(ArrowIpcWriterTest, NoRows) {
+  ArrowIpcWriter writer({"a", "b"});
+  std::vector<uint8_t> stream = writer.WriteStreamAndReset();
+  EXPECT_EQ(stream.size() % 8, 0u);
+
+  // Schema and an empty record batch.
+  std::vector<Message> messages = SplitMessages(stream);
+  ASSERT_EQ(messages.size(), 2u);
+  EXPECT_TRUE(Contains(stream, "a", 1));
+}
+
+TEST(ArrowIpcWriterTest, NoColumns) {
+  ArrowIpcWriter writer({});
+  std::vector<uint8_t> stream = writer.WriteStreamAndReset();
+  EXPECT_EQ(SplitMessages(stream).size(), 2u);
+}
+
+TEST(ArrowIpcWriterTest, Int64Column) {
+  ArrowIpcWriter writer({"value"});
+  for (int64_t i = 0; i < 4; ++i)
+    writer.AppendLong(i * 1000000007);
+  ASSERT_EQ(writer.row_count(), 4u);
+
+  std::vector<uint8_t> stream = writer.WriteStreamAndReset();
+  ASSERT_EQ(SplitMessages(stream).size(), 2u);
+  EXPECT_TRUE(Contains(stream, "value", 5));
+
+  // Without any NULLs, the data buffer should be written out verbatim.
+  int64_t expected[] = {0, 1000000007, 2000000014, 3000000021};
+  EXPECT_TRUE(Contains(stream, expected, sizeof(expected)));
+  EXPECT_EQ(writer.row_count(), 0u);
+}
+
+TEST(ArrowIpcWriterTest, MixedNumericColumnIsFloat64) {
+  ArrowIpcWriter writer({"value"});
+  writer.AppendLong(1);
+  writer.AppendDouble(2.5);
+  writer.AppendNull();
+
+  std::vector<uint8_t> stream = writer.WriteStreamAndReset();
+  double expected[] = {1.0, 2.5};
+  EXPECT_TRUE(Contains(stream, expected, sizeof(expected)));
+
+  // The validity bitmap has the first two rows set.
+  uint8_t validity = 0x03;
+  EXPECT_TRUE(Contains(stream, &validity, 1));
+}
+
+TEST(ArrowIpcWriterTest, StringColumn) {
+  ArrowIpcWriter writer({"name", "id"});
+  writer.AppendString("foo", 3);
+  writer.AppendLong(1);
+  writer.AppendLong(42);
+  writer.AppendLong(2);
+  writer.AppendString("barbaz", 6);
+  writer.AppendLong(3);
+
+  std::vector<uint8_t> stream = writer.WriteStreamAndReset();
+  ASSERT_EQ(SplitMessages(stream).size(), 2u);
+
+  // Numbers in string columns are converted to their decimal representation.
+  int32_t offsets[] = {0, 3, 5, 11};
+  EXPECT_TRUE(Contains(stream, offsets, sizeof(offsets)));
+  EXPECT_TRUE(Contains(stream, "foo42barbaz", 11));
+
+  int64_t ids[] = {1, 2, 3};
+  EXPECT_TRUE(Contains(stream, ids, sizeof(ids)));
+}
+
+TEST(ArrowIpcWriterTest, ResetBetweenStreams) {
+  ArrowIpcWriter writer({"v"});
+  writer.AppendLong(0x1122334455667788);
+  std::vector<uint8_t> first = writer.WriteStreamAndReset();
+  int64_t expected = 0x1122334455667788;
+  EXPECT_TRUE(Contains(first, &expected, sizeof(expected)));
+
+  // Only the rows are removed from the writer.
+  writer.AppendLong(0x2233445566778899);
+  std::vector<uint8_t> second = writer.WriteStreamAndReset();
+  EXPECT_FALSE(Contains(second, &expected, sizeof(expected)));
+  expected = 0x2233445566778899;
+  EXPECT_TRUE(Contains(second, &expected, sizeof(expected)));
+}
+
+TEST(ArrowIpcWriterTest, TypesOnlyGetWiderAcrossStreams) {
+  ArrowIpcWriter writer({"v"});
+  writer.AppendLong(1);
+  std::vector<uint8_t> first = writer.WriteStreamAndReset();
+  int64_t value = 1;
+  EXPECT_TRUE(Contains(first, &value, sizeof(value)));
+
+  // A string widens the column to utf8...
+  writer.AppendString("x", 1);
+  writer.AppendLong(12345);
+  std::vector<uint8_t> second = writer.WriteStreamAndReset();
+  EXPECT_TRUE(Contains(second, "x12345", 6));
+
+  // ... and it stays utf8 even if the following streams only have integers
+  // (or doubles).
+  writer.AppendLong(67890);
+  writer.AppendDouble(0.5);
+  std::vector<uint8_t> third = writer.WriteStreamAndReset();
+  value = 67890;
+  EXPECT_FALSE(Contains(third, &value, sizeof(value)));
+  EXPECT_TRUE(Contains(third, "678900.5", 8));
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor
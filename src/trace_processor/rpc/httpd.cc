@@ -16,6 +16,8 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <functional>
 #include <initializer_list>
 #include <memory>
 #include <optional>
@@ -25,10 +27,13 @@
 
 #include "perfetto/base/logging.h"
 #include "perfetto/base/status.h"
+#include "perfetto/base/task_runner.h"
+#include "perfetto/ext/base/flat_hash_map.h"
 #include "perfetto/ext/base/http/http_server.h"
 #include "perfetto/ext/base/lock_free_task_runner.h"
 #include "perfetto/ext/base/string_utils.h"
 #include "perfetto/ext/base/string_view.h"
+#include "perfetto/ext/base/thread_task_runner.h"
 #include "perfetto/protozero/scattered_heap_buffer.h"
 #include "perfetto/trace_processor/trace_processor.h"
 #include "src/trace_processor/rpc/httpd.h"
@@ -50,24 +55,93 @@ const char* kDefaultAllowedCORSOrigins[] = {
     "http://127.0.0.1:10000",
 };
 
+constexpr char kSessionIdHeader[] = "x-perfetto-session-id";
+constexpr char kSessionWebsocketPrefix[] = "/websocket/";
+
+// A TraceProcessor instance which serves, on its own thread, the requests
+// for a given session id.
+//
+// Each session has its own SQLite connection: this relies on SQLite being
+// built with SQLITE_THREADSAFE != 0, so that connections can be used
+// concurrently from different threads.
+struct Session {
+  explicit Session(std::string _id)
+      : id(std::move(_id)),
+        thread(base::ThreadTaskRunner::CreateAndStart("TPSession")) {}
+
+  const std::string id;
+
+  // Created and accessed only on |thread|. Destroyed after |thread| has been
+  // joined.
+  std::unique_ptr<Rpc> rpc;
+
+  base::ThreadTaskRunner thread;
+};
+
 class Httpd : public base::HttpRequestHandler {
  public:
-  explicit Httpd(Rpc& rpc);
+  Httpd(Rpc& rpc,
+        base::TaskRunner* task_runner,
+        HttpdSessionOptions session_options);
   ~Httpd() override;
-  void Run(const std::string& listen_ip,
-           int port,
-           const std::vector<std::string>& additional_cors_origins);
+  void Start(const std::string& listen_ip,
+             int port,
+             const std::vector<std::string>& additional_cors_origins);
 
  private:
+  // Sends (part of) the reply to a request served by a session. Always runs
+  // on the main thread.
+  using ReplyFunction = std::function<void(base::HttpServerConnection*)>;
+
   // HttpRequestHandler implementation.
   void OnHttpRequest(const base::HttpRequest&) override;
   void OnWebsocketMessage(const base::WebsocketMessage&) override;
+  void OnHttpConnectionClosed(base::HttpServerConnection*) override;
+
+  void OnSessionHttpRequest(Session*, const base::HttpRequest&);
+  void OnSessionWebsocketMessage(Session*, const base::WebsocketMessage&);
+
+  // Returns nullptr if the session doesn't exist and |max_sessions| has been
+  // reached.
+  Session* GetOrCreateSession(const std::string& id);
+
+  // Frees the session |id| and closes the websockets bound to it. Destroying
+  // a session joins its thread, which can take a while if a query is in
+  // progress, so that happens on |session_reaper_| rather than on the main
+  // thread.
+  void CloseSession(const std::string& id);
+
+  // Can be called on any thread. The reply is sent on the main thread, which
+  // owns the connections, and is dropped if |conn| has been closed in the
+  // meantime.
+  void PostReply(base::HttpServerConnection* conn,
+                 uint64_t conn_id,
+                 ReplyFunction);
+  uint64_t GetConnectionId(base::HttpServerConnection*);
 
   static void ServeHelpPage(const base::HttpRequest&);
 
   Rpc& global_trace_processor_rpc_;
-  base::MaybeLockFreeTaskRunner task_runner_;
+  base::TaskRunner* const task_runner_;
   base::HttpServer http_srv_;
+
+  const HttpdSessionOptions session_options_;
+  base::FlatHashMap<std::string, std::unique_ptr<Session>> sessions_;
+
+  // Destroys the closed sessions. Created on the first CloseSession(). Declared
+  // after |sessions_| so that the sessions still being closed are destroyed
+  // (and their threads joined) first when the server is destroyed.
+  std::unique_ptr<base::ThreadTaskRunner> session_reaper_;
+
+  // Identifies the connections which sessions are replying to. Keyed by
+  // pointer, so the id is required to tell apart a closed connection from a
+  // new one which reused its memory.
+  base::FlatHashMap<base::HttpServerConnection*, uint64_t> conn_ids_;
+  uint64_t last_conn_id_ = 0;
+
+  // The session each websocket connected to /websocket/<id> is bound to.
+  base::FlatHashMap<base::HttpServerConnection*, std::string>
+      websocket_sessions_;
 };
 
 base::StringView Vec2Sv(const std::vector<uint8_t>& v) {
@@ -95,13 +169,48 @@ void SendRpcChunk(base::HttpServerConnection* conn,
   }
 }
 
-Httpd::Httpd(Rpc& rpc)
-    : global_trace_processor_rpc_(rpc), http_srv_(&task_runner_, this) {}
+bool IsSessionEndpoint(base::StringView uri) {
+  static constexpr const char* kSessionEndpoints[] = {
+      "/status",
+      "/rpc",
+      "/parse",
+      "/notify_eof",
+      "/restore_initial_tables",
+      "/query",
+      "/compute_metric",
+      "/trace_summary",
+      "/enable_metatrace",
+      "/disable_and_read_metatrace",
+  };
+  for (const char* endpoint : kSessionEndpoints) {
+    if (uri == endpoint)
+      return true;
+  }
+  return false;
+}
+
+// Sends a chunk of a reply which uses chunked transfer encoding.
+void SendHttpChunk(base::HttpServerConnection* conn,
+                   const void* data,
+                   size_t len) {
+  base::StackString<32> chunk_hdr("%zx\r\n", len);
+  conn->SendResponseBody(chunk_hdr.c_str(), chunk_hdr.len());
+  conn->SendResponseBody(data, len);
+  conn->SendResponseBody("\r\n", 2);
+}
+
+Httpd::Httpd(Rpc& rpc,
+             base::TaskRunner* task_runner,
+             HttpdSessionOptions session_options)
+    : global_trace_processor_rpc_(rpc),
+      task_runner_(task_runner),
+      http_srv_(task_runner_, this),
+      session_options_(std::move(session_options)) {}
 Httpd::~Httpd() = default;
 
-void Httpd::Run(const std::string& listen_ip,
-                int port,
-                const std::vector<std::string>& additional_cors_origins) {
+void Httpd::Start(const std::string& listen_ip,
+                  int port,
+                  const std::vector<std::string>& additional_cors_origins) {
   for (const auto& kDefaultAllowedCORSOrigin : kDefaultAllowedCORSOrigins) {
     http_srv_.AddAllowedOrigin(kDefaultAllowedCORSOrigin);
   }
@@ -114,7 +223,6 @@ void Httpd::Run(const std::string& listen_ip,
       "clicking on YES on the \"Trace Processor native acceleration\" dialog "
       "or through the Python API (see "
       "https://perfetto.dev/docs/analysis/trace-processor#python-api).");
-  task_runner_.Run();
 }
 
 void Httpd::OnHttpRequest(const base::HttpRequest& req) {
@@ -124,6 +232,37 @@ void Httpd::OnHttpRequest(const base::HttpRequest& req) {
     return ServeHelpPage(req);
   }
 
+  if (session_options_.max_sessions > 0) {
+    std::optional<base::StringView> session_hdr =
+        req.GetHeader(kSessionIdHeader);
+    std::string session_id;
+    if (session_hdr && !session_hdr->empty()) {
+      session_id = session_hdr->ToStdString();
+    } else if (req.is_websocket_handshake &&
+               req.uri.StartsWith(kSessionWebsocketPrefix)) {
+      session_id =
+          req.uri.substr(strlen(kSessionWebsocketPrefix)).ToStdString();
+    }
+    if (!session_id.empty()) {
+      if (req.uri == "/close_session") {
+        CloseSession(session_id);
+        return conn.SendResponse("200 OK");
+      }
+      if (!req.is_websocket_handshake && !IsSessionEndpoint(req.uri))
+        return conn.SendResponseAndClose("404 Not Found");
+      Session* session = GetOrCreateSession(session_id);
+      if (!session) {
+        return conn.SendResponseAndClose("503 Service Unavailable", {},
+                                         "Too many sessions");
+      }
+      if (req.is_websocket_handshake) {
+        websocket_sessions_.Insert(&conn, session_id);
+        return conn.UpgradeToWebsocket(req);
+      }
+      return OnSessionHttpRequest(session, req);
+    }
+  }
+
   static int last_req_id = 0;
   auto seq_hdr = req.GetHeader("x-seq-id").value_or(base::StringView());
   int seq_id = base::StringToInt32(seq_hdr.ToStdString()).value_or(0);
@@ -218,10 +357,7 @@ void Httpd::OnHttpRequest(const base::HttpRequest& req) {
     // rpc.Query() call. No further calls will be made once Query() returns.
     auto on_result_chunk = [&](const uint8_t* buf, size_t len, bool has_more) {
       PERFETTO_DLOG("Sending response chunk, len=%zu eof=%d", len, !has_more);
-      base::StackString<32> chunk_hdr("%zx\r\n", len);
-      conn.SendResponseBody(chunk_hdr.c_str(), chunk_hdr.len());
-      conn.SendResponseBody(buf, len);
-      conn.SendResponseBody("\r\n", 2);
+      SendHttpChunk(&conn, buf, len);
       if (!has_more)
         conn.SendResponseBody("0\r\n\r\n", 5);
     };
@@ -259,6 +395,16 @@ void Httpd::OnHttpRequest(const base::HttpRequest& req) {
 }
 
 void Httpd::OnWebsocketMessage(const base::WebsocketMessage& msg) {
+  if (std::string* session_id = websocket_sessions_.Find(msg.conn)) {
+    // Websockets are bound to the session which existed at handshake time: if
+    // it has been closed in the meantime, don't silently create a new one.
+    std::unique_ptr<Session>* session = sessions_.Find(*session_id);
+    if (!session) {
+      msg.conn->Close();
+      return;
+    }
+    return OnSessionWebsocketMessage(session->get(), msg);
+  }
   global_trace_processor_rpc_.SetRpcResponseFunction(
       [&](const void* data, uint32_t len) {
         SendRpcChunk(msg.conn, data, len);
@@ -268,17 +414,211 @@ void Httpd::OnWebsocketMessage(const base::WebsocketMessage& msg) {
   global_trace_processor_rpc_.SetRpcResponseFunction(nullptr);
 }
 
+void Httpd::OnHttpConnectionClosed(base::HttpServerConnection* conn) {
+  conn_ids_.Erase(conn);
+  websocket_sessions_.Erase(conn);
+}
+
+// Session requests are served asynchronously, while HttpServer requires the
+// response headers to be sent before OnHttpRequest() returns. So, all the
+// replies are sent with chunked transfer encoding: the headers are sent
+// straight away and the body is streamed, possibly in several chunks, once the
+// session thread has handled the request. As a consequence, clients must not
+// pipeline requests to a session over the same connection.
+void Httpd::OnSessionHttpRequest(Session* session,
+                                 const base::HttpRequest& req) {
+  base::HttpServerConnection* conn = req.conn;
+  conn->SendResponseHeaders("200 OK",
+                            {
+                                "Cache-Control: no-cache",
+                                "Content-Type: application/x-protobuf",
+                                "Transfer-Encoding: chunked",
+                            },
+                            base::HttpServerConnection::kOmitContentLength);
+
+  uint64_t conn_id = GetConnectionId(conn);
+  std::string uri = req.uri.ToStdString();
+  std::string body = req.body.ToStdString();
+  session->thread.PostTask([this, session, conn, conn_id, uri = std::move(uri),
+                            body = std::move(body)] {
+    Rpc& rpc = *session->rpc;
+    const auto* data = reinterpret_cast<const uint8_t*>(body.data());
+    auto send_chunk = [&](const void* buf, size_t len) {
+      std::string chunk(static_cast<const char*>(buf), len);
+      PostReply(conn, conn_id,
+                [chunk = std::move(chunk)](base::HttpServerConnection* c) {
+                  SendHttpChunk(c, chunk.data(), chunk.size());
+                });
+    };
+    auto send_vector = [&](const std::vector<uint8_t>& v) {
+      send_chunk(v.data(), v.size());
+    };
+
+    if (uri == "/status") {
+      send_vector(rpc.GetStatus());
+    } else if (uri == "/rpc") {
+      bool closed = false;
+      rpc.SetRpcResponseFunction([&](const void* buf, uint32_t len) {
+        if (buf == nullptr) {
+          // Unrecoverable RPC error case.
+          closed = true;
+          return PostReply(conn, conn_id, [](base::HttpServerConnection* c) {
+            SendRpcChunk(c, nullptr, 0);
+          });
+        }
+        send_chunk(buf, len);
+      });
+      rpc.OnRpcRequest(data, body.size());
+      rpc.SetRpcResponseFunction(nullptr);
+      if (closed)
+        return;
+    } else if (uri == "/parse") {
+      base::Status status = rpc.Parse(data, body.size());
+      protozero::HeapBuffered<protos::pbzero::AppendTraceDataResult> result;
+      if (!status.ok()) {
+        result->set_error(status.c_message());
+      }
+      send_vector(result.SerializeAsArray());
+    } else if (uri == "/notify_eof") {
+      rpc.NotifyEndOfFile();
+    } else if (uri == "/restore_initial_tables") {
+      rpc.RestoreInitialTables();
+    } else if (uri == "/query") {
+      rpc.Query(data, body.size(),
+                [&](const uint8_t* buf, size_t len, bool) {
+                  send_chunk(buf, len);
+                });
+    } else if (uri == "/compute_metric") {
+      send_vector(rpc.ComputeMetric(data, body.size()));
+    } else if (uri == "/trace_summary") {
+      send_vector(rpc.ComputeTraceSummary(data, body.size()));
+    } else if (uri == "/enable_metatrace") {
+      rpc.EnableMetatrace(data, body.size());
+    } else if (uri == "/disable_and_read_metatrace") {
+      send_vector(rpc.DisableAndReadMetatrace());
+    }
+
+    // Terminate the chunked stream.
+    PostReply(conn, conn_id, [](base::HttpServerConnection* c) {
+      c->SendResponseBody("0\r\n\r\n", 5);
+    });
+  });
+}
+
+void Httpd::OnSessionWebsocketMessage(Session* session,
+                                      const base::WebsocketMessage& msg) {
+  base::HttpServerConnection* conn = msg.conn;
+  uint64_t conn_id = GetConnectionId(conn);
+  std::string data = msg.data.ToStdString();
+  session->thread.PostTask([this, session, conn, conn_id,
+                            data = std::move(data)] {
+    Rpc& rpc = *session->rpc;
+    rpc.SetRpcResponseFunction([&](const void* buf, uint32_t len) {
+      std::string chunk;
+      if (buf)
+        chunk.assign(static_cast<const char*>(buf), len);
+      bool is_error = buf == nullptr;
+      PostReply(conn, conn_id,
+                [chunk = std::move(chunk),
+                 is_error](base::HttpServerConnection* c) {
+                  SendRpcChunk(c, is_error ? nullptr : chunk.data(),
+                               static_cast<uint32_t>(chunk.size()));
+                });
+    });
+    // OnRpcRequest() will call the function above one or more times.
+    rpc.OnRpcRequest(data.data(), data.size());
+    rpc.SetRpcResponseFunction(nullptr);
+  });
+}
+
+Session* Httpd::GetOrCreateSession(const std::string& id) {
+  if (std::unique_ptr<Session>* session = sessions_.Find(id))
+    return session->get();
+  if (sessions_.size() >= session_options_.max_sessions) {
+    PERFETTO_ELOG("[HTTP] Cannot create session %s: too many sessions",
+                  id.c_str());
+    return nullptr;
+  }
+  PERFETTO_ILOG("[HTTP] Creating session %s", id.c_str());
+  auto* session =
+      sessions_.Insert(id, std::make_unique<Session>(id)).first->get();
+  session->thread.PostTask(
+      [this, session] { session->rpc = session_options_.rpc_factory(); });
+  return session;
+}
+
+void Httpd::CloseSession(const std::string& id) {
+  std::unique_ptr<Session>* session_ptr = sessions_.Find(id);
+  if (!session_ptr)
+    return;
+  PERFETTO_ILOG("[HTTP] Closing session %s", id.c_str());
+  std::shared_ptr<Session> session(std::move(*session_ptr));
+  sessions_.Erase(id);
+
+  std::vector<base::HttpServerConnection*> websockets;
+  for (auto it = websocket_sessions_.GetIterator(); it; ++it) {
+    if (it.value() == id)
+      websockets.push_back(it.key());
+  }
+  // The websockets are unbound by OnHttpConnectionClosed(). Until then,
+  // OnWebsocketMessage() rejects their messages as the session is gone.
+  for (base::HttpServerConnection* conn : websockets)
+    conn->Close();
+
+  if (!session_reaper_) {
+    session_reaper_ = std::make_unique<base::ThreadTaskRunner>(
+        base::ThreadTaskRunner::CreateAndStart("TPSessionReaper"));
+  }
+  // If the reaper quits before running this task, the session is destroyed
+  // together with the task.
+  session_reaper_->PostTask([session = std::move(session)]() mutable {
+    session.reset();
+  });
+}
+
+void Httpd::PostReply(base::HttpServerConnection* conn,
+                      uint64_t conn_id,
+                      ReplyFunction reply) {
+  task_runner_->PostTask([this, conn, conn_id, reply = std::move(reply)] {
+    uint64_t* id = conn_ids_.Find(conn);
+    if (id && *id == conn_id)
+      reply(conn);
+  });
+}
+
+uint64_t Httpd::GetConnectionId(base::HttpServerConnection* conn) {
+  auto it_and_inserted = conn_ids_.Insert(conn, last_conn_id_ + 1);
+  if (it_and_inserted.second)
+    ++last_conn_id_;
+  return *it_and_inserted.first;
+}
+
 }  // namespace
 
 void RunHttpRPCServer(Rpc& rpc,
                       const std::string& listen_ip,
                       const std::string& port_number,
-                      const std::vector<std::string>& additional_cors_origins) {
-  Httpd srv(rpc);
+                      const std::vector<std::string>& additional_cors_origins,
+                      HttpdSessionOptions session_options) {
+  base::MaybeLockFreeTaskRunner task_runner;
+  Httpd srv(rpc, &task_runner, std::move(session_options));
   std::optional<int> port_opt = base::StringToInt32(port_number);
   std::string ip = listen_ip.empty() ? "localhost" : listen_ip;
   int port = port_opt.has_value() ? *port_opt : kBindPort;
-  srv.Run(ip, port, additional_cors_origins);
+  srv.Start(ip, port, additional_cors_origins);
+  task_runner.Run();
+}
+
+std::unique_ptr<base::HttpRequestHandler> StartHttpRPCServerForTesting(
+    Rpc& rpc,
+    base::TaskRunner* task_runner,
+    const std::string& listen_ip,
+    int port,
+    HttpdSessionOptions session_options) {
+  auto srv =
+      std::make_unique<Httpd>(rpc, task_runner, std::move(session_options));
+  srv->Start(listen_ip, port, {});
+  return srv;
 }
 
 void Httpd::ServeHelpPage(const base::HttpRequest& req) {
@@ -301,6 +641,13 @@ Example: perfetto.TraceProcessor(addr='localhost:9001')
 See https://perfetto.dev/docs/analysis/trace-processor#python-api for more.
 
 
+If the server was started with --http-max-sessions, several traces can be
+loaded and queried in parallel: requests with a "X-Perfetto-Session-Id: <id>"
+header (or websockets connecting to /websocket/<id>) are served by a separate
+trace processor instance for each <id>. POST /close_session with the header
+set frees the instance.
+
+
 For questions:
 https://perfetto.dev/docs/contributing/getting-started#community
 )";
@@ -17,15 +17,42 @@
 #ifndef SRC_TRACE_PROCESSOR_RPC_HTTPD_H_
 #define SRC_TRACE_PROCESSOR_RPC_HTTPD_H_
 
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
 #include "src/trace_processor/rpc/rpc.h"
 
-namespace perfetto::trace_processor {
+namespace perfetto {
+namespace base {
+class HttpRequestHandler;
+class TaskRunner;
+}  // namespace base
+
+namespace trace_processor {
 
 class TraceProcessor;
 
+// Options for serving several independent traces from the same HTTP RPC
+// server. Requests carrying a "X-Perfetto-Session-Id: <id>" header (or, for
+// websockets, connecting to /websocket/<id>) are routed to the session <id>,
+// which is created on first use. Each session owns its own Rpc instance (and
+// hence TraceProcessor) and serves its requests on a dedicated thread, so
+// different sessions can load and query traces in parallel. Requests without
+// a session id keep going to the Rpc instance passed to RunHttpRPCServer().
+// Sessions share nothing but the stdlib sources compiled into the binary: the
+// stdlib modules are parsed again by every session which INCLUDEs them.
+// SQLite must be built with SQLITE_THREADSAFE != 0 for sessions to be safe.
+struct HttpdSessionOptions {
+  // Maximum number of sessions alive at the same time. 0 disables sessions.
+  uint32_t max_sessions = 0;
+
+  // Creates the Rpc instance of a new session. Invoked on the thread of the
+  // session.
+  std::function<std::unique_ptr<Rpc>()> rpc_factory;
+};
+
 // Starts a RPC server that handles requests using protobuf-over-HTTP.
 // It takes control of the calling thread and does not return.
 //
@@ -35,11 +62,24 @@ class TraceProcessor;
 // `port_number` is the port which http server will listen on.
 // `additional_cors_origins` is a list of origins to allow for CORS requests, in
 // addition to the default origins defined in httpd.cc.
+// `session_options` configures the (optional) multi-session mode.
 void RunHttpRPCServer(Rpc& rpc,
                       const std::string& listen_ip,
                       const std::string& port_number,
-                      const std::vector<std::string>& additional_cors_origins);
+                      const std::vector<std::string>& additional_cors_origins,
+                      HttpdSessionOptions session_options = {});
+
+// Like RunHttpRPCServer() but serves on |task_runner| (which must run on the
+// calling thread) and returns straight away. The server is stopped by
+// destroying the returned object.
+std::unique_ptr<base::HttpRequestHandler> StartHttpRPCServerForTesting(
+    Rpc& rpc,
+    base::TaskRunner* task_runner,
+    const std::string& listen_ip,
+    int port,
+    HttpdSessionOptions session_options = {});
 
-}  // namespace perfetto::trace_processor
+}  // namespace trace_processor
+}  // namespace perfetto
 
 #endif  // SRC_TRACE_PROCESSOR_RPC_HTTPD_H_
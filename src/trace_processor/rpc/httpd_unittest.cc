@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/rpc/httpd.h"
+
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "perfetto/ext/base/http/http_server.h"
+#include "perfetto/ext/base/string_utils.h"
+#include "perfetto/ext/base/unix_socket.h"
+#include "perfetto/protozero/scattered_heap_buffer.h"
+#include "perfetto/trace_processor/trace_processor.h"
+#include "src/base/test/test_task_runner.h"
+#include "src/trace_processor/rpc/rpc.h"
+#include "test/gtest_and_gmock.h"
+
+#include "protos/perfetto/trace_processor/trace_processor.pbzero.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+using testing::HasSubstr;
+using testing::Not;
+
+constexpr int kTestPort = 5131;
+
+class HttpCli {
+ public:
+  explicit HttpCli(base::TestTaskRunner* ttr) : task_runner_(ttr) {
+    sock_ = base::UnixSocketRaw::CreateMayFail(base::SockFamily::kInet,
+                                               base::SockType::kStream);
+    sock_.SetBlocking(true);
+    sock_.Connect("127.0.0.1:" + std::to_string(kTestPort));
+  }
+
+  void SendHttpReq(std::initializer_list<std::string> headers,
+                   const std::string& body = "") {
+    for (const auto& header : headers)
+      sock_.SendStr(header + "\r\n");
+    sock_.SendStr("Content-Length: " + std::to_string(body.size()) + "\r\n");
+    sock_.SendStr("\r\n");
+    sock_.SendStr(body);
+  }
+
+  // Sends a /query request for |sql| to |session_id| without waiting for the
+  // reply.
+  void SendQuery(const std::string& session_id, const std::string& sql) {
+    protozero::HeapBuffered<protos::pbzero::QueryArgs> args;
+    args->set_sql_query(sql);
+    SendHttpReq({"POST /query HTTP/1.1",
+                 "X-Perfetto-Session-Id: " + session_id},
+                args.SerializeAsString());
+  }
+
+  // Receives until |suffix| is seen (or, if empty, until the connection is
+  // closed).
+  std::string RecvUntil(const std::string& suffix) {
+    static int n = 0;
+    auto checkpoint_name = "rx_" + std::to_string(n++);
+    auto checkpoint = task_runner_->CreateCheckpoint(checkpoint_name);
+    std::string rxbuf;
+    sock_.SetBlocking(false);
+    task_runner_->AddFileDescriptorWatch(sock_.watch_handle(), [&] {
+      char buf[1024]{};
+      auto rsize = PERFETTO_EINTR(sock_.Receive(buf, sizeof(buf)));
+      if (rsize < 0)
+        return;
+      rxbuf.append(buf, static_cast<size_t>(rsize));
+      if (rsize == 0 || (!suffix.empty() && base::EndsWith(rxbuf, suffix)))
+        checkpoint();
+    });
+    task_runner_->RunUntilCheckpoint(checkpoint_name);
+    task_runner_->RemoveFileDescriptorWatch(sock_.watch_handle());
+    sock_.SetBlocking(true);
+    return rxbuf;
+  }
+
+  // Receives the whole chunked reply to a session request.
+  std::string RecvChunkedReply() { return RecvUntil("\r\n0\r\n\r\n"); }
+
+  std::string Query(const std::string& session_id, const std::string& sql) {
+    SendQuery(session_id, sql);
+    return RecvChunkedReply();
+  }
+
+  base::UnixSocketRaw& sock() { return sock_; }
+
+ private:
+  base::TestTaskRunner* task_runner_;
+  base::UnixSocketRaw sock_;
+};
+
+class HttpdSessionsTest : public ::testing::Test {
+ public:
+  HttpdSessionsTest() {
+    HttpdSessionOptions options;
+    options.max_sessions = 2;
+    options.rpc_factory = [] { return std::make_unique<Rpc>(); };
+    srv_ = StartHttpRPCServerForTesting(global_rpc_, &task_runner_,
+                                        "localhost", kTestPort, options);
+  }
+
+  void SetUp() override {
+    if (!sqlite3_threadsafe())
+      GTEST_SKIP() << "Sessions need SQLite built with SQLITE_THREADSAFE=2";
+  }
+
+  void CloseSession(const std::string& session_id) {
+    HttpCli cli(&task_runner_);
+    cli.SendHttpReq(
+        {"POST /close_session HTTP/1.1",
+         "X-Perfetto-Session-Id: " + session_id, "Connection: close"});
+    EXPECT_THAT(cli.RecvUntil(""), HasSubstr("200 OK"));
+  }
+
+ protected:
+  base::TestTaskRunner task_runner_;
+  Rpc global_rpc_;
+  std::unique_ptr<base::HttpRequestHandler> srv_;
+};
+
+TEST_F(HttpdSessionsTest, ConcurrentSessionsAreIsolated) {
+  HttpCli cli_a(&task_runner_);
+  HttpCli cli_b(&task_runner_);
+
+  // Send both requests before reading either reply, so the two sessions are
+  // served at the same time.
+  cli_a.SendQuery("a", "CREATE PERFETTO TABLE t AS SELECT 1 AS marker_a");
+  cli_b.SendQuery("b", "CREATE PERFETTO TABLE t AS SELECT 2 AS marker_b");
+  cli_a.RecvChunkedReply();
+  cli_b.RecvChunkedReply();
+
+  std::string reply_a = cli_a.Query("a", "SELECT * FROM t");
+  EXPECT_THAT(reply_a, HasSubstr("marker_a"));
+  EXPECT_THAT(reply_a, Not(HasSubstr("marker_b")));
+
+  std::string reply_b = cli_b.Query("b", "SELECT * FROM t");
+  EXPECT_THAT(reply_b, HasSubstr("marker_b"));
+  EXPECT_THAT(reply_b, Not(HasSubstr("marker_a")));
+
+  // The sessions are independent from the default instance.
+  auto it = global_rpc_.trace_processor()->ExecuteQuery("SELECT * FROM t");
+  EXPECT_FALSE(it.Next());
+  EXPECT_FALSE(it.Status().ok());
+
+  // A third session exceeds |max_sessions|.
+  HttpCli cli_c(&task_runner_);
+  cli_c.SendQuery("c", "SELECT 1");
+  EXPECT_THAT(cli_c.RecvUntil(""), HasSubstr("503 Service Unavailable"));
+}
+
+TEST_F(HttpdSessionsTest, ReuseAfterClose) {
+  HttpCli cli(&task_runner_);
+  cli.Query("a", "CREATE PERFETTO TABLE t AS SELECT 1 AS marker_a");
+  EXPECT_THAT(cli.Query("a", "SELECT * FROM t"), HasSubstr("marker_a"));
+
+  CloseSession("a");
+
+  // Requests with the id of a closed session get a brand new session.
+  std::string reply = cli.Query("a", "SELECT * FROM t");
+  EXPECT_THAT(reply, Not(HasSubstr("marker_a")));
+  EXPECT_THAT(reply, HasSubstr("no such table"));
+}
+
+TEST_F(HttpdSessionsTest, WebsocketClosedWithSession) {
+  HttpCli ws(&task_runner_);
+  ws.SendHttpReq({
+      "GET /websocket/a HTTP/1.1",
+      "Origin: http://localhost:10000",
+      "Connection: upgrade",
+      "Upgrade: websocket",
+      "Sec-WebSocket-Version: 13",
+      "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==",
+  });
+  EXPECT_THAT(ws.RecvUntil("\r\n\r\n"), HasSubstr("101 Switching Protocols"));
+
+  HttpCli cli_b(&task_runner_);
+  cli_b.Query("b", "SELECT 1");
+
+  // Closing the session drops its websocket rather than leaving it bound to
+  // a session which would be recreated by its next message.
+  CloseSession("a");
+  ws.RecvUntil("");
+
+  // "a" was not recreated: there is room for another session.
+  HttpCli cli_c(&task_runner_);
+  EXPECT_THAT(cli_c.Query("c", "SELECT 1"), HasSubstr("200 OK"));
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor
@@ -16,12 +16,22 @@
 
 #include "perfetto/ext/trace_processor/rpc/query_result_serializer.h"
 
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "perfetto/protozero/packed_repeated_fields.h"
 #include "perfetto/protozero/proto_utils.h"
 #include "perfetto/protozero/scattered_heap_buffer.h"
+#include "src/trace_processor/containers/null_term_string_view.h"
+#include "src/trace_processor/core/dataframe/cursor.h"
 #include "src/trace_processor/iterator_impl.h"
+#include "src/trace_processor/rpc/arrow_ipc_writer.h"
 
 #include "protos/perfetto/trace_processor/trace_processor.pbzero.h"
 
@@ -43,10 +53,169 @@ uint8_t MakeLenDelimTag(uint32_t field_num) {
   return static_cast<uint8_t>(tag);
 }
 
+// The cells of the batch being serialized. See SerializeBatch() for how the
+// different types of cells are laid out.
+struct BatchCells {
+  BatchCells(uint32_t cells_per_batch, protozero::Message* _strings)
+      : cell_types(cells_per_batch), strings(_strings) {}
+
+  void AppendNull() { cell_types[cell_idx++] = BatchProto::CELL_NULL; }
+
+  void AppendLong(int64_t value) {
+    cell_types[cell_idx++] = BatchProto::CELL_VARINT;
+    varints.Append(value);
+    approx_batch_size += 4;  // Just a guess, doesn't need to be accurate.
+  }
+
+  void AppendDouble(double value) {
+    cell_types[cell_idx++] = BatchProto::CELL_FLOAT64;
+    approx_batch_size += sizeof(double);
+    doubles.Append(value);
+  }
+
+  // |str| must be NUL terminated and |len| must not include the terminator.
+  void AppendString(const char* str, uint32_t len) {
+    // Append the string to the one |string_cells| proto field, just use
+    // \0 to separate each string. We are deliberately NOT emitting one
+    // proto repeated field for each string. Doing so significantly slows
+    // down parsing on the JS side (go/postmessage-benchmark).
+    cell_types[cell_idx++] = BatchProto::CELL_STRING;
+    uint32_t len_with_nul = len + 1;
+    strings->AppendRawProtoBytes(str, len_with_nul);
+    approx_batch_size += len_with_nul + 4;  // 4 is a guess on the preamble.
+  }
+
+  void AppendBlob(const uint8_t* src, uint32_t len) {
+    // Each blob is stored as its own repeated proto field, unlike strings.
+    // Blobs don't incur in text-decoding overhead (and are also rare).
+    cell_types[cell_idx++] = BatchProto::CELL_BLOB;
+    uint8_t preamble[16];
+    uint8_t* preamble_end = &preamble[0];
+    *(preamble_end++) = MakeLenDelimTag(BatchProto::kBlobCellsFieldNumber);
+    preamble_end = pu::WriteVarInt(len, preamble_end);
+    blobs.insert(blobs.end(), preamble, preamble_end);
+    blobs.insert(blobs.end(), src, src + len);
+    approx_batch_size += len + 4;  // 4 is a guess on the preamble size.
+  }
+
+  std::vector<uint8_t> cell_types;
+  protozero::Message* strings;
+
+  // Varints and doubles are written on stack-based storage and appended later.
+  protozero::PackedVarInt varints;
+  protozero::PackedFixedSizeInt<double> doubles;
+
+  // We write blobs on a temporary heap buffer and append it at the end. Blobs
+  // are extremely rare, trying to avoid copies is not worth the complexity.
+  std::vector<uint8_t> blobs;
+
+  uint32_t cell_idx = 0;
+
+  // This keeps track of the overall size of the batch. It is used to decide if
+  // we need to prematurely end the batch, even if the batch_split_threshold_
+  // is not reached. This is to guard against the degenerate case of appending
+  // a lot of very large strings and ending up with an enormous batch.
+  uint32_t approx_batch_size = 16;
+};
+
+// Like BatchCells but for batches in the Arrow IPC format.
+struct ArrowCells {
+  explicit ArrowCells(ArrowIpcWriter* _writer) : writer(_writer) {}
+
+  void AppendNull() {
+    ++cell_idx;
+    writer->AppendNull();
+  }
+  void AppendLong(int64_t value) {
+    ++cell_idx;
+    writer->AppendLong(value);
+    approx_batch_size += sizeof(int64_t);
+  }
+  void AppendDouble(double value) {
+    ++cell_idx;
+    writer->AppendDouble(value);
+    approx_batch_size += sizeof(double);
+  }
+  void AppendString(const char* str, uint32_t len) {
+    ++cell_idx;
+    writer->AppendString(str, len);
+    approx_batch_size += len + sizeof(int32_t);
+  }
+  void AppendBlob(const uint8_t* src, uint32_t len) {
+    ++cell_idx;
+    writer->AppendBlob(src, len);
+    approx_batch_size += len + sizeof(int32_t);
+  }
+
+  ArrowIpcWriter* writer;
+  uint32_t cell_idx = 0;
+  uint32_t approx_batch_size = 16;
+};
+
+// Appends the cells read from a dataframe cursor. Values are converted the
+// same way as when DataframeModule hands them to SQLite so that the output
+// doesn't depend on which path a row went through.
+template <typename Cells>
+struct DataframeCellWriter : dataframe::CellCallback {
+  void OnCell(int64_t v) { cells->AppendLong(v); }
+  void OnCell(double v) {
+    // SQLite turns NaN doubles into NULLs.
+    if (std::isnan(v)) {
+      cells->AppendNull();
+    } else {
+      cells->AppendDouble(v);
+    }
+  }
+  void OnCell(NullTermStringView v) {
+    if (v.data()) {
+      cells->AppendString(v.data(), static_cast<uint32_t>(v.size()));
+    } else {
+      cells->AppendNull();
+    }
+  }
+  void OnCell(std::nullptr_t) { cells->AppendNull(); }
+  void OnCell(uint32_t v) { cells->AppendLong(v); }
+  void OnCell(int32_t v) { cells->AppendLong(v); }
+  Cells* cells;
+};
+
+// Appends a padding field to |batch| so that |off| becomes 8-byte aligned.
+// |off| is the offset, in the output stream, which the next byte written to
+// |batch| would have without padding.
+void AppendAlignmentPadding(BatchProto* batch, uint32_t off) {
+  // The padding needs to be > 1 Byte because of proto encoding.
+  const uint32_t aligned_off = (off + 7) & ~7u;
+  uint32_t padding = aligned_off - off;
+  padding = padding == 1 ? 9 : padding;
+  if (padding > 0) {
+    uint8_t pad_buf[10];
+    uint8_t* pad = pad_buf;
+    *(pad++) = pu::MakeTagVarInt(kPaddingFieldId);
+    for (uint32_t i = 0; i < padding - 2; i++)
+      *(pad++) = 0x80;
+    *(pad++) = 0;
+    batch->AppendRawProtoBytes(pad_buf, static_cast<size_t>(pad - pad_buf));
+  }
+}
+
 }  // namespace
 
-QueryResultSerializer::QueryResultSerializer(Iterator iter)
-    : iter_(iter.take_impl()), num_cols_(iter_->ColumnCount()) {}
+struct QueryResultSerializer::DataframeScan {
+  IteratorImpl::DataframeScan scan;
+};
+
+QueryResultSerializer::QueryResultSerializer(Iterator iter,
+                                             ResultFormat result_format)
+    : iter_(iter.take_impl()),
+      num_cols_(iter_->ColumnCount()),
+      result_format_(result_format) {
+  if (result_format_ == ResultFormat::kArrowIpc) {
+    std::vector<std::string> column_names;
+    for (uint32_t c = 0; c < num_cols_; c++)
+      column_names.push_back(iter_->GetColumnName(c));
+    arrow_writer_ = std::make_unique<ArrowIpcWriter>(std::move(column_names));
+  }
+}
 
 QueryResultSerializer::~QueryResultSerializer() = default;
 
@@ -76,7 +245,95 @@ bool QueryResultSerializer::Serialize(protos::pbzero::QueryResult* res) {
   return !eof_reached_;
 }
 
+template <typename Cells>
+bool QueryResultSerializer::SerializeRows(Cells* cells) {
+  // A row pending at the start of a batch means that the query returned more
+  // than a batch worth of rows. If the query is a plain scan of a dataframe
+  // table, read the remaining rows straight from the dataframe: this skips
+  // SQLite's bytecode interpreter and the copies into its registers. This is
+  // not tried before because checking whether a query is a plain scan means
+  // parsing it and resolving the table it reads, which small queries should
+  // not pay for.
+  if (col_ == 0 && !did_try_dataframe_scan_) {
+    did_try_dataframe_scan_ = true;
+    if (auto scan = iter_->TakeDataframeScan(); scan) {
+      dataframe_scan_.reset(new DataframeScan{std::move(*scan)});
+    }
+  }
+
+  bool batch_full = false;
+  if (dataframe_scan_) {
+    // The cursor always points at the next row to write.
+    auto* cursor = dataframe_scan_->scan.cursor;
+    const auto& columns = dataframe_scan_->scan.columns;
+    DataframeCellWriter<Cells> cell_writer{{}, cells};
+    for (; !cursor->Eof(); cursor->Next()) {
+      if (cells->cell_idx + num_cols_ > cells_per_batch_ ||
+          cells->approx_batch_size > batch_split_threshold_) {
+        batch_full = true;
+        break;
+      }
+      for (uint32_t col : columns) {
+        cursor->Cell(col, cell_writer);
+      }
+    }
+  } else {
+    for (;; ++col_) {
+      // This branch is hit before starting each row. Note that iter_->Next()
+      // must be called before iterating on a row. col_ is initialized at
+      // MAX_INT in the constructor.
+      if (col_ >= num_cols_) {
+        col_ = 0;
+        // If num_cols_ == 0 and the query didn't return any result (e.g.
+        // CREATE TABLE) we should exit at this point. We still need to advance
+        // the iterator via Next() otherwise the statement will have no effect.
+        if (!iter_->Next())
+          break;  // EOF or error.
+
+        PERFETTO_DCHECK(num_cols_ > 0);
+        // We need to guarantee that a batch contains whole rows. Before moving
+        // to the next row, make sure that: (i) there is space for all the
+        // columns; (ii) the batch didn't grow too much.
+        if (cells->cell_idx + num_cols_ > cells_per_batch_ ||
+            cells->approx_batch_size > batch_split_threshold_) {
+          batch_full = true;
+          break;
+        }
+      }
+
+      auto value = iter_->Get(col_);
+      switch (value.type) {
+        case SqlValue::Type::kNull:
+          cells->AppendNull();
+          break;
+        case SqlValue::Type::kLong:
+          cells->AppendLong(value.long_value);
+          break;
+        case SqlValue::Type::kDouble:
+          cells->AppendDouble(value.double_value);
+          break;
+        case SqlValue::Type::kString:
+          cells->AppendString(
+              value.string_value,
+              static_cast<uint32_t>(strlen(value.string_value)));
+          break;
+        case SqlValue::Type::kBytes:
+          cells->AppendBlob(static_cast<const uint8_t*>(value.bytes_value),
+                           static_cast<uint32_t>(value.bytes_count));
+          break;
+      }
+    }  // for (cell)
+  }
+
+  return batch_full;
+}
+
 void QueryResultSerializer::SerializeBatch(protos::pbzero::QueryResult* res) {
+  if (result_format_ == ResultFormat::kArrowIpc) {
+    SerializeArrowBatch(res);
+    return;
+  }
+
   // The buffer is filled in this way:
   // - Append all the strings as we iterate through the results. The rationale
   //   is that strings are typically the largest part of the result and we want
@@ -91,122 +348,30 @@ void QueryResultSerializer::SerializeBatch(protos::pbzero::QueryResult* res) {
   auto* batch = res->add_batch();
 
   // Start the |string_cells|.
-  auto* strings = batch->BeginNestedMessage<protozero::Message>(
-      BatchProto::kStringCellsFieldNumber);
-
-  // This keeps track of the overall size of the batch. It is used to decide if
-  // we need to prematurely end the batch, even if the batch_split_threshold_ is
-  // not reached. This is to guard against the degenerate case of appending a
-  // lot of very large strings and ending up with an enormous batch.
-  uint32_t approx_batch_size = 16;
-
-  std::vector<uint8_t> cell_types(cells_per_batch_);
-
-  // Varints and doubles are written on stack-based storage and appended later.
-  protozero::PackedVarInt varints;
-  protozero::PackedFixedSizeInt<double> doubles;
-
-  // We write blobs on a temporary heap buffer and append it at the end. Blobs
-  // are extremely rare, trying to avoid copies is not worth the complexity.
-  std::vector<uint8_t> blobs;
-
-  uint32_t cell_idx = 0;
-  bool batch_full = false;
-
-  for (;; ++cell_idx, ++col_) {
-    // This branch is hit before starting each row. Note that iter_->Next() must
-    // be called before iterating on a row. col_ is initialized at MAX_INT in
-    // the constructor.
-    if (col_ >= num_cols_) {
-      col_ = 0;
-      // If num_cols_ == 0 and the query didn't return any result (e.g. CREATE
-      // TABLE) we should exit at this point. We still need to advance the
-      // iterator via Next() otherwise the statement will have no effect.
-      if (!iter_->Next())
-        break;  // EOF or error.
-
-      PERFETTO_DCHECK(num_cols_ > 0);
-      // We need to guarantee that a batch contains whole rows. Before moving to
-      // the next row, make sure that: (i) there is space for all the columns;
-      // (ii) the batch didn't grow too much.
-      if (cell_idx + num_cols_ > cells_per_batch_ ||
-          approx_batch_size > batch_split_threshold_) {
-        batch_full = true;
-        break;
-      }
-    }
-
-    auto value = iter_->Get(col_);
-    uint8_t cell_type = BatchProto::CELL_INVALID;
-    switch (value.type) {
-      case SqlValue::Type::kNull: {
-        cell_type = BatchProto::CELL_NULL;
-        break;
-      }
-      case SqlValue::Type::kLong: {
-        cell_type = BatchProto::CELL_VARINT;
-        varints.Append(value.long_value);
-        approx_batch_size += 4;  // Just a guess, doesn't need to be accurate.
-        break;
-      }
-      case SqlValue::Type::kDouble: {
-        cell_type = BatchProto::CELL_FLOAT64;
-        approx_batch_size += sizeof(double);
-        doubles.Append(value.double_value);
-        break;
-      }
-      case SqlValue::Type::kString: {
-        // Append the string to the one |string_cells| proto field, just use
-        // \0 to separate each string. We are deliberately NOT emitting one
-        // proto repeated field for each string. Doing so significantly slows
-        // down parsing on the JS side (go/postmessage-benchmark).
-        cell_type = BatchProto::CELL_STRING;
-        uint32_t len_with_nul =
-            static_cast<uint32_t>(strlen(value.string_value)) + 1;
-        const char* str_begin = value.string_value;
-        strings->AppendRawProtoBytes(str_begin, len_with_nul);
-        approx_batch_size += len_with_nul + 4;  // 4 is a guess on the preamble.
-        break;
-      }
-      case SqlValue::Type::kBytes: {
-        // Each blob is stored as its own repeated proto field, unlike strings.
-        // Blobs don't incur in text-decoding overhead (and are also rare).
-        cell_type = BatchProto::CELL_BLOB;
-        auto* src = static_cast<const uint8_t*>(value.bytes_value);
-        uint32_t len = static_cast<uint32_t>(value.bytes_count);
-        uint8_t preamble[16];
-        uint8_t* preamble_end = &preamble[0];
-        *(preamble_end++) = MakeLenDelimTag(BatchProto::kBlobCellsFieldNumber);
-        preamble_end = pu::WriteVarInt(len, preamble_end);
-        blobs.insert(blobs.end(), preamble, preamble_end);
-        blobs.insert(blobs.end(), src, src + len);
-        approx_batch_size += len + 4;  // 4 is a guess on the preamble size.
-        break;
-      }
-    }
+  BatchCells cells(cells_per_batch_,
+                   batch->BeginNestedMessage<protozero::Message>(
+                       BatchProto::kStringCellsFieldNumber));
 
-    PERFETTO_DCHECK(cell_type != BatchProto::CELL_INVALID);
-    cell_types[cell_idx] = cell_type;
-  }  // for (cell)
+  bool batch_full = SerializeRows(&cells);
 
   // Backfill the string size.
-  strings->Finalize();
-  strings = nullptr;
+  cells.strings->Finalize();
+  cells.strings = nullptr;
 
   // Write the cells headers (1 byte per cell).
-  if (cell_idx > 0) {
-    batch->AppendBytes(BatchProto::kCellsFieldNumber, cell_types.data(),
-                       cell_idx);
+  if (cells.cell_idx > 0) {
+    batch->AppendBytes(BatchProto::kCellsFieldNumber, cells.cell_types.data(),
+                       cells.cell_idx);
   }
 
   // Append the |varint_cells|, copying over the packed varint buffer.
-  if (varints.size())
-    batch->set_varint_cells(varints);
+  if (cells.varints.size())
+    batch->set_varint_cells(cells.varints);
 
   // Append the |float64_cells|, copying over the packed fixed64 buffer. This is
   // appended at a 64-bit aligned offset, so that JS can access these by overlay
   // a TypedArray, without extra copies.
-  const uint32_t doubles_size = static_cast<uint32_t>(doubles.size());
+  const uint32_t doubles_size = static_cast<uint32_t>(cells.doubles.size());
   if (doubles_size > 0) {
     uint8_t preamble[16];
     uint8_t* preamble_end = &preamble[0];
@@ -215,29 +380,16 @@ void QueryResultSerializer::SerializeBatch(protos::pbzero::QueryResult* res) {
     uint32_t preamble_size = static_cast<uint32_t>(preamble_end - &preamble[0]);
 
     // The byte after the preamble must start at a 64bit-aligned offset.
-    // The padding needs to be > 1 Byte because of proto encoding.
-    const uint32_t off =
-        static_cast<uint32_t>(writer.written() + preamble_size);
-    const uint32_t aligned_off = (off + 7) & ~7u;
-    uint32_t padding = aligned_off - off;
-    padding = padding == 1 ? 9 : padding;
-    if (padding > 0) {
-      uint8_t pad_buf[10];
-      uint8_t* pad = pad_buf;
-      *(pad++) = pu::MakeTagVarInt(kPaddingFieldId);
-      for (uint32_t i = 0; i < padding - 2; i++)
-        *(pad++) = 0x80;
-      *(pad++) = 0;
-      batch->AppendRawProtoBytes(pad_buf, static_cast<size_t>(pad - pad_buf));
-    }
+    AppendAlignmentPadding(
+        batch, static_cast<uint32_t>(writer.written() + preamble_size));
     batch->AppendRawProtoBytes(preamble, preamble_size);
     PERFETTO_CHECK(writer.written() % 8 == 0);
-    batch->AppendRawProtoBytes(doubles.data(), doubles_size);
+    batch->AppendRawProtoBytes(cells.doubles.data(), doubles_size);
   }  // if (doubles_size > 0)
 
   // Append the blobs.
-  if (blobs.size() > 0) {
-    batch->AppendRawProtoBytes(blobs.data(), blobs.size());
+  if (cells.blobs.size() > 0) {
+    batch->AppendRawProtoBytes(cells.blobs.data(), cells.blobs.size());
   }
 
   // If this is the last batch, write the EOF field.
@@ -250,6 +402,36 @@ void QueryResultSerializer::SerializeBatch(protos::pbzero::QueryResult* res) {
   batch->Finalize();
 }
 
+void QueryResultSerializer::SerializeArrowBatch(
+    protos::pbzero::QueryResult* res) {
+  const auto& writer = *res->stream_writer();
+  auto* batch = res->add_batch();
+
+  ArrowCells cells(arrow_writer_.get());
+  bool batch_full = SerializeRows(&cells);
+  std::vector<uint8_t> stream = arrow_writer_->WriteStreamAndReset();
+
+  // Like |float64_cells|, the stream starts at a 64bit-aligned offset so that
+  // clients can use the Arrow buffers in place.
+  uint8_t preamble[16];
+  uint8_t* preamble_end = &preamble[0];
+  *(preamble_end++) = MakeLenDelimTag(BatchProto::kArrowIpcStreamFieldNumber);
+  preamble_end =
+      pu::WriteVarInt(static_cast<uint32_t>(stream.size()), preamble_end);
+  uint32_t preamble_size = static_cast<uint32_t>(preamble_end - &preamble[0]);
+  AppendAlignmentPadding(
+      batch, static_cast<uint32_t>(writer.written() + preamble_size));
+  batch->AppendRawProtoBytes(preamble, preamble_size);
+  PERFETTO_CHECK(writer.written() % 8 == 0);
+  batch->AppendRawProtoBytes(stream.data(), stream.size());
+
+  if (!batch_full) {
+    eof_reached_ = true;
+    batch->set_is_last_batch(true);
+  }
+  batch->Finalize();
+}
+
 void QueryResultSerializer::MaybeSerializeError(
     protos::pbzero::QueryResult* res) {
   if (iter_->Status().ok())
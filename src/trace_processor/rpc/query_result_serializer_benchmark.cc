@@ -52,6 +52,34 @@ void RunQueryChecked(TraceProcessor* tp, const std::string& query) {
   PERFETTO_CHECK(iter.Status().ok());
 }
 
+// Serializes |query| on a dataframe table with mixed column types.
+void BenchmarkDataframeTable(benchmark::State& state,
+                             const std::string& query) {
+  auto tp = TraceProcessor::CreateInstance(Config());
+  RunQueryChecked(tp.get(), R"(
+    create perfetto table t as
+    select
+      ts,
+      dur,
+      dur * 1.5 as value,
+      'slice_' || (ts % 1000) as name
+    from __intrinsic_window(0, 100000, 1);
+  )");
+  VectorType buf;
+  for (auto _ : state) {
+    auto iter = tp->ExecuteQuery(query);
+    QueryResultSerializer serializer(std::move(iter));
+    serializer.set_batch_size_for_testing(
+        static_cast<uint32_t>(state.range(0)),
+        static_cast<uint32_t>(state.range(1)));
+    while (serializer.Serialize(&buf)) {
+    }
+    benchmark::DoNotOptimize(buf.data());
+    buf.clear();
+  }
+  benchmark::ClobberMemory();
+}
+
 }  // namespace
 
 static void BM_QueryResultSerializer_Mixed(benchmark::State& state) {
@@ -96,5 +124,19 @@ static void BM_QueryResultSerializer_Strings(benchmark::State& state) {
   benchmark::ClobberMemory();
 }
 
+// A plain scan of a dataframe: all but the first batch are read directly from
+// the dataframe.
+static void BM_QueryResultSerializer_DataframeScan(benchmark::State& state) {
+  BenchmarkDataframeTable(state, "select ts, dur, value, name from t");
+}
+
+// The same as above but the expression on |ts| forces all the rows to go
+// through SQLite.
+static void BM_QueryResultSerializer_DataframeNoScan(benchmark::State& state) {
+  BenchmarkDataframeTable(state, "select ts + 0, dur, value, name from t");
+}
+
 BENCHMARK(BM_QueryResultSerializer_Mixed)->Apply(BenchmarkArgs);
 BENCHMARK(BM_QueryResultSerializer_Strings)->Apply(BenchmarkArgs);
+BENCHMARK(BM_QueryResultSerializer_DataframeScan)->Apply(BenchmarkArgs);
+BENCHMARK(BM_QueryResultSerializer_DataframeNoScan)->Apply(BenchmarkArgs);
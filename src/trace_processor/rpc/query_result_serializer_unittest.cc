@@ -401,6 +401,119 @@ TEST(QueryResultSerializerTest, RandomSizes) {
   }
 }
 
+// Rows after the first batch of a plain dataframe scan are read directly from
+// the dataframe: check that they are serialized the same way as if they went
+// through SQLite.
+TEST(QueryResultSerializerTest, DataframeScanMultipleBatches) {
+  auto tp = TraceProcessor::CreateInstance(trace_processor::Config());
+  RunQueryChecked(tp.get(), R"(
+    create perfetto table tab as
+    with recursive seq(x) as (
+      select 0
+      union all
+      select x + 1 from seq where x < 999
+    )
+    select
+      x as id,
+      iif(x % 3 = 0, null, x * 1.5) as d,
+      iif(x % 4 = 0, null, 'str_' || x) as s
+    from seq
+  )");
+  RunQueryChecked(tp.get(), R"(
+    create perfetto function tab_fn()
+    returns table(s STRING, id LONG, d DOUBLE) as
+    select s, id, d from tab
+  )");
+  RunQueryChecked(tp.get(),
+                  "create perfetto view tab_view as select * from tab");
+
+  struct TestCase {
+    const char* query;
+    int64_t first_id;
+    bool reads_dataframe;
+  };
+  for (const TestCase& test : {
+           TestCase{"select s, id, d from tab", 0, true},
+           TestCase{"select s, id, d from tab where id > 500", 501, true},
+           TestCase{"SELECT s, id AS id, d FROM tab "
+                    "WHERE id > 500 ORDER BY id;",
+                    501, true},
+           TestCase{"select s, id, d from tab_view where id >= 0", 0, true},
+           // SQLite does not pass OR constraints to the table.
+           TestCase{"select s, id, d from tab where id > 500 or id > 600", 501,
+                    false},
+           // Not a plain scan: always goes through SQLite.
+           TestCase{"select s, id + 0 as id, d from tab", 0, false},
+           // A plain scan of a table function whose body scans a dataframe:
+           // the rows must not be read from the cursor of the body.
+           TestCase{"select s, id, d from tab_fn()", 0, false},
+       }) {
+    auto iter = tp->ExecuteQuery(test.query);
+    QueryResultSerializer ser(std::move(iter));
+    ser.set_batch_size_for_testing(30, 4096);
+
+    TestDeserializer deser;
+    deser.SerializeAndDeserialize(&ser);
+    ASSERT_EQ(deser.error, "");
+    ASSERT_EQ(ser.is_reading_dataframe_for_testing(), test.reads_dataframe)
+        << test.query;
+    ASSERT_THAT(deser.columns, ElementsAre("s", "id", "d"));
+
+    std::vector<std::string> strings;
+    strings.reserve(1000);
+    std::vector<SqlValue> expected;
+    for (int64_t i = test.first_id; i < 1000; ++i) {
+      strings.push_back("str_" + std::to_string(i));
+      expected.push_back(i % 4 == 0 ? SqlValue()
+                                    : SqlValue::String(strings.back().c_str()));
+      expected.push_back(SqlValue::Long(i));
+      expected.push_back(i % 3 == 0
+                             ? SqlValue()
+                             : SqlValue::Double(static_cast<double>(i) * 1.5));
+    }
+    ASSERT_EQ(deser.cells, expected) << test.query;
+  }
+}
+
+TEST(QueryResultSerializerTest, ArrowIpcFormat) {
+  auto tp = TraceProcessor::CreateInstance(trace_processor::Config());
+  auto iter = tp->ExecuteQuery(
+      "with recursive seq(x) as (select 1 union all select x + 1 from seq "
+      "where x < 100) select x as id, 'str_' || x as s from seq");
+  QueryResultSerializer ser(std::move(iter),
+                            QueryResultSerializer::ResultFormat::kArrowIpc);
+  ser.set_batch_size_for_testing(30, 4096);
+
+  std::vector<uint8_t> buf;
+  uint32_t num_batches = 0;
+  for (bool eof = false; !eof;) {
+    ser.Serialize(&buf);
+    ResultProto::Decoder result(buf.data(), buf.size());
+    EXPECT_FALSE(result.has_error());
+    for (auto batch_it = result.batch(); batch_it; ++batch_it) {
+      ASSERT_FALSE(eof);
+      ResultProto::CellsBatch::Decoder batch(batch_it->data(),
+                                             batch_it->size());
+      eof = batch.is_last_batch();
+      ++num_batches;
+
+      // All the rows are in the Arrow stream rather than in the cells.
+      EXPECT_FALSE(batch.has_cells());
+      ASSERT_TRUE(batch.has_arrow_ipc_stream());
+      protozero::ConstBytes stream = batch.arrow_ipc_stream();
+      EXPECT_EQ(stream.size % 8, 0u);
+      EXPECT_EQ(static_cast<size_t>(stream.data - buf.data()) % 8, 0u);
+      uint32_t continuation;
+      ASSERT_GE(stream.size, sizeof(continuation));
+      memcpy(&continuation, stream.data, sizeof(continuation));
+      EXPECT_EQ(continuation, 0xFFFFFFFFu);
+    }
+    buf.clear();
+  }
+  // 100 rows with 2 columns in batches of 30 cells.
+  EXPECT_EQ(num_batches, 7u);
+}
+
 TEST(QueryResultSerializerTest, ErrorBeforeStartingQuery) {
   auto tp = TraceProcessor::CreateInstance(trace_processor::Config());
   auto iter = tp->ExecuteQuery("insert into incomplete_input");
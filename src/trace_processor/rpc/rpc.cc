@@ -58,6 +58,14 @@ using RpcProto = protos::pbzero::TraceProcessorRpc;
 constexpr auto kSliceSize =
     QueryResultSerializer::kDefaultBatchSplitThreshold + 4096;
 
+QueryResultSerializer::ResultFormat GetResultFormat(
+    const protos::pbzero::QueryArgs::Decoder& query) {
+  if (query.result_format() == protos::pbzero::QueryArgs::ARROW_IPC) {
+    return QueryResultSerializer::ResultFormat::kArrowIpc;
+  }
+  return QueryResultSerializer::ResultFormat::kCells;
+}
+
 // Holds a trace_processor::TraceProcessorRpc pbzero message. Avoids extra
 // copies by doing direct scattered calls from the fragmented heap buffer onto
 // the RpcResponseFunction (the receiver is expected to deal with arbitrary
@@ -119,6 +127,7 @@ void Rpc::ResetTraceProcessorInternal(const Config& config) {
   current_config_ = config;
   bytes_parsed_ = bytes_last_progress_ = 0;
   t_parse_started_ = base::GetWallTimeNs().count();
+  before_query_hook_ = nullptr;
 
   trace_processor_ = TraceProcessor::CreateInstance(config);
   if (on_trace_processor_created_) {
@@ -252,8 +261,10 @@ void Rpc::ParseRpcRequest(const uint8_t* data, size_t len) {
                             }
                           });
 
+        MaybeRunBeforeQueryHook();
         auto it = trace_processor_->ExecuteQuery(sql);
-        QueryResultSerializer serializer(std::move(it));
+        QueryResultSerializer serializer(std::move(it),
+                                         GetResultFormat(query));
         for (bool has_more = true; has_more;) {
           const auto seq_id = tx_seq_id_++;
           Response resp(seq_id, req_type);
@@ -530,6 +541,11 @@ void Rpc::MaybePrintProgress() {
   }
 }
 
+void Rpc::MaybeRunBeforeQueryHook() {
+  if (before_query_hook_)
+    before_query_hook_(trace_processor_.get());
+}
+
 void Rpc::Query(const uint8_t* args,
                 size_t len,
                 const QueryResultBatchCallback& result_callback) {
@@ -543,9 +559,10 @@ void Rpc::Query(const uint8_t* args,
                       }
                     });
 
+  MaybeRunBeforeQueryHook();
   auto it = trace_processor_->ExecuteQuery(sql);
 
-  QueryResultSerializer serializer(std::move(it));
+  QueryResultSerializer serializer(std::move(it), GetResultFormat(query));
 
   protozero::HeapBuffered<protos::pbzero::QueryResult> buffered(kSliceSize,
                                                                 kSliceSize);
@@ -582,6 +599,7 @@ std::vector<uint8_t> Rpc::ComputeTraceSummary(const uint8_t* args, size_t len) {
 void Rpc::ComputeMetricInternal(const uint8_t* data,
                                 size_t len,
                                 protos::pbzero::ComputeMetricResult* result) {
+  MaybeRunBeforeQueryHook();
   protos::pbzero::ComputeMetricArgs::Decoder args(data, len);
   std::vector<std::string> metric_names;
   for (auto it = args.metric_names(); it; ++it) {
@@ -642,6 +660,7 @@ void Rpc::ComputeTraceSummaryInternal(
     const uint8_t* data,
     size_t len,
     protos::pbzero::TraceSummaryResult* result) {
+  MaybeRunBeforeQueryHook();
   protos::pbzero::TraceSummaryArgs::Decoder args(data, len);
   if (!args.has_proto_specs() && !args.has_textproto_specs()) {
     result->set_error("TraceSummary missing trace_summary_spec");
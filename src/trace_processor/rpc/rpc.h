@@ -93,6 +93,16 @@ class Rpc {
     rpc_response_fn_ = std::move(f);
   }
 
+  // Sets a function invoked with the current TraceProcessor instance right
+  // before each query, metric or trace summary computation. Used by
+  // trace_processor_shell --follow to ingest the data appended to the trace
+  // file since the previous query. The hook is bound to the current instance
+  // and is cleared when the trace processor is reset to load another trace.
+  using BeforeQueryHook = std::function<void(TraceProcessor*)>;
+  void SetBeforeQueryHook(BeforeQueryHook hook) {
+    before_query_hook_ = std::move(hook);
+  }
+
   // 2. TraceProcessor legacy RPC endpoints.
   // The methods below are exposed for the old RPC interfaces, where each RPC
   // implementation deals with the method demuxing: (i) wasm_bridge.cc has one
@@ -141,6 +151,7 @@ class Rpc {
   base::Status RegisterSqlPackage(protozero::ConstBytes);
   void ResetTraceProcessorInternal(const Config&);
   void MaybePrintProgress();
+  void MaybeRunBeforeQueryHook();
   Iterator QueryInternal(const uint8_t*, size_t);
   void ComputeMetricInternal(const uint8_t*,
                              size_t,
@@ -157,6 +168,7 @@ class Rpc {
   Config current_config_;
   std::unique_ptr<TraceProcessor> trace_processor_;
   RpcResponseFunction rpc_response_fn_;
+  BeforeQueryHook before_query_hook_;
   protozero::ProtoRingBuffer rxbuf_;
   int64_t tx_seq_id_ = 0;
   int64_t rx_seq_id_ = 0;
@@ -21,10 +21,14 @@
 #include <cstring>
 #include <limits>
 #include <memory>
+#include <vector>
 
 #include "perfetto/base/logging.h"
+#include "perfetto/ext/base/endian.h"
 #include "perfetto/public/compiler.h"
+#include "src/trace_processor/core/util/sort.h"
 #include "src/trace_processor/sorter/trace_sorter.h"
+#include "src/trace_processor/sorter/trace_sorter_spill.h"
 #include "src/trace_processor/sorter/trace_token_buffer.h"
 #include "src/trace_processor/storage/stats.h"
 #include "src/trace_processor/types/trace_processor_context.h"
@@ -32,12 +36,26 @@
 
 namespace perfetto::trace_processor {
 
+namespace {
+
+// Below this number of events, std::sort is faster than radix sort: each
+// radix sort pass has a fixed cost of clearing and scanning 64K counters.
+constexpr size_t kMinEventsForRadixSort = 4096;
+
+// The radix sort buffers are kept around between sorts to avoid reallocating
+// them, unless they grew past this number of events (~50MB).
+constexpr size_t kMaxRetainedRadixSortEvents = 1024 * 1024;
+
+}  // namespace
+
 TraceSorter::TraceSorter(TraceProcessorContext* context,
                          SortingMode sorting_mode,
-                         EventHandling event_handling)
+                         EventHandling event_handling,
+                         uint64_t memory_budget_bytes)
     : sorting_mode_(sorting_mode),
       storage_(context->storage.get()),
-      event_handling_(event_handling) {}
+      event_handling_(event_handling),
+      memory_budget_bytes_(memory_budget_bytes) {}
 
 TraceSorter::~TraceSorter() {
   // If trace processor encountered a fatal error, it's possible for some events
@@ -68,7 +86,9 @@ bool TraceSorter::SetSortingMode(SortingMode sorting_mode) {
   return true;
 }
 
-void TraceSorter::Queue::Sort(TraceTokenBuffer& buffer, bool use_slow_sorting) {
+void TraceSorter::Queue::Sort(TraceTokenBuffer& buffer,
+                              bool use_slow_sorting,
+                              RadixSortBuffers& radix) {
   PERFETTO_DCHECK(needs_sorting());
   PERFETTO_DCHECK(sort_start_idx_ < events_.size());
 
@@ -90,9 +110,58 @@ void TraceSorter::Queue::Sort(TraceTokenBuffer& buffer, bool use_slow_sorting) {
   }
   auto sort_begin = std::lower_bound(events_.begin(), sort_end, sort_min_ts_,
                                      &TimestampedEvent::Compare);
+  auto count = static_cast<size_t>(events_.end() - sort_begin);
   if (use_slow_sorting) {
     std::sort(sort_begin, events_.end(),
               TimestampedEvent::SlowOperatorLess{buffer});
+  } else if (count >= kMinEventsForRadixSort) {
+    // Traces with many out-of-order sequences (e.g. track events from many
+    // threads) can have very large unsorted ranges: radix sort them on the
+    // timestamp, which is much faster than a comparison sort.
+    //
+    // Events are appended to the queue in increasing AllocId order and the
+    // range before |sort_start_idx_| is sorted by (ts, AllocId): as radix sort
+    // is stable, sorting on the timestamp alone is enough to sort on
+    // (ts, AllocId).
+    radix.entries.resize(count);
+    radix.scratch.resize(count);
+    radix.counts.resize(1u << 16);
+    int64_t min_ts = std::numeric_limits<int64_t>::max();
+    int64_t max_ts = std::numeric_limits<int64_t>::min();
+    auto it = sort_begin;
+    for (size_t i = 0; i < count; ++i, ++it) {
+      radix.entries[i].event = *it;
+      min_ts = std::min(min_ts, it->ts);
+      max_ts = std::max(max_ts, it->ts);
+    }
+    for (auto& entry : radix.entries) {
+      uint64_t key = static_cast<uint64_t>(entry.event.ts) -
+                     static_cast<uint64_t>(min_ts);
+      entry.key = base::HostToBE64(key);
+    }
+
+    // Only sort on the bytes which can differ between the timestamps.
+    size_t key_width = 0;
+    for (uint64_t range = static_cast<uint64_t>(max_ts) -
+                          static_cast<uint64_t>(min_ts);
+         range != 0; range >>= 8) {
+      ++key_width;
+    }
+    const RadixSortBuffers::Entry* sorted = core::RadixSort(
+        radix.entries.data(), radix.entries.data() + count,
+        radix.scratch.data(), radix.counts.data(), key_width,
+        [key_width](const RadixSortBuffers::Entry& e) {
+          return reinterpret_cast<const uint8_t*>(&e.key) + sizeof(e.key) -
+                 key_width;
+        });
+    it = sort_begin;
+    for (size_t i = 0; i < count; ++i, ++it) {
+      *it = sorted[i].event;
+    }
+    if (count > kMaxRetainedRadixSortEvents) {
+      radix.entries = {};
+      radix.scratch = {};
+    }
   } else {
     std::sort(sort_begin, events_.end());
   }
@@ -128,12 +197,22 @@ void TraceSorter::Queue::Sort(TraceTokenBuffer& buffer, bool use_slow_sorting) {
 // to avoid re-scanning all the queues all the times) but doesn't seem worth it.
 // With Android traces (that have 8 CPUs) this function accounts for ~1-3% cpu
 // time in a profiler.
+//
+// Events with the same timestamp in different queues are extracted in queue
+// order: this is also the order used when merging events spilled to disk (see
+// MergeSpilledEvents) so that spilling does not change the order in which
+// events are pushed.
 void TraceSorter::SortAndExtractEventsUntilAllocId(
-    BumpAllocator::AllocId limit_alloc_id) {
+    BumpAllocator::AllocId limit_alloc_id,
+    int64_t limit_ts,
+    size_t limit_queue_idx) {
   constexpr int64_t kTsMax = std::numeric_limits<int64_t>::max();
   for (;;) {
     size_t min_queue_idx = 0;  // The index of the queue with the min(ts).
 
+    // The index of the queue with the 2nd min(ts), if any.
+    size_t next_queue_idx = queues_.size();
+
     // The top-2 min(ts) among all queues.
     // queues_[min_queue_idx].events.timestamp == min_queue_ts[0].
     int64_t min_queue_ts[2]{kTsMax, kTsMax};
@@ -154,9 +233,12 @@ void TraceSorter::SortAndExtractEventsUntilAllocId(
       if (all_queues_empty || queue.min_ts_ < min_queue_ts[0]) {
         min_queue_ts[1] = min_queue_ts[0];
         min_queue_ts[0] = queue.min_ts_;
+        next_queue_idx = all_queues_empty ? queues_.size() : min_queue_idx;
         min_queue_idx = i;
-      } else if (queue.min_ts_ < min_queue_ts[1]) {
+      } else if (next_queue_idx == queues_.size() ||
+                 queue.min_ts_ < min_queue_ts[1]) {
         min_queue_ts[1] = queue.min_ts_;
+        next_queue_idx = i;
       }
       all_queues_empty = false;
     }
@@ -167,20 +249,23 @@ void TraceSorter::SortAndExtractEventsUntilAllocId(
     auto& queue = queues_[min_queue_idx];
     auto& events = queue.events_;
     if (queue.needs_sorting()) {
-      queue.Sort(token_buffer_, use_slow_sorting_);
+      queue.Sort(token_buffer_, use_slow_sorting_, radix_sort_buffers_);
     }
     PERFETTO_DCHECK(queue.min_ts_ == events.front().ts);
 
     // Now that we identified the min-queue, extract all events from it until
     // we hit either: (1) the min-ts of the 2nd queue or (2) the packet index
-    // limit, whichever comes first.
+    // limit, whichever comes first. At equal timestamps, the queue with the
+    // lowest index goes first.
     size_t num_extracted = 0;
     for (auto& event : events) {
-      if (event.alloc_id() >= limit_alloc_id) {
+      if (event.alloc_id() >= limit_alloc_id || event.ts > limit_ts ||
+          (event.ts == limit_ts && min_queue_idx >= limit_queue_idx)) {
         break;
       }
 
-      if (event.ts > min_queue_ts[1]) {
+      if (event.ts > min_queue_ts[1] ||
+          (event.ts == min_queue_ts[1] && min_queue_idx > next_queue_idx)) {
         // We should never hit this condition on the first extraction as by
         // the algorithm above (event.ts =) min_queue_ts[0] <= min_queue[1].
         PERFETTO_DCHECK(num_extracted > 0);
@@ -230,6 +315,132 @@ void TraceSorter::SortAndExtractEventsUntilAllocId(
   }  // for(;;)
 }
 
+void TraceSorter::SpillEvents() {
+  struct SpilledEvent {
+    int64_t ts;
+    BumpAllocator::AllocId alloc_id;
+    uint32_t queue_idx;
+
+    bool operator<(const SpilledEvent& other) const {
+      return std::tie(ts, queue_idx, alloc_id) <
+             std::tie(other.ts, other.queue_idx, other.alloc_id);
+    }
+  };
+
+  // After a spill error, keep the events in memory: ingestion fails anyway
+  // (see |status()|) but the events must stay owned by the queues.
+  if (!spill_status_.ok()) {
+    return;
+  }
+
+  // Sort the events of all the spillable queues together so that the run
+  // can be read back sequentially. Ties are broken as for in-memory events:
+  // by queue and then by the order in which the events were pushed.
+  std::vector<SpilledEvent> events;
+  for (uint32_t i = 0; i < queues_.size(); ++i) {
+    Queue& queue = queues_[i];
+    if (!queue.spillable || queue.events_.empty()) {
+      continue;
+    }
+    for (const auto& event : queue.events_) {
+      events.push_back(SpilledEvent{event.ts, event.alloc_id(), i});
+    }
+    queue.events_ = base::CircularQueue<TimestampedEvent>();
+    queue.min_ts_ = std::numeric_limits<int64_t>::max();
+    queue.max_ts_ = 0;
+    queue.sort_start_idx_ = 0;
+    queue.sort_min_ts_ = std::numeric_limits<int64_t>::max();
+  }
+  spillable_bytes_ = 0;
+  if (events.empty()) {
+    return;
+  }
+  std::sort(events.begin(), events.end());
+
+  if (!spill_) {
+    spill_ = std::make_unique<TraceSorterSpill>();
+  }
+  uint64_t bytes_before = spill_->bytes_written();
+  spill_->BeginRun();
+  for (const SpilledEvent& event : events) {
+    queues_[event.queue_idx].sink->OnSpillEvent(
+        this, TraceTokenBuffer::Id{event.alloc_id});
+    spill_->AppendEvent(event.ts, event.queue_idx);
+  }
+  spill_->EndRun();
+  token_buffer_.FreeMemory();
+  spill_status_ = spill_->status();
+
+  storage_->IncrementStats(stats::sorter_spilled_runs);
+  storage_->IncrementStats(
+      stats::sorter_spilled_bytes,
+      static_cast<int64_t>(spill_->bytes_written() - bytes_before));
+}
+
+void TraceSorter::MergeSpilledEvents(BumpAllocator::AllocId limit_alloc_id) {
+  constexpr int64_t kTsMax = std::numeric_limits<int64_t>::max();
+
+  // Spill all the remaining spillable events so that only the events which
+  // cannot be spilled need to be interleaved with the runs.
+  SpillEvents();
+  if (!spill_status_.ok()) {
+    // The spilled events are lost: only extract the in-memory ones.
+    spill_.reset();
+    return;
+  }
+  spill_->BeginMerge();
+
+  // Events are merged by (ts, queue index), like SortAndExtractEvents does
+  // for in-memory events. Queues are either spilled or in memory so the
+  // queue index of a spilled and of an in-memory event never compare equal.
+  for (;;) {
+    const TraceSorterSpill::Event* event = spill_->Peek();
+
+    // Extract all the in-memory events before the next spilled one...
+    if (event) {
+      SortAndExtractEventsUntilAllocId(limit_alloc_id, event->ts,
+                                       event->queue_idx);
+    } else {
+      SortAndExtractEventsUntilAllocId(limit_alloc_id);
+      break;
+    }
+
+    // ...and then all the spilled events until the next in-memory one.
+    int64_t memory_min_ts = kTsMax;
+    size_t memory_min_queue_idx = queues_.size();
+    for (size_t i = 0; i < queues_.size(); ++i) {
+      const Queue& queue = queues_[i];
+      if (!queue.events_.empty() && queue.min_ts_ < memory_min_ts) {
+        memory_min_ts = queue.min_ts_;
+        memory_min_queue_idx = i;
+      }
+    }
+    do {
+      PushSpilledEvent(*event);
+      spill_->Pop();
+      event = spill_->Peek();
+    } while (event && (event->ts < memory_min_ts ||
+                       (event->ts == memory_min_ts &&
+                        event->queue_idx < memory_min_queue_idx)));
+  }
+  spill_status_ = spill_->status();
+  spill_.reset();
+}
+
+void TraceSorter::PushSpilledEvent(const TraceSorterSpill::Event& event) {
+  if (event.ts < latest_pushed_event_ts_) {
+    storage_->IncrementStats(stats::sorter_push_event_out_of_order);
+    return;
+  }
+  latest_pushed_event_ts_ = event.ts;
+  if (PERFETTO_UNLIKELY(event_handling_ == EventHandling::kSortAndDrop)) {
+    return;
+  }
+  PERFETTO_DCHECK(event_handling_ == EventHandling::kSortAndPush);
+  queues_[event.queue_idx].sink->OnSortedSpilledEvent(this, event.ts,
+                                                       event.payload);
+}
+
 TraceSorter::UntypedSink::~UntypedSink() = default;
 
 }  // namespace perfetto::trace_processor
@@ -29,9 +29,12 @@
 
 #include "perfetto/base/compiler.h"
 #include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
 #include "perfetto/ext/base/circular_queue.h"
 #include "perfetto/public/compiler.h"
+#include "perfetto/trace_processor/trace_blob_view.h"
 #include "src/trace_processor/importers/common/parser_types.h"
+#include "src/trace_processor/sorter/trace_sorter_spill.h"
 #include "src/trace_processor/sorter/trace_token_buffer.h"
 #include "src/trace_processor/storage/stats.h"
 #include "src/trace_processor/storage/trace_storage.h"
@@ -86,6 +89,17 @@ namespace perfetto::trace_processor {
 // We use a logarithmic bound search operation to figure out what is the index
 // within the first partition where sorting should start, and sort all events
 // from there to the end.
+//
+// Spilling to disk
+//
+// By default all the events waiting to be extracted are kept in memory: for
+// ring-buffer traces, this means the whole trace is resident at the peak. If
+// a memory budget is set, whenever the tokenized events held by the sorter
+// exceed the budget, they are sorted and written to disk as a "run" (see
+// TraceSorterSpill). At the end of the trace, the runs are merged with the
+// events still in memory. Only events whose type supports it (see
+// SpillTraits) are spilled: others are always kept in memory. Once events
+// have been spilled, incremental extraction is disabled.
 class TraceSorter {
  public:
   template <typename T>
@@ -114,9 +128,12 @@ class TraceSorter {
     kDrop,
   };
 
+  // |memory_budget_bytes| is the (approximate) amount of memory which events
+  // can use before being spilled to disk. 0 means no limit.
   TraceSorter(TraceProcessorContext*,
               SortingMode,
-              EventHandling = EventHandling::kSortAndPush);
+              EventHandling = EventHandling::kSortAndPush,
+              uint64_t memory_budget_bytes = 0);
 
   ~TraceSorter();
 
@@ -129,6 +146,9 @@ class TraceSorter {
 
   void ExtractEventsForced() {
     BumpAllocator::AllocId end_id = token_buffer_.PastTheEndAllocId();
+    if (PERFETTO_UNLIKELY(spill_)) {
+      MergeSpilledEvents(end_id);
+    }
     SortAndExtractEventsUntilAllocId(end_id);
     for (auto& queue : queues_) {
       PERFETTO_CHECK(queue.events_.empty());
@@ -143,7 +163,7 @@ class TraceSorter {
 
   void NotifyReadBufferEvent() {
     if (sorting_mode_ == SortingMode::kFullSort ||
-        flushes_since_extraction_ < 2) {
+        flushes_since_extraction_ < 2 || spill_) {
       return;
     }
 
@@ -154,6 +174,15 @@ class TraceSorter {
 
   int64_t max_timestamp() const { return append_max_ts_; }
 
+  // Whether events may be spilled to disk. Tokenizers should avoid keeping
+  // references to large chunks of the trace in memory (e.g. in interned data)
+  // when this is true as it defeats the purpose of spilling.
+  bool spilling_enabled() const { return memory_budget_bytes_ != 0; }
+
+  // Returns an error if spilling events to disk failed: the spilled events
+  // are lost so ingestion should be stopped.
+  const base::Status& status() const { return spill_status_; }
+
  private:
   class UntypedSink;
 
@@ -229,6 +258,20 @@ class TraceSorter {
   static_assert(std::is_nothrow_swappable_v<TimestampedEvent>,
                 "TimestampedEvent must be trivially swappable");
 
+  // Scratch space used to radix sort the unsorted tail of a queue. Owned by
+  // the sorter so that the allocations are reused across sorts.
+  struct RadixSortBuffers {
+    struct Entry {
+      // The big-endian timestamp of |event|, relative to the min timestamp of
+      // the range being sorted.
+      uint64_t key;
+      TimestampedEvent event;
+    };
+    std::vector<Entry> entries;
+    std::vector<Entry> scratch;
+    std::vector<uint32_t> counts;
+  };
+
   struct Queue {
     void Append(int64_t ts,
                 TraceTokenBuffer::Id id,
@@ -267,7 +310,7 @@ class TraceSorter {
     }
 
     bool needs_sorting() const { return sort_start_idx_ != 0; }
-    void Sort(TraceTokenBuffer&, bool use_slow_sorting);
+    void Sort(TraceTokenBuffer&, bool use_slow_sorting, RadixSortBuffers&);
 
     base::CircularQueue<TimestampedEvent> events_;
     int64_t min_ts_ = std::numeric_limits<int64_t>::max();
@@ -275,9 +318,34 @@ class TraceSorter {
     size_t sort_start_idx_ = 0;
     int64_t sort_min_ts_ = std::numeric_limits<int64_t>::max();
     std::unique_ptr<UntypedSink> sink;
+
+    // Whether the events in this queue can be spilled to disk.
+    bool spillable = false;
   };
 
-  void SortAndExtractEventsUntilAllocId(BumpAllocator::AllocId alloc_id);
+  // Extracts events in (timestamp, queue index) order until either the event
+  // with |alloc_id| or the first event at or after (|limit_ts|,
+  // |limit_queue_idx|) is reached.
+  void SortAndExtractEventsUntilAllocId(
+      BumpAllocator::AllocId alloc_id,
+      int64_t limit_ts = std::numeric_limits<int64_t>::max(),
+      size_t limit_queue_idx = std::numeric_limits<size_t>::max());
+
+  // Writes all the events in spillable queues to disk as a new run.
+  void SpillEvents();
+
+  // Extracts all the spilled events, interleaved with the in-memory events
+  // before |alloc_id|, in timestamp order.
+  void MergeSpilledEvents(BumpAllocator::AllocId alloc_id);
+
+  void PushSpilledEvent(const TraceSorterSpill::Event&);
+
+  // Called when a spillable event is removed from the token buffer.
+  void ReleaseSpillableBytes(size_t bytes) {
+    if (memory_budget_bytes_ != 0) {
+      spillable_bytes_ -= bytes;
+    }
+  }
 
   static TraceTokenBuffer::Id GetTokenBufferId(const TimestampedEvent& event) {
     return TraceTokenBuffer::Id{event.alloc_id()};
@@ -316,6 +384,19 @@ class TraceSorter {
   // Whether when std::sorting the queues, we should use the slow
   // sorting algorithm
   bool use_slow_sorting_ = false;
+
+  RadixSortBuffers radix_sort_buffers_;
+
+  // The memory budget for spillable events (0 if spilling is disabled) and
+  // the estimated memory currently used by them.
+  uint64_t memory_budget_bytes_ = 0;
+  uint64_t spillable_bytes_ = 0;
+
+  // The events spilled to disk, if any.
+  std::unique_ptr<TraceSorterSpill> spill_;
+
+  // The first error which occurred while spilling events to disk.
+  base::Status spill_status_;
 };
 
 // The non-templated base class for polymorphism.
@@ -329,6 +410,14 @@ class TraceSorter::UntypedSink {
                              TraceTokenBuffer::Id id) = 0;
   virtual void OnDiscardedEvent(TraceSorter* sorter,
                                 TraceTokenBuffer::Id id) = 0;
+
+  // Moves the event from the token buffer to the current run of the spill.
+  virtual void OnSpillEvent(TraceSorter* sorter, TraceTokenBuffer::Id id) = 0;
+
+  // Like |OnSortedEvent| but for an event read back from the spill.
+  virtual void OnSortedSpilledEvent(TraceSorter* sorter,
+                                    int64_t ts,
+                                    const TraceBlobView& payload) = 0;
 };
 
 // The type-safe interface that parsers implement.
@@ -345,6 +434,9 @@ class TraceSorter::Sink : public TraceSorter::UntypedSink {
                      TraceTokenBuffer::Id id) final {
     // Safely extracts the data of the expected type T...
     T data = sorter->token_buffer_.Extract<T>(id);
+    if constexpr (SpillTraits<T>::kSpillable) {
+      sorter->ReleaseSpillableBytes(SpillTraits<T>::EstimateSize(data));
+    }
     // ...and calls the type-safe method on the derived class.
     static_cast<Derived*>(this)->Parse(ts, std::move(data));
   }
@@ -352,8 +444,31 @@ class TraceSorter::Sink : public TraceSorter::UntypedSink {
   void OnDiscardedEvent(TraceSorter* sorter, TraceTokenBuffer::Id id) final {
     // Safely extracts and destroys the data of the expected type T.
     T res = sorter->token_buffer_.Extract<T>(id);
+    if constexpr (SpillTraits<T>::kSpillable) {
+      sorter->ReleaseSpillableBytes(SpillTraits<T>::EstimateSize(res));
+    }
     base::ignore_result(res);
   }
+
+  void OnSpillEvent(TraceSorter* sorter, TraceTokenBuffer::Id id) final {
+    if constexpr (SpillTraits<T>::kSpillable) {
+      T data = sorter->token_buffer_.Extract<T>(id);
+      SpillTraits<T>::Serialize(sorter->spill_.get(), std::move(data));
+    } else {
+      PERFETTO_FATAL("Event type cannot be spilled");
+    }
+  }
+
+  void OnSortedSpilledEvent(TraceSorter* sorter,
+                            int64_t ts,
+                            const TraceBlobView& payload) final {
+    if constexpr (SpillTraits<T>::kSpillable) {
+      T data = SpillTraits<T>::Deserialize(sorter->spill_.get(), payload);
+      static_cast<Derived*>(this)->Parse(ts, std::move(data));
+    } else {
+      PERFETTO_FATAL("Event type cannot be spilled");
+    }
+  }
 };
 
 // This is the handle a tokenizer uses to push data.
@@ -374,11 +489,23 @@ class TraceSorter::Stream {
       sorter_->use_slow_sorting_ =
           sorter_->use_slow_sorting_ || data.phase == 'X';
     }
+    size_t spillable_size = 0;
+    if constexpr (SpillTraits<T>::kSpillable) {
+      if (PERFETTO_UNLIKELY(sorter_->spilling_enabled())) {
+        spillable_size = SpillTraits<T>::EstimateSize(data);
+      }
+    }
     TraceTokenBuffer::Id id = sorter_->token_buffer_.Append(std::move(data));
     Queue& queue = sorter_->queues_[queue_idx_];
     queue.Append(ts, id, std::is_same_v<T, JsonEvent>,
                  sorter_->use_slow_sorting_);
     sorter_->append_max_ts_ = std::max(sorter_->append_max_ts_, queue.max_ts_);
+    if (PERFETTO_UNLIKELY(spillable_size)) {
+      sorter_->spillable_bytes_ += spillable_size;
+      if (sorter_->spillable_bytes_ > sorter_->memory_budget_bytes_) {
+        sorter_->SpillEvents();
+      }
+    }
   }
 
  private:
@@ -407,6 +534,7 @@ TraceSorter::CreateStream(std::unique_ptr<SinkType> sink) {
   // 2. Move the unique_ptr, upcasting it to the base class.
   //    The queue now owns the sink.
   queues_[queue_idx].sink = std::move(sink);
+  queues_[queue_idx].spillable = SpillTraits<T>::kSpillable;
 
   // 3. Create and return the type-safe input handle.
   return std::unique_ptr<Stream<T>>(new Stream<T>(this, queue_idx));
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "src/trace_processor/sorter/trace_sorter.h"
+#include "src/trace_processor/storage/trace_storage.h"
+#include "src/trace_processor/types/trace_processor_context.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+struct BenchmarkEvent {
+  int64_t value;
+};
+
+class BenchmarkSink : public TraceSorter::Sink<BenchmarkEvent, BenchmarkSink> {
+ public:
+  void Parse(int64_t ts, BenchmarkEvent event) {
+    benchmark::DoNotOptimize(ts);
+    benchmark::DoNotOptimize(event);
+  }
+};
+
+// An event to be pushed into the stream with index |stream|.
+struct InputEvent {
+  int64_t ts;
+  uint32_t stream;
+};
+
+bool IsBenchmarkFunctionalOnly() {
+  return getenv("BENCHMARK_FUNCTIONAL_TEST_ONLY") != nullptr;
+}
+
+void SorterArgs(benchmark::internal::Benchmark* b) {
+  if (IsBenchmarkFunctionalOnly()) {
+    b->Arg(1024);
+  } else {
+    b->Arg(16384);
+    b->Arg(262144);
+    b->Arg(4194304);
+  }
+}
+
+void RunSorterBenchmark(benchmark::State& state,
+                        const std::vector<InputEvent>& input,
+                        uint32_t stream_count) {
+  for (auto _ : state) {
+    TraceProcessorContext context;
+    context.storage.reset(new TraceStorage());
+    TraceSorter sorter(&context, TraceSorter::SortingMode::kFullSort);
+    std::vector<std::unique_ptr<TraceSorter::Stream<BenchmarkEvent>>> streams;
+    for (uint32_t i = 0; i < stream_count; ++i) {
+      streams.push_back(sorter.CreateStream(std::make_unique<BenchmarkSink>()));
+    }
+    for (const InputEvent& event : input) {
+      streams[event.stream]->Push(event.ts, {event.ts});
+    }
+    sorter.ExtractEventsForced();
+  }
+  state.SetItemsProcessed(
+      static_cast<int64_t>(state.iterations() * input.size()));
+}
+
+// Ftrace-like: 8 per-CPU streams, each in timestamp order, pushed in bundles
+// which overlap in time.
+void BM_TraceSorterInOrderFtrace(benchmark::State& state) {
+  constexpr uint32_t kCpus = 8;
+  constexpr size_t kBundleSize = 256;
+  const auto n = static_cast<size_t>(state.range(0));
+
+  std::vector<InputEvent> input;
+  input.reserve(n);
+  std::minstd_rand0 rnd(0);
+  std::vector<int64_t> cpu_ts(kCpus, 0);
+  while (input.size() < n) {
+    for (uint32_t cpu = 0; cpu < kCpus && input.size() < n; ++cpu) {
+      for (size_t i = 0; i < kBundleSize && input.size() < n; ++i) {
+        cpu_ts[cpu] += 1 + static_cast<int64_t>(rnd() % 10000);
+        input.push_back({cpu_ts[cpu], cpu});
+      }
+    }
+  }
+  RunSorterBenchmark(state, input, kCpus);
+}
+BENCHMARK(BM_TraceSorterInOrderFtrace)->Apply(SorterArgs);
+
+// TrackEvent-like: a single stream where events from many sequences are
+// interleaved, each event being up to 10ms late.
+void BM_TraceSorterJitteredTrackEvent(benchmark::State& state) {
+  const auto n = static_cast<size_t>(state.range(0));
+
+  std::vector<InputEvent> input;
+  input.reserve(n);
+  std::minstd_rand0 rnd(0);
+  for (size_t i = 0; i < n; ++i) {
+    int64_t ts = static_cast<int64_t>(i) * 1000 +
+                 static_cast<int64_t>(rnd() % 10000000);
+    input.push_back({ts, 0});
+  }
+  RunSorterBenchmark(state, input, 1);
+}
+BENCHMARK(BM_TraceSorterJitteredTrackEvent)->Apply(SorterArgs);
+
+// Worst case: a single stream with timestamps in random order.
+void BM_TraceSorterShuffled(benchmark::State& state) {
+  const auto n = static_cast<size_t>(state.range(0));
+
+  std::vector<InputEvent> input;
+  input.reserve(n);
+  std::mt19937_64 rnd(0);
+  std::uniform_int_distribution<int64_t> dist(0, 10ll * 1000 * 1000 * 1000);
+  for (size_t i = 0; i < n; ++i) {
+    input.push_back({dist(rnd), 0});
+  }
+  RunSorterBenchmark(state, input, 1);
+}
+BENCHMARK(BM_TraceSorterShuffled)->Apply(SorterArgs);
+
+}  // namespace
+}  // namespace perfetto::trace_processor
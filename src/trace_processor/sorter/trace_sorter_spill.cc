@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/sorter/trace_sorter_spill.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/build_config.h"
+#include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/scoped_file.h"
+#include "perfetto/ext/base/temp_file.h"
+#include "perfetto/trace_processor/ref_counted.h"
+#include "perfetto/trace_processor/trace_blob.h"
+#include "perfetto/trace_processor/trace_blob_view.h"
+#include "src/trace_processor/importers/proto/packet_sequence_state_generation.h"
+
+#if PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace perfetto::trace_processor {
+namespace {
+
+// Events are written as a fixed size header followed by the payload.
+struct EventHeader {
+  int64_t ts;
+  uint32_t queue_idx;
+  uint32_t payload_size;
+};
+static_assert(sizeof(EventHeader) == 16);
+
+// The size of the buffers used to write runs and to read them back. Bounds
+// the memory used by each run during the merge.
+constexpr size_t kWriteBufferSize = 1024 * 1024;
+constexpr size_t kReadChunkSize = 1024 * 1024;
+
+// Creates an unlinked temporary file. Unlike base::TempFile, failures are
+// returned (as an invalid file) instead of crashing.
+base::ScopedFile CreateSpillFile() {
+#if PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
+  return base::TempFile::CreateUnlinked().ReleaseFD();
+#else
+  std::string path = base::GetSysTempDir() + "/perfetto-sorter-XXXXXX";
+  base::ScopedFile fd(mkstemp(&path[0]));
+  if (fd) {
+    unlink(path.c_str());
+  }
+  return fd;
+#endif
+}
+
+}  // namespace
+
+// A single run: written sequentially and then read back sequentially.
+//
+// I/O errors are latched in |status()|: once an error occurred, writes are
+// ignored and reading stops.
+class TraceSorterSpill::Run {
+ public:
+  Run() : fd_(CreateSpillFile()) {
+    if (!fd_) {
+      status_ = base::ErrStatus(
+          "Failed to create trace sorter spill file in %s: %s",
+          base::GetSysTempDir().c_str(), strerror(errno));
+      return;
+    }
+    write_buffer_.reserve(kWriteBufferSize);
+  }
+
+  void Append(int64_t ts, uint32_t queue_idx, const std::string& payload) {
+    if (!status_.ok()) {
+      return;
+    }
+    EventHeader header{ts, queue_idx, static_cast<uint32_t>(payload.size())};
+    write_buffer_.append(reinterpret_cast<const char*>(&header),
+                         sizeof(header));
+    write_buffer_.append(payload);
+    if (write_buffer_.size() >= kWriteBufferSize) {
+      Flush();
+    }
+  }
+
+  // Flushes all the pending writes and rewinds the file for reading.
+  void FinishWriting() {
+    Flush();
+    write_buffer_ = std::string();
+    if (status_.ok() && lseek(*fd_, 0, SEEK_SET) == -1) {
+      status_ = base::ErrStatus("Failed to rewind trace sorter spill file: %s",
+                                strerror(errno));
+    }
+  }
+
+  // Reads the next event into |current()|. Returns false if all the events
+  // in the run have been read.
+  bool ReadNext() {
+    // Drop the reference to the previous payload so the chunk can be freed
+    // as soon as the sinks are done with it.
+    current_.payload = TraceBlobView();
+    if (!status_.ok()) {
+      return false;
+    }
+    if (!EnsureAvailable(sizeof(EventHeader))) {
+      if (status_.ok() && chunk_.size() != chunk_offset_) {
+        status_ = base::ErrStatus("Trace sorter spill file is truncated");
+      }
+      return false;
+    }
+    EventHeader header;
+    memcpy(&header, chunk_.data() + chunk_offset_, sizeof(header));
+    chunk_offset_ += sizeof(header);
+    if (!EnsureAvailable(header.payload_size)) {
+      if (status_.ok()) {
+        status_ = base::ErrStatus("Trace sorter spill file is truncated");
+      }
+      return false;
+    }
+    current_.ts = header.ts;
+    current_.queue_idx = header.queue_idx;
+    current_.payload = chunk_.slice_off(chunk_offset_, header.payload_size);
+    chunk_offset_ += header.payload_size;
+    return true;
+  }
+
+  const Event& current() const { return current_; }
+
+  uint64_t size() const { return size_; }
+
+  const base::Status& status() const { return status_; }
+
+ private:
+  void Flush() {
+    if (!status_.ok() || write_buffer_.empty()) {
+      return;
+    }
+    ssize_t res =
+        base::WriteAll(*fd_, write_buffer_.data(), write_buffer_.size());
+    if (res != static_cast<ssize_t>(write_buffer_.size())) {
+      status_ = base::ErrStatus("Failed to write trace sorter spill file: %s",
+                                strerror(errno));
+      return;
+    }
+    size_ += write_buffer_.size();
+    write_buffer_.clear();
+  }
+
+  // Makes sure that at least |size| bytes are available in |chunk_| after
+  // |chunk_offset_|, reading a new chunk from the file if needed. Returns
+  // false if the file does not contain enough bytes.
+  bool EnsureAvailable(size_t size) {
+    size_t available = chunk_.size() - chunk_offset_;
+    if (available >= size) {
+      return true;
+    }
+    // Payloads of previous events may still point into the current chunk:
+    // always read into a new chunk, copying the leftover bytes over.
+    TraceBlob blob = TraceBlob::Allocate(std::max(kReadChunkSize, size));
+    if (available > 0) {
+      memcpy(blob.data(), chunk_.data() + chunk_offset_, available);
+    }
+    size_t filled = available;
+    while (filled < blob.size()) {
+      ssize_t res =
+          base::Read(*fd_, blob.data() + filled, blob.size() - filled);
+      if (res < 0) {
+        status_ = base::ErrStatus("Failed to read trace sorter spill file: %s",
+                                  strerror(errno));
+        return false;
+      }
+      if (res == 0) {
+        break;
+      }
+      filled += static_cast<size_t>(res);
+    }
+    chunk_ = TraceBlobView(std::move(blob), 0, filled);
+    chunk_offset_ = 0;
+    return filled >= size;
+  }
+
+  base::ScopedFile fd_;
+  base::Status status_;
+  std::string write_buffer_;
+  uint64_t size_ = 0;
+
+  TraceBlobView chunk_;
+  size_t chunk_offset_ = 0;
+  Event current_{};
+};
+
+TraceSorterSpill::TraceSorterSpill() = default;
+TraceSorterSpill::~TraceSorterSpill() = default;
+
+void TraceSorterSpill::BeginRun() {
+  PERFETTO_CHECK(!merging_);
+  runs_.emplace_back(new Run());
+}
+
+void TraceSorterSpill::AppendEvent(int64_t ts, uint32_t queue_idx) {
+  PERFETTO_DCHECK(!runs_.empty());
+  runs_.back()->Append(ts, queue_idx, scratch_);
+  bytes_written_ += sizeof(EventHeader) + scratch_.size();
+  scratch_.clear();
+}
+
+void TraceSorterSpill::EndRun() {
+  runs_.back()->FinishWriting();
+  LatchStatus(*runs_.back());
+}
+
+void TraceSorterSpill::BeginMerge() {
+  PERFETTO_CHECK(!merging_);
+  merging_ = true;
+  for (uint32_t i = 0; i < runs_.size(); ++i) {
+    if (runs_[i]->ReadNext()) {
+      heap_.push_back(i);
+    } else {
+      LatchStatus(*runs_[i]);
+    }
+  }
+  std::make_heap(heap_.begin(), heap_.end(), HeapComparator());
+}
+
+const TraceSorterSpill::Event* TraceSorterSpill::Peek() const {
+  return heap_.empty() ? nullptr : &runs_[heap_.front()]->current();
+}
+
+void TraceSorterSpill::Pop() {
+  PERFETTO_DCHECK(!heap_.empty());
+  std::pop_heap(heap_.begin(), heap_.end(), HeapComparator());
+  uint32_t run_idx = heap_.back();
+  if (runs_[run_idx]->ReadNext()) {
+    std::push_heap(heap_.begin(), heap_.end(), HeapComparator());
+  } else {
+    heap_.pop_back();
+    LatchStatus(*runs_[run_idx]);
+    // Closes the file and frees the disk space as early as possible.
+    runs_[run_idx].reset();
+  }
+}
+
+void TraceSorterSpill::LatchStatus(const Run& run) {
+  if (status_.ok()) {
+    status_ = run.status();
+  }
+}
+
+std::function<bool(uint32_t, uint32_t)> TraceSorterSpill::HeapComparator()
+    const {
+  // std::*_heap build a max-heap: invert the comparison to get a min-heap.
+  return [this](uint32_t a, uint32_t b) {
+    const Event& a_event = runs_[a]->current();
+    const Event& b_event = runs_[b]->current();
+    return std::tie(a_event.ts, a_event.queue_idx, a) >
+           std::tie(b_event.ts, b_event.queue_idx, b);
+  };
+}
+
+uint32_t TraceSorterSpill::InternSequenceState(
+    RefPtr<PacketSequenceStateGeneration> state) {
+  auto [it, inserted] = sequence_state_indices_.Insert(
+      state.get(), static_cast<uint32_t>(sequence_states_.size()));
+  if (inserted) {
+    sequence_states_.emplace_back(std::move(state));
+  }
+  return *it;
+}
+
+}  // namespace perfetto::trace_processor
@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_SORTER_TRACE_SORTER_SPILL_H_
+#define SRC_TRACE_PROCESSOR_SORTER_TRACE_SORTER_SPILL_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/flat_hash_map.h"
+#include "perfetto/trace_processor/ref_counted.h"
+#include "perfetto/trace_processor/trace_blob.h"
+#include "perfetto/trace_processor/trace_blob_view.h"
+#include "src/trace_processor/importers/common/parser_types.h"
+#include "src/trace_processor/importers/proto/packet_sequence_state_generation.h"
+
+namespace perfetto::trace_processor {
+
+// Holds the events which TraceSorter spilled to disk because its memory budget
+// was exceeded.
+//
+// Events are spilled in "runs": each run is an (unlinked) temporary file
+// containing events sorted by (timestamp, queue index). Once all the events
+// have been
+// spilled, the runs are read back concurrently and merged to obtain the
+// globally sorted stream of events. Only a small window of each run is
+// resident in memory during the merge.
+//
+// The payload of each event is written by |SpillTraits<T>|. Objects which
+// cannot be written to disk (i.e. PacketSequenceStateGeneration) are kept in
+// memory by this class and referenced by index in the payload.
+class TraceSorterSpill {
+ public:
+  // An event read back from a run.
+  struct Event {
+    int64_t ts;
+    uint32_t queue_idx;
+    TraceBlobView payload;
+  };
+
+  TraceSorterSpill();
+  ~TraceSorterSpill();
+
+  TraceSorterSpill(const TraceSorterSpill&) = delete;
+  TraceSorterSpill& operator=(const TraceSorterSpill&) = delete;
+
+  // Starts a new run. Events appended until the next call to |EndRun| must be
+  // sorted by (timestamp, queue index).
+  void BeginRun();
+
+  // Appends an event to the current run. Its payload is |scratch()|, which is
+  // cleared by this function.
+  void AppendEvent(int64_t ts, uint32_t queue_idx);
+
+  // Finishes the current run.
+  void EndRun();
+
+  // Buffer which |SpillTraits<T>::Serialize| should append the payload of the
+  // event being spilled to.
+  std::string* scratch() { return &scratch_; }
+
+  // Starts reading back the runs. No more runs can be written after this.
+  void BeginMerge();
+
+  // Returns the earliest event, by (timestamp, queue index), among all the
+  // runs or nullptr if all the events have been read. Ties between runs are
+  // broken by the order in which the runs were written.
+  const Event* Peek() const;
+
+  // Moves past the event returned by |Peek|.
+  void Pop();
+
+  // Functions to store a sequence state in memory and reference it from a
+  // payload.
+  uint32_t InternSequenceState(RefPtr<PacketSequenceStateGeneration>);
+  RefPtr<PacketSequenceStateGeneration> GetSequenceState(uint32_t index) const {
+    return sequence_states_[index];
+  }
+
+  size_t run_count() const { return runs_.size(); }
+  uint64_t bytes_written() const { return bytes_written_; }
+
+  // The first I/O error which occurred while writing or reading the runs.
+  // Events written to a run after an error are lost and reading a run stops
+  // at the first error.
+  const base::Status& status() const { return status_; }
+
+ private:
+  class Run;
+
+  void LatchStatus(const Run&);
+
+  // Returns the comparator which orders |heap_|.
+  std::function<bool(uint32_t, uint32_t)> HeapComparator() const;
+
+  std::vector<std::unique_ptr<Run>> runs_;
+  bool merging_ = false;
+
+  // Indices into |runs_| of the runs which still have events to read, as a
+  // min-heap on (current event ts, queue index, run index).
+  std::vector<uint32_t> heap_;
+
+  base::Status status_;
+
+  std::string scratch_;
+  uint64_t bytes_written_ = 0;
+
+  std::vector<RefPtr<PacketSequenceStateGeneration>> sequence_states_;
+  base::FlatHashMap<const PacketSequenceStateGeneration*, uint32_t>
+      sequence_state_indices_;
+};
+
+// Defines how tokenized objects of type |T| are written to and read back from
+// a TraceSorterSpill.
+//
+// Trivially copyable (and default constructible) types are supported out of
+// the box by copying their bytes. Other types need an explicit
+// specialization: types without one are never spilled and are always kept in
+// memory.
+template <typename T, typename = void>
+struct SpillTraits {
+  static constexpr bool kSpillable = std::is_trivially_copyable_v<T> &&
+                                     std::is_default_constructible_v<T>;
+
+  // Returns an estimate of the memory kept alive by |object| while it sits in
+  // the sorter.
+  static size_t EstimateSize(const T&) { return sizeof(T); }
+
+  static void Serialize(TraceSorterSpill* spill, T object) {
+    static_assert(kSpillable);
+    spill->scratch()->append(reinterpret_cast<const char*>(&object),
+                             sizeof(T));
+  }
+
+  static T Deserialize(TraceSorterSpill*, const TraceBlobView& payload) {
+    static_assert(kSpillable);
+    PERFETTO_CHECK(payload.size() == sizeof(T));
+    T object;
+    memcpy(&object, payload.data(), sizeof(T));
+    return object;
+  }
+};
+
+template <>
+struct SpillTraits<TracePacketData> {
+  static constexpr bool kSpillable = true;
+
+  // The packet is a view on a (usually much larger) chunk of the trace: count
+  // the bytes of the packet itself as the chunk is freed once all the packets
+  // in it are gone.
+  static size_t EstimateSize(const TracePacketData& data) {
+    return sizeof(TracePacketData) + data.packet.size();
+  }
+
+  static void Serialize(TraceSorterSpill* spill, TracePacketData data) {
+    uint32_t state = spill->InternSequenceState(std::move(data.sequence_state));
+    std::string* out = spill->scratch();
+    out->append(reinterpret_cast<const char*>(&state), sizeof(state));
+    out->append(reinterpret_cast<const char*>(data.packet.data()),
+                data.packet.size());
+  }
+
+  static TracePacketData Deserialize(TraceSorterSpill* spill,
+                                     const TraceBlobView& payload) {
+    uint32_t state;
+    PERFETTO_CHECK(payload.size() >= sizeof(state));
+    memcpy(&state, payload.data(), sizeof(state));
+    return TracePacketData{
+        payload.slice_off(sizeof(state), payload.size() - sizeof(state)),
+        spill->GetSequenceState(state)};
+  }
+};
+
+template <>
+struct SpillTraits<TrackEventData> {
+  static constexpr bool kSpillable = true;
+
+  static size_t EstimateSize(const TrackEventData& data) {
+    return sizeof(TrackEventData) + data.trace_packet_data.packet.size();
+  }
+
+  // The fields other than |trace_packet_data| are written first, followed by
+  // the payload of |trace_packet_data|.
+  static void Serialize(TraceSorterSpill* spill, TrackEventData data) {
+    Fields fields{data.thread_timestamp, data.thread_instruction_count,
+                  data.counter_value, data.extra_counter_values};
+    spill->scratch()->append(reinterpret_cast<const char*>(&fields),
+                             sizeof(fields));
+    SpillTraits<TracePacketData>::Serialize(
+        spill, std::move(data.trace_packet_data));
+  }
+
+  static TrackEventData Deserialize(TraceSorterSpill* spill,
+                                    const TraceBlobView& payload) {
+    Fields fields;
+    PERFETTO_CHECK(payload.size() >= sizeof(fields));
+    memcpy(&fields, payload.data(), sizeof(fields));
+    TrackEventData data(SpillTraits<TracePacketData>::Deserialize(
+        spill,
+        payload.slice_off(sizeof(fields), payload.size() - sizeof(fields))));
+    data.thread_timestamp = fields.thread_timestamp;
+    data.thread_instruction_count = fields.thread_instruction_count;
+    data.counter_value = fields.counter_value;
+    data.extra_counter_values = fields.extra_counter_values;
+    return data;
+  }
+
+ private:
+  struct Fields {
+    std::optional<int64_t> thread_timestamp;
+    std::optional<int64_t> thread_instruction_count;
+    double counter_value;
+    std::array<double, TrackEventData::kMaxNumExtraCounters>
+        extra_counter_values;
+  };
+  static_assert(std::is_trivially_copyable_v<Fields>);
+};
+
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_SORTER_TRACE_SORTER_SPILL_H_
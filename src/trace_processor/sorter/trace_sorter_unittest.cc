@@ -16,15 +16,18 @@
 
 #include "src/trace_processor/sorter/trace_sorter.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <map>
 #include <memory>
 #include <random>
+#include <string>
 #include <utility>
 #include <vector>
 
+#include "perfetto/base/build_config.h"
 #include "perfetto/ext/base/string_view.h"
 #include "perfetto/trace_processor/trace_blob.h"
 #include "perfetto/trace_processor/trace_blob_view.h"
@@ -49,6 +52,10 @@ struct FtraceEventData {
   uint32_t cpu;
 };
 
+struct alignas(8) TriviallyCopyableData {
+  int64_t value;
+};
+
 class MockTraceStorage : public TraceStorage {
  public:
   MockTraceStorage() = default;
@@ -71,10 +78,55 @@ class TraceSorterTest : public ::testing::Test {
     CreateSorter();
   }
 
-  void CreateSorter(bool full_sort = true) {
+  void CreateSorter(bool full_sort = true, uint64_t memory_budget_bytes = 0) {
     auto sorting_mode = full_sort ? TraceSorter::SortingMode::kFullSort
                                   : TraceSorter::SortingMode::kDefault;
-    context_.sorter.reset(new TraceSorter(&context_, sorting_mode));
+    context_.sorter.reset(
+        new TraceSorter(&context_, sorting_mode,
+                        TraceSorter::EventHandling::kSortAndPush,
+                        memory_budget_bytes));
+  }
+
+  // Pushes events with many equal timestamps to interleaved spillable and
+  // non-spillable streams. Returns the (timestamp, event index) of the events
+  // in the order they are parsed.
+  std::vector<std::pair<int64_t, uint32_t>> PushEventsWithEqualTimestamps(
+      uint64_t memory_budget_bytes) {
+    CreateSorter(true, memory_budget_bytes);
+    std::vector<std::pair<int64_t, uint32_t>> parsed;
+    std::vector<std::unique_ptr<TraceSorter::Stream<TriviallyCopyableData>>>
+        spillable;
+    std::vector<std::unique_ptr<TraceSorter::Stream<FtraceEventData>>>
+        in_memory;
+    for (uint32_t i = 0; i < 3; ++i) {
+      auto sink = std::make_unique<MockSink<TriviallyCopyableData>>();
+      EXPECT_CALL(*sink, MockParse(_, _))
+          .WillRepeatedly([&](int64_t ts, TriviallyCopyableData data) {
+            parsed.emplace_back(ts, static_cast<uint32_t>(data.value));
+          });
+      spillable.emplace_back(context_.sorter->CreateStream(std::move(sink)));
+
+      auto ftrace_sink = std::make_unique<MockSink<FtraceEventData>>();
+      EXPECT_CALL(*ftrace_sink, MockParse(_, _))
+          .WillRepeatedly([&](int64_t ts, FtraceEventData data) {
+            parsed.emplace_back(ts, data.cpu);
+          });
+      in_memory.emplace_back(
+          context_.sorter->CreateStream(std::move(ftrace_sink)));
+    }
+
+    std::minstd_rand0 rnd_engine(0);
+    for (uint32_t i = 0; i < 2000; ++i) {
+      auto ts = static_cast<int64_t>(rnd_engine() % 50);
+      uint32_t stream = rnd_engine() % 6;
+      if (stream % 2 == 0) {
+        spillable[stream / 2]->Push(ts, {i});
+      } else {
+        in_memory[stream / 2]->Push(ts, {test_buffer_.slice_off(0, 1), i});
+      }
+    }
+    context_.sorter->ExtractEventsForced();
+    return parsed;
   }
 
  protected:
@@ -372,5 +424,148 @@ TEST_F(TraceSorterTest, SetSortingModeAfterExtraction) {
       context_.sorter->SetSortingMode(TraceSorter::SortingMode::kFullSort));
 }
 
+TEST_F(TraceSorterTest, LargeOutOfOrderTail) {
+  std::vector<std::pair<int64_t, int64_t>> parsed;
+  auto sink = std::make_unique<MockSink<TriviallyCopyableData>>();
+  EXPECT_CALL(*sink, MockParse(_, _))
+      .WillRepeatedly([&](int64_t ts, TriviallyCopyableData data) {
+        parsed.emplace_back(ts, data.value);
+      });
+  auto stream = context_.sorter->CreateStream(std::move(sink));
+
+  // Enough events to be radix sorted, with many duplicate timestamps to check
+  // that events with the same timestamp are extracted in push order.
+  std::minstd_rand0 rnd(0);
+  std::vector<std::pair<int64_t, int64_t>> expected;
+  for (int64_t i = 0; i < 20000; ++i) {
+    int64_t ts = 1000000000 + i * 10 + static_cast<int64_t>(rnd() % 100000);
+    if (i % 7 == 0) {
+      ts = 1000000000;
+    }
+    stream->Push(ts, {i});
+    expected.emplace_back(ts, i);
+  }
+  context_.sorter->ExtractEventsForced();
+
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(parsed, expected);
+}
+
+TEST_F(TraceSorterTest, SpillToDisk) {
+  CreateSorter(true, /*memory_budget_bytes=*/256);
+  auto state = PacketSequenceStateGeneration::CreateFirst(&context_);
+
+  std::vector<std::pair<int64_t, std::string>> parsed;
+  auto packet_sink = std::make_unique<MockSink<TracePacketData>>();
+  EXPECT_CALL(*packet_sink, MockParse(_, _))
+      .WillRepeatedly([&](int64_t ts, TracePacketData data) {
+        EXPECT_EQ(data.sequence_state.get(), state.get());
+        parsed.emplace_back(
+            ts, std::string(reinterpret_cast<const char*>(data.packet.data()),
+                            data.packet.size()));
+      });
+  auto packet_stream = context_.sorter->CreateStream(std::move(packet_sink));
+
+  // FtraceEventData cannot be spilled: these events stay in memory and are
+  // merged with the spilled ones at the end.
+  auto ftrace_sink = std::make_unique<MockSink<FtraceEventData>>();
+  EXPECT_CALL(*ftrace_sink, MockParse(_, _))
+      .WillRepeatedly([&](int64_t ts, FtraceEventData data) {
+        parsed.emplace_back(ts, "cpu" + std::to_string(data.cpu));
+      });
+  auto ftrace_stream = context_.sorter->CreateStream(std::move(ftrace_sink));
+
+  std::map<int64_t, std::string> expected;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    // Visits all the timestamps in [0, 1000) in a scrambled order.
+    int64_t ts = (i * 7919) % 1000;
+    if (i % 10 == 0) {
+      ftrace_stream->Push(ts, {test_buffer_.slice_off(0, 1), i});
+      expected[ts] = "cpu" + std::to_string(i);
+    } else {
+      std::string payload = "packet" + std::to_string(i);
+      packet_stream->Push(
+          ts, {TraceBlobView(TraceBlob::CopyFrom(payload.data(),
+                                                 payload.size())),
+               state});
+      expected[ts] = payload;
+    }
+  }
+  context_.sorter->ExtractEventsForced();
+
+  EXPECT_GT(storage_->GetStats(stats::sorter_spilled_runs), 1);
+  EXPECT_GT(storage_->GetStats(stats::sorter_spilled_bytes), 0);
+  EXPECT_THAT(parsed, testing::ElementsAreArray(expected));
+}
+
+TEST_F(TraceSorterTest, SpillTriviallyCopyable) {
+  CreateSorter(true, /*memory_budget_bytes=*/16);
+
+  std::vector<std::pair<int64_t, int64_t>> parsed;
+  auto sink = std::make_unique<MockSink<TriviallyCopyableData>>();
+  EXPECT_CALL(*sink, MockParse(_, _))
+      .WillRepeatedly([&](int64_t ts, TriviallyCopyableData data) {
+        parsed.emplace_back(ts, data.value);
+      });
+  auto stream = context_.sorter->CreateStream(std::move(sink));
+
+  stream->Push(30, {3});
+  stream->Push(10, {1});
+  stream->Push(50, {5});
+  stream->Push(20, {2});
+  stream->Push(40, {4});
+  stream->Push(10, {6});
+  context_.sorter->ExtractEventsForced();
+
+  EXPECT_GT(storage_->GetStats(stats::sorter_spilled_runs), 0);
+  // Events with the same timestamp are extracted in push order.
+  EXPECT_THAT(parsed, testing::ElementsAre(std::make_pair(10, 1),
+                                           std::make_pair(10, 6),
+                                           std::make_pair(20, 2),
+                                           std::make_pair(30, 3),
+                                           std::make_pair(40, 4),
+                                           std::make_pair(50, 5)));
+}
+
+// Events with the same timestamp must be parsed in the same order whether or
+// not they were spilled to disk.
+TEST_F(TraceSorterTest, SpillPreservesOrderOfEqualTimestamps) {
+  auto in_memory = PushEventsWithEqualTimestamps(0);
+  ASSERT_EQ(in_memory.size(), 2000u);
+  ASSERT_TRUE(std::is_sorted(
+      in_memory.begin(), in_memory.end(),
+      [](const auto& a, const auto& b) { return a.first < b.first; }));
+
+  auto spilled = PushEventsWithEqualTimestamps(256);
+  EXPECT_GT(storage_->GetStats(stats::sorter_spilled_runs), 1);
+  EXPECT_TRUE(context_.sorter->status().ok());
+  EXPECT_EQ(spilled, in_memory);
+}
+
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
+TEST_F(TraceSorterTest, SpillErrorIsReported) {
+  const char* tmpdir = getenv("TMPDIR");
+  std::string old_tmpdir = tmpdir ? tmpdir : "";
+  setenv("TMPDIR", "/nonexistent/perfetto/tmpdir", 1);
+
+  CreateSorter(true, /*memory_budget_bytes=*/16);
+  auto sink = std::make_unique<MockSink<TriviallyCopyableData>>();
+  EXPECT_CALL(*sink, MockParse(_, _)).Times(testing::AnyNumber());
+  auto stream = context_.sorter->CreateStream(std::move(sink));
+  for (int64_t i = 0; i < 10; ++i) {
+    stream->Push(i, {i});
+  }
+  EXPECT_FALSE(context_.sorter->status().ok());
+  context_.sorter->ExtractEventsForced();
+  EXPECT_FALSE(context_.sorter->status().ok());
+
+  if (tmpdir) {
+    setenv("TMPDIR", old_tmpdir.c_str(), 1);
+  } else {
+    unsetenv("TMPDIR");
+  }
+}
+#endif
+
 }  // namespace
 }  // namespace perfetto::trace_processor
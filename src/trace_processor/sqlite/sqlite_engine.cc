@@ -45,9 +45,11 @@ namespace perfetto::trace_processor {
 namespace {
 
 void EnsureSqliteInitialized() {
-  // sqlite3_initialize isn't actually thread-safe in standalone builds because
-  // we build with SQLITE_THREADSAFE=0. Ensure it's only called from a single
-  // thread.
+  // Standalone builds use SQLITE_THREADSAFE=2 (multi-thread mode): different
+  // connections can be used concurrently from different threads (e.g. by the
+  // sessions of the HTTP RPC server) but each connection by one thread at a
+  // time. Initialize only once anyway, as sqlite3_config() must precede
+  // sqlite3_initialize().
   static bool init_once = [] {
     // Enabling memstatus causes a lock to be taken on every malloc/free in
     // SQLite to update the memory statistics. This can cause massive contention
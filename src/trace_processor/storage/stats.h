@@ -241,6 +241,16 @@ namespace perfetto::trace_processor::stats {
   F(traced_chunks_discarded,              kSingle,  kInfo,     kTrace,    ""), \
   F(traced_data_sources_registered,       kSingle,  kInfo,     kTrace,    ""), \
   F(traced_data_sources_seen,             kSingle,  kInfo,     kTrace,    ""), \
+  F(traced_file_writer_bytes_written,     kSingle,  kInfo,     kTrace,    ""), \
+  F(traced_file_writer_max_pending_bytes, kSingle,  kInfo,     kTrace,         \
+      "Max number of bytes queued by traced and not yet written into the "     \
+      "trace file by its writer thread."),                                     \
+  F(traced_file_writer_stall_time_ns,     kSingle,  kInfo,     kTrace,    ""), \
+  F(traced_file_writer_stalls,            kSingle,  kInfo,     kTrace,         \
+      "Number of times traced had to wait for its trace file writer thread "   \
+      "to catch up. If this is non-zero the storage is too slow for the rate " \
+      "of trace data."),                                                       \
+  F(traced_file_writer_write_errors,      kSingle,  kDataLoss, kTrace,    ""), \
   F(traced_final_flush_failed,            kSingle,  kDataLoss, kTrace,    ""), \
   F(traced_final_flush_succeeded,         kSingle,  kInfo,     kTrace,    ""), \
   F(traced_flushes_failed,                kSingle,  kDataLoss, kTrace,    ""), \
@@ -434,6 +444,12 @@ namespace perfetto::trace_processor::stats {
       "Trace events are out of order event after sorting. This can happen "    \
       "due to many factors including clock sync drift, producers emitting "    \
       "events out of order or a bug in trace processor's logic of sorting."),  \
+  F(sorter_spilled_runs,                  kSingle,  kInfo,     kTrace,         \
+      "Number of sorted runs of events which were written to disk because "    \
+      "the sorter exceeded Config.sorter_memory_budget_bytes."),               \
+  F(sorter_spilled_bytes,                 kSingle,  kInfo,     kTrace,         \
+      "Number of bytes written to disk by the sorter because it exceeded "     \
+      "Config.sorter_memory_budget_bytes."),                                   \
   F(unknown_extension_fields,             kSingle,  kError,    kTrace,         \
       "TraceEvent had unknown extension fields, which might result in "        \
       "missing some arguments. You may need a newer version of trace "         \
@@ -806,6 +822,10 @@ namespace perfetto::trace_processor::stats {
       "generation, so it's ignored until incremental state is cleared. Root "  \
       "cause: packet loss in the trace (check packet loss stats) or a bug "    \
       "in the trace producer (missing incremental_state_cleared packet)."),    \
+  F(dataframe_encoding_bytes_saved,        kSingle,  kInfo,     kAnalysis,     \
+      "Number of bytes of memory saved by encoding the integer columns of "    \
+      "tables after the trace was loaded (see the "                            \
+      "enable_dataframe_column_encoding option)."),                            \
   F(heap_graph_non_finalized_graph,             kSingle,  kDataLoss, kTrace,   \
       "Heap graph profile was not finalized before the trace ended. Packet "   \
       "loss was detected (missing packet indices) which means the profile is " \
@@ -20,13 +20,19 @@
 #include <cstdint>
 #include <cstring>
 #include <string>
+#include <utility>
 #include <variant>
 #include <vector>
 
 #include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/scoped_mmap.h"
+#include "perfetto/ext/base/status_macros.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "src/trace_processor/core/dataframe/dataframe.h"
 #include "src/trace_processor/core/dataframe/specs.h"
+#include "src/trace_processor/core/util/snapshot.h"
+#include "src/trace_processor/storage/stats.h"
 #include "src/trace_processor/tables/all_tables_fwd.h"
 #include "src/trace_processor/tables/android_tables_py.h"   // IWYU pragma: keep
 #include "src/trace_processor/tables/counter_tables_py.h"   // IWYU pragma: keep
@@ -100,6 +106,68 @@ TraceStorage::~TraceStorage() {
   }
 }
 
+void TraceStorage::FinalizeTables() {
+  for (size_t i = 0; i < tables::kTableCount; ++i) {
+    reinterpret_cast<dataframe::Dataframe*>(
+        &tables_storage_[i * sizeof(dataframe::Dataframe)])
+        ->Finalize();
+  }
+}
+
+void TraceStorage::SerializeToSnapshot(core::SnapshotWriter* writer) const {
+  string_pool_.SerializeToSnapshot(writer);
+
+  writer->WriteU32(static_cast<uint32_t>(stats_.size()));
+  for (const Stats& stat : stats_) {
+    writer->WriteI64(stat.value);
+    writer->WriteU64(stat.indexed_values.size());
+    for (const auto& [index, value] : stat.indexed_values) {
+      writer->WriteI64(index);
+      writer->WriteI64(value);
+    }
+  }
+
+  writer->WriteU32(static_cast<uint32_t>(tables::kTableCount));
+  for (size_t i = 0; i < tables::kTableCount; ++i) {
+    reinterpret_cast<const dataframe::Dataframe*>(
+        &tables_storage_[i * sizeof(dataframe::Dataframe)])
+        ->SerializeToSnapshot(writer);
+  }
+}
+
+base::Status TraceStorage::LoadFromSnapshot(core::SnapshotReader* reader,
+                                            base::ScopedMmap mapping) {
+  RETURN_IF_ERROR(string_pool_.LoadFromSnapshot(reader));
+
+  ASSIGN_OR_RETURN(uint32_t stats_count, reader->ReadU32());
+  if (stats_count != stats_.size()) {
+    return base::ErrStatus("Snapshot: stats count mismatch");
+  }
+  for (Stats& stat : stats_) {
+    ASSIGN_OR_RETURN(stat.value, reader->ReadI64());
+    ASSIGN_OR_RETURN(uint64_t indexed_count, reader->ReadU64());
+    stat.indexed_values.clear();
+    for (uint64_t i = 0; i < indexed_count; ++i) {
+      ASSIGN_OR_RETURN(int64_t index, reader->ReadI64());
+      ASSIGN_OR_RETURN(int64_t value, reader->ReadI64());
+      stat.indexed_values[static_cast<int>(index)] = value;
+    }
+  }
+
+  ASSIGN_OR_RETURN(uint32_t table_count, reader->ReadU32());
+  if (table_count != tables::kTableCount) {
+    return base::ErrStatus("Snapshot: table count mismatch (%u vs %zu)",
+                           table_count, tables::kTableCount);
+  }
+  for (size_t i = 0; i < tables::kTableCount; ++i) {
+    RETURN_IF_ERROR(reinterpret_cast<dataframe::Dataframe*>(
+                        &tables_storage_[i * sizeof(dataframe::Dataframe)])
+                        ->LoadFromSnapshot(reader));
+  }
+  snapshot_mapping_ = std::move(mapping);
+  return base::OkStatus();
+}
+
 uint32_t TraceStorage::SqlStats::RecordQueryBegin(const std::string& query,
                                                   int64_t time_started) {
   if (queries_.size() >= kMaxLogEntries) {
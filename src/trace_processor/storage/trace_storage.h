@@ -34,7 +34,9 @@
 #include <vector>
 
 #include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
 #include "perfetto/base/time.h"
+#include "perfetto/ext/base/scoped_mmap.h"
 #include "perfetto/ext/base/string_view.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "perfetto/trace_processor/trace_blob_view.h"
@@ -324,6 +326,26 @@ class TraceStorage {
     // TODO(lalitm): remove.
   }
 
+  // Finalizes all the tables, including the ones which are not exposed to SQL
+  // as static tables (e.g. the viewcapture interned data) and so are not
+  // finalized with them.
+  void FinalizeTables();
+
+  // Writes the string pool, the stats and the contents of all the tables to
+  // `writer`. All the tables must have been finalized.
+  void SerializeToSnapshot(core::SnapshotWriter* writer) const;
+
+  // Replaces the string pool, the stats and the contents of all the tables
+  // with the ones read from `reader`, which must be reading from `mapping`.
+  // Table columns point directly into `mapping`, which is kept alive by this
+  // class. None of the tables must be finalized; they are all finalized on
+  // success.
+  //
+  // On failure, the storage is left in an unspecified state and should be
+  // discarded.
+  base::Status LoadFromSnapshot(core::SnapshotReader* reader,
+                                base::ScopedMmap mapping);
+
   const tables::ThreadTable& thread_table() const {
     return table<tables::ThreadTable>();
   }
@@ -1134,6 +1156,10 @@ class TraceStorage {
   std::vector<TraceBlobView> etm_v4_chunk_data_;
   std::unique_ptr<Destructible> etm_target_memory_;
 
+  // The mapping of the snapshot file this storage was loaded from (if any).
+  // The columns of all tables point into it.
+  base::ScopedMmap snapshot_mapping_;
+
   // Aligned storage for all table dataframes.
   alignas(
       dataframe::Dataframe) char tables_storage_[tables::kTableCount *
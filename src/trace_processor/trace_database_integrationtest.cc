@@ -28,7 +28,9 @@
 #include "perfetto/base/status.h"
 #include "perfetto/ext/base/file_utils.h"
 #include "perfetto/ext/base/scoped_file.h"
+#include "perfetto/ext/base/scoped_mmap.h"
 #include "perfetto/ext/base/string_utils.h"
+#include "perfetto/ext/base/temp_file.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "perfetto/trace_processor/iterator.h"
 #include "perfetto/trace_processor/status.h"
@@ -908,5 +910,41 @@ TEST_F(TraceProcessorIntegrationTest, MultiLevelPackageInclude) {
   ASSERT_OK(it2.Status());
 }
 
+#if PERFETTO_HAS_MMAP()
+TEST_F(TraceProcessorIntegrationTest, SnapshotRoundTrip) {
+  std::string json = "[";
+  for (int i = 0; i < 1000; ++i) {
+    json += base::StackString<128>(
+                "%s{\"name\":\"s%d\",\"ph\":\"X\",\"ts\":%d,\"dur\":5,"
+                "\"pid\":1,\"tid\":%d}",
+                i == 0 ? "" : ",", i % 13, i * 10, i % 11)
+                .ToStdString();
+  }
+  json += "]";
+  ASSERT_OK(Processor()->Parse(
+      TraceBlobView(TraceBlob::CopyFrom(json.data(), json.size()))));
+  ASSERT_OK(NotifyEndOfFile());
+
+  // All the tables in the storage, and not only the ones exposed to SQL, must
+  // be finalized for the snapshot to be written.
+  base::TempFile file = base::TempFile::Create();
+  ASSERT_OK(Processor()->SaveSnapshot(file.path()));
+
+  auto loaded = TraceProcessor::CreateInstance(Config());
+  ASSERT_OK(loaded->LoadSnapshot(file.path()));
+  const char kQuery[] =
+      "select count(*), count(distinct utid), sum(dur) from slice "
+      "join thread_track on slice.track_id = thread_track.id";
+  auto expected = Query(kQuery);
+  auto it = loaded->ExecuteQuery(kQuery);
+  ASSERT_TRUE(expected.Next()) << expected.Status().message();
+  ASSERT_TRUE(it.Next()) << it.Status().message();
+  ASSERT_EQ(it.Get(0).long_value, 1000);
+  for (uint32_t i = 0; i < 3; ++i) {
+    ASSERT_EQ(it.Get(i).long_value, expected.Get(i).long_value);
+  }
+}
+#endif  // PERFETTO_HAS_MMAP()
+
 }  // namespace
 }  // namespace perfetto::trace_processor
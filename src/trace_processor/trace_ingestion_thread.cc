@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/trace_ingestion_thread.h"
+
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "perfetto/base/status.h"
+#include "perfetto/base/thread_annotations.h"
+#include "perfetto/ext/base/thread_utils.h"
+#include "perfetto/trace_processor/trace_blob.h"
+#include "perfetto/trace_processor/trace_blob_view.h"
+
+namespace perfetto::trace_processor {
+
+TraceIngestionThread::TraceIngestionThread(Consumer consumer,
+                                               size_t max_queued_bytes)
+    : consumer_(std::move(consumer)), max_queued_bytes_(max_queued_bytes) {
+  thread_ = std::thread(&TraceIngestionThread::RunThreadLoop, this);
+}
+
+TraceIngestionThread::~TraceIngestionThread() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    quit_ = true;
+    queue_.clear();
+  }
+  consumer_cv_.notify_all();
+  thread_.join();
+}
+
+base::Status TraceIngestionThread::Push(TraceBlobView blob)
+    PERFETTO_NO_THREAD_SAFETY_ANALYSIS {
+  // See ThreadPool::RunThreadLoop for why thread-safety analysis is disabled
+  // in functions using std::unique_lock.
+
+  // The refcount of TraceBlob is not thread-safe. If the caller still holds
+  // other views on the same blob, copy the bytes into a fresh blob so that it
+  // is only ever referenced by the ingestion thread.
+  const size_t size = blob.size();
+  TraceBlobView owned = std::move(blob);
+  if (!owned.has_unique_blob()) {
+    owned = TraceBlobView(TraceBlob::CopyFrom(owned.data(), size));
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  producer_cv_.wait(
+      lock, [this, size]() PERFETTO_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+        return !status_.ok() || queued_bytes_ == 0 ||
+               queued_bytes_ + size <= max_queued_bytes_;
+      });
+  if (!status_.ok()) {
+    return status_;
+  }
+  queued_bytes_ += size;
+  queue_.emplace_back(std::move(owned));
+  lock.unlock();
+  consumer_cv_.notify_one();
+  return base::OkStatus();
+}
+
+base::Status TraceIngestionThread::WaitForIdle()
+    PERFETTO_NO_THREAD_SAFETY_ANALYSIS {
+  std::unique_lock<std::mutex> lock(mutex_);
+  producer_cv_.wait(lock, [this]() PERFETTO_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return queue_.empty() && !busy_;
+  });
+  return status_;
+}
+
+void TraceIngestionThread::RunThreadLoop()
+    PERFETTO_NO_THREAD_SAFETY_ANALYSIS {
+  base::MaybeSetThreadName("tp-ingestion");
+  for (;;) {
+    TraceBlobView blob;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      consumer_cv_.wait(lock,
+                        [this]() PERFETTO_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+                          return quit_ || !queue_.empty();
+                        });
+      if (quit_) {
+        return;
+      }
+      blob = std::move(queue_.front());
+      queue_.pop_front();
+      busy_ = true;
+    }
+
+    const size_t size = blob.size();
+    base::Status status = consumer_(std::move(blob));
+
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      busy_ = false;
+      queued_bytes_ -= size;
+      if (!status.ok()) {
+        status_ = std::move(status);
+        queue_.clear();
+        queued_bytes_ = 0;
+      }
+    }
+    producer_cv_.notify_all();
+  }
+}
+
+}  // namespace perfetto::trace_processor
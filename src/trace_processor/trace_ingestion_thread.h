@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_TRACE_INGESTION_THREAD_H_
+#define SRC_TRACE_PROCESSOR_TRACE_INGESTION_THREAD_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "perfetto/base/status.h"
+#include "perfetto/base/thread_annotations.h"
+#include "perfetto/trace_processor/trace_blob_view.h"
+
+namespace perfetto::trace_processor {
+
+// Runs the ingestion of trace bytes on a dedicated thread, so that the thread
+// producing them (e.g. reading from disk or the network) can read ahead.
+//
+// Blobs passed to |Push| are moved into a bounded queue and handed, in
+// order, to the |consumer| function on the ingestion thread. This is a single
+// stage: tokenization, sorting and parsing all run in |consumer|, on the same
+// thread, as they share state which is not thread-safe. The only work which
+// overlaps with them is the producer's.
+//
+// The queue is bounded by the total size of the blobs it holds (including the
+// one currently being consumed): |Push| blocks while the queue is full. A
+// single blob larger than the bound is always accepted when the queue is
+// empty.
+//
+// The refcount of TraceBlob is not thread-safe: blobs which are shared with
+// other views (e.g. slices of a larger buffer) are copied on the calling
+// thread, so that blobs seen by |consumer| are never shared with the thread
+// calling |Push|. Blobs only referenced by the view passed to |Push| are
+// handed over without copying.
+//
+// Once |consumer| returns an error, all queued blobs are dropped and the error
+// is returned by every subsequent call to |Push| and |WaitForIdle|.
+//
+// Thread-safety: |Push| and |WaitForIdle| must be called from the same thread.
+// The caller must not touch any state accessed by |consumer| unless
+// |WaitForIdle| has returned and no blobs were pushed since.
+class TraceIngestionThread {
+ public:
+  using Consumer = std::function<base::Status(TraceBlobView)>;
+
+  static constexpr size_t kDefaultMaxQueuedBytes = 64ul * 1024 * 1024;
+
+  explicit TraceIngestionThread(
+      Consumer consumer,
+      size_t max_queued_bytes = kDefaultMaxQueuedBytes);
+
+  // Drops any blob which has not been consumed yet, waits for the blob
+  // currently being consumed (if any) and joins the ingestion thread.
+  ~TraceIngestionThread();
+
+  TraceIngestionThread(const TraceIngestionThread&) = delete;
+  TraceIngestionThread& operator=(const TraceIngestionThread&) = delete;
+
+  // Enqueues |blob| to be passed to the consumer, copying it if other views
+  // share its TraceBlob. Blocks while the queue is full. Returns the error of
+  // the consumer if a previous blob failed.
+  base::Status Push(TraceBlobView blob);
+
+  // Blocks until all the pushed blobs have been consumed. Returns the error of
+  // the consumer if any blob failed.
+  base::Status WaitForIdle();
+
+ private:
+  void RunThreadLoop();
+
+  const Consumer consumer_;
+  const size_t max_queued_bytes_;
+
+  std::mutex mutex_;
+  std::condition_variable consumer_cv_;
+  std::condition_variable producer_cv_;
+  std::deque<TraceBlobView> queue_ PERFETTO_GUARDED_BY(mutex_);
+  size_t queued_bytes_ PERFETTO_GUARDED_BY(mutex_) = 0;
+  bool busy_ PERFETTO_GUARDED_BY(mutex_) = false;
+  bool quit_ PERFETTO_GUARDED_BY(mutex_) = false;
+  base::Status status_ PERFETTO_GUARDED_BY(mutex_);
+
+  std::thread thread_;
+};
+
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_TRACE_INGESTION_THREAD_H_
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/trace_ingestion_thread.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/waitable_event.h"
+#include "perfetto/trace_processor/trace_blob.h"
+#include "perfetto/trace_processor/trace_blob_view.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+TraceBlobView ToBlob(const std::string& str) {
+  return TraceBlobView(TraceBlob::CopyFrom(str.data(), str.size()));
+}
+
+TEST(TraceIngestionThreadTest, ConsumesInOrder) {
+  std::string consumed;
+  TraceIngestionThread ingestion([&consumed](TraceBlobView blob) {
+    consumed.append(reinterpret_cast<const char*>(blob.data()), blob.size());
+    return base::OkStatus();
+  });
+  for (const char* chunk : {"ab", "cd", "ef", "gh"}) {
+    ASSERT_TRUE(ingestion.Push(ToBlob(chunk)).ok());
+  }
+  ASSERT_TRUE(ingestion.WaitForIdle().ok());
+  ASSERT_EQ(consumed, "abcdefgh");
+}
+
+TEST(TraceIngestionThreadTest, MovesUniqueBlobs) {
+  const uint8_t* consumed_data = nullptr;
+  TraceIngestionThread ingestion([&consumed_data](TraceBlobView blob) {
+    consumed_data = blob.data();
+    return base::OkStatus();
+  });
+  TraceBlobView blob = ToBlob("0123456789");
+  const uint8_t* data = blob.data();
+  ASSERT_TRUE(ingestion.Push(std::move(blob)).ok());
+  ASSERT_TRUE(ingestion.WaitForIdle().ok());
+  ASSERT_EQ(consumed_data, data);
+}
+
+TEST(TraceIngestionThreadTest, CopiesSharedBlobs) {
+  std::string consumed;
+  std::vector<const uint8_t*> consumed_data;
+  TraceIngestionThread ingestion([&](TraceBlobView blob) {
+    consumed.append(reinterpret_cast<const char*>(blob.data()), blob.size());
+    consumed_data.push_back(blob.data());
+    return base::OkStatus();
+  });
+  TraceBlobView whole = ToBlob("0123456789");
+  ASSERT_TRUE(ingestion.Push(whole.slice_off(0, 5)).ok());
+  ASSERT_TRUE(ingestion.Push(whole.slice_off(5, 5)).ok());
+  ASSERT_TRUE(ingestion.WaitForIdle().ok());
+  ASSERT_EQ(consumed, "0123456789");
+  ASSERT_EQ(consumed_data.size(), 2u);
+  ASSERT_NE(consumed_data[0], whole.data());
+  ASSERT_NE(consumed_data[1], whole.data() + 5);
+}
+
+TEST(TraceIngestionThreadTest, BlocksWhenFull) {
+  base::WaitableEvent consumer_started;
+  base::WaitableEvent unblock_consumer;
+  std::vector<size_t> sizes;
+  TraceIngestionThread ingestion(
+      [&](TraceBlobView blob) {
+        if (sizes.empty()) {
+          consumer_started.Notify();
+          unblock_consumer.Wait();
+        }
+        sizes.push_back(blob.size());
+        return base::OkStatus();
+      },
+      /*max_queued_bytes=*/4);
+
+  // A blob bigger than the limit is accepted if the queue is empty.
+  ASSERT_TRUE(ingestion.Push(ToBlob("abcdef")).ok());
+  consumer_started.Wait();
+  unblock_consumer.Notify();
+  ASSERT_TRUE(ingestion.Push(ToBlob("ab")).ok());
+  ASSERT_TRUE(ingestion.Push(ToBlob("cd")).ok());
+  ASSERT_TRUE(ingestion.Push(ToBlob("e")).ok());
+  ASSERT_TRUE(ingestion.WaitForIdle().ok());
+  ASSERT_THAT(sizes, testing::ElementsAre(6u, 2u, 2u, 1u));
+}
+
+TEST(TraceIngestionThreadTest, ErrorIsSticky) {
+  uint32_t calls = 0;
+  TraceIngestionThread ingestion([&calls](TraceBlobView blob) {
+    ++calls;
+    if (blob.size() == 3) {
+      return base::ErrStatus("Bad blob");
+    }
+    return base::OkStatus();
+  });
+  ASSERT_TRUE(ingestion.Push(ToBlob("a")).ok());
+  ASSERT_TRUE(ingestion.Push(ToBlob("abc")).ok());
+  base::Status status = ingestion.WaitForIdle();
+  ASSERT_FALSE(status.ok());
+  ASSERT_EQ(status.message(), "Bad blob");
+
+  status = ingestion.Push(ToBlob("a"));
+  ASSERT_FALSE(status.ok());
+  ASSERT_EQ(status.message(), "Bad blob");
+  ASSERT_FALSE(ingestion.WaitForIdle().ok());
+  ASSERT_EQ(calls, 2u);
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor
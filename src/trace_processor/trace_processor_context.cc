@@ -16,11 +16,13 @@
 
 #include "src/trace_processor/types/trace_processor_context.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <optional>
 #include <utility>
 
+#include "perfetto/base/build_config.h"
 #include "perfetto/base/logging.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "src/trace_processor/forwarding_trace_parser.h"
@@ -50,6 +52,7 @@
 #include "src/trace_processor/storage/trace_storage.h"
 #include "src/trace_processor/trace_reader_registry.h"
 #include "src/trace_processor/types/trace_processor_context_ptr.h"
+#include "src/trace_processor/util/parallel_for.h"
 
 namespace perfetto::trace_processor {
 namespace {
@@ -136,8 +139,12 @@ Ptr<TraceSorter> CreateSorter(TraceProcessorContext* context,
       event_handling = TraceSorter::EventHandling::kSortAndDrop;
     }
   }
+  uint64_t memory_budget_bytes = 0;
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WASM)
+  memory_budget_bytes = config.sorter_memory_budget_bytes;
+#endif
   return Ptr<TraceSorter>::MakeRoot(context, TraceSorter::SortingMode::kDefault,
-                                    event_handling);
+                                    event_handling, memory_budget_bytes);
 }
 
 void InitGlobalState(TraceProcessorContext* context, const Config& config) {
@@ -158,6 +165,9 @@ void InitGlobalState(TraceProcessorContext* context, const Config& config) {
   context->stack_profile_tracker = Ptr<StackProfileTracker>::MakeRoot(context);
   context->deobfuscation_tracker = nullptr;
   context->register_additional_proto_modules = nullptr;
+  context->decompression_thread_pool = Ptr<util::LazyThreadPool>::MakeRoot(
+      std::min(config.decompression_parallelism,
+               util::GetDefaultParallelism()));
 
   // Per-Trace State (Miscategorized).
   context->metadata_tracker =
@@ -183,6 +193,7 @@ void CopyGlobalState(const TraceProcessorContext* source,
   dest->track_group_idx_state = source->track_group_idx_state.Fork();
   dest->register_additional_proto_modules =
       source->register_additional_proto_modules;
+  dest->decompression_thread_pool = source->decompression_thread_pool.Fork();
 
   // Per-Trace State (Miscategorized).
   dest->metadata_tracker = source->metadata_tracker.Fork();
@@ -16,6 +16,8 @@
 
 #include "src/trace_processor/trace_processor_impl.h"
 
+#include <fcntl.h>
+
 #include <algorithm>
 #include <cinttypes>
 #include <cstddef>
@@ -35,7 +37,10 @@
 #include "perfetto/base/thread_utils.h"
 #include "perfetto/base/time.h"
 #include "perfetto/ext/base/clock_snapshots.h"
+#include "perfetto/ext/base/file_utils.h"
 #include "perfetto/ext/base/flat_hash_map.h"
+#include "perfetto/ext/base/scoped_file.h"
+#include "perfetto/ext/base/scoped_mmap.h"
 #include "perfetto/ext/base/small_vector.h"
 #include "perfetto/ext/base/status_macros.h"
 #include "perfetto/ext/base/status_or.h"
@@ -48,6 +53,7 @@
 #include "perfetto/trace_processor/trace_blob.h"
 #include "perfetto/trace_processor/trace_blob_view.h"
 #include "perfetto/trace_processor/trace_processor.h"
+#include "src/trace_processor/core/util/snapshot.h"
 #include "src/trace_processor/forwarding_trace_parser.h"
 #include "src/trace_processor/importers/android_bugreport/android_dumpstate_event_parser.h"
 #include "src/trace_processor/importers/android_bugreport/android_dumpstate_reader.h"
@@ -56,6 +62,7 @@
 #include "src/trace_processor/importers/archive/gzip_trace_parser.h"
 #include "src/trace_processor/importers/archive/tar_trace_reader.h"
 #include "src/trace_processor/importers/archive/zip_trace_reader.h"
+#include "src/trace_processor/importers/archive/zstd_trace_parser.h"
 #include "src/trace_processor/importers/art_hprof/art_hprof_parser.h"
 #include "src/trace_processor/importers/art_method/art_method_tokenizer.h"
 #include "src/trace_processor/importers/collapsed_stack/collapsed_stack_trace_reader.h"
@@ -93,6 +100,8 @@
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/counter_intervals.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/create_function.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/create_view_function.h"
+#include "src/trace_processor/perfetto_sql/intrinsics/functions/dataframe_group_by.h"
+#include "src/trace_processor/perfetto_sql/intrinsics/functions/dataframe_join.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/dominator_tree.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/graph_scan.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/graph_traversal.h"
@@ -149,12 +158,14 @@
 #include "src/trace_processor/types/trace_processor_context.h"
 #include "src/trace_processor/util/descriptors.h"
 #include "src/trace_processor/util/gzip_utils.h"
+#include "src/trace_processor/util/parallel_for.h"
 #include "src/trace_processor/util/protozero_to_json.h"
 #include "src/trace_processor/util/protozero_to_text.h"
 #include "src/trace_processor/util/regex.h"
 #include "src/trace_processor/util/simple_json_parser.h"
 #include "src/trace_processor/util/sql_modules.h"
 #include "src/trace_processor/util/trace_type.h"
+#include "src/trace_processor/util/zstd_utils.h"
 
 #include "protos/perfetto/trace/clock_snapshot.pbzero.h"
 #include "protos/perfetto/trace/perfetto/perfetto_metatrace.pbzero.h"
@@ -486,7 +497,14 @@ std::pair<int64_t, int64_t> GetTraceTimestampBoundsNs(
 }  // namespace
 
 TraceProcessorImpl::TraceProcessorImpl(const Config& cfg)
-    : TraceProcessorStorageImpl(cfg), config_(cfg) {
+    : TraceProcessorStorageImpl(cfg),
+      config_(cfg),
+      query_thread_pool_(util::MaybeCreateThreadPool(
+          std::min(cfg.query_parallelism, util::GetDefaultParallelism()))) {
+  if (cfg.enable_string_pool_trigram_index) {
+    string_pool_trigram_index_ = std::make_unique<StringPoolTrigramIndex>(
+        context()->storage->mutable_string_pool());
+  }
   context()->register_additional_proto_modules = &RegisterAdditionalModules;
   context()->reader_registry->RegisterTraceReader<AndroidDumpstateReader>(
       kAndroidDumpstateTraceType);
@@ -522,6 +540,10 @@ TraceProcessorImpl::TraceProcessorImpl(const Config& cfg)
         kCtraceTraceType);
     context()->reader_registry->RegisterTraceReader<ZipTraceReader>(kZipFile);
   }
+  if constexpr (util::IsZstdSupported()) {
+    context()->reader_registry->RegisterTraceReader<ZstdTraceParser>(
+        kZstdTraceType);
+  }
   context()->reader_registry->RegisterTraceReader<JsonTraceTokenizer>(
       kJsonTraceType);
   context()
@@ -596,6 +618,8 @@ TraceProcessorImpl::TraceProcessorImpl(const Config& cfg)
       context(), context()->storage.get(), config_, registered_sql_packages_,
       sql_metrics_, &metrics_descriptor_pool_, &proto_fn_name_to_path_, this,
       notify_eof_called_, cached_trace_bounds_);
+  engine_->SetDataframeThreadPool(query_thread_pool_.get());
+  engine_->SetDataframeStringPoolTrigramIndex(string_pool_trigram_index_.get());
 
   sqlite_objects_post_prelude_ = engine_->SqliteRegisteredObjectCount();
 
@@ -616,7 +640,9 @@ TraceProcessorImpl::TraceProcessorImpl(const Config& cfg)
                          context()->storage->mutable_string_pool());
 }
 
-TraceProcessorImpl::~TraceProcessorImpl() = default;
+TraceProcessorImpl::~TraceProcessorImpl() {
+  StopIngestionThread();
+}
 
 // =================================================================
 // |        TraceProcessorStorage implementation starts here       |
@@ -673,9 +699,18 @@ base::Status TraceProcessorImpl::NotifyEndOfFile() {
 
   TraceProcessorStorageImpl::DestroyContext();
   context()->storage->ShrinkToFitTables();
+  size_t encoding_bytes_saved = 0;
   for (const auto& table : GetStaticTables(context()->storage.get())) {
     table.dataframe->Finalize();
+    if (config_.enable_dataframe_column_encoding) {
+      encoding_bytes_saved += table.dataframe->EncodeColumns();
+    }
   }
+  if (config_.enable_dataframe_column_encoding) {
+    context()->storage->SetStats(stats::dataframe_encoding_bytes_saved,
+                                 static_cast<int64_t>(encoding_bytes_saved));
+  }
+  context()->storage->FinalizeTables();
 
   IncludeAfterEofPrelude(engine_.get());
   sqlite_objects_post_prelude_ = engine_->SqliteRegisteredObjectCount();
@@ -949,6 +984,8 @@ size_t TraceProcessorImpl::RestoreInitialTables() {
       context(), context()->storage.get(), config_, registered_sql_packages_,
       sql_metrics_, &metrics_descriptor_pool_, &proto_fn_name_to_path_, this,
       notify_eof_called_, cached_trace_bounds_);
+  engine_->SetDataframeThreadPool(query_thread_pool_.get());
+  engine_->SetDataframeStringPoolTrigramIndex(string_pool_trigram_index_.get());
 
   // The registered count should now be the same as it was in the constructor.
   uint64_t registered_count_after = engine_->SqliteRegisteredObjectCount();
@@ -956,6 +993,63 @@ size_t TraceProcessorImpl::RestoreInitialTables() {
   return static_cast<size_t>(registered_count_before - registered_count_after);
 }
 
+base::Status TraceProcessorImpl::SaveSnapshot(const std::string& path) {
+  if (!notify_eof_called_) {
+    return base::ErrStatus(
+        "SaveSnapshot: NotifyEndOfFile must be called before saving a "
+        "snapshot");
+  }
+  base::ScopedFile fd(base::OpenFile(path, O_CREAT | O_WRONLY | O_TRUNC, 0644));
+  if (!fd) {
+    return base::ErrStatus("SaveSnapshot: unable to open %s", path.c_str());
+  }
+  core::SnapshotWriter writer(std::move(fd));
+  writer.WriteI64(cached_trace_bounds_.first);
+  writer.WriteI64(cached_trace_bounds_.second);
+  context()->storage->SerializeToSnapshot(&writer);
+  return writer.Finish();
+}
+
+base::Status TraceProcessorImpl::LoadSnapshot(const std::string& path) {
+  if (notify_eof_called_ || bytes_parsed_ != 0) {
+    return base::ErrStatus(
+        "LoadSnapshot: must be called before any trace data is parsed");
+  }
+#if PERFETTO_HAS_MMAP()
+  base::ScopedMmap mapping = base::ReadMmapWholeFile(path);
+  if (!mapping.IsValid()) {
+    return base::ErrStatus("LoadSnapshot: unable to map %s", path.c_str());
+  }
+  ASSIGN_OR_RETURN(
+      core::SnapshotReader reader,
+      core::SnapshotReader::Create(static_cast<const uint8_t*>(mapping.data()),
+                                   mapping.length()));
+  ASSIGN_OR_RETURN(int64_t start_ns, reader.ReadI64());
+  ASSIGN_OR_RETURN(int64_t end_ns, reader.ReadI64());
+  bytes_parsed_ = mapping.length();
+  RETURN_IF_ERROR(
+      context()->storage->LoadFromSnapshot(&reader, std::move(mapping)));
+  if (!reader.AtEnd()) {
+    return base::ErrStatus("LoadSnapshot: unexpected data at end of file");
+  }
+
+  // Do the same work as NotifyEndOfFile() minus anything touching the tables:
+  // they were already finalized when the snapshot was written.
+  notify_eof_called_ = true;
+  if (current_trace_name_.empty())
+    current_trace_name_ = "Unnamed trace";
+  cached_trace_bounds_ = {start_ns, end_ns};
+  BuildBoundsTable(engine_->sqlite_engine()->db(), cached_trace_bounds_);
+  TraceProcessorStorageImpl::DestroyContext();
+  IncludeAfterEofPrelude(engine_.get());
+  sqlite_objects_post_prelude_ = engine_->SqliteRegisteredObjectCount();
+  return base::OkStatus();
+#else
+  base::ignore_result(path);
+  return base::ErrStatus("LoadSnapshot: not supported on this platform");
+#endif
+}
+
 // =================================================================
 // |  Trace-based metrics (v1) related functionality starts here   |
 // =================================================================
@@ -1282,8 +1376,8 @@ std::unique_ptr<PerfettoSqlEngine> TraceProcessorImpl::InitPerfettoSqlEngine(
   RegisterFunction<PackageLookup>(
       engine.get(), std::make_unique<PackageLookup::Context>(storage));
 
-  if constexpr (regex::IsRegexSupported()) {
-    RegisterFunction<Regexp>(engine.get());
+  RegisterFunction<Regexp>(engine.get());
+  if constexpr (regex::IsSubmatchSupported()) {
     RegisterFunction<RegexpExtract>(engine.get());
   }
 
@@ -1416,6 +1510,22 @@ std::unique_ptr<PerfettoSqlEngine> TraceProcessorImpl::InitPerfettoSqlEngine(
   engine->RegisterVirtualTableModule<StatsModule>("stats", storage);
   engine->RegisterVirtualTableModule<TablePointerModule>(
       "__intrinsic_table_ptr", nullptr);
+  {
+    base::Status status = perfetto_sql::RegisterDataframeGroupByFunction(
+        *engine, storage->mutable_string_pool());
+    if (!status.ok())
+      PERFETTO_FATAL("%s", status.c_message());
+  }
+  {
+    base::Status status = perfetto_sql::RegisterDataframeJoinFunction(
+        *engine, storage->mutable_string_pool());
+    if (!status.ok())
+      PERFETTO_FATAL("%s", status.c_message());
+  }
+  if (config.enable_dataframe_query_rewrites) {
+    engine->EnableDataframeGroupByRewrite();
+    engine->EnableDataframeJoinRewrite();
+  }
 
   // Value table aggregate functions.
   engine->RegisterAggregateFunction<DominatorTree>(
@@ -1451,6 +1561,8 @@ std::unique_ptr<PerfettoSqlEngine> TraceProcessorImpl::InitPerfettoSqlEngine(
 
   if (notify_eof_called) {
     IncludeAfterEofPrelude(engine.get());
+  } else if (config.enable_prelude_views_before_eof) {
+    IncludeAfterEofPreludeViews(engine.get());
   }
 
   for (const auto& metric : sql_metrics) {
@@ -1474,6 +1586,25 @@ void TraceProcessorImpl::IncludeAfterEofPrelude(PerfettoSqlEngine* engine) {
   }
 }
 
+void TraceProcessorImpl::IncludeAfterEofPreludeViews(
+    PerfettoSqlEngine* engine) {
+  // The modules of prelude.after_eof which only define views, functions and
+  // macros over the intrinsic tables: unlike the tables and indexes of the
+  // rest of the prelude (e.g. the *_counter_track tables), they don't go stale
+  // as more data is parsed. The only table they create (the stats key to
+  // severity mapping) depends on static data. The rest of the prelude is
+  // included by IncludeAfterEofPrelude() at EOF.
+  auto result = engine->Execute(SqlSource::FromTraceProcessorImplementation(
+      "INCLUDE PERFETTO MODULE prelude.after_eof.core;"
+      "INCLUDE PERFETTO MODULE prelude.after_eof.views;"
+      "INCLUDE PERFETTO MODULE prelude.after_eof.slices;"
+      "INCLUDE PERFETTO MODULE prelude.after_eof.cpu_scheduling;"
+      "INCLUDE PERFETTO MODULE prelude.after_eof.memory;"));
+  if (!result.status().ok()) {
+    PERFETTO_FATAL("Failed to import prelude: %s", result.status().c_message());
+  }
+}
+
 bool TraceProcessorImpl::IsRootMetricField(const std::string& metric_name) {
   std::optional<uint32_t> desc_idx = metrics_descriptor_pool_.FindDescriptorIdx(
       ".perfetto.protos.TraceMetrics");
@@ -28,9 +28,11 @@
 #include <vector>
 
 #include "perfetto/base/status.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "perfetto/trace_processor/trace_blob_view.h"
 #include "perfetto/trace_processor/trace_processor.h"
+#include "src/trace_processor/containers/string_pool_trigram_index.h"
 #include "src/trace_processor/iterator_impl.h"
 #include "src/trace_processor/metrics/metrics.h"
 #include "src/trace_processor/perfetto_sql/engine/perfetto_sql_engine.h"
@@ -107,6 +109,9 @@ class TraceProcessorImpl : public TraceProcessor,
 
   size_t RestoreInitialTables() override;
 
+  base::Status SaveSnapshot(const std::string& path) override;
+  base::Status LoadSnapshot(const std::string& path) override;
+
   // =================================================================
   // |  Trace-based metrics (v1) related functionality starts here   |
   // =================================================================
@@ -166,9 +171,20 @@ class TraceProcessorImpl : public TraceProcessor,
                              PerfettoSqlEngine* engine);
 
   static void IncludeAfterEofPrelude(PerfettoSqlEngine*);
+  static void IncludeAfterEofPreludeViews(PerfettoSqlEngine*);
 
   const Config config_;
 
+  // Pool used to execute filters on large tables in parallel. Null if
+  // |Config::query_parallelism| <= 1. Declared before |engine_| as the engine
+  // uses it.
+  std::unique_ptr<base::ThreadPool> query_thread_pool_;
+
+  // Index over the storage string pool used to speed up GLOB filters. Null if
+  // |Config::enable_string_pool_trigram_index| is false. Declared before
+  // |engine_| as the engine uses it.
+  std::unique_ptr<StringPoolTrigramIndex> string_pool_trigram_index_;
+
   std::unique_ptr<PerfettoSqlEngine> engine_;
 
   DescriptorPool metrics_descriptor_pool_;
@@ -65,6 +65,7 @@
 #include "src/profiling/symbolizer/local_symbolizer.h"
 #include "src/profiling/symbolizer/symbolize_database.h"
 #include "src/profiling/symbolizer/symbolizer.h"
+#include "src/trace_processor/core/util/snapshot.h"
 #include "src/trace_processor/metrics/all_chrome_metrics.descriptor.h"
 #include "src/trace_processor/metrics/all_webview_metrics.descriptor.h"
 #include "src/trace_processor/metrics/metrics.descriptor.h"
@@ -77,6 +78,8 @@
 #include "protos/perfetto/trace_processor/trace_processor.pbzero.h"
 
 #if PERFETTO_BUILDFLAG(PERFETTO_TP_HTTPD)
+#include <sqlite3.h>
+
 #include "src/trace_processor/rpc/httpd.h"
 #endif
 
@@ -728,11 +731,20 @@ struct CommandLineOptions {
   std::string port_number;
   std::string listen_ip;
   std::vector<std::string> additional_cors_origins;
+  uint32_t http_max_sessions = 0;
   bool enable_stdiod = false;
   bool launch_shell = false;
 
   bool force_full_sort = false;
   bool no_ftrace_raw = false;
+  bool read_ahead = false;
+  bool follow = false;
+  uint64_t sorter_memory_budget_mb = 0;
+  bool encode_dataframe_columns = false;
+  bool dataframe_query_rewrites = false;
+  uint32_t query_parallelism = 0;
+  uint32_t decompression_parallelism = 0;
+  bool string_trigram_index = false;
 
   std::string query_file_path;
   std::string query_string;
@@ -758,6 +770,7 @@ struct CommandLineOptions {
   std::vector<std::string> dev_flags;
   bool extra_checks = false;
   std::string export_file_path;
+  std::string snapshot_file_path;
   std::string perf_file_path;
   bool wide = false;
   bool analyze_trace_proto_content = false;
@@ -790,6 +803,10 @@ Behavioural:
                                       HTTP RPC server. These are in addition to
                                       the default origins: [https://ui.perfetto.dev,
                                       http://localhost:10000, http://127.0.0.1:10000]
+ --http-max-sessions N                Allows the HTTP RPC server to load and
+                                      query up to N traces in parallel, each
+                                      in its own session, selected by the
+                                      X-Perfetto-Session-Id request header.
  --stdiod                             Enables the stdio RPC server.
  -i, --interactive                    Starts interactive mode even after
                                       executing some other commands (-q, -Q,
@@ -804,6 +821,38 @@ Parsing:
                                       reduces the memory usage of trace
                                       processor when loading traces containing
                                       ftrace events.
+ --read-ahead                         Ingests the trace on a dedicated thread,
+                                      so that reading the trace file overlaps
+                                      with ingesting it. Tokenization,
+                                      sorting and parsing still run on a
+                                      single thread.
+ --follow                             Keeps reading the data appended to the
+                                      trace file while it is being written
+                                      (e.g. by traced with write_into_file).
+                                      Each query run with --httpd, --stdiod or
+                                      the interactive shell first ingests the
+                                      new data and sees all the events sorted
+                                      so far. Not compatible with
+                                      --read-ahead.
+ --sorter-memory-budget-mb MB         Spills events waiting to be sorted to
+                                      temporary files (in $TMPDIR) once they
+                                      use more than MB megabytes of memory.
+                                      Allows loading traces larger than the
+                                      available memory.
+ --encode-dataframe-columns           Stores integer columns in a compressed
+                                      form once the trace is loaded, reducing
+                                      memory use at some cost to query speed.
+ --dataframe-query-rewrites           Computes simple GROUP BY queries and
+                                      joins inside the tables' dataframes
+                                      instead of by SQLite.
+ --query-parallelism N                Filters large tables using up to N
+                                      threads (capped at the number of cores).
+ --decompression-parallelism N        Inflates zip entries and multi-member
+                                      gzip files using up to N threads
+                                      (capped at the number of cores).
+ --string-trigram-index               Indexes interned strings to speed up
+                                      substring GLOB queries at the cost of
+                                      extra memory.
 
 PerfettoSQL:
  -q, --query-file FILE                Read and execute an SQL query from a file.
@@ -905,6 +954,13 @@ Advanced:
  -e, --export FILE                    Export the contents of trace processor
                                       into an SQLite database after running any
                                       metrics or queries specified.
+ --save-snapshot FILE                 Saves the tables of trace processor into
+                                      a snapshot file after running any metrics
+                                      or queries specified. Passing a snapshot
+                                      as the trace file loads it back much
+                                      faster than re-parsing the trace. Only
+                                      loadable by the same trace processor
+                                      build.
  -p, --perf-file FILE                 Writes the time taken to ingest the trace
                                       and execute the queries to the given file.
                                       Only valid with -q or --run-metrics and
@@ -984,10 +1040,19 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
     OPT_HTTP_PORT = 1000,
     OPT_HTTP_IP,
     OPT_HTTP_ADDITIONAL_CORS_ORIGINS,
+    OPT_HTTP_MAX_SESSIONS,
     OPT_STDIOD,
 
     OPT_FORCE_FULL_SORT,
     OPT_NO_FTRACE_RAW,
+    OPT_READ_AHEAD,
+    OPT_FOLLOW,
+    OPT_SORTER_MEMORY_BUDGET_MB,
+    OPT_ENCODE_DATAFRAME_COLUMNS,
+    OPT_DATAFRAME_QUERY_REWRITES,
+    OPT_QUERY_PARALLELISM,
+    OPT_DECOMPRESSION_PARALLELISM,
+    OPT_STRING_TRIGRAM_INDEX,
 
     OPT_ADD_SQL_PACKAGE,
     OPT_OVERRIDE_SQL_PACKAGE,
@@ -1006,6 +1071,7 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
     OPT_DEV,
     OPT_DEV_FLAG,
     OPT_EXTRA_CHECKS,
+    OPT_SAVE_SNAPSHOT,
     OPT_ANALYZE_TRACE_PROTO_CONTENT,
     OPT_CROP_TRACK_EVENTS,
     OPT_REGISTER_FILES_DIR,
@@ -1026,11 +1092,24 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
       {"http-ip-address", required_argument, nullptr, OPT_HTTP_IP},
       {"http-additional-cors-origins", required_argument, nullptr,
        OPT_HTTP_ADDITIONAL_CORS_ORIGINS},
+      {"http-max-sessions", required_argument, nullptr, OPT_HTTP_MAX_SESSIONS},
       {"stdiod", no_argument, nullptr, OPT_STDIOD},
       {"interactive", no_argument, nullptr, 'i'},
 
       {"full-sort", no_argument, nullptr, OPT_FORCE_FULL_SORT},
       {"no-ftrace-raw", no_argument, nullptr, OPT_NO_FTRACE_RAW},
+      {"read-ahead", no_argument, nullptr, OPT_READ_AHEAD},
+      {"follow", no_argument, nullptr, OPT_FOLLOW},
+      {"sorter-memory-budget-mb", required_argument, nullptr,
+       OPT_SORTER_MEMORY_BUDGET_MB},
+      {"encode-dataframe-columns", no_argument, nullptr,
+       OPT_ENCODE_DATAFRAME_COLUMNS},
+      {"dataframe-query-rewrites", no_argument, nullptr,
+       OPT_DATAFRAME_QUERY_REWRITES},
+      {"query-parallelism", required_argument, nullptr, OPT_QUERY_PARALLELISM},
+      {"decompression-parallelism", required_argument, nullptr,
+       OPT_DECOMPRESSION_PARALLELISM},
+      {"string-trigram-index", no_argument, nullptr, OPT_STRING_TRIGRAM_INDEX},
 
       {"query-file", required_argument, nullptr, 'q'},
       {"query-string", required_argument, nullptr, 'Q'},
@@ -1060,6 +1139,7 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
       {"dev-flag", required_argument, nullptr, OPT_DEV_FLAG},
       {"extra-checks", no_argument, nullptr, OPT_EXTRA_CHECKS},
       {"export", required_argument, nullptr, 'e'},
+      {"save-snapshot", required_argument, nullptr, OPT_SAVE_SNAPSHOT},
       {"perf-file", required_argument, nullptr, 'p'},
       {"wide", no_argument, nullptr, 'W'},
       {"analyze-trace-proto-content", no_argument, nullptr,
@@ -1136,6 +1216,12 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
       continue;
     }
 
+    if (option == OPT_HTTP_MAX_SESSIONS) {
+      command_line_options.http_max_sessions =
+          static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
+      continue;
+    }
+
     if (option == OPT_STDIOD) {
       command_line_options.enable_stdiod = true;
       continue;
@@ -1178,6 +1264,49 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
       continue;
     }
 
+    if (option == OPT_READ_AHEAD) {
+      command_line_options.read_ahead = true;
+      continue;
+    }
+
+    if (option == OPT_FOLLOW) {
+      command_line_options.follow = true;
+      continue;
+    }
+
+    if (option == OPT_SORTER_MEMORY_BUDGET_MB) {
+      command_line_options.sorter_memory_budget_mb =
+          static_cast<uint64_t>(strtoull(optarg, nullptr, 10));
+      continue;
+    }
+
+    if (option == OPT_ENCODE_DATAFRAME_COLUMNS) {
+      command_line_options.encode_dataframe_columns = true;
+      continue;
+    }
+
+    if (option == OPT_DATAFRAME_QUERY_REWRITES) {
+      command_line_options.dataframe_query_rewrites = true;
+      continue;
+    }
+
+    if (option == OPT_QUERY_PARALLELISM) {
+      command_line_options.query_parallelism =
+          static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
+      continue;
+    }
+
+    if (option == OPT_DECOMPRESSION_PARALLELISM) {
+      command_line_options.decompression_parallelism =
+          static_cast<uint32_t>(strtoul(optarg, nullptr, 10));
+      continue;
+    }
+
+    if (option == OPT_STRING_TRIGRAM_INDEX) {
+      command_line_options.string_trigram_index = true;
+      continue;
+    }
+
     if (option == OPT_ANALYZE_TRACE_PROTO_CONTENT) {
       command_line_options.analyze_trace_proto_content = true;
       continue;
@@ -1193,6 +1322,11 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
       continue;
     }
 
+    if (option == OPT_SAVE_SNAPSHOT) {
+      command_line_options.snapshot_file_path = optarg;
+      continue;
+    }
+
     if (option == OPT_EXTRA_CHECKS) {
       command_line_options.extra_checks = true;
       continue;
@@ -1289,6 +1423,7 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
        command_line_options.query_string.empty() &&
        command_line_options.structured_query_id.empty() &&
        command_line_options.export_file_path.empty() &&
+       command_line_options.snapshot_file_path.empty() &&
        !command_line_options.summary);
 
   // Only allow non-interactive queries to emit perf data.
@@ -1332,10 +1467,32 @@ void ExtendPoolWithBinaryDescriptor(
   }
 }
 
+bool IsSnapshotFile(const std::string& path) {
+  base::ScopedFile fd = base::OpenFile(path, O_RDONLY);
+  if (!fd) {
+    return false;
+  }
+  uint8_t magic[core::kSnapshotMagicSize];
+  ssize_t rsize = base::Read(*fd, magic, sizeof(magic));
+  return rsize == static_cast<ssize_t>(sizeof(magic)) &&
+         core::IsSnapshot(magic, sizeof(magic));
+}
+
 base::Status LoadTrace(TraceProcessor* trace_processor,
                        TraceProcessorShell::PlatformInterface* platform,
                        const std::string& trace_file_path,
                        double* size_mb) {
+  if (IsSnapshotFile(trace_file_path)) {
+    base::Status status = trace_processor->LoadSnapshot(trace_file_path);
+    if (!status.ok()) {
+      return base::ErrStatus("Could not load snapshot (path: %s): %s",
+                             trace_file_path.c_str(), status.c_message());
+    }
+    uint64_t file_size = base::GetFileSize(trace_file_path).value_or(0);
+    *size_mb = static_cast<double>(file_size) / 1E6;
+    return base::OkStatus();
+  }
+
   base::Status load_status = platform->LoadTrace(
       trace_processor, trace_file_path, [&size_mb](size_t parsed_size) {
         *size_mb = static_cast<double>(parsed_size) / 1E6;
@@ -1804,12 +1961,33 @@ Available commands:
 )");
 }
 
+void MaybeFollowTrace(TraceProcessor* trace_processor,
+                      TraceFileFollower* follower) {
+  if (!follower)
+    return;
+  base::Status status = follower->ReadNewData(trace_processor);
+  if (!status.ok())
+    PERFETTO_ELOG("%s", status.c_message());
+}
+
+// Ingests the data appended to the followed trace before each RPC query.
+void MaybeFollowTraceInRpc(Rpc* rpc, TraceFileFollower* follower) {
+  if (!follower)
+    return;
+  rpc->SetBeforeQueryHook([follower](TraceProcessor* tp) {
+    MaybeFollowTrace(tp, follower);
+  });
+}
+
 struct InteractiveOptions {
   uint32_t column_width;
   MetricV1OutputFormat metric_v1_format;
   std::vector<MetricExtension> extensions;
   std::vector<MetricNameAndPath> metrics;
   const google::protobuf::DescriptorPool* pool;
+  // Set in --follow mode: ingests the data appended to the trace file before
+  // each query.
+  TraceFileFollower* follower;
 };
 
 base::Status StartInteractiveShell(TraceProcessor* trace_processor,
@@ -1863,6 +2041,7 @@ base::Status StartInteractiveShell(TraceProcessor* trace_processor,
           continue;
         }
 
+        MaybeFollowTrace(trace_processor, options.follower);
         base::Status status = RunMetrics(trace_processor, options.metrics,
                                          options.metric_v1_format);
         if (!status.ok()) {
@@ -1874,6 +2053,7 @@ base::Status StartInteractiveShell(TraceProcessor* trace_processor,
       continue;
     }
 
+    MaybeFollowTrace(trace_processor, options.follower);
     base::TimeNanos t_start = base::GetWallTimeNs();
     auto it = trace_processor->ExecuteQuery(line.get());
     PrintQueryResultInteractively(&it, t_start, column_width);
@@ -1984,6 +2164,10 @@ TraceSummaryOutputSpec::Format GetSummaryOutputFormat(
 
 class DefaultPlatformInterface : public TraceProcessorShell::PlatformInterface {
  public:
+  // |read_ahead| is owned by the shell and set once the command line has been
+  // parsed.
+  explicit DefaultPlatformInterface(const bool* read_ahead)
+      : read_ahead_(read_ahead) {}
   ~DefaultPlatformInterface() override;
 
   Config DefaultConfig() const override { return {}; }
@@ -1996,9 +2180,15 @@ class DefaultPlatformInterface : public TraceProcessorShell::PlatformInterface {
       TraceProcessor* trace_processor,
       const std::string& path,
       std::function<void(size_t)> progress_callback) override {
+    // With read-ahead, chunks sharing the same mapping would be copied before
+    // being handed to the ingestion thread.
     return ReadTraceUnfinalized(trace_processor, path.c_str(),
-                                progress_callback);
+                                progress_callback,
+                                /*map_chunks_separately=*/*read_ahead_);
   }
+
+ private:
+  const bool* read_ahead_;
 };
 
 DefaultPlatformInterface::~DefaultPlatformInterface() = default;
@@ -2017,8 +2207,10 @@ std::unique_ptr<TraceProcessorShell> TraceProcessorShell::Create(
 
 std::unique_ptr<TraceProcessorShell>
 TraceProcessorShell::CreateWithDefaultPlatform() {
-  return std::unique_ptr<TraceProcessorShell>(
-      new TraceProcessorShell(std::make_unique<DefaultPlatformInterface>()));
+  std::unique_ptr<TraceProcessorShell> shell(new TraceProcessorShell(nullptr));
+  shell->platform_interface_ =
+      std::make_unique<DefaultPlatformInterface>(&shell->read_ahead_);
+  return shell;
 }
 
 base::Status TraceProcessorShell::Run(int argc, char** argv) {
@@ -2029,6 +2221,18 @@ base::Status TraceProcessorShell::Run(int argc, char** argv) {
                             ? SortingMode::kForceFullSort
                             : SortingMode::kDefaultHeuristics;
   config.ingest_ftrace_in_raw_table = !options.no_ftrace_raw;
+  config.enable_read_ahead = options.read_ahead;
+  read_ahead_ = options.read_ahead;
+  config.sorter_memory_budget_bytes =
+      options.sorter_memory_budget_mb * 1024 * 1024;
+  config.enable_dataframe_column_encoding = options.encode_dataframe_columns;
+  config.enable_dataframe_query_rewrites = options.dataframe_query_rewrites;
+  config.query_parallelism = options.query_parallelism;
+  config.decompression_parallelism = options.decompression_parallelism;
+  config.enable_string_pool_trigram_index = options.string_trigram_index;
+  // --follow never calls NotifyEndOfFile(): make the prelude views (slice,
+  // sched, thread...) available before it.
+  config.enable_prelude_views_before_eof = options.follow;
   config.analyze_trace_proto_content = options.analyze_trace_proto_content;
   config.drop_track_event_data_before =
       options.crop_track_events
@@ -2092,12 +2296,32 @@ base::Status TraceProcessorShell::Run(int argc, char** argv) {
     RETURN_IF_ERROR(LoadMetricExtension(tp.get(), extension, pool));
   }
 
+  std::unique_ptr<TraceFileFollower> follower;
+  if (options.follow) {
+    if (options.trace_file_path.empty())
+      return base::ErrStatus("--follow requires a trace file");
+    if (options.read_ahead) {
+      return base::ErrStatus(
+          "--follow is not compatible with --read-ahead");
+    }
+    if (IsSnapshotFile(options.trace_file_path))
+      return base::ErrStatus("--follow cannot be used with snapshots");
+    follower = std::make_unique<TraceFileFollower>(options.trace_file_path);
+  }
+
   base::TimeNanos t_load{};
   if (!options.trace_file_path.empty()) {
     base::TimeNanos t_load_start = base::GetWallTimeNs();
     double size_mb = 0;
-    RETURN_IF_ERROR(LoadTrace(tp.get(), platform_interface_.get(),
-                              options.trace_file_path, &size_mb));
+    if (follower) {
+      // The file is not finalized, so symbolization and deobfuscation (which
+      // need the whole trace) are skipped.
+      RETURN_IF_ERROR(follower->ReadNewData(tp.get()));
+      size_mb = static_cast<double>(follower->bytes_read()) / 1E6;
+    } else {
+      RETURN_IF_ERROR(LoadTrace(tp.get(), platform_interface_.get(),
+                                options.trace_file_path, &size_mb));
+    }
     t_load = base::GetWallTimeNs() - t_load_start;
 
     double t_load_s = static_cast<double>(t_load.count()) / 1E9;
@@ -2246,12 +2470,17 @@ base::Status TraceProcessorShell::Run(int argc, char** argv) {
     RETURN_IF_ERROR(ExportTraceToDatabase(tp.get(), options.export_file_path));
   }
 
+  if (!options.snapshot_file_path.empty()) {
+    RETURN_IF_ERROR(tp->SaveSnapshot(options.snapshot_file_path));
+  }
+
   if (options.enable_httpd) {
 #if PERFETTO_BUILDFLAG(PERFETTO_TP_HTTPD)
     Rpc rpc(std::move(tp), !options.trace_file_path.empty(), config,
             [this](TraceProcessor* tp) {
               platform_interface_->OnTraceProcessorCreated(tp);
             });
+    MaybeFollowTraceInRpc(&rpc, follower.get());
 
 #if PERFETTO_HAS_SIGNAL_H()
     static Rpc* g_rpc_for_signal_handler = &rpc;
@@ -2270,11 +2499,34 @@ base::Status TraceProcessorShell::Run(int argc, char** argv) {
       });
     }
 #endif
+    // Sessions run concurrently with each other and with |rpc|, which SQLite
+    // only supports when built in (at least) multi-thread mode.
+    if (options.http_max_sessions > 0 && !sqlite3_threadsafe()) {
+      return base::ErrStatus(
+          "--http-max-sessions is not supported: this binary was built with "
+          "SQLITE_THREADSAFE=0 (see "
+          "enable_perfetto_trace_processor_httpd_sessions)");
+    }
+    HttpdSessionOptions session_options;
+    session_options.max_sessions = options.http_max_sessions;
+    // Sessions get the same SQL packages as the default instance, including
+    // when their trace processor is recreated to load a new trace.
+    session_options.rpc_factory = [this, config, &options] {
+      return std::make_unique<Rpc>(
+          nullptr, false, config,
+          [this, &options](TraceProcessor* session_tp) {
+            platform_interface_->OnTraceProcessorCreated(session_tp);
+            base::Status status = MaybeUpdateSqlPackages(session_tp, options);
+            if (!status.ok())
+              PERFETTO_ELOG("%s", status.c_message());
+          });
+    };
     RunHttpRPCServer(
         /*rpc=*/rpc,
         /*listen_ip=*/options.listen_ip,
         /*port_number=*/options.port_number,
-        /*additional_cors_origins=*/options.additional_cors_origins);
+        /*additional_cors_origins=*/options.additional_cors_origins,
+        /*session_options=*/std::move(session_options));
     PERFETTO_FATAL("Should never return");
 #else
     PERFETTO_FATAL("HTTP not available");
@@ -2286,6 +2538,7 @@ base::Status TraceProcessorShell::Run(int argc, char** argv) {
             [this](TraceProcessor* tp) {
               platform_interface_->OnTraceProcessorCreated(tp);
             });
+    MaybeFollowTraceInRpc(&rpc, follower.get());
 #if PERFETTO_HAS_SIGNAL_H()
     static Rpc* g_rpc_for_signal_handler = &rpc;
     g_tp_for_signal_handler = nullptr;
@@ -2298,8 +2551,9 @@ base::Status TraceProcessorShell::Run(int argc, char** argv) {
 
   if (options.launch_shell) {
     RETURN_IF_ERROR(StartInteractiveShell(
-        tp.get(), InteractiveOptions{options.wide ? 40u : 20u, metric_format,
-                                     metric_extensions, metrics, &pool}));
+        tp.get(),
+        InteractiveOptions{options.wide ? 40u : 20u, metric_format,
+                           metric_extensions, metrics, &pool, follower.get()}));
   } else if (!options.perf_file_path.empty()) {
     RETURN_IF_ERROR(PrintPerfFile(options.perf_file_path, t_load, t_query));
   }
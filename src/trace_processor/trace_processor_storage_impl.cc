@@ -22,6 +22,8 @@
 #include <memory>
 #include <utility>
 
+#include "perfetto/base/build_config.h"
+#include "perfetto/base/compiler.h"
 #include "perfetto/base/status.h"
 #include "perfetto/ext/base/status_macros.h"
 #include "perfetto/ext/base/string_view.h"
@@ -44,6 +46,7 @@
 #include "src/trace_processor/storage/metadata.h"
 #include "src/trace_processor/storage/stats.h"
 #include "src/trace_processor/storage/trace_storage.h"
+#include "src/trace_processor/trace_ingestion_thread.h"
 #include "src/trace_processor/trace_reader_registry.h"
 #include "src/trace_processor/types/trace_processor_context.h"
 #include "src/trace_processor/types/variadic.h"
@@ -63,19 +66,36 @@ TraceProcessorStorageImpl::TraceProcessorStorageImpl(const Config& cfg)
         reinterpret_cast<const uint8_t*>(raw_bytes.data()), raw_bytes.size(),
         {}, true);
   }
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WASM)
+  if (cfg.enable_read_ahead) {
+    ingestion_thread_ = std::make_unique<TraceIngestionThread>(
+        [this](TraceBlobView blob) { return ParseInternal(std::move(blob)); });
+  }
+#endif
 }
 
-TraceProcessorStorageImpl::~TraceProcessorStorageImpl() {}
+TraceProcessorStorageImpl::~TraceProcessorStorageImpl() {
+  StopIngestionThread();
+}
 
 base::Status TraceProcessorStorageImpl::Parse(TraceBlobView blob) {
   if (blob.size() == 0)
     return base::OkStatus();
-  if (unrecoverable_parse_error_)
-    return base::ErrStatus(
-        "Failed unrecoverably while parsing in a previous Parse call");
   if (eof_) {
     return base::ErrStatus("Parse() called after NotifyEndOfFile()");
   }
+  if (ingestion_thread_) {
+    // Parsing errors on the ingestion thread are latched by it and
+    // returned by Push().
+    return ingestion_thread_->Push(std::move(blob));
+  }
+  return ParseInternal(std::move(blob));
+}
+
+base::Status TraceProcessorStorageImpl::ParseInternal(TraceBlobView blob) {
+  if (unrecoverable_parse_error_)
+    return base::ErrStatus(
+        "Failed unrecoverably while parsing in a previous Parse call");
 
   if (!parser_) {
     parser_ = std::make_unique<ForwardingTraceParser>(
@@ -105,11 +125,28 @@ base::Status TraceProcessorStorageImpl::Parse(TraceBlobView blob) {
         "Trace parse failure (%s) (ERR:tp-parse). "
         "The trace file is corrupt.",
         status.c_message());
+  } else if (context()->sorter && !context()->sorter->status().ok()) {
+    // The trace is fine but the events spilled to disk are lost.
+    unrecoverable_parse_error_ = true;
+    status = context()->sorter->status();
   }
   return status;
 }
 
+void TraceProcessorStorageImpl::StopIngestionThread() {
+  ingestion_thread_.reset();
+}
+
+void TraceProcessorStorageImpl::WaitForIngestionIdle() {
+  if (ingestion_thread_) {
+    // Errors are also latched in |unrecoverable_parse_error_| by
+    // ParseInternal so there is no need to propagate the status here.
+    base::ignore_result(ingestion_thread_->WaitForIdle());
+  }
+}
+
 void TraceProcessorStorageImpl::Flush() {
+  WaitForIngestionIdle();
   if (unrecoverable_parse_error_) {
     return;
   }
@@ -119,6 +156,12 @@ void TraceProcessorStorageImpl::Flush() {
 }
 
 base::Status TraceProcessorStorageImpl::NotifyEndOfFile() {
+  if (ingestion_thread_) {
+    base::Status status = ingestion_thread_->WaitForIdle();
+    // Nothing else can be ingested after EOF: release the ingestion thread.
+    StopIngestionThread();
+    RETURN_IF_ERROR(status);
+  }
   if (!parser_) {
     return base::OkStatus();
   }
@@ -130,6 +173,9 @@ base::Status TraceProcessorStorageImpl::NotifyEndOfFile() {
   RETURN_IF_ERROR(parser_->NotifyEndOfFile());
   // NotifyEndOfFile might have pushed packets to the sorter.
   Flush();
+  if (context()->sorter) {
+    RETURN_IF_ERROR(context()->sorter->status());
+  }
 
   auto& traces = context()->forked_context_state->trace_to_context;
   for (auto it = traces.GetIterator(); it; ++it) {
@@ -30,6 +30,7 @@
 namespace perfetto::trace_processor {
 
 class ForwardingTraceParser;
+class TraceIngestionThread;
 
 class TraceProcessorStorageImpl : public TraceProcessorStorage {
  public:
@@ -45,12 +46,28 @@ class TraceProcessorStorageImpl : public TraceProcessorStorage {
   TraceProcessorContext* context() { return &context_; }
 
  protected:
+  // Drops any data queued for ingestion and joins the ingestion thread when
+  // |Config::enable_read_ahead| is set. Subclasses must call this
+  // before destroying any state which could be used by the parsers.
+  void StopIngestionThread();
+
   base::FnvHasher trace_hash_;
   TraceProcessorContext context_;
   bool unrecoverable_parse_error_ = false;
   bool eof_ = false;
   size_t hash_input_size_remaining_ = 4096;
   std::unique_ptr<ForwardingTraceParser> parser_;
+
+ private:
+  base::Status ParseInternal(TraceBlobView);
+
+  // Waits until all the data passed to |Parse| has been ingested when
+  // |Config::enable_read_ahead| is set. No-op otherwise.
+  void WaitForIngestionIdle();
+
+  // Must be declared last: the ingestion thread accesses all the other members
+  // and is joined when |ingestion_thread_| is destroyed.
+  std::unique_ptr<TraceIngestionThread> ingestion_thread_;
 };
 
 }  // namespace perfetto::trace_processor
@@ -26,11 +26,14 @@
 #include "src/trace_processor/types/trace_processor_context.h"
 #include "src/trace_processor/util/gzip_utils.h"
 #include "src/trace_processor/util/trace_type.h"
+#include "src/trace_processor/util/zstd_utils.h"
 
 namespace perfetto::trace_processor {
 namespace {
 const char kNoZlibErr[] =
     "Cannot open compressed trace. zlib not enabled in the build config";
+const char kNoZstdErr[] =
+    "Cannot open compressed trace. zstd not enabled in the build config";
 
 bool RequiresZlibSupport(TraceType type) {
   switch (type) {
@@ -61,6 +64,7 @@ bool RequiresZlibSupport(TraceType type) {
     case kPerfTextTraceType:
     case kSimpleperfProtoTraceType:
     case kTarTraceType:
+    case kZstdTraceType:
       return false;
   }
   PERFETTO_FATAL("For GCC");
@@ -84,6 +88,11 @@ TraceReaderRegistry::CreateTraceReader(TraceType type,
                            TraceTypeToString(type), kNoZlibErr);
   }
 
+  if (type == kZstdTraceType && !util::IsZstdSupported()) {
+    return base::ErrStatus("%s support is disabled. %s",
+                           TraceTypeToString(type), kNoZstdErr);
+  }
+
   return base::ErrStatus("%s support is disabled", TraceTypeToString(type));
 }
 
@@ -64,6 +64,10 @@ class TrackTracker;
 struct ProtoImporterModuleContext;
 struct TrackCompressorGroupIdxState;
 
+namespace util {
+class LazyThreadPool;
+}  // namespace util
+
 using MachineId = tables::MachineTable::Id;
 using ClockTracker = ClockSynchronizer<ClockSynchronizerListenerImpl>;
 
@@ -146,6 +150,10 @@ class TraceProcessorContext {
   GlobalPtr<StackProfileTracker> stack_profile_tracker;
   GlobalPtr<Destructible> deobfuscation_tracker;  // DeobfuscationTracker
 
+  // Threads used to decompress archives and gzip files concurrently (see
+  // Config::decompression_parallelism).
+  GlobalPtr<util::LazyThreadPool> decompression_thread_pool;
+
   // The registration function for additional proto modules.
   // This is populated by TraceProcessorImpl to allow for late registration of
   // modules.
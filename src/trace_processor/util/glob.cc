@@ -18,6 +18,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 
 #include "perfetto/base/logging.h"
 #include "perfetto/ext/base/string_utils.h"
@@ -134,6 +135,40 @@ bool GlobMatcher::Matches(base::StringView in) const {
   return true;
 }
 
+std::vector<base::StringView> GlobMatcher::LiteralRuns() const {
+  std::vector<base::StringView> runs;
+  for (const Segment& segment : segments_) {
+    base::StringView pattern = segment.pattern;
+    size_t run_start = 0;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+      char c = pattern.at(i);
+      if (c != '?' && c != '[') {
+        continue;
+      }
+      if (i > run_start) {
+        runs.push_back(pattern.substr(run_start, i - run_start));
+      }
+      if (c == '?') {
+        run_start = i + 1;
+        continue;
+      }
+      // Unterminated classes are handled inconsistently by the matching
+      // functions: be conservative and ignore the rest of the segment.
+      base::StringView cclass = ExtractCharacterClass(pattern.substr(i + 1));
+      if (cclass.empty()) {
+        run_start = pattern.size();
+        break;
+      }
+      i += cclass.size() + 1;
+      run_start = i + 1;
+    }
+    if (pattern.size() > run_start) {
+      runs.push_back(pattern.substr(run_start));
+    }
+  }
+  return runs;
+}
+
 bool GlobMatcher::StartsWithSlow(base::StringView in, const Segment& segment) {
   base::StringView pattern = segment.pattern;
   for (uint32_t i = 0, p = 0; p < pattern.size(); ++i, ++p) {
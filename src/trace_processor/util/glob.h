@@ -85,6 +85,14 @@ class GlobMatcher {
            !contains_char_class_or_question_ && segments_.size() <= 1;
   }
 
+  // Returns the runs of ordinary characters (i.e. outside of '*', '?' and
+  // character classes) in the pattern. Every string matching the pattern
+  // contains all of these as substrings so they can be used to cheaply rule
+  // out strings before calling |Matches|.
+  //
+  // The returned views point inside this object.
+  std::vector<base::StringView> LiteralRuns() const;
+
  private:
   // Represents a portion of the pattern in between two * characters.
   struct Segment {
@@ -16,6 +16,10 @@
 
 #include "src/trace_processor/util/glob.h"
 
+#include <string>
+#include <vector>
+
+#include "perfetto/ext/base/string_view.h"
 #include "test/gtest_and_gmock.h"
 
 namespace perfetto::trace_processor::util {
@@ -268,5 +272,30 @@ TEST(GlobUnittest, Complex) {
   ASSERT_FALSE(matcher.Matches("ABDDDDDDCIFJKNFAB"));
 }
 
+std::vector<std::string> LiteralRuns(const char* pattern) {
+  GlobMatcher matcher = GlobMatcher::FromPattern(pattern);
+  std::vector<std::string> res;
+  for (base::StringView run : matcher.LiteralRuns()) {
+    res.push_back(run.ToStdString());
+  }
+  return res;
+}
+
+TEST(GlobUnittest, LiteralRuns) {
+  using testing::ElementsAre;
+  using testing::IsEmpty;
+
+  ASSERT_THAT(LiteralRuns(""), IsEmpty());
+  ASSERT_THAT(LiteralRuns("*"), IsEmpty());
+  ASSERT_THAT(LiteralRuns("*binder*"), ElementsAre("binder"));
+  ASSERT_THAT(LiteralRuns("AB*CD"), ElementsAre("AB", "CD"));
+  ASSERT_THAT(LiteralRuns("AB?CD*E"), ElementsAre("AB", "CD", "E"));
+  ASSERT_THAT(LiteralRuns("AB*[C-D]?*F*CAB"), ElementsAre("AB", "F", "CAB"));
+  ASSERT_THAT(LiteralRuns("A[]]BC"), ElementsAre("A", "BC"));
+
+  // Unterminated character classes end the run.
+  ASSERT_THAT(LiteralRuns("AB[CD*EF"), ElementsAre("AB", "EF"));
+}
+
 }  // namespace
 }  // namespace perfetto::trace_processor::util
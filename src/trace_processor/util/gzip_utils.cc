@@ -18,10 +18,17 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "perfetto/base/build_config.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/status_macros.h"
+#include "perfetto/ext/base/status_or.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
+#include "src/trace_processor/util/parallel_for.h"
 
 #if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
 #include <zconf.h>
@@ -118,4 +125,139 @@ std::vector<uint8_t> GzipDecompressor::DecompressFully(const uint8_t* data,
   return whole_data;
 }
 
+namespace {
+
+struct MemberState {
+  // Offset of the start of the member in the input.
+  size_t start = 0;
+
+  // Offset past the end of the member in the input. Only valid if |complete|.
+  size_t end = 0;
+
+  bool complete = false;
+  bool error = false;
+  std::unique_ptr<GzipDecompressor> decompressor;
+
+  // The output of the member, in chunks of kGzipMemberOutputChunkSize bytes.
+  // Only the last one can be partially filled, with |last_chunk_size| bytes.
+  std::vector<std::unique_ptr<uint8_t[]>> chunks;
+  size_t last_chunk_size = 0;
+};
+
+// Returns whether |data| starts with the same gzip member header as
+// |member_header|: ID1, ID2, CM, FLG, XFL and OS must match, MTIME can differ.
+// Members written by the same compressor share all of them, which rules out
+// most of the byte sequences inside the compressed data that look like a
+// header.
+bool MatchesMemberHeader(const uint8_t* data,
+                         size_t size,
+                         const uint8_t* member_header) {
+  return size >= kGzipMemberHeaderSize &&
+         memcmp(data, member_header, 4) == 0 &&
+         memcmp(data + 8, member_header + 8, 2) == 0;
+}
+
+void InflateMember(const uint8_t* data, size_t size, MemberState* member) {
+  member->decompressor = std::make_unique<GzipDecompressor>();
+  member->decompressor->Feed(data + member->start, size - member->start);
+
+  for (;;) {
+    if (member->chunks.empty() ||
+        member->last_chunk_size == kGzipMemberOutputChunkSize) {
+      member->chunks.emplace_back(new uint8_t[kGzipMemberOutputChunkSize]);
+      member->last_chunk_size = 0;
+    }
+    auto res = member->decompressor->ExtractOutput(
+        member->chunks.back().get() + member->last_chunk_size,
+        kGzipMemberOutputChunkSize - member->last_chunk_size);
+    if (res.ret == GzipDecompressor::ResultCode::kError) {
+      member->error = true;
+      member->decompressor.reset();
+      member->chunks.clear();
+      return;
+    }
+    member->last_chunk_size += res.bytes_written;
+    if (res.ret == GzipDecompressor::ResultCode::kNeedsMoreInput) {
+      return;
+    }
+    if (res.ret == GzipDecompressor::ResultCode::kEof) {
+      member->complete = true;
+      member->end = size - member->decompressor->AvailIn();
+      member->decompressor.reset();
+      return;
+    }
+  }
+}
+
+}  // namespace
+
+base::StatusOr<std::unique_ptr<GzipDecompressor>> InflateGzipMembers(
+    base::ThreadPool* pool,
+    const uint8_t* data,
+    size_t size,
+    const uint8_t* member_header,
+    const GzipMemberCallback& member_callback) {
+  if (!IsGzipSupported()) {
+    return base::ErrStatus(
+        "Cannot decompress gzip data. Gzip is not enabled in the current "
+        "build. Rebuild with enable_perfetto_zlib=true");
+  }
+
+  // Bounds the number of speculatively inflated offsets, and so the wasted
+  // work and the output held in memory, to one per thread.
+  const size_t max_round_size = pool ? pool->thread_count() + 1 : 1;
+  const uint8_t* const end = data + size;
+  std::vector<MemberState> round;
+  for (size_t pos = 0; pos < size;) {
+    // The first member of the round is known to start at |pos|.
+    round.clear();
+    round.emplace_back().start = pos;
+    for (const uint8_t* it = data + pos + 1;
+         it < end && round.size() < max_round_size; ++it) {
+      it = static_cast<const uint8_t*>(
+          memchr(it, 0x1f, static_cast<size_t>(end - it)));
+      if (!it) {
+        break;
+      }
+      if (MatchesMemberHeader(it, static_cast<size_t>(end - it),
+                              member_header)) {
+        round.emplace_back().start = static_cast<size_t>(it - data);
+      }
+    }
+    ParallelFor(pool, round.size(), [&](size_t i) {
+      InflateMember(data, size, &round[i]);
+    });
+
+    // Walk the chain of actual member boundaries. Any member boundary between
+    // the first and the last offset of the round looks like a member header,
+    // so it is in the round: the chain only leaves the round past its end.
+    for (MemberState& member : round) {
+      if (member.start < pos) {
+        continue;  // A false header inside the previous member.
+      }
+      if (member.start > pos) {
+        break;
+      }
+      if (member.error) {
+        return base::ErrStatus(
+            "Failed to decompress gzip member at offset %zu", pos);
+      }
+      for (size_t i = 0; i < member.chunks.size(); ++i) {
+        size_t chunk_size = i + 1 == member.chunks.size()
+                                ? member.last_chunk_size
+                                : kGzipMemberOutputChunkSize;
+        if (chunk_size > 0) {
+          RETURN_IF_ERROR(
+              member_callback(std::move(member.chunks[i]), chunk_size));
+        }
+      }
+      if (!member.complete) {
+        return std::move(member.decompressor);
+      }
+      pos = member.end;
+    }
+  }
+  return std::unique_ptr<GzipDecompressor>();
+}
+
 }  // namespace perfetto::trace_processor::util
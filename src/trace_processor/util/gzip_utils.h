@@ -19,13 +19,20 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <vector>
 
 #include "perfetto/base/build_config.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/status_or.h"
 
 struct z_stream_s;
 
+namespace perfetto::base {
+class ThreadPool;
+}  // namespace perfetto::base
+
 namespace perfetto::trace_processor::util {
 
 // Returns whether gzip related functioanlity is supported with the current
@@ -136,6 +143,42 @@ class GzipDecompressor {
   std::unique_ptr<z_stream_s, Deleter> z_stream_;
 };
 
+// Size of the fixed part of a gzip member header (RFC1952 section 2.3).
+constexpr size_t kGzipMemberHeaderSize = 10;
+
+// Maximum size of the chunks of output passed to a GzipMemberCallback.
+constexpr size_t kGzipMemberOutputChunkSize = 1024ul * 1024;
+
+// Called by InflateGzipMembers with a chunk of the decompressed contents of a
+// member and its size.
+using GzipMemberCallback =
+    std::function<base::Status(std::unique_ptr<uint8_t[]>, size_t)>;
+
+// Decompresses |data|, which must start at the beginning of a gzip member and
+// can contain any number of concatenated members (RFC1952 section 2.2), and
+// passes the output of each member to |member_callback|, in order, in chunks
+// of at most kGzipMemberOutputChunkSize bytes.
+//
+// If |pool| is not null, members are inflated concurrently, in rounds of at
+// most |pool->thread_count() + 1| members. The start of a member is only known
+// after the previous member has been decompressed so, in each round, the
+// offsets following the first member whose header matches |member_header|
+// (the first kGzipMemberHeaderSize bytes of a real member of the same file,
+// compared except for MTIME) are speculatively inflated; only the results of
+// offsets which turn out to be actual member boundaries are used. The output
+// is identical to sequential decompression.
+//
+// If |data| ends in the middle of a member, the output produced so far for it
+// is passed to |member_callback| and its decompressor, which has been fed all
+// the input, is returned: the rest of the member should be fed to it.
+// Otherwise returns nullptr.
+base::StatusOr<std::unique_ptr<GzipDecompressor>> InflateGzipMembers(
+    base::ThreadPool* pool,
+    const uint8_t* data,
+    size_t size,
+    const uint8_t* member_header,
+    const GzipMemberCallback& member_callback);
+
 }  // namespace perfetto::trace_processor::util
 
 #endif  // SRC_TRACE_PROCESSOR_UTIL_GZIP_UTILS_H_
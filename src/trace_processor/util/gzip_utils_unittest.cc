@@ -27,7 +27,9 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
 #include "perfetto/base/logging.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 
 using std::string;
 
@@ -145,4 +147,141 @@ TEST(GzipDecompressor, DISABLED_FileInFileOut) {
   EXPECT_TRUE(ReadFile(txt_file) == big_string);
 }
 
+// Compresses |input| into a single member of a .gz file (i.e. with a gzip
+// header rather than a zlib one).
+static std::string GzipMemberCompress(const std::string& input,
+                                      int level = Z_BEST_COMPRESSION) {
+  z_stream defstream{};
+  deflateInit2(&defstream, level, Z_DEFLATED, 16 + MAX_WBITS, 8,
+               Z_DEFAULT_STRATEGY);
+  std::string output(deflateBound(&defstream, uLong(input.size())), '\0');
+  defstream.avail_in = uint32_t(input.size());
+  defstream.next_in =
+      const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.data()));
+  defstream.avail_out = uint32_t(output.size());
+  defstream.next_out = reinterpret_cast<Bytef*>(output.data());
+  PERFETTO_CHECK(deflate(&defstream, Z_FINISH) == Z_STREAM_END);
+  output.resize(output.size() - defstream.avail_out);
+  deflateEnd(&defstream);
+  return output;
+}
+
+// Inflates |compressed| with InflateGzipMembers, appending each chunk of
+// output to |chunks|. The header of the first member is used to find the
+// others.
+static base::StatusOr<std::unique_ptr<GzipDecompressor>> Inflate(
+    base::ThreadPool* pool,
+    const std::string& compressed,
+    std::vector<std::string>* chunks) {
+  const auto* data = reinterpret_cast<const uint8_t*>(compressed.data());
+  return InflateGzipMembers(
+      pool, data, compressed.size(), data,
+      [chunks](std::unique_ptr<uint8_t[]> chunk, size_t size) {
+        chunks->emplace_back(reinterpret_cast<const char*>(chunk.get()), size);
+        return base::OkStatus();
+      });
+}
+
+static std::string Concat(const std::vector<std::string>& chunks) {
+  std::string output;
+  for (const std::string& chunk : chunks) {
+    output += chunk;
+  }
+  return output;
+}
+
+TEST(InflateGzipMembers, MultiMember) {
+  std::string expected;
+  std::string compressed;
+  for (uint32_t i = 0; i < 50; ++i) {
+    std::string member = "Member " + std::to_string(i) + ": ";
+    for (uint32_t j = 0; j < i * 100; ++j) {
+      member += std::to_string(i * j);
+    }
+    expected += member;
+    compressed += GzipMemberCompress(member);
+  }
+
+  // The members don't fit in a single round with either pool.
+  base::ThreadPool pool1(1);
+  base::ThreadPool pool4(4);
+  for (base::ThreadPool* p :
+       {static_cast<base::ThreadPool*>(nullptr), &pool1, &pool4}) {
+    std::vector<std::string> chunks;
+    auto partial = Inflate(p, compressed, &chunks);
+    ASSERT_TRUE(partial.ok()) << partial.status().message();
+    ASSERT_FALSE(*partial);
+    ASSERT_EQ(chunks.size(), 50u);
+    ASSERT_EQ(Concat(chunks), expected);
+  }
+}
+
+TEST(InflateGzipMembers, FalseHeaderInsideMember) {
+  // A stored (i.e. uncompressed) member contains a copy of its own header: it
+  // is speculatively inflated but must not be treated as a boundary.
+  std::string fake_header =
+      GzipMemberCompress("", Z_NO_COMPRESSION).substr(0, kGzipMemberHeaderSize);
+  std::string member = "abc" + fake_header + "def";
+  std::string compressed = GzipMemberCompress(member, Z_NO_COMPRESSION);
+  ASSERT_NE(compressed.find(fake_header, 1), std::string::npos);
+  compressed += GzipMemberCompress("ghi", Z_NO_COMPRESSION);
+
+  base::ThreadPool pool(2);
+  std::vector<std::string> chunks;
+  auto partial = Inflate(&pool, compressed, &chunks);
+  ASSERT_TRUE(partial.ok());
+  ASSERT_EQ(chunks.size(), 2u);
+  ASSERT_EQ(Concat(chunks), member + "ghi");
+}
+
+TEST(InflateGzipMembers, PartialMember) {
+  std::string first = GzipMemberCompress("first");
+  std::string second = GzipMemberCompress("second member");
+  std::string compressed = first + second.substr(0, second.size() - 4);
+
+  base::ThreadPool pool(2);
+  std::vector<std::string> chunks;
+  auto partial = Inflate(&pool, compressed, &chunks);
+  ASSERT_TRUE(partial.ok());
+  ASSERT_TRUE(*partial);
+
+  // Feeding the rest of the member to the partial decompressor completes it.
+  std::string rest = second.substr(second.size() - 4);
+  std::string output = Concat(chunks);
+  auto ret = (*partial)->FeedAndExtract(
+      reinterpret_cast<const uint8_t*>(rest.data()), rest.size(),
+      [&](const uint8_t* data, size_t len) {
+        output.append(reinterpret_cast<const char*>(data), len);
+      });
+  ASSERT_EQ(ret, GzipDecompressor::ResultCode::kEof);
+  ASSERT_EQ(output, "firstsecond member");
+}
+
+TEST(InflateGzipMembers, LargeMemberIsChunked) {
+  std::string member;
+  for (uint32_t i = 0; member.size() < 3 * kGzipMemberOutputChunkSize; ++i) {
+    member += std::to_string(i);
+  }
+  std::string compressed = GzipMemberCompress(member) + GzipMemberCompress("x");
+
+  base::ThreadPool pool(2);
+  for (base::ThreadPool* p : {static_cast<base::ThreadPool*>(nullptr), &pool}) {
+    std::vector<std::string> chunks;
+    auto partial = Inflate(p, compressed, &chunks);
+    ASSERT_TRUE(partial.ok());
+    ASSERT_FALSE(*partial);
+    ASSERT_GT(chunks.size(), 4u);
+    for (const std::string& chunk : chunks) {
+      ASSERT_LE(chunk.size(), kGzipMemberOutputChunkSize);
+    }
+    ASSERT_EQ(Concat(chunks), member + "x");
+  }
+}
+
+TEST(InflateGzipMembers, Corrupt) {
+  std::string compressed = GzipMemberCompress("abc") + "garbage";
+  std::vector<std::string> chunks;
+  ASSERT_FALSE(Inflate(nullptr, compressed, &chunks).ok());
+}
+
 }  // namespace perfetto::trace_processor::util
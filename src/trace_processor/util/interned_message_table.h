@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_UTIL_INTERNED_MESSAGE_TABLE_H_
+#define SRC_TRACE_PROCESSOR_UTIL_INTERNED_MESSAGE_TABLE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/compiler.h"
+#include "perfetto/ext/base/flat_hash_map.h"
+#include "src/trace_processor/util/interned_message_view.h"
+
+namespace perfetto::trace_processor {
+
+// Stores the interned messages of a single InternedData field, keyed by iid.
+//
+// Producers allocate iids sequentially, starting from 1, in each interning
+// context. So, instead of a node-based hash map, messages are stored in a
+// vector and small iids are mapped to their message with a dense index. Iids
+// which would make the dense index too sparse fall back to a hash map.
+//
+// Pointers returned by |Find| and |Insert| are invalidated by |Insert|.
+// Decoders returned by InternedMessageView::GetOrCreateDecoder() are not.
+class InternedMessageTable {
+ public:
+  InternedMessageTable() = default;
+  InternedMessageTable(InternedMessageTable&&) noexcept = default;
+  InternedMessageTable& operator=(InternedMessageTable&&) noexcept = default;
+
+  // Copies are needed when the sequence state is forked by new
+  // TracePacketDefaults.
+  InternedMessageTable(const InternedMessageTable& other)
+      : messages_(other.messages_), dense_index_(other.dense_index_) {
+    for (auto it = other.sparse_index_.GetIterator(); it; ++it) {
+      sparse_index_.Insert(it.key(), it.value());
+    }
+  }
+  InternedMessageTable& operator=(const InternedMessageTable&) = delete;
+
+  // Returns the message with |iid| or nullptr if there is none.
+  PERFETTO_ALWAYS_INLINE InternedMessageView* Find(uint64_t iid) {
+    if (PERFETTO_LIKELY(iid < dense_index_.size())) {
+      uint32_t idx = dense_index_[iid];
+      if (PERFETTO_LIKELY(idx != kNoMessage)) {
+        return &messages_[idx];
+      }
+    }
+    if (PERFETTO_LIKELY(sparse_index_.size() == 0)) {
+      return nullptr;
+    }
+    uint32_t* idx = sparse_index_.Find(iid);
+    return idx ? &messages_[*idx] : nullptr;
+  }
+
+  // Inserts |message| unless there already is a message with |iid|. Returns
+  // the message with |iid| and whether it was inserted.
+  std::pair<InternedMessageView*, bool> Insert(uint64_t iid,
+                                               InternedMessageView message) {
+    if (InternedMessageView* existing = Find(iid); existing) {
+      return std::make_pair(existing, false);
+    }
+    auto idx = static_cast<uint32_t>(messages_.size());
+    messages_.emplace_back(std::move(message));
+
+    // Bound the size of the dense index to a small multiple of the number of
+    // messages so that a few large iids don't waste memory.
+    uint64_t dense_limit =
+        std::max<uint64_t>(kMinDenseIndexSize, messages_.size() * 2);
+    if (iid < dense_index_.size() || iid < dense_limit) {
+      if (iid >= dense_index_.size()) {
+        dense_index_.resize(static_cast<size_t>(iid) + 1, kNoMessage);
+      }
+      dense_index_[static_cast<size_t>(iid)] = idx;
+    } else {
+      sparse_index_.Insert(iid, idx);
+    }
+    return std::make_pair(&messages_.back(), true);
+  }
+
+  size_t size() const { return messages_.size(); }
+
+ private:
+  static constexpr uint32_t kNoMessage = UINT32_MAX;
+  static constexpr uint64_t kMinDenseIndexSize = 1024;
+
+  // Messages must not be copied when |messages_| grows: that would drop their
+  // decoders.
+  static_assert(std::is_nothrow_move_constructible_v<InternedMessageView>);
+
+  std::vector<InternedMessageView> messages_;
+  std::vector<uint32_t> dense_index_;
+  base::FlatHashMap<uint64_t, uint32_t> sparse_index_;
+};
+
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_UTIL_INTERNED_MESSAGE_TABLE_H_
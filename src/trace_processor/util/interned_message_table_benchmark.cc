@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/util/interned_message_table.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "perfetto/trace_processor/trace_blob.h"
+#include "perfetto/trace_processor/trace_blob_view.h"
+#include "src/trace_processor/util/interned_message_view.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+// Field ids of InternedData looked up for most TrackEvents.
+constexpr uint32_t kEventCategories = 1;
+constexpr uint32_t kEventNames = 2;
+constexpr uint32_t kDebugAnnotationNames = 3;
+constexpr uint32_t kSourceLocations = 4;
+
+// The number of distinct interned messages per sequence for each field, in
+// the same order as above: this is roughly the shape of the interned data of
+// a Chrome renderer main thread.
+constexpr uint32_t kFieldIds[] = {kEventCategories, kEventNames,
+                                  kDebugAnnotationNames, kSourceLocations};
+constexpr uint64_t kMessagesPerField[] = {40, 2000, 300, 1500};
+
+// The interned data representation used before InternedMessageTable.
+using UnorderedMapInternedData =
+    std::unordered_map<uint32_t,
+                       std::unordered_map<uint64_t, InternedMessageView>>;
+
+struct UnorderedMapTag {};
+struct InternedMessageTableTag {};
+
+template <typename Tag>
+struct InternedData;
+
+template <>
+struct InternedData<UnorderedMapTag> {
+  void Insert(uint32_t field_id, uint64_t iid, InternedMessageView view) {
+    map[field_id].emplace(iid, std::move(view));
+  }
+  InternedMessageView* Find(uint32_t field_id, uint64_t iid) {
+    auto field_it = map.find(field_id);
+    if (field_it == map.end()) {
+      return nullptr;
+    }
+    auto it = field_it->second.find(iid);
+    return it == field_it->second.end() ? nullptr : &it->second;
+  }
+  UnorderedMapInternedData map;
+};
+
+template <>
+struct InternedData<InternedMessageTableTag> {
+  void Insert(uint32_t field_id, uint64_t iid, InternedMessageView view) {
+    if (field_id >= tables.size()) {
+      tables.resize(field_id + 1);
+    }
+    tables[field_id].Insert(iid, std::move(view));
+  }
+  InternedMessageView* Find(uint32_t field_id, uint64_t iid) {
+    return field_id < tables.size() ? tables[field_id].Find(iid) : nullptr;
+  }
+  std::vector<InternedMessageTable> tables;
+};
+
+bool IsBenchmarkFunctionalOnly() {
+  return getenv("BENCHMARK_FUNCTIONAL_TEST_ONLY") != nullptr;
+}
+
+void SequenceArgs(benchmark::internal::Benchmark* b) {
+  if (IsBenchmarkFunctionalOnly()) {
+    b->Arg(1);
+  } else {
+    b->Arg(1);
+    b->Arg(64);
+  }
+}
+
+template <typename Tag>
+std::vector<InternedData<Tag>> CreateSequences(size_t sequence_count) {
+  TraceBlobView blob(TraceBlob::Allocate(64));
+  std::vector<InternedData<Tag>> sequences(sequence_count);
+  for (auto& sequence : sequences) {
+    for (size_t f = 0; f < std::size(kFieldIds); ++f) {
+      for (uint64_t iid = 1; iid <= kMessagesPerField[f]; ++iid) {
+        sequence.Insert(kFieldIds[f], iid,
+                        InternedMessageView(blob.slice_off(0, 16)));
+      }
+    }
+  }
+  return sequences;
+}
+
+// Simulates the lookups done while parsing TrackEvents: each event looks up
+// its category, name, source location and a couple of debug annotation names,
+// with a skewed distribution of iids.
+template <typename Tag>
+void BM_InternedDataLookup(benchmark::State& state) {
+  auto sequence_count = static_cast<size_t>(state.range(0));
+  std::vector<InternedData<Tag>> sequences = CreateSequences<Tag>(
+      sequence_count);
+
+  struct Lookup {
+    uint32_t sequence;
+    uint32_t field_id;
+    uint64_t iid;
+  };
+  std::vector<Lookup> lookups;
+  std::minstd_rand0 rnd(0);
+  for (uint32_t i = 0; i < 64 * 1024; ++i) {
+    auto sequence = static_cast<uint32_t>(rnd() % sequence_count);
+    for (size_t f = 0; f < std::size(kFieldIds); ++f) {
+      // Skew towards small iids: they are assigned to the most frequent
+      // strings as those are seen first.
+      uint64_t r = rnd() % kMessagesPerField[f];
+      uint64_t iid = 1 + (r * r) / kMessagesPerField[f];
+      lookups.push_back({sequence, kFieldIds[f], iid});
+    }
+  }
+
+  size_t i = 0;
+  for (auto _ : state) {
+    const Lookup& lookup = lookups[i++ % lookups.size()];
+    benchmark::DoNotOptimize(
+        sequences[lookup.sequence].Find(lookup.field_id, lookup.iid));
+  }
+  state.counters["lookups"] = benchmark::Counter(
+      static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+}
+BENCHMARK_TEMPLATE(BM_InternedDataLookup, UnorderedMapTag)
+    ->Apply(SequenceArgs)
+    ->Name("BM_InternedDataLookupUnorderedMap");
+BENCHMARK_TEMPLATE(BM_InternedDataLookup, InternedMessageTableTag)
+    ->Apply(SequenceArgs)
+    ->Name("BM_InternedDataLookupTable");
+
+template <typename Tag>
+void BM_InternedDataInsert(benchmark::State& state) {
+  auto sequence_count = static_cast<size_t>(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(CreateSequences<Tag>(sequence_count));
+  }
+  uint64_t messages_per_sequence = 0;
+  for (uint64_t count : kMessagesPerField) {
+    messages_per_sequence += count;
+  }
+  state.counters["messages"] = benchmark::Counter(
+      static_cast<double>(state.iterations() * sequence_count *
+                          messages_per_sequence),
+      benchmark::Counter::kIsRate);
+}
+BENCHMARK_TEMPLATE(BM_InternedDataInsert, UnorderedMapTag)
+    ->Apply(SequenceArgs)
+    ->Name("BM_InternedDataInsertUnorderedMap");
+BENCHMARK_TEMPLATE(BM_InternedDataInsert, InternedMessageTableTag)
+    ->Apply(SequenceArgs)
+    ->Name("BM_InternedDataInsertTable");
+
+}  // namespace
+}  // namespace perfetto::trace_processor
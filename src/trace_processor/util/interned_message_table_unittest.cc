@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/util/interned_message_table.h"
+
+#include <cstdint>
+#include <string>
+
+#include "perfetto/trace_processor/trace_blob.h"
+#include "perfetto/trace_processor/trace_blob_view.h"
+#include "src/trace_processor/util/interned_message_view.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+InternedMessageView ToView(const std::string& str) {
+  return InternedMessageView(
+      TraceBlobView(TraceBlob::CopyFrom(str.data(), str.size())));
+}
+
+std::string ToString(const InternedMessageView* view) {
+  if (!view) {
+    return "<null>";
+  }
+  return std::string(reinterpret_cast<const char*>(view->message().data()),
+                     view->message().size());
+}
+
+TEST(InternedMessageTableTest, DenseIids) {
+  InternedMessageTable table;
+  for (uint64_t iid = 1; iid <= 5000; ++iid) {
+    ASSERT_TRUE(table.Insert(iid, ToView(std::to_string(iid))).second);
+  }
+  ASSERT_EQ(table.size(), 5000u);
+  ASSERT_EQ(ToString(table.Find(0)), "<null>");
+  ASSERT_EQ(ToString(table.Find(1)), "1");
+  ASSERT_EQ(ToString(table.Find(4321)), "4321");
+  ASSERT_EQ(ToString(table.Find(5000)), "5000");
+  ASSERT_EQ(ToString(table.Find(5001)), "<null>");
+}
+
+TEST(InternedMessageTableTest, SparseIids) {
+  InternedMessageTable table;
+  ASSERT_TRUE(table.Insert(1, ToView("small")).second);
+  ASSERT_TRUE(table.Insert(0xffffffffffull, ToView("large")).second);
+  ASSERT_TRUE(table.Insert(1ull << 63, ToView("huge")).second);
+  ASSERT_TRUE(table.Insert(2, ToView("small2")).second);
+
+  ASSERT_EQ(ToString(table.Find(1)), "small");
+  ASSERT_EQ(ToString(table.Find(2)), "small2");
+  ASSERT_EQ(ToString(table.Find(0xffffffffffull)), "large");
+  ASSERT_EQ(ToString(table.Find(1ull << 63)), "huge");
+  ASSERT_EQ(ToString(table.Find(3)), "<null>");
+  ASSERT_EQ(ToString(table.Find(0xfffffffffeull)), "<null>");
+}
+
+TEST(InternedMessageTableTest, SparseIidBecomesDense) {
+  InternedMessageTable table;
+  // Too large to be in the dense index while the table is small...
+  ASSERT_TRUE(table.Insert(3000, ToView("3000")).second);
+  // ...but the dense index grows past it as more messages are inserted.
+  for (uint64_t iid = 1; iid <= 2000; ++iid) {
+    ASSERT_TRUE(table.Insert(iid, ToView(std::to_string(iid))).second);
+  }
+  ASSERT_TRUE(table.Insert(3001, ToView("3001")).second);
+  ASSERT_EQ(ToString(table.Find(3000)), "3000");
+  ASSERT_EQ(ToString(table.Find(3001)), "3001");
+  ASSERT_EQ(ToString(table.Find(2999)), "<null>");
+  ASSERT_FALSE(table.Insert(3000, ToView("other")).second);
+  ASSERT_EQ(ToString(table.Find(3000)), "3000");
+}
+
+TEST(InternedMessageTableTest, DuplicateIid) {
+  InternedMessageTable table;
+  ASSERT_TRUE(table.Insert(1, ToView("first")).second);
+  auto res = table.Insert(1, ToView("second"));
+  ASSERT_FALSE(res.second);
+  ASSERT_EQ(ToString(res.first), "first");
+  ASSERT_EQ(table.size(), 1u);
+}
+
+TEST(InternedMessageTableTest, Copy) {
+  InternedMessageTable table;
+  table.Insert(1, ToView("dense"));
+  table.Insert(1ull << 40, ToView("sparse"));
+
+  InternedMessageTable copy(table);
+  copy.Insert(2, ToView("copy only"));
+
+  ASSERT_EQ(ToString(copy.Find(1)), "dense");
+  ASSERT_EQ(ToString(copy.Find(1ull << 40)), "sparse");
+  ASSERT_EQ(ToString(copy.Find(2)), "copy only");
+  ASSERT_EQ(ToString(table.Find(2)), "<null>");
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/util/parallel_for.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "perfetto/base/build_config.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
+
+namespace perfetto::trace_processor::util {
+
+namespace {
+
+// Shared between the caller of ParallelFor and the helper tasks posted on the
+// pool. Helper tasks can start running after ParallelFor has returned (e.g. if
+// the pool is busy) so this is refcounted: |fn| is only dereferenced while
+// there are still unclaimed indices, which guarantees that ParallelFor has
+// not returned yet.
+struct ParallelForState {
+  ParallelForState(size_t _count, const std::function<void(size_t)>* _fn)
+      : count(_count), fn(_fn) {}
+
+  // Claims and runs indices until none is left.
+  void RunUntilDone() {
+    for (;;) {
+      size_t i = next.fetch_add(1, std::memory_order_relaxed);
+      if (i >= count) {
+        return;
+      }
+      (*fn)(i);
+      if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == count) {
+        std::lock_guard<std::mutex> guard(mutex);
+        cv.notify_all();
+      }
+    }
+  }
+
+  const size_t count;
+  const std::function<void(size_t)>* const fn;
+  std::atomic<size_t> next{0};
+  std::atomic<size_t> done{0};
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
+}  // namespace
+
+uint32_t GetDefaultParallelism() {
+#if PERFETTO_BUILDFLAG(PERFETTO_OS_WASM)
+  return 1;
+#else
+  return std::max(1u, std::thread::hardware_concurrency());
+#endif
+}
+
+std::unique_ptr<base::ThreadPool> MaybeCreateThreadPool(uint32_t thread_count) {
+  if (thread_count <= 1) {
+    return nullptr;
+  }
+  return std::make_unique<base::ThreadPool>(thread_count);
+}
+
+LazyThreadPool::LazyThreadPool(uint32_t thread_count)
+    : thread_count_(thread_count) {}
+LazyThreadPool::~LazyThreadPool() = default;
+
+base::ThreadPool* LazyThreadPool::Get() {
+  if (!pool_) {
+    pool_ = MaybeCreateThreadPool(thread_count_);
+  }
+  return pool_.get();
+}
+
+void ParallelFor(base::ThreadPool* pool,
+                 size_t count,
+                 const std::function<void(size_t)>& fn) {
+  if (!pool || count <= 1) {
+    for (size_t i = 0; i < count; ++i) {
+      fn(i);
+    }
+    return;
+  }
+  auto state = std::make_shared<ParallelForState>(count, &fn);
+
+  // The calling thread also claims indices so one less helper is needed.
+  size_t helpers = std::min<size_t>(pool->thread_count(), count - 1);
+  for (size_t i = 0; i < helpers; ++i) {
+    pool->PostTask([state] { state->RunUntilDone(); });
+  }
+  state->RunUntilDone();
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->cv.wait(lock, [&state] {
+    return state->done.load(std::memory_order_acquire) == state->count;
+  });
+}
+
+}  // namespace perfetto::trace_processor::util
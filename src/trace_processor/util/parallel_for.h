@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_UTIL_PARALLEL_FOR_H_
+#define SRC_TRACE_PROCESSOR_UTIL_PARALLEL_FOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace perfetto::base {
+class ThreadPool;
+}  // namespace perfetto::base
+
+namespace perfetto::trace_processor::util {
+
+// Returns the number of threads which trace processor should use for CPU bound
+// parallel work on this machine. Returns 1 on platforms where threads are not
+// supported (e.g. Wasm), in which case no ThreadPool should be created.
+uint32_t GetDefaultParallelism();
+
+// Creates a ThreadPool with |thread_count| threads or returns nullptr if
+// |thread_count| <= 1: ParallelFor runs inline when passed a null pool.
+std::unique_ptr<base::ThreadPool> MaybeCreateThreadPool(uint32_t thread_count);
+
+// Holds a ThreadPool which is only created the first time it is needed, so
+// that no threads are spawned unless there is parallel work to do.
+//
+// Not thread-safe: Get() must always be called from the same thread.
+class LazyThreadPool {
+ public:
+  explicit LazyThreadPool(uint32_t thread_count);
+  ~LazyThreadPool();
+
+  // Returns the pool, creating it on the first call, or nullptr if
+  // thread_count() <= 1 (see MaybeCreateThreadPool).
+  base::ThreadPool* Get();
+
+  uint32_t thread_count() const { return thread_count_; }
+
+ private:
+  const uint32_t thread_count_;
+  std::unique_ptr<base::ThreadPool> pool_;
+};
+
+// Calls |fn(i)| for every i in [0, count) and blocks until all the calls have
+// returned. The calls are distributed between the threads of |pool| and the
+// calling thread, in no particular order. If |pool| is nullptr, all the calls
+// happen on the calling thread, in increasing order of i.
+//
+// |fn| must be safe to call concurrently for different values of i.
+void ParallelFor(base::ThreadPool* pool,
+                 size_t count,
+                 const std::function<void(size_t)>& fn);
+
+}  // namespace perfetto::trace_processor::util
+
+#endif  // SRC_TRACE_PROCESSOR_UTIL_PARALLEL_FOR_H_
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/util/parallel_for.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "perfetto/ext/base/threading/thread_pool.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor::util {
+namespace {
+
+TEST(ParallelForTest, NullPoolRunsInOrder) {
+  std::vector<size_t> order;
+  ParallelFor(nullptr, 5, [&order](size_t i) { order.push_back(i); });
+  ASSERT_THAT(order, testing::ElementsAre(0u, 1u, 2u, 3u, 4u));
+}
+
+TEST(ParallelForTest, MaybeCreateThreadPool) {
+  ASSERT_EQ(MaybeCreateThreadPool(0), nullptr);
+  ASSERT_EQ(MaybeCreateThreadPool(1), nullptr);
+  std::unique_ptr<base::ThreadPool> pool = MaybeCreateThreadPool(3);
+  ASSERT_NE(pool, nullptr);
+  ASSERT_EQ(pool->thread_count(), 3u);
+}
+
+TEST(ParallelForTest, LazyThreadPool) {
+  LazyThreadPool single(1);
+  ASSERT_EQ(single.Get(), nullptr);
+
+  LazyThreadPool lazy(3);
+  ASSERT_EQ(lazy.thread_count(), 3u);
+  base::ThreadPool* pool = lazy.Get();
+  ASSERT_NE(pool, nullptr);
+  ASSERT_EQ(pool->thread_count(), 3u);
+  ASSERT_EQ(lazy.Get(), pool);
+}
+
+TEST(ParallelForTest, RunsEveryIndexOnce) {
+  base::ThreadPool pool(4);
+  std::vector<std::atomic<uint32_t>> calls(1000);
+  ParallelFor(&pool, calls.size(), [&calls](size_t i) { calls[i]++; });
+  for (const auto& c : calls) {
+    ASSERT_EQ(c.load(), 1u);
+  }
+}
+
+TEST(ParallelForTest, Nested) {
+  base::ThreadPool pool(2);
+  std::atomic<uint32_t> total{0};
+  ParallelFor(&pool, 8, [&](size_t) {
+    ParallelFor(&pool, 8, [&](size_t) { total++; });
+  });
+  ASSERT_EQ(total.load(), 64u);
+}
+
+TEST(ParallelForTest, Empty) {
+  base::ThreadPool pool(2);
+  ParallelFor(&pool, 0, [](size_t) { FAIL(); });
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor::util
@@ -0,0 +1,928 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/util/regex.h"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/build_config.h"
+#include "perfetto/base/compiler.h"
+#include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/flat_hash_map.h"
+#include "perfetto/ext/base/no_destructor.h"
+#include "perfetto/ext/base/status_macros.h"
+#include "perfetto/ext/base/status_or.h"
+
+namespace perfetto::trace_processor::regex {
+namespace {
+
+// Limits on the size of patterns which are compiled to an automaton: anything
+// bigger (i.e. with large repetition counts or deeply nested groups) is handed
+// to regex.h instead.
+constexpr uint32_t kMaxRepeat = 1000;
+constexpr uint32_t kMaxDepth = 256;
+constexpr size_t kMaxInsts = 64 * 1024;
+
+// Maximum number of DFA states kept by an automaton: once this is reached,
+// the DFA is thrown away and rebuilt lazily as strings are searched.
+constexpr size_t kMaxDfaStates = 4096;
+
+// Number of patterns kept by Regex::CreateCached on each thread.
+constexpr size_t kCacheSize = 16;
+
+using ByteSet = std::bitset<256>;
+
+ByteSet ByteRange(uint8_t lo, uint8_t hi) {
+  ByteSet set;
+  for (uint32_t c = lo; c <= hi; ++c) {
+    set.set(c);
+  }
+  return set;
+}
+
+ByteSet WordBytes() {
+  return ByteRange('a', 'z') | ByteRange('A', 'Z') | ByteRange('0', '9') |
+         ByteSet().set('_');
+}
+
+ByteSet SpaceBytes() {
+  return ByteRange('\t', '\r') | ByteSet().set(' ');
+}
+
+// Returns the bytes in the character class [:name:] in the C locale.
+std::optional<ByteSet> NamedClass(std::string_view name) {
+  ByteSet alpha = ByteRange('a', 'z') | ByteRange('A', 'Z');
+  ByteSet digit = ByteRange('0', '9');
+  ByteSet graph = ByteRange('!', '~');
+  if (name == "alpha")
+    return alpha;
+  if (name == "digit")
+    return digit;
+  if (name == "alnum")
+    return alpha | digit;
+  if (name == "upper")
+    return ByteRange('A', 'Z');
+  if (name == "lower")
+    return ByteRange('a', 'z');
+  if (name == "space")
+    return SpaceBytes();
+  if (name == "blank")
+    return ByteSet().set(' ').set('\t');
+  if (name == "punct")
+    return graph & ~(alpha | digit);
+  if (name == "print")
+    return ByteRange(' ', '~');
+  if (name == "graph")
+    return graph;
+  if (name == "cntrl")
+    return ByteRange(0, 0x1f).set(0x7f);
+  if (name == "xdigit")
+    return digit | ByteRange('a', 'f') | ByteRange('A', 'F');
+  return std::nullopt;
+}
+
+// A node of the syntax tree of a pattern.
+struct Node {
+  enum Kind : uint8_t {
+    kEmpty,
+    kBytes,
+    kBegin,
+    kEnd,
+    kConcat,
+    kAlternate,
+    kRepeat,
+  };
+  Kind kind = kEmpty;
+
+  // kBytes: the set of bytes matched.
+  ByteSet bytes;
+
+  // kConcat, kAlternate: the operands. kRepeat: the repeated node.
+  std::vector<uint32_t> children;
+
+  // kRepeat: the bounds on the number of repetitions. |max| is nullopt if
+  // the number of repetitions is unbounded.
+  uint32_t min = 0;
+  std::optional<uint32_t> max;
+};
+
+// Parses the subset of POSIX extended regular expressions supported by the
+// automaton. Returns nullopt for anything else (including malformed patterns)
+// in which case regex.h decides what to do with the pattern.
+class Parser {
+ public:
+  Parser(std::string_view pattern, std::vector<Node>* nodes)
+      : p_(pattern), nodes_(nodes) {}
+
+  std::optional<uint32_t> Parse() {
+    std::optional<uint32_t> root = ParseAlternate();
+    // Stray closing parentheses are treated as literals by regex.h.
+    if (!root || pos_ != p_.size()) {
+      return std::nullopt;
+    }
+    return root;
+  }
+
+ private:
+  std::optional<uint32_t> ParseAlternate() {
+    std::vector<uint32_t> branches;
+    do {
+      std::optional<uint32_t> branch = ParseConcat();
+      if (!branch) {
+        return std::nullopt;
+      }
+      branches.push_back(*branch);
+    } while (Consume('|'));
+    if (branches.size() == 1) {
+      return branches[0];
+    }
+    Node node;
+    node.kind = Node::kAlternate;
+    node.children = std::move(branches);
+    return Add(std::move(node));
+  }
+
+  std::optional<uint32_t> ParseConcat() {
+    std::vector<uint32_t> items;
+    while (pos_ < p_.size() && p_[pos_] != '|' && p_[pos_] != ')') {
+      std::optional<uint32_t> item = ParseRepeat();
+      if (!item) {
+        return std::nullopt;
+      }
+      // Flatten concatenations coming from groups: this makes finding the
+      // literal prefix of the pattern easier.
+      const Node& node = (*nodes_)[*item];
+      if (node.kind == Node::kConcat) {
+        items.insert(items.end(), node.children.begin(), node.children.end());
+      } else {
+        items.push_back(*item);
+      }
+    }
+    // regex.h treats anchors in the middle of a pattern inconsistently (e.g.
+    // "$." can match "\nA"): only support them at the edges of top-level
+    // branches.
+    for (size_t i = 0; i < items.size(); ++i) {
+      Node::Kind kind = (*nodes_)[items[i]].kind;
+      if ((kind == Node::kBegin && i != 0) ||
+          (kind == Node::kEnd && i != items.size() - 1)) {
+        return std::nullopt;
+      }
+    }
+    if (items.size() == 1) {
+      return items[0];
+    }
+    Node node;
+    node.kind = items.empty() ? Node::kEmpty : Node::kConcat;
+    node.children = std::move(items);
+    return Add(std::move(node));
+  }
+
+  std::optional<uint32_t> ParseRepeat() {
+    std::optional<uint32_t> atom = ParseAtom();
+    while (atom && pos_ < p_.size()) {
+      Node node;
+      node.kind = Node::kRepeat;
+      switch (p_[pos_]) {
+        case '*':
+          ++pos_;
+          break;
+        case '+':
+          ++pos_;
+          node.min = 1;
+          break;
+        case '?':
+          ++pos_;
+          node.max = 1;
+          break;
+        case '{':
+          if (!ParseInterval(node)) {
+            return std::nullopt;
+          }
+          break;
+        default:
+          return atom;
+      }
+      Node::Kind kind = (*nodes_)[*atom].kind;
+      if (kind == Node::kBegin || kind == Node::kEnd) {
+        return std::nullopt;
+      }
+      node.children.push_back(*atom);
+      atom = Add(std::move(node));
+    }
+    return atom;
+  }
+
+  // Parses {m}, {m,} or {m,n}.
+  bool ParseInterval(Node& node) {
+    PERFETTO_DCHECK(p_[pos_] == '{');
+    ++pos_;
+    std::optional<uint32_t> min = ParseNumber();
+    if (!min) {
+      return false;
+    }
+    node.min = *min;
+    if (Consume(',')) {
+      if (pos_ < p_.size() && p_[pos_] != '}') {
+        node.max = ParseNumber();
+        if (!node.max || *node.max < node.min) {
+          return false;
+        }
+      }
+    } else {
+      node.max = node.min;
+    }
+    return Consume('}');
+  }
+
+  std::optional<uint32_t> ParseNumber() {
+    uint32_t value = 0;
+    size_t start = pos_;
+    for (; pos_ < p_.size() && p_[pos_] >= '0' && p_[pos_] <= '9'; ++pos_) {
+      value = value * 10 + static_cast<uint32_t>(p_[pos_] - '0');
+      if (value > kMaxRepeat) {
+        return std::nullopt;
+      }
+    }
+    if (pos_ == start) {
+      return std::nullopt;
+    }
+    return value;
+  }
+
+  std::optional<uint32_t> ParseAtom() {
+    char c = p_[pos_++];
+    switch (c) {
+      case '(': {
+        if (++depth_ > kMaxDepth) {
+          return std::nullopt;
+        }
+        std::optional<uint32_t> inner = ParseAlternate();
+        if (!inner || !Consume(')')) {
+          return std::nullopt;
+        }
+        --depth_;
+        return inner;
+      }
+      case '[':
+        return ParseBracket();
+      case '.':
+        return AddBytes(ByteSet().set());
+      case '^':
+      case '$':
+        if (depth_ > 0) {
+          return std::nullopt;
+        }
+        return Add(Node{c == '^' ? Node::kBegin : Node::kEnd,
+                        {},
+                        {},
+                        0,
+                        std::nullopt});
+      case '*':
+      case '+':
+      case '?':
+      case '{':
+        return std::nullopt;
+      case '\\':
+        return ParseEscape();
+      default:
+        return AddBytes(ByteSet().set(static_cast<uint8_t>(c)));
+    }
+  }
+
+  std::optional<uint32_t> ParseEscape() {
+    if (pos_ == p_.size()) {
+      return std::nullopt;
+    }
+    char c = p_[pos_++];
+    switch (c) {
+      case 'w':
+        return AddBytes(WordBytes());
+      case 'W':
+        return AddBytes(~WordBytes());
+      case 's':
+        return AddBytes(SpaceBytes());
+      case 'S':
+        return AddBytes(~SpaceBytes());
+      // Back-references and word boundaries.
+      case 'b':
+      case 'B':
+      case '<':
+      case '>':
+      case '`':
+      case '\'':
+        return std::nullopt;
+      default:
+        if (c >= '1' && c <= '9') {
+          return std::nullopt;
+        }
+        return AddBytes(ByteSet().set(static_cast<uint8_t>(c)));
+    }
+  }
+
+  // Parses a bracket expression, after the opening bracket.
+  std::optional<uint32_t> ParseBracket() {
+    ByteSet set;
+    bool negate = Consume('^');
+    for (bool first = true;; first = false) {
+      if (pos_ == p_.size()) {
+        return std::nullopt;
+      }
+      if (p_[pos_] == ']' && !first) {
+        ++pos_;
+        break;
+      }
+      if (p_[pos_] == '[' && pos_ + 1 < p_.size() &&
+          (p_[pos_ + 1] == ':' || p_[pos_ + 1] == '.' ||
+           p_[pos_ + 1] == '=')) {
+        // Collating elements and equivalence classes are not supported.
+        if (p_[pos_ + 1] != ':') {
+          return std::nullopt;
+        }
+        size_t close = p_.find(":]", pos_ + 2);
+        if (close == std::string_view::npos) {
+          return std::nullopt;
+        }
+        std::optional<ByteSet> cls =
+            NamedClass(p_.substr(pos_ + 2, close - pos_ - 2));
+        if (!cls || IsRangeAt(close + 2)) {
+          return std::nullopt;
+        }
+        set |= *cls;
+        pos_ = close + 2;
+        continue;
+      }
+      auto lo = static_cast<uint8_t>(p_[pos_++]);
+      if (!IsRangeAt(pos_)) {
+        set.set(lo);
+        continue;
+      }
+      auto hi = static_cast<uint8_t>(p_[pos_ + 1]);
+      if (hi < lo || hi == '[') {
+        return std::nullopt;
+      }
+      set |= ByteRange(lo, hi);
+      pos_ += 2;
+      // The end of a range can't be the start of another one.
+      if (IsRangeAt(pos_)) {
+        return std::nullopt;
+      }
+    }
+    if (negate) {
+      set.flip();
+    }
+    return AddBytes(set);
+  }
+
+  // Returns true if there is a '-' at |pos| which is not the last character
+  // of a bracket expression.
+  bool IsRangeAt(size_t pos) const {
+    return pos + 1 < p_.size() && p_[pos] == '-' && p_[pos + 1] != ']';
+  }
+
+  bool Consume(char c) {
+    if (pos_ < p_.size() && p_[pos_] == c) {
+      ++pos_;
+      return true;
+    }
+    return false;
+  }
+
+  uint32_t AddBytes(ByteSet bytes) {
+    return Add(Node{Node::kBytes, bytes, {}, 0, std::nullopt});
+  }
+
+  uint32_t Add(Node node) {
+    nodes_->push_back(std::move(node));
+    return static_cast<uint32_t>(nodes_->size() - 1);
+  }
+
+  std::string_view p_;
+  size_t pos_ = 0;
+  // Number of enclosing groups.
+  uint32_t depth_ = 0;
+  std::vector<Node>* nodes_;
+};
+
+}  // namespace
+
+// A Thompson NFA for a pattern which is lazily converted into a DFA as
+// strings are searched.
+class Automaton {
+ public:
+  // Returns nullptr if the pattern is not supported by the automaton.
+  static std::unique_ptr<Automaton> Compile(std::string_view pattern);
+
+  bool Search(std::string_view s) const;
+
+ private:
+  struct Inst {
+    enum Op : uint8_t {
+      // Consumes a byte in |byte_sets_[set]| and continues at |x|.
+      kByte,
+      // Continues at both |x| and |y|.
+      kSplit,
+      // Continues at |x| if at the start of the string.
+      kBegin,
+      // Continues at |x| if at the end of the string.
+      kEnd,
+      kMatch,
+    };
+    Op op;
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t set = 0;
+  };
+
+  struct State {
+    // The sorted kByte, kEnd and kMatch instructions reachable in this state.
+    std::vector<uint32_t> insts;
+    bool match = false;
+    // Whether the string matches if it ends in this state: -1 until computed.
+    int8_t match_at_end = -1;
+  };
+
+  Automaton() = default;
+
+  uint32_t Emit(const std::vector<Node>& nodes, uint32_t node, uint32_t next);
+  uint32_t Push(Inst inst);
+  void ComputeByteClasses();
+  void FindLiteralPrefix(const std::vector<Node>& nodes, uint32_t root);
+
+  void Closure(bool at_start, bool at_end, std::vector<uint32_t>* out) const;
+  uint32_t Transition(uint32_t from, uint8_t cls) const;
+  uint32_t AddState(const std::vector<uint32_t>& insts) const;
+  void ResetDfa() const;
+  bool MatchAtEnd(uint32_t state) const;
+
+  std::vector<Inst> insts_;
+  uint32_t start_ = 0;
+  std::vector<ByteSet> byte_sets_;
+  // Node index to index in |byte_sets_|.
+  std::map<uint32_t, uint32_t> node_sets_;
+
+  // Bytes which no instruction distinguishes share the same class: DFA
+  // transitions are stored per class rather than per byte.
+  std::array<uint8_t, 256> byte_class_{};
+  std::vector<uint8_t> class_byte_;
+
+  // Literal which every match starts with. If |anchored_|, matches must also
+  // start at the beginning of the string and if |literal_|, the pattern
+  // matches exactly this literal.
+  std::string prefix_;
+  bool anchored_ = false;
+  bool literal_ = false;
+  bool matches_empty_ = false;
+
+  // The instructions reachable from |start_| at the start of the string and
+  // anywhere else.
+  std::vector<uint32_t> begin_insts_;
+  std::vector<uint32_t> mid_insts_;
+
+  // The lazily built DFA. Search() is const but grows it, without any
+  // synchronization: see the thread-safety note on Regex.
+  mutable std::vector<State> states_;
+  mutable std::vector<int32_t> transitions_;
+  mutable base::FlatHashMap<std::string, uint32_t> state_ids_;
+  mutable uint32_t begin_state_ = 0;
+  mutable uint32_t mid_state_ = 0;
+
+  // Scratch space used to compute closures.
+  mutable std::vector<uint32_t> stack_;
+  mutable std::vector<uint32_t> seen_;
+  mutable uint32_t seen_generation_ = 0;
+  mutable std::vector<uint32_t> next_insts_;
+};
+
+std::unique_ptr<Automaton> Automaton::Compile(std::string_view pattern) {
+  std::vector<Node> nodes;
+  std::optional<uint32_t> root = Parser(pattern, &nodes).Parse();
+  if (!root) {
+    return nullptr;
+  }
+  std::unique_ptr<Automaton> a(new Automaton());
+  a->Push(Inst{Inst::kMatch});
+  a->start_ = a->Emit(nodes, *root, 0);
+  if (a->insts_.size() > kMaxInsts) {
+    return nullptr;
+  }
+  a->ComputeByteClasses();
+  a->FindLiteralPrefix(nodes, *root);
+
+  a->seen_.resize(a->insts_.size());
+  a->stack_.push_back(a->start_);
+  a->Closure(true, false, &a->begin_insts_);
+  a->stack_.push_back(a->start_);
+  a->Closure(false, false, &a->mid_insts_);
+  std::vector<uint32_t> empty;
+  a->stack_.push_back(a->start_);
+  a->Closure(true, true, &empty);
+  a->matches_empty_ = std::any_of(empty.begin(), empty.end(), [&](uint32_t i) {
+    return a->insts_[i].op == Inst::kMatch;
+  });
+  a->ResetDfa();
+  return a;
+}
+
+// Emits the instructions for |node| which continue at |next| and returns the
+// first one. Instructions are emitted backwards from the end of the pattern.
+uint32_t Automaton::Emit(const std::vector<Node>& nodes,
+                         uint32_t node,
+                         uint32_t next) {
+  if (insts_.size() > kMaxInsts) {
+    return next;
+  }
+  const Node& n = nodes[node];
+  switch (n.kind) {
+    case Node::kEmpty:
+      return next;
+    case Node::kBytes: {
+      auto [it, inserted] = node_sets_.emplace(node, 0);
+      if (inserted) {
+        auto set = std::find(byte_sets_.begin(), byte_sets_.end(), n.bytes);
+        it->second = static_cast<uint32_t>(set - byte_sets_.begin());
+        if (set == byte_sets_.end()) {
+          byte_sets_.push_back(n.bytes);
+        }
+      }
+      return Push(Inst{Inst::kByte, next, 0, it->second});
+    }
+    case Node::kBegin:
+      return Push(Inst{Inst::kBegin, next});
+    case Node::kEnd:
+      return Push(Inst{Inst::kEnd, next});
+    case Node::kConcat:
+      for (auto it = n.children.rbegin(); it != n.children.rend(); ++it) {
+        next = Emit(nodes, *it, next);
+      }
+      return next;
+    case Node::kAlternate: {
+      uint32_t first = Emit(nodes, n.children.back(), next);
+      for (size_t i = n.children.size() - 1; i-- > 0;) {
+        uint32_t branch = Emit(nodes, n.children[i], next);
+        first = Push(Inst{Inst::kSplit, branch, first});
+      }
+      return first;
+    }
+    case Node::kRepeat: {
+      uint32_t child = n.children[0];
+      uint32_t first = next;
+      if (n.max) {
+        // x{0,2} is emitted as (x(x)?)?.
+        for (uint32_t i = n.min; i < *n.max; ++i) {
+          first = Push(Inst{Inst::kSplit, Emit(nodes, child, first), next});
+        }
+      } else {
+        first = Push(Inst{Inst::kSplit, 0, next});
+        uint32_t body = Emit(nodes, child, first);
+        insts_[first].x = body;
+      }
+      for (uint32_t i = 0; i < n.min; ++i) {
+        first = Emit(nodes, child, first);
+      }
+      return first;
+    }
+  }
+  PERFETTO_FATAL("For GCC");
+}
+
+uint32_t Automaton::Push(Inst inst) {
+  insts_.push_back(inst);
+  return static_cast<uint32_t>(insts_.size() - 1);
+}
+
+void Automaton::ComputeByteClasses() {
+  std::map<std::vector<bool>, uint8_t> classes;
+  std::vector<bool> key(byte_sets_.size());
+  for (uint32_t c = 0; c < 256; ++c) {
+    for (size_t i = 0; i < byte_sets_.size(); ++i) {
+      key[i] = byte_sets_[i].test(c);
+    }
+    auto [it, inserted] =
+        classes.emplace(key, static_cast<uint8_t>(class_byte_.size()));
+    if (inserted) {
+      class_byte_.push_back(static_cast<uint8_t>(c));
+    }
+    byte_class_[c] = it->second;
+  }
+}
+
+void Automaton::FindLiteralPrefix(const std::vector<Node>& nodes,
+                                  uint32_t root) {
+  std::vector<uint32_t> items = nodes[root].kind == Node::kConcat
+                                    ? nodes[root].children
+                                    : std::vector<uint32_t>{root};
+  size_t i = 0;
+  if (nodes[items[0]].kind == Node::kBegin) {
+    anchored_ = true;
+    ++i;
+  }
+  for (; i < items.size(); ++i) {
+    const Node& n = nodes[items[i]];
+    if (n.kind != Node::kBytes || n.bytes.count() != 1) {
+      break;
+    }
+    for (uint32_t c = 0; c < 256; ++c) {
+      if (n.bytes.test(c)) {
+        prefix_.push_back(static_cast<char>(c));
+      }
+    }
+  }
+  literal_ = !anchored_ && i == items.size();
+}
+
+// Computes the instructions reachable from the instructions in |stack_|
+// without consuming any byte, storing them in |out|.
+void Automaton::Closure(bool at_start,
+                        bool at_end,
+                        std::vector<uint32_t>* out) const {
+  if (++seen_generation_ == 0) {
+    std::fill(seen_.begin(), seen_.end(), 0);
+    seen_generation_ = 1;
+  }
+  out->clear();
+  while (!stack_.empty()) {
+    uint32_t pc = stack_.back();
+    stack_.pop_back();
+    if (seen_[pc] == seen_generation_) {
+      continue;
+    }
+    seen_[pc] = seen_generation_;
+    const Inst& inst = insts_[pc];
+    switch (inst.op) {
+      case Inst::kByte:
+      case Inst::kMatch:
+        out->push_back(pc);
+        break;
+      case Inst::kSplit:
+        stack_.push_back(inst.y);
+        stack_.push_back(inst.x);
+        break;
+      case Inst::kBegin:
+        if (at_start) {
+          stack_.push_back(inst.x);
+        }
+        break;
+      case Inst::kEnd:
+        if (at_end) {
+          stack_.push_back(inst.x);
+        } else {
+          out->push_back(pc);
+        }
+        break;
+    }
+  }
+  std::sort(out->begin(), out->end());
+}
+
+uint32_t Automaton::Transition(uint32_t from, uint8_t cls) const {
+  uint8_t byte = class_byte_[cls];
+  for (uint32_t pc : states_[from].insts) {
+    const Inst& inst = insts_[pc];
+    if (inst.op == Inst::kByte && byte_sets_[inst.set].test(byte)) {
+      stack_.push_back(inst.x);
+    }
+  }
+  // Matches can start anywhere in the string.
+  stack_.push_back(start_);
+  Closure(false, false, &next_insts_);
+
+  std::string key(reinterpret_cast<const char*>(next_insts_.data()),
+                  next_insts_.size() * sizeof(uint32_t));
+  if (uint32_t* id = state_ids_.Find(key); id) {
+    transitions_[from * class_byte_.size() + cls] = static_cast<int32_t>(*id);
+    return *id;
+  }
+  if (states_.size() >= kMaxDfaStates) {
+    // |from| is invalidated by the reset so the transition is not recorded.
+    ResetDfa();
+    return AddState(next_insts_);
+  }
+  uint32_t id = AddState(next_insts_);
+  transitions_[from * class_byte_.size() + cls] = static_cast<int32_t>(id);
+  return id;
+}
+
+uint32_t Automaton::AddState(const std::vector<uint32_t>& insts) const {
+  std::string key(reinterpret_cast<const char*>(insts.data()),
+                  insts.size() * sizeof(uint32_t));
+  auto [id, inserted] =
+      state_ids_.Insert(std::move(key), static_cast<uint32_t>(states_.size()));
+  if (!inserted) {
+    return *id;
+  }
+  State state;
+  state.insts = insts;
+  state.match = std::any_of(insts.begin(), insts.end(), [this](uint32_t pc) {
+    return insts_[pc].op == Inst::kMatch;
+  });
+  states_.push_back(std::move(state));
+  transitions_.resize(states_.size() * class_byte_.size(), -1);
+  return *id;
+}
+
+void Automaton::ResetDfa() const {
+  states_.clear();
+  transitions_.clear();
+  state_ids_.Clear();
+  begin_state_ = AddState(begin_insts_);
+  mid_state_ = AddState(mid_insts_);
+}
+
+bool Automaton::MatchAtEnd(uint32_t state) const {
+  State& s = states_[state];
+  if (s.match_at_end == -1) {
+    for (uint32_t pc : s.insts) {
+      if (insts_[pc].op == Inst::kEnd) {
+        stack_.push_back(insts_[pc].x);
+      }
+    }
+    Closure(false, true, &next_insts_);
+    s.match_at_end = std::any_of(
+        next_insts_.begin(), next_insts_.end(),
+        [this](uint32_t pc) { return insts_[pc].op == Inst::kMatch; });
+  }
+  return s.match_at_end == 1;
+}
+
+bool Automaton::Search(std::string_view s) const {
+  if (literal_) {
+    return s.find(prefix_) != std::string_view::npos;
+  }
+  if (s.empty()) {
+    return matches_empty_;
+  }
+  size_t pos = 0;
+  if (anchored_) {
+    if (s.substr(0, prefix_.size()) != prefix_) {
+      return false;
+    }
+  } else if (!prefix_.empty()) {
+    // Matches must start with the prefix so skip straight to its first
+    // occurrence.
+    pos = s.find(prefix_);
+    if (pos == std::string_view::npos) {
+      return false;
+    }
+  }
+  uint32_t state = pos == 0 ? begin_state_ : mid_state_;
+  const size_t num_classes = class_byte_.size();
+  for (; pos < s.size(); ++pos) {
+    const State& st = states_[state];
+    if (st.match) {
+      return true;
+    }
+    if (st.insts.empty()) {
+      return false;
+    }
+    uint8_t cls = byte_class_[static_cast<uint8_t>(s[pos])];
+    int32_t next = transitions_[state * num_classes + cls];
+    state = next >= 0 ? static_cast<uint32_t>(next) : Transition(state, cls);
+  }
+  return states_[state].match || MatchAtEnd(state);
+}
+
+Regex::Regex(std::string pattern, std::unique_ptr<Automaton> automaton)
+    : pattern_(std::move(pattern)), automaton_(std::move(automaton)) {}
+
+Regex::~Regex() {
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
+  if (regex_) {
+    regfree(&regex_.value());
+  }
+#endif
+}
+
+Regex::Regex(Regex&& other) noexcept
+    : pattern_(std::move(other.pattern_)),
+      automaton_(std::move(other.automaton_)) {
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
+  regex_ = other.regex_;
+  other.regex_ = std::nullopt;
+  pmatch_ = std::move(other.pmatch_);
+#endif
+}
+
+Regex& Regex::operator=(Regex&& other) noexcept {
+  this->~Regex();
+  new (this) Regex(std::move(other));
+  return *this;
+}
+
+base::StatusOr<Regex> Regex::Create(const char* pattern) {
+  Regex regex(pattern, Automaton::Compile(pattern));
+  if (!regex.automaton_) {
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
+    if (!regex.CompilePosix()) {
+      return base::ErrStatus("Regex pattern '%s' is malformed.", pattern);
+    }
+#else
+    return base::ErrStatus(
+        "Regex pattern '%s' is malformed or not supported on Windows.",
+        pattern);
+#endif
+  }
+  return regex;
+}
+
+base::StatusOr<std::shared_ptr<Regex>> Regex::CreateCached(
+    const char* pattern) {
+  struct Entry {
+    std::string pattern;
+    std::shared_ptr<Regex> regex;
+  };
+  // Ordered from the least to the most recently used. The cache is per-thread
+  // as the regexes in it can't be searched concurrently.
+  thread_local base::NoDestructor<std::vector<Entry>> cache;
+  std::vector<Entry>& entries = cache.ref();
+  for (auto it = entries.begin(); it != entries.end(); ++it) {
+    if (it->pattern == pattern) {
+      std::rotate(it, it + 1, entries.end());
+      return entries.back().regex;
+    }
+  }
+  ASSIGN_OR_RETURN(Regex regex, Create(pattern));
+  if (entries.size() == kCacheSize) {
+    entries.erase(entries.begin());
+  }
+  entries.push_back(Entry{pattern, std::make_shared<Regex>(std::move(regex))});
+  return entries.back().regex;
+}
+
+bool Regex::Search(const char* s) const {
+  if (automaton_) {
+    return automaton_->Search(s);
+  }
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
+  PERFETTO_CHECK(regex_);
+  return regexec(&regex_.value(), s, 0, nullptr, 0) == 0;
+#else
+  PERFETTO_FATAL("Regex without automaton on Windows.");
+#endif
+}
+
+void Regex::Submatch(const char* s, std::vector<std::string_view>& out) {
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
+  out.clear();
+  if (!regex_ && !CompilePosix()) {
+    return;
+  }
+  const auto& rgx = regex_.value();
+  size_t nmatch = rgx.re_nsub + 1;
+  pmatch_.resize(nmatch);
+
+  if (regexec(&rgx, s, nmatch, pmatch_.data(), 0) != 0) {
+    return;
+  }
+  for (size_t i = 0; i < nmatch; ++i) {
+    if (pmatch_[i].rm_so == -1) {
+      // Optional group that did not match.
+      out.emplace_back();
+    } else {
+      out.emplace_back(
+          s + pmatch_[i].rm_so,
+          static_cast<size_t>(pmatch_[i].rm_eo - pmatch_[i].rm_so));
+    }
+  }
+#else
+  base::ignore_result(s, out);
+  PERFETTO_FATAL("Windows regex is not supported.");
+#endif
+}
+
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
+bool Regex::CompilePosix() {
+  regex_t regex;
+  if (regcomp(&regex, pattern_.c_str(), REG_EXTENDED)) {
+    return false;
+  }
+  regex_ = regex;
+  return true;
+}
+#endif
+
+}  // namespace perfetto::trace_processor::regex
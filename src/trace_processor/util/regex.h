@@ -17,15 +17,13 @@
 #ifndef SRC_TRACE_PROCESSOR_UTIL_REGEX_H_
 #define SRC_TRACE_PROCESSOR_UTIL_REGEX_H_
 
-#include <cstddef>
+#include <memory>
 #include <optional>
+#include <string>
 #include <string_view>
-#include <utility>
 #include <vector>
 
 #include "perfetto/base/build_config.h"
-#include "perfetto/base/logging.h"
-#include "perfetto/base/status.h"
 #include "perfetto/ext/base/status_or.h"
 
 #if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
@@ -34,7 +32,17 @@
 
 namespace perfetto::trace_processor::regex {
 
+class Automaton;
+
+// Returns true if Regex::Search is supported. Searching uses our own regex
+// engine so is supported on all platforms.
 constexpr bool IsRegexSupported() {
+  return true;
+}
+
+// Returns true if Regex::Submatch is supported. Submatching is based on the C
+// library `regex.h` so doesn't work on Windows.
+constexpr bool IsSubmatchSupported() {
 #if PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
   return false;
 #else
@@ -42,94 +50,66 @@ constexpr bool IsRegexSupported() {
 #endif
 }
 
-// Implements regex parsing and regex search based on C library `regex.h`.
-// Doesn't work on Windows.
+// Implements POSIX extended regular expressions.
+//
+// Search is implemented by compiling the pattern to an automaton which is
+// lazily converted to a DFA as strings are matched: this makes each search
+// linear in the length of the string. Patterns using constructs which the
+// automaton doesn't support (e.g. back-references or word boundaries) fall
+// back to the C library `regex.h` (and are rejected on Windows).
+//
+// This class is not thread-safe: even though Search() is const, it grows the
+// DFA shared by all the searches, so a Regex must not be used by several
+// threads at the same time. Threads which match the same pattern should each
+// create their own Regex; CreateCached() already returns one per thread.
 class Regex {
  public:
-#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
-  ~Regex() {
-    if (regex_) {
-      regfree(&regex_.value());
-    }
-  }
+  ~Regex();
+  Regex(Regex&&) noexcept;
+  Regex& operator=(Regex&&) noexcept;
   Regex(const Regex&) = delete;
-  Regex(Regex&& other) {
-    regex_ = other.regex_;
-    other.regex_ = std::nullopt;
-  }
-  Regex& operator=(Regex&& other) {
-    this->~Regex();
-    new (this) Regex(std::move(other));
-    return *this;
-  }
   Regex& operator=(const Regex&) = delete;
-#endif
 
   // Parse regex pattern. Returns error if regex pattern is invalid.
-  static base::StatusOr<Regex> Create(const char* pattern) {
-#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
-    regex_t regex;
-    if (regcomp(&regex, pattern, REG_EXTENDED)) {
-      return base::ErrStatus("Regex pattern '%s' is malformed.", pattern);
-    }
-    return Regex(regex);
-#else
-    base::ignore_result(pattern);
-    PERFETTO_FATAL("Windows regex is not supported.");
-#endif
-  }
+  static base::StatusOr<Regex> Create(const char* pattern);
 
-  // Returns true if string matches the regex.
-  bool Search(const char* s) const {
-#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
-    PERFETTO_CHECK(regex_);
-    return regexec(&regex_.value(), s, 0, nullptr, 0) == 0;
-#else
-    base::ignore_result(s);
-    PERFETTO_FATAL("Windows regex is not supported.");
-#endif
-  }
+  // Same as Create but reuses the regex if |pattern| was recently created
+  // with this function on the calling thread: this avoids recompiling (and
+  // rebuilding the DFA of) patterns which are used by many queries. The
+  // returned regex must only be used on the calling thread.
+  static base::StatusOr<std::shared_ptr<Regex>> CreateCached(
+      const char* pattern);
+
+  // Returns true if string matches the regex. See the class comment about
+  // thread-safety.
+  bool Search(const char* s) const;
 
   // Returns a vector of string views representing the matched groups.
   // The first element is the full match. Subsequent elements are parenthesized
   // subexpressions.
-  // Returns nullopt if there is no match.
-  void Submatch(const char* s, std::vector<std::string_view>& out) {
-#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
-    PERFETTO_CHECK(regex_);
-    const auto& rgx = regex_.value();
-    size_t nmatch = rgx.re_nsub + 1;
-    pmatch_.resize(nmatch);
-
-    out.clear();
-    if (regexec(&rgx, s, nmatch, pmatch_.data(), 0) != 0) {
-      return;
-    }
-    for (size_t i = 0; i < nmatch; ++i) {
-      if (pmatch_[i].rm_so == -1) {
-        // Optional group that did not match.
-        out.emplace_back();
-      } else {
-        out.emplace_back(
-            s + pmatch_[i].rm_so,
-            static_cast<size_t>(pmatch_[i].rm_eo - pmatch_[i].rm_so));
-      }
-    }
-#else
-    base::ignore_result(out);
-    if (s)
-      PERFETTO_FATAL("Windows regex is not supported.");
-#endif
-  }
+  // |out| is cleared if there is no match.
+  //
+  // Only supported if IsSubmatchSupported() returns true.
+  void Submatch(const char* s, std::vector<std::string_view>& out);
 
-#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
  private:
-  explicit Regex(regex_t regex) : regex_(regex) {}
+  Regex(std::string pattern, std::unique_ptr<Automaton> automaton);
+
+  std::string pattern_;
+
+  // Null if the pattern uses constructs not supported by the automaton.
+  std::unique_ptr<Automaton> automaton_;
+
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
+  // Compiled eagerly if |automaton_| is null and lazily on the first call to
+  // Submatch otherwise.
+  bool CompilePosix();
 
   std::optional<regex_t> regex_;
   std::vector<regmatch_t> pmatch_;
 #endif
 };
+
 }  // namespace perfetto::trace_processor::regex
 
 #endif  // SRC_TRACE_PROCESSOR_UTIL_REGEX_H_
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/util/regex.h"
+
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/build_config.h"
+
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
+#include <regex.h>
+#endif
+
+namespace {
+
+using benchmark::Counter;
+using perfetto::trace_processor::regex::Regex;
+
+const char kLiteralRegex[] = "doFrame";
+const char kPrefixRegex[] = "Choreographer#doFrame [0-9]+";
+const char kAnchoredRegex[] = "^binder (reply|transaction)";
+const char kAlternationRegex[] = "(inflate|measure|layout|draw)";
+const char kCharClassRegex[] = "[[:digit:]]+ms$";
+
+// Returns strings which look like slice names from an Android trace.
+std::vector<std::string> CreateStrings() {
+  static const char* kNames[] = {
+      "Choreographer#doFrame ",
+      "binder transaction",
+      "binder reply",
+      "RenderThread::draw",
+      "inflate",
+      "Lock contention on thread list lock (owner tid: ",
+      "android.os.Handler: android.view.View$PerformClick",
+      "measure",
+      "layout",
+      "traversal took ",
+  };
+  std::vector<std::string> strs;
+  std::minstd_rand0 rnd(0);
+  for (uint32_t i = 0; i < 100000; ++i) {
+    std::string str = kNames[rnd() % (sizeof(kNames) / sizeof(kNames[0]))];
+    str += std::to_string(rnd() % 100000);
+    if (rnd() % 4 == 0) {
+      str += "ms";
+    }
+    strs.push_back(std::move(str));
+  }
+  return strs;
+}
+
+void SetCounters(benchmark::State& state, size_t count) {
+  state.counters["str/s"] = Counter(static_cast<double>(count),
+                                    Counter::kIsIterationInvariantRate);
+  state.counters["s/str"] =
+      Counter(static_cast<double>(count),
+              Counter::kIsIterationInvariantRate | Counter::kInvert);
+}
+
+template <class... Args>
+void BM_Regex(benchmark::State& state, Args&&... args) {
+  auto args_tuple = std::make_tuple(std::move(args)...);
+
+  std::vector<std::string> strs = CreateStrings();
+  Regex regex = std::move(*Regex::Create(std::get<0>(args_tuple)));
+  for (auto _ : state) {
+    for (const std::string& str : strs) {
+      benchmark::DoNotOptimize(regex.Search(str.c_str()));
+    }
+    benchmark::ClobberMemory();
+  }
+  SetCounters(state, strs.size());
+}
+
+BENCHMARK_CAPTURE(BM_Regex, literal, kLiteralRegex);
+BENCHMARK_CAPTURE(BM_Regex, prefix, kPrefixRegex);
+BENCHMARK_CAPTURE(BM_Regex, anchored, kAnchoredRegex);
+BENCHMARK_CAPTURE(BM_Regex, alternation, kAlternationRegex);
+BENCHMARK_CAPTURE(BM_Regex, char_class, kCharClassRegex);
+
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
+template <class... Args>
+void BM_PosixRegex(benchmark::State& state, Args&&... args) {
+  auto args_tuple = std::make_tuple(std::move(args)...);
+
+  std::vector<std::string> strs = CreateStrings();
+  regex_t regex;
+  if (regcomp(&regex, std::get<0>(args_tuple), REG_EXTENDED)) {
+    state.SkipWithError("Failed to compile regex");
+    return;
+  }
+  for (auto _ : state) {
+    for (const std::string& str : strs) {
+      benchmark::DoNotOptimize(regexec(&regex, str.c_str(), 0, nullptr, 0));
+    }
+    benchmark::ClobberMemory();
+  }
+  regfree(&regex);
+  SetCounters(state, strs.size());
+}
+
+BENCHMARK_CAPTURE(BM_PosixRegex, literal, kLiteralRegex);
+BENCHMARK_CAPTURE(BM_PosixRegex, prefix, kPrefixRegex);
+BENCHMARK_CAPTURE(BM_PosixRegex, anchored, kAnchoredRegex);
+BENCHMARK_CAPTURE(BM_PosixRegex, alternation, kAlternationRegex);
+BENCHMARK_CAPTURE(BM_PosixRegex, char_class, kCharClassRegex);
+#endif
+
+}  // namespace
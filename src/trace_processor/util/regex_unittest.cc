@@ -15,11 +15,118 @@
  */
 
 #include "src/trace_processor/util/regex.h"
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/build_config.h"
 #include "test/gtest_and_gmock.h"
 
 namespace perfetto::trace_processor::regex {
 namespace {
 
+bool Search(const char* pattern, const char* s) {
+  auto regex = Regex::Create(pattern);
+  PERFETTO_CHECK(regex.ok());
+  return regex->Search(s);
+}
+
+TEST(Regex, SearchLiteral) {
+  EXPECT_TRUE(Search("doFrame", "Choreographer#doFrame 123"));
+  EXPECT_FALSE(Search("doFrame", "Choreographer#doframe 123"));
+  EXPECT_TRUE(Search("", "anything"));
+  EXPECT_TRUE(Search("", ""));
+}
+
+TEST(Regex, SearchAnchors) {
+  EXPECT_TRUE(Search("^binder", "binder transaction"));
+  EXPECT_FALSE(Search("^binder", "a binder transaction"));
+  EXPECT_TRUE(Search("ms$", "took 10ms"));
+  EXPECT_FALSE(Search("ms$", "took 10ms!"));
+  EXPECT_TRUE(Search("^$", ""));
+  EXPECT_FALSE(Search("^$", "a"));
+  EXPECT_TRUE(Search("^a|b$", "ab"));
+  EXPECT_TRUE(Search("^a|b$", "cb"));
+  EXPECT_FALSE(Search("^a|b$", "ba"));
+}
+
+TEST(Regex, SearchOperators) {
+  EXPECT_TRUE(Search("a.c", "xxabcxx"));
+  EXPECT_TRUE(Search("a.c", "a\nc"));
+  EXPECT_TRUE(Search("(foo|bar)[0-9]+", "xbar42"));
+  EXPECT_FALSE(Search("(foo|bar)[0-9]+", "xbaz42"));
+  EXPECT_TRUE(Search("^ab*c$", "ac"));
+  EXPECT_TRUE(Search("^ab*c$", "abbbc"));
+  EXPECT_FALSE(Search("^ab+c$", "ac"));
+  EXPECT_TRUE(Search("^ab?c$", "abc"));
+  EXPECT_FALSE(Search("^ab?c$", "abbc"));
+  EXPECT_TRUE(Search("^a{2,3}$", "aaa"));
+  EXPECT_FALSE(Search("^a{2,3}$", "aaaa"));
+  EXPECT_TRUE(Search("^(ab){2,}$", "ababab"));
+  EXPECT_FALSE(Search("^(ab){2,}$", "ab"));
+  EXPECT_TRUE(Search("^(a|)+$", "aa"));
+}
+
+TEST(Regex, SearchBrackets) {
+  EXPECT_TRUE(Search("[[:digit:]]+ms", "took 15ms"));
+  EXPECT_FALSE(Search("[[:digit:]]+ms", "took ms"));
+  EXPECT_TRUE(Search("^[^a-c]+$", "xyz"));
+  EXPECT_FALSE(Search("^[^a-c]+$", "xbz"));
+  EXPECT_TRUE(Search("[]a]", "]"));
+  EXPECT_TRUE(Search("[a-]", "-"));
+  EXPECT_TRUE(Search("\\w+\\s\\S", "foo_1 x"));
+  EXPECT_TRUE(Search("a\\.b", "a.b"));
+  EXPECT_FALSE(Search("a\\.b", "axb"));
+}
+
+TEST(Regex, SearchManyStates) {
+  // This pattern needs more DFA states than are kept so the DFA is rebuilt
+  // as the string is searched.
+  std::minstd_rand0 rnd(0);
+  std::string s;
+  for (uint32_t i = 0; i < 20000; ++i) {
+    s.push_back(rnd() % 2 ? 'a' : 'b');
+  }
+  EXPECT_FALSE(Search("a.{13}c", s.c_str()));
+  s[s.size() - 14] = 'a';
+  s.push_back('c');
+  EXPECT_TRUE(Search("a.{13}c", s.c_str()));
+}
+
+TEST(Regex, Malformed) {
+  EXPECT_FALSE(Regex::Create("a(").ok());
+  EXPECT_FALSE(Regex::Create("*a").ok());
+  EXPECT_FALSE(Regex::Create("[a").ok());
+  EXPECT_FALSE(Regex::Create("a{2,1}").ok());
+  EXPECT_FALSE(Regex::Create("[[:foo:]]").ok());
+}
+
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
+TEST(Regex, SearchUnsupportedByAutomaton) {
+  // Back-references and word boundaries are handled by regex.h.
+  EXPECT_TRUE(Search("(ab)\\1", "xababx"));
+  EXPECT_FALSE(Search("(ab)\\1", "xabx"));
+  EXPECT_TRUE(Search("\\bfoo\\b", "a foo b"));
+  EXPECT_FALSE(Search("\\bfoo\\b", "afoob"));
+}
+#endif
+
+TEST(Regex, CreateCached) {
+  auto a = Regex::CreateCached("fo+");
+  auto b = Regex::CreateCached("fo+");
+  ASSERT_TRUE(a.ok());
+  ASSERT_TRUE(b.ok());
+  EXPECT_EQ(a->get(), b->get());
+  EXPECT_TRUE((*a)->Search("foo"));
+  EXPECT_FALSE(Regex::CreateCached("fo(").ok());
+}
+
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
 TEST(Regex, Submatch) {
   auto regex = std::move(*Regex::Create("a(b)c(d)e"));
   std::vector<std::string_view> matches;
@@ -43,5 +150,7 @@ TEST(Regex, SubmatchOptionalGroup) {
   EXPECT_THAT(matches, testing::ElementsAre("ac", ""));
 }
 
+#endif
+
 }  // namespace
 }  // namespace perfetto::trace_processor::regex
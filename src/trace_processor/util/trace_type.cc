@@ -44,6 +44,7 @@ constexpr char kFuchsiaMagic[] = {'\x10', '\x00', '\x04', '\x46',
 constexpr char kPerfMagic[] = {'P', 'E', 'R', 'F', 'I', 'L', 'E', '2'};
 constexpr char kZipMagic[] = {'P', 'K', '\x03', '\x04'};
 constexpr char kGzipMagic[] = {'\x1f', '\x8b'};
+constexpr char kZstdMagic[] = {'\x28', '\xb5', '\x2f', '\xfd'};
 constexpr char kArtMethodStreamingMagic[] = {'S', 'L', 'O', 'W'};
 constexpr char kArtHprofStreamingMagic[] = {'J', 'A', 'V', 'A', ' ', 'P',
                                             'R', 'O', 'F', 'I', 'L', 'E'};
@@ -383,6 +384,8 @@ const char* TraceTypeToString(TraceType trace_type) {
       return "unknown";
     case kTarTraceType:
       return "tar";
+    case kZstdTraceType:
+      return "zstd";
   }
   PERFETTO_FATAL("For GCC");
 }
@@ -419,6 +422,10 @@ TraceType GuessTraceType(const uint8_t* data, size_t size) {
     return kGzipTraceType;
   }
 
+  if (MatchesMagic(data, size, kZstdMagic)) {
+    return kZstdTraceType;
+  }
+
   if (MatchesMagic(data, size, kArtMethodStreamingMagic)) {
     return kArtMethodTraceType;
   }
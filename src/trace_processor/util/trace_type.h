@@ -48,6 +48,7 @@ enum TraceType {
   kPerfTextTraceType,
   kSimpleperfProtoTraceType,
   kTarTraceType,
+  kZstdTraceType,
 };
 
 constexpr size_t kGuessTraceMaxLookahead = 128;
@@ -16,6 +16,7 @@
 
 #include "src/trace_processor/util/zip_reader.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <ctime>
@@ -33,6 +34,7 @@
 #include "perfetto/ext/base/status_or.h"
 #include "perfetto/ext/base/string_view.h"
 #include "perfetto/ext/base/utils.h"
+#include "perfetto/trace_processor/trace_blob.h"
 #include "perfetto/trace_processor/trace_blob_view.h"
 #include "src/trace_processor/util/gzip_utils.h"
 #include "src/trace_processor/util/streaming_line_reader.h"
@@ -341,10 +343,68 @@ ZipFile& ZipFile::operator=(ZipFile&& other) noexcept = default;
 base::Status ZipFile::Decompress(std::vector<uint8_t>* out_data) const {
   out_data->clear();
   RETURN_IF_ERROR(DoDecompressionChecks());
+  out_data->resize(DecompressedCapacity());
+  size_t out_size = 0;
+  RETURN_IF_ERROR(DecompressInto(out_data->data(), &out_size));
+  out_data->resize(out_size);
+  return base::OkStatus();
+}
+
+base::Status ZipFile::Decompress(TraceBlobView* out_data) const {
+  RETURN_IF_ERROR(DoDecompressionChecks());
+  TraceBlob blob = TraceBlob::Allocate(DecompressedCapacity());
+  size_t out_size = 0;
+  RETURN_IF_ERROR(DecompressInto(blob.data(), &out_size));
+  *out_data = TraceBlobView(std::move(blob), 0, out_size);
+  return base::OkStatus();
+}
+
+base::Status ZipFile::DecompressPrefix(size_t max_size,
+                                       std::vector<uint8_t>* out_data) const {
+  out_data->clear();
+  RETURN_IF_ERROR(DoDecompressionChecks());
+  out_data->resize(std::min(max_size, DecompressedCapacity()));
+  if (hdr_.compression == kNoCompression) {
+    if (!out_data->empty()) {
+      memcpy(out_data->data(), compressed_data_.data(), out_data->size());
+    }
+    return base::OkStatus();
+  }
 
+  PERFETTO_DCHECK(hdr_.compression == kDeflate);
+  GzipDecompressor dec(GzipDecompressor::InputMode::kRawDeflate);
+  dec.Feed(compressed_data_.data(), hdr_.compressed_size);
+  size_t out_size = 0;
+  while (out_size < out_data->size()) {
+    auto dec_res = dec.ExtractOutput(out_data->data() + out_size,
+                                     out_data->size() - out_size);
+    if (dec_res.ret == GzipDecompressor::ResultCode::kError ||
+        dec_res.ret == GzipDecompressor::ResultCode::kNeedsMoreInput) {
+      return base::ErrStatus("Zip decompression error (%d) on %s",
+                             static_cast<int>(dec_res.ret),
+                             hdr_.fname.c_str());
+    }
+    out_size += dec_res.bytes_written;
+    if (dec_res.ret == GzipDecompressor::ResultCode::kEof) {
+      break;
+    }
+  }
+  out_data->resize(out_size);
+  return base::OkStatus();
+}
+
+size_t ZipFile::DecompressedCapacity() const {
+  return hdr_.compression == kNoCompression ? hdr_.compressed_size
+                                            : hdr_.uncompressed_size;
+}
+
+base::Status ZipFile::DecompressInto(uint8_t* out, size_t* out_size) const {
+  *out_size = 0;
   if (hdr_.compression == kNoCompression) {
-    const uint8_t* data = compressed_data_.data();
-    out_data->insert(out_data->end(), data, data + hdr_.compressed_size);
+    if (hdr_.compressed_size > 0) {
+      memcpy(out, compressed_data_.data(), hdr_.compressed_size);
+    }
+    *out_size = hdr_.compressed_size;
     return base::OkStatus();
   }
 
@@ -356,18 +416,17 @@ base::Status ZipFile::Decompress(std::vector<uint8_t>* out_data) const {
   GzipDecompressor dec(GzipDecompressor::InputMode::kRawDeflate);
   dec.Feed(compressed_data_.data(), hdr_.compressed_size);
 
-  out_data->resize(hdr_.uncompressed_size);
-  auto dec_res = dec.ExtractOutput(out_data->data(), out_data->size());
+  auto dec_res = dec.ExtractOutput(out, hdr_.uncompressed_size);
   if (dec_res.ret != GzipDecompressor::ResultCode::kEof) {
     return base::ErrStatus("Zip decompression error (%d) on %s (c=%u, u=%u)",
                            static_cast<int>(dec_res.ret), hdr_.fname.c_str(),
                            hdr_.compressed_size, hdr_.uncompressed_size);
   }
-  out_data->resize(dec_res.bytes_written);
+  *out_size = dec_res.bytes_written;
 
 #if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
-  const auto* crc_data = reinterpret_cast<const ::Bytef*>(out_data->data());
-  auto crc_len = static_cast<::uInt>(out_data->size());
+  const auto* crc_data = reinterpret_cast<const ::Bytef*>(out);
+  auto crc_len = static_cast<::uInt>(*out_size);
   auto actual_crc32 = static_cast<uint32_t>(::crc32(0u, crc_data, crc_len));
   if (actual_crc32 != hdr_.checksum) {
     return base::ErrStatus("Zip CRC32 failure on %s (actual: %x, expected: %x)",
@@ -82,6 +82,15 @@ class ZipFile {
   // this can be called several times.
   base::Status Decompress(std::vector<uint8_t>*) const;
 
+  // Like the above, but decompresses directly into a newly allocated
+  // TraceBlob, avoiding a copy when the output is handed to a trace reader.
+  base::Status Decompress(TraceBlobView*) const;
+
+  // Decompresses only the first |max_size| bytes of the file (or the whole
+  // file, if smaller). The CRC is not checked as the output is partial.
+  base::Status DecompressPrefix(size_t max_size,
+                                std::vector<uint8_t>* out_data) const;
+
   // Streaming line-based decompression for text files.
   // It decompresses the file in chunks and passes batches of lines to the
   // caller, without decompressing the whole file into memory.
@@ -106,6 +115,11 @@ class ZipFile {
 
   base::Status DoDecompressionChecks() const;
 
+  // Decompresses the file into |out|, which must have room for at least
+  // DecompressedCapacity() bytes, and stores the output size in |out_size|.
+  size_t DecompressedCapacity() const;
+  base::Status DecompressInto(uint8_t* out, size_t* out_size) const;
+
   // Rationale for having this as a nested sub-struct:
   // 1. Makes the move operator easier to maintain.
   // 2. Allows the ZipReader to handle a copy of this struct for the file
@@ -165,6 +165,41 @@ TEST(ZipReaderTest, Find) {
 // All the tests below require zlib.
 #if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
 
+TEST(ZipReaderTest, ValidZip_DecompressIntoBlob) {
+  ZipReader zr;
+  ASSERT_OK(
+      zr.Parse(TraceBlobView(TraceBlob::CopyFrom(kTestZip, sizeof(kTestZip)))));
+  ASSERT_EQ(zr.files().size(), 2u);
+
+  TraceBlobView dec;
+  ASSERT_OK(zr.files()[0].Decompress(&dec));
+  ASSERT_EQ(std::string(reinterpret_cast<const char*>(dec.data()), dec.size()),
+            "foo\n");
+
+  ASSERT_OK(zr.files()[1].Decompress(&dec));
+  ASSERT_EQ(std::string(reinterpret_cast<const char*>(dec.data()), dec.size()),
+            "The quick brown fox jumps over the lazy dog\n"
+            "The quick brown fox jumps over the lazy frog\n");
+}
+
+TEST(ZipReaderTest, ValidZip_DecompressPrefix) {
+  ZipReader zr;
+  ASSERT_OK(
+      zr.Parse(TraceBlobView(TraceBlob::CopyFrom(kTestZip, sizeof(kTestZip)))));
+  ASSERT_EQ(zr.files().size(), 2u);
+
+  std::vector<uint8_t> dec;
+  ASSERT_OK(zr.files()[0].DecompressPrefix(2, &dec));
+  ASSERT_EQ(vec2str(dec), "fo");
+  ASSERT_OK(zr.files()[0].DecompressPrefix(100, &dec));
+  ASSERT_EQ(vec2str(dec), "foo\n");
+
+  ASSERT_OK(zr.files()[1].DecompressPrefix(9, &dec));
+  ASSERT_EQ(vec2str(dec), "The quick");
+  ASSERT_OK(zr.files()[1].DecompressPrefix(1000, &dec));
+  ASSERT_EQ(dec.size(), 89u);
+}
+
 TEST(ZipReaderTest, ValidZip_DecompressLines) {
   ZipReader zr;
   ASSERT_OK(
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/util/zstd_utils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "perfetto/base/build_config.h"
+
+#if PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+#include <zstd.h>
+#else
+struct ZSTD_DCtx_s {};
+#endif
+
+namespace perfetto::trace_processor::util {
+
+#if PERFETTO_BUILDFLAG(PERFETTO_ZSTD)  // Real Implementation
+
+ZstdDecompressor::ZstdDecompressor() : dctx_(ZSTD_createDCtx()) {}
+
+void ZstdDecompressor::Reset() {
+  ZSTD_DCtx_reset(dctx_.get(), ZSTD_reset_session_only);
+  in_ = nullptr;
+  in_size_ = 0;
+  in_pos_ = 0;
+  output_pending_ = false;
+}
+
+void ZstdDecompressor::Feed(const uint8_t* data, size_t size) {
+  in_ = data;
+  in_size_ = size;
+  in_pos_ = 0;
+}
+
+ZstdDecompressor::Result ZstdDecompressor::ExtractOutput(uint8_t* out,
+                                                         size_t out_size) {
+  if (!dctx_)
+    return Result{ResultCode::kError, 0};
+  if (in_pos_ == in_size_ && !output_pending_)
+    return Result{ResultCode::kNeedsMoreInput, 0};
+
+  ZSTD_inBuffer input{in_, in_size_, in_pos_};
+  ZSTD_outBuffer output{out, out_size, 0};
+  size_t ret = ZSTD_decompressStream(dctx_.get(), &output, &input);
+  in_pos_ = input.pos;
+  if (ZSTD_isError(ret))
+    return Result{ResultCode::kError, 0};
+
+  // ZSTD_decompressStream returns 0 only once a frame has been completely
+  // decoded and all its output flushed.
+  output_pending_ = ret != 0 && output.pos == out_size;
+  if (ret == 0)
+    return Result{ResultCode::kEof, output.pos};
+  if (output.pos == 0 && in_pos_ == in_size_)
+    return Result{ResultCode::kNeedsMoreInput, 0};
+  return Result{ResultCode::kOk, output.pos};
+}
+
+void ZstdDecompressor::Deleter::operator()(ZSTD_DCtx_s* dctx) const {
+  ZSTD_freeDCtx(dctx);
+}
+
+#else  // Dummy Implementation
+
+ZstdDecompressor::ZstdDecompressor() = default;
+void ZstdDecompressor::Reset() {}
+void ZstdDecompressor::Feed(const uint8_t*, size_t) {}
+ZstdDecompressor::Result ZstdDecompressor::ExtractOutput(uint8_t*, size_t) {
+  return Result{ResultCode::kError, 0};
+}
+void ZstdDecompressor::Deleter::operator()(ZSTD_DCtx_s*) const {}
+
+#endif  // PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+
+// static
+std::vector<uint8_t> ZstdDecompressor::DecompressFully(const uint8_t* data,
+                                                       size_t len) {
+  std::vector<uint8_t> whole_data;
+  ZstdDecompressor decompressor;
+  auto output_consumer = [&](const uint8_t* buf, size_t buf_len) {
+    whole_data.insert(whole_data.end(), buf, buf + buf_len);
+  };
+  decompressor.FeedAndExtract(data, len, output_consumer);
+  return whole_data;
+}
+
+}  // namespace perfetto::trace_processor::util
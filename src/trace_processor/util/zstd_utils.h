@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_UTIL_ZSTD_UTILS_H_
+#define SRC_TRACE_PROCESSOR_UTIL_ZSTD_UTILS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "perfetto/base/build_config.h"
+
+struct ZSTD_DCtx_s;
+
+namespace perfetto::trace_processor::util {
+
+// The first four bytes of every zstd frame (RFC8878 section 3.1.1).
+inline constexpr uint8_t kZstdMagic[] = {0x28, 0xb5, 0x2f, 0xfd};
+
+// Returns whether zstd related functionality is supported with the current
+// build flags.
+constexpr bool IsZstdSupported() {
+#if PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Returns whether |data| starts with a zstd frame.
+inline bool IsZstdFrame(const uint8_t* data, size_t size) {
+  return size >= sizeof(kZstdMagic) &&
+         memcmp(data, kZstdMagic, sizeof(kZstdMagic)) == 0;
+}
+
+// Streaming zstd decompressor. The interface and the semantics of the result
+// codes are the same as GzipDecompressor: see the comments there.
+//
+// The input can contain any number of concatenated frames (including
+// skippable frames): kEof is returned at the end of each frame and, if
+// AvailIn() > 0, ExtractOutput can be called again to decompress the next
+// one without calling Reset().
+class ZstdDecompressor {
+ public:
+  enum class ResultCode {
+    kOk,
+    kEof,
+    kError,
+    kNeedsMoreInput,
+  };
+  struct Result {
+    // The return code of the decompression.
+    ResultCode ret;
+
+    // The amount of bytes written to output.
+    // Valid in all cases except |ResultCode::kError|.
+    size_t bytes_written;
+  };
+
+  ZstdDecompressor();
+
+  // Feed the next mem-block. The previous one must have been fully consumed.
+  void Feed(const uint8_t* data, size_t size);
+
+  // Feed the next mem-block and extract output in the callback consumer.
+  //
+  // Note the output of this function is guaranteed *not* to be kOk.
+  template <typename Callback = void(const uint8_t* ptr, size_t size)>
+  ResultCode FeedAndExtract(const uint8_t* data,
+                            size_t size,
+                            const Callback& output_consumer) {
+    Feed(data, size);
+    uint8_t buffer[4096];
+    Result result;
+    do {
+      result = ExtractOutput(buffer, sizeof(buffer));
+      if (result.ret != ResultCode::kError && result.bytes_written > 0) {
+        output_consumer(buffer, result.bytes_written);
+      }
+    } while (result.ret == ResultCode::kOk ||
+             (result.ret == ResultCode::kEof && AvailIn() > 0));
+    return result.ret;
+  }
+
+  // Extract the newly available partial output. On each 'Feed', this method
+  // should be called repeatedly until there is no more data to output
+  // i.e. (either 'kEof' or 'kNeedsMoreInput').
+  Result ExtractOutput(uint8_t* out, size_t out_capacity);
+
+  // Discards the state of the current frame and any unconsumed input.
+  void Reset();
+
+  // Decompress the entire mem-block and return decompressed mem-block.
+  static std::vector<uint8_t> DecompressFully(const uint8_t* data, size_t len);
+
+  // Returns the amount of input bytes left unprocessed.
+  size_t AvailIn() const { return in_size_ - in_pos_; }
+
+ private:
+  struct Deleter {
+    void operator()(ZSTD_DCtx_s*) const;
+  };
+  std::unique_ptr<ZSTD_DCtx_s, Deleter> dctx_;
+
+  const uint8_t* in_ = nullptr;
+  size_t in_size_ = 0;
+  size_t in_pos_ = 0;
+
+  // Set when the last ExtractOutput filled the output buffer: the
+  // decompressor might hold more output even if all the input was consumed.
+  bool output_pending_ = false;
+};
+
+}  // namespace perfetto::trace_processor::util
+
+#endif  // SRC_TRACE_PROCESSOR_UTIL_ZSTD_UTILS_H_
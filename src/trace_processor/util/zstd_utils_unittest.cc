@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/util/zstd_utils.h"
+
+#include <zstd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor::util {
+namespace {
+
+std::string ZstdCompress(const std::string& input) {
+  std::string output(ZSTD_compressBound(input.size()), '\0');
+  size_t size = ZSTD_compress(output.data(), output.size(), input.data(),
+                              input.size(), /*compressionLevel=*/3);
+  PERFETTO_CHECK(!ZSTD_isError(size));
+  output.resize(size);
+  return output;
+}
+
+std::string MakeInput(size_t size) {
+  std::string input;
+  for (size_t i = 0; input.size() < size; ++i) {
+    input += "Packet number " + std::to_string(i) + "\n";
+  }
+  input.resize(size);
+  return input;
+}
+
+// Feeds |input| to the decompressor in chunks of |chunk_size| bytes and
+// extracts the output into buffers of |out_size| bytes.
+std::string StreamingDecompress(const std::string& input,
+                                size_t chunk_size,
+                                size_t out_size,
+                                ZstdDecompressor::ResultCode* last_ret) {
+  ZstdDecompressor decompressor;
+  std::vector<uint8_t> out(out_size);
+  std::string output;
+  *last_ret = ZstdDecompressor::ResultCode::kNeedsMoreInput;
+  for (size_t off = 0; off < input.size(); off += chunk_size) {
+    size_t len = std::min(chunk_size, input.size() - off);
+    decompressor.Feed(reinterpret_cast<const uint8_t*>(input.data()) + off,
+                      len);
+    for (;;) {
+      auto res = decompressor.ExtractOutput(out.data(), out.size());
+      *last_ret = res.ret;
+      if (res.ret == ZstdDecompressor::ResultCode::kError)
+        return output;
+      output.append(reinterpret_cast<const char*>(out.data()),
+                    res.bytes_written);
+      if (res.ret == ZstdDecompressor::ResultCode::kNeedsMoreInput)
+        break;
+      if (res.ret == ZstdDecompressor::ResultCode::kEof &&
+          decompressor.AvailIn() == 0) {
+        break;
+      }
+    }
+  }
+  return output;
+}
+
+TEST(ZstdDecompressor, Magic) {
+  std::string compressed = ZstdCompress("abc");
+  ASSERT_TRUE(IsZstdFrame(reinterpret_cast<const uint8_t*>(compressed.data()),
+                          compressed.size()));
+  ASSERT_FALSE(IsZstdFrame(reinterpret_cast<const uint8_t*>("abcd"), 4));
+  ASSERT_FALSE(IsZstdFrame(kZstdMagic, 3));
+}
+
+TEST(ZstdDecompressor, Fully) {
+  std::string input = MakeInput(100000);
+  std::string compressed = ZstdCompress(input);
+  std::vector<uint8_t> output = ZstdDecompressor::DecompressFully(
+      reinterpret_cast<const uint8_t*>(compressed.data()), compressed.size());
+  ASSERT_EQ(std::string(output.begin(), output.end()), input);
+}
+
+TEST(ZstdDecompressor, Streaming) {
+  std::string input = MakeInput(1000000);
+  std::string compressed = ZstdCompress(input);
+  for (size_t chunk_size : {1ul, 7ul, 4096ul, compressed.size()}) {
+    for (size_t out_size : {1ul, 1000ul, 2000000ul}) {
+      if (chunk_size == 1 && out_size == 1)
+        continue;
+      ZstdDecompressor::ResultCode ret;
+      std::string output =
+          StreamingDecompress(compressed, chunk_size, out_size, &ret);
+      ASSERT_EQ(ret, ZstdDecompressor::ResultCode::kEof);
+      ASSERT_EQ(output, input);
+    }
+  }
+}
+
+TEST(ZstdDecompressor, MultipleFrames) {
+  std::string a = MakeInput(5000);
+  std::string b = MakeInput(3000);
+  std::string compressed = ZstdCompress(a) + ZstdCompress(b);
+
+  std::vector<uint8_t> output = ZstdDecompressor::DecompressFully(
+      reinterpret_cast<const uint8_t*>(compressed.data()), compressed.size());
+  ASSERT_EQ(std::string(output.begin(), output.end()), a + b);
+
+  ZstdDecompressor::ResultCode ret;
+  ASSERT_EQ(StreamingDecompress(compressed, 100, 512, &ret), a + b);
+  ASSERT_EQ(ret, ZstdDecompressor::ResultCode::kEof);
+}
+
+TEST(ZstdDecompressor, Truncated) {
+  std::string compressed = ZstdCompress(MakeInput(5000));
+  compressed.resize(compressed.size() / 2);
+  ZstdDecompressor::ResultCode ret;
+  StreamingDecompress(compressed, 100, 512, &ret);
+  ASSERT_EQ(ret, ZstdDecompressor::ResultCode::kNeedsMoreInput);
+}
+
+TEST(ZstdDecompressor, Corrupt) {
+  std::string compressed = ZstdCompress(MakeInput(5000));
+  // Set the reserved bit of the frame header descriptor.
+  compressed[4] = static_cast<char>(compressed[4] | 0x08);
+  ZstdDecompressor::ResultCode ret;
+  StreamingDecompress(compressed, compressed.size(), 512, &ret);
+  ASSERT_EQ(ret, ZstdDecompressor::ResultCode::kError);
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor::util
@@ -16,6 +16,7 @@
 
 #include <stdio.h>
 #include <algorithm>
+#include <optional>
 
 #include "perfetto/base/status.h"
 #include "perfetto/ext/base/android_utils.h"
@@ -41,6 +42,10 @@
 #include "src/tracing/service/zlib_compressor.h"
 #endif
 
+#if PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+#include "src/tracing/service/zstd_compressor.h"
+#endif
+
 namespace perfetto {
 namespace {
 void PrintUsage(const char* prog_name) {
@@ -59,6 +64,12 @@ Options and arguments
     --enable-relay-endpoint : enables the relay endpoint on producer socket(s)
         for traced_relay to communicate with traced in a multiple-machine
         tracing session.
+    --filter-threads <N> : uses N worker threads, in addition to the service
+        thread, to apply the TraceConfig.trace_filter to the packets read back
+        from the trace buffers. Defaults to 0 (no worker threads).
+    --async-file-writes : writes the trace file of write_into_file sessions
+        from a dedicated thread per session, so that slow storage doesn't
+        stall the service.
 
 Example:
     %s --set-socket-permissions traced-producer:0660:traced-consumer:0660
@@ -75,11 +86,15 @@ int PERFETTO_EXPORT_ENTRYPOINT ServiceMain(int argc, char** argv) {
     OPT_VERSION = 1000,
     OPT_SET_SOCKET_PERMISSIONS = 1001,
     OPT_BACKGROUND,
-    OPT_ENABLE_RELAY_ENDPOINT
+    OPT_ENABLE_RELAY_ENDPOINT,
+    OPT_FILTER_THREADS,
+    OPT_ASYNC_FILE_WRITES,
   };
 
   bool background = false;
   bool enable_relay_endpoint = false;
+  uint32_t filter_thread_count = 0;
+  bool async_file_writes = false;
 
   static const option long_options[] = {
       {"background", no_argument, nullptr, OPT_BACKGROUND},
@@ -88,6 +103,8 @@ int PERFETTO_EXPORT_ENTRYPOINT ServiceMain(int argc, char** argv) {
        OPT_SET_SOCKET_PERMISSIONS},
       {"enable-relay-endpoint", no_argument, nullptr,
        OPT_ENABLE_RELAY_ENDPOINT},
+      {"filter-threads", required_argument, nullptr, OPT_FILTER_THREADS},
+      {"async-file-writes", no_argument, nullptr, OPT_ASYNC_FILE_WRITES},
       {nullptr, 0, nullptr, 0}};
 
   std::string producer_socket_group, consumer_socket_group,
@@ -120,6 +137,18 @@ int PERFETTO_EXPORT_ENTRYPOINT ServiceMain(int argc, char** argv) {
       case OPT_ENABLE_RELAY_ENDPOINT:
         enable_relay_endpoint = true;
         break;
+      case OPT_FILTER_THREADS: {
+        std::optional<uint32_t> count = base::CStringToUInt32(optarg);
+        if (!count) {
+          PrintUsage(argv[0]);
+          return 1;
+        }
+        filter_thread_count = *count;
+        break;
+      }
+      case OPT_ASYNC_FILE_WRITES:
+        async_file_writes = true;
+        break;
       default:
         PrintUsage(argv[0]);
         return 1;
@@ -135,6 +164,9 @@ int PERFETTO_EXPORT_ENTRYPOINT ServiceMain(int argc, char** argv) {
   TracingService::InitOpts init_opts = {};
 #if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
   init_opts.compressor_fn = &ZlibCompressFn;
+#endif
+#if PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+  init_opts.zstd_compressor_fn = &ZstdCompressFn;
 #endif
   std::string relay_producer_socket;
 #if PERFETTO_BUILDFLAG(PERFETTO_OS_ANDROID)
@@ -147,6 +179,8 @@ int PERFETTO_EXPORT_ENTRYPOINT ServiceMain(int argc, char** argv) {
 #endif
   if (enable_relay_endpoint)
     init_opts.enable_relay_endpoint = true;
+  init_opts.filter_thread_count = filter_thread_count;
+  init_opts.async_write_into_file = async_file_writes;
   svc = ServiceIPCHost::CreateInstance(&task_runner, init_opts);
 
   // When built as part of the Android tree, the two socket are created and
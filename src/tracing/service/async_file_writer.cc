@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/tracing/service/async_file_writer.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/base/time.h"
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/waitable_event.h"
+#include "perfetto/ext/tracing/core/trace_packet.h"
+
+namespace perfetto {
+
+AsyncFileWriter::AsyncFileWriter(int fd)
+    : fd_(fd),
+      thread_(base::ThreadTaskRunner::CreateAndStart("TraceFileWriter")) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < kNumBuffers; ++i)
+    free_buffers_.push_back(i);
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+  Drain();
+}
+
+bool AsyncFileWriter::has_free_buffer() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return !free_buffers_.empty();
+}
+
+bool AsyncFileWriter::Write(std::vector<TracePacket>* packets,
+                            size_t num_packets) {
+  PERFETTO_DCHECK(num_packets <= packets->size());
+  size_t buffer_idx;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (failed_)
+      return false;
+    if (free_buffers_.empty()) {
+      auto start = base::GetWallTimeNs();
+      buffer_freed_.wait(lock, [this]() PERFETTO_EXCLUSIVE_LOCKS_REQUIRED(
+                                   mutex_) { return !free_buffers_.empty(); });
+      ++stats_.stalls;
+      stats_.stall_time_ns +=
+          static_cast<uint64_t>((base::GetWallTimeNs() - start).count());
+    }
+    buffer_idx = free_buffers_.back();
+    free_buffers_.pop_back();
+  }
+
+  // Only the service thread touches a buffer which is not queued.
+  std::vector<uint8_t>& buffer = buffers_[buffer_idx];
+  size_t size = 0;
+  for (size_t i = 0; i < num_packets; ++i)
+    size += TracePacket::kMaxPreambleBytes + (*packets)[i].size();
+  buffer.resize(size);
+  uint8_t* wptr = buffer.data();
+  for (size_t i = 0; i < num_packets; ++i) {
+    TracePacket& packet = (*packets)[i];
+    auto [preamble, preamble_size] = packet.GetProtoPreamble();
+    memcpy(wptr, preamble, preamble_size);
+    wptr += preamble_size;
+    for (const Slice& slice : packet.slices()) {
+      memcpy(wptr, slice.start, slice.size);
+      wptr += slice.size;
+    }
+  }
+  buffer.resize(static_cast<size_t>(wptr - buffer.data()));
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_bytes_ += buffer.size();
+    stats_.max_pending_bytes =
+        std::max(stats_.max_pending_bytes, pending_bytes_);
+  }
+  thread_.PostTask([this, buffer_idx] { WriteBuffer(buffer_idx); });
+  return true;
+}
+
+void AsyncFileWriter::WriteBuffer(size_t buffer_idx) {
+  std::vector<uint8_t>& buffer = buffers_[buffer_idx];
+  ssize_t wr_size = base::WriteAll(fd_, buffer.data(), buffer.size());
+  bool ok = wr_size == static_cast<ssize_t>(buffer.size());
+  if (!ok)
+    PERFETTO_PLOG("write() failed");
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_bytes_ -= buffer.size();
+  if (ok) {
+    stats_.bytes_written += buffer.size();
+    ++stats_.batches_written;
+  } else {
+    ++stats_.write_errors;
+    failed_ = true;
+  }
+  free_buffers_.push_back(buffer_idx);
+  buffer_freed_.notify_one();
+}
+
+void AsyncFileWriter::Sync() {
+  thread_.PostTask([this] { base::FlushFile(fd_); });
+}
+
+bool AsyncFileWriter::Drain() {
+  base::WaitableEvent drained;
+  thread_.PostTask([&drained] { drained.Notify(); });
+  drained.Wait();
+  std::lock_guard<std::mutex> lock(mutex_);
+  return !failed_;
+}
+
+AsyncFileWriter::Stats AsyncFileWriter::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+}  // namespace perfetto
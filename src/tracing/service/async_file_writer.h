@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACING_SERVICE_ASYNC_FILE_WRITER_H_
+#define SRC_TRACING_SERVICE_ASYNC_FILE_WRITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "perfetto/base/thread_annotations.h"
+#include "perfetto/ext/base/thread_task_runner.h"
+
+namespace perfetto {
+
+class TracePacket;
+
+// Appends the packets of a write_into_file session to its file from a
+// dedicated thread, so that slow storage doesn't stall the service thread (and
+// with it the producers' commits and flushes).
+// The packets read from the trace buffers point into them, so they are copied
+// into one of two staging buffers: the service thread fills one while the
+// writer thread writes the other out. Write() blocks if both are in flight.
+class AsyncFileWriter {
+ public:
+  struct Stats {
+    uint64_t bytes_written = 0;
+    uint64_t batches_written = 0;
+    uint64_t write_errors = 0;
+    // Max number of bytes queued and not yet written out.
+    uint64_t max_pending_bytes = 0;
+    // Number of times, and total time, Write() had to wait for a staging
+    // buffer to be written out.
+    uint64_t stalls = 0;
+    uint64_t stall_time_ns = 0;
+  };
+
+  // |fd| must outlive this object.
+  explicit AsyncFileWriter(int fd);
+
+  // Waits for the queued writes to complete.
+  ~AsyncFileWriter();
+
+  AsyncFileWriter(const AsyncFileWriter&) = delete;
+  AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+  // Whether the next Write() will not block.
+  bool has_free_buffer() const;
+
+  // Copies the first |num_packets| of |packets|, each preceded by its proto
+  // preamble, and queues them to be appended to the file. Returns false,
+  // without queueing anything, if a previous write has failed.
+  bool Write(std::vector<TracePacket>* packets, size_t num_packets);
+
+  // Queues a base::FlushFile() after the writes queued so far.
+  void Sync();
+
+  // Blocks until the queued writes and syncs have completed. Returns false if
+  // any write has failed.
+  bool Drain();
+
+  Stats stats() const;
+
+ private:
+  static constexpr size_t kNumBuffers = 2;
+
+  void WriteBuffer(size_t buffer_idx);
+
+  const int fd_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable buffer_freed_;
+  std::array<std::vector<uint8_t>, kNumBuffers> buffers_;
+  std::vector<size_t> free_buffers_ PERFETTO_GUARDED_BY(mutex_);
+  uint64_t pending_bytes_ PERFETTO_GUARDED_BY(mutex_) = 0;
+  bool failed_ PERFETTO_GUARDED_BY(mutex_) = false;
+  Stats stats_ PERFETTO_GUARDED_BY(mutex_);
+
+  // Keep last: it must be destroyed (and its thread joined) first.
+  base::ThreadTaskRunner thread_;
+};
+
+}  // namespace perfetto
+
+#endif  // SRC_TRACING_SERVICE_ASYNC_FILE_WRITER_H_
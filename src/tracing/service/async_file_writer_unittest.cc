@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/tracing/service/async_file_writer.h"
+
+#include <fcntl.h>
+
+#include <string>
+#include <vector>
+
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/temp_file.h"
+#include "perfetto/ext/tracing/core/slice.h"
+#include "perfetto/ext/tracing/core/trace_packet.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto {
+namespace {
+
+// Returns |num_packets| packets with two slices each, and appends to
+// |expected| the bytes they should be written as.
+std::vector<TracePacket> MakePackets(size_t num_packets,
+                                     std::string* expected) {
+  std::vector<TracePacket> packets(num_packets);
+  for (size_t i = 0; i < num_packets; ++i) {
+    for (size_t s = 0; s < 2; ++s) {
+      std::string payload(100 * i + s + 1, static_cast<char>('a' + i % 26));
+      Slice slice = Slice::Allocate(payload.size());
+      memcpy(slice.own_data(), payload.data(), payload.size());
+      packets[i].AddSlice(std::move(slice));
+    }
+  }
+  for (TracePacket& packet : packets) {
+    auto [preamble, preamble_size] = packet.GetProtoPreamble();
+    expected->append(preamble, preamble_size);
+    expected->append(packet.GetRawBytesForTesting());
+  }
+  return packets;
+}
+
+TEST(AsyncFileWriterTest, WritesInOrder) {
+  base::TempFile file = base::TempFile::Create();
+  std::string expected;
+  AsyncFileWriter writer(file.fd());
+  for (size_t batch = 0; batch < 10; ++batch) {
+    std::vector<TracePacket> packets = MakePackets(batch * 3, &expected);
+    ASSERT_TRUE(writer.Write(&packets, packets.size()));
+    writer.Sync();
+  }
+  ASSERT_TRUE(writer.Drain());
+
+  std::string contents;
+  ASSERT_TRUE(base::ReadFile(file.path(), &contents));
+  EXPECT_EQ(contents, expected);
+
+  AsyncFileWriter::Stats stats = writer.stats();
+  EXPECT_EQ(stats.bytes_written, expected.size());
+  EXPECT_EQ(stats.batches_written, 10u);
+  EXPECT_EQ(stats.write_errors, 0u);
+  EXPECT_GT(stats.max_pending_bytes, 0u);
+  EXPECT_TRUE(writer.has_free_buffer());
+}
+
+TEST(AsyncFileWriterTest, WritesOnlyTheFirstPackets) {
+  base::TempFile file = base::TempFile::Create();
+  std::string expected;
+  std::vector<TracePacket> packets = MakePackets(2, &expected);
+  std::string unexpected;
+  std::vector<TracePacket> more_packets = MakePackets(3, &unexpected);
+  for (TracePacket& packet : more_packets)
+    packets.emplace_back(std::move(packet));
+  {
+    AsyncFileWriter writer(file.fd());
+    ASSERT_TRUE(writer.Write(&packets, 2));
+  }  // The destructor waits for the write.
+
+  std::string contents;
+  ASSERT_TRUE(base::ReadFile(file.path(), &contents));
+  EXPECT_EQ(contents, expected);
+}
+
+TEST(AsyncFileWriterTest, WriteFailure) {
+  base::TempFile file = base::TempFile::Create();
+  base::ScopedFile read_only_fd = base::OpenFile(file.path(), O_RDONLY);
+  ASSERT_TRUE(read_only_fd);
+  AsyncFileWriter writer(*read_only_fd);
+  std::string expected;
+  std::vector<TracePacket> packets = MakePackets(3, &expected);
+  ASSERT_TRUE(writer.Write(&packets, packets.size()));
+  EXPECT_FALSE(writer.Drain());
+  EXPECT_FALSE(writer.Write(&packets, packets.size()));
+  EXPECT_EQ(writer.stats().write_errors, 1u);
+}
+
+}  // namespace
+}  // namespace perfetto
@@ -0,0 +1,113 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "perfetto/base/build_config.h"
+#include "perfetto/base/logging.h"
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/tracing/core/trace_packet.h"
+#include "perfetto/protozero/proto_decoder.h"
+#include "src/base/test/utils.h"
+
+#if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
+#include "src/tracing/service/zlib_compressor.h"
+#endif
+
+#if PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+#include "src/tracing/service/zstd_compressor.h"
+#endif
+
+namespace perfetto {
+namespace {
+
+const std::string& GetTestTrace() {
+  static const std::string* trace = [] {
+    auto* data = new std::string();
+    static const char kTestTrace[] = "test/data/example_android_trace_30s.pb";
+    base::ReadFile(base::GetTestDataPath(kTestTrace), data);
+    PERFETTO_CHECK(!data->empty());
+    return data;
+  }();
+  return *trace;
+}
+
+// Splits the trace into packets which point into |trace| without copying, the
+// same way TraceBuffer hands them over to TracingServiceImpl::ReadBuffers.
+std::vector<TracePacket> SplitIntoPackets(const std::string& trace) {
+  std::vector<TracePacket> packets;
+  protozero::ProtoDecoder decoder(trace.data(), trace.size());
+  for (auto field = decoder.ReadField(); field.valid();
+       field = decoder.ReadField()) {
+    PERFETTO_CHECK(field.id() == TracePacket::kPacketFieldNumber);
+    TracePacket packet;
+    packet.AddSlice(field.data(), field.size());
+    packets.emplace_back(std::move(packet));
+  }
+  return packets;
+}
+
+size_t TotalSize(const std::vector<TracePacket>& packets) {
+  size_t size = 0;
+  for (const TracePacket& packet : packets) {
+    size += packet.size();
+  }
+  return size;
+}
+
+template <typename CompressFn>
+void BenchmarkCompressor(benchmark::State& state, CompressFn compress_fn) {
+  const std::string& trace = GetTestTrace();
+  size_t uncompressed_size = 0;
+  size_t compressed_size = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::vector<TracePacket> packets = SplitIntoPackets(trace);
+    uncompressed_size = TotalSize(packets);
+    state.ResumeTiming();
+
+    compress_fn(&packets);
+    benchmark::DoNotOptimize(packets);
+    benchmark::ClobberMemory();
+
+    compressed_size = TotalSize(packets);
+  }
+  state.SetBytesProcessed(
+      static_cast<int64_t>(state.iterations() * uncompressed_size));
+  state.counters["ratio"] = benchmark::Counter(
+      static_cast<double>(uncompressed_size) /
+      static_cast<double>(compressed_size));
+}
+
+#if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
+void BM_TracingServiceCompressZlib(benchmark::State& state) {
+  BenchmarkCompressor(state, &ZlibCompressFn);
+}
+BENCHMARK(BM_TracingServiceCompressZlib)->Unit(benchmark::kMillisecond);
+#endif
+
+#if PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+void BM_TracingServiceCompressZstd(benchmark::State& state) {
+  BenchmarkCompressor(state, &ZstdCompressFn);
+}
+BENCHMARK(BM_TracingServiceCompressZstd)->Unit(benchmark::kMillisecond);
+#endif
+
+}  // namespace
+}  // namespace perfetto
@@ -230,6 +230,54 @@ static void BM_TraceBuffer_RD(benchmark::State& state) {
   state.SetBytesProcessed(static_cast<int64_t>(total_bytes_read));
 }
 
+// Benchmark 3: Clone latency (as in CLONE_SNAPSHOT) of a full buffer, with
+// state.range(0) bytes written into it between clones.
+template <typename BufferType>
+static void BM_TraceBuffer_Clone(benchmark::State& state) {
+  constexpr size_t kBufferSize = 128 * 1024 * 1024;
+  const size_t bytes_between_clones = static_cast<size_t>(state.range(0));
+  auto chunk_templates = GenerateChunkTemplates(100);
+
+  auto buffer = BufferType::Create(kBufferSize);
+  PERFETTO_CHECK(buffer);
+  ClientIdentity client_identity(1000, 100);
+  ChunkID chunk_id = 0;
+  size_t template_idx = 0;
+  auto write_chunks = [&](size_t size) {
+    for (size_t bytes_written = 0; bytes_written < size;) {
+      const auto& tmpl = chunk_templates[template_idx % chunk_templates.size()];
+      ++template_idx;
+      buffer->CopyChunkUntrusted(ProducerID(1), client_identity, WriterID(1),
+                                 chunk_id++, tmpl.num_fragments, tmpl.flags,
+                                 /*chunk_complete=*/true, tmpl.data.data(),
+                                 tmpl.data.size());
+      bytes_written += kChunkSize;
+    }
+  };
+  write_chunks(kBufferSize);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    write_chunks(bytes_between_clones);
+    state.ResumeTiming();
+
+    std::unique_ptr<TraceBuffer> clone = buffer->CloneReadOnly();
+    PERFETTO_CHECK(clone);
+    benchmark::DoNotOptimize(clone);
+
+    // Destroying the clone (and unmapping its memory) is not part of the
+    // clone latency.
+    state.PauseTiming();
+    clone.reset();
+    state.ResumeTiming();
+  }
+}
+
+static void CloneArgs(benchmark::internal::Benchmark* b) {
+  BmArgs(b);
+  b->Arg(1024 * 1024)->Arg(16 * 1024 * 1024)->Unit(benchmark::kMillisecond);
+}
+
 // Instantiate benchmarks for both V1 and V2
 
 // Write benchmarks - Single writer
@@ -248,5 +296,9 @@ BENCHMARK_TEMPLATE(BM_TraceBuffer_WR_MultipleWriters, TraceBufferV2)
 BENCHMARK_TEMPLATE(BM_TraceBuffer_RD, TraceBufferV1)->Apply(BmArgs);
 BENCHMARK_TEMPLATE(BM_TraceBuffer_RD, TraceBufferV2)->Apply(BmArgs);
 
+// Clone benchmarks
+BENCHMARK_TEMPLATE(BM_TraceBuffer_Clone, TraceBufferV1)->Apply(CloneArgs);
+BENCHMARK_TEMPLATE(BM_TraceBuffer_Clone, TraceBufferV2)->Apply(CloneArgs);
+
 }  // namespace
 }  // namespace perfetto
@@ -70,7 +70,8 @@ bool TraceBufferV1::Initialize(size_t size) {
   auto max_size = std::numeric_limits<decltype(ChunkMeta::record_off)>::max();
   PERFETTO_CHECK(size <= static_cast<size_t>(max_size));
   data_ = base::PagedMemory::Allocate(
-      size, base::PagedMemory::kMayFail | base::PagedMemory::kDontCommit);
+      size, base::PagedMemory::kMayFail | base::PagedMemory::kDontCommit |
+                base::PagedMemory::kCopyOnWriteClones);
   if (!data_.IsValid()) {
     PERFETTO_ELOG("Trace buffer allocation failed (size: %zu)", size);
     return false;
@@ -914,13 +915,15 @@ TraceBufferV1::TraceBufferV1(CloneCtor, const TraceBufferV1& src)
     : overwrite_policy_(src.overwrite_policy_),
       read_only_(true),
       discard_writes_(src.discard_writes_) {
-  if (!Initialize(src.data_.size()))
+  // Shares the pages with |src| copy-on-write where supported, see
+  // PagedMemory::Clone().
+  data_ = src.data_.Clone(src.used_size_);
+  if (!data_.IsValid())
     return;  // TraceBuffer::Clone() will check |data_| and return nullptr.
-
-  // The assignments below must be done after Initialize().
-
-  EnsureCommitted(src.used_size_);
-  memcpy(data_.Get(), src.data_.Get(), src.used_size_);
+  size_ = src.size_;
+  used_size_ = src.used_size_;
+  max_chunk_size_ = src.max_chunk_size_;
+  wptr_ = begin();
   last_chunk_id_written_ = src.last_chunk_id_written_;
 
   stats_ = src.stats_;
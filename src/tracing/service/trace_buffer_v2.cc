@@ -559,7 +559,8 @@ bool TraceBufferV2::Initialize(size_t size) {
   // the TBChunk linked list) to reduce memory overhead.
   PERFETTO_CHECK(size <= UINT32_MAX);
   data_ = base::PagedMemory::Allocate(
-      size, base::PagedMemory::kMayFail | base::PagedMemory::kDontCommit);
+      size, base::PagedMemory::kMayFail | base::PagedMemory::kDontCommit |
+                base::PagedMemory::kCopyOnWriteClones);
   if (!data_.IsValid()) {
     PERFETTO_ELOG("Trace buffer allocation failed (size: %zu)", size);
     return false;
@@ -1089,13 +1090,12 @@ TraceBufferV2::TraceBufferV2(CloneCtor, const TraceBufferV2& src)
       read_generation_(src.read_generation_),
       read_only_(true),
       discard_writes_(src.discard_writes_) {
-  if (!Initialize(src.data_.size()))
+  // Shares the pages with |src| copy-on-write where supported, see
+  // PagedMemory::Clone().
+  data_ = src.data_.Clone(src.used_size_);
+  if (!data_.IsValid())
     return;  // TraceBufferV2::Clone() will check |data_| and return nullptr.
-
-  // The assignments below must be done after Initialize().
-
-  data_.EnsureCommitted(src.used_size_);
-  memcpy(data_.Get(), src.data_.Get(), src.used_size_);
+  size_ = src.size_;
   used_size_ = src.used_size_;
   wr_ = src.wr_;
 
@@ -18,6 +18,7 @@
 
 #include <fcntl.h>
 #include <limits.h>
+#include <stdio.h>
 #include <string.h>
 #include <algorithm>
 #include <array>
@@ -77,10 +78,12 @@
 #include "perfetto/ext/base/scoped_sched_boost.h"
 #include "perfetto/ext/base/string_utils.h"  // IWYU pragma: keep
 #include "perfetto/ext/base/sys_types.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/ext/base/thread_checker.h"
 #include "perfetto/ext/base/utils.h"
 #include "perfetto/ext/base/uuid.h"
 #include "perfetto/ext/base/version.h"
+#include "perfetto/ext/base/waitable_event.h"
 #include "perfetto/ext/base/watchdog.h"
 #include "perfetto/ext/tracing/core/basic_types.h"
 #include "perfetto/ext/tracing/core/client_identity.h"
@@ -104,6 +107,7 @@
 #include "src/protozero/filtering/message_filter.h"
 #include "src/protozero/filtering/string_filter.h"
 #include "src/tracing/core/shared_memory_arbiter_impl.h"
+#include "src/tracing/service/async_file_writer.h"
 #include "src/tracing/service/clock.h"
 #include "src/tracing/service/dependencies.h"
 #include "src/tracing/service/packet_stream_validator.h"
@@ -269,6 +273,23 @@ bool NameMatchesFilter(const std::string& name,
   return filter_matches || filter_regex_matches;
 }
 
+// Used when TraceConfig.file_rotation is set.
+std::string RotatedTraceFilePath(const std::string& output_path,
+                                 uint32_t index) {
+  return output_path + "." + std::to_string(index);
+}
+
+// Waits for the writes queued on |file_writer| to complete. Logs if any of
+// them failed: once the writer is destroyed nothing else reports it.
+void DrainFileWriter(AsyncFileWriter* file_writer) {
+  if (file_writer->Drain())
+    return;
+  AsyncFileWriter::Stats stats = file_writer->stats();
+  PERFETTO_ELOG("Writing into the trace file failed (%" PRIu64
+                " errors, %" PRIu64 " bytes written)",
+                stats.write_errors, stats.bytes_written);
+}
+
 // Used when TraceConfig.write_into_file == true and output_path is not empty.
 base::ScopedFile CreateTraceFile(const std::string& path, bool overwrite) {
 #if PERFETTO_BUILDFLAG(PERFETTO_OS_ANDROID) && \
@@ -336,6 +357,72 @@ void AppendOwnedSlicesToPacket(std::unique_ptr<uint8_t[]> data,
   }
 }
 
+// Below this many packets per batch, handing the work to the filter threads
+// costs more than it saves.
+constexpr size_t kMinPacketsPerFilterBatch = 32;
+
+// Filter stats accumulated by FilterPacketBatch(). Each batch has its own copy
+// so that the worker threads don't touch the TracingSession.
+struct FilterBatchStats {
+  uint64_t input_packets = 0;
+  uint64_t input_bytes = 0;
+  uint64_t output_bytes = 0;
+  uint64_t errors = 0;
+  std::vector<uint64_t> bytes_discarded_per_buffer;
+};
+
+// Runs |filter| over the packets in [begin, end) and replaces each of them
+// in-place with the filter result.
+// This maintains the cardinality of input packets. Even if an entire packet is
+// filtered out, we emit a zero-sized TracePacket proto. That makes debugging
+// and reasoning about the trace stats easier.
+void FilterPacketBatch(protozero::MessageFilter* filter,
+                       TracePacket* begin,
+                       TracePacket* end,
+                       FilterBatchStats* stats) {
+  std::vector<protozero::MessageFilter::InputSlice> filter_input;
+  for (TracePacket* packet = begin; packet != end; ++packet) {
+    const auto& packet_slices = packet->slices();
+    const size_t input_packet_size = packet->size();
+    filter_input.clear();
+    filter_input.resize(packet_slices.size());
+    ++stats->input_packets;
+    stats->input_bytes += input_packet_size;
+    for (size_t i = 0; i < packet_slices.size(); ++i)
+      filter_input[i] = {packet_slices[i].start, packet_slices[i].size};
+    auto filtered_packet =
+        filter->FilterMessageFragments(&filter_input[0], filter_input.size());
+
+    // Replace the packet in-place with the filtered one (unless failed).
+    std::optional<uint32_t> maybe_buffer_idx = packet->buffer_index_for_stats();
+    *packet = TracePacket();
+    if (filtered_packet.error) {
+      ++stats->errors;
+      PERFETTO_DLOG("Trace packet filtering failed @ batch packet %" PRIu64,
+                    stats->input_packets);
+      continue;
+    }
+    stats->output_bytes += filtered_packet.size;
+    if (maybe_buffer_idx.has_value()) {
+      // Keep the per-buffer stats updated. Also propagate the
+      // buffer_index_for_stats in the output packet to allow accounting by
+      // other parts of the ReadBuffer pipeline.
+      uint32_t buffer_idx = maybe_buffer_idx.value();
+      packet->set_buffer_index_for_stats(buffer_idx);
+      auto& vec = stats->bytes_discarded_per_buffer;
+      if (static_cast<size_t>(buffer_idx) >= vec.size())
+        vec.resize(buffer_idx + 1);
+      PERFETTO_DCHECK(input_packet_size >= filtered_packet.size);
+      size_t bytes_filtered_out = input_packet_size - filtered_packet.size;
+      vec[buffer_idx] += bytes_filtered_out;
+    }
+    AppendOwnedSlicesToPacket(std::move(filtered_packet.data),
+                              filtered_packet.size,
+                              TracingServiceImpl::kMaxTracePacketSliceSize,
+                              packet);
+  }
+}
+
 using TraceFilter = protos::gen::TraceConfig::TraceFilter;
 std::optional<protozero::StringFilter::Policy> ConvertPolicy(
     TraceFilter::StringFilterPolicy policy) {
@@ -381,6 +468,26 @@ ConvertSemanticTypeMask(const StringFilterRule& rule) {
 
 }  // namespace
 
+// The packets of a ReadBuffers() call, from the moment they are read out of
+// the buffers until they are handed to the caller. Shared with the filter
+// worker threads while they filter part of the packets, so it can outlive the
+// TracingSession.
+struct PendingRead {
+  std::vector<TracePacket> packets;
+  bool has_more = false;
+  std::function<void(std::vector<TracePacket>, bool /*has_more*/)> callback;
+
+  // Filter state. |worker_filters| are borrowed from the session while the
+  // worker threads use them.
+  bool filtered = false;
+  int64_t filter_start_ns = 0;
+  std::vector<FilterBatchStats> batch_stats;
+  std::vector<std::unique_ptr<protozero::MessageFilter>> worker_filters;
+  size_t num_worker_batches = 0;
+  std::atomic<size_t> worker_batches_left{0};
+  base::WaitableEvent worker_batch_done;
+};
+
 TracingServiceImpl::TracingServiceImpl(
     std::unique_ptr<SharedMemory::Factory> shm_factory,
     base::TaskRunner* task_runner,
@@ -1157,18 +1264,32 @@ base::Status TracingServiceImpl::EnableTracing(ConsumerEndpointImpl* consumer,
           "When write_into_file==true either a FD needs to be passed or "
           "output_path must be populated (but not both)");
     }
+    if (cfg.has_file_rotation() && cfg.output_path().empty()) {
+      tracing_sessions_.erase(tsid);
+      return PERFETTO_SVC_ERR(
+          "file_rotation requires the service to create the trace files: "
+          "output_path must be populated");
+    }
     if (!cfg.output_path().empty()) {
-      fd = CreateTraceFile(cfg.output_path(), /*overwrite=*/false);
+      std::string path = cfg.has_file_rotation()
+                             ? RotatedTraceFilePath(cfg.output_path(), 0)
+                             : cfg.output_path();
+      fd = CreateTraceFile(path, /*overwrite=*/false);
       if (!fd) {
         MaybeLogUploadEvent(
             tracing_session->config, uuid,
             PerfettoStatsdAtom::kTracedEnableTracingFailedToCreateFile);
         tracing_sessions_.erase(tsid);
         return PERFETTO_SVC_ERR("Failed to create the trace file %s",
-                                cfg.output_path().c_str());
+                                path.c_str());
       }
+      tracing_session->file_start_ms = clock_->GetWallTimeMs().count();
     }
     tracing_session->write_into_file = std::move(fd);
+    if (init_opts_.async_write_into_file) {
+      tracing_session->file_writer =
+          std::make_unique<AsyncFileWriter>(*tracing_session->write_into_file);
+    }
     uint32_t write_period_ms = cfg.file_write_period_ms();
     if (write_period_ms == 0)
       write_period_ms = kDefaultWriteIntoFilePeriodMs;
@@ -1211,9 +1332,22 @@ base::Status TracingServiceImpl::EnableTracing(ConsumerEndpointImpl* consumer,
         cfg.fflush_post_write() == TraceConfig::FFLUSH_ENABLED;
   }
 
-  if (cfg.compression_type() == TraceConfig::COMPRESSION_TYPE_DEFLATE) {
+  if (cfg.compression_type() == TraceConfig::COMPRESSION_TYPE_ZSTD) {
+    if (init_opts_.zstd_compressor_fn) {
+      tracing_session->compressor_fn = init_opts_.zstd_compressor_fn;
+    } else if (init_opts_.compressor_fn) {
+      PERFETTO_LOG(
+          "COMPRESSION_TYPE_ZSTD is not supported in the current build "
+          "configuration. Falling back to COMPRESSION_TYPE_DEFLATE");
+      tracing_session->compressor_fn = init_opts_.compressor_fn;
+    } else {
+      PERFETTO_LOG(
+          "COMPRESSION_TYPE_ZSTD is not supported in the current build "
+          "configuration. Skipping compression");
+    }
+  } else if (cfg.compression_type() == TraceConfig::COMPRESSION_TYPE_DEFLATE) {
     if (init_opts_.compressor_fn) {
-      tracing_session->compress_deflate = true;
+      tracing_session->compressor_fn = init_opts_.compressor_fn;
     } else {
       PERFETTO_LOG(
           "COMPRESSION_TYPE_DEFLATE is not supported in the current build "
@@ -2514,7 +2648,11 @@ void TracingServiceImpl::PeriodicClearIncrementalStateTask(
   PERFETTO_DLOG(
       "Performing periodic incremental state clear for trace session %" PRIu64,
       tsid);
+  ClearIncrementalState(tracing_session);
+}
 
+void TracingServiceImpl::ClearIncrementalState(
+    TracingSession* tracing_session) {
   // Queue the IPCs to producers with active data sources that opted in.
   std::map<ProducerID, std::vector<DataSourceInstanceID>> clear_map;
   for (const auto& kv : tracing_session->data_source_instances) {
@@ -2572,22 +2710,40 @@ bool TracingServiceImpl::ReadBuffersIntoConsumer(
   // buffers are full and hang the service for a bit (until the consumer
   // catches up).
   static constexpr size_t kApproxBytesPerTask = 32768;
-  bool has_more;
-  std::vector<TracePacket> packets =
-      ReadBuffers(tracing_session, kApproxBytesPerTask, &has_more);
-
-  if (has_more) {
-    auto weak_consumer = consumer->weak_ptr_factory_.GetWeakPtr();
-    weak_runner_.PostTask(
-        [this, weak_consumer = std::move(weak_consumer), tsid] {
-          if (!weak_consumer)
-            return;
-          ReadBuffersIntoConsumer(tsid, weak_consumer.get());
-        });
+  auto weak_consumer = consumer->weak_ptr_factory_.GetWeakPtr();
+  auto read_again = [this, weak_consumer, tsid] {
+    weak_runner_.PostTask([this, weak_consumer, tsid] {
+      if (!weak_consumer)
+        return;
+      ReadBuffersIntoConsumer(tsid, weak_consumer.get());
+    });
+  };
+
+  if (tracing_session->pending_read) {
+    // The previous read is still being filtered. Read again once it has been
+    // handed out, rather than overtaking it.
+    auto& callback = tracing_session->pending_read->callback;
+    callback = [previous_callback = std::move(callback), read_again](
+                   std::vector<TracePacket> packets, bool has_more) {
+      // If |has_more| the previous read continues by itself.
+      if (!has_more)
+        read_again();
+      previous_callback(std::move(packets), has_more);
+    };
+    return true;
   }
 
-  // Keep this as tail call, just in case the consumer re-enters.
-  consumer->consumer_->OnTraceData(std::move(packets), has_more);
+  ReadBuffersAsync(
+      tracing_session, kApproxBytesPerTask,
+      [weak_consumer, read_again](std::vector<TracePacket> packets,
+                                  bool has_more) {
+        if (!weak_consumer)
+          return;
+        if (has_more)
+          read_again();
+        // Keep this as tail call, just in case the consumer re-enters.
+        weak_consumer->consumer_->OnTraceData(std::move(packets), has_more);
+      });
   return true;
 }
 
@@ -2615,14 +2771,23 @@ bool TracingServiceImpl::ReadBuffersIntoFile(
         TracingSession* tracing_session = GetTracingSession(tsid);
         if (!tracing_session)
           return;
+        if (tracing_session->config.has_file_rotation() &&
+            tracing_session->write_into_file &&
+            tracing_session->write_period_ms != 0) {
+          MaybeRotateTraceFile(tracing_session);
+        }
+        if (tracing_session->write_period_ms != 0) {
+          ReadNextChunkIntoFile(tsid, async_flush_buffers_before_read);
+          return;
+        }
+
+        // This is the final read. It has to read the whole available data
+        // before returning, to support the disable_immediately=true code
+        // paths, so it reads synchronously.
+        //
         // ReadBuffers() can allocate memory internally, for filtering. By
         // limiting the data that ReadBuffers() reads to kWriteIntoChunksSize
         // per iteration, we limit the amount of memory used on each iteration.
-        //
-        // It would be tempting to split this into multiple tasks like in
-        // ReadBuffersIntoConsumer, but that's not currently possible.
-        // ReadBuffersIntoFile has to read the whole available data before
-        // returning, to support the disable_immediately=true code paths.
         bool has_more = true;
         bool stop_writing_into_file = false;
         do {
@@ -2632,27 +2797,8 @@ bool TracingServiceImpl::ReadBuffersIntoFile(
           stop_writing_into_file =
               WriteIntoFile(tracing_session, std::move(packets));
         } while (has_more && !stop_writing_into_file);
-
-        if (stop_writing_into_file || tracing_session->write_period_ms == 0) {
-          // Ensure all data was written to the file before we close it.
-          base::FlushFile(tracing_session->write_into_file.get());
-          tracing_session->write_into_file.reset();
-          tracing_session->write_period_ms = 0;
-          if (tracing_session->state == TracingSession::STARTED)
-            DisableTracing(tsid);
-          return;
-        }
-
-        if (tracing_session->fflush_post_write) {
-          // Ensure all data was written to the file.
-          base::FlushFile(tracing_session->write_into_file.get());
-        }
-
-        weak_runner_.PostDelayedTask(
-            [this, tsid, async_flush_buffers_before_read] {
-              ReadBuffersIntoFile(tsid, async_flush_buffers_before_read);
-            },
-            DelayToNextWritePeriodMs(*tracing_session));
+        FinishReadBuffersIntoFile(tracing_session, stop_writing_into_file,
+                                  async_flush_buffers_before_read);
       };
 
   if (async_flush_buffers_before_read) {
@@ -2673,6 +2819,86 @@ bool TracingServiceImpl::ReadBuffersIntoFile(
   return true;
 }
 
+void TracingServiceImpl::ReadNextChunkIntoFile(
+    TracingSessionID tsid,
+    bool async_flush_buffers_before_read) {
+  TracingSession* tracing_session = GetTracingSession(tsid);
+  if (!tracing_session || !tracing_session->write_into_file)
+    return;
+  // If the writer thread is still busy with both staging buffers, the storage
+  // can't keep up. Leave the data in the trace buffers until the next period
+  // rather than blocking the service thread.
+  AsyncFileWriter* file_writer = tracing_session->file_writer.get();
+  if (file_writer && !file_writer->has_free_buffer()) {
+    FinishReadBuffersIntoFile(tracing_session, false,
+                              async_flush_buffers_before_read);
+    return;
+  }
+  ReadBuffersAsync(
+      tracing_session, kWriteIntoFileChunkSize,
+      [this, tsid, async_flush_buffers_before_read](
+          std::vector<TracePacket> packets, bool has_more) {
+        TracingSession* session = GetTracingSession(tsid);
+        if (!session || !session->write_into_file)
+          return;
+        bool stop_writing_into_file =
+            WriteIntoFile(session, std::move(packets));
+        if (session->write_period_ms == 0) {
+          // The final read of the session is waiting for these packets and
+          // takes over from here.
+          return;
+        }
+        if (has_more && !stop_writing_into_file) {
+          // Read the next chunk in a separate task, like
+          // ReadBuffersIntoConsumer(), to keep the service responsive.
+          weak_runner_.PostTask([this, tsid, async_flush_buffers_before_read] {
+            ReadNextChunkIntoFile(tsid, async_flush_buffers_before_read);
+          });
+          return;
+        }
+        FinishReadBuffersIntoFile(session, stop_writing_into_file,
+                                  async_flush_buffers_before_read);
+      });
+}
+
+void TracingServiceImpl::FinishReadBuffersIntoFile(
+    TracingSession* tracing_session,
+    bool stop_writing_into_file,
+    bool async_flush_buffers_before_read) {
+  AsyncFileWriter* file_writer = tracing_session->file_writer.get();
+  if (stop_writing_into_file || tracing_session->write_period_ms == 0) {
+    // Ensure all data was written to the file before we close it.
+    if (file_writer) {
+      file_writer->Sync();
+      DrainFileWriter(file_writer);
+      tracing_session->file_writer.reset();
+    } else {
+      base::FlushFile(tracing_session->write_into_file.get());
+    }
+    tracing_session->write_into_file.reset();
+    tracing_session->write_period_ms = 0;
+    if (tracing_session->state == TracingSession::STARTED)
+      DisableTracing(tracing_session->id);
+    return;
+  }
+
+  if (tracing_session->fflush_post_write) {
+    // Ensure all data was written to the file.
+    if (file_writer) {
+      file_writer->Sync();
+    } else {
+      base::FlushFile(tracing_session->write_into_file.get());
+    }
+  }
+
+  TracingSessionID tsid = tracing_session->id;
+  weak_runner_.PostDelayedTask(
+      [this, tsid, async_flush_buffers_before_read] {
+        ReadBuffersIntoFile(tsid, async_flush_buffers_before_read);
+      },
+      DelayToNextWritePeriodMs(*tracing_session));
+}
+
 bool TracingServiceImpl::IsWaitingForTrigger(TracingSession* tracing_session) {
   // Ignore the logic below for cloned tracing sessions. In this case we
   // actually want to read the (cloned) trace buffers even if no trigger was
@@ -2712,6 +2938,35 @@ std::vector<TracePacket> TracingServiceImpl::ReadBuffers(
     TracingSession* tracing_session,
     size_t threshold,
     bool* has_more) {
+  std::vector<TracePacket> packets;
+  ReadBuffersAsync(tracing_session, threshold,
+                   [&packets, has_more](std::vector<TracePacket> read_packets,
+                                        bool read_has_more) {
+                     packets = std::move(read_packets);
+                     *has_more = read_has_more;
+                   });
+  CompletePendingRead(tracing_session);
+  return packets;
+}
+
+void TracingServiceImpl::ReadBuffersAsync(TracingSession* tracing_session,
+                                          size_t threshold,
+                                          ReadBuffersCallback callback) {
+  PERFETTO_DCHECK_THREAD(thread_checker_);
+  // Hand out the previous read first, so that the packets stay in order.
+  CompletePendingRead(tracing_session);
+  auto read = std::make_shared<PendingRead>();
+  read->callback = std::move(callback);
+  read->packets = ReadRawPackets(tracing_session, threshold, &read->has_more);
+  if (MaybeFilterPackets(tracing_session, read))
+    return;
+  FinishRead(tracing_session, read.get());
+}
+
+std::vector<TracePacket> TracingServiceImpl::ReadRawPackets(
+    TracingSession* tracing_session,
+    size_t threshold,
+    bool* has_more) {
   PERFETTO_DCHECK_THREAD(thread_checker_);
   PERFETTO_DCHECK(tracing_session);
   *has_more = false;
@@ -2874,89 +3129,138 @@ std::vector<TracePacket> TracingServiceImpl::ReadBuffers(
     tracing_session->should_emit_stats = false;
   }
 
-  MaybeFilterPackets(tracing_session, &packets);
-
-  MaybeCompressPackets(tracing_session, &packets);
-
-  if (!*has_more) {
-    // We've observed some extremely high memory usage by scudo after
-    // MaybeFilterPackets in the past. The original bug (b/195145848) is fixed
-    // now, but this code asks scudo to release memory just in case.
-    base::MaybeReleaseAllocatorMemToOS();
-  }
-
   return packets;
 }
 
-void TracingServiceImpl::MaybeFilterPackets(TracingSession* tracing_session,
-                                            std::vector<TracePacket>* packets) {
+bool TracingServiceImpl::MaybeFilterPackets(
+    TracingSession* tracing_session,
+    const std::shared_ptr<PendingRead>& read) {
   // If the tracing session specified a filter, run all packets through the
   // filter and replace them with the filter results.
-  // The process below mantains the cardinality of input packets. Even if an
-  // entire packet is filtered out, we emit a zero-sized TracePacket proto. That
-  // makes debugging and reasoning about the trace stats easier.
-  // This place swaps the contents of each |packets| entry in place.
+  // This place swaps the contents of each packet in place.
   if (!tracing_session->trace_filter) {
-    return;
+    return false;
   }
   protozero::MessageFilter& trace_filter = *tracing_session->trace_filter;
   // The filter root should be reset from protos.Trace to protos.TracePacket
   // by the earlier call to SetFilterRoot() in EnableTracing().
   PERFETTO_DCHECK(trace_filter.config().root_msg_index() != 0);
-  std::vector<protozero::MessageFilter::InputSlice> filter_input;
-  auto start = clock_->GetWallTimeNs();
-  for (TracePacket& packet : *packets) {
-    const auto& packet_slices = packet.slices();
-    const size_t input_packet_size = packet.size();
-    filter_input.clear();
-    filter_input.resize(packet_slices.size());
-    ++tracing_session->filter_input_packets;
-    tracing_session->filter_input_bytes += input_packet_size;
-    for (size_t i = 0; i < packet_slices.size(); ++i)
-      filter_input[i] = {packet_slices[i].start, packet_slices[i].size};
-    auto filtered_packet = trace_filter.FilterMessageFragments(
-        &filter_input[0], filter_input.size());
+  read->filtered = true;
+  read->filter_start_ns = clock_->GetWallTimeNs().count();
+
+  // Split the packets in contiguous batches, one per thread. The service
+  // thread filters the first batch itself and hands the others to the worker
+  // threads. The last worker to finish posts the completion of the read back
+  // to the service thread, which runs other tasks in the meantime.
+  // Each batch is filtered in-place, so the packet order is preserved.
+  const size_t num_packets = read->packets.size();
+  const size_t num_batches =
+      std::min(static_cast<size_t>(init_opts_.filter_thread_count) + 1,
+               num_packets / kMinPacketsPerFilterBatch);
+  read->batch_stats.resize(std::max(num_batches, size_t(1)));
+  TracePacket* first_packet = read->packets.data();
+  if (num_batches <= 1) {
+    FilterPacketBatch(&trace_filter, first_packet, first_packet + num_packets,
+                      &read->batch_stats[0]);
+    return false;
+  }
 
-    // Replace the packet in-place with the filtered one (unless failed).
-    std::optional<uint32_t> maybe_buffer_idx = packet.buffer_index_for_stats();
-    packet = TracePacket();
-    if (filtered_packet.error) {
-      ++tracing_session->filter_errors;
-      PERFETTO_DLOG("Trace packet filtering failed @ packet %" PRIu64,
-                    tracing_session->filter_input_packets);
-      continue;
-    }
-    tracing_session->filter_output_bytes += filtered_packet.size;
-    if (maybe_buffer_idx.has_value()) {
-      // Keep the per-buffer stats updated. Also propagate the
-      // buffer_index_for_stats in the output packet to allow accounting by
-      // other parts of the ReadBuffer pipeline.
-      uint32_t buffer_idx = maybe_buffer_idx.value();
-      packet.set_buffer_index_for_stats(buffer_idx);
+  if (!filter_thread_pool_) {
+    filter_thread_pool_ =
+        std::make_unique<base::ThreadPool>(init_opts_.filter_thread_count);
+  }
+  auto& worker_filters = tracing_session->worker_trace_filters;
+  while (worker_filters.size() < num_batches - 1) {
+    worker_filters.emplace_back(
+        new protozero::MessageFilter(trace_filter.config()));
+  }
+  read->worker_filters = std::move(worker_filters);
+  worker_filters.clear();
+  read->num_worker_batches = num_batches - 1;
+  read->worker_batches_left = num_batches - 1;
+  tracing_session->pending_read = read;
+
+  auto batch_begin = [&](size_t i) {
+    return first_packet + (num_packets * i / num_batches);
+  };
+  const TracingSessionID tsid = tracing_session->id;
+  for (size_t i = 1; i < num_batches; ++i) {
+    TracePacket* begin = batch_begin(i);
+    TracePacket* end = batch_begin(i + 1);
+    filter_thread_pool_->PostTask([this, read, tsid, i, begin, end] {
+      FilterPacketBatch(read->worker_filters[i - 1].get(), begin, end,
+                        &read->batch_stats[i]);
+      read->worker_batch_done.Notify();
+      if (read->worker_batches_left.fetch_sub(1) != 1)
+        return;
+      weak_runner_.PostTask([this, read, tsid] {
+        TracingSession* session = GetTracingSession(tsid);
+        // The read might have been completed by CompletePendingRead() or the
+        // session freed in the meantime.
+        if (!session || session->pending_read != read)
+          return;
+        session->pending_read.reset();
+        FinishRead(session, read.get());
+      });
+    });
+  }
+  FilterPacketBatch(&trace_filter, batch_begin(0), batch_begin(1),
+                    &read->batch_stats[0]);
+  return true;
+}
+
+void TracingServiceImpl::CompletePendingRead(TracingSession* tracing_session) {
+  std::shared_ptr<PendingRead> read = std::move(tracing_session->pending_read);
+  tracing_session->pending_read.reset();
+  if (!read)
+    return;
+  read->worker_batch_done.Wait(read->num_worker_batches);
+  FinishRead(tracing_session, read.get());
+}
+
+void TracingServiceImpl::FinishRead(TracingSession* tracing_session,
+                                    PendingRead* read) {
+  if (read->filtered) {
+    // Fold the per-batch stats into the session, in packet order.
+    for (const FilterBatchStats& stats : read->batch_stats) {
+      tracing_session->filter_input_packets += stats.input_packets;
+      tracing_session->filter_input_bytes += stats.input_bytes;
+      tracing_session->filter_output_bytes += stats.output_bytes;
+      tracing_session->filter_errors += stats.errors;
       auto& vec = tracing_session->filter_bytes_discarded_per_buffer;
-      if (static_cast<size_t>(buffer_idx) >= vec.size())
-        vec.resize(buffer_idx + 1);
-      PERFETTO_DCHECK(input_packet_size >= filtered_packet.size);
-      size_t bytes_filtered_out = input_packet_size - filtered_packet.size;
-      vec[buffer_idx] += bytes_filtered_out;
+      if (stats.bytes_discarded_per_buffer.size() > vec.size())
+        vec.resize(stats.bytes_discarded_per_buffer.size());
+      for (size_t i = 0; i < stats.bytes_discarded_per_buffer.size(); ++i)
+        vec[i] += stats.bytes_discarded_per_buffer[i];
     }
-    AppendOwnedSlicesToPacket(std::move(filtered_packet.data),
-                              filtered_packet.size, kMaxTracePacketSliceSize,
-                              &packet);
+    if (!read->worker_filters.empty())
+      tracing_session->worker_trace_filters = std::move(read->worker_filters);
+    int64_t end_ns = clock_->GetWallTimeNs().count();
+    tracing_session->filter_time_taken_ns +=
+        static_cast<uint64_t>(end_ns - read->filter_start_ns);
+  }
+
+  MaybeCompressPackets(tracing_session, &read->packets);
+
+  if (!read->has_more) {
+    // We've observed some extremely high memory usage by scudo after
+    // MaybeFilterPackets in the past. The original bug (b/195145848) is fixed
+    // now, but this code asks scudo to release memory just in case.
+    base::MaybeReleaseAllocatorMemToOS();
   }
-  auto end = clock_->GetWallTimeNs();
-  tracing_session->filter_time_taken_ns +=
-      static_cast<uint64_t>((end - start).count());
+
+  ReadBuffersCallback callback = std::move(read->callback);
+  callback(std::move(read->packets), read->has_more);
 }
 
 void TracingServiceImpl::MaybeCompressPackets(
     TracingSession* tracing_session,
     std::vector<TracePacket>* packets) {
-  if (!tracing_session->compress_deflate) {
+  if (!tracing_session->compressor_fn) {
     return;
   }
 
-  init_opts_.compressor_fn(packets);
+  tracing_session->compressor_fn(packets);
 }
 
 bool TracingServiceImpl::WriteIntoFile(TracingSession* tracing_session,
@@ -2968,44 +3272,55 @@ bool TracingServiceImpl::WriteIntoFile(TracingSession* tracing_session,
                                 ? tracing_session->max_file_size_bytes
                                 : std::numeric_limits<size_t>::max();
 
-  size_t total_slices = 0;
-  for (const TracePacket& packet : packets) {
-    total_slices += packet.slices().size();
-  }
   // When writing into a file, the file should look like a root trace.proto
   // message. Each packet should be prepended with a proto preamble stating
-  // its field id (within trace.proto) and size. Hence the addition below.
-  const size_t max_iovecs = total_slices + packets.size();
-
-  size_t num_iovecs = 0;
+  // its field id (within trace.proto) and size.
   bool stop_writing_into_file = false;
-  std::unique_ptr<struct iovec[]> iovecs(new struct iovec[max_iovecs]);
-  size_t num_iovecs_at_last_packet = 0;
+  size_t num_packets = 0;
+  size_t num_iovecs = 0;
   uint64_t bytes_about_to_be_written = 0;
+  uint64_t bytes_at_last_packet = 0;
   for (TracePacket& packet : packets) {
-    std::tie(iovecs[num_iovecs].iov_base, iovecs[num_iovecs].iov_len) =
+    bytes_about_to_be_written +=
+        std::get<1>(packet.GetProtoPreamble()) + packet.size();
+    if (tracing_session->bytes_written_into_file + bytes_about_to_be_written >=
+        max_size) {
+      stop_writing_into_file = true;
+      break;
+    }
+    bytes_at_last_packet = bytes_about_to_be_written;
+    num_iovecs += 1 + packet.slices().size();
+    num_packets++;
+  }
+
+  if (tracing_session->file_writer) {
+    // The write is completed (or fails) asynchronously. A failure is reported
+    // by the next Write().
+    if (!tracing_session->file_writer->Write(&packets, num_packets)) {
+      PERFETTO_ELOG("Writing into the trace file failed");
+      return true;
+    }
+    tracing_session->bytes_written_into_file += bytes_at_last_packet;
+    return stop_writing_into_file;
+  }
+
+  std::unique_ptr<struct iovec[]> iovecs(new struct iovec[num_iovecs]);
+  size_t iovec_idx = 0;
+  for (size_t i = 0; i < num_packets; i++) {
+    TracePacket& packet = packets[i];
+    std::tie(iovecs[iovec_idx].iov_base, iovecs[iovec_idx].iov_len) =
         packet.GetProtoPreamble();
-    bytes_about_to_be_written += iovecs[num_iovecs].iov_len;
-    num_iovecs++;
+    iovec_idx++;
     for (const Slice& slice : packet.slices()) {
       // writev() doesn't change the passed pointer. However, struct iovec
       // take a non-const ptr because it's the same struct used by readv().
       // Hence the const_cast here.
       char* start = static_cast<char*>(const_cast<void*>(slice.start));
-      bytes_about_to_be_written += slice.size;
-      iovecs[num_iovecs++] = {start, slice.size};
-    }
-
-    if (tracing_session->bytes_written_into_file + bytes_about_to_be_written >=
-        max_size) {
-      stop_writing_into_file = true;
-      num_iovecs = num_iovecs_at_last_packet;
-      break;
+      iovecs[iovec_idx++] = {start, slice.size};
     }
-
-    num_iovecs_at_last_packet = num_iovecs;
   }
-  PERFETTO_DCHECK(num_iovecs <= max_iovecs);
+  PERFETTO_DCHECK(iovec_idx == num_iovecs);
+
   int fd = *tracing_session->write_into_file;
 
   uint64_t total_wr_size = 0;
@@ -3030,6 +3345,76 @@ bool TracingServiceImpl::WriteIntoFile(TracingSession* tracing_session,
   return stop_writing_into_file;
 }
 
+void TracingServiceImpl::MaybeRotateTraceFile(
+    TracingSession* tracing_session) {
+  const auto& rotation = tracing_session->config.file_rotation();
+  int64_t now_ms = clock_->GetWallTimeMs().count();
+  if (!tracing_session->file_rotation_pending) {
+    uint64_t file_bytes = tracing_session->bytes_written_into_file -
+                          tracing_session->file_start_bytes_written;
+    int64_t file_ms = now_ms - tracing_session->file_start_ms;
+    bool is_full = (rotation.max_bytes_per_file() &&
+                    file_bytes >= rotation.max_bytes_per_file()) ||
+                   (rotation.max_duration_ms_per_file() &&
+                    file_ms >= rotation.max_duration_ms_per_file());
+    if (!is_full)
+      return;
+    // Give the data sources one write period to re-emit their interned data,
+    // so that the packets going into the next file don't depend on interned
+    // data that lives in this one.
+    ClearIncrementalState(tracing_session);
+    tracing_session->file_rotation_pending = true;
+    return;
+  }
+
+  const std::string& output_path = tracing_session->config.output_path();
+  uint32_t next_index = tracing_session->file_index + 1;
+  std::string path = RotatedTraceFilePath(output_path, next_index);
+  base::ScopedFile fd = CreateTraceFile(path, /*overwrite=*/false);
+  if (!fd) {
+    // Keep writing into the current file, and try again on the next period.
+    PERFETTO_ELOG("Failed to create the trace file %s", path.c_str());
+    return;
+  }
+
+  if (tracing_session->file_writer) {
+    tracing_session->file_writer->Sync();
+    DrainFileWriter(tracing_session->file_writer.get());
+    tracing_session->file_writer.reset();
+  } else {
+    base::FlushFile(tracing_session->write_into_file.get());
+  }
+  tracing_session->write_into_file = std::move(fd);
+  if (init_opts_.async_write_into_file) {
+    tracing_session->file_writer =
+        std::make_unique<AsyncFileWriter>(*tracing_session->write_into_file);
+  }
+  tracing_session->file_index = next_index;
+  tracing_session->file_start_bytes_written =
+      tracing_session->bytes_written_into_file;
+  tracing_session->file_start_ms = now_ms;
+  tracing_session->file_rotation_pending = false;
+
+  if (rotation.max_files() && next_index >= rotation.max_files()) {
+    std::string oldest_path =
+        RotatedTraceFilePath(output_path, next_index - rotation.max_files());
+    if (remove(oldest_path.c_str()) != 0)
+      PERFETTO_PLOG("Failed to remove %s", oldest_path.c_str());
+  }
+
+  // Make the new file self-contained: the next ReadBuffers() emits the clock
+  // snapshots, sync marker, trace config and system info again.
+  if (!tracing_session->config.builtin_data_sources()
+           .disable_clock_snapshotting()) {
+    SnapshotClocks(&tracing_session->initial_clock_snapshot);
+  }
+  tracing_session->should_emit_sync_marker = true;
+  tracing_session->did_emit_initial_packets = false;
+  tracing_session->did_emit_remote_clock_sync_ = false;
+  PERFETTO_DLOG("Rotated trace file of session %" PRIu64 " to %s",
+                tracing_session->id, path.c_str());
+}
+
 void TracingServiceImpl::FreeBuffers(TracingSessionID tsid,
                                      const std::string& error) {
   PERFETTO_DCHECK_THREAD(thread_checker_);
@@ -3978,6 +4363,17 @@ TraceStats TracingServiceImpl::GetTraceStats(TracingSession* tracing_session) {
       filt_stats->add_bytes_discarded_per_buffer(value);
   }
 
+  if (tracing_session->file_writer) {
+    AsyncFileWriter::Stats fw = tracing_session->file_writer->stats();
+    auto* fw_stats = trace_stats.mutable_file_writer_stats();
+    fw_stats->set_bytes_written(fw.bytes_written);
+    fw_stats->set_batches_written(fw.batches_written);
+    fw_stats->set_write_errors(fw.write_errors);
+    fw_stats->set_max_pending_bytes(fw.max_pending_bytes);
+    fw_stats->set_stalls(fw.stalls);
+    fw_stats->set_stall_time_ns(fw.stall_time_ns);
+  }
+
   for (BufferID buf_id : tracing_session->buffers_index) {
     TraceBuffer* buf = GetBufferByID(buf_id);
     if (!buf) {
@@ -4393,6 +4789,8 @@ base::Status TracingServiceImpl::FlushAndCloneSession(
           "Failed to clone 'write_into_file' session: a file descriptor is "
           "required to copy existing file");
     }
+    if (session->file_writer)
+      DrainFileWriter(session->file_writer.get());
     base::FlushFile(*session->write_into_file);
     base::Status status =
         base::CopyFileContents(*session->write_into_file, *args.output_file_fd);
@@ -4734,7 +5132,7 @@ base::Status TracingServiceImpl::FinishCloneSession(
   cloned_session->flushes_requested = src->flushes_requested;
   cloned_session->flushes_succeeded = src->flushes_succeeded;
   cloned_session->flushes_failed = src->flushes_failed;
-  cloned_session->compress_deflate = src->compress_deflate;
+  cloned_session->compressor_fn = src->compressor_fn;
   if (src->trace_filter && !skip_trace_filter) {
     // Copy the trace filter, unless it's a clone-for-bugreport (b/317065412).
     cloned_session->trace_filter.reset(
@@ -17,6 +17,7 @@
 #ifndef SRC_TRACING_SERVICE_TRACING_SERVICE_IMPL_H_
 #define SRC_TRACING_SERVICE_TRACING_SERVICE_IMPL_H_
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <optional>
@@ -50,6 +51,10 @@ class MessageFilter;
 
 namespace perfetto {
 
+namespace base {
+class ThreadPool;
+}  // namespace base
+
 namespace protos {
 namespace gen {
 enum TraceStats_FinalFlushOutcome : int;
@@ -146,8 +151,11 @@ class TracingServiceImpl : public TracingService {
   // asynchronous: immediately posts a `Flush` task and returns. Reads the
   // buffers when the flush is done, inside the `FlushCallback`.
   //
-  // Reads all the data in the buffers (or until the file is full) before
-  // returning.
+  // When the write period is 0 (i.e. this is the final read), reads all the
+  // data in the buffers (or until the file is full) before returning.
+  // Otherwise the buffers are read in chunks: while a chunk is being filtered
+  // on the filter worker threads, the service thread keeps running other
+  // tasks.
   //
   // If the tracing session write_period_ms is 0, the file is full or there has
   // been an error, flushes the file and closes it. Otherwise, schedules itself
@@ -277,6 +285,7 @@ class TracingServiceImpl : public TracingService {
                      bool success);
   void ScrapeSharedMemoryBuffers(TracingSession*, ProducerEndpointImpl*);
   void PeriodicClearIncrementalStateTask(TracingSessionID, bool post_next_only);
+  void ClearIncrementalState(TracingSession*);
   TraceBuffer* GetBufferByID(BufferID);
   void FlushDataSourceInstances(
       TracingSession*,
@@ -315,14 +324,52 @@ class TracingServiceImpl : public TracingService {
   // The function stops when the cumulative size of the return packets exceeds
   // `threshold` (so it's not a strict upper bound) and sets `*has_more` to
   // true, or when there are no more packets (and sets `*has_more` to false).
+  //
+  // If the packets are filtered on the filter worker threads, blocks until
+  // they are done: prefer ReadBuffersAsync() on the service thread.
   std::vector<TracePacket> ReadBuffers(TracingSession* tracing_session,
                                        size_t threshold,
                                        bool* has_more);
 
-  // If `*tracing_session` has a filter, applies it to `*packets`. Doesn't
-  // change the number of `*packets`, only their content.
-  void MaybeFilterPackets(TracingSession* tracing_session,
-                          std::vector<TracePacket>* packets);
+  // Like ReadBuffers(), but hands the packets to `callback`. If the packets
+  // are filtered on the filter worker threads, returns straight away and
+  // `callback` is invoked from a task posted once they are done (unless the
+  // session is freed in the meantime). Otherwise `callback` is invoked before
+  // returning.
+  using ReadBuffersCallback =
+      std::function<void(std::vector<TracePacket>, bool /*has_more*/)>;
+  void ReadBuffersAsync(TracingSession* tracing_session,
+                        size_t threshold,
+                        ReadBuffersCallback callback);
+
+  // Reads the packets of ReadBuffers(), before filtering and compression.
+  std::vector<TracePacket> ReadRawPackets(TracingSession* tracing_session,
+                                          size_t threshold,
+                                          bool* has_more);
+
+  // If `*tracing_session` has a filter, applies it to the packets of `read`.
+  // Doesn't change the number of packets, only their content. Returns true if
+  // part of them are being filtered on the filter worker threads: in this case
+  // `read` becomes the session's `pending_read` until they are done.
+  bool MaybeFilterPackets(TracingSession* tracing_session,
+                          const std::shared_ptr<PendingRead>& read);
+
+  // Waits for the session's `pending_read`, if any, and hands it out.
+  void CompletePendingRead(TracingSession* tracing_session);
+
+  // Folds the filter stats of `read` into the session, compresses its packets
+  // and hands them to its callback.
+  void FinishRead(TracingSession* tracing_session, PendingRead* read);
+
+  // Reads the next chunk of a periodic ReadBuffersIntoFile().
+  void ReadNextChunkIntoFile(TracingSessionID tsid,
+                             bool async_flush_buffers_before_read);
+
+  // Ends a ReadBuffersIntoFile(): closes the file if `stop_writing_into_file`
+  // or if this was the final read, otherwise schedules the next read.
+  void FinishReadBuffersIntoFile(TracingSession* tracing_session,
+                                 bool stop_writing_into_file,
+                                 bool async_flush_buffers_before_read);
 
   // If `*tracing_session` has compression enabled, compress `*packets`.
   void MaybeCompressPackets(TracingSession* tracing_session,
@@ -335,6 +382,11 @@ class TracingServiceImpl : public TracingService {
   // been an error), false otherwise.
   bool WriteIntoFile(TracingSession* tracing_session,
                      std::vector<TracePacket> packets);
+  // Implements TraceConfig.file_rotation. Called before each periodic write
+  // into the file: once the current file is full, asks the data sources to
+  // clear their incremental state and, on the next call, switches to a new
+  // file.
+  void MaybeRotateTraceFile(TracingSession*);
   void OnStartTriggersTimeout(TracingSessionID tsid);
   void MaybeLogUploadEvent(const TraceConfig&,
                            const base::Uuid&,
@@ -352,6 +404,7 @@ class TracingServiceImpl : public TracingService {
   std::unique_ptr<tracing_service::Random> random_;
   const InitOpts init_opts_;
   std::unique_ptr<SharedMemory::Factory> shm_factory_;
+
   ProducerID last_producer_id_ = 0;
   DataSourceInstanceID last_data_source_instance_id_ = 0;
   TracingSessionID last_tracing_session_id_ = 0;
@@ -387,6 +440,12 @@ class TracingServiceImpl : public TracingService {
   PERFETTO_THREAD_CHECKER(thread_checker_)
 
   base::WeakRunner weak_runner_;
+
+  // Runs the trace filter over batches of packets in MaybeFilterPackets().
+  // Created lazily and only if |init_opts_.filter_thread_count| > 0.
+  // Declared after |weak_runner_|, which the worker threads use to post the
+  // completion of a batch, so that they are joined before it is destroyed.
+  std::unique_ptr<base::ThreadPool> filter_thread_pool_;
 };
 
 }  // namespace tracing_service
@@ -2113,6 +2113,61 @@ TEST_F(TracingServiceImplTest, CompressionReadIpc) {
                   Property(&protos::gen::TestEvent::str, Eq("payload-2")))));
 }
 
+TEST_F(TracingServiceImplTest, ZstdCompressionFallsBackToDeflate) {
+  // Initialize the service with support for deflate but not zstd.
+  TracingService::InitOpts init_opts;
+  init_opts.compressor_fn = ZlibCompressFn;
+  init_opts.zstd_compressor_fn = nullptr;
+  InitializeSvcWithOpts(init_opts);
+
+  std::unique_ptr<MockConsumer> consumer = CreateMockConsumer();
+  consumer->Connect(svc.get());
+
+  std::unique_ptr<MockProducer> producer = CreateMockProducer();
+  producer->Connect(svc.get(), "mock_producer");
+  producer->RegisterDataSource("data_source");
+
+  TraceConfig trace_config;
+  trace_config.add_buffers()->set_size_kb(4096);
+  auto* ds_config = trace_config.add_data_sources()->mutable_config();
+  ds_config->set_name("data_source");
+  ds_config->set_target_buffer(0);
+  trace_config.set_compression_type(TraceConfig::COMPRESSION_TYPE_ZSTD);
+  consumer->EnableTracing(trace_config);
+
+  producer->WaitForTracingSetup();
+  producer->WaitForDataSourceSetup("data_source");
+  producer->WaitForDataSourceStart("data_source");
+
+  std::unique_ptr<TraceWriter> writer =
+      producer->CreateTraceWriter("data_source");
+  {
+    auto tp = writer->NewTracePacket();
+    tp->set_for_testing()->set_str("payload-1");
+  }
+
+  writer->Flush();
+  writer.reset();
+
+  consumer->DisableTracing();
+  producer->WaitForDataSourceStop("data_source");
+  consumer->WaitForTracingDisabled();
+
+  // The packets should be compressed with deflate.
+  std::vector<protos::gen::TracePacket> compressed_packets =
+      consumer->ReadBuffers();
+  EXPECT_THAT(compressed_packets, Not(IsEmpty()));
+  EXPECT_THAT(compressed_packets,
+              Each(Property(&protos::gen::TracePacket::compressed_packets,
+                            Not(IsEmpty()))));
+  std::vector<protos::gen::TracePacket> decompressed_packets =
+      DecompressTrace(compressed_packets);
+  EXPECT_THAT(decompressed_packets,
+              Contains(Property(
+                  &protos::gen::TracePacket::for_testing,
+                  Property(&protos::gen::TestEvent::str, Eq("payload-1")))));
+}
+
 TEST_F(TracingServiceImplTest, CompressionWriteIntoFile) {
   TracingService::InitOpts init_opts;
   init_opts.compressor_fn = ZlibCompressFn;
@@ -2441,6 +2496,70 @@ TEST_F(TracingServiceImplTest, WriteIntoFileAndStopOnMaxSize) {
   }
 }
 
+// Same as above, but the file is written from a dedicated writer thread.
+TEST_F(TracingServiceImplTest, WriteIntoFileAsync) {
+  TracingService::InitOpts init_opts;
+  init_opts.async_write_into_file = true;
+  InitializeSvcWithOpts(init_opts);
+
+  std::unique_ptr<MockConsumer> consumer = CreateMockConsumer();
+  consumer->Connect(svc.get());
+
+  std::unique_ptr<MockProducer> producer = CreateMockProducer();
+  producer->Connect(svc.get(), "mock_producer");
+  producer->RegisterDataSource("data_source");
+
+  TraceConfig trace_config;
+  trace_config.add_buffers()->set_size_kb(4096);
+  auto* ds_config = trace_config.add_data_sources()->mutable_config();
+  ds_config->set_name("data_source");
+  ds_config->set_target_buffer(0);
+  trace_config.set_write_into_file(true);
+  trace_config.set_file_write_period_ms(100000);  // 100s
+  base::TempFile tmp_file = base::TempFile::Create();
+  consumer->EnableTracing(trace_config, base::ScopedFile(dup(tmp_file.fd())));
+
+  producer->WaitForTracingSetup();
+  producer->WaitForDataSourceSetup("data_source");
+  producer->WaitForDataSourceStart("data_source");
+
+  static const int kNumTestPackets = 100;
+  static const char kPayload[] = "1234567890abcdef-";
+
+  std::unique_ptr<TraceWriter> writer =
+      producer->CreateTraceWriter("data_source");
+  for (int i = 0; i < kNumTestPackets; i++) {
+    auto tp = writer->NewTracePacket();
+    std::string payload(kPayload);
+    payload.append(std::to_string(i));
+    tp->set_for_testing()->set_str(payload.c_str(), payload.size());
+  }
+  writer->Flush();
+  writer.reset();
+
+  consumer->DisableTracing();
+  producer->WaitForDataSourceStop("data_source");
+  consumer->WaitForTracingDisabled();
+
+  std::string trace_raw;
+  ASSERT_TRUE(base::ReadFile(tmp_file.path().c_str(), &trace_raw));
+  protos::gen::Trace trace;
+  ASSERT_TRUE(trace.ParseFromString(trace_raw));
+
+  std::vector<std::string> payloads;
+  bool has_file_writer_stats = false;
+  for (const protos::gen::TracePacket& tp : trace.packet()) {
+    if (tp.has_for_testing())
+      payloads.push_back(tp.for_testing().str());
+    if (tp.trace_stats().has_file_writer_stats())
+      has_file_writer_stats = true;
+  }
+  ASSERT_EQ(payloads.size(), static_cast<size_t>(kNumTestPackets));
+  for (int i = 0; i < kNumTestPackets; i++)
+    EXPECT_EQ(payloads[static_cast<size_t>(i)], kPayload + std::to_string(i));
+  EXPECT_TRUE(has_file_writer_stats);
+}
+
 TEST_F(TracingServiceImplTest, WriteIntoFileWithPath) {
   auto tmp_file = base::TempFile::Create();
   // Deletes the file (the service would refuse to overwrite an existing file)
@@ -2577,6 +2696,110 @@ TEST_F(TracingServiceImplTest, NoFlushBeforeWriteIntoFile) {
   }
 }
 
+TEST_F(TracingServiceImplTest, WriteIntoFileWithRotation) {
+  base::TempDir tmp_dir = base::TempDir::Create();
+  const std::string output_path = tmp_dir.path() + "/trace";
+  auto file_path = [&](uint32_t index) {
+    return output_path + "." + std::to_string(index);
+  };
+
+  std::unique_ptr<MockConsumer> consumer = CreateMockConsumer();
+  consumer->Connect(svc.get());
+
+  std::unique_ptr<MockProducer> producer = CreateMockProducer();
+  producer->Connect(svc.get(), "mock_producer");
+  producer->RegisterDataSource("data_source", false, false,
+                               /*handles_incremental_state_clear=*/true);
+
+  constexpr uint32_t kWritePeriodMs = 100;
+  TraceConfig trace_config;
+  trace_config.add_buffers()->set_size_kb(4096);
+  auto* ds_config = trace_config.add_data_sources()->mutable_config();
+  ds_config->set_name("data_source");
+  ds_config->set_target_buffer(0);
+  trace_config.set_write_into_file(true);
+  trace_config.set_output_path(output_path);
+  trace_config.set_file_write_period_ms(kWritePeriodMs);
+  trace_config.set_write_flush_mode(TraceConfig::WRITE_FLUSH_DISABLED);
+  auto* rotation = trace_config.mutable_file_rotation();
+  rotation->set_max_duration_ms_per_file(kWritePeriodMs);
+  rotation->set_max_files(2);
+  consumer->EnableTracing(trace_config);
+
+  producer->WaitForTracingSetup();
+  producer->WaitForDataSourceSetup("data_source");
+  producer->WaitForDataSourceStart("data_source");
+  std::unique_ptr<TraceWriter> writer =
+      producer->CreateTraceWriter("data_source");
+
+  // Records the incremental state clears and the roll overs in the order in
+  // which they happen.
+  std::vector<std::string> events;
+  EXPECT_CALL(*producer, ClearIncrementalState(_, _))
+      .WillRepeatedly([&events](const DataSourceInstanceID*, size_t) {
+        events.push_back("clear");
+      });
+
+  // A file is due after one period and rolled over on the next one.
+  constexpr uint32_t kNumPeriods = 8;
+  uint32_t next_index = 1;
+  for (uint32_t i = 0; i < kNumPeriods; i++) {
+    {
+      auto tp = writer->NewTracePacket();
+      tp->set_for_testing()->set_str("payload_" + std::to_string(i));
+    }
+    writer->Flush();
+    AdvanceTimeAndRunUntilIdle(kWritePeriodMs);
+    if (base::FileExists(file_path(next_index))) {
+      events.push_back("rollover");
+      next_index++;
+    }
+  }
+  writer.reset();
+
+  // The data source is asked to clear its incremental state before each roll
+  // over, so that it re-emits its interned data into the new file.
+  ASSERT_GE(events.size(), 4u);
+  for (size_t i = 0; i < events.size(); i++) {
+    EXPECT_EQ(events[i], i % 2 == 0 ? "clear" : "rollover") << i;
+  }
+
+  consumer->DisableTracing();
+  producer->WaitForDataSourceStop("data_source");
+  consumer->WaitForTracingDisabled();
+
+  std::vector<uint32_t> indexes;
+  for (uint32_t i = 0; i < kNumPeriods; i++) {
+    if (base::FileExists(file_path(i)))
+      indexes.push_back(i);
+  }
+  ASSERT_EQ(indexes.size(), 2u);
+  EXPECT_GE(indexes[0], 2u);
+  EXPECT_EQ(indexes[1], indexes[0] + 1);
+
+  // Each file is self-contained, and the last one has the latest data.
+  std::vector<std::string> payloads;
+  for (uint32_t index : indexes) {
+    std::string trace_raw;
+    ASSERT_TRUE(base::ReadFile(file_path(index), &trace_raw));
+    protos::gen::Trace trace;
+    ASSERT_TRUE(trace.ParseFromString(trace_raw));
+    EXPECT_THAT(trace.packet(),
+                Contains(Property(&protos::gen::TracePacket::has_trace_config,
+                                  true)));
+    EXPECT_THAT(trace.packet(),
+                Contains(Property(
+                    &protos::gen::TracePacket::has_clock_snapshot, true)));
+    for (const protos::gen::TracePacket& tp : trace.packet()) {
+      if (tp.has_for_testing())
+        payloads.push_back(tp.for_testing().str());
+    }
+    remove(file_path(index).c_str());
+  }
+  ASSERT_FALSE(payloads.empty());
+  EXPECT_EQ(payloads.back(), "payload_" + std::to_string(kNumPeriods - 1));
+}
+
 TEST_F(TracingServiceImplTest, WriteIntoFileCloneSessionBeforeWrite) {
   if (!PERFETTO_FLAGS(BUFFER_CLONE_PRESERVE_READ_ITER)) {
     GTEST_SKIP() << "This test requires buffer_clone_preserve_read_iter=true";
@@ -6732,11 +6955,167 @@ TEST_F(TracingServiceImplTest, StringFiltering) {
                                                   Eq("B|1023|payP6ad1P")))));
 }
 
+// Same as above, but with enough packets to split the filtering across the
+// filter worker threads. Checks that the packets are read back in order.
+TEST_F(TracingServiceImplTest, StringFilteringOnWorkerThreads) {
+  TracingService::InitOpts init_opts;
+  init_opts.filter_thread_count = 3;
+  InitializeSvcWithOpts(init_opts);
+
+  std::unique_ptr<MockConsumer> consumer = CreateMockConsumer();
+  consumer->Connect(svc.get());
+
+  std::unique_ptr<MockProducer> producer = CreateMockProducer();
+  producer->Connect(svc.get(), "mock_producer");
+
+  producer->RegisterDataSource("ds_1");
+
+  TraceConfig trace_config;
+  trace_config.add_buffers()->set_size_kb(256);  // Buf 0.
+  auto* ds_cfg = trace_config.add_data_sources()->mutable_config();
+  ds_cfg->set_name("ds_1");
+  ds_cfg->set_target_buffer(0);
+
+  protozero::FilterBytecodeGenerator filt;
+  // Message 0: root Trace proto.
+  filt.AddNestedField(1 /* root trace.packet*/, 1);
+  filt.EndMessage();
+  // Message 1: TracePacket proto. Allow only the `for_testing` sub-field.
+  filt.AddNestedField(protos::pbzero::TracePacket::kForTestingFieldNumber, 2);
+  filt.EndMessage();
+  // Message 2: TestEvent proto. Allow only the `str` sub-field as a string.
+  filt.AddFilterStringField(protos::pbzero::TestEvent::kStrFieldNumber,
+                            /*semantic_type=*/0, /*allow_in_v1=*/false,
+                            /*allow_in_v2=*/false);
+  filt.EndMessage();
+  trace_config.mutable_trace_filter()->set_bytecode_v2(
+      filt.Serialize().bytecode);
+
+  // Redact the last digit of the payloads ending with an odd digit.
+  auto* chain =
+      trace_config.mutable_trace_filter()->mutable_string_filter_chain();
+  auto* rule = chain->add_rules();
+  rule->set_policy(
+      protos::gen::TraceConfig::TraceFilter::SFP_ATRACE_MATCH_REDACT_GROUPS);
+  rule->set_atrace_payload_starts_with("payload");
+  rule->set_regex_pattern(R"(B\|\d+\|payload\d*([13579]))");
+
+  consumer->EnableTracing(trace_config);
+  producer->WaitForTracingSetup();
+
+  producer->WaitForDataSourceSetup("ds_1");
+  producer->WaitForDataSourceStart("ds_1");
+
+  std::unique_ptr<TraceWriter> writer = producer->CreateTraceWriter("ds_1");
+  static constexpr size_t kNumTestPackets = 2000;
+  std::vector<std::string> expected_payloads;
+  for (size_t i = 0; i < kNumTestPackets; i++) {
+    auto tp = writer->NewTracePacket();
+    std::string payload("B|1023|payload" + std::to_string(i));
+    tp->set_for_testing()->set_str(payload.c_str(), payload.size());
+    if (i % 2)
+      payload.back() = 'P';
+    expected_payloads.push_back(std::move(payload));
+  }
+
+  auto flush_request = consumer->Flush();
+  producer->ExpectFlush(writer.get());
+  ASSERT_TRUE(flush_request.WaitForReply());
+
+  const DataSourceInstanceID id1 = producer->GetDataSourceInstanceId("ds_1");
+  EXPECT_CALL(*producer, StopDataSource(id1));
+
+  consumer->DisableTracing();
+  consumer->WaitForTracingDisabled();
+
+  auto packets = consumer->ReadBuffers();
+  std::vector<std::string> actual_payloads;
+  for (const auto& packet : packets) {
+    if (packet.has_for_testing())
+      actual_payloads.emplace_back(packet.for_testing().str());
+  }
+  EXPECT_THAT(actual_payloads, ElementsAreArray(expected_payloads));
+}
+
 // Comprehensive test for UNSPECIFIED semantic type handling.
 // UNSPECIFIED (0) is treated as its own distinct category.
 //
 // We use two sessions (one per bytecode semantic type) with multiple rules
 // and packets per session to minimize setup/teardown overhead.
+// The periodic reads of a write_into_file session filter on the worker threads
+// without blocking the service thread. Checks that the packets are written in
+// order, both by the periodic reads and by the final one.
+TEST_F(TracingServiceImplTest, WriteIntoFileFilterOnWorkerThreads) {
+  TracingService::InitOpts init_opts;
+  init_opts.filter_thread_count = 3;
+  InitializeSvcWithOpts(init_opts);
+
+  std::unique_ptr<MockConsumer> consumer = CreateMockConsumer();
+  consumer->Connect(svc.get());
+
+  std::unique_ptr<MockProducer> producer = CreateMockProducer();
+  producer->Connect(svc.get(), "mock_producer");
+  producer->RegisterDataSource("data_source");
+
+  constexpr uint32_t kWritePeriodMs = 100;
+  TraceConfig trace_config;
+  trace_config.add_buffers()->set_size_kb(4096);
+  auto* ds_config = trace_config.add_data_sources()->mutable_config();
+  ds_config->set_name("data_source");
+  ds_config->set_target_buffer(0);
+  trace_config.set_write_into_file(true);
+  trace_config.set_file_write_period_ms(kWritePeriodMs);
+  trace_config.set_write_flush_mode(TraceConfig::WRITE_FLUSH_DISABLED);
+
+  protozero::FilterBytecodeGenerator filt;
+  // Message 0: root Trace proto.
+  filt.AddNestedField(1 /* root trace.packet*/, 1);
+  filt.EndMessage();
+  // Message 1: TracePacket proto. Allow all fields.
+  filt.AddSimpleFieldRange(1, 1000);
+  filt.EndMessage();
+  trace_config.mutable_trace_filter()->set_bytecode(filt.Serialize().bytecode);
+
+  base::TempFile tmp_file = base::TempFile::Create();
+  consumer->EnableTracing(trace_config, base::ScopedFile(dup(tmp_file.fd())));
+
+  producer->WaitForTracingSetup();
+  producer->WaitForDataSourceSetup("data_source");
+  producer->WaitForDataSourceStart("data_source");
+
+  std::unique_ptr<TraceWriter> writer =
+      producer->CreateTraceWriter("data_source");
+  constexpr uint32_t kNumPeriods = 3;
+  constexpr uint32_t kPacketsPerPeriod = 500;
+  std::vector<std::string> expected_payloads;
+  for (uint32_t period = 0; period < kNumPeriods; period++) {
+    for (uint32_t i = 0; i < kPacketsPerPeriod; i++) {
+      std::string payload = "payload_" + std::to_string(period) + "_" +
+                            std::to_string(i);
+      writer->NewTracePacket()->set_for_testing()->set_str(payload);
+      expected_payloads.push_back(std::move(payload));
+    }
+    writer->Flush();
+    AdvanceTimeAndRunUntilIdle(kWritePeriodMs);
+  }
+  writer.reset();
+
+  consumer->DisableTracing();
+  producer->WaitForDataSourceStop("data_source");
+  consumer->WaitForTracingDisabled();
+
+  std::string trace_raw;
+  ASSERT_TRUE(base::ReadFile(tmp_file.path().c_str(), &trace_raw));
+  protos::gen::Trace trace;
+  ASSERT_TRUE(trace.ParseFromString(trace_raw));
+  std::vector<std::string> payloads;
+  for (const protos::gen::TracePacket& tp : trace.packet()) {
+    if (tp.has_for_testing())
+      payloads.push_back(tp.for_testing().str());
+  }
+  EXPECT_EQ(payloads, expected_payloads);
+}
+
 TEST_F(TracingServiceImplTest, StringFilteringSemanticTypeUnspecified) {
   // Runs a session with given bytecode semantic type and multiple rules,
   // returning a map of string prefix -> output string.
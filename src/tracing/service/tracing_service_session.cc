@@ -17,6 +17,7 @@
 #include "src/tracing/service/tracing_service_session.h"
 #include "protos/perfetto/trace/perfetto/tracing_service_event.pbzero.h"
 #include "src/protozero/filtering/message_filter.h"
+#include "src/tracing/service/async_file_writer.h"
 #include "src/tracing/service/trace_buffer.h"
 #include "src/tracing/service/tracing_service_endpoints_impl.h"
 
@@ -33,6 +33,7 @@
 #include "perfetto/ext/base/scoped_sched_boost.h"
 #include "perfetto/ext/base/uuid.h"
 #include "perfetto/ext/tracing/core/basic_types.h"
+#include "perfetto/ext/tracing/core/tracing_service.h"
 #include "perfetto/tracing/core/data_source_config.h"
 #include "perfetto/tracing/core/trace_config.h"
 
@@ -54,9 +55,12 @@ namespace base {
 class TaskRunner;
 }
 
+class AsyncFileWriter;
+
 namespace tracing_service {
 
 class ConsumerEndpointImpl;
+struct PendingRead;
 
 // Holds the state of a tracing session. A tracing session is uniquely bound
 // a specific Consumer. Each Consumer can own one or more sessions.
@@ -156,8 +160,9 @@ struct TracingSession {
   // Whether we emitted clock offsets for relay clients yet.
   bool did_emit_remote_clock_sync_ = false;
 
-  // Whether we should compress TracePackets after reading them.
-  bool compress_deflate = false;
+  // If set, the function used to compress TracePackets after reading them.
+  // Selected from TracingServiceInitOpts by TraceConfig.compression_type.
+  TracingServiceInitOpts::CompressorFn compressor_fn = nullptr;
 
   // The number of received triggers we've emitted into the trace output.
   size_t num_triggers_emitted_into_trace = 0;
@@ -238,6 +243,12 @@ struct TracingSession {
   base::ScopedFile write_into_file;
   uint32_t write_period_ms = 0;
 
+  // Set when TracingServiceInitOpts.async_write_into_file is true. Writes into
+  // |write_into_file| from its own thread. Must be drained (and is destroyed,
+  // being declared after |write_into_file|) before the file is touched
+  // otherwise or closed.
+  std::unique_ptr<AsyncFileWriter> file_writer;
+
   // Flush strategy for the tracing session:
   // * kDisabled: default, no periodic or on-write flushing is performed.
   // * kOnWrite: Buffers are flushed every time data is written to the output
@@ -251,6 +262,16 @@ struct TracingSession {
   uint64_t max_file_size_bytes = 0;
   uint64_t bytes_written_into_file = 0;
 
+  // Only used when TraceConfig.file_rotation is set. The index N of the
+  // current "<output_path>.<N>" file, and |bytes_written_into_file| and the
+  // wall time when it was created. |file_rotation_pending| is set once the
+  // current file is due to be rolled over and the incremental state of the
+  // data sources has been cleared: the next write goes into a new file.
+  uint32_t file_index = 0;
+  uint64_t file_start_bytes_written = 0;
+  int64_t file_start_ms = 0;
+  bool file_rotation_pending = false;
+
   // Periodic task for snapshotting service events (e.g. clocks, sync markers
   // etc)
   base::PeriodicTask snapshot_periodic_task;
@@ -262,6 +283,12 @@ struct TracingSession {
 
   // When non-NULL the packets should be post-processed using the filter.
   std::unique_ptr<protozero::MessageFilter> trace_filter;
+  // Copies of |trace_filter| used by the filter worker threads (MessageFilter
+  // is stateful and cannot be shared). Created on demand, one per worker.
+  std::vector<std::unique_ptr<protozero::MessageFilter>> worker_trace_filters;
+  // Set while the packets of the last read are being filtered on the filter
+  // worker threads. Cleared when they are handed out.
+  std::shared_ptr<PendingRead> pending_read;
   uint64_t filter_input_packets = 0;
   uint64_t filter_input_bytes = 0;
   uint64_t filter_output_bytes = 0;
@@ -24,35 +24,15 @@
 
 #include "protos/perfetto/trace/trace.pbzero.h"
 #include "protos/perfetto/trace/trace_packet.pbzero.h"
+#include "src/tracing/service/compressor_utils.h"
 
 namespace perfetto {
 
 namespace {
 
-struct Preamble {
-  uint32_t size;
-  std::array<uint8_t, 16> buf;
-};
-
-template <uint32_t id>
-Preamble GetPreamble(size_t sz) {
-  Preamble preamble;
-  uint8_t* ptr = preamble.buf.data();
-  constexpr uint32_t tag = protozero::proto_utils::MakeTagLengthDelimited(id);
-  ptr = protozero::proto_utils::WriteVarInt(tag, ptr);
-  ptr = protozero::proto_utils::WriteVarInt(sz, ptr);
-  preamble.size =
-      static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ptr) -
-                            reinterpret_cast<uintptr_t>(preamble.buf.data()));
-  PERFETTO_DCHECK(preamble.size < preamble.buf.size());
-  return preamble;
-}
-
-Slice PreambleToSlice(const Preamble& preamble) {
-  Slice slice = Slice::Allocate(preamble.size);
-  memcpy(slice.own_data(), preamble.buf.data(), preamble.size);
-  return slice;
-}
+using compressor_utils::GetPreamble;
+using compressor_utils::Preamble;
+using compressor_utils::PreambleToSlice;
 
 // A compressor for `TracePacket`s that uses zlib. The class is exposed for
 // testing.
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/tracing/service/zstd_compressor.h"
+
+#if !PERFETTO_BUILDFLAG(PERFETTO_ZSTD)
+#error "Zstd must be enabled to compile this file."
+#endif
+
+#include <zstd.h>
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "protos/perfetto/trace/trace.pbzero.h"
+#include "protos/perfetto/trace/trace_packet.pbzero.h"
+#include "src/tracing/service/compressor_utils.h"
+
+namespace perfetto {
+
+namespace {
+
+using compressor_utils::GetPreamble;
+using compressor_utils::Preamble;
+using compressor_utils::PreambleToSlice;
+
+// Level 3 is zstd's default: it compresses faster than zlib at level 6 with a
+// better compression ratio, which matters as this runs on device.
+constexpr int kCompressionLevel = 3;
+
+// A compressor for `TracePacket`s that uses zstd. Mirrors ZlibPacketCompressor:
+// the output is split in slices of at most kZstdCompressSliceSize bytes.
+class ZstdPacketCompressor {
+ public:
+  ZstdPacketCompressor();
+  ~ZstdPacketCompressor();
+
+  // Can be called multiple times, before Finish() is called.
+  void PushPacket(const TracePacket& packet);
+
+  // Returned the compressed data. Can be called at most once. After this call,
+  // the object is unusable (PushPacket should not be called) and must be
+  // destroyed.
+  TracePacket Finish();
+
+ private:
+  void PushData(const void* data, size_t size);
+  void NewOutputSlice();
+  void PushCurSlice();
+
+  ZSTD_CCtx* const cctx_;
+  ZSTD_outBuffer out_{};
+  size_t total_new_slices_size_ = 0;
+  std::vector<Slice> new_slices_;
+  std::unique_ptr<uint8_t[]> cur_slice_;
+};
+
+ZstdPacketCompressor::ZstdPacketCompressor() : cctx_(ZSTD_createCCtx()) {
+  PERFETTO_CHECK(cctx_);
+  size_t ret =
+      ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel, kCompressionLevel);
+  PERFETTO_CHECK(!ZSTD_isError(ret));
+}
+
+ZstdPacketCompressor::~ZstdPacketCompressor() {
+  ZSTD_freeCCtx(cctx_);
+}
+
+void ZstdPacketCompressor::PushPacket(const TracePacket& packet) {
+  // We need to be able to tokenize packets in the compressed stream, so we
+  // prefix a proto preamble to each packet. The compressed stream looks like a
+  // valid Trace proto.
+  Preamble preamble =
+      GetPreamble<protos::pbzero::Trace::kPacketFieldNumber>(packet.size());
+  PushData(preamble.buf.data(), preamble.size);
+  for (const Slice& slice : packet.slices()) {
+    PushData(slice.start, slice.size);
+  }
+}
+
+void ZstdPacketCompressor::PushData(const void* data, size_t size) {
+  ZSTD_inBuffer in{data, size, 0};
+  while (in.pos < in.size) {
+    if (out_.pos == out_.size) {
+      NewOutputSlice();
+    }
+    size_t ret = ZSTD_compressStream2(cctx_, &out_, &in, ZSTD_e_continue);
+    PERFETTO_CHECK(!ZSTD_isError(ret));
+  }
+}
+
+TracePacket ZstdPacketCompressor::Finish() {
+  for (;;) {
+    if (out_.pos == out_.size) {
+      NewOutputSlice();
+    }
+    ZSTD_inBuffer in{nullptr, 0, 0};
+    size_t remaining = ZSTD_compressStream2(cctx_, &out_, &in, ZSTD_e_end);
+    PERFETTO_CHECK(!ZSTD_isError(remaining));
+    if (remaining == 0)
+      break;
+  }
+
+  PushCurSlice();
+
+  TracePacket packet;
+  packet.AddSlice(PreambleToSlice(
+      GetPreamble<protos::pbzero::TracePacket::kCompressedPacketsFieldNumber>(
+          total_new_slices_size_)));
+  for (auto& slice : new_slices_) {
+    packet.AddSlice(std::move(slice));
+  }
+  return packet;
+}
+
+void ZstdPacketCompressor::NewOutputSlice() {
+  PushCurSlice();
+  cur_slice_ = std::make_unique<uint8_t[]>(kZstdCompressSliceSize);
+  out_.dst = cur_slice_.get();
+  out_.size = kZstdCompressSliceSize;
+  out_.pos = 0;
+}
+
+void ZstdPacketCompressor::PushCurSlice() {
+  if (cur_slice_) {
+    total_new_slices_size_ += out_.pos;
+    new_slices_.push_back(
+        Slice::TakeOwnership(std::move(cur_slice_), out_.pos));
+  }
+}
+
+}  // namespace
+
+void ZstdCompressFn(std::vector<TracePacket>* packets) {
+  if (packets->empty()) {
+    return;
+  }
+
+  ZstdPacketCompressor stream;
+
+  for (const TracePacket& packet : *packets) {
+    stream.PushPacket(packet);
+  }
+
+  TracePacket packet = stream.Finish();
+
+  packets->clear();
+  packets->push_back(std::move(packet));
+}
+
+}  // namespace perfetto
@@ -209,6 +209,89 @@ class PerfettoTable(TestSuite):
         1,1
         """))
 
+  def test_group_by_dataframe(self):
+    return DiffTestBlueprint(
+        trace=TextProto(''),
+        query="""
+        CREATE PERFETTO TABLE foo AS
+        SELECT column1 AS id, column2 AS name, column3 AS val, column4 AS d
+        FROM (
+          VALUES
+            (1, 'a', 10, 1.5),
+            (2, 'b', NULL, 2.5),
+            (3, 'a', 5, NULL),
+            (4, NULL, 7, 0.5),
+            (5, 'b', 3, 1.0)
+        );
+
+        SELECT
+          name,
+          COUNT(*) AS cnt,
+          COUNT(val) AS cnt_val,
+          SUM(val) AS sum_val,
+          MIN(val) AS min_val,
+          MAX(d) AS max_d
+        FROM foo
+        GROUP BY name
+        """,
+        out=Csv("""
+        "name","cnt","cnt_val","sum_val","min_val","max_d"
+        "[NULL]",1,1,7,7,0.500000
+        "a",2,2,15,5,1.500000
+        "b",2,1,3,3,2.500000
+        """))
+
+  def test_join_dataframes(self):
+    return DiffTestBlueprint(
+        trace=TextProto(''),
+        query="""
+        CREATE PERFETTO TABLE foo AS
+        SELECT column1 AS id, column2 AS name
+        FROM (VALUES (0, 'a'), (1, 'b'), (2, 'c'));
+
+        CREATE PERFETTO TABLE bar AS
+        SELECT column1 AS foo_id, column2 AS val
+        FROM (VALUES (1, 10), (0, 20), (1, 30), (5, 40), (NULL, 50));
+
+        SELECT f.name, b.val
+        FROM foo f
+        JOIN bar b ON b.foo_id = f.id
+        """,
+        out=Csv("""
+        "name","val"
+        "a",20
+        "b",10
+        "b",30
+        """))
+
+  def test_query_plan_cache_same_shape(self):
+    return DiffTestBlueprint(
+        trace=TextProto(''),
+        query="""
+        CREATE PERFETTO TABLE foo AS
+        SELECT column1 AS id, column2 AS a, column3 AS b
+        FROM (VALUES (0, 1, 10), (1, 2, 20), (2, 1, 30), (3, 2, 40));
+
+        CREATE PERFETTO TABLE res AS
+        SELECT 'first' AS q, id FROM foo WHERE a = 1 AND b > 15
+        UNION ALL
+        SELECT 'second' AS q, id FROM foo WHERE a = 2 AND b > 25;
+
+        CREATE PERFETTO INDEX foo_b ON foo(b);
+
+        SELECT q, id FROM res
+        UNION ALL
+        SELECT 'third' AS q, id FROM foo WHERE a = 2 AND b > 15
+        ORDER BY q, id
+        """,
+        out=Csv("""
+        "q","id"
+        "first",2
+        "second",3
+        "third",1
+        "third",3
+        """))
+
   def test_limit(self):
     return DiffTestBlueprint(
         trace=TextProto(''),